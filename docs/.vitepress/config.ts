@@ -46,6 +46,7 @@ export default defineConfig({
               { text: "公网访问建议", link: "/guide/public-access" },
               { text: "时间处理说明", link: "/guide/time-processing" },
               { text: "访问日志", link: "/guide/access-log" },
+              { text: "Prometheus 监控指标", link: "/guide/metrics" },
               { text: "视频快照配置", link: "/guide/video-snapshot" },
             ],
           },
@@ -130,6 +131,7 @@ export default defineConfig({
               { text: "Public Access", link: "/en/guide/public-access" },
               { text: "Time Processing", link: "/en/guide/time-processing" },
               { text: "Access Logging", link: "/en/guide/access-log" },
+              { text: "Prometheus Metrics", link: "/en/guide/metrics" },
               { text: "Video Snapshot", link: "/en/guide/video-snapshot" },
             ],
           },
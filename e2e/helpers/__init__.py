@@ -12,6 +12,7 @@ Sub-modules:
     r2h_process - R2HProcess server wrapper
     mock_rtsp   - MockRTSPServer / MockRTSPServerUDP
     mock_http   - MockHTTPUpstream
+    mock_dns    - MockDNSServer
 """
 
 # Re-export everything so ``from helpers import X`` keeps working.
@@ -37,6 +38,7 @@ from .http import (
     unix_http_request,
     wait_for_status_payload,
 )
+from .mock_dns import MockDNSServer
 from .mock_fcc import MockFCCServer
 from .mock_http import MockHTTPUpstream, MockHTTPUpstreamSilent
 from .mock_rtsp import (
@@ -56,7 +58,7 @@ from .ports import (
     wait_for_unix_socket,
 )
 from .r2h_process import R2HProcess, make_m3u_rtsp_config
-from .rtp import MulticastSender, make_rtp_packet
+from .rtp import MulticastSender, make_rtp_packet, make_ts_idr_payload
 
 __all__ = [
     "BINARY_PATH",
@@ -64,6 +66,7 @@ __all__ = [
     "LOOPBACK_IF",
     "MCAST_ADDR",
     "PROJECT_ROOT",
+    "MockDNSServer",
     "MockFCCServer",
     "MockHTTPUpstream",
     "MockHTTPUpstreamSilent",
@@ -90,6 +93,7 @@ __all__ = [
     "ipv6_loopback_available",
     "make_m3u_rtsp_config",
     "make_rtp_packet",
+    "make_ts_idr_payload",
     "stream_get",
     "unix_http_get",
     "unix_http_request",
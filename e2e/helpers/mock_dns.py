@@ -0,0 +1,159 @@
+"""Mock DNS server for E2E tests.
+
+Answers A / AAAA queries over UDP from a static record table.  Names missing
+from the table get NXDOMAIN with an SOA in the authority section (so the
+answer is negatively cacheable), names present without a record of the
+requested type get NODATA.  A "silent" mode drops every query, allowing
+failover / timeout testing, and a "wrong question" mode answers for a
+different name than the one asked.
+"""
+
+from __future__ import annotations
+
+import socket
+import struct
+import threading
+import time
+
+from .ports import find_free_udp_port
+
+_TYPE_A = 1
+_TYPE_SOA = 6
+_TYPE_AAAA = 28
+_CLASS_IN = 1
+_RCODE_NXDOMAIN = 3
+_HEADER_SIZE = 12
+
+
+def _encode_name(name: str) -> bytes:
+    out = b""
+    for label in name.rstrip(".").split("."):
+        if label:
+            out += bytes([len(label)]) + label.encode()
+    return out + b"\x00"
+
+
+def _decode_name(data: bytes, offset: int) -> tuple[str, int]:
+    labels = []
+    while offset < len(data) and data[offset] != 0:
+        length = data[offset]
+        labels.append(data[offset + 1 : offset + 1 + length].decode(errors="replace"))
+        offset += 1 + length
+    return ".".join(labels), offset + 1
+
+
+class MockDNSServer:
+    """A mock DNS server resolving names from a dict.
+
+    Parameters
+    ----------
+    records : dict
+        Maps lower-case host names to a list of IPv4 / IPv6 address strings.
+    port : int
+        UDP port to listen on (0 = auto).
+    ttl : int
+        TTL of positive answers and SOA minimum of negative answers.
+    delay : float
+        Seconds to wait before each response.
+    silent : bool
+        If ``True``, receive queries but never respond.
+    wrong_question : bool
+        If ``True``, echo a different name in the question section.
+    """
+
+    def __init__(
+        self,
+        records: dict | None = None,
+        port: int = 0,
+        ttl: int = 60,
+        delay: float = 0.0,
+        silent: bool = False,
+        wrong_question: bool = False,
+    ):
+        self.records = {k.lower(): v for k, v in (records or {}).items()}
+        self.port = port or find_free_udp_port()
+        self.ttl = ttl
+        self.delay = delay
+        self.silent = silent
+        self.wrong_question = wrong_question
+
+        self._sock: socket.socket | None = None
+        self._thread: threading.Thread | None = None
+        self._stop = threading.Event()
+
+        # Observable state: (name, qtype) and (source port, transaction ID)
+        # per query received
+        self.queries_received: list[tuple[str, int]] = []
+        self.query_sources: list[tuple[int, int]] = []
+
+    def start(self) -> None:
+        self._sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self._sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self._sock.bind(("127.0.0.1", self.port))
+        self._sock.settimeout(0.2)
+        self._thread = threading.Thread(target=self._loop, daemon=True)
+        self._thread.start()
+
+    def queries_for(self, name: str) -> int:
+        """Number of queries received for a host name (any type)."""
+        return sum(1 for qname, _ in self.queries_received if qname == name.lower())
+
+    def _loop(self) -> None:
+        assert self._sock is not None
+        while not self._stop.is_set():
+            try:
+                data, addr = self._sock.recvfrom(4096)
+            except socket.timeout:
+                continue
+            except OSError:
+                break
+
+            if len(data) < _HEADER_SIZE:
+                continue
+            name, offset = _decode_name(data, _HEADER_SIZE)
+            if offset + 4 > len(data):
+                continue
+            qtype = struct.unpack_from("!H", data, offset)[0]
+            self.queries_received.append((name.lower(), qtype))
+            self.query_sources.append((addr[1], struct.unpack_from("!H", data)[0]))
+            if self.silent:
+                continue
+            if self.delay:
+                time.sleep(self.delay)
+            question = data[_HEADER_SIZE : offset + 4]
+            if self.wrong_question:
+                question = _encode_name("other." + name) + data[offset : offset + 4]
+            self._sock.sendto(self._build_response(data[:2], question, name, qtype), addr)
+
+    def _build_response(self, txid: bytes, question: bytes, name: str, qtype: int) -> bytes:
+        addrs = self.records.get(name.lower())
+        answers = []
+        if addrs is not None:
+            for addr in addrs:
+                family = socket.AF_INET6 if ":" in addr else socket.AF_INET
+                rtype = _TYPE_AAAA if family == socket.AF_INET6 else _TYPE_A
+                if rtype != qtype:
+                    continue
+                rdata = socket.inet_pton(family, addr)
+                answers.append(b"\xc0\x0c" + struct.pack("!HHIH", rtype, _CLASS_IN, self.ttl, len(rdata)) + rdata)
+
+        rcode = _RCODE_NXDOMAIN if addrs is None else 0
+        authority = []
+        if not answers:
+            soa = (
+                _encode_name("ns.mock")
+                + _encode_name("admin.mock")
+                + struct.pack("!IIIII", 1, 3600, 600, 86400, self.ttl)
+            )
+            authority.append(b"\xc0\x0c" + struct.pack("!HHIH", _TYPE_SOA, _CLASS_IN, self.ttl, len(soa)) + soa)
+
+        flags = 0x8180 | rcode
+        header = txid + struct.pack("!HHHHH", flags, 1, len(answers), len(authority), 0)
+        return header + question + b"".join(answers) + b"".join(authority)
+
+    def stop(self) -> None:
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=3)
+        if self._sock:
+            self._sock.close()
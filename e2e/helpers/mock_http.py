@@ -50,9 +50,28 @@ class _UpstreamHandler(BaseHTTPRequestHandler):
             body = body.encode()
         extra_headers = route.get("headers", {})
 
+        # Optional validator: answer a matching If-None-Match with 304
+        etag = route.get("etag")
+        if etag:
+            extra_headers = {**extra_headers, "ETag": etag}
+            if self.headers.get("If-None-Match") == etag:
+                self.send_response(304)
+                self.send_header("ETag", etag)
+                self.end_headers()
+                return
+
         self.send_response(status)
         for k, v in extra_headers.items():
             self.send_header(k, v)
+        if route.get("chunked"):
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            if not head:
+                for i in range(0, len(body), 7):
+                    piece = body[i : i + 7]
+                    self.wfile.write(b"%x\r\n%s\r\n" % (len(piece), piece))
+                self.wfile.write(b"0\r\n\r\n")
+            return
         if "Content-Length" not in extra_headers:
             self.send_header("Content-Length", str(len(body)))
         self.end_headers()
@@ -18,6 +18,30 @@ def _make_ts_with_marker(marker: int) -> bytes:
     return b"\x47\x1f\xff\x10" + struct.pack("!H", marker & 0xFFFF) + b"\xff" * 182
 
 
+def _ts_packet(pid: int, payload: bytes, start: bool = False, cc: int = 0) -> bytes:
+    """188-byte TS packet with payload only, padded with 0xff."""
+    header = struct.pack("!BHB", 0x47, (0x4000 if start else 0) | (pid & 0x1FFF), 0x10 | (cc & 0x0F))
+    return (header + payload + b"\xff" * 184)[:188]
+
+
+def make_ts_idr_payload(video_pid: int = 0x100, pmt_pid: int = 0x1000) -> bytes:
+    """Seven TS packets: PAT, PMT and an H.264 PES starting with an IDR NAL.
+
+    Sent repeatedly, each datagram's PES start ends the previous frame, so a
+    snapshot request captures a complete (if undecodable) IDR access unit.
+    """
+    pat = bytes([0x00, 0x00, 0xB0, 0x0D, 0x00, 0x01, 0xC1, 0x00, 0x00, 0x00, 0x01])
+    pat += struct.pack("!H", 0xE000 | pmt_pid) + b"\x00" * 4
+    pmt = bytes([0x00, 0x02, 0xB0, 0x12, 0x00, 0x01, 0xC1, 0x00, 0x00])
+    pmt += struct.pack("!HH", 0xE000 | video_pid, 0xF000)  # PCR PID, no program info
+    pmt += bytes([0x1B]) + struct.pack("!HH", 0xE000 | video_pid, 0xF000)  # H.264 stream
+    pmt += b"\x00" * 4
+    pes = b"\x00\x00\x01\xe0\x00\x00\x80\x00\x00" + b"\x00\x00\x00\x01\x65" + b"\x88" * 32
+    packets = [_ts_packet(0, pat, start=True), _ts_packet(pmt_pid, pmt, start=True), _ts_packet(video_pid, pes, True)]
+    packets += [_ts_packet(video_pid, b"\x88" * 184, cc=i + 1) for i in range(4)]
+    return b"".join(packets)
+
+
 def make_rtp_packet(
     seq: int,
     timestamp: int,
@@ -56,6 +80,7 @@ class MulticastSender:
         reorder_distance: int = 0,
         unique_payloads: bool = False,
         send_duplicates: bool = False,
+        payload: bytes | None = None,
     ):
         self.addr = addr
         self.port = port or find_free_udp_port()
@@ -64,7 +89,7 @@ class MulticastSender:
         self.reorder_distance = reorder_distance
         self.unique_payloads = unique_payloads
         self.send_duplicates = send_duplicates
-        self._payload = _TS_NULL_PACKET * ts_per_rtp
+        self._payload = payload if payload is not None else _TS_NULL_PACKET * ts_per_rtp
         self._sock: socket.socket | None = None
         self._thread: threading.Thread | None = None
         self._stop = threading.Event()
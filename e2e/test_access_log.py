@@ -6,6 +6,7 @@ status registration without depending on multicast availability.
 """
 
 import re
+import time
 
 import pytest
 
@@ -23,6 +24,9 @@ from helpers import (
 
 pytestmark = pytest.mark.http_proxy
 
+# Lines are written by the supervisor at least once a second (plus its 100ms tick)
+_FLUSH_WAIT = 1.5
+
 
 def _config(port: int, global_lines: list[str] | None = None) -> str:
     lines = ["[global]", "verbosity = 4"]
@@ -42,6 +46,19 @@ def _request_proxy(port: int, upstream: MockHTTPUpstream, path: str = "/hello",
     )
 
 
+def _read_log(path, lines: int = 1, timeout: float = 5.0) -> str:
+    """Wait for the supervisor to write *lines* complete lines to *path*."""
+    deadline = time.monotonic() + timeout
+    text = ""
+    while time.monotonic() < deadline:
+        if path.exists():
+            text = path.read_text()
+            if text.count("\n") >= lines:
+                break
+        time.sleep(0.1)
+    return text
+
+
 def _start_upstream() -> MockHTTPUpstream:
     upstream = MockHTTPUpstream(
         routes={
@@ -62,6 +79,7 @@ def test_access_log_disabled_by_default(r2h_binary, tmp_path):
         status, _, body = _request_proxy(port, upstream)
         assert status == 200
         assert body == b"world"
+        time.sleep(_FLUSH_WAIT)
         assert not log_path.exists()
     finally:
         r2h.stop()
@@ -83,7 +101,7 @@ def test_config_access_log_writes_default_line(r2h_binary, tmp_path):
         assert status == 200
         assert body == b"world"
 
-        lines = log_path.read_text().splitlines()
+        lines = _read_log(log_path).splitlines()
         assert len(lines) == 1
         assert re.search(
             rf'^127\.0\.0\.1:\d+ \[[^\]]+\] "/http/127\.0\.0\.1:{upstream.port}/hello" http "http://127\.0\.0\.1:{upstream.port}/hello"$',
@@ -122,8 +140,8 @@ def test_cli_access_log_overrides_config(r2h_binary, tmp_path):
         assert status == 200
         assert body == b"world"
 
+        assert _read_log(cli_log_path).strip() == f"cli http GET /http/127.0.0.1:{upstream.port}/hello"
         assert not config_log_path.exists()
-        assert cli_log_path.read_text().strip() == f"cli http GET /http/127.0.0.1:{upstream.port}/hello"
     finally:
         r2h.stop()
         upstream.stop()
@@ -160,7 +178,7 @@ def test_custom_format_filters_token_and_expands_placeholders(r2h_binary, tmp_pa
         assert status == 200
         assert body == b"world"
 
-        line = log_path.read_text().strip()
+        line = _read_log(log_path).strip()
         assert line.startswith("$ GET ")
         assert "secret-token" not in line
         assert f"/http/127.0.0.1:{upstream.port}/hello?foo=bar" in line
@@ -199,7 +217,7 @@ def test_client_addr_uses_x_forwarded_for_when_enabled(r2h_binary, tmp_path):
         )
         assert status == 200
         assert body == b"world"
-        assert log_path.read_text().strip() == "203.0.113.7|203.0.113.7|-|203.0.113.7"
+        assert _read_log(log_path).strip() == "203.0.113.7|203.0.113.7|-|203.0.113.7"
     finally:
         r2h.stop()
         upstream.stop()
@@ -230,7 +248,7 @@ def test_user_agent_token_is_redacted(r2h_binary, tmp_path):
         )
         assert status == 200
         assert body == b"world"
-        assert log_path.read_text().strip() == "Player/1.0 TZ/UTC+8"
+        assert _read_log(log_path).strip() == "Player/1.0 TZ/UTC+8"
     finally:
         r2h.stop()
         upstream.stop()
@@ -275,7 +293,7 @@ rtp://{MCAST_ADDR}:{mcast_port}?fcc=127.0.0.1:15970
         )
         assert status == 200
 
-        line = log_path.read_text().strip()
+        line = _read_log(log_path).strip()
         assert "secret-token" not in line
         assert "snapshot=1" in line
         assert f"rtp://{MCAST_ADDR}:{mcast_port}" in line
@@ -298,6 +316,29 @@ def test_non_media_requests_are_not_logged(r2h_binary, tmp_path):
         r2h.start()
         status, _, _ = http_get("127.0.0.1", port, "/status")
         assert status == 200
+        time.sleep(_FLUSH_WAIT)
         assert not log_path.exists()
     finally:
         r2h.stop()
+
+
+def test_lines_are_batched_without_loss(r2h_binary, tmp_path):
+    port = find_free_port()
+    log_path = tmp_path / "access.log"
+    r2h = R2HProcess(
+        r2h_binary,
+        port,
+        config_content=_config(port, [f"access-log = {log_path}", "log-format = $service_url"]),
+    )
+    upstream = _start_upstream()
+    try:
+        r2h.start()
+        for i in range(20):
+            status, _, _ = _request_proxy(port, upstream, f"/hello?n={i}")
+            assert status == 200
+
+        lines = _read_log(log_path, lines=20).splitlines()
+        assert sorted(lines) == sorted(f"/http/127.0.0.1:{upstream.port}/hello?n={i}" for i in range(20))
+    finally:
+        r2h.stop()
+        upstream.stop()
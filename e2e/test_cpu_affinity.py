@@ -0,0 +1,114 @@
+"""E2E coverage for worker CPU pinning and per-worker CPU placement stats."""
+
+from __future__ import annotations
+
+import os
+
+import pytest
+
+from helpers import (
+    R2HProcess,
+    build_single_service_config,
+    find_free_port,
+    http_get,
+    wait_for_status_payload,
+)
+
+
+@pytest.fixture(scope="module")
+def pinned_r2h(r2h_binary):
+    port = find_free_port()
+    config = build_single_service_config(
+        port,
+        "Pinned",
+        "rtp://239.1.1.1:1234",
+        global_lines=["workers = 2", "worker-cpu-affinity = 0", "reuseport-cpu-steering = yes"],
+    )
+    r2h = R2HProcess(r2h_binary, port, config_content=config, capture_log=True)
+    r2h.start()
+    yield r2h
+    r2h.stop()
+
+
+def test_workers_report_pinned_cpu(pinned_r2h):
+    payload = wait_for_status_payload(
+        "127.0.0.1",
+        pinned_r2h.port,
+        lambda p: len([w for w in p.get("workers", []) if w["pid"] > 0]) == 2,
+    )
+    for worker in payload["workers"]:
+        assert worker["cpu"]["affinity"] == 0, worker
+
+
+def test_accepts_are_counted(pinned_r2h):
+    for _ in range(4):
+        status, _, _ = http_get("127.0.0.1", pinned_r2h.port, "/playlist.m3u")
+        assert status == 200
+
+    payload = wait_for_status_payload(
+        "127.0.0.1",
+        pinned_r2h.port,
+        lambda p: sum(w["cpu"]["accepts"] for w in p.get("workers", [])) >= 4,
+    )
+    for worker in payload["workers"]:
+        assert worker["cpu"]["crossCpuAccepts"] <= worker["cpu"]["accepts"]
+
+
+def test_steering_ignored_in_process_mode(pinned_r2h):
+    """Worker processes bind in start-up order, so the listener index does not
+    name a worker and the steering program is not attached."""
+    wait_for_status_payload("127.0.0.1", pinned_r2h.port, lambda p: len(p.get("workers", [])) == 2)
+    log = pinned_r2h.read_log()
+    assert log.count("reuseport-cpu-steering requires worker-threads mode, ignored") == 1
+    assert "SO_ATTACH_REUSEPORT_CBPF failed" not in log
+
+
+def test_steering_in_threads_mode(r2h_binary):
+    port = find_free_port()
+    config = build_single_service_config(
+        port,
+        "Steered",
+        "rtp://239.1.1.1:1234",
+        global_lines=[
+            "workers = 2",
+            "worker-threads = yes",
+            "worker-cpu-affinity = 0",
+            "reuseport-cpu-steering = yes",
+        ],
+    )
+    r2h = R2HProcess(r2h_binary, port, config_content=config, capture_log=True)
+    r2h.start()
+    try:
+        for _ in range(4):
+            status, _, _ = http_get("127.0.0.1", r2h.port, "/playlist.m3u")
+            assert status == 200
+        log = r2h.read_log()
+        assert "requires worker-threads mode" not in log
+        assert "SO_ATTACH_REUSEPORT_CBPF failed" not in log
+    finally:
+        r2h.stop()
+
+
+def test_auto_affinity_threads_use_process_cpus(r2h_binary):
+    """With "auto", every worker thread is placed from the supervisor's CPU
+    set, not from the mask of a thread that already pinned itself."""
+    expected = sorted(os.sched_getaffinity(0))
+    port = find_free_port()
+    config = build_single_service_config(
+        port,
+        "Auto",
+        "rtp://239.1.1.1:1234",
+        global_lines=["workers = 4", "worker-threads = yes", "worker-cpu-affinity = auto"],
+    )
+    r2h = R2HProcess(r2h_binary, port, config_content=config)
+    r2h.start()
+    try:
+        payload = wait_for_status_payload(
+            "127.0.0.1",
+            r2h.port,
+            lambda p: len([w for w in p.get("workers", []) if w["pid"] > 0 and w["cpu"]["affinity"] >= 0]) == 4,
+        )
+        cpus = [w["cpu"]["affinity"] for w in sorted(payload["workers"], key=lambda w: w["id"])]
+        assert cpus == [expected[i % len(expected)] for i in range(4)]
+    finally:
+        r2h.stop()
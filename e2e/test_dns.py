@@ -0,0 +1,151 @@
+"""
+E2E tests for the asynchronous upstream resolver.
+
+A mock DNS server is passed with --dns-server and upstream URLs use host
+names only it knows about, so every answer is observable.
+"""
+
+import pytest
+
+from helpers import (
+    MockDNSServer,
+    MockHTTPUpstream,
+    R2HProcess,
+    find_free_port,
+    find_free_udp_port,
+    http_get,
+    wait_for_status_payload,
+)
+
+pytestmark = pytest.mark.http_proxy
+
+_ROUTES = {"/hello": {"status": 200, "body": b"world", "headers": {"Content-Type": "text/plain"}}}
+
+
+@pytest.fixture()
+def upstream():
+    server = MockHTTPUpstream(routes=_ROUTES)
+    server.start()
+    yield server
+    server.stop()
+
+
+def _start_r2h(binary, dns_servers):
+    port = find_free_port()
+    servers = ",".join("127.0.0.1:%d" % p for p in dns_servers)
+    r2h = R2HProcess(binary, port, extra_args=["-v", "4", "-m", "100", "--dns-server", servers])
+    r2h.start()
+    return r2h
+
+
+class TestResolve:
+    def test_proxy_by_host_name(self, r2h_binary, upstream):
+        dns = MockDNSServer(records={"upstream.r2h.test": ["127.0.0.1"]})
+        dns.start()
+        r2h = _start_r2h(r2h_binary, [dns.port])
+        try:
+            status, _, body = http_get("127.0.0.1", r2h.port, f"/http/upstream.r2h.test:{upstream.port}/hello")
+            assert status == 200
+            assert body == b"world"
+            assert dns.queries_for("upstream.r2h.test") >= 1
+        finally:
+            r2h.stop()
+            dns.stop()
+
+    def test_answer_is_cached(self, r2h_binary, upstream):
+        dns = MockDNSServer(records={"cached.r2h.test": ["127.0.0.1"]}, ttl=60)
+        dns.start()
+        r2h = _start_r2h(r2h_binary, [dns.port])
+        try:
+            for _ in range(3):
+                status, _, _ = http_get("127.0.0.1", r2h.port, f"/http/cached.r2h.test:{upstream.port}/hello")
+                assert status == 200
+            # One A + one AAAA query for all three requests
+            assert dns.queries_for("cached.r2h.test") == 2
+
+            payload = wait_for_status_payload(
+                "127.0.0.1",
+                r2h.port,
+                lambda p: sum(w.get("dns", {}).get("cacheHits", 0) for w in p.get("workers", [])) >= 2,
+            )
+            assert sum(w["dns"]["lookups"] for w in payload["workers"]) == 1
+        finally:
+            r2h.stop()
+            dns.stop()
+
+    def test_nxdomain_returns_503(self, r2h_binary, upstream):
+        dns = MockDNSServer(records={})
+        dns.start()
+        r2h = _start_r2h(r2h_binary, [dns.port])
+        try:
+            status, _, _ = http_get("127.0.0.1", r2h.port, f"/http/missing.r2h.test:{upstream.port}/hello")
+            assert status == 503
+            payload = wait_for_status_payload(
+                "127.0.0.1",
+                r2h.port,
+                lambda p: sum(w.get("dns", {}).get("failures", 0) for w in p.get("workers", [])) >= 1,
+            )
+            assert payload["workers"]
+        finally:
+            r2h.stop()
+            dns.stop()
+
+    def test_failover_to_second_server(self, r2h_binary, upstream):
+        dead = MockDNSServer(silent=True)
+        dead.start()
+        dns = MockDNSServer(records={"failover.r2h.test": ["127.0.0.1"]})
+        dns.start()
+        r2h = _start_r2h(r2h_binary, [dead.port, dns.port])
+        try:
+            status, _, _ = http_get(
+                "127.0.0.1", r2h.port, f"/http/failover.r2h.test:{upstream.port}/hello", timeout=5.0
+            )
+            assert status == 200
+            assert dead.queries_for("failover.r2h.test") >= 1
+            assert dns.queries_for("failover.r2h.test") >= 1
+        finally:
+            r2h.stop()
+            dns.stop()
+            dead.stop()
+
+    def test_unreachable_nameserver_fails(self, r2h_binary, upstream):
+        r2h = _start_r2h(r2h_binary, [find_free_udp_port()])
+        try:
+            status, _, _ = http_get(
+                "127.0.0.1", r2h.port, f"/http/nowhere.r2h.test:{upstream.port}/hello", timeout=8.0
+            )
+            assert status == 503
+        finally:
+            r2h.stop()
+
+    def test_queries_use_fresh_source_ports_and_ids(self, r2h_binary, upstream):
+        names = [f"port{i}.r2h.test" for i in range(4)]
+        dns = MockDNSServer(records={name: ["127.0.0.1"] for name in names})
+        dns.start()
+        r2h = _start_r2h(r2h_binary, [dns.port])
+        try:
+            for name in names:
+                status, _, _ = http_get("127.0.0.1", r2h.port, f"/http/{name}:{upstream.port}/hello")
+                assert status == 200
+            # A and AAAA of one lookup share a socket; every lookup gets its own
+            ports = {port for port, _ in dns.query_sources}
+            ids = {txid for _, txid in dns.query_sources}
+            assert len(dns.query_sources) == 8
+            assert len(ports) == 4
+            assert len(ids) >= 7
+        finally:
+            r2h.stop()
+            dns.stop()
+
+    def test_answer_for_other_question_is_ignored(self, r2h_binary, upstream):
+        dns = MockDNSServer(records={"asked.r2h.test": ["127.0.0.1"]}, wrong_question=True)
+        dns.start()
+        r2h = _start_r2h(r2h_binary, [dns.port])
+        try:
+            status, _, _ = http_get("127.0.0.1", r2h.port, f"/http/asked.r2h.test:{upstream.port}/hello", timeout=8.0)
+            assert status == 503
+            # Every answer was dropped, so the query was retransmitted
+            assert dns.queries_for("asked.r2h.test") > 2
+        finally:
+            r2h.stop()
+            dns.stop()
@@ -6,19 +6,24 @@ Tests cover:
 - Gzipped XML EPG via http://
 - /epg.xml and /epg.xml.gz endpoint routing logic
 - ETag caching (304 Not Modified)
+- Range / If-Range (206, multipart/byteranges, 416) and If-Modified-Since
 - M3U x-tvg-url rewriting (points to /epg.xml or /epg.xml.gz based on source)
 - r2h-token propagation in EPG URLs within M3U
 - 404 when no EPG is configured or when .gz is requested but source is plain XML
 - file:// EPG loading (via auth fixture)
+- /epg.json and /epg.xml?channel= queries answered from the programme index
 
-Four module-scoped rtp2httpd instances are used (one per distinct EPG config):
+
+Five module-scoped rtp2httpd instances are used (one per distinct EPG config):
 - no_epg_r2h:    no x-tvg-url configured
 - plain_epg_r2h: uncompressed XML loaded from HTTP upstream
 - gz_epg_r2h:    gzipped XML loaded from HTTP upstream
 - auth_epg_r2h:  uncompressed XML loaded from file:// with r2h-token
+- indexed_epg_r2h: generated multi-channel guide, gzipped, from file://
 """
 
 import gzip
+import json
 import os
 import time
 
@@ -47,6 +52,34 @@ SAMPLE_EPG_XML = """\
 
 SECRET = "s3cret-t0ken"
 
+# Generated guide: hourly programmes from GUIDE_START on three channels
+GUIDE_START = 1767225600  # 2026-01-01 00:00:00 UTC
+GUIDE_HOURS = 240
+
+
+def _xmltv_time(ts):
+    return time.strftime("%Y%m%d%H%M%S +0000", time.gmtime(ts))
+
+
+def _generated_guide():
+    parts = ['<?xml version="1.0" encoding="UTF-8"?>\n<!-- generated > guide -->\n<tv>\n']
+    for ch, name in (("cctv1", "CCTV-1 综合"), ("cctv2", "CCTV-2"), ("news", "News &amp; Weather")):
+        parts.append(f'  <channel id="{ch}">\n    <display-name lang="zh">{name}</display-name>\n  </channel>\n')
+    for ch in ("cctv1", "cctv2", "news"):
+        for h in range(GUIDE_HOURS):
+            start = GUIDE_START + h * 3600
+            # Local-time stamps (+0800) must be normalised to UTC
+            local = time.strftime("%Y%m%d%H%M%S +0800", time.gmtime(start + 8 * 3600))
+            stop = _xmltv_time(start + 3600)
+            parts.append(
+                f'  <programme start="{local}" stop="{stop}" channel="{ch}">\n'
+                f'    <title lang="zh">{ch} Show {h} &amp; Friends</title>\n'
+                f"    <desc><![CDATA[Episode {h} <live>]]></desc>\n"
+                "  </programme>\n"
+            )
+    parts.append("</tv>\n")
+    return "".join(parts).encode()
+
 
 # ---------------------------------------------------------------------------
 # Module-scoped shared fixtures (4 rtp2httpd instances)
@@ -186,6 +219,34 @@ rtp://239.0.0.1:1234
     os.unlink(epg_path)
 
 
+@pytest.fixture(scope="module")
+def indexed_epg_r2h(r2h_binary):
+    """rtp2httpd with a generated guide stored as a two-member gzip file."""
+    guide = _generated_guide()
+    half = len(guide) // 2
+    gz_data = gzip.compress(guide[:half], compresslevel=9) + gzip.compress(guide[half:], compresslevel=1)
+    epg_path = write_temp_file(gz_data, suffix=".xml.gz", prefix="r2h_epg_")
+    port = find_free_port()
+    config = f"""\
+[global]
+verbosity = 4
+
+[bind]
+* {port}
+
+[services]
+#EXTM3U x-tvg-url="file://{epg_path}"
+#EXTINF:-1,Channel
+rtp://239.0.0.1:1234
+"""
+    r2h = R2HProcess(r2h_binary, port, config_content=config, capture_log=True)
+    r2h.start()
+    time.sleep(0.5)
+    yield r2h
+    r2h.stop()
+    os.unlink(epg_path)
+
+
 # ---------------------------------------------------------------------------
 # No EPG configured
 # ---------------------------------------------------------------------------
@@ -310,6 +371,80 @@ class TestEPGETag:
         assert_etag_cache_behavior("127.0.0.1", plain_epg_r2h.port, "/epg.xml")
 
 
+class TestEPGRange:
+    """Range and Last-Modified handling on the cached EPG file."""
+
+    def _get(self, r2h, headers):
+        return http_get("127.0.0.1", r2h.port, "/epg.xml", headers=headers)
+
+    def test_validators_advertised(self, plain_epg_r2h):
+        status, hdrs, _ = self._get(plain_epg_r2h, {})
+        assert status == 200
+        assert hdrs.get("Accept-Ranges") == "bytes"
+        assert hdrs.get("Last-Modified", "").endswith(" GMT")
+
+    def test_single_range(self, plain_epg_r2h):
+        status, hdrs, body = self._get(plain_epg_r2h, {"Range": "bytes=0-9"})
+        assert status == 206
+        assert body == SAMPLE_EPG_XML.encode()[:10]
+        assert hdrs.get("Content-Range") == "bytes 0-9/%d" % len(SAMPLE_EPG_XML)
+
+    def test_suffix_range(self, plain_epg_r2h):
+        status, _, body = self._get(plain_epg_r2h, {"Range": "bytes=-6"})
+        assert status == 206
+        assert body == SAMPLE_EPG_XML.encode()[-6:]
+
+    def test_multiple_ranges(self, plain_epg_r2h):
+        data = SAMPLE_EPG_XML.encode()
+        status, hdrs, body = self._get(plain_epg_r2h, {"Range": "bytes=0-4, 10-19"})
+        assert status == 206
+        ctype = hdrs.get("Content-Type", "")
+        assert ctype.startswith("multipart/byteranges; boundary=")
+        boundary = ctype.split("boundary=", 1)[1].encode()
+        assert int(hdrs["Content-Length"]) == len(body)
+        assert body.endswith(b"--" + boundary + b"--\r\n")
+        assert b"Content-Range: bytes 0-4/%d\r\n\r\n" % len(data) + data[0:5] in body
+        assert b"Content-Range: bytes 10-19/%d\r\n\r\n" % len(data) + data[10:20] in body
+
+    def test_overlapping_ranges_coalesced(self, plain_epg_r2h):
+        data = SAMPLE_EPG_XML.encode()
+        # Repeated whole-body ranges collapse into one, not sixteen copies
+        status, hdrs, body = self._get(plain_epg_r2h, {"Range": "bytes=" + ",".join(["0-"] * 16)})
+        assert status == 206
+        assert body == data
+        assert hdrs.get("Content-Range") == "bytes 0-%d/%d" % (len(data) - 1, len(data))
+
+        # Overlapping and adjacent ranges merge, separate ones stay apart
+        status, hdrs, body = self._get(plain_epg_r2h, {"Range": "bytes=20-29, 0-4, 3-9, 10-12"})
+        assert status == 206
+        ctype = hdrs.get("Content-Type", "")
+        assert ctype.startswith("multipart/byteranges; boundary=")
+        assert body.count(b"Content-Range: ") == 2
+        assert b"Content-Range: bytes 0-12/%d\r\n\r\n" % len(data) + data[0:13] in body
+        assert b"Content-Range: bytes 20-29/%d\r\n\r\n" % len(data) + data[20:30] in body
+
+    def test_unsatisfiable_range(self, plain_epg_r2h):
+        status, hdrs, _ = self._get(plain_epg_r2h, {"Range": "bytes=99999999-"})
+        assert status == 416
+        assert hdrs.get("Content-Range") == "bytes */%d" % len(SAMPLE_EPG_XML)
+
+    def test_if_range(self, plain_epg_r2h):
+        _, hdrs, _ = self._get(plain_epg_r2h, {})
+        status, _, _ = self._get(plain_epg_r2h, {"Range": "bytes=0-9", "If-Range": hdrs["ETag"]})
+        assert status == 206
+        status, _, body = self._get(plain_epg_r2h, {"Range": "bytes=0-9", "If-Range": '"stale"'})
+        assert status == 200
+        assert body == SAMPLE_EPG_XML.encode()
+
+    def test_if_modified_since(self, plain_epg_r2h):
+        _, hdrs, _ = self._get(plain_epg_r2h, {})
+        status, _, body = self._get(plain_epg_r2h, {"If-Modified-Since": hdrs["Last-Modified"]})
+        assert status == 304
+        assert body == b""
+        status, _, _ = self._get(plain_epg_r2h, {"If-Modified-Since": "Thu, 01 Jan 1970 00:00:00 GMT"})
+        assert status == 200
+
+
 # ---------------------------------------------------------------------------
 # r2h-token authentication (also tests file:// loading path)
 # ---------------------------------------------------------------------------
@@ -344,3 +479,91 @@ class TestEPGAuth:
         text = body.decode()
         assert "x-tvg-url=" in text
         assert "r2h-token=" in text
+
+
+# ---------------------------------------------------------------------------
+# Programme index queries (indexed_epg_r2h)
+# ---------------------------------------------------------------------------
+
+
+class TestEPGQuery:
+    """/epg.json and /epg.xml?channel= answer from the programme index."""
+
+    def _query(self, r2h, path):
+        status, hdrs, body = http_get("127.0.0.1", r2h.port, path)
+        assert status == 200
+        assert int(hdrs["Content-Length"]) == len(body)
+        return json.loads(body)
+
+    def test_now_and_next(self, indexed_epg_r2h):
+        now = GUIDE_START + 5 * 3600 + 120
+        data = self._query(indexed_epg_r2h, f"/epg.json?channel=cctv1&start={now}&next=1")
+        assert len(data["channels"]) == 1
+        channel = data["channels"][0]
+        assert channel["id"] == "cctv1"
+        assert channel["name"] == "CCTV-1 综合"
+        progs = channel["programmes"]
+        assert [p["title"] for p in progs] == ["cctv1 Show 5 & Friends", "cctv1 Show 6 & Friends"]
+        assert progs[0]["start"] == GUIDE_START + 5 * 3600
+        assert progs[0]["stop"] == GUIDE_START + 6 * 3600
+        assert progs[0]["desc"] == "Episode 5 <live>"
+
+    def test_window_across_channels(self, indexed_epg_r2h):
+        start = GUIDE_START + 100 * 3600
+        end = start + 3 * 3600
+        data = self._query(indexed_epg_r2h, f"/epg.json?channel=cctv2,missing,News%20%26%20Weather&start={start}&end={end}")
+        assert [c["id"] for c in data["channels"]] == ["cctv2", "news"]
+        for channel in data["channels"]:
+            assert [p["start"] for p in channel["programmes"]] == [start, start + 3600, start + 7200]
+
+    def test_wide_window_is_cut_to_two_days(self, indexed_epg_r2h):
+        start = GUIDE_START
+        end = start + 9 * 86400
+        data = self._query(indexed_epg_r2h, f"/epg.json?channel=cctv1,cctv2,news&start={start}&end={end}")
+        assert len(data["channels"]) == 3
+        for channel in data["channels"]:
+            starts = [p["start"] for p in channel["programmes"]]
+            assert starts == [start + h * 3600 for h in range(48)]
+
+    def test_last_programme_of_gzip_member_boundary(self, indexed_epg_r2h):
+        last = GUIDE_START + (GUIDE_HOURS - 1) * 3600
+        data = self._query(indexed_epg_r2h, f"/epg.json?channel=news&start={last}")
+        assert [p["title"] for p in data["channels"][0]["programmes"]] == [f"news Show {GUIDE_HOURS - 1} & Friends"]
+
+    def test_xmltv_fragment(self, indexed_epg_r2h):
+        start = GUIDE_START + 10 * 3600
+        status, hdrs, body = http_get(
+            "127.0.0.1", indexed_epg_r2h.port, f"/epg.xml?channel=cctv1&start={start}&next=2"
+        )
+        assert status == 200
+        assert "xml" in hdrs.get("Content-Type", "")
+        assert hdrs.get("Content-Encoding", "") == ""
+        text = body.decode()
+        assert text.index("<channel id=\"cctv1\">") < text.index("<programme")
+        assert text.count("<programme ") == 3
+        assert f'start="{_xmltv_time(start)}"' in text
+        assert "<title>cctv1 Show 10 &amp; Friends</title>" in text
+        assert "<desc>Episode 10 &lt;live&gt;</desc>" in text
+
+    def test_build_logged_by_worker(self, indexed_epg_r2h):
+        # The builder thread hands its outcome to the event loop, which logs it
+        # through the worker's own log ring
+        deadline = time.monotonic() + 5.0
+        while "EPG index built" not in indexed_epg_r2h.read_log() and time.monotonic() < deadline:
+            time.sleep(0.1)
+        lines = [line for line in indexed_epg_r2h.read_log().splitlines() if "EPG index built" in line]
+        assert lines
+        assert all(line.startswith("[Worker 0] ") for line in lines)
+
+    def test_full_guide_still_served(self, indexed_epg_r2h):
+        status, _, body = http_get("127.0.0.1", indexed_epg_r2h.port, "/epg.xml.gz")
+        assert status == 200
+        assert gzip.decompress(body) == _generated_guide()
+
+    def test_channel_required(self, indexed_epg_r2h):
+        status, _, _ = http_get("127.0.0.1", indexed_epg_r2h.port, "/epg.json")
+        assert status == 400
+
+    def test_no_index_without_epg(self, no_epg_r2h):
+        status, _, _ = http_get("127.0.0.1", no_epg_r2h.port, "/epg.json?channel=CH1")
+        assert status == 404
@@ -186,6 +186,28 @@ class TestMalformedHTTP:
         status, _, _ = http_get("127.0.0.1", basic_r2h.port, "/status")
         assert status == 200
 
+    def test_fragmented_request_head(self, basic_r2h):
+        """A head split across many segments (mid-line, mid-CRLF) is parsed in place."""
+        request = (
+            b"GET /status HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+            + b"".join(b"X-Filler-%d: %s\r\n" % (i, b"v" * 40) for i in range(80))
+            + b"Connection: close\r\n\r\n"
+        )
+        with socket.create_connection(("127.0.0.1", basic_r2h.port), timeout=3) as sock:
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            for i in range(0, len(request), 7):
+                sock.sendall(request[i : i + 7])
+                if i % 700 == 0:
+                    time.sleep(0.01)
+            data = b""
+            while True:
+                chunk = sock.recv(65536)
+                if not chunk:
+                    break
+                data += chunk
+        assert data.startswith(b"HTTP/1.1 200")
+        assert b"Connection: close" in data.split(b"\r\n\r\n", 1)[0]
+
 
 # ---------------------------------------------------------------------------
 # Concurrent connections
@@ -238,8 +260,8 @@ class TestConnectionClose:
     """Verify the server properly closes connections."""
 
     def test_server_sends_connection_close(self, basic_r2h):
-        """Non-streaming responses should have Connection: close."""
-        status, hdrs, _ = http_get("127.0.0.1", basic_r2h.port, "/status")
+        """Responses to a request asking for close should have Connection: close."""
+        status, hdrs, _ = http_get("127.0.0.1", basic_r2h.port, "/status", headers={"Connection": "close"})
         assert status == 200
         conn_hdr = hdrs.get("Connection", hdrs.get("connection", ""))
         assert "close" in conn_hdr.lower() or conn_hdr == ""
@@ -6,6 +6,8 @@ that accepts requests and streams unicast RTP data before transitioning
 to multicast.
 """
 
+import os
+import signal
 import time
 
 import pytest
@@ -16,9 +18,11 @@ from helpers import (
     MockFCCServer,
     MulticastSender,
     R2HProcess,
+    build_config,
     find_free_port,
     find_free_udp_port,
     find_free_udp_port_pair,
+    http_get,
     stream_get,
 )
 
@@ -41,6 +45,15 @@ def shared_r2h(r2h_binary):
     r2h.stop()
 
 
+def _metric(r2h_port, name):
+    _, _, body = http_get("127.0.0.1", r2h_port, "/metrics", timeout=5.0)
+    total = 0
+    for line in body.decode().splitlines():
+        if line.startswith(name + "{") or line.startswith(name + " "):
+            total += int(float(line.rpartition(" ")[2]))
+    return total
+
+
 # ---------------------------------------------------------------------------
 # Telecom FCC protocol
 # ---------------------------------------------------------------------------
@@ -101,6 +114,109 @@ class TestTelecomFCC:
         finally:
             fcc.stop()
 
+    def test_fcc_socket_reused_for_next_channel(self, r2h_binary):
+        """The next zap takes a spare socket bound ahead of time."""
+        base = find_free_udp_port()
+        r2h_port = find_free_port()
+        r2h = R2HProcess(
+            r2h_binary,
+            r2h_port,
+            extra_args=["-v", "4", "-m", "100", "-r", LOOPBACK_IF, "-P", f"{base}-{base + 99}"],
+        )
+        fcc = MockFCCServer(
+            mcast_addr=MCAST_ADDR,
+            protocol="telecom",
+            unicast_pps=300,
+            sync_after=0,
+        )
+        r2h.start()
+        fcc.start()
+        try:
+            session_ports = []
+            for _ in range(2):
+                requests_before = len(fcc.request_client_addrs)
+                status, _, body = stream_get(
+                    "127.0.0.1",
+                    r2h.port,
+                    f"/rtp/{MCAST_ADDR}:{find_free_udp_port()}?fcc=127.0.0.1:{fcc.port}",
+                    read_bytes=4096,
+                    timeout=_FCC_STREAM_TIMEOUT,
+                )
+                assert status == 200
+                assert len(body) > 0 and body[0] == 0x47
+                session_ports.append({addr[1] for addr in fcc.request_client_addrs[requests_before:]})
+
+                deadline = time.monotonic() + 5.0
+                while _metric(r2h.port, "rtp2httpd_fcc_socket_pool_idle") < 1 and time.monotonic() < deadline:
+                    time.sleep(0.1)
+
+            assert len(fcc.request_client_addrs) >= 2
+            ports = {addr[1] for addr in fcc.request_client_addrs}
+            assert all(base <= port <= base + 99 for port in ports)
+            assert _metric(r2h.port, "rtp2httpd_fcc_socket_pool_hits_total") >= 1
+            # The ended session's socket is closed, not handed to the next zap
+            assert session_ports[1] and not session_ports[0] & session_ports[1]
+        finally:
+            fcc.stop()
+            r2h.stop()
+
+    def test_fcc_parked_sockets_follow_reloaded_port_range(self, r2h_binary):
+        """Sockets parked in the old fcc-listen-port-range are closed on reload."""
+        base = find_free_udp_port()
+        r2h_port = find_free_port()
+        config = build_config(
+            r2h_port,
+            global_lines=[
+                "maxclients = 100",
+                f"upstream-interface = {LOOPBACK_IF}",
+                f"fcc-listen-port-range = {base}-{base + 99}",
+            ],
+        )
+        r2h = R2HProcess(r2h_binary, r2h_port, config_content=config, capture_log=True)
+        fcc = MockFCCServer(
+            mcast_addr=MCAST_ADDR,
+            protocol="telecom",
+            unicast_pps=300,
+            sync_after=0,
+        )
+        r2h.start()
+        fcc.start()
+
+        def zap():
+            status, _, body = stream_get(
+                "127.0.0.1",
+                r2h.port,
+                f"/rtp/{MCAST_ADDR}:{find_free_udp_port()}?fcc=127.0.0.1:{fcc.port}",
+                read_bytes=4096,
+                timeout=_FCC_STREAM_TIMEOUT,
+            )
+            assert status == 200
+            assert len(body) > 0 and body[0] == 0x47
+
+        try:
+            zap()
+            deadline = time.monotonic() + 5.0
+            while _metric(r2h.port, "rtp2httpd_fcc_socket_pool_idle") < 1 and time.monotonic() < deadline:
+                time.sleep(0.1)
+            assert _metric(r2h.port, "rtp2httpd_fcc_socket_pool_idle") >= 1
+
+            with open(r2h._config_path, "w") as config_file:
+                config_file.write(config.replace(f"{base}-{base + 99}", f"{base + 200}-{base + 299}"))
+            os.kill(r2h.process.pid, signal.SIGHUP)
+            deadline = time.monotonic() + 5.0
+            while "[Worker 0] Configuration reloaded" not in r2h.read_log() and time.monotonic() < deadline:
+                time.sleep(0.1)
+            assert "[Worker 0] Configuration reloaded" in r2h.read_log()
+
+            requests_before = len(fcc.request_client_addrs)
+            zap()
+            new_ports = [addr[1] for addr in fcc.request_client_addrs[requests_before:]]
+            assert new_ports
+            assert all(base + 200 <= port <= base + 299 for port in new_ports)
+        finally:
+            fcc.stop()
+            r2h.stop()
+
     def test_fcc_redirect_to_unicast_stream(self, shared_r2h):
         """Telecom duplicate redirect responses should not consume redirect budget."""
         mcast_port = find_free_udp_port()
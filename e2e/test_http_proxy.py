@@ -5,6 +5,8 @@ These tests start a mock HTTP upstream, point rtp2httpd at it via
 /http/127.0.0.1:<port>/..., and verify responses are correctly proxied.
 """
 
+import socket
+import threading
 import time
 
 import pytest
@@ -14,6 +16,7 @@ from helpers import (
     MockHTTPUpstreamSilent,
     R2HProcess,
     find_free_port,
+    get_header,
     http_get,
     stream_get,
 )
@@ -553,3 +556,330 @@ class TestProxyEmptyBody:
             assert body == b""
         finally:
             upstream.stop()
+
+
+# ---------------------------------------------------------------------------
+# Upstream keep-alive
+# ---------------------------------------------------------------------------
+
+
+class _KeepAliveUpstream:
+    """HTTP/1.1 upstream serving any number of requests per connection.
+
+    Every response carries ``body``, framed by Content-Length or, with
+    ``chunked``, by chunks.  With ``close_idle`` the connection is closed
+    right after each response without announcing it, like an upstream whose
+    idle timeout expired.  With ``stall`` only the first half of each
+    response is sent until ``release`` is set.
+    """
+
+    def __init__(self, body=b"segment-data", *, chunked=False, close_idle=False, stall=False):
+        self.port = find_free_port()
+        self.body = body
+        self.chunked = chunked
+        self.close_idle = close_idle
+        self.stall = stall
+        self.release = threading.Event()
+        self.stalled = threading.Event()
+        self.connections = 0
+        self.requests = 0
+        self._server_sock = None
+        self._thread = None
+        self._stop = threading.Event()
+
+    def start(self):
+        self._server_sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self._server_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self._server_sock.bind(("127.0.0.1", self.port))
+        self._server_sock.listen(8)
+        self._server_sock.settimeout(0.5)
+        self._thread = threading.Thread(target=self._accept, daemon=True)
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        if self._server_sock:
+            self._server_sock.close()
+        if self._thread:
+            self._thread.join(timeout=3)
+
+    def _accept(self):
+        while not self._stop.is_set():
+            try:
+                conn, _ = self._server_sock.accept()
+            except socket.timeout:
+                continue
+            except OSError:
+                break
+            self.connections += 1
+            threading.Thread(target=self._handle, args=(conn,), daemon=True).start()
+
+    def _response(self):
+        if self.chunked:
+            head = b"HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\nTransfer-Encoding: chunked\r\n\r\n"
+            half = len(self.body) // 2
+            parts = [self.body[:half], self.body[half:]]
+            return head + b"".join(b"%x\r\n%s\r\n" % (len(p), p) for p in parts if p) + b"0\r\n\r\n"
+        head = b"HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\nContent-Length: %d\r\n\r\n" % len(self.body)
+        return head + self.body
+
+    def _handle(self, conn):
+        pending = b""
+        conn.settimeout(0.5)
+        try:
+            while not self._stop.is_set():
+                if b"\r\n\r\n" not in pending:
+                    try:
+                        chunk = conn.recv(4096)
+                    except socket.timeout:
+                        continue
+                    if not chunk:
+                        return
+                    pending += chunk
+                    continue
+                _, pending = pending.split(b"\r\n\r\n", 1)
+                self.requests += 1
+                response = self._response()
+                if self.stall:
+                    conn.sendall(response[: len(response) // 2])
+                    self.stalled.set()
+                    self.release.wait(timeout=10.0)
+                    response = response[len(response) // 2 :]
+                conn.sendall(response)
+                if self.close_idle:
+                    return
+        except OSError:
+            pass
+        finally:
+            conn.close()
+
+
+def _metric(r2h_port, name):
+    _, _, body = http_get("127.0.0.1", r2h_port, "/metrics", timeout=5.0)
+    total = 0
+    for line in body.decode().splitlines():
+        if line.startswith(name + "{") or line.startswith(name + " "):
+            total += int(float(line.rpartition(" ")[2]))
+    return total
+
+
+class TestProxyUpstreamKeepAlive:
+    """Upstream connections are reused across proxied requests."""
+
+    @pytest.mark.parametrize("chunked", [False, True], ids=["content-length", "chunked"])
+    def test_connection_reused(self, shared_r2h, chunked):
+        upstream = _KeepAliveUpstream(chunked=chunked)
+        upstream.start()
+        try:
+            reuses_before = _metric(shared_r2h.port, "rtp2httpd_http_upstream_reuses_total")
+            for i in range(3):
+                status, _, body = http_get(
+                    "127.0.0.1",
+                    shared_r2h.port,
+                    "/http/127.0.0.1:%d/seg%d.ts" % (upstream.port, i),
+                    timeout=5.0,
+                )
+                assert status == 200
+                assert body == upstream.body
+            assert upstream.requests == 3
+            assert upstream.connections == 1, "Expected all requests on one upstream connection"
+            assert _metric(shared_r2h.port, "rtp2httpd_http_upstream_reuses_total") - reuses_before == 2
+        finally:
+            upstream.stop()
+
+    def test_closed_idle_connection_not_reused(self, shared_r2h):
+        """A connection the upstream dropped while idle is replaced."""
+        upstream = _KeepAliveUpstream(close_idle=True)
+        upstream.start()
+        try:
+            for i in range(2):
+                status, _, body = http_get(
+                    "127.0.0.1",
+                    shared_r2h.port,
+                    "/http/127.0.0.1:%d/seg%d.ts" % (upstream.port, i),
+                    timeout=5.0,
+                )
+                assert status == 200
+                assert body == upstream.body
+                time.sleep(0.2)
+            assert upstream.connections == 2
+        finally:
+            upstream.stop()
+
+
+# ---------------------------------------------------------------------------
+# HLS segment cache
+# ---------------------------------------------------------------------------
+
+
+@pytest.fixture(scope="module")
+def segment_cache_r2h(r2h_binary):
+    port = find_free_port()
+    r2h = R2HProcess(r2h_binary, port, extra_args=["-v", "4", "-m", "100", "--http-proxy-segment-cache", "4"])
+    r2h.start()
+    yield r2h
+    r2h.stop()
+
+
+def _get_in_thread(r2h_port, path, results, headers=None):
+    def run():
+        results.append(http_get("127.0.0.1", r2h_port, path, timeout=10.0, headers=headers))
+
+    thread = threading.Thread(target=run, daemon=True)
+    thread.start()
+    return thread
+
+
+class TestProxySegmentCache:
+    """Clients fetching the same segment share one upstream download."""
+
+    _BODY = bytes(range(256)) * 256
+
+    def _fetch_while_stalled(self, r2h, upstream, path):
+        """Two clients request path while the upstream is halfway through it."""
+        results = []
+        first = _get_in_thread(r2h.port, path, results)
+        assert upstream.stalled.wait(timeout=5.0), "Upstream never got the first request"
+        second = _get_in_thread(r2h.port, path, results)
+        time.sleep(0.5)
+        upstream.release.set()
+        first.join(timeout=10.0)
+        second.join(timeout=10.0)
+        return results
+
+    def test_concurrent_requests_share_download(self, segment_cache_r2h):
+        upstream = _KeepAliveUpstream(body=self._BODY, stall=True)
+        upstream.start()
+        try:
+            path = "/http/127.0.0.1:%d/live/seg1.ts" % upstream.port
+            coalesced_before = _metric(segment_cache_r2h.port, "rtp2httpd_http_segment_coalesced_total")
+            results = self._fetch_while_stalled(segment_cache_r2h, upstream, path)
+            assert len(results) == 2
+            for status, hdrs, body in results:
+                assert status == 200
+                assert body == self._BODY
+            assert upstream.requests == 1
+            assert _metric(segment_cache_r2h.port, "rtp2httpd_http_segment_coalesced_total") - coalesced_before == 1
+
+            # Later requests, ranges included, are answered from the cache
+            hits_before = _metric(segment_cache_r2h.port, "rtp2httpd_http_segment_cache_hits_total")
+            status, _, body = http_get("127.0.0.1", segment_cache_r2h.port, path, timeout=5.0)
+            assert status == 200
+            assert body == self._BODY
+            status, hdrs, body = http_get(
+                "127.0.0.1", segment_cache_r2h.port, path, timeout=5.0, headers={"Range": "bytes=100-199"}
+            )
+            assert status == 206
+            assert body == self._BODY[100:200]
+            assert upstream.requests == 1
+            assert _metric(segment_cache_r2h.port, "rtp2httpd_http_segment_cache_hits_total") - hits_before == 2
+        finally:
+            upstream.release.set()
+            upstream.stop()
+
+    def test_unshareable_response_fetched_separately(self, segment_cache_r2h):
+        """Without a Content-Length, the waiting client fetches on its own."""
+        upstream = _KeepAliveUpstream(body=self._BODY, chunked=True, stall=True)
+        upstream.start()
+        try:
+            path = "/http/127.0.0.1:%d/live/seg2.ts" % upstream.port
+            results = self._fetch_while_stalled(segment_cache_r2h, upstream, path)
+            assert len(results) == 2
+            for status, _, body in results:
+                assert status == 200
+                assert body == self._BODY
+            assert upstream.requests == 2
+        finally:
+            upstream.release.set()
+            upstream.stop()
+
+    def test_playlist_not_cached(self, segment_cache_r2h):
+        upstream = MockHTTPUpstream(
+            routes={"/live/index.m3u8": {"body": b"#EXTM3U\n", "headers": {"Content-Type": "application/x-mpegURL"}}}
+        )
+        upstream.start()
+        try:
+            for _ in range(2):
+                status, _, _ = http_get(
+                    "127.0.0.1", segment_cache_r2h.port, "/http/127.0.0.1:%d/live/index.m3u8" % upstream.port
+                )
+                assert status == 200
+            assert len(upstream.requests_log) == 2
+        finally:
+            upstream.stop()
+
+    def _fetch_twice(self, r2h, upstream, path, headers=None):
+        for _ in range(2):
+            status, _, body = http_get("127.0.0.1", r2h.port, path, timeout=5.0, headers=headers)
+            assert status == 200
+            assert body == self._BODY
+        return len(upstream.requests_log)
+
+    def test_segment_expires_after_max_age(self, segment_cache_r2h):
+        """The lifetime runs from when the segment was stored; hits do not extend it."""
+        upstream = MockHTTPUpstream(
+            routes={"/live/seg3.ts": {"body": self._BODY, "headers": {"Cache-Control": "max-age=1"}}}
+        )
+        upstream.start()
+        try:
+            path = "/http/127.0.0.1:%d/live/seg3.ts" % upstream.port
+            assert self._fetch_twice(segment_cache_r2h, upstream, path) == 1
+
+            time.sleep(0.6)
+            status, hdrs, _ = http_get("127.0.0.1", segment_cache_r2h.port, path, timeout=5.0)
+            assert status == 200
+            assert get_header(hdrs, "Age") == "0"
+            assert len(upstream.requests_log) == 1
+
+            time.sleep(0.6)
+            status, _, body = http_get("127.0.0.1", segment_cache_r2h.port, path, timeout=5.0)
+            assert status == 200
+            assert body == self._BODY
+            assert len(upstream.requests_log) == 2
+        finally:
+            upstream.stop()
+
+    @pytest.mark.parametrize(
+        "headers",
+        [
+            {"Cache-Control": "no-store"},
+            {"Cache-Control": "no-cache"},
+            {"Cache-Control": "private, max-age=30"},
+            {"Cache-Control": "max-age=0"},
+            {"Expires": "Thu, 01 Jan 1970 00:00:00 GMT"},
+            {"Expires": "0"},
+        ],
+        ids=["no-store", "no-cache", "private", "max-age-0", "expired", "invalid-expires"],
+    )
+    def test_uncacheable_response_not_cached(self, segment_cache_r2h, headers):
+        upstream = MockHTTPUpstream(routes={"/live/seg4.ts": {"body": self._BODY, "headers": headers}})
+        upstream.start()
+        try:
+            path = "/http/127.0.0.1:%d/live/seg4.ts" % upstream.port
+            assert self._fetch_twice(segment_cache_r2h, upstream, path) == 2
+        finally:
+            upstream.stop()
+
+    def test_s_maxage_overrides_max_age(self, segment_cache_r2h):
+        upstream = MockHTTPUpstream(
+            routes={"/live/seg5.ts": {"body": self._BODY, "headers": {"Cache-Control": "max-age=0, s-maxage=30"}}}
+        )
+        upstream.start()
+        try:
+            path = "/http/127.0.0.1:%d/live/seg5.ts" % upstream.port
+            assert self._fetch_twice(segment_cache_r2h, upstream, path) == 1
+        finally:
+            upstream.stop()
+
+    def test_request_with_cookie_bypasses_cache(self, segment_cache_r2h):
+        upstream = MockHTTPUpstream(routes={"/live/seg6.ts": {"body": self._BODY}})
+        upstream.start()
+        try:
+            path = "/http/127.0.0.1:%d/live/seg6.ts" % upstream.port
+            assert self._fetch_twice(segment_cache_r2h, upstream, path, headers={"Cookie": "session=abc"}) == 2
+            assert upstream.requests_log[-1]["headers"].get("Cookie") == "session=abc"
+
+            # Without the cookie the segment is cached as usual
+            assert self._fetch_twice(segment_cache_r2h, upstream, path) == 3
+        finally:
+            upstream.stop()
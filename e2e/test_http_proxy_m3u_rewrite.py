@@ -804,9 +804,10 @@ class TestM3URewriteChunked:
             assert text.startswith("#EXTM3U\n")
             assert f"/http/127.0.0.1:{upstream.port}/video/321124334400000.jpeg" in text
             assert not any(line.endswith("/0") for line in text.splitlines())
-            assert get_header(hdrs, "Transfer-Encoding") == ""
             assert get_header(hdrs, "Trailer") == ""
-            assert int(get_header(hdrs, "Content-Length")) == len(body)
+            # Lines are passed on as they complete, re-chunked by rtp2httpd
+            assert get_header(hdrs, "Transfer-Encoding").lower() == "chunked"
+            assert get_header(hdrs, "Content-Length") == ""
         finally:
             upstream.stop()
 
@@ -964,7 +965,7 @@ class TestM3URewritePlaylistVariants:
             upstream.stop()
 
     @pytest.mark.parametrize("upstream_mode", ["normal_headers", "padded_header_only"], ids=["normal", "header-only"])
-    def test_large_playlist_body_is_fully_buffered(self, shared_r2h, upstream_mode):
+    def test_large_playlist_body_is_fully_rewritten(self, shared_r2h, upstream_mode):
         """A large M3U body should be fully read after header parsing."""
         segment_count = 4096
         segments = "".join("#EXTINF:10,\nsegment-%04d.ts?token=abcdef0123456789\n" % i for i in range(segment_count))
@@ -988,9 +989,66 @@ class TestM3URewritePlaylistVariants:
                 f"/http/127.0.0.1:{upstream.port}/lookback/segment-{segment_count - 1:04d}.ts?token=abcdef0123456789"
                 in text
             )
-            cl = hdrs.get("content-length")
-            assert cl is not None
-            assert int(cl) == len(body)
+            assert text.endswith("#EXT-X-ENDLIST\n")
+            # Streamed to an HTTP/1.0 client: delimited by closing the connection
+            assert hdrs.get("content-length") is None
+            assert hdrs.get("transfer-encoding") is None
+        finally:
+            upstream.stop()
+
+    def test_large_playlist_is_chunked_for_http11(self, shared_r2h):
+        segment_count = 4096
+        segments = "".join("#EXTINF:10,\nsegment-%04d.ts\n" % i for i in range(segment_count))
+        m3u = "#EXTM3U\n" + segments + "#EXT-X-ENDLIST\n"
+        upstream = _make_m3u_upstream("/lookback/long.m3u8", m3u)
+        try:
+            status, hdrs, text = _m3u_get(shared_r2h, upstream.port, "/lookback/long.m3u8")
+            assert status == 200
+            assert get_header(hdrs, "Transfer-Encoding").lower() == "chunked"
+            lines = text.splitlines()
+            assert len(lines) == 2 * segment_count + 2
+            assert lines[-2].endswith(f"/http/127.0.0.1:{upstream.port}/lookback/segment-{segment_count - 1:04d}.ts")
+            assert lines[-1] == "#EXT-X-ENDLIST"
+        finally:
+            upstream.stop()
+
+    def test_lines_sent_before_body_ends(self, shared_r2h):
+        """Complete lines reach the client while the upstream is still sending."""
+        first = b"#EXTM3U\n#EXTINF:10,\nsegment-0.ts\n#EXTINF:10,\nsegm"
+        second = b"ent-1.ts\n#EXT-X-ENDLIST\n"
+        headers = (
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/vnd.apple.mpegurl\r\n"
+            f"Content-Length: {len(first) + len(second)}\r\n\r\n"
+        ).encode()
+        upstream = _RawHTTPResponseUpstream([headers + first, second], part_delay=2.0)
+        upstream.start()
+        try:
+            sock = socket.create_connection(("127.0.0.1", shared_r2h.port), timeout=_TIMEOUT)
+            try:
+                request = f"GET /http/127.0.0.1:{upstream.port}/live/index.m3u8 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+                sock.sendall(request.encode())
+                sock.settimeout(1.0)
+                data = b""
+                while b"/live/segment-0.ts" not in data:
+                    chunk = sock.recv(4096)
+                    assert chunk, "connection closed before the first lines"
+                    data += chunk
+                assert b"segment-1.ts" not in data
+
+                sock.settimeout(_TIMEOUT)
+                while not data.endswith(b"0\r\n\r\n"):
+                    chunk = sock.recv(4096)
+                    if not chunk:
+                        break
+                    data += chunk
+            finally:
+                sock.close()
+
+            head, _, body = data.partition(b"\r\n\r\n")
+            assert b"Transfer-Encoding: chunked" in head
+            assert body.endswith(b"0\r\n\r\n")
+            assert f"/http/127.0.0.1:{upstream.port}/live/segment-1.ts\n".encode() in body
         finally:
             upstream.stop()
 
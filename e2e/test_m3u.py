@@ -12,6 +12,7 @@ import time
 import pytest
 
 from helpers import (
+    MockHTTPUpstream,
     MockRTSPServer,
     R2HProcess,
     assert_etag_cache_behavior,
@@ -146,6 +147,71 @@ class TestExternalM3UFile:
             os.unlink(m3u_path)
 
 
+# ---------------------------------------------------------------------------
+# External M3U through an HTTP proxy (http_proxy / no_proxy)
+# ---------------------------------------------------------------------------
+
+
+def _wait_for_playlist(port, needle, timeout=5.0):
+    deadline = time.monotonic() + timeout
+    text = ""
+    while time.monotonic() < deadline:
+        status, _, body = http_get("127.0.0.1", port, "/playlist.m3u")
+        text = body.decode(errors="replace")
+        if status == 200 and needle in text:
+            break
+        time.sleep(0.2)
+    return text
+
+
+class TestExternalM3UProxy:
+    """The in-process fetcher honours the proxy variables curl does."""
+
+    _PLAYLIST = b"#EXTM3U\n#EXTINF:-1,Proxied Channel\nrtp://239.10.0.1:5000\n"
+
+    def test_fetch_goes_through_http_proxy(self, r2h_binary):
+        # The proxy answers the absolute-form request target
+        proxy = MockHTTPUpstream(routes={"http://playlist.r2h.test/list.m3u": {"body": self._PLAYLIST}})
+        proxy.start()
+        port = find_free_port()
+        r2h = R2HProcess(
+            r2h_binary,
+            port,
+            extra_args=["-v", "4", "-m", "100", "-M", "http://playlist.r2h.test/list.m3u"],
+            env={"http_proxy": f"http://127.0.0.1:{proxy.port}", "no_proxy": ""},
+        )
+        try:
+            r2h.start()
+            assert "Proxied Channel" in _wait_for_playlist(port, "Proxied Channel")
+            assert proxy.requests_log[0]["path"] == "http://playlist.r2h.test/list.m3u"
+            assert proxy.requests_log[0]["headers"]["Host"] == "playlist.r2h.test"
+        finally:
+            r2h.stop()
+            proxy.stop()
+
+    def test_no_proxy_host_fetched_directly(self, r2h_binary):
+        upstream = MockHTTPUpstream(routes={"/list.m3u": {"body": self._PLAYLIST}})
+        upstream.start()
+        proxy = MockHTTPUpstream(routes={})
+        proxy.start()
+        port = find_free_port()
+        r2h = R2HProcess(
+            r2h_binary,
+            port,
+            extra_args=["-v", "4", "-m", "100", "-M", f"http://127.0.0.1:{upstream.port}/list.m3u"],
+            env={"http_proxy": f"http://127.0.0.1:{proxy.port}", "no_proxy": "localhost,127.0.0.1"},
+        )
+        try:
+            r2h.start()
+            assert "Proxied Channel" in _wait_for_playlist(port, "Proxied Channel")
+            assert len(upstream.requests_log) >= 1
+            assert proxy.requests_log == []
+        finally:
+            r2h.stop()
+            upstream.stop()
+            proxy.stop()
+
+
 # ---------------------------------------------------------------------------
 # URL rewriting
 # ---------------------------------------------------------------------------
@@ -302,6 +368,25 @@ rtp://239.0.0.1:1234
         finally:
             r2h.stop()
 
+    def test_rendered_per_host(self, r2h_binary):
+        """Cached renderings are kept apart per Host and share the ETag."""
+        port = find_free_port()
+        r2h = self._start_with_m3u(r2h_binary, port)
+        try:
+            bodies = {}
+            etags = set()
+            for _ in range(2):
+                for host in ("alpha.example:8080", "beta.example:9090"):
+                    status, headers, body = http_get("127.0.0.1", port, "/playlist.m3u", headers={"Host": host})
+                    assert status == 200
+                    assert int(headers["Content-Length"]) == len(body)
+                    assert f"http://{host}/ETag%20Test" in body.decode()
+                    assert bodies.setdefault(host, body) == body
+                    etags.add(headers["ETag"])
+            assert len(etags) == 1
+        finally:
+            r2h.stop()
+
 
 # ---------------------------------------------------------------------------
 # Duplicate service names
@@ -906,6 +991,81 @@ class TestM3UHTTPExternal:
             r2h.stop()
             upstream.stop()
 
+    def test_external_http_m3u_chunked_and_redirected(self, r2h_binary):
+        """A redirect to a chunked response should be followed and decoded."""
+        from helpers import MockHTTPUpstream
+
+        m3u_content = "#EXTM3U\n#EXTINF:-1,Chunked Channel\nrtp://239.10.0.2:5000\n"
+        upstream = MockHTTPUpstream(
+            routes={
+                "/old.m3u": {"status": 302, "headers": {"Location": "/new.m3u"}},
+                "/new.m3u": {"status": 200, "body": m3u_content, "chunked": True},
+            }
+        )
+        upstream.start()
+
+        port = find_free_port()
+        r2h = R2HProcess(
+            r2h_binary,
+            port,
+            extra_args=["-v", "4", "-m", "100", "-M", "http://127.0.0.1:%d/old.m3u" % upstream.port],
+        )
+        try:
+            r2h.start()
+            time.sleep(0.5)
+            status, _, body = http_get("127.0.0.1", port, "/playlist.m3u")
+            assert status == 200
+            assert "Chunked Channel" in body.decode()
+        finally:
+            r2h.stop()
+            upstream.stop()
+
+    def test_unchanged_http_m3u_is_revalidated(self, r2h_binary):
+        """Periodic reloads send If-None-Match; a 304 keeps the services."""
+        from helpers import MockHTTPUpstream
+
+        route = {
+            "status": 200,
+            "body": "#EXTM3U\n#EXTINF:-1,Version One\nrtp://239.10.0.3:5000\n",
+            "etag": '"v1"',
+        }
+        upstream = MockHTTPUpstream(routes={"/list.m3u": route})
+        upstream.start()
+
+        port = find_free_port()
+        r2h = R2HProcess(
+            r2h_binary,
+            port,
+            extra_args=["-v", "4", "-m", "100", "-I", "1", "-M", "http://127.0.0.1:%d/list.m3u" % upstream.port],
+        )
+        try:
+            r2h.start()
+            time.sleep(2.5)
+            fetches = [r for r in upstream.requests_log if r["path"] == "/list.m3u"]
+            assert len(fetches) >= 2
+            assert "If-None-Match" not in fetches[0]["headers"]
+            assert all(r["headers"].get("If-None-Match") == '"v1"' for r in fetches[1:])
+
+            status, _, body = http_get("127.0.0.1", port, "/playlist.m3u")
+            assert status == 200
+            assert "Version One" in body.decode()
+
+            # A changed playlist is downloaded and parsed again
+            route["body"] = "#EXTM3U\n#EXTINF:-1,Version Two\nrtp://239.10.0.3:5000\n"
+            route["etag"] = '"v2"'
+            deadline = time.monotonic() + 5.0
+            text = ""
+            while time.monotonic() < deadline:
+                _, _, body = http_get("127.0.0.1", port, "/playlist.m3u")
+                text = body.decode()
+                if "Version Two" in text:
+                    break
+                time.sleep(0.3)
+            assert "Version Two" in text
+        finally:
+            r2h.stop()
+            upstream.stop()
+
 
 # ---------------------------------------------------------------------------
 # Multiple sources per channel with $label suffix in M3U
@@ -1056,6 +1216,9 @@ class TestM3UQueryMerge:
                 assert status == 500, status
                 # Pin the failure to the merge-overflow path — distinguishes it
                 # from any unrelated 500 (e.g. RTSP teardown).
+                deadline = time.monotonic() + 2.0
+                while "Merged RTSP URL too long" not in r2h.read_log() and time.monotonic() < deadline:
+                    time.sleep(0.05)
                 assert "Merged RTSP URL too long" in r2h.read_log()
             finally:
                 r2h.stop()
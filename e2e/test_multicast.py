@@ -8,7 +8,10 @@ The mock sender uses 7 TS packets per RTP datagram at ~200 pps,
 producing roughly 2 Mbps of payload (similar to real IPTV streams).
 """
 
+import json
+import socket
 import struct
+import time
 
 import pytest
 
@@ -19,6 +22,7 @@ from helpers import (
     R2HProcess,
     find_free_port,
     find_free_udp_port,
+    http_get,
     stream_get,
 )
 
@@ -398,3 +402,122 @@ class TestRTPReorder:
             _assert_markers_ordered(markers)
         finally:
             sender.stop()
+
+
+# ---------------------------------------------------------------------------
+# Status stream deltas
+# ---------------------------------------------------------------------------
+
+
+def _read_sse_until(sock: socket.socket, buffered: bytes, predicate, timeout: float = 8.0) -> tuple[dict, bytes]:
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        lines = buffered.split(b"\n")
+        buffered = lines.pop()
+        for line in lines:
+            if line.startswith(b"data: {"):
+                payload = json.loads(line[len(b"data: ") :])
+                if predicate(payload):
+                    return payload, buffered
+        sock.settimeout(min(1.0, max(0.1, deadline - time.monotonic())))
+        try:
+            chunk = sock.recv(65536)
+        except TimeoutError:
+            continue
+        if not chunk:
+            break
+        buffered += chunk
+    raise AssertionError("Expected SSE payload was not received")
+
+
+def _client_changes(payload: dict, op: str, path: str | None = None) -> list[dict]:
+    if payload.get("type") != "delta":
+        return []
+    return [
+        change
+        for change in payload["clientChanges"]
+        if change["op"] == op and (path is None or path in change.get("serviceUrl", ""))
+    ]
+
+
+class TestStatusStreamDeltas:
+    """After the first snapshot the status stream only reports client changes."""
+
+    def test_stream_add_update_remove(self, multicast_r2h):
+        mcast_port = find_free_udp_port()
+        path = f"/rtp/{MCAST_ADDR}:{mcast_port}"
+        sender = MulticastSender(addr=MCAST_ADDR, port=mcast_port, pps=200)
+        sender.start()
+        sse = socket.create_connection(("127.0.0.1", multicast_r2h.port), timeout=3)
+        stream = None
+        try:
+            sse.sendall(b"GET /status/sse HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n")
+            first, buffered = _read_sse_until(sse, b"", lambda p: True)
+            assert first["type"] == "full"
+            assert all(path not in c["serviceUrl"] for c in first["clients"])
+
+            stream = socket.create_connection(("127.0.0.1", multicast_r2h.port), timeout=3)
+            stream.sendall(f"GET {path} HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n".encode())
+
+            added, buffered = _read_sse_until(sse, buffered, lambda p: _client_changes(p, "add", path))
+            entry = _client_changes(added, "add", path)[0]
+            client_id = entry["clientId"]
+            assert entry["clientAddr"] and "durationMs" in entry
+
+            updated, buffered = _read_sse_until(
+                sse,
+                buffered,
+                lambda p: any(c["clientId"] == client_id and "bytesSent" in c for c in _client_changes(p, "update")),
+            )
+            change = next(c for c in _client_changes(updated, "update") if c["clientId"] == client_id)
+            assert "serviceUrl" not in change and "clientAddr" not in change
+
+            stream.close()
+            stream = None
+            _read_sse_until(
+                sse, buffered, lambda p: any(c["clientId"] == client_id for c in _client_changes(p, "remove"))
+            )
+        finally:
+            if stream is not None:
+                stream.close()
+            sse.close()
+            sender.stop()
+
+
+class TestMetricsClients:
+    """A multicast client should be counted under service_type="rtp" on /metrics."""
+
+    def test_streaming_client_in_metrics(self, multicast_r2h):
+        mcast_port = find_free_udp_port()
+        sender = MulticastSender(addr=MCAST_ADDR, port=mcast_port, pps=200)
+        sender.start()
+        stream = socket.create_connection(("127.0.0.1", multicast_r2h.port), timeout=3)
+        try:
+            stream.sendall(f"GET /rtp/{MCAST_ADDR}:{mcast_port} HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n".encode())
+            stream.settimeout(_MCAST_STREAM_TIMEOUT)
+            assert stream.recv(4096)
+
+            deadline = time.monotonic() + 5.0
+            clients = 0
+            while time.monotonic() < deadline:
+                status, _, body = http_get("127.0.0.1", multicast_r2h.port, "/metrics")
+                assert status == 200
+                text = body.decode()
+                clients = sum(
+                    int(line.rpartition(" ")[2])
+                    for line in text.splitlines()
+                    if line.startswith("rtp2httpd_clients{") and 'service_type="rtp"' in line
+                )
+                if clients >= 1:
+                    break
+                time.sleep(0.2)
+            assert clients >= 1
+            counts = [
+                int(line.rpartition(" ")[2])
+                for line in text.splitlines()
+                if line.startswith("rtp2httpd_client_queue_bytes_count{") and 'service_type="rtp"' in line
+            ]
+            assert sum(counts) == clients
+        finally:
+            stream.close()
+            sender.stop()
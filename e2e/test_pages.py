@@ -4,9 +4,11 @@ playlist endpoint.
 """
 
 import gzip
+import http.client
 import json
 import os
 import signal
+import socket
 import struct
 import time
 from urllib.parse import quote
@@ -320,6 +322,193 @@ class TestStatusSSE:
             assert "event-stream" in ct or "text/" in ct
 
 
+# ---------------------------------------------------------------------------
+# Metrics
+# ---------------------------------------------------------------------------
+
+
+class TestMetrics:
+    """/metrics should expose the statistics in Prometheus / OpenMetrics format."""
+
+    def test_prometheus_text_format(self, basic_r2h):
+        status, hdrs, body = http_get("127.0.0.1", basic_r2h.port, "/metrics")
+        assert status == 200
+        assert get_header(hdrs, "Content-Type").startswith("text/plain; version=0.0.4")
+        text = body.decode()
+        assert "# TYPE rtp2httpd_send_calls_total counter" in text
+        assert 'rtp2httpd_send_calls_total{worker="0"} ' in text
+        assert "# TYPE rtp2httpd_client_queue_bytes histogram" in text
+        assert 'rtp2httpd_clients{worker="0",service_type="rtsp"} 0' in text
+        assert 'rtp2httpd_buffer_pool_buffers{worker="0",pool="control"} ' in text
+        assert "# EOF" not in text
+
+    def test_openmetrics_format(self, basic_r2h):
+        status, hdrs, body = http_get(
+            "127.0.0.1",
+            basic_r2h.port,
+            "/metrics",
+            headers={"Accept": "application/openmetrics-text; version=1.0.0,text/plain;q=0.5"},
+        )
+        assert status == 200
+        assert get_header(hdrs, "Content-Type").startswith("application/openmetrics-text")
+        text = body.decode()
+        assert text.endswith("# EOF\n")
+        assert "# TYPE rtp2httpd_send_calls counter" in text
+        assert "# TYPE rtp2httpd_build info" in text
+        assert "# TYPE rtp2httpd_client_bandwidth_bytes_per_second gaugehistogram" in text
+        assert 'rtp2httpd_client_bandwidth_bytes_per_second_bucket{worker="0",service_type="rtp",le="+Inf"} 0' in text
+        assert 'rtp2httpd_client_bandwidth_bytes_per_second_gcount{worker="0",service_type="rtp"} 0' in text
+        for line in text.splitlines():
+            if line and not line.startswith("#"):
+                name, _, value = line.rpartition(" ")
+                assert name and float(value) >= 0
+
+    def test_head_has_no_body(self, basic_r2h):
+        conn = http.client.HTTPConnection("127.0.0.1", basic_r2h.port, timeout=3)
+        try:
+            conn.request("HEAD", "/metrics")
+            resp = conn.getresponse()
+            assert resp.status == 200
+            assert int(resp.getheader("Content-Length")) > 0
+            resp.read()
+            conn.request("GET", "/metrics")
+            resp = conn.getresponse()
+            assert resp.status == 200
+            assert b"rtp2httpd_max_clients" in resp.read()
+        finally:
+            conn.close()
+
+
+# ---------------------------------------------------------------------------
+# HTTP keep-alive
+# ---------------------------------------------------------------------------
+
+
+def _read_responses(sock: socket.socket, count: int, timeout: float = 3.0) -> list[tuple[int, dict, bytes]]:
+    """Read *count* Content-Length framed responses from a raw socket."""
+    sock.settimeout(timeout)
+    buf = b""
+    responses = []
+    while len(responses) < count:
+        head_end = buf.find(b"\r\n\r\n")
+        if head_end >= 0:
+            lines = buf[:head_end].decode("latin-1").split("\r\n")
+            hdrs = {}
+            for line in lines[1:]:
+                name, _, value = line.partition(":")
+                hdrs[name.strip().lower()] = value.strip()
+            length = int(hdrs.get("content-length", "0"))
+            if len(buf) >= head_end + 4 + length:
+                responses.append((int(lines[0].split()[1]), hdrs, buf[head_end + 4 : head_end + 4 + length]))
+                buf = buf[head_end + 4 + length :]
+                continue
+        chunk = sock.recv(65536)
+        if not chunk:
+            break
+        buf += chunk
+    return responses
+
+
+# ---------------------------------------------------------------------------
+# Logging
+# ---------------------------------------------------------------------------
+
+
+class TestLogRateLimit:
+    """Worker log lines reach the console through the supervisor, with bursts collapsed."""
+
+    def test_repeated_messages_are_suppressed(self, r2h_binary):
+        port = find_free_port()
+        r2h = R2HProcess(r2h_binary, port, extra_args=["-v", "3", "-m", "100"], capture_log=True)
+        r2h.start()
+        try:
+            for _ in range(40):
+                status, _, _ = http_get("127.0.0.1", port, "/status", timeout=3.0)
+                assert status == 200
+            time.sleep(1.2)
+            http_get("127.0.0.1", port, "/status", timeout=3.0)
+
+            deadline = time.monotonic() + 3.0
+            log = r2h.read_log()
+            while "similar messages suppressed" not in log and time.monotonic() < deadline:
+                time.sleep(0.1)
+                log = r2h.read_log()
+            assert "similar messages suppressed" in log, log
+
+            lines = [line for line in log.splitlines() if "requested URL: /status" in line]
+            assert 20 <= len(lines) < 41
+        finally:
+            r2h.stop()
+
+
+class TestHttpKeepAlive:
+    """Non-streaming responses should keep HTTP/1.1 connections open."""
+
+    def test_requests_reuse_connection(self, basic_r2h):
+        conn = http.client.HTTPConnection("127.0.0.1", basic_r2h.port, timeout=3)
+        try:
+            conn.request("GET", "/status", headers={"Accept-Encoding": "identity"})
+            resp = conn.getresponse()
+            resp.read()
+            assert resp.status == 200
+            assert resp.getheader("Connection") == "keep-alive"
+            assert "timeout=15" in resp.getheader("Keep-Alive", "")
+            sock = conn.sock
+
+            conn.request("GET", "/no-such-page")
+            resp = conn.getresponse()
+            resp.read()
+            assert resp.status == 404
+            assert conn.sock is sock
+        finally:
+            conn.close()
+
+    def test_pipelined_requests_answered_in_order(self, basic_r2h):
+        with socket.create_connection(("127.0.0.1", basic_r2h.port), timeout=3) as sock:
+            sock.sendall(
+                b"GET /status HTTP/1.1\r\nHost: x\r\nAccept-Encoding: identity\r\n\r\n"
+                b"GET /no-such-page HTTP/1.1\r\nHost: x\r\n\r\n"
+                b"GET /status.webmanifest HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n"
+            )
+            responses = _read_responses(sock, 3)
+            assert [r[0] for r in responses] == [200, 404, 200]
+            assert responses[1][1]["connection"] == "keep-alive"
+            assert responses[2][1]["connection"] == "close"
+            assert _parse_manifest(responses[2][2])["start_url"]
+            assert sock.recv(1) == b""
+
+    def test_http10_closes(self, basic_r2h):
+        with socket.create_connection(("127.0.0.1", basic_r2h.port), timeout=3) as sock:
+            sock.sendall(b"GET /no-such-page HTTP/1.0\r\n\r\n")
+            responses = _read_responses(sock, 1)
+            assert responses[0][1]["connection"] == "close"
+            assert sock.recv(1) == b""
+
+    def test_request_limit_and_idle_timeout(self, r2h_binary):
+        port = find_free_port()
+        r2h = R2HProcess(
+            r2h_binary,
+            port,
+            extra_args=["-v", "4", "--http-keepalive-timeout", "1", "--http-keepalive-requests", "2"],
+        )
+        r2h.start()
+        try:
+            with socket.create_connection(("127.0.0.1", port), timeout=3) as sock:
+                sock.sendall(b"GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\n\r\nGET /c HTTP/1.1\r\n\r\n")
+                responses = _read_responses(sock, 3)
+                assert [r[1]["connection"] for r in responses] == ["keep-alive", "close"]
+                assert "max=1" in responses[0][1]["keep-alive"]
+
+            with socket.create_connection(("127.0.0.1", port), timeout=5) as sock:
+                sock.sendall(b"GET /a HTTP/1.1\r\n\r\n")
+                assert len(_read_responses(sock, 1)) == 1
+                started = time.monotonic()
+                assert sock.recv(1) == b""
+                assert time.monotonic() - started < 4
+        finally:
+            r2h.stop()
+
+
 # ---------------------------------------------------------------------------
 # app-path-prefix
 # ---------------------------------------------------------------------------
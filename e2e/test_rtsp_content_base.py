@@ -19,9 +19,11 @@ pytestmark = pytest.mark.rtsp
 _STREAM_TIMEOUT = 20.0
 
 
-@pytest.fixture(scope="module")
+@pytest.fixture
 def shared_r2h(r2h_binary):
-    """A single rtp2httpd instance shared by all Content-Base tests."""
+    """A fresh rtp2httpd per test: mock servers reuse ephemeral ports, and a
+    DESCRIBE result cached for fast start by an earlier test with the same
+    URL would otherwise decide the SETUP URL being checked."""
     port = find_free_port()
     r2h = R2HProcess(r2h_binary, port, extra_args=["-v", "4", "-m", "100"])
     r2h.start()
@@ -0,0 +1,240 @@
+"""
+E2E tests for RTCP on RTSP sessions.
+
+rtp2httpd accounts for every RTP packet it receives (RFC 3550 sequence
+and jitter tracking), reads sender reports from the server and sends
+receiver reports back: as interleaved frames on the RTCP channel in TCP
+mode, to the server's RTCP port in UDP mode.  Loss also shows up on
+/metrics.
+"""
+
+import select
+import socket
+import struct
+import threading
+import time
+
+import pytest
+
+from helpers import (
+    MockRTSPServer,
+    MockRTSPServerUDP,
+    R2HProcess,
+    find_free_port,
+    http_get,
+    make_rtp_packet,
+)
+
+pytestmark = pytest.mark.rtsp
+
+_STREAM_TIMEOUT = 20.0
+_SSRC = 0x12345678
+_SKIPPED_SEQ = 5
+
+# NTP timestamp of the sender report the mock servers send first; the
+# receiver report echoes its middle 32 bits as LSR
+_SR_NTP_MSW = 0x11112222
+_SR_NTP_LSW = 0x33334444
+_SR_LSR = 0x22223333
+
+
+def _sender_report() -> bytes:
+    return struct.pack("!BBHIIIIII", 0x80, 200, 6, _SSRC, _SR_NTP_MSW, _SR_NTP_LSW, 0, 0, 0)
+
+
+def _parse_receiver_report(data: bytes) -> dict | None:
+    """Fields of the first report block of a compound RR, None if there is none."""
+    while len(data) >= 4:
+        length = (struct.unpack("!H", data[2:4])[0] + 1) * 4
+        if data[1] == 201 and data[0] & 0x1F >= 1 and length >= 32:
+            ssrc, lost_word, highest, jitter, lsr, dlsr = struct.unpack("!IIIIII", data[8:32])
+            lost = lost_word & 0xFFFFFF
+            return {
+                "ssrc": ssrc,
+                "lost": lost - 0x1000000 if lost & 0x800000 else lost,
+                "highest": highest,
+                "jitter": jitter,
+                "lsr": lsr,
+                "dlsr": dlsr,
+                "compound": data,
+            }
+        data = data[length:]
+    return None
+
+
+class _MockRTSPServerRTCP(MockRTSPServer):
+    """Sends a sender report, then RTP with one sequence number missing, and
+    collects the interleaved frames rtp2httpd sends on the RTCP channel."""
+
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.reports: list[dict] = []
+        self.report_seen = threading.Event()
+
+    def _after_play(self, conn: socket.socket, addr: tuple) -> None:
+        sr = _sender_report()
+        pending = b""
+        deadline = time.monotonic() + 10.0
+        seq = 0
+        try:
+            conn.sendall(b"\x24" + struct.pack("!BH", 1, len(sr)) + sr)
+            while not self._stop.is_set() and time.monotonic() < deadline:
+                if seq != _SKIPPED_SEQ:
+                    rtp = make_rtp_packet(seq, seq * 3600, ssrc=_SSRC)
+                    conn.sendall(b"\x24" + struct.pack("!BH", 0, len(rtp)) + rtp)
+                seq += 1
+                readable, _, _ = select.select([conn], [], [], 0.01)
+                if not readable:
+                    continue
+                chunk = conn.recv(4096)
+                if not chunk:
+                    break
+                pending += chunk
+                while True:
+                    start = pending.find(b"\x24")
+                    if start < 0 or len(pending) < start + 4:
+                        break
+                    channel, length = struct.unpack("!BH", pending[start + 1 : start + 4])
+                    if len(pending) < start + 4 + length:
+                        break
+                    if channel == 1:
+                        report = _parse_receiver_report(pending[start + 4 : start + 4 + length])
+                        if report:
+                            self.reports.append(report)
+                            self.report_seen.set()
+                    pending = pending[start + 4 + length :]
+        except OSError:
+            pass
+
+
+class _MockRTSPServerUDPRTCP(MockRTSPServerUDP):
+    """UDP variant: listens on the advertised server RTCP port."""
+
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.reports: list[dict] = []
+        self.report_seen = threading.Event()
+        self._rtcp_sock: socket.socket | None = None
+
+    def _setup_response(self, cseq: str, transport_hdr: str) -> str:
+        response = super()._setup_response(cseq, transport_hdr)
+        self._rtcp_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self._rtcp_sock.bind(("127.0.0.1", self._server_rtcp_port))
+        return response
+
+    def _after_play(self, conn: socket.socket, addr: tuple) -> None:
+        udp_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        deadline = time.monotonic() + 10.0
+        seq = 0
+        try:
+            while not self._stop.is_set() and time.monotonic() < deadline:
+                if seq != _SKIPPED_SEQ:
+                    rtp = make_rtp_packet(seq, seq * 3600, ssrc=_SSRC)
+                    udp_sock.sendto(rtp, (addr[0], self._client_rtp_port))
+                seq += 1
+                readable, _, _ = select.select([self._rtcp_sock], [], [], 0.01)
+                if readable:
+                    report = _parse_receiver_report(self._rtcp_sock.recv(2048))
+                    if report:
+                        self.reports.append(report)
+                        self.report_seen.set()
+        except OSError:
+            pass
+        finally:
+            udp_sock.close()
+            if self._rtcp_sock:
+                self._rtcp_sock.close()
+
+
+@pytest.fixture(scope="module")
+def rtcp_r2h(r2h_binary):
+    port = find_free_port()
+    r2h = R2HProcess(r2h_binary, port, extra_args=["-v", "4", "-m", "100"])
+    r2h.start()
+    yield r2h
+    r2h.stop()
+
+
+def _start_stream(r2h_port: int, rtsp_port: int) -> socket.socket:
+    sock = socket.create_connection(("127.0.0.1", r2h_port), timeout=_STREAM_TIMEOUT)
+    sock.sendall(("GET /rtsp/127.0.0.1:%d/stream HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n" % rtsp_port).encode())
+    return sock
+
+
+def _drain(sock: socket.socket, seconds: float) -> None:
+    """Keep reading the stream so rtp2httpd never backs off."""
+    deadline = time.monotonic() + seconds
+    sock.settimeout(0.2)
+    while time.monotonic() < deadline:
+        try:
+            if not sock.recv(65536):
+                return
+        except socket.timeout:
+            pass
+
+
+class TestRTCPReceiverReports:
+    def test_tcp_interleaved_receiver_report(self, rtcp_r2h):
+        """A report goes out on the RTCP channel soon after media starts."""
+        rtsp = _MockRTSPServerRTCP()
+        rtsp.start()
+        stream = _start_stream(rtcp_r2h.port, rtsp.port)
+        try:
+            # The first report follows media by half the 5 s interval
+            deadline = time.monotonic() + 8.0
+            while not rtsp.report_seen.is_set() and time.monotonic() < deadline:
+                _drain(stream, 0.2)
+            assert rtsp.reports, "No RTCP receiver report on the interleaved RTCP channel"
+            report = rtsp.reports[0]
+            assert report["ssrc"] == _SSRC
+            assert report["lost"] == 1
+            assert report["highest"] > _SKIPPED_SEQ
+            assert report["lsr"] == _SR_LSR
+            assert b"rtp2httpd" in report["compound"], "Expected an SDES CNAME chunk"
+        finally:
+            stream.close()
+            rtsp.stop()
+
+    def test_udp_receiver_report(self, rtcp_r2h):
+        """In UDP mode reports are sent to the server's RTCP port."""
+        rtsp = _MockRTSPServerUDPRTCP()
+        rtsp.start()
+        stream = _start_stream(rtcp_r2h.port, rtsp.port)
+        try:
+            # The first report follows media by half the 5 s interval
+            deadline = time.monotonic() + 8.0
+            while not rtsp.report_seen.is_set() and time.monotonic() < deadline:
+                _drain(stream, 0.2)
+            assert rtsp.reports, "No RTCP receiver report on the server RTCP port"
+            report = rtsp.reports[0]
+            assert report["ssrc"] == _SSRC
+            assert report["lost"] == 1
+        finally:
+            stream.close()
+            rtsp.stop()
+
+    def test_loss_on_metrics(self, rtcp_r2h):
+        rtsp = _MockRTSPServerRTCP()
+        rtsp.start()
+        stream = _start_stream(rtcp_r2h.port, rtsp.port)
+        try:
+            deadline = time.monotonic() + 5.0
+            lost = expected = 0
+            while time.monotonic() < deadline:
+                _drain(stream, 0.3)
+                status, _, body = http_get("127.0.0.1", rtcp_r2h.port, "/metrics")
+                assert status == 200
+                values = {}
+                for line in body.decode().splitlines():
+                    if 'service_type="rtsp"' in line:
+                        name = line.split("{", 1)[0]
+                        values[name] = values.get(name, 0) + int(line.rpartition(" ")[2])
+                lost = values.get("rtp2httpd_client_rtp_lost_packets", 0)
+                expected = values.get("rtp2httpd_client_rtp_expected_packets", 0)
+                if lost and expected:
+                    break
+            assert lost == 1
+            assert expected > _SKIPPED_SEQ
+        finally:
+            stream.close()
+            rtsp.stop()
@@ -5,6 +5,10 @@ Tests verify basic connectivity, TS payload correctness, and the RTSP
 handshake sequence for both transport modes.
 """
 
+import socket
+import struct
+import time
+
 import pytest
 
 from helpers import (
@@ -12,6 +16,7 @@ from helpers import (
     MockRTSPServerUDP,
     R2HProcess,
     find_free_port,
+    make_rtp_packet,
     stream_get,
 )
 
@@ -20,6 +25,97 @@ pytestmark = pytest.mark.rtsp
 _STREAM_TIMEOUT = 20.0
 
 
+def _numbered_ts_packet(index: int) -> bytes:
+    """A 188-byte TS packet whose body identifies its position in the stream."""
+    return b"\x47\x1f\xff\x10" + struct.pack("!I", index) * 46
+
+
+class _MockRTSPServerBurst(MockRTSPServer):
+    """Writes every interleaved frame in a single send, with a server
+    OPTIONS request in the middle, so rtp2httpd sees many frames per recv."""
+
+    def _after_play(self, conn: socket.socket, addr: tuple) -> None:
+        frames = []
+        for seq in range(self._num_packets):
+            if seq == self._num_packets // 2:
+                frames.append(b"OPTIONS rtsp://127.0.0.1/stream RTSP/1.0\r\nCSeq: 99\r\n\r\n")
+            rtp = make_rtp_packet(seq, seq * 3600, payload=_numbered_ts_packet(seq))
+            frames.append(b"\x24" + struct.pack("!BH", 0, len(rtp)) + rtp)
+        try:
+            conn.sendall(b"".join(frames))
+            # Stay connected long enough for the PLAY response to be consumed
+            self._stop.wait(1.0)
+        except OSError:
+            pass
+
+
+class _MockRTSPServerUDPBurst(MockRTSPServerUDP):
+    """Sends every RTP datagram back to back, so several are queued on
+    rtp2httpd's socket by the time it reads."""
+
+    def _after_play(self, conn: socket.socket, addr: tuple) -> None:
+        udp_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            # Give the PLAY response a head start
+            time.sleep(0.2)
+            for seq in range(self._num_packets):
+                rtp = make_rtp_packet(seq, seq * 3600, payload=_numbered_ts_packet(seq))
+                udp_sock.sendto(rtp, (addr[0], self._client_rtp_port))
+        except OSError:
+            pass
+        finally:
+            udp_sock.close()
+
+
+def _open_stream(port: int, path: str, min_body: int = 4096, timeout: float = _STREAM_TIMEOUT):
+    """Start a streaming GET and read until *min_body* body bytes arrived.
+
+    Returns ``(sock, status_line, body)``; the caller closes the socket.
+    """
+    sock = socket.create_connection(("127.0.0.1", port), timeout=timeout)
+    sock.sendall(("GET %s HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n" % path).encode())
+    data = b""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        head, sep, body = data.partition(b"\r\n\r\n")
+        if sep and len(body) >= min_body:
+            return sock, head.split(b"\r\n")[0].decode(), body
+        chunk = sock.recv(65536)
+        if not chunk:
+            break
+        data += chunk
+    head, _, body = data.partition(b"\r\n\r\n")
+    return sock, head.split(b"\r\n")[0].decode(), body
+
+
+def _read_body(sock: socket.socket, nbytes: int, timeout: float = _STREAM_TIMEOUT) -> bytes:
+    """Read up to *nbytes* more from an open stream."""
+    data = b""
+    deadline = time.monotonic() + timeout
+    while len(data) < nbytes and time.monotonic() < deadline:
+        try:
+            chunk = sock.recv(65536)
+        except socket.timeout:
+            break
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+
+class _MockRTSPServerForgetful(MockRTSPServer):
+    """Rejects the next SETUP with 454 once ``forget`` is set, like a server
+    that no longer knows the stream a cached SETUP URL points to."""
+
+    forget = False
+
+    def _setup_response(self, cseq: str, transport_hdr: str) -> str:
+        if self.forget:
+            self.forget = False
+            return "RTSP/1.0 454 Session Not Found\r\nCSeq: %s\r\n\r\n" % cseq
+        return super()._setup_response(cseq, transport_hdr)
+
+
 @pytest.fixture(scope="module")
 def shared_r2h(r2h_binary):
     """A single rtp2httpd instance shared by all transport tests."""
@@ -116,6 +212,137 @@ class TestRTSPTCPStream:
         finally:
             rtsp.stop()
 
+    def test_tcp_burst_relayed_in_order(self, shared_r2h):
+        """Frames arriving back to back in one recv are all relayed, in order."""
+        num_packets = 300
+        rtsp = _MockRTSPServerBurst(num_packets=num_packets)
+        rtsp.start()
+        try:
+            expected = b"".join(_numbered_ts_packet(i) for i in range(num_packets))
+            status, _, body = stream_get(
+                "127.0.0.1",
+                shared_r2h.port,
+                "/rtsp/127.0.0.1:%d/stream" % rtsp.port,
+                read_bytes=len(expected),
+                timeout=_STREAM_TIMEOUT,
+            )
+            assert status == 200
+            assert body[: len(expected)] == expected
+        finally:
+            rtsp.stop()
+
+
+# ===================================================================
+# Shared upstream sessions
+# ===================================================================
+
+
+class TestRTSPSharedSession:
+    """Live clients of the same URL share one upstream session per worker."""
+
+    def test_second_client_joins_running_session(self, shared_r2h):
+        rtsp = MockRTSPServer(num_packets=5000)
+        rtsp.start()
+        path = "/rtsp/127.0.0.1:%d/shared" % rtsp.port
+        first = second = None
+        try:
+            first, status, body = _open_stream(shared_r2h.port, path)
+            assert " 200 " in status and len(body) >= 4096
+            second, status, body = _open_stream(shared_r2h.port, path)
+            assert " 200 " in status, "Joining client should be served"
+            assert len(body) >= 4096 and body[0] == 0x47
+            assert rtsp.requests_received.count("PLAY") == 1, "Upstream should be played once"
+        finally:
+            for sock in (first, second):
+                if sock:
+                    sock.close()
+            rtsp.stop()
+
+    def test_session_survives_leader_leaving(self, shared_r2h):
+        rtsp = MockRTSPServer(num_packets=5000)
+        rtsp.start()
+        path = "/rtsp/127.0.0.1:%d/handover" % rtsp.port
+        second = None
+        try:
+            first, status, _ = _open_stream(shared_r2h.port, path)
+            assert " 200 " in status
+            second, status, _ = _open_stream(shared_r2h.port, path)
+            assert " 200 " in status
+            first.close()
+            time.sleep(0.3)
+
+            more = _read_body(second, 65536)
+            assert len(more) >= 65536, "Remaining client should keep streaming"
+            assert rtsp.requests_received.count("PLAY") == 1
+            assert "TEARDOWN" not in rtsp.requests_received
+        finally:
+            if second:
+                second.close()
+            rtsp.stop()
+
+    def test_linger_keeps_session_for_returning_client(self, r2h_binary):
+        port = find_free_port()
+        r2h = R2HProcess(r2h_binary, port, extra_args=["-v", "4", "--rtsp-share-linger", "5"])
+        r2h.start()
+        rtsp = MockRTSPServer(num_packets=5000)
+        rtsp.start()
+        path = "/rtsp/127.0.0.1:%d/linger" % rtsp.port
+        try:
+            first, status, _ = _open_stream(port, path)
+            assert " 200 " in status
+            first.close()
+            time.sleep(0.5)
+
+            second, status, body = _open_stream(port, path)
+            second.close()
+            assert " 200 " in status and body[0] == 0x47
+            assert rtsp.requests_received.count("PLAY") == 1, "Returning client should reuse the parked session"
+            assert "TEARDOWN" not in rtsp.requests_received
+        finally:
+            rtsp.stop()
+            r2h.stop()
+
+
+class TestRTSPFastStart:
+    """A repeated request for a URL skips OPTIONS and DESCRIBE."""
+
+    def test_repeat_request_goes_straight_to_setup(self, shared_r2h):
+        rtsp = MockRTSPServer(num_packets=200)
+        rtsp.start()
+        path = "/rtsp/127.0.0.1:%d/faststart" % rtsp.port
+        try:
+            status, _, _ = stream_get("127.0.0.1", shared_r2h.port, path, read_bytes=4096, timeout=_STREAM_TIMEOUT)
+            assert status == 200
+            time.sleep(0.5)
+            status, _, body = stream_get("127.0.0.1", shared_r2h.port, path, read_bytes=4096, timeout=_STREAM_TIMEOUT)
+            assert status == 200 and body[0] == 0x47
+
+            methods = rtsp.requests_received
+            assert methods.count("DESCRIBE") == 1, "Second session should reuse the DESCRIBE result"
+            assert methods.count("OPTIONS") == 1
+            assert methods.count("SETUP") == 2 and methods.count("PLAY") == 2
+        finally:
+            rtsp.stop()
+
+    def test_stale_cache_falls_back_to_describe(self, shared_r2h):
+        rtsp = _MockRTSPServerForgetful(num_packets=200)
+        rtsp.start()
+        path = "/rtsp/127.0.0.1:%d/forgotten" % rtsp.port
+        try:
+            status, _, _ = stream_get("127.0.0.1", shared_r2h.port, path, read_bytes=4096, timeout=_STREAM_TIMEOUT)
+            assert status == 200
+            time.sleep(0.5)
+            rtsp.forget = True
+            status, _, body = stream_get("127.0.0.1", shared_r2h.port, path, read_bytes=4096, timeout=_STREAM_TIMEOUT)
+            assert status == 200, "Rejected fast start should fall back to the full handshake"
+            assert body[0] == 0x47
+
+            methods = rtsp.requests_received
+            assert methods.count("DESCRIBE") == 2
+            assert methods.count("SETUP") == 3 and methods.count("PLAY") == 2
+        finally:
+            rtsp.stop()
+
 
 # ===================================================================
 # UDP transport
@@ -176,3 +403,22 @@ class TestRTSPUDPStream:
             assert "PLAY" in methods
         finally:
             rtsp.stop()
+
+    def test_udp_burst_relayed_in_order(self, shared_r2h):
+        """Datagrams queued on the socket are drained in batches, in order."""
+        num_packets = 100
+        rtsp = _MockRTSPServerUDPBurst(num_packets=num_packets)
+        rtsp.start()
+        try:
+            expected = b"".join(_numbered_ts_packet(i) for i in range(num_packets))
+            status, _, body = stream_get(
+                "127.0.0.1",
+                shared_r2h.port,
+                "/rtsp/127.0.0.1:%d/stream" % rtsp.port,
+                read_bytes=len(expected),
+                timeout=_STREAM_TIMEOUT,
+            )
+            assert status == 200
+            assert body[: len(expected)] == expected
+        finally:
+            rtsp.stop()
@@ -0,0 +1,215 @@
+"""
+E2E tests for video snapshots: the prewarmed decoder pool and the
+per-channel snapshot cache.
+
+A stand-in for ffmpeg (a shell script set as ffmpeg-path) reads the
+captured frame from stdin and writes a fixed JPEG-like body, fails, or
+hangs, and records every frame it was handed, so tests can count decoder
+runs.
+"""
+
+import stat
+import threading
+import time
+
+import pytest
+
+from helpers import (
+    LOOPBACK_IF,
+    MCAST_ADDR,
+    MulticastSender,
+    R2HProcess,
+    build_config,
+    find_free_port,
+    find_free_udp_port,
+    get_header,
+    get_status_payload,
+    http_get,
+    make_ts_idr_payload,
+)
+
+pytestmark = pytest.mark.multicast
+
+_FAKE_JPEG = b"\xff\xd8fake-jpeg\xff\xd9"
+
+_SNAPSHOT_TIMEOUT = 15.0
+
+
+def _write_decoder(tmp_path, name, body):
+    """Write an ffmpeg stand-in; every frame it receives adds a line to <name>.runs."""
+    runs = tmp_path / f"{name}.runs"
+    script = tmp_path / f"{name}.sh"
+    script.write_text(f'#!/bin/sh\ncat > /dev/null\necho run >> "{runs}"\n{body}\n')
+    script.chmod(script.stat().st_mode | stat.S_IXUSR)
+    return str(script), runs
+
+
+def _octal(data):
+    """Escape bytes for the shell printf builtin."""
+    return "".join(f"\\{b:03o}" for b in data)
+
+
+def _decoder_runs(runs):
+    return len(runs.read_text().splitlines()) if runs.exists() else 0
+
+
+def _snapshot_stats(r2h):
+    payload = get_status_payload("127.0.0.1", r2h.port) or {}
+    total = {}
+    for worker in payload.get("workers", []):
+        for key, value in worker.get("snapshot", {}).items():
+            total[key] = total.get(key, 0) + value
+    return total
+
+
+class _SnapshotSetup:
+    """rtp2httpd with snapshots served by a given decoder script, plus a
+    multicast channel carrying IDR frames."""
+
+    def __init__(self, r2h_binary, decoder, cache_ttl=0, decoders=1):
+        self.mcast_port = find_free_udp_port()
+        self.sender = MulticastSender(addr=MCAST_ADDR, port=self.mcast_port, pps=100, payload=make_ts_idr_payload())
+        port = find_free_port()
+        config = build_config(
+            port,
+            global_lines=[
+                "video-snapshot = yes",
+                f"snapshot-decoders = {decoders}",
+                f"snapshot-cache-ttl = {cache_ttl}",
+                f"ffmpeg-path = {decoder}",
+                f"upstream-interface = {LOOPBACK_IF}",
+            ],
+        )
+        self.r2h = R2HProcess(r2h_binary, port, config_content=config)
+        self.path = f"/rtp/{MCAST_ADDR}:{self.mcast_port}?snapshot=1"
+
+    def __enter__(self):
+        self.sender.start()
+        self.r2h.start()
+        return self
+
+    def __exit__(self, *exc):
+        self.r2h.stop()
+        self.sender.stop()
+
+    def get(self, headers=None):
+        return http_get("127.0.0.1", self.r2h.port, self.path, timeout=_SNAPSHOT_TIMEOUT, headers=headers)
+
+
+# ---------------------------------------------------------------------------
+# Decoder pool
+# ---------------------------------------------------------------------------
+
+
+class TestSnapshotDecoder:
+    """Frames are converted by prewarmed decoder processes."""
+
+    def test_snapshot_converted_by_decoder(self, r2h_binary, tmp_path):
+        decoder, runs = _write_decoder(tmp_path, "ok", f"printf '{_octal(_FAKE_JPEG)}'")
+        with _SnapshotSetup(r2h_binary, decoder) as setup:
+            status, headers, body = setup.get()
+            assert status == 200
+            assert get_header(headers, "Content-Type") == "image/jpeg"
+            assert body == _FAKE_JPEG
+            assert _decoder_runs(runs) == 1
+
+            stats = _snapshot_stats(setup.r2h)
+            assert stats["jobs"] >= 1
+            assert stats["failures"] == 0
+
+            # The used decoder exits and a fresh one is prewarmed for the next frame
+            deadline = time.monotonic() + 5.0
+            while _snapshot_stats(setup.r2h).get("spawns", 0) < 2 and time.monotonic() < deadline:
+                time.sleep(0.1)
+            assert _snapshot_stats(setup.r2h)["spawns"] >= 2
+
+            status, _, body = setup.get()
+            assert status == 200 and body == _FAKE_JPEG
+            assert _decoder_runs(runs) == 2
+
+    def test_decoder_failure_returns_500(self, r2h_binary, tmp_path):
+        decoder, runs = _write_decoder(tmp_path, "fail", "exit 1")
+        with _SnapshotSetup(r2h_binary, decoder) as setup:
+            status, _, _ = setup.get()
+            assert status == 500
+            assert _decoder_runs(runs) == 1
+            assert _snapshot_stats(setup.r2h)["failures"] >= 1
+
+    @pytest.mark.slow
+    def test_decoder_timeout_returns_500(self, r2h_binary, tmp_path):
+        decoder, runs = _write_decoder(tmp_path, "hang", "exec sleep 30")
+        with _SnapshotSetup(r2h_binary, decoder) as setup:
+            started = time.monotonic()
+            status, _, _ = setup.get()
+            assert status == 500
+            assert time.monotonic() - started >= 4.0
+            assert _decoder_runs(runs) == 1
+            assert _snapshot_stats(setup.r2h)["timeouts"] >= 1
+
+
+# ---------------------------------------------------------------------------
+# Snapshot cache
+# ---------------------------------------------------------------------------
+
+
+class TestSnapshotCache:
+    """A channel's JPEG is reused for snapshot-cache-ttl seconds."""
+
+    def test_cache_hit_skips_decoder(self, r2h_binary, tmp_path):
+        decoder, runs = _write_decoder(tmp_path, "ok", f"printf '{_octal(_FAKE_JPEG)}'")
+        with _SnapshotSetup(r2h_binary, decoder, cache_ttl=60) as setup:
+            status, _, body = setup.get()
+            assert status == 200 and body == _FAKE_JPEG
+
+            status, _, body = setup.get()
+            assert status == 200 and body == _FAKE_JPEG
+            assert _decoder_runs(runs) == 1
+            assert _snapshot_stats(setup.r2h)["cacheHits"] >= 1
+
+    def test_if_none_match_returns_304(self, r2h_binary, tmp_path):
+        decoder, runs = _write_decoder(tmp_path, "ok", f"printf '{_octal(_FAKE_JPEG)}'")
+        with _SnapshotSetup(r2h_binary, decoder, cache_ttl=60) as setup:
+            status, headers, _ = setup.get()
+            assert status == 200
+            etag = get_header(headers, "ETag")
+            assert etag
+
+            status, _, body = setup.get(headers={"If-None-Match": etag})
+            assert status == 304
+            assert body == b""
+
+            status, _, body = setup.get(headers={"If-None-Match": '"other"'})
+            assert status == 200 and body == _FAKE_JPEG
+            assert _decoder_runs(runs) == 1
+
+    def test_entry_expires_after_ttl(self, r2h_binary, tmp_path):
+        decoder, runs = _write_decoder(tmp_path, "ok", f"printf '{_octal(_FAKE_JPEG)}'")
+        with _SnapshotSetup(r2h_binary, decoder, cache_ttl=1) as setup:
+            status, _, _ = setup.get()
+            assert status == 200
+            time.sleep(1.5)
+
+            status, _, body = setup.get()
+            assert status == 200 and body == _FAKE_JPEG
+            assert _decoder_runs(runs) == 2
+
+    def test_concurrent_requests_share_one_decode(self, r2h_binary, tmp_path):
+        # A slow decoder keeps the first capture running while the others arrive
+        decoder, runs = _write_decoder(tmp_path, "slow", f"sleep 1\nprintf '{_octal(_FAKE_JPEG)}'")
+        with _SnapshotSetup(r2h_binary, decoder, cache_ttl=60, decoders=4) as setup:
+            results = []
+
+            def fetch():
+                results.append(setup.get())
+
+            threads = [threading.Thread(target=fetch) for _ in range(4)]
+            for t in threads:
+                t.start()
+                time.sleep(0.05)
+            for t in threads:
+                t.join(timeout=_SNAPSHOT_TIMEOUT)
+
+            assert len(results) == 4
+            assert all(status == 200 and body == _FAKE_JPEG for status, _, body in results)
+            assert _decoder_runs(runs) == 1
+            assert _snapshot_stats(setup.r2h)["coalesced"] >= 1
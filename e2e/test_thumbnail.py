@@ -0,0 +1,130 @@
+"""
+E2E tests for the channel thumbnail mosaic (/thumbnails.jpg, /thumbnails.json).
+
+A stand-in for ffmpeg (a shell script set as ffmpeg-path) both converts the
+captured snapshot and "composes" the mosaic: it discards stdin and writes a
+fixed JPEG-like body to stdout.
+"""
+
+import json
+import os
+import stat
+import time
+
+import pytest
+
+from helpers import (
+    LOOPBACK_IF,
+    MCAST_ADDR,
+    MulticastSender,
+    R2HProcess,
+    build_config,
+    find_free_port,
+    find_free_udp_port,
+    get_header,
+    http_get,
+    make_ts_idr_payload,
+)
+
+pytestmark = pytest.mark.multicast
+
+_FAKE_JPEG = b"\xff\xd8fake-mosaic\xff\xd9"
+
+_MOSAIC_TIMEOUT = 20.0
+
+
+def _write_ffmpeg(tmp_path):
+    script = tmp_path / "ffmpeg.sh"
+    octal = "".join(f"\\{b:03o}" for b in _FAKE_JPEG)
+    script.write_text(f"#!/bin/sh\ncat > /dev/null\nprintf '{octal}'\n")
+    script.chmod(script.stat().st_mode | stat.S_IXUSR)
+    return str(script)
+
+
+@pytest.fixture()
+def thumbnail_r2h(r2h_binary, tmp_path):
+    mcast_port = find_free_udp_port()
+    sender = MulticastSender(addr=MCAST_ADDR, port=mcast_port, pps=100, payload=make_ts_idr_payload())
+    port = find_free_port()
+    config = build_config(
+        port,
+        global_lines=[
+            "video-snapshot = yes",
+            "thumbnail-interval = 60",
+            f"ffmpeg-path = {_write_ffmpeg(tmp_path)}",
+            f"upstream-interface = {LOOPBACK_IF}",
+        ],
+        services_content=f"#EXTM3U\n#EXTINF:-1,Thumb One\nrtp://{MCAST_ADDR}:{mcast_port}\n",
+    )
+    r2h = R2HProcess(r2h_binary, port, config_content=config)
+    sender.start()
+    r2h.start()
+    try:
+        yield r2h
+    finally:
+        r2h.stop()
+        sender.stop()
+
+
+def _wait_for_mosaic(r2h):
+    deadline = time.monotonic() + _MOSAIC_TIMEOUT
+    while time.monotonic() < deadline:
+        status, headers, body = http_get("127.0.0.1", r2h.port, "/thumbnails.jpg", timeout=5)
+        if status == 200:
+            return headers, body
+        time.sleep(0.5)
+    pytest.fail("mosaic was not published")
+
+
+class TestThumbnailMosaic:
+    """Worker 0 captures every channel and publishes a mosaic plus its index."""
+
+    def test_mosaic_and_index_served(self, thumbnail_r2h):
+        headers, body = _wait_for_mosaic(thumbnail_r2h)
+        assert get_header(headers, "Content-Type") == "image/jpeg"
+        assert body == _FAKE_JPEG
+
+        status, headers, body = http_get("127.0.0.1", thumbnail_r2h.port, "/thumbnails.json", timeout=5)
+        assert status == 200
+        assert get_header(headers, "Content-Type") == "application/json"
+        index = json.loads(body)
+        assert index["columns"] == 1 and index["rows"] == 1
+        assert [ch["name"] for ch in index["channels"]] == ["Thumb One"]
+        assert index["channels"][0]["x"] == 0 and index["channels"][0]["y"] == 0
+
+    def test_if_none_match_returns_304(self, thumbnail_r2h):
+        headers, _ = _wait_for_mosaic(thumbnail_r2h)
+        etag = get_header(headers, "ETag")
+        assert etag
+
+        status, _, body = http_get(
+            "127.0.0.1", thumbnail_r2h.port, "/thumbnails.jpg", timeout=5, headers={"If-None-Match": etag}
+        )
+        assert status == 304
+        assert body == b""
+
+    def test_directory_is_private_and_removed_on_exit(self, thumbnail_r2h):
+        _wait_for_mosaic(thumbnail_r2h)
+        directory = f"/tmp/rtp2httpd_thumbnails_{thumbnail_r2h.process.pid}"
+
+        st = os.lstat(directory)
+        assert stat.S_ISDIR(st.st_mode)
+        assert stat.S_IMODE(st.st_mode) == 0o700
+        assert st.st_uid == os.geteuid()
+        # Temporary files are renamed into place or removed, never left behind
+        assert sorted(os.listdir(directory)) == ["thumbnails.jpg", "thumbnails.json"]
+
+        thumbnail_r2h.stop()
+        assert not os.path.exists(directory)
+
+
+class TestThumbnailDisabled:
+    def test_no_mosaic_without_interval(self, r2h_binary):
+        port = find_free_port()
+        r2h = R2HProcess(r2h_binary, port, config_content=build_config(port, global_lines=["video-snapshot = yes"]))
+        r2h.start()
+        try:
+            status, _, _ = http_get("127.0.0.1", port, "/thumbnails.jpg", timeout=5)
+            assert status == 404
+        finally:
+            r2h.stop()
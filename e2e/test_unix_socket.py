@@ -130,7 +130,7 @@ class TestUnixSocketListen:
                 assert status == 200
                 assert "text/html" in content_type
                 assert len(body) > 0
-                assert "New client localhost requested URL: /status" in r2h.read_log()
+                _wait_log_contains(r2h, "New client localhost requested URL: /status")
             finally:
                 r2h.stop()
 
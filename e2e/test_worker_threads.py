@@ -0,0 +1,86 @@
+"""E2E coverage for worker-threads mode (several event loops in one worker process)."""
+
+from __future__ import annotations
+
+import concurrent.futures
+
+import pytest
+
+from helpers import (
+    MockRTSPServer,
+    R2HProcess,
+    build_single_service_config,
+    find_free_port,
+    http_get,
+    stream_get,
+    wait_for_status_payload,
+)
+
+_WORKERS = 3
+_STREAM_TIMEOUT = 10.0
+
+
+@pytest.fixture(scope="module")
+def threaded_r2h(r2h_binary):
+    port = find_free_port()
+    config = build_single_service_config(
+        port,
+        "Threaded",
+        "rtp://239.1.1.1:1234",
+        global_lines=["workers = %d" % _WORKERS, "worker-threads = yes"],
+    )
+    r2h = R2HProcess(r2h_binary, port, config_content=config)
+    r2h.start()
+    yield r2h
+    r2h.stop()
+
+
+def test_all_threads_report_same_worker_process(threaded_r2h):
+    payload = wait_for_status_payload(
+        "127.0.0.1",
+        threaded_r2h.port,
+        lambda p: len([w for w in p.get("workers", []) if w["pid"] > 0]) == _WORKERS,
+    )
+    pids = {worker["pid"] for worker in payload["workers"] if worker["pid"] > 0}
+    assert len(pids) == 1, payload["workers"]
+
+
+def test_shared_playlist_served_by_every_thread(threaded_r2h):
+    def fetch(_):
+        return http_get("127.0.0.1", threaded_r2h.port, "/playlist.m3u")
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as pool:
+        results = list(pool.map(fetch, range(32)))
+
+    bodies = set()
+    for status, _, body in results:
+        assert status == 200
+        bodies.add(body)
+    assert len(bodies) == 1
+    assert b"Threaded" in bodies.pop()
+
+
+def test_concurrent_streams_across_threads(threaded_r2h):
+    servers = [MockRTSPServer(num_packets=300) for _ in range(_WORKERS)]
+    for server in servers:
+        server.start()
+    try:
+
+        def fetch(server):
+            return stream_get(
+                "127.0.0.1",
+                threaded_r2h.port,
+                "/rtsp/127.0.0.1:%d/stream" % server.port,
+                read_bytes=4096,
+                timeout=_STREAM_TIMEOUT,
+            )
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=_WORKERS) as pool:
+            results = list(pool.map(fetch, servers))
+
+        for status, _, body in results:
+            assert status == 200
+            assert len(body) > 0
+    finally:
+        for server in servers:
+            server.stop()
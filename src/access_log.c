@@ -1,16 +1,21 @@
 #include "access_log.h"
 #include "configuration.h"
 #include "connection.h"
+#include "rtp2httpd.h"
 #include "service.h"
 #include "status.h"
+#include "supervisor.h"
 #include "utils.h"
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -18,20 +23,33 @@
 #define O_CLOEXEC 0
 #endif
 
-#define ACCESS_LOG_INITIAL_CAPACITY 512
 #define ACCESS_LOG_MAX_LINE 8192
 
 typedef struct {
   char *data;
   size_t len;
-  size_t cap;
   int truncated;
 } access_log_buffer_t;
 
+/* Single-producer single-consumer byte ring of complete log lines: the
+ * worker (or worker thread) of the same index appends, the supervisor
+ * drains.  head and tail only grow; offsets are taken modulo the size. */
+typedef struct {
+  _Atomic uint64_t head; /* Bytes published by the worker */
+  _Atomic uint64_t tail; /* Bytes consumed by the supervisor */
+  char data[ACCESS_LOG_RING_SIZE];
+} access_log_ring_t;
+
 static int access_log_fd = -1;
 static char *access_log_open_path = NULL;
 static char *access_log_last_failed_path = NULL;
 
+static access_log_ring_t *access_log_rings = NULL;
+static int64_t access_log_last_flush_ms = 0;
+
+/* Lines are rendered here, never on the heap */
+static _Thread_local char access_log_line[ACCESS_LOG_MAX_LINE];
+
 static void access_log_close_fd(void) {
   if (access_log_fd >= 0) {
     close(access_log_fd);
@@ -44,14 +62,42 @@ static void access_log_close_fd(void) {
 }
 
 void access_log_cleanup(void) {
+  if (worker_id == SUPERVISOR_WORKER_ID)
+    access_log_flush(1);
   access_log_close_fd();
   if (access_log_last_failed_path) {
     free(access_log_last_failed_path);
     access_log_last_failed_path = NULL;
   }
+  if (access_log_rings) {
+    munmap(access_log_rings, sizeof(access_log_ring_t) * STATUS_MAX_WORKERS);
+    access_log_rings = NULL;
+  }
 }
 
-void access_log_reopen(void) { access_log_cleanup(); }
+int access_log_init(void) {
+  void *mapped = mmap(NULL, sizeof(access_log_ring_t) * STATUS_MAX_WORKERS, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    logger(LOG_ERROR, "Failed to map access log rings: %s", strerror(errno));
+    return -1;
+  }
+
+  access_log_rings = mapped;
+  for (int i = 0; i < STATUS_MAX_WORKERS; i++) {
+    atomic_init(&access_log_rings[i].head, 0);
+    atomic_init(&access_log_rings[i].tail, 0);
+  }
+  return 0;
+}
+
+void access_log_reopen(void) {
+  access_log_close_fd();
+  if (access_log_last_failed_path) {
+    free(access_log_last_failed_path);
+    access_log_last_failed_path = NULL;
+  }
+}
 
 static int access_log_set_cloexec(int fd) {
 #if O_CLOEXEC == 0 && defined(FD_CLOEXEC)
@@ -107,64 +153,17 @@ static int access_log_ensure_fd(const char *path) {
   return access_log_fd;
 }
 
-static int access_log_buffer_init(access_log_buffer_t *buf) {
-  buf->data = malloc(ACCESS_LOG_INITIAL_CAPACITY);
-  if (!buf->data)
-    return -1;
-  buf->len = 0;
-  buf->cap = ACCESS_LOG_INITIAL_CAPACITY;
-  buf->truncated = 0;
-  buf->data[0] = '\0';
-  return 0;
-}
-
-static void access_log_buffer_free(access_log_buffer_t *buf) {
-  free(buf->data);
-  buf->data = NULL;
-  buf->len = 0;
-  buf->cap = 0;
-}
-
-static int access_log_buffer_reserve(access_log_buffer_t *buf, size_t extra) {
-  if (buf->truncated)
-    return 0;
-
-  if (extra > ACCESS_LOG_MAX_LINE - buf->len - 1) {
-    extra = ACCESS_LOG_MAX_LINE - buf->len - 1;
-    buf->truncated = 1;
-  }
-
-  size_t need = buf->len + extra + 1;
-  if (need <= buf->cap)
-    return 0;
-
-  size_t next_cap = buf->cap;
-  while (next_cap < need && next_cap < ACCESS_LOG_MAX_LINE)
-    next_cap *= 2;
-  if (next_cap > ACCESS_LOG_MAX_LINE)
-    next_cap = ACCESS_LOG_MAX_LINE;
-
-  char *next = realloc(buf->data, next_cap);
-  if (!next)
-    return -1;
-  buf->data = next;
-  buf->cap = next_cap;
-  return 0;
-}
-
 static int access_log_append_mem(access_log_buffer_t *buf, const char *value, size_t len) {
   if (!value || len == 0 || buf->truncated)
     return 0;
 
+  /* Keep room for the newline and the terminator */
   size_t writable = len;
-  if (writable > ACCESS_LOG_MAX_LINE - buf->len - 1) {
-    writable = ACCESS_LOG_MAX_LINE - buf->len - 1;
+  if (writable > ACCESS_LOG_MAX_LINE - buf->len - 2) {
+    writable = ACCESS_LOG_MAX_LINE - buf->len - 2;
     buf->truncated = 1;
   }
 
-  if (access_log_buffer_reserve(buf, writable) < 0)
-    return -1;
-
   memcpy(buf->data + buf->len, value, writable);
   buf->len += writable;
   buf->data[buf->len] = '\0';
@@ -233,17 +232,7 @@ static int access_log_append_escaped(access_log_buffer_t *buf, const char *value
 static const char *access_log_service_type_name(service_t *service) {
   if (!service)
     return "-";
-
-  switch (service->service_type) {
-  case SERVICE_MRTP:
-    return "rtp";
-  case SERVICE_RTSP:
-    return "rtsp";
-  case SERVICE_HTTP:
-    return "http";
-  default:
-    return "-";
-  }
+  return service_type_name(service->service_type);
 }
 
 static const char *access_log_upstream_url(service_t *service) {
@@ -349,7 +338,7 @@ static int access_log_append_placeholder(access_log_buffer_t *buf, const char *n
                                          const char *time_iso8601, const char *time_local, const char *msec,
                                          const char *remote_addr, const char *remote_port, const char *request) {
   char numeric[64];
-  char filtered_user_agent[sizeof(c->http_req.user_agent)];
+  char filtered_user_agent[512];
 
 #define MATCH(name_literal) (name_len == strlen(name_literal) && strncmp(name, name_literal, name_len) == 0)
 
@@ -443,32 +432,34 @@ static int access_log_render(access_log_buffer_t *buf, connection_t *c, service_
     p = end - 1;
   }
 
-  if (access_log_append_char(buf, '\n') < 0)
-    return -1;
+  buf->data[buf->len++] = '\n';
+  buf->data[buf->len] = '\0';
   return 0;
 }
 
-static int access_log_write_line(int fd, const char *data, size_t len) {
-  ssize_t written;
-
-  do {
-    written = write(fd, data, len);
-  } while (written < 0 && errno == EINTR);
+static int access_log_ring_push(access_log_ring_t *ring, const char *data, size_t len) {
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
 
-  if (written < 0)
+  if (len > ACCESS_LOG_RING_SIZE - (size_t)(head - tail))
     return -1;
-  if ((size_t)written != len) {
-    errno = EIO;
-    return -1;
-  }
+
+  size_t offset = (size_t)(head % ACCESS_LOG_RING_SIZE);
+  size_t first = ACCESS_LOG_RING_SIZE - offset;
+  if (first > len)
+    first = len;
+  memcpy(ring->data + offset, data, first);
+  memcpy(ring->data, data + first, len - first);
+
+  atomic_store_explicit(&ring->head, head + len, memory_order_release);
   return 0;
 }
 
 void access_log_write_connection(connection_t *c, service_t *service, int status_index) {
-  if (!c || !service || !config.access_log || config.access_log[0] == '\0' || !status_shared)
+  if (!c || !service || !config.access_log || config.access_log[0] == '\0' || !status_shared || !access_log_rings)
     return;
 
-  if (status_index < 0 || status_index >= STATUS_MAX_CLIENTS)
+  if (status_index < 0 || status_index >= STATUS_MAX_CLIENTS || worker_id < 0 || worker_id >= STATUS_MAX_WORKERS)
     return;
 
   client_stats_t *client = &status_shared->clients[status_index];
@@ -476,29 +467,102 @@ void access_log_write_connection(connection_t *c, service_t *service, int status
     return;
   pid_t owner_pid = (pid_t)atomic_load_explicit(&client->owner_pid, memory_order_relaxed);
 
-  int fd = access_log_ensure_fd(config.access_log);
-  if (fd < 0)
-    return;
-
   const char *format =
       (config.log_format && config.log_format[0] != '\0') ? config.log_format : DEFAULT_ACCESS_LOG_FORMAT;
 
   access_log_buffer_t buf;
-  if (access_log_buffer_init(&buf) < 0) {
-    logger(LOG_ERROR, "Failed to allocate access log buffer");
-    return;
-  }
+  buf.data = access_log_line;
+  buf.len = 0;
+  buf.truncated = 0;
+  buf.data[0] = '\0';
 
   if (access_log_render(&buf, c, service, &client->payload, owner_pid, format) < 0) {
     logger(LOG_ERROR, "Failed to render access log line");
-    access_log_buffer_free(&buf);
     return;
   }
 
-  if (access_log_write_line(fd, buf.data, buf.len) < 0) {
-    logger(LOG_ERROR, "Failed to write access log %s: %s", config.access_log, strerror(errno));
-    access_log_close_fd();
+  /* The supervisor writes the line out; when it falls behind, lines are
+   * dropped rather than stalling this worker */
+  worker_stats_t *ws = &status_shared->worker_stats[worker_id];
+  if (access_log_ring_push(&access_log_rings[worker_id], buf.data, buf.len) < 0) {
+    ws->access_log_dropped++;
+    if (ws->access_log_dropped == 1 || (ws->access_log_dropped % 1000) == 0)
+      logger(LOG_WARN, "Access log ring full, %llu line(s) dropped", (unsigned long long)ws->access_log_dropped);
+    return;
+  }
+  ws->access_log_records++;
+}
+
+void access_log_flush(int force) {
+  struct iovec iov[STATUS_MAX_WORKERS * 2];
+  uint64_t heads[STATUS_MAX_WORKERS];
+  size_t pending = 0;
+  int iovcnt = 0;
+
+  if (!access_log_rings)
+    return;
+
+  for (int i = 0; i < STATUS_MAX_WORKERS; i++) {
+    access_log_ring_t *ring = &access_log_rings[i];
+    heads[i] = atomic_load_explicit(&ring->head, memory_order_acquire);
+    pending += (size_t)(heads[i] - atomic_load_explicit(&ring->tail, memory_order_relaxed));
+  }
+
+  int64_t now_ms = get_time_ms();
+  if (pending == 0) {
+    access_log_last_flush_ms = now_ms;
+    return;
+  }
+  if (!force && pending < ACCESS_LOG_FLUSH_BYTES && now_ms - access_log_last_flush_ms < ACCESS_LOG_FLUSH_INTERVAL_MS)
+    return;
+  access_log_last_flush_ms = now_ms;
+
+  for (int i = 0; i < STATUS_MAX_WORKERS; i++) {
+    access_log_ring_t *ring = &access_log_rings[i];
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t len = (size_t)(heads[i] - tail);
+    if (len == 0)
+      continue;
+
+    size_t offset = (size_t)(tail % ACCESS_LOG_RING_SIZE);
+    size_t first = ACCESS_LOG_RING_SIZE - offset;
+    if (first > len)
+      first = len;
+    iov[iovcnt].iov_base = ring->data + offset;
+    iov[iovcnt++].iov_len = first;
+    if (len > first) {
+      iov[iovcnt].iov_base = ring->data;
+      iov[iovcnt++].iov_len = len - first;
+    }
+  }
+
+  /* Lines left over from a disabled or unwritable log are discarded */
+  int fd = (config.access_log && config.access_log[0] != '\0') ? access_log_ensure_fd(config.access_log) : -1;
+  struct iovec *cur = iov;
+  while (fd >= 0 && iovcnt > 0) {
+    ssize_t written = writev(fd, cur, iovcnt);
+    if (written <= 0) {
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written == 0)
+        errno = EIO;
+      logger(LOG_ERROR, "Failed to write access log %s: %s", config.access_log, strerror(errno));
+      access_log_close_fd();
+      break;
+    }
+
+    /* Short write: skip what went out and retry with the rest */
+    while (iovcnt > 0 && (size_t)written >= cur->iov_len) {
+      written -= (ssize_t)cur->iov_len;
+      cur++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      cur->iov_base = (char *)cur->iov_base + written;
+      cur->iov_len -= (size_t)written;
+    }
   }
 
-  access_log_buffer_free(&buf);
+  for (int i = 0; i < STATUS_MAX_WORKERS; i++)
+    atomic_store_explicit(&access_log_rings[i].tail, heads[i], memory_order_release);
 }
@@ -4,8 +4,41 @@
 typedef struct connection_s connection_t;
 typedef struct service_s service_t;
 
+/* Per-worker ring of rendered lines awaiting the supervisor's writer */
+#define ACCESS_LOG_RING_SIZE (64 * 1024)
+
+/* The supervisor writes pending lines once this many bytes are queued... */
+#define ACCESS_LOG_FLUSH_BYTES (16 * 1024)
+
+/* ...and at least this often while any are queued */
+#define ACCESS_LOG_FLUSH_INTERVAL_MS 1000
+
+/**
+ * Map the per-worker access log rings; called by the supervisor before
+ * workers are forked
+ * @return 0 on success, -1 on error (access logging stays off)
+ */
+int access_log_init(void);
+
+/**
+ * Queue the access log line of a media request (worker side, never blocks)
+ *
+ * The line is rendered into a reused per-thread buffer and appended to this
+ * worker's ring; it is dropped and counted when the ring is full.
+ */
 void access_log_write_connection(connection_t *c, service_t *service, int status_index);
+
+/**
+ * Write the lines queued by every worker with a single writev() (supervisor
+ * side)
+ * @param force 1 to write regardless of the size and time thresholds
+ */
+void access_log_flush(int force);
+
+/* Close the log file so the next flush reopens it (config reload, rotation) */
 void access_log_reopen(void);
+
+/* Flush (supervisor only), close the log file and unmap the rings */
 void access_log_cleanup(void);
 
 #endif /* __ACCESS_LOG_H__ */
@@ -3,6 +3,7 @@
 #include "status.h"
 #include "utils.h"
 #include "zerocopy.h"
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
@@ -15,6 +16,11 @@
     }                                                                                                                  \
   } while (0)
 
+/* Process-wide stack of idle media segments shared by worker threads */
+static _Atomic(buffer_pool_segment_t *) segment_depot = NULL;
+static atomic_int segment_depot_count = 0;
+static int segment_depot_enabled = 0;
+
 static uint64_t buffer_pool_time_us(void) {
   struct timeval tv;
   gettimeofday(&tv, NULL);
@@ -104,6 +110,89 @@ static inline const char *buffer_pool_name(buffer_pool_t *pool) {
   return (pool == &zerocopy_state.pool) ? "Buffer pool" : "Control pool";
 }
 
+static void segment_depot_push_list(buffer_pool_segment_t *first, buffer_pool_segment_t *last) {
+  buffer_pool_segment_t *head = atomic_load_explicit(&segment_depot, memory_order_relaxed);
+  do {
+    last->next = head;
+  } while (!atomic_compare_exchange_weak_explicit(&segment_depot, &head, first, memory_order_release,
+                                                  memory_order_relaxed));
+}
+
+/* Park a fully idle segment in the depot.  Returns 0 if the depot took it. */
+static int segment_depot_put(buffer_pool_segment_t *seg) {
+  if (!segment_depot_enabled)
+    return -1;
+  if (atomic_fetch_add_explicit(&segment_depot_count, 1, memory_order_relaxed) >= BUFFER_POOL_DEPOT_MAX_SEGMENTS) {
+    atomic_fetch_sub_explicit(&segment_depot_count, 1, memory_order_relaxed);
+    return -1;
+  }
+  seg->parent = NULL;
+  segment_depot_push_list(seg, seg);
+  return 0;
+}
+
+/* Take one segment holding at most max_buffers buffers from the depot.
+ * The whole stack is detached with a single exchange so concurrent takers
+ * never dereference a node another thread may be adopting (no ABA). */
+static buffer_pool_segment_t *segment_depot_take(size_t max_buffers) {
+  if (!segment_depot_enabled)
+    return NULL;
+
+  buffer_pool_segment_t *list = atomic_exchange_explicit(&segment_depot, NULL, memory_order_acquire);
+  buffer_pool_segment_t *taken = NULL;
+  buffer_pool_segment_t **link = &list;
+
+  while (*link) {
+    if ((*link)->num_buffers <= max_buffers) {
+      taken = *link;
+      *link = taken->next;
+      break;
+    }
+    link = &(*link)->next;
+  }
+
+  if (list) {
+    buffer_pool_segment_t *last = list;
+    while (last->next)
+      last = last->next;
+    segment_depot_push_list(list, last);
+  }
+
+  if (taken) {
+    atomic_fetch_sub_explicit(&segment_depot_count, 1, memory_order_relaxed);
+    taken->next = NULL;
+  }
+  return taken;
+}
+
+/* Adopt a depot segment into pool: re-parent it and thread its buffers onto the free list */
+static void buffer_pool_adopt_segment(buffer_pool_t *pool, buffer_pool_segment_t *seg) {
+  seg->parent = pool;
+  seg->num_free = seg->num_buffers;
+  seg->create_time_us = buffer_pool_time_us();
+  for (size_t i = 0; i < seg->num_buffers; i++) {
+    buffer_ref_t *ref = &seg->refs[i];
+    ref->refcount = 0;
+    ref->free_next = pool->free_list;
+    pool->free_list = ref;
+  }
+}
+
+void buffer_pool_depot_enable(void) { segment_depot_enabled = 1; }
+
+void buffer_pool_depot_cleanup(void) {
+  buffer_pool_segment_t *seg = atomic_exchange_explicit(&segment_depot, NULL, memory_order_acquire);
+  while (seg) {
+    buffer_pool_segment_t *next = seg->next;
+    free(seg->buffers);
+    free(seg->refs);
+    free(seg);
+    seg = next;
+  }
+  atomic_store_explicit(&segment_depot_count, 0, memory_order_relaxed);
+  segment_depot_enabled = 0;
+}
+
 static int buffer_pool_expand(buffer_pool_t *pool) {
   if (pool->num_buffers >= pool->max_buffers) {
     logger(LOG_DEBUG, "%s: Cannot expand beyond maximum size (%zu buffers)", buffer_pool_name(pool), pool->max_buffers);
@@ -115,13 +204,24 @@ static int buffer_pool_expand(buffer_pool_t *pool) {
     buffers_to_add = pool->max_buffers - pool->num_buffers;
   }
 
-  logger(LOG_DEBUG, "%s: Expanding by %zu buffers (current: %zu, free: %zu, max: %zu)", buffer_pool_name(pool),
-         buffers_to_add, pool->num_buffers, pool->num_free, pool->max_buffers);
-
-  buffer_pool_segment_t *new_segment = buffer_pool_segment_create(pool->buffer_size, buffers_to_add, pool);
-  if (!new_segment) {
-    logger(LOG_ERROR, "%s: Failed to allocate new segment", buffer_pool_name(pool));
-    return -1;
+  buffer_pool_segment_t *new_segment = NULL;
+  if (pool == &zerocopy_state.pool)
+    new_segment = segment_depot_take(pool->max_buffers - pool->num_buffers);
+
+  if (new_segment) {
+    buffers_to_add = new_segment->num_buffers;
+    buffer_pool_adopt_segment(pool, new_segment);
+    logger(LOG_DEBUG, "%s: Expanding by %zu buffers from shared depot (current: %zu, free: %zu, max: %zu)",
+           buffer_pool_name(pool), buffers_to_add, pool->num_buffers, pool->num_free, pool->max_buffers);
+  } else {
+    logger(LOG_DEBUG, "%s: Expanding by %zu buffers (current: %zu, free: %zu, max: %zu)", buffer_pool_name(pool),
+           buffers_to_add, pool->num_buffers, pool->num_free, pool->max_buffers);
+
+    new_segment = buffer_pool_segment_create(pool->buffer_size, buffers_to_add, pool);
+    if (!new_segment) {
+      logger(LOG_ERROR, "%s: Failed to allocate new segment", buffer_pool_name(pool));
+      return -1;
+    }
   }
 
   new_segment->next = pool->segments;
@@ -305,9 +405,11 @@ static void buffer_pool_try_shrink_pool(buffer_pool_t *pool, size_t min_buffers)
              buffer_pool_name(pool), seg->num_buffers, (buffer_pool_time_us() - seg->create_time_us) / 1000000.0,
              pool->num_buffers + seg->num_buffers, pool->num_buffers);
 
-      free(seg->refs);
-      free(seg->buffers);
-      free(seg);
+      if (pool != &zerocopy_state.pool || segment_depot_put(seg) < 0) {
+        free(seg->refs);
+        free(seg->buffers);
+        free(seg);
+      }
 
       segments_freed++;
 
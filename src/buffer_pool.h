@@ -21,6 +21,9 @@
 #define CONTROL_POOL_LOW_WATERMARK 64
 #define CONTROL_POOL_HIGH_WATERMARK (CONTROL_POOL_INITIAL_SIZE * 2)
 
+/* Shared segment depot (worker-threads mode): idle media segments parked for other threads */
+#define BUFFER_POOL_DEPOT_MAX_SEGMENTS 16
+
 typedef enum {
   BUFFER_TYPE_MEMORY = 0, /* Normal memory buffer from pool */
   BUFFER_TYPE_FILE = 1    /* File descriptor for sendfile() */
@@ -108,4 +111,18 @@ buffer_ref_t *buffer_pool_alloc(void);
 buffer_ref_t *buffer_pool_alloc_control(void);
 void buffer_pool_try_shrink(void);
 
+/**
+ * Enable the process-wide segment depot shared by worker threads.
+ * Fully idle media-pool segments released by one thread's shrink are parked
+ * in a lock-free stack and adopted by the next thread that needs to expand,
+ * instead of being returned to malloc.  Call before starting worker threads.
+ */
+void buffer_pool_depot_enable(void);
+
+/**
+ * Free all segments still parked in the depot.  Call after worker threads
+ * have been joined.
+ */
+void buffer_pool_depot_cleanup(void);
+
 #endif /* BUFFER_POOL_H */
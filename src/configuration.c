@@ -1,8 +1,15 @@
 #include "configuration.h"
+#include "connection.h"
+#include "cpu_affinity.h"
 #include "epg.h"
 #include "http.h"
 #include "m3u.h"
+#include "rtsp_share.h"
 #include "service.h"
+#include "http_proxy_cache.h"
+#include "snapshot_cache.h"
+#include "snapshot_decoder.h"
+#include "thumbnail.h"
 #include "utils.h"
 #include <ctype.h>
 #include <errno.h>
@@ -26,6 +33,8 @@ static char *config_file_path = NULL;
 int cmd_verbosity_set = 0;
 int cmd_udpxy_set = 0;
 int cmd_maxclients_set = 0;
+int cmd_http_keepalive_timeout_set = 0;
+int cmd_http_keepalive_requests_set = 0;
 int cmd_bind_set = 0;
 int cmd_hostname_set = 0;
 int cmd_xff_set = 0;
@@ -36,6 +45,11 @@ int cmd_mcast_rejoin_interval_set = 0;
 int cmd_ffmpeg_path_set = 0;
 int cmd_ffmpeg_args_set = 0;
 int cmd_video_snapshot_set = 0;
+int cmd_snapshot_decoders_set = 0;
+int cmd_snapshot_queue_depth_set = 0;
+int cmd_snapshot_cache_ttl_set = 0;
+int cmd_thumbnail_interval_set = 0;
+int cmd_thumbnail_concurrency_set = 0;
 int cmd_upstream_interface_set = 0;
 int cmd_upstream_interface_fcc_set = 0;
 int cmd_upstream_interface_rtsp_set = 0;
@@ -48,11 +62,17 @@ int cmd_app_path_prefix_set = 0;
 int cmd_use_relative_path_in_m3u_set = 0;
 int cmd_zerocopy_on_send_set = 0;
 int cmd_workers_set = 0;
+int cmd_worker_threads_set = 0;
+int cmd_worker_cpu_affinity_set = 0;
+int cmd_reuseport_cpu_steering_set = 0;
 int cmd_external_m3u_url_set = 0;
 int cmd_external_m3u_update_interval_set = 0;
 int cmd_rtsp_stun_server_set = 0;
+int cmd_dns_server_set = 0;
 int cmd_http_proxy_user_agent_set = 0;
+int cmd_http_proxy_segment_cache_set = 0;
 int cmd_rtsp_user_agent_set = 0;
+int cmd_rtsp_share_linger_set = 0;
 int cmd_cors_allow_origin_set = 0;
 int cmd_access_log_set = 0;
 int cmd_log_format_set = 0;
@@ -65,7 +85,20 @@ enum long_option_e {
   OPT_USE_RELATIVE_PATH_IN_M3U,
   OPT_ACCESS_LOG,
   OPT_LOG_FORMAT,
-  OPT_PID_FILE
+  OPT_PID_FILE,
+  OPT_WORKER_THREADS,
+  OPT_WORKER_CPU_AFFINITY,
+  OPT_REUSEPORT_CPU_STEERING,
+  OPT_SNAPSHOT_DECODERS,
+  OPT_SNAPSHOT_QUEUE_DEPTH,
+  OPT_SNAPSHOT_CACHE_TTL,
+  OPT_THUMBNAIL_INTERVAL,
+  OPT_THUMBNAIL_CONCURRENCY,
+  OPT_DNS_SERVER,
+  OPT_HTTP_KEEPALIVE_TIMEOUT,
+  OPT_HTTP_KEEPALIVE_REQUESTS,
+  OPT_RTSP_SHARE_LINGER,
+  OPT_HTTP_PROXY_SEGMENT_CACHE
 };
 
 /* M3U parsing state variables */
@@ -138,6 +171,8 @@ static void free_config_strings(config_t *target, bool force_free) {
     safe_free_string(&target->external_m3u_url);
   if (!cmd_rtsp_stun_server_set || force_free)
     safe_free_string(&target->rtsp_stun_server);
+  if (!cmd_dns_server_set || force_free)
+    safe_free_string(&target->dns_server);
   if (!cmd_http_proxy_user_agent_set || force_free)
     safe_free_string(&target->http_proxy_user_agent);
   if (!cmd_rtsp_user_agent_set || force_free)
@@ -150,6 +185,8 @@ static void free_config_strings(config_t *target, bool force_free) {
     safe_free_string(&target->log_format);
   if (!cmd_pid_file_set || force_free)
     safe_free_string(&target->pid_file);
+  if (!cmd_worker_cpu_affinity_set || force_free)
+    safe_free_string(&target->worker_cpu_affinity);
 }
 
 static int snapshot_string(char **dst, char *src, int keep_shallow) {
@@ -214,6 +251,20 @@ static void apply_bind_side_effects(void) {
   }
 }
 
+/* Replace config.worker_cpu_affinity; invalid values leave workers unpinned */
+static void set_worker_cpu_affinity(const char *value) {
+  cpu_affinity_set_t cpus;
+
+  safe_free_string(&config.worker_cpu_affinity);
+  if (value[0] == '\0')
+    return;
+  if (cpu_affinity_parse(value, &cpus) < 0) {
+    logger(LOG_ERROR, "Invalid worker-cpu-affinity value: %s. Ignoring.", value);
+    return;
+  }
+  config.worker_cpu_affinity = strdup(value);
+}
+
 static int parse_port_range_value(const char *value, int *min_port, int *max_port) {
   char *endptr = NULL;
   long start = 0;
@@ -555,6 +606,32 @@ void parse_global_sec(char *line) {
     return;
   }
 
+  if (strcasecmp("http-keepalive-timeout", param) == 0) {
+    if (set_if_not_cmd_override(cmd_http_keepalive_timeout_set, "http-keepalive-timeout")) {
+      int val = atoi(value);
+      if (val < 0 || val > CONNECTION_KEEPALIVE_TIMEOUT_MAX) {
+        logger(LOG_ERROR, "Invalid http-keepalive-timeout! Must be between 0 and %d. Ignoring.",
+               CONNECTION_KEEPALIVE_TIMEOUT_MAX);
+      } else {
+        config.http_keepalive_timeout = val;
+      }
+    }
+    return;
+  }
+
+  if (strcasecmp("http-keepalive-requests", param) == 0) {
+    if (set_if_not_cmd_override(cmd_http_keepalive_requests_set, "http-keepalive-requests")) {
+      int val = atoi(value);
+      if (val < 1 || val > CONNECTION_KEEPALIVE_REQUESTS_MAX) {
+        logger(LOG_ERROR, "Invalid http-keepalive-requests! Must be between 1 and %d. Ignoring.",
+               CONNECTION_KEEPALIVE_REQUESTS_MAX);
+      } else {
+        config.http_keepalive_requests = val;
+      }
+    }
+    return;
+  }
+
   if (strcasecmp("workers", param) == 0) {
     int n = atoi(value);
     if (n < 1 || n > CONFIG_MAX_WORKERS) {
@@ -616,12 +693,85 @@ void parse_global_sec(char *line) {
     return;
   }
 
+  if (strcasecmp("snapshot-decoders", param) == 0) {
+    if (set_if_not_cmd_override(cmd_snapshot_decoders_set, "snapshot-decoders")) {
+      int val = atoi(value);
+      if (val < 1 || val > SNAPSHOT_DECODER_MAX) {
+        logger(LOG_ERROR, "Invalid snapshot-decoders! Must be between 1 and %d. Ignoring.", SNAPSHOT_DECODER_MAX);
+      } else {
+        config.snapshot_decoders = val;
+      }
+    }
+    return;
+  }
+
+  if (strcasecmp("snapshot-queue-depth", param) == 0) {
+    if (set_if_not_cmd_override(cmd_snapshot_queue_depth_set, "snapshot-queue-depth")) {
+      int val = atoi(value);
+      if (val < 0 || val > SNAPSHOT_QUEUE_MAX) {
+        logger(LOG_ERROR, "Invalid snapshot-queue-depth! Must be between 0 and %d. Ignoring.", SNAPSHOT_QUEUE_MAX);
+      } else {
+        config.snapshot_queue_depth = val;
+      }
+    }
+    return;
+  }
+
+  if (strcasecmp("snapshot-cache-ttl", param) == 0) {
+    if (set_if_not_cmd_override(cmd_snapshot_cache_ttl_set, "snapshot-cache-ttl")) {
+      int val = atoi(value);
+      if (val < 0 || val > SNAPSHOT_CACHE_TTL_MAX) {
+        logger(LOG_ERROR, "Invalid snapshot-cache-ttl! Must be between 0 and %d. Ignoring.", SNAPSHOT_CACHE_TTL_MAX);
+      } else {
+        config.snapshot_cache_ttl = val;
+      }
+    }
+    return;
+  }
+
+  if (strcasecmp("thumbnail-interval", param) == 0) {
+    if (set_if_not_cmd_override(cmd_thumbnail_interval_set, "thumbnail-interval")) {
+      int val = atoi(value);
+      if (val < 0 || val > THUMBNAIL_INTERVAL_MAX) {
+        logger(LOG_ERROR, "Invalid thumbnail-interval! Must be between 0 and %d. Ignoring.", THUMBNAIL_INTERVAL_MAX);
+      } else {
+        config.thumbnail_interval = val;
+      }
+    }
+    return;
+  }
+
+  if (strcasecmp("thumbnail-concurrency", param) == 0) {
+    if (set_if_not_cmd_override(cmd_thumbnail_concurrency_set, "thumbnail-concurrency")) {
+      int val = atoi(value);
+      if (val < 1 || val > THUMBNAIL_CONCURRENCY_MAX) {
+        logger(LOG_ERROR, "Invalid thumbnail-concurrency! Must be between 1 and %d. Ignoring.",
+               THUMBNAIL_CONCURRENCY_MAX);
+      } else {
+        config.thumbnail_concurrency = val;
+      }
+    }
+    return;
+  }
+
   if (strcasecmp("zerocopy-on-send", param) == 0) {
     if (set_if_not_cmd_override(cmd_zerocopy_on_send_set, "zerocopy-on-send"))
       config.zerocopy_on_send = parse_bool(value);
     return;
   }
 
+  if (strcasecmp("worker-threads", param) == 0) {
+    if (set_if_not_cmd_override(cmd_worker_threads_set, "worker-threads"))
+      config.worker_threads = parse_bool(value);
+    return;
+  }
+
+  if (strcasecmp("reuseport-cpu-steering", param) == 0) {
+    if (set_if_not_cmd_override(cmd_reuseport_cpu_steering_set, "reuseport-cpu-steering"))
+      config.reuseport_cpu_steering = parse_bool(value);
+    return;
+  }
+
   if (strcasecmp("use-relative-path-in-m3u", param) == 0) {
     if (set_if_not_cmd_override(cmd_use_relative_path_in_m3u_set, "use-relative-path-in-m3u"))
       config.use_relative_path_in_m3u = parse_bool(value);
@@ -763,6 +913,17 @@ void parse_global_sec(char *line) {
     return;
   }
 
+  if (strcasecmp("dns-server", param) == 0) {
+    if (!cmd_dns_server_set) {
+      safe_free_string(&config.dns_server);
+      if (value[0] != '\0') {
+        config.dns_server = strdup(value);
+        logger(LOG_INFO, "DNS server: %s", config.dns_server);
+      }
+    }
+    return;
+  }
+
   if (strcasecmp("http-proxy-user-agent", param) == 0) {
     if (set_if_not_cmd_override(cmd_http_proxy_user_agent_set, "http-proxy-user-agent")) {
       safe_free_string(&config.http_proxy_user_agent);
@@ -783,6 +944,31 @@ void parse_global_sec(char *line) {
     return;
   }
 
+  if (strcasecmp("http-proxy-segment-cache", param) == 0) {
+    if (set_if_not_cmd_override(cmd_http_proxy_segment_cache_set, "http-proxy-segment-cache")) {
+      int val = atoi(value);
+      if (val < 0 || val > HTTP_PROXY_CACHE_SIZE_MAX) {
+        logger(LOG_ERROR, "Invalid http-proxy-segment-cache! Must be between 0 and %d. Ignoring.",
+               HTTP_PROXY_CACHE_SIZE_MAX);
+      } else {
+        config.http_proxy_segment_cache = val;
+      }
+    }
+    return;
+  }
+
+  if (strcasecmp("rtsp-share-linger", param) == 0) {
+    if (set_if_not_cmd_override(cmd_rtsp_share_linger_set, "rtsp-share-linger")) {
+      int val = atoi(value);
+      if (val < 0 || val > RTSP_SHARE_LINGER_MAX) {
+        logger(LOG_ERROR, "Invalid rtsp-share-linger! Must be between 0 and %d. Ignoring.", RTSP_SHARE_LINGER_MAX);
+      } else {
+        config.rtsp_share_linger = val;
+      }
+    }
+    return;
+  }
+
   /* CORS configuration */
   if (strcasecmp("cors-allow-origin", param) == 0) {
     if (set_if_not_cmd_override(cmd_cors_allow_origin_set, "cors-allow-origin")) {
@@ -811,6 +997,12 @@ void parse_global_sec(char *line) {
     return;
   }
 
+  if (strcasecmp("worker-cpu-affinity", param) == 0) {
+    if (set_if_not_cmd_override(cmd_worker_cpu_affinity_set, "worker-cpu-affinity"))
+      set_worker_cpu_affinity(value);
+    return;
+  }
+
   if (strcasecmp("pid-file", param) == 0) {
     if (set_if_not_cmd_override(cmd_pid_file_set, "pid-file")) {
       safe_free_string(&config.pid_file);
@@ -1060,6 +1252,9 @@ void config_cleanup(bool force_free) {
   /* Free all services */
   service_free_all();
 
+  /* External services are gone: the next M3U load must not be conditional */
+  http_fetch_validators_reset(&m3u_get_cache()->fetch_validators);
+
   /* Free EPG cache */
   epg_cleanup();
 
@@ -1090,12 +1285,14 @@ int config_snapshot(config_t *snapshot) {
   snapshot->app_path_route = NULL;
   snapshot->external_m3u_url = NULL;
   snapshot->rtsp_stun_server = NULL;
+  snapshot->dns_server = NULL;
   snapshot->http_proxy_user_agent = NULL;
   snapshot->rtsp_user_agent = NULL;
   snapshot->cors_allow_origin = NULL;
   snapshot->access_log = NULL;
   snapshot->log_format = NULL;
   snapshot->pid_file = NULL;
+  snapshot->worker_cpu_affinity = NULL;
 
 #define SNAPSHOT_STRING(field, cmd_flag)                                                                               \
   do {                                                                                                                 \
@@ -1115,12 +1312,14 @@ int config_snapshot(config_t *snapshot) {
   SNAPSHOT_STRING(app_path_route, cmd_app_path_prefix_set);
   SNAPSHOT_STRING(external_m3u_url, cmd_external_m3u_url_set);
   SNAPSHOT_STRING(rtsp_stun_server, cmd_rtsp_stun_server_set);
+  SNAPSHOT_STRING(dns_server, cmd_dns_server_set);
   SNAPSHOT_STRING(http_proxy_user_agent, cmd_http_proxy_user_agent_set);
   SNAPSHOT_STRING(rtsp_user_agent, cmd_rtsp_user_agent_set);
   SNAPSHOT_STRING(cors_allow_origin, cmd_cors_allow_origin_set);
   SNAPSHOT_STRING(access_log, cmd_access_log_set);
   SNAPSHOT_STRING(log_format, cmd_log_format_set);
   SNAPSHOT_STRING(pid_file, cmd_pid_file_set);
+  SNAPSHOT_STRING(worker_cpu_affinity, cmd_worker_cpu_affinity_set);
 
 #undef SNAPSHOT_STRING
 
@@ -1160,6 +1359,10 @@ void config_init(void) {
     config.verbosity = LOG_ERROR;
   if (!cmd_maxclients_set)
     config.maxclients = 5;
+  if (!cmd_http_keepalive_timeout_set)
+    config.http_keepalive_timeout = 15;
+  if (!cmd_http_keepalive_requests_set)
+    config.http_keepalive_requests = 100;
   if (!cmd_udpxy_set)
     config.udpxy = 1;
   if (!cmd_buffer_pool_max_size_set)
@@ -1170,6 +1373,20 @@ void config_init(void) {
     config.xff = 0;
   if (!cmd_video_snapshot_set)
     config.video_snapshot = 0;
+  if (!cmd_snapshot_decoders_set)
+    config.snapshot_decoders = 2;
+  if (!cmd_snapshot_queue_depth_set)
+    config.snapshot_queue_depth = 8;
+  if (!cmd_snapshot_cache_ttl_set)
+    config.snapshot_cache_ttl = 5;
+  if (!cmd_rtsp_share_linger_set)
+    config.rtsp_share_linger = 0;
+  if (!cmd_http_proxy_segment_cache_set)
+    config.http_proxy_segment_cache = 0;
+  if (!cmd_thumbnail_interval_set)
+    config.thumbnail_interval = 0;
+  if (!cmd_thumbnail_concurrency_set)
+    config.thumbnail_concurrency = 2;
   if (!cmd_mcast_rejoin_interval_set)
     config.mcast_rejoin_interval = 0;
   if (!cmd_zerocopy_on_send_set)
@@ -1184,6 +1401,10 @@ void config_init(void) {
   /* Workers setting (only if not set by command line) */
   if (!cmd_workers_set)
     config.workers = 1;
+  if (!cmd_worker_threads_set)
+    config.worker_threads = 0;
+  if (!cmd_reuseport_cpu_steering_set)
+    config.reuseport_cpu_steering = 0;
 
   /* Set string config values to defaults (only if not set by command line) */
   if (!cmd_ffmpeg_args_set)
@@ -1293,8 +1514,18 @@ void usage(FILE *f, char *progname) {
           "\t-q --quiet           Report only fatal errors\n"
           "\t-U --noudpxy         Disable UDPxy compatibility\n"
           "\t-m --maxclients <n>  Serve max n requests simultaneously (default 5)\n"
+          "\t   --http-keepalive-timeout <sec>  Idle time allowed between requests on "
+          "a persistent connection, 0 disables keep-alive (default 15)\n"
+          "\t   --http-keepalive-requests <n>  Requests served per persistent "
+          "connection (default 100)\n"
           "\t-w --workers <n>     Number of worker processes with SO_REUSEPORT "
           "(default 1)\n"
+          "\t   --worker-threads   Run workers as threads of a single worker process "
+          "(default: off)\n"
+          "\t   --worker-cpu-affinity <auto|cpus>  Pin workers to CPUs, e.g. auto or "
+          "0-3,6 (default: off)\n"
+          "\t   --reuseport-cpu-steering  Steer new connections to the worker pinned "
+          "to the CPU that received them (default: off)\n"
           "\t-b --buffer-pool-max-size <n> Maximum number of buffers in zero-copy "
           "pool (default 16384)\n"
           "\t-B --udp-rcvbuf-size <bytes> UDP socket receive buffer size for "
@@ -1330,6 +1561,16 @@ void usage(FILE *f, char *progname) {
           "-hwaccel none)\n"
           "\t-S --video-snapshot      Enable video snapshot feature (default: "
           "off)\n"
+          "\t   --snapshot-decoders <n>  Prewarmed ffmpeg decoders per worker "
+          "(default 2)\n"
+          "\t   --snapshot-queue-depth <n>  Snapshot requests that may wait for "
+          "a decoder (default 8)\n"
+          "\t   --snapshot-cache-ttl <sec>  Seconds a channel snapshot is reused, "
+          "0 disables (default 5)\n"
+          "\t   --thumbnail-interval <sec>  Refresh every channel's thumbnail for "
+          "the mosaic this often, 0 disables (default 0)\n"
+          "\t   --thumbnail-concurrency <n>  Thumbnail captures running at once "
+          "(default 2)\n"
           "\t-s --status-page-path <path>  HTTP path for status UI (default: "
           "/status)\n"
           "\t-p --player-page-path <path>  HTTP path for player UI (default: "
@@ -1345,10 +1586,16 @@ void usage(FILE *f, char *progname) {
           "\t-Z --zerocopy-on-send    Enable zero-copy send with MSG_ZEROCOPY for "
           "better performance (default: off)\n"
           "\t-g --http-proxy-user-agent <value>  Override User-Agent for upstream HTTP proxy requests\n"
+          "\t   --http-proxy-segment-cache <MB>  HLS segments cached and shared per worker "
+          "(default: 0 = off)\n"
           "\t-u --rtsp-user-agent <value>  User-Agent header for upstream RTSP requests "
           "(default: rtp2httpd/<version>)\n"
+          "\t   --rtsp-share-linger <seconds>  Keep a shared RTSP session playing after its "
+          "last client left (default: 0 = tear down at once)\n"
           "\t-N --rtsp-stun-server <host:port>  STUN server for RTSP NAT traversal "
           "(default: disabled)\n"
+          "\t   --dns-server <ip[:port],...>  Nameservers for upstream host names "
+          "(default: from /etc/resolv.conf)\n"
           "\t-O --cors-allow-origin <origin>  Set Access-Control-Allow-Origin header "
           "(default: disabled)\n"
           "\t   --access-log <path>  Write access logs to this file (default: disabled)\n"
@@ -1404,6 +1651,8 @@ void parse_cmd_line(int argc, char *argv[]) {
                                     {"help", no_argument, 0, 'h'},
                                     {"noudpxy", no_argument, 0, 'U'},
                                     {"maxclients", required_argument, 0, 'm'},
+                                    {"http-keepalive-timeout", required_argument, 0, OPT_HTTP_KEEPALIVE_TIMEOUT},
+                                    {"http-keepalive-requests", required_argument, 0, OPT_HTTP_KEEPALIVE_REQUESTS},
                                     {"workers", required_argument, 0, 'w'},
                                     {"buffer-pool-max-size", required_argument, 0, 'b'},
                                     {"udp-rcvbuf-size", required_argument, 0, 'B'},
@@ -1423,6 +1672,12 @@ void parse_cmd_line(int argc, char *argv[]) {
                                     {"ffmpeg-path", required_argument, 0, 'F'},
                                     {"ffmpeg-args", required_argument, 0, 'A'},
                                     {"video-snapshot", no_argument, 0, 'S'},
+                                    {"snapshot-decoders", required_argument, 0, OPT_SNAPSHOT_DECODERS},
+                                    {"snapshot-queue-depth", required_argument, 0, OPT_SNAPSHOT_QUEUE_DEPTH},
+                                    {"snapshot-cache-ttl", required_argument, 0, OPT_SNAPSHOT_CACHE_TTL},
+                                    {"thumbnail-interval", required_argument, 0, OPT_THUMBNAIL_INTERVAL},
+                                    {"thumbnail-concurrency", required_argument, 0, OPT_THUMBNAIL_CONCURRENCY},
+                                    {"dns-server", required_argument, 0, OPT_DNS_SERVER},
                                     {"status-page-path", required_argument, 0, 's'},
                                     {"player-page-path", required_argument, 0, 'p'},
                                     {"app-path-prefix", required_argument, 0, OPT_APP_PATH_PREFIX},
@@ -1431,12 +1686,17 @@ void parse_cmd_line(int argc, char *argv[]) {
                                     {"external-m3u-update-interval", required_argument, 0, 'I'},
                                     {"zerocopy-on-send", no_argument, 0, 'Z'},
                                     {"http-proxy-user-agent", required_argument, 0, 'g'},
+                                    {"http-proxy-segment-cache", required_argument, 0, OPT_HTTP_PROXY_SEGMENT_CACHE},
                                     {"rtsp-stun-server", required_argument, 0, 'N'},
                                     {"rtsp-user-agent", required_argument, 0, 'u'},
+                                    {"rtsp-share-linger", required_argument, 0, OPT_RTSP_SHARE_LINGER},
                                     {"cors-allow-origin", required_argument, 0, 'O'},
                                     {"access-log", required_argument, 0, OPT_ACCESS_LOG},
                                     {"log-format", required_argument, 0, OPT_LOG_FORMAT},
                                     {"pid-file", required_argument, 0, OPT_PID_FILE},
+                                    {"worker-threads", no_argument, 0, OPT_WORKER_THREADS},
+                                    {"worker-cpu-affinity", required_argument, 0, OPT_WORKER_CPU_AFFINITY},
+                                    {"reuseport-cpu-steering", no_argument, 0, OPT_REUSEPORT_CPU_STEERING},
                                     {0, 0, 0, 0}};
 
   const char short_opts[] = "v:qhUm:w:b:B:c:l:P:H:XT:i:f:t:r:y:R:F:A:s:p:M:I:SCZg:N:u:O:";
@@ -1652,6 +1912,23 @@ void parse_cmd_line(int argc, char *argv[]) {
       }
       cmd_rtsp_user_agent_set = 1;
       break;
+    case OPT_HTTP_PROXY_SEGMENT_CACHE:
+      if (atoi(optarg) < 0 || atoi(optarg) > HTTP_PROXY_CACHE_SIZE_MAX) {
+        logger(LOG_ERROR, "Invalid http-proxy-segment-cache! Must be between 0 and %d. Ignoring.",
+               HTTP_PROXY_CACHE_SIZE_MAX);
+      } else {
+        config.http_proxy_segment_cache = atoi(optarg);
+        cmd_http_proxy_segment_cache_set = 1;
+      }
+      break;
+    case OPT_RTSP_SHARE_LINGER:
+      if (atoi(optarg) < 0 || atoi(optarg) > RTSP_SHARE_LINGER_MAX) {
+        logger(LOG_ERROR, "Invalid rtsp-share-linger! Must be between 0 and %d. Ignoring.", RTSP_SHARE_LINGER_MAX);
+      } else {
+        config.rtsp_share_linger = atoi(optarg);
+        cmd_rtsp_share_linger_set = 1;
+      }
+      break;
     case 'O':
       safe_free_string(&config.cors_allow_origin);
       config.cors_allow_origin = strdup(optarg);
@@ -1678,6 +1955,85 @@ void parse_cmd_line(int argc, char *argv[]) {
       }
       cmd_pid_file_set = 1;
       break;
+    case OPT_WORKER_THREADS:
+      config.worker_threads = 1;
+      cmd_worker_threads_set = 1;
+      break;
+    case OPT_WORKER_CPU_AFFINITY:
+      set_worker_cpu_affinity(optarg);
+      cmd_worker_cpu_affinity_set = 1;
+      break;
+    case OPT_REUSEPORT_CPU_STEERING:
+      config.reuseport_cpu_steering = 1;
+      cmd_reuseport_cpu_steering_set = 1;
+      break;
+    case OPT_SNAPSHOT_DECODERS:
+      if (atoi(optarg) < 1 || atoi(optarg) > SNAPSHOT_DECODER_MAX) {
+        logger(LOG_ERROR, "Invalid snapshot-decoders! Must be between 1 and %d. Ignoring.", SNAPSHOT_DECODER_MAX);
+      } else {
+        config.snapshot_decoders = atoi(optarg);
+        cmd_snapshot_decoders_set = 1;
+      }
+      break;
+    case OPT_SNAPSHOT_QUEUE_DEPTH:
+      if (atoi(optarg) < 0 || atoi(optarg) > SNAPSHOT_QUEUE_MAX) {
+        logger(LOG_ERROR, "Invalid snapshot-queue-depth! Must be between 0 and %d. Ignoring.", SNAPSHOT_QUEUE_MAX);
+      } else {
+        config.snapshot_queue_depth = atoi(optarg);
+        cmd_snapshot_queue_depth_set = 1;
+      }
+      break;
+    case OPT_SNAPSHOT_CACHE_TTL:
+      if (atoi(optarg) < 0 || atoi(optarg) > SNAPSHOT_CACHE_TTL_MAX) {
+        logger(LOG_ERROR, "Invalid snapshot-cache-ttl! Must be between 0 and %d. Ignoring.", SNAPSHOT_CACHE_TTL_MAX);
+      } else {
+        config.snapshot_cache_ttl = atoi(optarg);
+        cmd_snapshot_cache_ttl_set = 1;
+      }
+      break;
+    case OPT_THUMBNAIL_INTERVAL:
+      if (atoi(optarg) < 0 || atoi(optarg) > THUMBNAIL_INTERVAL_MAX) {
+        logger(LOG_ERROR, "Invalid thumbnail-interval! Must be between 0 and %d. Ignoring.", THUMBNAIL_INTERVAL_MAX);
+      } else {
+        config.thumbnail_interval = atoi(optarg);
+        cmd_thumbnail_interval_set = 1;
+      }
+      break;
+    case OPT_HTTP_KEEPALIVE_TIMEOUT:
+      if (atoi(optarg) < 0 || atoi(optarg) > CONNECTION_KEEPALIVE_TIMEOUT_MAX) {
+        logger(LOG_ERROR, "Invalid http-keepalive-timeout! Must be between 0 and %d. Ignoring.",
+               CONNECTION_KEEPALIVE_TIMEOUT_MAX);
+      } else {
+        config.http_keepalive_timeout = atoi(optarg);
+        cmd_http_keepalive_timeout_set = 1;
+      }
+      break;
+    case OPT_HTTP_KEEPALIVE_REQUESTS:
+      if (atoi(optarg) < 1 || atoi(optarg) > CONNECTION_KEEPALIVE_REQUESTS_MAX) {
+        logger(LOG_ERROR, "Invalid http-keepalive-requests! Must be between 1 and %d. Ignoring.",
+               CONNECTION_KEEPALIVE_REQUESTS_MAX);
+      } else {
+        config.http_keepalive_requests = atoi(optarg);
+        cmd_http_keepalive_requests_set = 1;
+      }
+      break;
+    case OPT_THUMBNAIL_CONCURRENCY:
+      if (atoi(optarg) < 1 || atoi(optarg) > THUMBNAIL_CONCURRENCY_MAX) {
+        logger(LOG_ERROR, "Invalid thumbnail-concurrency! Must be between 1 and %d. Ignoring.",
+               THUMBNAIL_CONCURRENCY_MAX);
+      } else {
+        config.thumbnail_concurrency = atoi(optarg);
+        cmd_thumbnail_concurrency_set = 1;
+      }
+      break;
+    case OPT_DNS_SERVER:
+      safe_free_string(&config.dns_server);
+      if (optarg[0] != '\0') {
+        config.dns_server = strdup(optarg);
+      }
+      cmd_dns_server_set = 1;
+      logger(LOG_INFO, "DNS server: %s", optarg);
+      break;
     default:
       logger(LOG_FATAL, "Unknown option! %d ", opt);
       usage(stderr, argv[0]);
@@ -54,9 +54,14 @@ typedef struct {
   char *hostname;  /* Server hostname for URL generation (NULL=auto) */
   int xff;         /* Enable X-Forwarded-For header recognize (0=no, 1=yes) */
   char *r2h_token; /* Authentication token for HTTP requests (NULL=disabled) */
+  int http_keepalive_timeout;  /* Seconds a persistent connection may idle between requests, 0 = off, default 15 */
+  int http_keepalive_requests; /* Requests served per persistent connection, default 100 */
 
   /* Worker and performance settings */
   int workers;              /* Number of worker threads (SO_REUSEPORT sharded), default 1 */
+  int worker_threads;       /* Run workers as event-loop threads of one process (0=processes, 1=threads) */
+  char *worker_cpu_affinity; /* CPUs to pin workers to ("auto" or list like "0-3,6", NULL=unpinned) */
+  int reuseport_cpu_steering; /* Steer new connections to the worker on the SYN's CPU (0=no, 1=yes) */
   int buffer_pool_max_size; /* Maximum number of buffers in zero-copy buffer
                                pool, default 16384 */
   int udp_rcvbuf_size;      /* UDP socket receive buffer size in bytes for
@@ -91,7 +96,12 @@ typedef struct {
   char *ffmpeg_args; /* Additional ffmpeg arguments (default: "-hwaccel none") */
 
   /* Video snapshot settings */
-  int video_snapshot; /* Enable video snapshot feature (0=off, 1=on) */
+  int video_snapshot;       /* Enable video snapshot feature (0=off, 1=on) */
+  int snapshot_decoders;    /* Prewarmed ffmpeg decoders per worker, default 2 */
+  int snapshot_queue_depth; /* Snapshot requests allowed to wait for a decoder, default 8 */
+  int snapshot_cache_ttl;   /* Seconds a channel's JPEG is reused, 0 = no caching, default 5 */
+  int thumbnail_interval;   /* Seconds per thumbnail refresh cycle over all channels, 0 = off */
+  int thumbnail_concurrency; /* Thumbnail captures running at once, default 2 */
 
   /* Status page settings */
   char *status_page_path;  /* Absolute HTTP path for status page (leading slash) */
@@ -119,12 +129,18 @@ typedef struct {
                            1=enabled) */
 
   /* STUN NAT traversal settings */
-  char *rtsp_stun_server;      /* STUN server host:port for RTSP NAT traversal
-                                  (NULL=disabled) */
-  char *http_proxy_user_agent; /* Override User-Agent header for upstream HTTP
-                                  proxy requests (NULL=disabled) */
-  char *rtsp_user_agent;       /* User-Agent header for upstream RTSP requests
-                                  (NULL=use default) */
+  char *rtsp_stun_server;        /* STUN server host:port for RTSP NAT traversal
+                                   (NULL=disabled) */
+  char *dns_server;             /* Nameservers for upstream host names, comma
+                                   separated (NULL=use /etc/resolv.conf) */
+  char *http_proxy_user_agent;  /* Override User-Agent header for upstream HTTP
+                                   proxy requests (NULL=disabled) */
+  int http_proxy_segment_cache; /* MB of HLS segments cached per worker for
+                                   proxied requests, 0 = off, default 0 */
+  char *rtsp_user_agent;        /* User-Agent header for upstream RTSP requests
+                                   (NULL=use default) */
+  int rtsp_share_linger;        /* Seconds a shared RTSP session keeps playing
+                                   after its last client left, default 0 */
 
   /* CORS settings */
   char *cors_allow_origin; /* CORS Access-Control-Allow-Origin value
@@ -3,15 +3,21 @@
 #include "embedded_web.h"
 #include "epg.h"
 #include "http.h"
+#include "http_proxy_cache.h"
 #include "m3u.h"
+#include "metrics.h"
 #include "platform_compat.h"
 #include "poller.h"
+#include "rtp2httpd.h"
 #include "service.h"
+#include "snapshot_cache.h"
 #include "status.h"
+#include "thumbnail.h"
 #include "utils.h"
 #include "zerocopy.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <net/if.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
 #include <stdint.h>
@@ -40,9 +46,17 @@
 #define CONN_QUEUE_SLOW_EXIT_LIMIT_RATIO 0.75
 #define CONN_QUEUE_SLOW_CLAMP_FACTOR 0.8
 
+#define CONNECTION_STATS_INC(field)                                                                                    \
+  do {                                                                                                                 \
+    if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS) {                                           \
+      status_shared->worker_stats[worker_id].field++;                                                                  \
+    }                                                                                                                  \
+  } while (0)
+
 /* Forward declarations */
 static void handle_playlist_request(connection_t *c);
 static void handle_epg_request(connection_t *c, int requested_gz);
+static int handle_epg_query_request(connection_t *c, const char *query, int as_xml);
 
 static int strip_app_path_prefix(const char *url, char *out, size_t out_size) {
   const char *prefix = config.app_path_prefix;
@@ -606,6 +620,8 @@ void connection_cleanup(connection_t *c) {
   /* Cleanup HTTP request (free dynamically allocated body) */
   http_request_cleanup(&c->http_req);
 
+  status_sse_view_free(c->sse_view);
+
   free(c);
 }
 
@@ -626,6 +642,7 @@ int connection_queue_output(connection_t *c, const uint8_t *data, size_t len) {
              "connection_queue_output: Buffer pool exhausted, cannot queue %zu "
              "bytes",
              remaining);
+      c->keepalive = 0; /* The response is cut short */
       return -1;
     }
 
@@ -646,6 +663,7 @@ int connection_queue_output(connection_t *c, const uint8_t *data, size_t len) {
              "connection_queue_output: Zero-copy queue full, cannot queue %zu "
              "bytes",
              remaining);
+      c->keepalive = 0;
       return -1;
     }
 
@@ -673,6 +691,14 @@ int connection_queue_output_and_flush(connection_t *c, const uint8_t *data, size
   return 0;
 }
 
+/* Client socket took data: let whatever feeds the connection queue more */
+static void connection_notify_drain(connection_t *c) {
+  if (c->segment_waiting)
+    http_proxy_cache_on_drain(c);
+  else
+    stream_on_client_drain(&c->stream);
+}
+
 connection_write_status_t connection_handle_write(connection_t *c) {
   if (!c)
     return CONNECTION_WRITE_IDLE;
@@ -698,6 +724,7 @@ connection_write_status_t connection_handle_write(connection_t *c) {
 
     if (ret < 0 && ret != -2) {
       c->state = CONN_CLOSING;
+      c->keepalive = 0;
       connection_epoll_update_events(c->epfd, c->fd, POLLER_IN | POLLER_RDHUP | POLLER_HUP | POLLER_ERR);
       connection_report_queue(c);
       return CONNECTION_WRITE_CLOSED;
@@ -707,7 +734,7 @@ connection_write_status_t connection_handle_write(connection_t *c) {
       /* EAGAIN - socket send buffer full, wait for next writable event */
       connection_report_queue(c);
       if (total_sent > 0)
-        stream_on_client_drain(&c->stream);
+        connection_notify_drain(c);
       return CONNECTION_WRITE_BLOCKED;
     }
 
@@ -721,7 +748,7 @@ connection_write_status_t connection_handle_write(connection_t *c) {
        * new buffers in this same call frame, in which case POLLER_OUT must
        * stay armed so the worker re-enters this function to drain them. */
       if (total_sent > 0)
-        stream_on_client_drain(&c->stream);
+        connection_notify_drain(c);
       uint32_t mask = POLLER_IN | POLLER_RDHUP | POLLER_HUP | POLLER_ERR;
       if (c->zc_queue.head)
         mask |= POLLER_OUT;
@@ -738,7 +765,7 @@ connection_write_status_t connection_handle_write(connection_t *c) {
   /* Queue still has data but we couldn't make progress */
   connection_report_queue(c);
   if (total_sent > 0)
-    stream_on_client_drain(&c->stream);
+    connection_notify_drain(c);
   return CONNECTION_WRITE_PENDING;
 }
 
@@ -749,19 +776,25 @@ void connection_handle_read(connection_t *c) {
   /* Read into input buffer.  Loop to drain all available data for
    * edge-triggered pollers (epoll EPOLLET / kqueue EV_CLEAR) where the read event fires
    * only once per data arrival.  This is important for POST requests
-   * with bodies larger than INBUF_SIZE. */
+   * with bodies larger than INBUF_SIZE.  The buffer stays NUL-terminated for
+   * the parser, and a request pipelined behind the previous one may already
+   * be complete in it when the socket has nothing new. */
+  int drained = 0;
   for (;;) {
-    if (c->in_len < INBUF_SIZE) {
-      int r = read(c->fd, c->inbuf + c->in_len, INBUF_SIZE - c->in_len);
+    if (!drained && c->in_len < INBUF_SIZE - 1) {
+      int r = read(c->fd, c->inbuf + c->in_len, INBUF_SIZE - 1 - c->in_len);
       if (r > 0) {
         c->in_len += r;
+        c->inbuf[c->in_len] = '\0';
       } else if (r == 0) {
         c->state = CONN_CLOSING;
+        c->keepalive = 0;
         return;
       } else if (errno == EAGAIN) {
-        return; /* No more data available */
+        drained = 1; /* No more data available */
       } else {
         c->state = CONN_CLOSING;
+        c->keepalive = 0;
         return;
       }
     }
@@ -771,21 +804,84 @@ void connection_handle_read(connection_t *c) {
       int parse_result = http_parse_request(c->inbuf, &c->in_len, &c->http_req);
       if (parse_result == 1) {
         /* Request complete, route it */
+        if (c->requests_served > 0)
+          CONNECTION_STATS_INC(http_keepalive_reuses);
+        CONNECTION_STATS_INC(http_requests);
+        c->requests_served++;
+        c->keepalive = c->http_req.keep_alive && config.http_keepalive_timeout > 0 &&
+                       c->requests_served < (uint32_t)config.http_keepalive_requests &&
+                       strcasecmp(c->http_req.method, "HEAD") != 0;
         c->state = CONN_ROUTE;
         connection_route_and_start(c);
         return;
       } else if (parse_result < 0) {
         /* Parse error */
         c->state = CONN_CLOSING;
+        c->keepalive = 0;
+        return;
+      } else if (c->in_len >= INBUF_SIZE - 1) {
+        /* Request head does not fit the input buffer */
+        c->state = CONN_CLOSING;
+        c->keepalive = 0;
         return;
       }
       /* else parse_result == 0: need more data, keep reading */
+      if (drained)
+        return;
     } else {
       return; /* Not in a request-reading state */
     }
   }
 }
 
+int connection_finish_response(connection_t *c) {
+  /* Nothing was answered (e.g. the request failed before its headers), or
+   * the response cannot be followed by another one */
+  if (!c || !c->keepalive || !c->headers_sent || c->streaming || c->fd < 0)
+    return -1;
+
+  /* Release what the previous request held; buffers, socket and the
+   * zero-copy queue are kept for the next one */
+  if (c->service) {
+    service_free(c->service);
+    c->service = NULL;
+  }
+  if (c->status_index >= 0) {
+    status_unregister_client(c->status_index);
+    c->status_index = -1;
+  }
+  http_request_consume(c->inbuf, &c->in_len, &c->http_req);
+  http_request_cleanup(&c->http_req);
+  http_request_init(&c->http_req);
+  c->headers_sent = 0;
+  c->should_set_r2h_cookie = 0;
+  c->keepalive = 0;
+  c->buffer_class = CONNECTION_BUFFER_CONTROL;
+  c->state = CONN_READ_REQ_LINE;
+  c->idle_since = get_time_ms();
+
+  if (c->in_len > 0)
+    CONNECTION_STATS_INC(http_pipelined);
+
+  /* Parse a pipelined request and pick up anything left unread while the
+   * previous response was being sent */
+  connection_handle_read(c);
+  if (c->state == CONN_CLOSING && !c->zc_queue.head)
+    return -1;
+  return 0;
+}
+
+int connection_check_idle_timeout(connection_t *c, int64_t now) {
+  if (!c || c->requests_served == 0 || (c->state != CONN_READ_REQ_LINE && c->state != CONN_READ_HEADERS))
+    return 0;
+  if (now - c->idle_since < (int64_t)config.http_keepalive_timeout * 1000)
+    return 0;
+
+  logger(LOG_DEBUG, "Closing persistent connection fd=%d after %u requests (idle)", c->fd, c->requests_served);
+  CONNECTION_STATS_INC(http_idle_timeouts);
+  return -1;
+}
+
 int connection_route_and_start(connection_t *c) {
   /* Copy URL and strip $label suffix (UI display tag at URL end) */
   char url_buf[HTTP_URL_BUFFER_SIZE];
@@ -972,7 +1068,14 @@ int connection_route_and_start(connection_t *c) {
     return 0;
   }
 
-  /* Handle /epg.xml and /epg.xml.gz requests */
+  /* Handle /epg.xml and /epg.xml.gz requests; with ?channel= /epg.xml and
+   * /epg.json answer from the programme index instead */
+  const char *epg_json_route = "epg.json";
+  if (strlen(epg_json_route) == path_len && strncmp(service_path, epg_json_route, path_len) == 0) {
+    if (handle_epg_query_request(c, query_start ? query_start + 1 : NULL, 0) < 0)
+      http_send_400(c);
+    return 0;
+  }
   const char *epg_xml_route = "epg.xml";
   const char *epg_xml_gz_route = "epg.xml.gz";
   size_t epg_xml_route_len = strlen(epg_xml_route);
@@ -982,7 +1085,27 @@ int connection_route_and_start(connection_t *c) {
     return 0;
   }
   if (epg_xml_route_len == path_len && strncmp(service_path, epg_xml_route, path_len) == 0) {
-    handle_epg_request(c, 0);
+    if (handle_epg_query_request(c, query_start ? query_start + 1 : NULL, 1) < 0)
+      handle_epg_request(c, 0);
+    return 0;
+  }
+
+  /* Handle /thumbnails.jpg and /thumbnails.json (mosaic of channel thumbnails) */
+  const char *thumbnails_jpg_route = "thumbnails.jpg";
+  const char *thumbnails_json_route = "thumbnails.json";
+  if (strlen(thumbnails_jpg_route) == path_len && strncmp(service_path, thumbnails_jpg_route, path_len) == 0) {
+    thumbnail_handle_request(c, 0);
+    return 0;
+  }
+  if (strlen(thumbnails_json_route) == path_len && strncmp(service_path, thumbnails_json_route, path_len) == 0) {
+    thumbnail_handle_request(c, 1);
+    return 0;
+  }
+
+  /* Handle /metrics (OpenMetrics / Prometheus exposition) */
+  const char *metrics_route = "metrics";
+  if (strlen(metrics_route) == path_len && strncmp(service_path, metrics_route, path_len) == 0) {
+    metrics_handle_request(c);
     return 0;
   }
   size_t status_sse_len = strlen(status_sse_route);
@@ -1160,7 +1283,7 @@ int connection_route_and_start(connection_t *c) {
       snprintf(client_addr_str, sizeof(client_addr_str), "%s", c->http_req.x_forwarded_for);
     }
 
-    c->status_index = status_register_client(client_addr_str, display_url);
+    c->status_index = status_register_client(client_addr_str, display_url, service_type_name(service->service_type));
     if (c->status_index < 0) {
       http_send_503(c);
       service_free(service);
@@ -1172,9 +1295,66 @@ int connection_route_and_start(connection_t *c) {
     c->status_index = -1;
   }
 
+  if (is_snapshot_request) {
+    char cache_key[2 * HTTP_URL_BUFFER_SIZE + 2];
+    char filtered_query[HTTP_URL_BUFFER_SIZE];
+    char key_query[HTTP_URL_BUFFER_SIZE];
+    int key_query_len = 0;
+
+    if (query_start && http_filter_query_param(query_start + 1, "r2h-token", filtered_query,
+                                               sizeof(filtered_query)) > 0)
+      key_query_len = http_filter_query_param(filtered_query, "snapshot", key_query, sizeof(key_query));
+    snprintf(cache_key, sizeof(cache_key), "/%s%s%s", decoded_path, key_query_len > 0 ? "?" : "",
+             key_query_len > 0 ? key_query : "");
+    return connection_start_snapshot(c, service, cache_key, is_snapshot_request);
+  }
+
+  /* HLS segments of a channel are fetched by every client watching it; key
+   * them by what is actually requested upstream */
+  if (service->service_type == SERVICE_HTTP && !service->seek_param_value &&
+      http_proxy_cache_is_eligible(c, service->http_url)) {
+    char cache_key[HTTP_URL_BUFFER_SIZE + IF_NAMESIZE + 16];
+    const char *ifname = get_upstream_interface_for_http(service->ifname);
+    snprintf(cache_key, sizeof(cache_key), "%s|%s", ifname ? ifname : "", service->http_url);
+    return connection_start_segment(c, service, cache_key);
+  }
+
+  return connection_start_stream(c, service, is_snapshot_request);
+}
+
+int connection_start_snapshot(connection_t *c, service_t *service, const char *cache_key, int is_snapshot_request) {
+  c->service = service;
+  snapshot_cache_result_t result = snapshot_cache_attach(c, cache_key, is_snapshot_request);
+  if (result != SNAPSHOT_CACHE_MISS) {
+    /* Only a JPEG answered from the cache leaves the connection reusable */
+    if (result == SNAPSHOT_CACHE_WAITING)
+      c->keepalive = 0;
+    return 0; /* A waiter keeps c->service until its capture completes */
+  }
+  c->service = NULL;
+  return connection_start_stream(c, service, is_snapshot_request);
+}
+
+int connection_start_segment(connection_t *c, service_t *service, const char *cache_key) {
+  c->service = service;
+  http_proxy_cache_result_t result = http_proxy_cache_attach(c, cache_key);
+  if (result != HTTP_PROXY_CACHE_MISS) {
+    /* Only a segment answered from the cache leaves the connection reusable */
+    if (result == HTTP_PROXY_CACHE_WAITING)
+      c->keepalive = 0;
+    return 0; /* A waiter keeps c->service until the download completes */
+  }
+  c->service = NULL;
+  return connection_start_stream(c, service, 0);
+}
+
+int connection_start_stream(connection_t *c, service_t *service, int is_snapshot_request) {
   /* Headers will be sent lazily when first data is ready (or 503 on timeout) */
   /* Snapshots send JPEG headers after conversion */
 
+  /* Streams end by closing the connection */
+  c->keepalive = 0;
+
   /* Initialize stream in unified epoll (works for both streaming and snapshot)
    */
   if (stream_context_init_for_worker(&c->stream, c, service, c->epfd, c->status_index, is_snapshot_request) == 0) {
@@ -1257,8 +1437,10 @@ int connection_queue_file(connection_t *c, int file_fd, off_t file_offset, size_
 
   /* Add file to zero-copy queue */
   int ret = zerocopy_queue_add_file(&c->zc_queue, file_fd, file_offset, file_size);
-  if (ret < 0)
+  if (ret < 0) {
+    c->keepalive = 0;
     return -1;
+  }
 
   /* Always flush immediately for file sends (no batching) */
   connection_epoll_update_events(c->epfd, c->fd, POLLER_IN | POLLER_OUT | POLLER_RDHUP | POLLER_HUP | POLLER_ERR);
@@ -1269,11 +1451,11 @@ int connection_queue_file(connection_t *c, int file_fd, off_t file_offset, size_
   return 0;
 }
 
-/* Handle /playlist.m3u request - serve dynamically generated M3U playlist */
+/* Handle /playlist.m3u request - serve the playlist rendered for this
+ * request's base URL, reusing the event loop's cached rendering */
 static void handle_playlist_request(connection_t *c) {
-  char *playlist = NULL;
-  size_t playlist_len;
-  char extra_headers[512];
+  int playlist_fd;
+  size_t playlist_size;
   const char *etag;
 
   if (!c)
@@ -1287,25 +1469,94 @@ static void handle_playlist_request(connection_t *c) {
     return;
   }
 
-  /* Generate complete playlist dynamically */
-  playlist = m3u_generate_playlist(c->http_req.hostname, c->http_req.x_forwarded_host, c->http_req.x_forwarded_proto);
-
-  if (!playlist) {
-    /* No playlist available or generation failed */
+  if (m3u_open_rendered_playlist(c->http_req.hostname, c->http_req.x_forwarded_host, c->http_req.x_forwarded_proto,
+                                 &playlist_fd, &playlist_size) < 0) {
+    /* No playlist available or rendering failed */
     http_send_404(c);
     return;
   }
 
-  playlist_len = strlen(playlist);
+  /* Send the rendered file, honouring Range (closes the fd) */
+  http_send_file(c, playlist_fd, playlist_size, "audio/x-mpegurl", etag, NULL);
+}
+
+/* Write a rendered query answer to an unlinked temporary file */
+static int write_epg_query_file(const char *data, size_t len) {
+  char temp_file_template[] = "/tmp/rtp2httpd_epg_query_XXXXXX";
+  size_t written = 0;
+  int fd = mkstemp(temp_file_template);
+
+  if (fd < 0) {
+    logger(LOG_ERROR, "Failed to create temporary file for EPG query: %s", strerror(errno));
+    return -1;
+  }
+  unlink(temp_file_template);
+
+  while (written < len) {
+    ssize_t n = write(fd, data + written, len - written);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      logger(LOG_ERROR, "Failed to write EPG query answer: %s", strerror(errno));
+      close(fd);
+      return -1;
+    }
+    written += (size_t)n;
+  }
+  return fd;
+}
+
+/* Handle /epg.json or /epg.xml?channel= request - answer from the EPG
+ * programme index
+ * Parameters: channel (comma-separated ids or display names, required),
+ * start / end (Unix seconds, default now), next (following programmes)
+ * Returns -1 without responding if no channel was given
+ */
+static int handle_epg_query_request(connection_t *c, const char *query, int as_xml) {
+  char channels[2048];
+  char value[32];
+  int64_t start = get_realtime_ms() / 1000;
+  int64_t end;
+  int next = 0;
+  size_t body_len;
+  const char *content_type = as_xml ? "application/xml" : "application/json";
+
+  if (!query || http_parse_query_param(query, "channel", channels, sizeof(channels)) < 0 || channels[0] == '\0')
+    return -1;
+
+  epg_cache_t *epg = epg_get_cache();
+  if (!epg->index) {
+    http_send_404(c);
+    return 0;
+  }
 
-  /* Build headers with ETag support */
-  http_build_etag_headers(extra_headers, sizeof(extra_headers), playlist_len, etag, NULL);
+  if (http_parse_query_param(query, "start", value, sizeof(value)) == 0)
+    start = strtoll(value, NULL, 10);
+  end = start;
+  if (http_parse_query_param(query, "end", value, sizeof(value)) == 0)
+    end = strtoll(value, NULL, 10);
+  if (end > start && end - start > EPG_QUERY_MAX_WINDOW)
+    end = start + EPG_QUERY_MAX_WINDOW;
+  if (http_parse_query_param(query, "next", value, sizeof(value)) == 0) {
+    next = atoi(value);
+    if (next < 0)
+      next = 0;
+    if (next > EPG_QUERY_MAX_NEXT)
+      next = EPG_QUERY_MAX_NEXT;
+  }
 
-  send_http_headers(c, STATUS_200, "audio/x-mpegurl", extra_headers);
-  connection_queue_output_and_flush(c, (const uint8_t *)playlist, playlist_len);
+  char *body = epg_index_query(epg->index, channels, start, end, next, as_xml, &body_len);
+  int fd = body ? write_epg_query_file(body, body_len) : -1;
+  free(body);
+  if (fd < 0) {
+    http_send_500(c);
+    return 0;
+  }
 
-  /* Free the dynamically generated playlist */
-  free(playlist);
+  /* Sent from a file: a wide query can exceed what the control buffer
+   * pool holds at once */
+  http_send_file(c, fd, body_len, content_type, NULL, "Cache-Control: no-cache");
+  return 0;
 }
 
 /* Handle /epg.xml or /epg.xml.gz request - serve cached EPG data
@@ -1363,22 +1614,9 @@ static void handle_epg_request(connection_t *c, int requested_gz) {
     }
   }
 
-  /* Check ETag and send 304 if it matches */
-  if (http_check_etag_and_send_304(c, etag, content_type)) {
-    return;
-  }
-
-  /* ETag doesn't match or not provided - send full EPG data */
-  char extra_headers[256];
-
-  /* Build headers with ETag support */
-  http_build_etag_headers(extra_headers, sizeof(extra_headers), epg_size, etag, content_encoding);
-
-  send_http_headers(c, STATUS_200, content_type, extra_headers);
-
-  /* Use zero-copy transmission via sendfile
+  /* Send the cached file, honouring conditional and range requests
    * Note: epg_fd is owned by EPG cache, so we need to dup it
-   * zerocopy_queue_add_file will close the fd when done */
+   * http_send_file will close the fd when done */
   int dup_fd = dup(epg_fd);
   if (dup_fd < 0) {
     logger(LOG_ERROR, "Failed to dup EPG fd for zero-copy transmission: %s", strerror(errno));
@@ -1386,11 +1624,5 @@ static void handle_epg_request(connection_t *c, int requested_gz) {
     return;
   }
 
-  /* Queue the file for zero-copy transmission */
-  if (connection_queue_file(c, dup_fd, 0, epg_size) < 0) {
-    logger(LOG_ERROR, "Failed to queue EPG file for zero-copy transmission");
-    close(dup_fd);
-    c->state = CONN_CLOSING;
-    return;
-  }
+  http_send_file(c, dup_fd, epg_size, content_type, etag, content_encoding);
 }
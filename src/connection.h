@@ -20,6 +20,10 @@ typedef enum {
 
 #define INBUF_SIZE 8192
 
+/* Upper bounds for the http-keepalive-timeout / http-keepalive-requests options */
+#define CONNECTION_KEEPALIVE_TIMEOUT_MAX 3600
+#define CONNECTION_KEEPALIVE_REQUESTS_MAX 100000
+
 typedef enum { CONNECTION_BUFFER_CONTROL = 0, CONNECTION_BUFFER_MEDIA = 1 } connection_buffer_class_t;
 
 typedef struct connection_s {
@@ -41,10 +45,10 @@ typedef struct connection_s {
   stream_context_t stream;
   int streaming;
   /* SSE */
-  int64_t next_sse_ts; /* Next SSE heartbeat time in milliseconds */
-  int sse_sent_initial;
-  uint32_t sse_last_log_epoch;
-  uint32_t sse_last_log_sequence;
+  int64_t next_sse_ts;                /* Next SSE refresh time in milliseconds */
+  int64_t sse_last_sent;              /* Time of the last SSE event in milliseconds */
+  int sse_pending;                    /* An update was coalesced and is still to be sent */
+  struct status_sse_view_s *sse_view; /* What the stream last reported (status.c) */
   /* status tracking */
   int status_index; /* Index in status_shared->clients array, -1 if not
                        registered */
@@ -75,9 +79,18 @@ typedef struct connection_s {
    * its reads due to client-side backpressure.  Lets the per-write notify
    * fast-path skip cheaply when no upstream is paused (the common case). */
   int any_upstream_paused;
+  /* Receiving an HLS segment another connection is downloading; each
+   * drained send queue is refilled from the segment file */
+  int segment_waiting;
   /* r2h-token Set-Cookie flag: set cookie when token was provided via URL
      query */
   int should_set_r2h_cookie;
+  /* HTTP keep-alive: the current response leaves the connection open for the
+   * next request.  Cleared for streams, SSE and any response that cannot be
+   * delimited or was cut short. */
+  int keepalive;
+  uint32_t requests_served; /* Requests parsed on this connection */
+  int64_t idle_since;       /* When the connection started waiting for its next request (ms) */
 } connection_t;
 
 typedef enum {
@@ -115,6 +128,23 @@ void connection_handle_read(connection_t *c);
  */
 connection_write_status_t connection_handle_write(connection_t *c);
 
+/**
+ * Called once the response of a CONN_CLOSING connection has been sent.  A
+ * persistent connection is reset in place for its next request, which is
+ * parsed straight away if it was pipelined behind the previous one.
+ * @param c Connection
+ * @return 0 if the connection stays open, -1 if it should be closed
+ */
+int connection_finish_response(connection_t *c);
+
+/**
+ * Idle timeout for persistent connections waiting for their next request
+ * @param c Connection
+ * @param now Current time in milliseconds
+ * @return -1 if the connection idled out and should be closed, 0 otherwise
+ */
+int connection_check_idle_timeout(connection_t *c, int64_t now);
+
 /**
  * Route HTTP request and start appropriate handler
  * @param c Connection
@@ -122,6 +152,37 @@ connection_write_status_t connection_handle_write(connection_t *c);
  */
 int connection_route_and_start(connection_t *c);
 
+/**
+ * Start streaming (or snapshot capture) of a resolved service
+ * On failure a 503 is sent and the service is freed
+ * @param c Connection
+ * @param service Service to stream (ownership transferred)
+ * @param is_snapshot_request Snapshot mode (0 = normal streaming)
+ * @return 0 on success, -1 on error
+ */
+int connection_start_stream(connection_t *c, service_t *service, int is_snapshot_request);
+
+/**
+ * Answer a snapshot request from the channel's cached JPEG, attach it to a
+ * capture already running for the channel, or start capturing
+ * @param c Connection
+ * @param service Service to capture (ownership transferred)
+ * @param cache_key Channel identity for the snapshot cache
+ * @param is_snapshot_request Snapshot mode (1 = snapshot=1, 2 = header based)
+ * @return 0 on success, -1 on error
+ */
+int connection_start_snapshot(connection_t *c, service_t *service, const char *cache_key, int is_snapshot_request);
+
+/**
+ * Answer an HLS segment request from the segment cache, attach it to a
+ * download already running for the same upstream URL, or proxy it
+ * @param c Connection
+ * @param service HTTP proxy service (ownership transferred)
+ * @param cache_key Upstream interface and URL for the segment cache
+ * @return 0 on success, -1 on error
+ */
+int connection_start_segment(connection_t *c, service_t *service, const char *cache_key);
+
 /**
  * Set socket to non-blocking mode
  * @param fd File descriptor
@@ -0,0 +1,305 @@
+#include "cpu_affinity.h"
+#include "configuration.h"
+#include "rtp2httpd.h"
+#include "status.h"
+#include "utils.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#include <sched.h>
+#endif
+
+/* CPU this event loop is pinned to, -1 when unpinned */
+static _Thread_local int pinned_cpu = -1;
+static _Thread_local uint32_t rx_sample_tick = 0;
+
+static worker_stats_t *cpu_stats_slot(void) {
+  if (!status_shared || worker_id < 0 || worker_id >= STATUS_MAX_WORKERS)
+    return NULL;
+  return &status_shared->worker_stats[worker_id];
+}
+
+static int cpu_affinity_add(cpu_affinity_set_t *set, long cpu) {
+  if (cpu < 0 || cpu >= CPU_AFFINITY_MAX_CPUS)
+    return -1;
+  for (int i = 0; i < set->count; i++) {
+    if (set->cpus[i] == (int)cpu)
+      return 0;
+  }
+  set->cpus[set->count++] = (int)cpu;
+  return 0;
+}
+
+static int cpu_affinity_parse_auto(cpu_affinity_set_t *set) {
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE && cpu < CPU_AFFINITY_MAX_CPUS; cpu++) {
+      if (CPU_ISSET(cpu, &mask))
+        cpu_affinity_add(set, cpu);
+    }
+    return set->count > 0 ? 0 : -1;
+  }
+#endif
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  if (online < 1)
+    return -1;
+  for (long cpu = 0; cpu < online && cpu < CPU_AFFINITY_MAX_CPUS; cpu++)
+    cpu_affinity_add(set, cpu);
+  return 0;
+}
+
+int cpu_affinity_parse(const char *spec, cpu_affinity_set_t *set) {
+  const char *p = spec;
+
+  if (!spec || !set)
+    return -1;
+  set->count = 0;
+
+  while (*p && isspace((unsigned char)*p))
+    p++;
+  if (strncasecmp(p, "auto", 4) == 0) {
+    const char *rest = p + 4;
+    while (*rest && isspace((unsigned char)*rest))
+      rest++;
+    if (*rest == '\0')
+      return cpu_affinity_parse_auto(set);
+  }
+
+  while (*p) {
+    char *endptr = NULL;
+    long start;
+    long end;
+
+    while (*p && isspace((unsigned char)*p))
+      p++;
+    if (!isdigit((unsigned char)*p))
+      return -1;
+    start = strtol(p, &endptr, 10);
+    end = start;
+    p = endptr;
+    while (*p && isspace((unsigned char)*p))
+      p++;
+
+    if (*p == '-') {
+      p++;
+      while (*p && isspace((unsigned char)*p))
+        p++;
+      if (!isdigit((unsigned char)*p))
+        return -1;
+      end = strtol(p, &endptr, 10);
+      p = endptr;
+      while (*p && isspace((unsigned char)*p))
+        p++;
+    }
+
+    if (end < start || start >= CPU_AFFINITY_MAX_CPUS || end >= CPU_AFFINITY_MAX_CPUS)
+      return -1;
+    for (long cpu = start; cpu <= end; cpu++)
+      cpu_affinity_add(set, cpu);
+
+    if (*p == ',')
+      p++;
+    else if (*p != '\0')
+      return -1;
+  }
+
+  return set->count > 0 ? 0 : -1;
+}
+
+/* CPU assigned to worker_index by the configured list, or -1 */
+static int cpu_affinity_cpu_for_worker(const cpu_affinity_set_t *set, int worker_index) {
+  if (set->count == 0 || worker_index < 0)
+    return -1;
+  return set->cpus[worker_index % set->count];
+}
+
+int cpu_affinity_resolve(cpu_affinity_set_t *set) {
+  set->count = 0;
+  if (!config.worker_cpu_affinity)
+    return 0;
+  if (cpu_affinity_parse(config.worker_cpu_affinity, set) < 0) {
+    logger(LOG_ERROR, "Invalid worker-cpu-affinity value: %s", config.worker_cpu_affinity);
+    set->count = 0;
+    return -1;
+  }
+  return 0;
+}
+
+int cpu_affinity_pin_worker(const cpu_affinity_set_t *set, int worker_index) {
+  worker_stats_t *stats = cpu_stats_slot();
+
+  pinned_cpu = -1;
+  if (stats)
+    stats->cpu_affinity = -1;
+
+  int cpu = cpu_affinity_cpu_for_worker(set, worker_index);
+  if (cpu < 0)
+    return -1;
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  /* pid 0 targets the calling thread, so each worker thread pins itself */
+  if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+    logger(LOG_WARN, "Failed to pin worker %d to CPU %d: %s", worker_index, cpu, strerror(errno));
+    return -1;
+  }
+  pinned_cpu = cpu;
+  if (stats)
+    stats->cpu_affinity = cpu;
+  logger(LOG_INFO, "Worker %d pinned to CPU %d", worker_index, cpu);
+  return cpu;
+#else
+  logger(LOG_WARN, "worker-cpu-affinity is not supported on this platform, worker %d not pinned (CPU %d)", worker_index,
+         cpu);
+  return -1;
+#endif
+}
+
+int cpu_affinity_worker_cpu(void) { return pinned_cpu; }
+
+void cpu_affinity_set_incoming_cpu(int sock) {
+#ifdef SO_INCOMING_CPU
+  if (pinned_cpu < 0 || sock < 0)
+    return;
+  if (setsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &pinned_cpu, sizeof(pinned_cpu)) < 0)
+    logger(LOG_DEBUG, "SO_INCOMING_CPU failed: %s", strerror(errno));
+#else
+  (void)sock;
+#endif
+}
+
+int cpu_affinity_attach_reuseport_steering(int sock, const cpu_affinity_set_t *set) {
+  static int process_mode_warned = 0;
+
+  if (!config.reuseport_cpu_steering || set->count == 0)
+    return 0;
+
+  /* The program maps listener index N to worker N.  Only worker threads
+   * open their listeners in worker order; worker processes bind in whatever
+   * order they are scheduled, and a restarted one is appended at the end of
+   * the reuseport group, so steering would pick the wrong worker. */
+  if (!config.worker_threads) {
+    if (worker_id == 0 && !process_mode_warned) {
+      logger(LOG_WARN, "reuseport-cpu-steering requires worker-threads mode, ignored");
+      process_mode_warned = 1;
+    }
+    return 0;
+  }
+
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  int workers = config.workers;
+  struct sock_filter code[2 * STATUS_MAX_WORKERS + 2];
+  int len = 0;
+  int mapped_cpus[STATUS_MAX_WORKERS];
+  int mapped = 0;
+
+  if (workers > STATUS_MAX_WORKERS)
+    workers = STATUS_MAX_WORKERS;
+
+  /* A = CPU that handled the SYN; listener index N belongs to worker thread N */
+  code[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU));
+  for (int w = 0; w < workers; w++) {
+    int cpu = cpu_affinity_cpu_for_worker(set, w);
+    int seen = 0;
+    for (int i = 0; i < mapped; i++) {
+      if (mapped_cpus[i] == cpu)
+        seen = 1;
+    }
+    if (seen)
+      continue;
+    mapped_cpus[mapped++] = cpu;
+    code[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)cpu, 0, 1);
+    code[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, (uint32_t)w);
+  }
+  /* Out-of-range index: the kernel falls back to hash selection */
+  code[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xffffffffU);
+
+  struct sock_fprog prog = {.len = (unsigned short)len, .filter = code};
+  if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+    logger(LOG_WARN, "SO_ATTACH_REUSEPORT_CBPF failed: %s", strerror(errno));
+    return -1;
+  }
+  return 0;
+#else
+  (void)sock;
+  logger(LOG_WARN, "reuseport-cpu-steering is not supported on this platform");
+  return -1;
+#endif
+}
+
+/* CPU the kernel last processed packets for sock on, or -1 */
+static int cpu_affinity_socket_cpu(int sock) {
+#ifdef SO_INCOMING_CPU
+  int cpu = -1;
+  socklen_t len = sizeof(cpu);
+  if (getsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0)
+    return -1;
+  return cpu;
+#else
+  (void)sock;
+  return -1;
+#endif
+}
+
+/* CPU the calling event loop runs on (its pinned CPU when pinned), or -1 */
+static int cpu_affinity_running_cpu(void) {
+  if (pinned_cpu >= 0)
+    return pinned_cpu;
+#ifdef __linux__
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+void cpu_affinity_note_accept(int cfd) {
+  worker_stats_t *stats = cpu_stats_slot();
+  if (!stats)
+    return;
+
+  stats->accepts++;
+  int rx_cpu = cpu_affinity_socket_cpu(cfd);
+  int cpu = cpu_affinity_running_cpu();
+  if (rx_cpu >= 0 && cpu >= 0 && rx_cpu != cpu)
+    stats->cross_cpu_accepts++;
+}
+
+void cpu_affinity_sample_rx(int sock) {
+  if (++rx_sample_tick < CPU_AFFINITY_RX_SAMPLE_INTERVAL)
+    return;
+  rx_sample_tick = 0;
+
+  worker_stats_t *stats = cpu_stats_slot();
+  if (!stats)
+    return;
+
+  int rx_cpu = cpu_affinity_socket_cpu(sock);
+  int cpu = cpu_affinity_running_cpu();
+  if (rx_cpu < 0 || cpu < 0)
+    return;
+  stats->rx_samples++;
+  if (rx_cpu != cpu)
+    stats->cross_cpu_rx_samples++;
+}
+
+void cpu_affinity_update_stats(void) {
+  worker_stats_t *stats = cpu_stats_slot();
+  if (!stats)
+    return;
+#ifdef __linux__
+  stats->current_cpu = sched_getcpu();
+#else
+  stats->current_cpu = -1;
+#endif
+}
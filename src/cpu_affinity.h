@@ -0,0 +1,74 @@
+#ifndef __CPU_AFFINITY_H__
+#define __CPU_AFFINITY_H__
+
+/* Upper bound on CPUs accepted in a worker-cpu-affinity list */
+#define CPU_AFFINITY_MAX_CPUS 256
+
+/* One out of this many upstream datagram reads samples SO_INCOMING_CPU */
+#define CPU_AFFINITY_RX_SAMPLE_INTERVAL 1024
+
+typedef struct {
+  int count;
+  int cpus[CPU_AFFINITY_MAX_CPUS];
+} cpu_affinity_set_t;
+
+/**
+ * Parse a worker-cpu-affinity value.
+ *
+ * Accepts "auto" (every CPU the process may run on) or a comma separated
+ * list of CPUs and ranges such as "0-3,6".  Duplicates are dropped, order is
+ * kept: worker N is placed on the (N mod count)-th CPU of the list.
+ *
+ * @return 0 on success, -1 if the value is malformed or names no CPU
+ */
+int cpu_affinity_parse(const char *spec, cpu_affinity_set_t *set);
+
+/**
+ * Resolve config.worker_cpu_affinity into the CPU list workers are placed on.
+ * "auto" reads the calling thread's affinity mask, so this must run before
+ * any event loop is pinned (the supervisor does it before starting workers).
+ *
+ * @return 0 on success (set->count is 0 when pinning is disabled), -1 if the
+ *         value is malformed
+ */
+int cpu_affinity_resolve(cpu_affinity_set_t *set);
+
+/**
+ * Pin the calling event loop to the CPU assigned to worker_index by the
+ * resolved CPU list and publish the placement in worker stats.
+ * Safe to call from worker threads; only the calling thread is pinned.
+ *
+ * @return pinned CPU, or -1 when pinning is disabled or failed
+ */
+int cpu_affinity_pin_worker(const cpu_affinity_set_t *set, int worker_index);
+
+/** CPU the calling event loop is pinned to, or -1 */
+int cpu_affinity_worker_cpu(void);
+
+/**
+ * Hint the kernel to process this socket's packets on the worker's CPU
+ * (SO_INCOMING_CPU).  No-op when the worker is not pinned.
+ */
+void cpu_affinity_set_incoming_cpu(int sock);
+
+/**
+ * Attach the reuseport steering program to a listening socket: connections
+ * whose SYN was handled on a pinned worker's CPU go to that worker's listener,
+ * anything else falls back to the kernel's hash selection.  Only attached in
+ * worker-threads mode, where listeners are opened in worker order.
+ *
+ * @param set CPU list resolved by cpu_affinity_resolve()
+ * @return 0 on success or when steering is disabled, -1 on error
+ */
+int cpu_affinity_attach_reuseport_steering(int sock, const cpu_affinity_set_t *set);
+
+/** Account an accepted client socket in the cross-CPU statistics */
+void cpu_affinity_note_accept(int cfd);
+
+/** Periodically sample SO_INCOMING_CPU on an upstream datagram socket */
+void cpu_affinity_sample_rx(int sock);
+
+/** Refresh the CPU this worker currently runs on in worker stats */
+void cpu_affinity_update_stats(void);
+
+#endif /* __CPU_AFFINITY_H__ */
@@ -4,6 +4,7 @@
 #include "hashmap.h"
 #include "http.h"
 #include "utils.h"
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,6 +14,9 @@
 /* Static hashmap for O(1) embedded file lookup */
 static struct hashmap *embedded_files_map = NULL;
 
+/* Guards lazy initialization when worker threads share the map */
+static pthread_once_t embedded_files_once = PTHREAD_ONCE_INIT;
+
 /**
  * Hash function for embedded file paths
  */
@@ -72,11 +76,9 @@ static const embedded_file_t *find_embedded_file(const char *path) {
     return NULL;
 
   /* Lazy initialization of hashmap */
-  if (!embedded_files_map) {
-    init_embedded_files_map();
-    if (!embedded_files_map)
-      return NULL; /* Initialization failed */
-  }
+  pthread_once(&embedded_files_once, init_embedded_files_map);
+  if (!embedded_files_map)
+    return NULL; /* Initialization failed */
 
   /* Create temporary key for lookup */
   embedded_file_t key = {.path = path};
@@ -1,8 +1,11 @@
 #include "epg.h"
 #include "http_fetch.h"
 #include "md5.h"
+#include "rtp2httpd.h"
 #include "utils.h"
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +15,28 @@
 /* Global EPG cache */
 static epg_cache_t epg_cache = {.data_fd = -1};
 
+/* Background index build.  Parsing a large guide takes a noticeable time, so
+ * it runs on a helper thread while queries keep using the previous index;
+ * the event loop swaps the finished one in.  One build runs at a time, a
+ * newer request replaces a queued one, and a result whose generation is
+ * outdated (cleanup, restore) is dropped. */
+typedef struct {
+  pthread_mutex_t lock;
+  int running;          /* Builder thread alive */
+  int request_fd;       /* Duplicate of the data to index next, -1 if none */
+  size_t request_size;  /* Size of that data */
+  int request_gzipped;  /* 1 if that data is gzip compressed */
+  unsigned generation;  /* Bumped whenever pending results become stale */
+  epg_index_t *pending; /* Finished index waiting to be published */
+  char report[256];     /* Outcome of the finished build, logged by the event loop */
+  atomic_int ready;     /* A build finished: report (and pending, if it succeeded) is set */
+} epg_index_builder_t;
+
+static epg_index_builder_t index_builder = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .request_fd = -1,
+};
+
 /* Retry delays in seconds: 2, 4, 8, 16, 32, 64, 128, 256 */
 static const int retry_delays[] = {2, 4, 8, 16, 32, 64, 128, 256};
 #define EPG_MAX_RETRY_COUNT 8
@@ -82,11 +107,132 @@ static void calculate_epg_etag(int fd, size_t size) {
   logger(LOG_DEBUG, "EPG ETag calculated: %s", epg_cache.etag);
 }
 
+/* Runs without a worker_id: the worker's log ring has a single writer, the
+ * event loop, so the outcome is handed back in report instead of logged */
+static void *epg_index_builder_main(void *arg) {
+  char report[sizeof(index_builder.report)];
+  (void)arg;
+
+  pthread_mutex_lock(&index_builder.lock);
+  while (index_builder.request_fd >= 0) {
+    int fd = index_builder.request_fd;
+    size_t size = index_builder.request_size;
+    int is_gzipped = index_builder.request_gzipped;
+    unsigned generation = index_builder.generation;
+    index_builder.request_fd = -1;
+    pthread_mutex_unlock(&index_builder.lock);
+
+    epg_index_t *index = epg_index_build(fd, size, is_gzipped, report, sizeof(report));
+    close(fd);
+
+    pthread_mutex_lock(&index_builder.lock);
+    if (generation == index_builder.generation) {
+      if (index) {
+        epg_index_free(index_builder.pending);
+        index_builder.pending = index;
+      }
+      memcpy(index_builder.report, report, sizeof(report));
+      atomic_store(&index_builder.ready, 1);
+    } else {
+      epg_index_free(index);
+    }
+  }
+  index_builder.running = 0;
+  pthread_mutex_unlock(&index_builder.lock);
+  return NULL;
+}
+
+/* Queue the cached data for indexing on the builder thread; the current
+ * index stays in use until epg_publish_index() swaps the new one in */
+static void request_epg_index(void) {
+  if (epg_cache.data_fd < 0 || epg_cache.data_size == 0)
+    return;
+
+  int fd = dup(epg_cache.data_fd);
+  if (fd < 0) {
+    logger(LOG_ERROR, "EPG index: Failed to duplicate EPG data fd: %s", strerror(errno));
+    return;
+  }
+
+  pthread_mutex_lock(&index_builder.lock);
+  if (index_builder.request_fd >= 0)
+    close(index_builder.request_fd);
+  index_builder.request_fd = fd;
+  index_builder.request_size = epg_cache.data_size;
+  index_builder.request_gzipped = epg_cache.is_gzipped;
+  index_builder.generation++;
+  if (!index_builder.running) {
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, epg_index_builder_main, NULL) == 0) {
+      index_builder.running = 1;
+    } else {
+      logger(LOG_ERROR, "EPG index: Failed to start builder thread");
+      close(index_builder.request_fd);
+      index_builder.request_fd = -1;
+    }
+    pthread_attr_destroy(&attr);
+  }
+  pthread_mutex_unlock(&index_builder.lock);
+}
+
+/* Drop queued and finished builds, they no longer match the cache */
+static void discard_pending_epg_index(void) {
+  pthread_mutex_lock(&index_builder.lock);
+  index_builder.generation++;
+  if (index_builder.request_fd >= 0) {
+    close(index_builder.request_fd);
+    index_builder.request_fd = -1;
+  }
+  epg_index_free(index_builder.pending);
+  index_builder.pending = NULL;
+  index_builder.report[0] = '\0';
+  atomic_store(&index_builder.ready, 0);
+  pthread_mutex_unlock(&index_builder.lock);
+}
+
+int epg_index_pending(void) { return atomic_load(&index_builder.ready); }
+
+void epg_publish_index(void) {
+  epg_index_t *old = NULL;
+  char report[sizeof(index_builder.report)];
+  int published = 0;
+
+  if (!atomic_load(&index_builder.ready))
+    return;
+
+  pthread_mutex_lock(&index_builder.lock);
+  if (index_builder.pending) {
+    old = epg_cache.index;
+    epg_cache.index = index_builder.pending;
+    index_builder.pending = NULL;
+    published = 1;
+  }
+  memcpy(report, index_builder.report, sizeof(report));
+  index_builder.report[0] = '\0';
+  atomic_store(&index_builder.ready, 0);
+  pthread_mutex_unlock(&index_builder.lock);
+
+  if (report[0])
+    logger(published ? LOG_INFO : LOG_ERROR, "%s", report);
+  epg_index_free(old);
+}
+
 /* Async fetch completion callback (fd-based, zero-copy) */
 static void epg_fetch_fd_callback(http_fetch_ctx_t *ctx, int fd, size_t content_size, void *user_data) {
-  (void)ctx;       /* Unused */
   (void)user_data; /* Unused */
 
+  if (fd < 0 && http_fetch_not_modified(ctx)) {
+    /* Keep serving the cached data */
+    epg_cache.fetch_error_count = 0;
+    epg_cache.retry_count = 0;
+    epg_cache.next_retry_time = 0;
+    logger(LOG_INFO, "EPG not modified, keeping cached data (%zu bytes)", epg_cache.data_size);
+    return;
+  }
+
   if (fd < 0) {
     epg_cache.fetch_error_count++;
 
@@ -129,6 +275,8 @@ static void epg_fetch_fd_callback(http_fetch_ctx_t *ctx, int fd, size_t content_
   /* Calculate ETag for the fetched data */
   calculate_epg_etag(fd, content_size);
 
+  request_epg_index();
+
   logger(LOG_INFO, "EPG data cached: %zu bytes, fd=%d (%s), ETag=%s", content_size, fd,
          epg_cache.is_gzipped ? "gzipped" : "uncompressed", epg_cache.etag_valid ? epg_cache.etag : "none");
 }
@@ -142,6 +290,9 @@ void epg_cleanup(void) {
     close(epg_cache.data_fd);
     epg_cache.data_fd = -1;
   }
+  discard_pending_epg_index();
+  epg_index_free(epg_cache.index);
+  epg_cache.index = NULL;
   epg_cache.data_size = 0;
   epg_cache.is_gzipped = 0;
   epg_cache.fetch_error_count = 0;
@@ -149,6 +300,7 @@ void epg_cleanup(void) {
   epg_cache.etag[0] = '\0';
   epg_cache.retry_count = 0;
   epg_cache.next_retry_time = 0;
+  http_fetch_validators_reset(&epg_cache.fetch_validators);
   logger(LOG_DEBUG, "EPG cache cleaned up");
 }
 
@@ -159,6 +311,7 @@ int epg_cache_snapshot(epg_cache_t *snapshot) {
   *snapshot = epg_cache;
   snapshot->url = NULL;
   snapshot->data_fd = -1;
+  snapshot->index = NULL;
 
   if (epg_cache.url) {
     snapshot->url = strdup(epg_cache.url);
@@ -177,6 +330,9 @@ int epg_cache_snapshot(epg_cache_t *snapshot) {
     }
   }
 
+  /* The index moves into the snapshot, so restoring it needs no rebuild */
+  snapshot->index = epg_cache.index;
+  epg_cache.index = NULL;
   return 0;
 }
 
@@ -192,6 +348,7 @@ void epg_cache_snapshot_free(epg_cache_t *snapshot) {
     close(snapshot->data_fd);
     snapshot->data_fd = -1;
   }
+  epg_index_free(snapshot->index);
   memset(snapshot, 0, sizeof(*snapshot));
   snapshot->data_fd = -1;
 }
@@ -261,7 +418,8 @@ int epg_fetch_async(int epfd) {
   /* Start async fetch with fd-based callback (zero-copy)
    * Note: file:// URLs complete synchronously and return NULL (callback already
    * invoked) */
-  fetch_ctx = http_fetch_start_async_fd(epg_cache.url, epg_fetch_fd_callback, NULL, epfd);
+  fetch_ctx = http_fetch_start_async_fd(epg_cache.url, epg_cache.data_fd >= 0 ? &epg_cache.fetch_validators : NULL,
+                                        epg_fetch_fd_callback, NULL, epfd);
 
   /* NULL return value can mean:
    * 1. file:// URL completed synchronously (callback already called) - SUCCESS
@@ -1,6 +1,8 @@
 #ifndef __EPG_H__
 #define __EPG_H__
 
+#include "epg_index.h"
+#include "http_fetch.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -16,6 +18,14 @@ typedef struct {
   int etag_valid;          /* 1 if etag is valid, 0 otherwise */
   int retry_count;         /* Current retry count (0-8) */
   int64_t next_retry_time; /* Next retry time in milliseconds (0 if not retrying) */
+
+  /* Validators of data_fd, so an unchanged EPG is not downloaded again */
+  http_fetch_validators_t fetch_validators;
+
+  /* Programme index for /epg.json queries, NULL if not built.  Built off the
+   * event loop: after a fetch it may still describe the previous data until
+   * epg_publish_index() swaps the new one in */
+  epg_index_t *index;
 } epg_cache_t;
 
 /* Cleanup EPG cache
@@ -23,7 +33,7 @@ typedef struct {
 void epg_cleanup(void);
 
 /* Create a restorable snapshot of the EPG cache.
- * Duplicates the cached data fd if present.
+ * Duplicates the cached data fd if present and moves the programme index.
  * Returns 0 on success, -1 on allocation or fd duplication failure.
  */
 int epg_cache_snapshot(epg_cache_t *snapshot);
@@ -48,6 +58,17 @@ int epg_set_url(const char *url);
  */
 int epg_fetch_async(int epfd);
 
+/* Whether a programme index finished building and awaits publishing
+ * (safe to call without holding the shared state lock)
+ */
+int epg_index_pending(void);
+
+/* Make a finished programme index current and log how the build went.
+ * Replaces epg_get_cache()->index, so in threaded mode the caller holds the
+ * shared state write lock.
+ */
+void epg_publish_index(void);
+
 /* Get EPG cache for direct access
  * Returns: pointer to epg_cache_t structure
  */
@@ -0,0 +1,935 @@
+#include "epg_index.h"
+#include "hashmap.h"
+#include "inflate.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define EPG_TAG_MAX 4096  /* Markup kept per tag, longer tags are cut */
+#define EPG_TEXT_MAX 4096 /* Text kept per title / description / name */
+
+typedef struct {
+  int64_t start;    /* Unix seconds */
+  int64_t stop;     /* Unix seconds, 0 if unknown */
+  uint32_t channel; /* Channel number */
+  uint32_t title;   /* String pool offset, 0 if none */
+  uint32_t desc;    /* String pool offset, 0 if none */
+} epg_programme_t;
+
+typedef struct {
+  uint32_t id;    /* String pool offset of the XMLTV channel id */
+  uint32_t name;  /* String pool offset of the first display-name, 0 if none */
+  uint32_t first; /* First programme */
+  uint32_t count; /* Programmes of the channel */
+} epg_channel_t;
+
+/* Hash map entry mapping a pooled string to a number.  Lookups pass the
+ * string in probe since it is not pooled yet. */
+typedef struct {
+  uint64_t hash;
+  uint32_t offset;
+  uint32_t value;
+  const char *probe;
+} epg_string_entry_t;
+
+struct epg_index_s {
+  char *pool; /* NUL-separated strings, offset 0 is "" */
+  size_t pool_used;
+  size_t pool_size;
+
+  epg_channel_t *channels;
+  size_t num_channels;
+  size_t channels_size;
+
+  epg_programme_t *programmes;
+  size_t num_programmes;
+  size_t programmes_size;
+
+  struct hashmap *by_id;   /* Channel id -> channel number */
+  struct hashmap *by_name; /* Display name -> channel number */
+};
+
+typedef enum { CAPTURE_NONE = 0, CAPTURE_NAME, CAPTURE_TITLE, CAPTURE_DESC } capture_t;
+
+typedef struct {
+  epg_index_t *index;
+  struct hashmap *strings; /* Interned titles and descriptions */
+  int failed;
+
+  int in_tag;
+  char tag[EPG_TAG_MAX];
+  size_t tag_len;
+  size_t tag_total; /* Length including the part that did not fit */
+  char tag_tail[2]; /* Last two characters, for comment / CDATA ends */
+
+  capture_t capture;
+  char text[EPG_TEXT_MAX];
+  size_t text_len;
+  int text_truncated;
+
+  int in_channel;
+  uint32_t channel;
+
+  int in_programme;
+  int programme_valid;
+  epg_programme_t programme;
+} epg_parser_t;
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t size;
+  int failed;
+} epg_buf_t;
+
+/* ---- String pool ---- */
+
+static uint64_t string_entry_hash(const void *item, uint64_t seed0, uint64_t seed1) {
+  (void)seed0;
+  (void)seed1;
+  return ((const epg_string_entry_t *)item)->hash;
+}
+
+static int string_entry_compare(const void *a, const void *b, void *udata) {
+  const epg_index_t *index = udata;
+  const epg_string_entry_t *ea = a;
+  const epg_string_entry_t *eb = b;
+  const char *sa = ea->probe ? ea->probe : index->pool + ea->offset;
+  const char *sb = eb->probe ? eb->probe : index->pool + eb->offset;
+  return strcmp(sa, sb);
+}
+
+static struct hashmap *string_map_new(epg_index_t *index) {
+  return hashmap_new(sizeof(epg_string_entry_t), 0, 0, 0, string_entry_hash, string_entry_compare, NULL, index);
+}
+
+static uint64_t string_hash(const char *s) { return hashmap_xxhash3(s, strlen(s), 0, 0); }
+
+/* Append a string to the pool, returns its offset or 0 on failure */
+static uint32_t pool_add(epg_index_t *index, const char *s) {
+  size_t len = strlen(s) + 1;
+
+  if (index->pool_used + len > UINT32_MAX)
+    return 0;
+  if (index->pool_used + len > index->pool_size) {
+    size_t new_size = index->pool_size ? index->pool_size : 65536;
+    while (new_size < index->pool_used + len)
+      new_size *= 2;
+    char *pool = realloc(index->pool, new_size);
+    if (!pool)
+      return 0;
+    index->pool = pool;
+    index->pool_size = new_size;
+  }
+  memcpy(index->pool + index->pool_used, s, len);
+  index->pool_used += len;
+  return (uint32_t)(index->pool_used - len);
+}
+
+/* Find s in map; when missing and add is set, pool it with value */
+static const epg_string_entry_t *string_map_lookup(epg_index_t *index, struct hashmap *map, const char *s,
+                                                   uint32_t value, int add) {
+  epg_string_entry_t key = {.hash = string_hash(s), .probe = s};
+  const epg_string_entry_t *found = hashmap_get_with_hash(map, &key, key.hash);
+
+  if (found || !add)
+    return found;
+
+  key.offset = pool_add(index, s);
+  if (key.offset == 0)
+    return NULL;
+  key.value = value;
+  key.probe = NULL;
+  hashmap_set_with_hash(map, &key, key.hash);
+  if (hashmap_oom(map))
+    return NULL;
+  return hashmap_get_with_hash(map, &key, key.hash);
+}
+
+/* ---- Index building ---- */
+
+static int channel_for_id(epg_parser_t *p, const char *id, uint32_t *channel_out) {
+  epg_index_t *index = p->index;
+  const epg_string_entry_t *entry = string_map_lookup(index, index->by_id, id, 0, 0);
+
+  if (entry) {
+    *channel_out = entry->value;
+    return 0;
+  }
+
+  if (index->num_channels == index->channels_size) {
+    size_t new_size = index->channels_size ? index->channels_size * 2 : 256;
+    epg_channel_t *channels = realloc(index->channels, new_size * sizeof(*channels));
+    if (!channels)
+      return -1;
+    index->channels = channels;
+    index->channels_size = new_size;
+  }
+
+  entry = string_map_lookup(index, index->by_id, id, (uint32_t)index->num_channels, 1);
+  if (!entry)
+    return -1;
+
+  epg_channel_t *channel = &index->channels[index->num_channels];
+  memset(channel, 0, sizeof(*channel));
+  channel->id = entry->offset;
+  *channel_out = (uint32_t)index->num_channels++;
+  return 0;
+}
+
+static uint32_t intern_text(epg_parser_t *p, const char *s) {
+  if (s[0] == '\0')
+    return 0;
+  const epg_string_entry_t *entry = string_map_lookup(p->index, p->strings, s, 0, 1);
+  if (!entry) {
+    p->failed = 1;
+    return 0;
+  }
+  return entry->offset;
+}
+
+static int add_programme(epg_parser_t *p) {
+  epg_index_t *index = p->index;
+
+  if (index->num_programmes == index->programmes_size) {
+    size_t new_size = index->programmes_size ? index->programmes_size * 2 : 4096;
+    epg_programme_t *programmes = realloc(index->programmes, new_size * sizeof(*programmes));
+    if (!programmes)
+      return -1;
+    index->programmes = programmes;
+    index->programmes_size = new_size;
+  }
+  index->programmes[index->num_programmes++] = p->programme;
+  return 0;
+}
+
+/* ---- XMLTV parsing ---- */
+
+static size_t utf8_encode(uint32_t cp, char *out) {
+  if (cp < 0x80) {
+    out[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = (char)(0xC0 | (cp >> 6));
+    out[1] = (char)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  if (cp < 0x110000) {
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+  }
+  return 0;
+}
+
+/* Decode XML entities in place, returns the new length */
+static size_t decode_entities(char *s, size_t len) {
+  static const struct {
+    const char *name;
+    char value;
+  } named[] = {{"lt;", '<'}, {"gt;", '>'}, {"amp;", '&'}, {"quot;", '"'}, {"apos;", '\''}};
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in < len) {
+    if (s[in] != '&') {
+      s[out++] = s[in++];
+      continue;
+    }
+
+    const char *semi = memchr(s + in, ';', len - in < 12 ? len - in : 12);
+    size_t consumed = 0;
+    if (semi && s[in + 1] == '#') {
+      char *end;
+      uint32_t cp = (s[in + 2] == 'x' || s[in + 2] == 'X') ? (uint32_t)strtoul(s + in + 3, &end, 16)
+                                                           : (uint32_t)strtoul(s + in + 2, &end, 10);
+      if (end == semi && cp != 0) {
+        char utf8[4];
+        size_t n = utf8_encode(cp, utf8);
+        /* The entity is at least as long as its UTF-8 encoding */
+        memcpy(s + out, utf8, n);
+        out += n;
+        consumed = (size_t)(semi - (s + in)) + 1;
+      }
+    } else if (semi) {
+      for (size_t i = 0; i < sizeof(named) / sizeof(named[0]); i++) {
+        size_t name_len = strlen(named[i].name);
+        if ((size_t)(semi - (s + in)) == name_len && strncmp(s + in + 1, named[i].name, name_len) == 0) {
+          s[out++] = named[i].value;
+          consumed = name_len + 1;
+          break;
+        }
+      }
+    }
+    if (consumed == 0) {
+      s[out++] = s[in++];
+      continue;
+    }
+    in += consumed;
+  }
+  return out;
+}
+
+/* Trim whitespace; a text cut at EPG_TEXT_MAX loses its last, possibly
+ * partial, UTF-8 character */
+static char *finish_text(char *s, size_t len, int truncated) {
+  if (truncated) {
+    while (len > 0 && ((unsigned char)s[len - 1] & 0xC0) == 0x80)
+      len--;
+    if (len > 0 && ((unsigned char)s[len - 1] & 0x80))
+      len--;
+  }
+  while (len > 0 && (unsigned char)s[len - 1] <= ' ')
+    len--;
+  while (len > 0 && (unsigned char)*s <= ' ') {
+    s++;
+    len--;
+  }
+  s[len] = '\0';
+  return s;
+}
+
+static void text_append(epg_parser_t *p, const char *data, size_t len) {
+  size_t room = EPG_TEXT_MAX - 1 - p->text_len;
+  if (len > room) {
+    len = room;
+    p->text_truncated = 1;
+  }
+  memcpy(p->text + p->text_len, data, len);
+  p->text_len += len;
+}
+
+/* Copy the decoded value of attribute name from a start tag */
+static int get_attr(const char *tag, size_t len, const char *name, char *out, size_t out_size) {
+  size_t name_len = strlen(name);
+  size_t i = 0;
+
+  /* Skip the element name */
+  while (i < len && tag[i] != ' ' && tag[i] != '\t' && tag[i] != '\r' && tag[i] != '\n')
+    i++;
+
+  while (i < len) {
+    while (i < len && (tag[i] == ' ' || tag[i] == '\t' || tag[i] == '\r' || tag[i] == '\n'))
+      i++;
+    size_t attr_start = i;
+    while (i < len && tag[i] != '=' && tag[i] != ' ' && tag[i] != '\t' && tag[i] != '\r' && tag[i] != '\n')
+      i++;
+    size_t attr_len = i - attr_start;
+    while (i < len && tag[i] != '=' && tag[i] != '"' && tag[i] != '\'')
+      i++;
+    if (i >= len || tag[i] != '=')
+      return -1;
+    i++;
+    while (i < len && tag[i] != '"' && tag[i] != '\'')
+      i++;
+    if (i >= len)
+      return -1;
+    char quote = tag[i++];
+    size_t value_start = i;
+    while (i < len && tag[i] != quote)
+      i++;
+    if (i >= len)
+      return -1;
+    size_t value_len = i - value_start;
+    i++;
+
+    if (attr_len == name_len && strncmp(tag + attr_start, name, name_len) == 0) {
+      if (value_len >= out_size)
+        value_len = out_size - 1;
+      memcpy(out, tag + value_start, value_len);
+      out[decode_entities(out, value_len)] = '\0';
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = (unsigned)(y - era * 400);
+  unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+/* Parse an XMLTV time ("YYYYMMDDhhmmss +hhmm", seconds and offset optional) */
+static int parse_xmltv_time(const char *s, int64_t *out) {
+  static const int widths[6] = {4, 2, 2, 2, 2, 2};
+  int v[6] = {0, 0, 0, 0, 0, 0};
+  int fields;
+
+  for (fields = 0; fields < 6; fields++) {
+    int digits = 0;
+    while (digits < widths[fields] && *s >= '0' && *s <= '9') {
+      v[fields] = v[fields] * 10 + (*s++ - '0');
+      digits++;
+    }
+    if (digits < widths[fields])
+      break;
+  }
+  if (fields < 5 || v[1] < 1 || v[1] > 12 || v[2] < 1 || v[2] > 31)
+    return -1;
+
+  int64_t t = days_from_civil(v[0], (unsigned)v[1], (unsigned)v[2]) * 86400 + v[3] * 3600 + v[4] * 60 + v[5];
+
+  while (*s == ' ')
+    s++;
+  if ((s[0] == '+' || s[0] == '-') && strlen(s) >= 5) {
+    int offset = ((s[1] - '0') * 10 + (s[2] - '0')) * 3600 + ((s[3] - '0') * 10 + (s[4] - '0')) * 60;
+    t += s[0] == '+' ? -offset : offset;
+  }
+  *out = t;
+  return 0;
+}
+
+static int tag_is(const char *tag, size_t len, const char *name) {
+  size_t name_len = strlen(name);
+  if (len < name_len || strncmp(tag, name, name_len) != 0)
+    return 0;
+  return len == name_len || tag[name_len] == ' ' || tag[name_len] == '\t' || tag[name_len] == '\r' ||
+         tag[name_len] == '\n' || tag[name_len] == '/';
+}
+
+static void handle_end(epg_parser_t *p, const char *name, size_t len) {
+  if (p->capture != CAPTURE_NONE &&
+      ((p->capture == CAPTURE_NAME && tag_is(name, len, "display-name")) ||
+       (p->capture == CAPTURE_TITLE && tag_is(name, len, "title")) ||
+       (p->capture == CAPTURE_DESC && tag_is(name, len, "desc")))) {
+    char *text = finish_text(p->text, decode_entities(p->text, p->text_len), p->text_truncated);
+    if (p->capture == CAPTURE_NAME) {
+      if (text[0] != '\0' && p->index->channels[p->channel].name == 0) {
+        const epg_string_entry_t *entry =
+            string_map_lookup(p->index, p->index->by_name, text, p->channel, 1);
+        if (!entry)
+          p->failed = 1;
+        else
+          p->index->channels[p->channel].name = entry->offset;
+      }
+    } else if (p->capture == CAPTURE_TITLE) {
+      p->programme.title = intern_text(p, text);
+    } else {
+      p->programme.desc = intern_text(p, text);
+    }
+    p->capture = CAPTURE_NONE;
+    return;
+  }
+
+  if (tag_is(name, len, "programme")) {
+    if (p->in_programme && p->programme_valid && add_programme(p) < 0)
+      p->failed = 1;
+    p->in_programme = 0;
+  } else if (tag_is(name, len, "channel")) {
+    p->in_channel = 0;
+  }
+}
+
+static void handle_start(epg_parser_t *p, const char *tag, size_t len) {
+  char value[512];
+  int self_closing = len > 0 && tag[len - 1] == '/';
+
+  if (tag_is(tag, len, "channel")) {
+    if (get_attr(tag, len, "id", value, sizeof(value)) == 0 && value[0] != '\0') {
+      if (channel_for_id(p, value, &p->channel) < 0)
+        p->failed = 1;
+      else
+        p->in_channel = !self_closing;
+    }
+  } else if (tag_is(tag, len, "programme")) {
+    memset(&p->programme, 0, sizeof(p->programme));
+    p->in_programme = !self_closing;
+    p->programme_valid = get_attr(tag, len, "channel", value, sizeof(value)) == 0 && value[0] != '\0' &&
+                         channel_for_id(p, value, &p->programme.channel) == 0 &&
+                         get_attr(tag, len, "start", value, sizeof(value)) == 0 &&
+                         parse_xmltv_time(value, &p->programme.start) == 0;
+    if (p->programme_valid && get_attr(tag, len, "stop", value, sizeof(value)) == 0)
+      parse_xmltv_time(value, &p->programme.stop);
+  } else if (self_closing) {
+    /* Empty titles / names carry nothing worth indexing */
+  } else if (p->in_channel && tag_is(tag, len, "display-name") && p->index->channels[p->channel].name == 0) {
+    p->capture = CAPTURE_NAME;
+    p->text_len = 0;
+    p->text_truncated = 0;
+  } else if (p->in_programme && tag_is(tag, len, "title") && p->programme.title == 0) {
+    p->capture = CAPTURE_TITLE;
+    p->text_len = 0;
+    p->text_truncated = 0;
+  } else if (p->in_programme && tag_is(tag, len, "desc") && p->programme.desc == 0) {
+    p->capture = CAPTURE_DESC;
+    p->text_len = 0;
+    p->text_truncated = 0;
+  }
+}
+
+/* Markup between '<' and '>' is complete */
+static void handle_markup(epg_parser_t *p) {
+  const char *tag = p->tag;
+  size_t len = p->tag_len;
+
+  if (len > 0 && tag[0] == '/') {
+    handle_end(p, tag + 1, len - 1);
+  } else if (len >= 8 && strncmp(tag, "![CDATA[", 8) == 0) {
+    if (p->capture != CAPTURE_NONE) {
+      /* Re-escape '&' so entity decoding leaves CDATA text alone */
+      size_t end = p->tag_total == len ? len - 2 : len;
+      for (size_t i = 8; i < end; i++) {
+        if (tag[i] == '&')
+          text_append(p, "&amp;", 5);
+        else
+          text_append(p, tag + i, 1);
+      }
+    }
+  } else if (len > 0 && tag[0] != '!' && tag[0] != '?') {
+    handle_start(p, tag, len);
+  }
+}
+
+/* Comments and CDATA sections may contain '>' */
+static int markup_complete(const epg_parser_t *p) {
+  if (p->tag_total >= 3 && strncmp(p->tag, "!--", 3) == 0)
+    return p->tag_total >= 5 && p->tag_tail[0] == '-' && p->tag_tail[1] == '-';
+  if (p->tag_total >= 8 && strncmp(p->tag, "![CDATA[", 8) == 0)
+    return p->tag_total >= 10 && p->tag_tail[0] == ']' && p->tag_tail[1] == ']';
+  return 1;
+}
+
+static void tag_append(epg_parser_t *p, const char *data, size_t len) {
+  size_t room = sizeof(p->tag) - p->tag_len;
+  memcpy(p->tag + p->tag_len, data, len < room ? len : room);
+  p->tag_len += len < room ? len : room;
+  if (len >= 2) {
+    p->tag_tail[0] = data[len - 2];
+    p->tag_tail[1] = data[len - 1];
+  } else if (len == 1) {
+    p->tag_tail[0] = p->tag_tail[1];
+    p->tag_tail[1] = data[0];
+  }
+  p->tag_total += len;
+}
+
+static int parser_feed(const uint8_t *data, size_t len, void *user_data) {
+  epg_parser_t *p = user_data;
+  const char *s = (const char *)data;
+  const char *end = s + len;
+
+  while (s < end && !p->failed) {
+    if (!p->in_tag) {
+      const char *lt = memchr(s, '<', (size_t)(end - s));
+      const char *stop = lt ? lt : end;
+      if (p->capture != CAPTURE_NONE)
+        text_append(p, s, (size_t)(stop - s));
+      if (!lt)
+        break;
+      s = lt + 1;
+      p->in_tag = 1;
+      p->tag_len = 0;
+      p->tag_total = 0;
+      continue;
+    }
+
+    const char *gt = memchr(s, '>', (size_t)(end - s));
+    if (!gt) {
+      tag_append(p, s, (size_t)(end - s));
+      break;
+    }
+    tag_append(p, s, (size_t)(gt - s));
+    s = gt + 1;
+    if (!markup_complete(p)) {
+      tag_append(p, ">", 1);
+      continue;
+    }
+    p->in_tag = 0;
+    handle_markup(p);
+  }
+  return p->failed ? -1 : 0;
+}
+
+static int compare_programmes(const void *a, const void *b) {
+  const epg_programme_t *pa = a;
+  const epg_programme_t *pb = b;
+  if (pa->channel != pb->channel)
+    return pa->channel < pb->channel ? -1 : 1;
+  if (pa->start != pb->start)
+    return pa->start < pb->start ? -1 : 1;
+  return 0;
+}
+
+/* Sort programmes per channel and record each channel's range */
+static void index_finalize(epg_index_t *index) {
+  if (index->num_programmes > 0)
+    qsort(index->programmes, index->num_programmes, sizeof(epg_programme_t), compare_programmes);
+
+  for (size_t i = 0; i < index->num_programmes; i++) {
+    epg_channel_t *channel = &index->channels[index->programmes[i].channel];
+    if (channel->count == 0)
+      channel->first = (uint32_t)i;
+    channel->count++;
+  }
+
+  /* Give back the growth slack */
+  if (index->num_programmes > 0 && index->num_programmes < index->programmes_size) {
+    epg_programme_t *programmes = realloc(index->programmes, index->num_programmes * sizeof(epg_programme_t));
+    if (programmes) {
+      index->programmes = programmes;
+      index->programmes_size = index->num_programmes;
+    }
+  }
+  if (index->pool_used < index->pool_size) {
+    char *pool = realloc(index->pool, index->pool_used);
+    if (pool) {
+      index->pool = pool;
+      index->pool_size = index->pool_used;
+    }
+  }
+}
+
+epg_index_t *epg_index_build(int fd, size_t size, int is_gzipped, char *report, size_t report_size) {
+  epg_parser_t *parser;
+  epg_index_t *index;
+  void *data;
+  int ret;
+  int64_t started = get_time_ms();
+
+  if (fd < 0 || size == 0) {
+    snprintf(report, report_size, "EPG index: No EPG data");
+    return NULL;
+  }
+
+  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    snprintf(report, report_size, "EPG index: Failed to map EPG data: %s", strerror(errno));
+    return NULL;
+  }
+
+  index = calloc(1, sizeof(*index));
+  parser = calloc(1, sizeof(*parser));
+  if (!index || !parser) {
+    snprintf(report, report_size, "EPG index: Out of memory");
+    free(index);
+    free(parser);
+    munmap(data, size);
+    return NULL;
+  }
+
+  parser->index = index;
+  index->by_id = string_map_new(index);
+  index->by_name = string_map_new(index);
+  parser->strings = string_map_new(index);
+  if (!index->by_id || !index->by_name || !parser->strings || pool_add(index, "") != 0) {
+    ret = -1;
+  } else if (is_gzipped) {
+    ret = inflate_gzip(data, size, parser_feed, parser);
+  } else {
+    ret = parser_feed(data, size, parser);
+  }
+
+  if (parser->strings)
+    hashmap_free(parser->strings);
+  munmap(data, size);
+
+  if (ret < 0 || parser->failed) {
+    snprintf(report, report_size, "EPG index: Failed to index EPG data (%s)",
+             !parser->failed && is_gzipped ? "corrupt gzip data" : "out of memory");
+    free(parser);
+    epg_index_free(index);
+    return NULL;
+  }
+  free(parser);
+
+  index_finalize(index);
+  snprintf(report, report_size, "EPG index built: %zu channels, %zu programmes, %zu bytes of strings in %lld ms",
+           index->num_channels, index->num_programmes, index->pool_used, (long long)(get_time_ms() - started));
+  return index;
+}
+
+void epg_index_free(epg_index_t *index) {
+  if (!index)
+    return;
+  if (index->by_id)
+    hashmap_free(index->by_id);
+  if (index->by_name)
+    hashmap_free(index->by_name);
+  free(index->pool);
+  free(index->channels);
+  free(index->programmes);
+  free(index);
+}
+
+size_t epg_index_channel_count(const epg_index_t *index) { return index ? index->num_channels : 0; }
+
+size_t epg_index_programme_count(const epg_index_t *index) { return index ? index->num_programmes : 0; }
+
+/* ---- Queries ---- */
+
+static void buf_reserve(epg_buf_t *b, size_t extra) {
+  if (b->failed || b->len + extra + 1 <= b->size)
+    return;
+  size_t new_size = b->size ? b->size : 4096;
+  while (new_size < b->len + extra + 1)
+    new_size *= 2;
+  char *data = realloc(b->data, new_size);
+  if (!data) {
+    b->failed = 1;
+    return;
+  }
+  b->data = data;
+  b->size = new_size;
+}
+
+static void buf_append(epg_buf_t *b, const char *s, size_t len) {
+  buf_reserve(b, len);
+  if (b->failed)
+    return;
+  memcpy(b->data + b->len, s, len);
+  b->len += len;
+  b->data[b->len] = '\0';
+}
+
+static void buf_append_str(epg_buf_t *b, const char *s) { buf_append(b, s, strlen(s)); }
+
+static void buf_printf(epg_buf_t *b, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void buf_printf(epg_buf_t *b, const char *format, ...) {
+  va_list args;
+  char tmp[256];
+
+  va_start(args, format);
+  int n = vsnprintf(tmp, sizeof(tmp), format, args);
+  va_end(args);
+  if (n > 0)
+    buf_append(b, tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+}
+
+static void buf_append_json(epg_buf_t *b, const char *s) {
+  size_t len = json_escaped_len(s);
+  buf_reserve(b, len);
+  if (b->failed)
+    return;
+  json_escape_string_to_buffer(s, b->data + b->len, len + 1);
+  b->len += len;
+}
+
+static void buf_append_xml(epg_buf_t *b, const char *s) {
+  for (const char *run = s;; s++) {
+    const char *entity = NULL;
+    switch (*s) {
+    case '<':
+      entity = "&lt;";
+      break;
+    case '>':
+      entity = "&gt;";
+      break;
+    case '&':
+      entity = "&amp;";
+      break;
+    case '"':
+      entity = "&quot;";
+      break;
+    case '\0':
+      buf_append(b, run, (size_t)(s - run));
+      return;
+    default:
+      continue;
+    }
+    buf_append(b, run, (size_t)(s - run));
+    buf_append_str(b, entity);
+    run = s + 1;
+  }
+}
+
+static void buf_append_xmltv_time(epg_buf_t *b, int64_t t) {
+  int64_t days = t >= 0 ? t / 86400 : (t - 86399) / 86400;
+  int64_t secs = t - days * 86400;
+
+  /* civil_from_days */
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  unsigned doe = (unsigned)(days - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp = (5 * doy + 2) / 153;
+  unsigned d = doy - (153 * mp + 2) / 5 + 1;
+  unsigned m = mp < 10 ? mp + 3 : mp - 9;
+  int64_t y = (int64_t)yoe + era * 400 + (m <= 2);
+
+  buf_printf(b, "%04lld%02u%02u%02d%02d%02d +0000", (long long)y, m, d, (int)(secs / 3600), (int)(secs / 60 % 60),
+             (int)(secs % 60));
+}
+
+static const epg_channel_t *find_channel(const epg_index_t *index, const char *name) {
+  epg_string_entry_t key = {.hash = string_hash(name), .probe = name};
+  const epg_string_entry_t *entry = hashmap_get_with_hash(index->by_id, &key, key.hash);
+
+  if (!entry)
+    entry = hashmap_get_with_hash(index->by_name, &key, key.hash);
+  return entry ? &index->channels[entry->value] : NULL;
+}
+
+static void render_programme(epg_buf_t *b, const epg_index_t *index, const epg_channel_t *channel,
+                             const epg_programme_t *prog, int as_xml, int first) {
+  if (as_xml) {
+    buf_append_str(b, "<programme start=\"");
+    buf_append_xmltv_time(b, prog->start);
+    if (prog->stop) {
+      buf_append_str(b, "\" stop=\"");
+      buf_append_xmltv_time(b, prog->stop);
+    }
+    buf_append_str(b, "\" channel=\"");
+    buf_append_xml(b, index->pool + channel->id);
+    buf_append_str(b, "\">");
+    if (prog->title) {
+      buf_append_str(b, "<title>");
+      buf_append_xml(b, index->pool + prog->title);
+      buf_append_str(b, "</title>");
+    }
+    if (prog->desc) {
+      buf_append_str(b, "<desc>");
+      buf_append_xml(b, index->pool + prog->desc);
+      buf_append_str(b, "</desc>");
+    }
+    buf_append_str(b, "</programme>\n");
+    return;
+  }
+
+  buf_printf(b, "%s{\"start\":%lld,\"stop\":%lld,\"title\":\"", first ? "" : ",", (long long)prog->start,
+             (long long)prog->stop);
+  buf_append_json(b, index->pool + prog->title);
+  buf_append_str(b, "\"");
+  if (prog->desc) {
+    buf_append_str(b, ",\"desc\":\"");
+    buf_append_json(b, index->pool + prog->desc);
+    buf_append_str(b, "\"");
+  }
+  buf_append_str(b, "}");
+}
+
+static void render_channel(epg_buf_t *b, const epg_index_t *index, const epg_channel_t *channel, int64_t start,
+                           int64_t end, int next, int as_xml) {
+  const epg_programme_t *progs = index->programmes + channel->first;
+  size_t lo = 0;
+  size_t hi = channel->count;
+  int rendered = 0;
+
+  if (end <= start)
+    end = start + 1;
+
+  /* First programme starting at or after the window start */
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (progs[mid].start < start)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  /* The previous one is still airing at the window start */
+  if (lo > 0 && (progs[lo - 1].stop > start ||
+                 (progs[lo - 1].stop == 0 && (lo == channel->count || progs[lo].start > start))))
+    lo--;
+
+  for (size_t i = lo; i < channel->count && rendered < EPG_QUERY_MAX_PROGRAMMES; i++) {
+    if (progs[i].start >= end) {
+      if (next <= 0)
+        break;
+      next--;
+    }
+    render_programme(b, index, channel, &progs[i], as_xml, rendered == 0);
+    rendered++;
+  }
+}
+
+/* Call fn for every known channel of a comma-separated list */
+static void for_each_channel(const epg_index_t *index, const char *channels,
+                             void (*fn)(epg_buf_t *b, const epg_index_t *index, const epg_channel_t *channel,
+                                        void *ctx),
+                             epg_buf_t *b, void *ctx) {
+  char name[512];
+
+  while (channels && *channels) {
+    const char *comma = strchr(channels, ',');
+    size_t len = comma ? (size_t)(comma - channels) : strlen(channels);
+
+    if (len > 0 && len < sizeof(name)) {
+      memcpy(name, channels, len);
+      name[len] = '\0';
+      const epg_channel_t *channel = find_channel(index, name);
+      if (channel)
+        fn(b, index, channel, ctx);
+    }
+    channels = comma ? comma + 1 : channels + len;
+  }
+}
+
+typedef struct {
+  int64_t start;
+  int64_t end;
+  int next;
+  int rendered; /* Channels rendered so far (JSON separators) */
+} epg_query_t;
+
+static void render_json_channel(epg_buf_t *b, const epg_index_t *index, const epg_channel_t *channel, void *ctx) {
+  epg_query_t *q = ctx;
+
+  buf_append_str(b, q->rendered++ ? ",{\"id\":\"" : "{\"id\":\"");
+  buf_append_json(b, index->pool + channel->id);
+  buf_append_str(b, "\",\"name\":\"");
+  buf_append_json(b, index->pool + channel->name);
+  buf_append_str(b, "\",\"programmes\":[");
+  render_channel(b, index, channel, q->start, q->end, q->next, 0);
+  buf_append_str(b, "]}");
+}
+
+static void render_xml_channel(epg_buf_t *b, const epg_index_t *index, const epg_channel_t *channel, void *ctx) {
+  (void)ctx;
+  buf_append_str(b, "<channel id=\"");
+  buf_append_xml(b, index->pool + channel->id);
+  buf_append_str(b, "\">");
+  if (channel->name) {
+    buf_append_str(b, "<display-name>");
+    buf_append_xml(b, index->pool + channel->name);
+    buf_append_str(b, "</display-name>");
+  }
+  buf_append_str(b, "</channel>\n");
+}
+
+static void render_xml_programmes(epg_buf_t *b, const epg_index_t *index, const epg_channel_t *channel, void *ctx) {
+  epg_query_t *q = ctx;
+  render_channel(b, index, channel, q->start, q->end, q->next, 1);
+}
+
+char *epg_index_query(const epg_index_t *index, const char *channels, int64_t start, int64_t end, int next,
+                      int as_xml, size_t *len_out) {
+  epg_query_t query = {.start = start, .end = end, .next = next};
+  epg_buf_t b = {0};
+
+  if (as_xml) {
+    /* XMLTV lists all channels before the programmes */
+    buf_append_str(&b, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tv generator-info-name=\"rtp2httpd\">\n");
+    for_each_channel(index, channels, render_xml_channel, &b, &query);
+    for_each_channel(index, channels, render_xml_programmes, &b, &query);
+    buf_append_str(&b, "</tv>\n");
+  } else {
+    buf_append_str(&b, "{\"channels\":[");
+    for_each_channel(index, channels, render_json_channel, &b, &query);
+    buf_append_str(&b, "]}");
+  }
+
+  if (b.failed) {
+    free(b.data);
+    return NULL;
+  }
+  *len_out = b.len;
+  return b.data;
+}
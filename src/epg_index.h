@@ -0,0 +1,63 @@
+#ifndef __EPG_INDEX_H__
+#define __EPG_INDEX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Programmes returned per channel by one query, at most */
+#define EPG_QUERY_MAX_PROGRAMMES 500
+
+/* Following programmes a query may ask for ("now/next"), at most */
+#define EPG_QUERY_MAX_NEXT 32
+
+/* Longest time window one query covers (seconds); longer ones are cut */
+#define EPG_QUERY_MAX_WINDOW (2 * 86400)
+
+/**
+ * Compact in-memory index of an XMLTV guide
+ *
+ * Built once per EPG fetch, on a helper thread, by streaming the cached file
+ * (gzip or plain) through a minimal XMLTV parser.  Every channel keeps its programmes sorted
+ * by start time, and titles / descriptions are interned into one string pool,
+ * so a query for a handful of channels is a binary search per channel.
+ */
+typedef struct epg_index_s epg_index_t;
+
+/**
+ * Build an index from XMLTV data
+ * @param fd File holding the data (not modified, offset not used)
+ * @param size Data size in bytes
+ * @param is_gzipped 1 if the data is gzip compressed
+ * @param report Receives a log line describing the outcome; this runs off
+ *               the event loop, whose log ring has a single writer, so the
+ *               caller logs it
+ * @param report_size Size of report
+ * @return Index, or NULL on error
+ */
+epg_index_t *epg_index_build(int fd, size_t size, int is_gzipped, char *report, size_t report_size);
+
+/** Free an index (NULL is ignored) */
+void epg_index_free(epg_index_t *index);
+
+/** Number of channels in the index */
+size_t epg_index_channel_count(const epg_index_t *index);
+
+/** Number of programmes in the index */
+size_t epg_index_programme_count(const epg_index_t *index);
+
+/**
+ * Render the programmes of some channels overlapping a time window
+ * @param index Index to query
+ * @param channels Comma-separated channel ids or display names
+ * @param start Window start (Unix seconds)
+ * @param end Window end (Unix seconds); end <= start selects the programme
+ * airing at start
+ * @param next Following programmes to add after the window per channel
+ * @param as_xml 1 for an XMLTV document, 0 for JSON
+ * @param len_out Receives the rendered length
+ * @return malloc'd NUL-terminated document, or NULL on allocation failure
+ */
+char *epg_index_query(const epg_index_t *index, const char *channels, int64_t start, int64_t end, int next,
+                      int as_xml, size_t *len_out);
+
+#endif /* __EPG_INDEX_H__ */
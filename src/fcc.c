@@ -2,6 +2,7 @@
 #include "buffer_pool.h"
 #include "connection.h"
 #include "fcc_huawei.h"
+#include "fcc_socket_pool.h"
 #include "fcc_telecom.h"
 #include "multicast.h"
 #include "poller.h"
@@ -23,132 +24,6 @@ static void log_fcc_state_transition(fcc_state_t from, fcc_state_t to, const cha
 static int fcc_send_term_packet(fcc_session_t *fcc, service_t *service, uint16_t seqn, const char *reason);
 static int fcc_send_termination_message(stream_context_t *ctx, uint16_t mcast_seqn);
 
-static int fcc_create_configured_socket(service_t *service, const char *upstream_if, const char *label) {
-  int sock = socket(AF_INET, service->fcc_addr->ai_socktype, service->fcc_addr->ai_protocol);
-  if (sock < 0) {
-    logger(LOG_ERROR, "FCC: Failed to create %s socket: %s", label, strerror(errno));
-    return -1;
-  }
-
-  if (connection_set_nonblocking(sock) < 0) {
-    logger(LOG_ERROR, "FCC: Failed to set %s socket non-blocking: %s", label, strerror(errno));
-    close(sock);
-    return -1;
-  }
-
-  if (set_socket_rcvbuf(sock, config.udp_rcvbuf_size) < 0) {
-    logger(LOG_WARN, "FCC: Failed to set %s SO_RCVBUF to %d: %s", label, config.udp_rcvbuf_size, strerror(errno));
-  }
-
-  bind_to_upstream_interface(sock, upstream_if);
-
-  return sock;
-}
-
-typedef int (*fcc_bind_port_fn)(int port, void *opaque);
-
-typedef struct {
-  int sock;
-  struct sockaddr_in *sin;
-} fcc_single_bind_attempt_t;
-
-typedef struct {
-  stream_context_t *ctx;
-  const char *upstream_if;
-  int media_sock;
-  int signal_sock;
-} fcc_double_bind_attempt_t;
-
-static int fcc_get_bind_port_range(int paired_port_offset, int *min_port, int *max_port, int *use_ephemeral) {
-  if (!min_port || !max_port || !use_ephemeral) {
-    return -1;
-  }
-
-  *use_ephemeral = 0;
-  if (config.fcc_listen_port_min <= 0 || config.fcc_listen_port_max <= 0) {
-    if (paired_port_offset == 0) {
-      *use_ephemeral = 1;
-      *min_port = 0;
-      *max_port = 0;
-      return 0;
-    }
-
-    *min_port = 10000;
-    *max_port = 65535;
-  } else {
-    *min_port = config.fcc_listen_port_min;
-    *max_port = config.fcc_listen_port_max;
-  }
-
-  if (*max_port < *min_port) {
-    int tmp = *min_port;
-    *min_port = *max_port;
-    *max_port = tmp;
-  }
-
-  *max_port -= paired_port_offset;
-
-  int max_allowed = 65535 - paired_port_offset;
-  if (*max_port > max_allowed) {
-    *max_port = max_allowed;
-  }
-  if (*min_port < 1) {
-    *min_port = 1;
-  }
-
-  return *max_port >= *min_port ? 0 : -1;
-}
-
-static int fcc_try_bind_port_range(int paired_port_offset, const char *label, fcc_bind_port_fn bind_port,
-                                   void *opaque) {
-  int min_port;
-  int max_port;
-  int use_ephemeral;
-
-  if (fcc_get_bind_port_range(paired_port_offset, &min_port, &max_port, &use_ephemeral) < 0) {
-    logger(LOG_ERROR, "FCC: Invalid %s port range", label);
-    return -1;
-  }
-
-  if (use_ephemeral) {
-    return bind_port(0, opaque);
-  }
-
-  int range = max_port - min_port + 1;
-  int start_offset = (int)(get_time_ms() % range);
-
-  for (int i = 0; i < range; i++) {
-    int port = min_port + ((start_offset + i) % range);
-    int r = bind_port(port, opaque);
-    if (r == 0) {
-      return 0;
-    }
-    if (r < -1) {
-      return -1;
-    }
-  }
-
-  logger(LOG_ERROR, "FCC: Unable to bind %s within port range %d-%d", label, min_port, max_port);
-  return -1;
-}
-
-static int fcc_bind_single_socket_port(int port, void *opaque) {
-  fcc_single_bind_attempt_t *attempt = (fcc_single_bind_attempt_t *)opaque;
-
-  attempt->sin->sin_port = htons((uint16_t)port);
-  if (bind(attempt->sock, (struct sockaddr *)attempt->sin, sizeof(*attempt->sin)) == 0) {
-    if (port != 0) {
-      logger(LOG_DEBUG, "FCC: Bound client socket to port %d", port);
-    }
-    return 0;
-  }
-
-  if (errno != EADDRINUSE && errno != EACCES) {
-    logger(LOG_DEBUG, "FCC: Failed to bind port %d: %s", port, strerror(errno));
-  }
-  return -1;
-}
-
 static int fcc_register_socket(stream_context_t *ctx, int sock, const char *label) {
   if (poller_add(ctx->epoll_fd, sock, POLLER_IN) < 0) {
     logger(LOG_ERROR, "FCC: Failed to add %s socket to poller: %s", label, strerror(errno));
@@ -160,106 +35,55 @@ static int fcc_register_socket(stream_context_t *ctx, int sock, const char *labe
   return 0;
 }
 
-static int fcc_bind_double_socket_port(int media_port, void *opaque) {
-  fcc_double_bind_attempt_t *attempt = (fcc_double_bind_attempt_t *)opaque;
-  stream_context_t *ctx = attempt->ctx;
-  fcc_session_t *fcc = &ctx->fcc;
-  service_t *service = ctx->service;
-  int signal_port = media_port + 1;
-
-  if (attempt->media_sock < 0) {
-    attempt->media_sock = fcc_create_configured_socket(service, attempt->upstream_if, "media");
-  }
-  if (attempt->media_sock < 0) {
-    return -2;
-  }
-
-  struct sockaddr_in media_sin;
-  memset(&media_sin, 0, sizeof(media_sin));
-  media_sin.sin_family = AF_INET;
-  media_sin.sin_addr.s_addr = INADDR_ANY;
-  media_sin.sin_port = htons((uint16_t)media_port);
+/* Take the session's sockets out of the event loop and hand them back to
+ * the socket pool, which keeps or closes them */
+static void fcc_release_sockets(fcc_session_t *fcc, int epoll_fd) {
+  int sockets[2] = {fcc->fcc_sock, fcc->media_sock};
 
-  int media_bound = bind(attempt->media_sock, (struct sockaddr *)&media_sin, sizeof(media_sin));
-  int media_errno = errno;
-  if (media_bound < 0) {
-    if (media_errno != EADDRINUSE && media_errno != EACCES) {
-      logger(LOG_DEBUG, "FCC: Failed to bind media port %d: %s", media_port, strerror(media_errno));
+  for (int i = 0; i < 2; i++) {
+    if (sockets[i] < 0) {
+      continue;
+    }
+    fdmap_del(sockets[i]);
+    if (epoll_fd >= 0 && poller_del(epoll_fd, sockets[i]) < 0) {
+      logger(LOG_DEBUG, "FCC: poller_del failed for fd %d: %s (continuing)", sockets[i], strerror(errno));
     }
-    return -1;
-  }
-
-  if (attempt->signal_sock < 0) {
-    attempt->signal_sock = fcc_create_configured_socket(service, attempt->upstream_if, "signal");
-  }
-  if (attempt->signal_sock < 0) {
-    close(attempt->media_sock);
-    attempt->media_sock = -1;
-    return -2;
-  }
-
-  struct sockaddr_in signal_sin;
-  memset(&signal_sin, 0, sizeof(signal_sin));
-  signal_sin.sin_family = AF_INET;
-  signal_sin.sin_addr.s_addr = INADDR_ANY;
-  signal_sin.sin_port = htons((uint16_t)signal_port);
-
-  int signal_bound = bind(attempt->signal_sock, (struct sockaddr *)&signal_sin, sizeof(signal_sin));
-  int signal_errno = errno;
-  if (signal_bound == 0) {
-    fcc->media_sock = attempt->media_sock;
-    fcc->fcc_sock = attempt->signal_sock;
-    attempt->media_sock = -1;
-    attempt->signal_sock = -1;
-    fcc->fcc_server = (struct sockaddr_in *)(uintptr_t)service->fcc_addr->ai_addr;
-
-    socklen_t media_len = sizeof(fcc->media_client);
-    socklen_t signal_len = sizeof(fcc->fcc_client);
-    getsockname(fcc->media_sock, (struct sockaddr *)&fcc->media_client, &media_len);
-    getsockname(fcc->fcc_sock, (struct sockaddr *)&fcc->fcc_client, &signal_len);
-
-    logger(LOG_DEBUG, "FCC: Bound media socket to port %u, signal socket to port %u", ntohs(fcc->media_client.sin_port),
-           ntohs(fcc->fcc_client.sin_port));
-    return 0;
-  }
-
-  if (signal_errno != EADDRINUSE && signal_errno != EACCES) {
-    logger(LOG_DEBUG, "FCC: Failed to bind signal port %d: %s", signal_port, strerror(signal_errno));
   }
 
-  close(attempt->media_sock);
-  attempt->media_sock = -1;
-  return -1;
+  fcc_socket_pool_release(fcc->type == FCC_TYPE_HUAWEI, fcc->upstream_if, fcc->fcc_sock, fcc->media_sock);
+  fcc->fcc_sock = -1;
+  fcc->media_sock = -1;
 }
 
-static int fcc_initialize_double_sockets(stream_context_t *ctx, const char *upstream_if) {
+/* Take a bound socket (Huawei: media/signal pair) from the socket pool and
+ * register it with the event loop */
+static int fcc_acquire_sockets(stream_context_t *ctx, const char *upstream_if) {
   fcc_session_t *fcc = &ctx->fcc;
-  fcc_double_bind_attempt_t attempt = {.ctx = ctx, .upstream_if = upstream_if, .media_sock = -1, .signal_sock = -1};
+  service_t *service = ctx->service;
+  int paired = fcc->type == FCC_TYPE_HUAWEI;
+  socklen_t slen;
 
-  if (fcc_try_bind_port_range(1, "media/signal socket pair", fcc_bind_double_socket_port, &attempt) < 0) {
-    if (attempt.media_sock >= 0) {
-      close(attempt.media_sock);
-    }
-    if (attempt.signal_sock >= 0) {
-      close(attempt.signal_sock);
-    }
+  snprintf(fcc->upstream_if, sizeof(fcc->upstream_if), "%s", upstream_if ? upstream_if : "");
+  if (fcc_socket_pool_acquire(paired, fcc->upstream_if, &fcc->fcc_sock, &fcc->media_sock) < 0) {
+    fcc->fcc_sock = -1;
+    fcc->media_sock = -1;
     return -1;
   }
 
-  if (fcc_register_socket(ctx, fcc->fcc_sock, "signal") < 0) {
-    close(fcc->media_sock);
-    close(fcc->fcc_sock);
-    fcc->media_sock = -1;
-    fcc->fcc_sock = -1;
-    fcc->fcc_server = NULL;
-    return -1;
+  /* Get the assigned local addresses */
+  slen = sizeof(fcc->fcc_client);
+  getsockname(fcc->fcc_sock, (struct sockaddr *)&fcc->fcc_client, &slen);
+  if (paired) {
+    slen = sizeof(fcc->media_client);
+    getsockname(fcc->media_sock, (struct sockaddr *)&fcc->media_client, &slen);
   }
 
-  if (fcc_register_socket(ctx, fcc->media_sock, "media") < 0) {
-    worker_cleanup_socket_from_epoll(ctx->epoll_fd, fcc->fcc_sock);
-    close(fcc->media_sock);
-    fcc->media_sock = -1;
-    fcc->fcc_sock = -1;
+  fcc->fcc_server = (struct sockaddr_in *)(uintptr_t)service->fcc_addr->ai_addr;
+
+  /* Register sockets with poller immediately after acquiring them */
+  if (fcc_register_socket(ctx, fcc->fcc_sock, paired ? "signal" : "client") < 0 ||
+      (paired && fcc_register_socket(ctx, fcc->media_sock, "media") < 0)) {
+    fcc_release_sockets(fcc, ctx->epoll_fd);
     fcc->fcc_server = NULL;
     return -1;
   }
@@ -303,18 +127,10 @@ void fcc_session_cleanup(fcc_session_t *fcc, service_t *service, int epoll_fd) {
   fcc->pending_list_head = NULL;
   fcc->pending_list_tail = NULL;
 
-  /* Close media socket */
-  if (fcc->media_sock >= 0) {
-    worker_cleanup_socket_from_epoll(epoll_fd, fcc->media_sock);
-    fcc->media_sock = -1;
-    logger(LOG_DEBUG, "FCC: Media socket closed");
-  }
-
-  /* Close FCC socket */
-  if (fcc->fcc_sock >= 0) {
-    worker_cleanup_socket_from_epoll(epoll_fd, fcc->fcc_sock);
-    fcc->fcc_sock = -1;
-    logger(LOG_DEBUG, "FCC: Socket closed");
+  /* Return sockets to the socket pool */
+  if (fcc->fcc_sock >= 0 || fcc->media_sock >= 0) {
+    fcc_release_sockets(fcc, epoll_fd);
+    logger(LOG_DEBUG, "FCC: Sockets released");
   }
 
   /* Reset all session state to clean state */
@@ -535,8 +351,6 @@ int fcc_session_set_state(fcc_session_t *fcc, fcc_state_t new_state, const char
 int fcc_initialize_and_request(stream_context_t *ctx) {
   fcc_session_t *fcc = &ctx->fcc;
   service_t *service = ctx->service;
-  struct sockaddr_in sin;
-  socklen_t slen;
   int r;
   const char *upstream_if;
 
@@ -545,42 +359,13 @@ int fcc_initialize_and_request(stream_context_t *ctx) {
   if (fcc->fcc_sock < 0) {
     upstream_if = get_upstream_interface_for_fcc(service->ifname, service->ifname_fcc);
 
-    if (fcc->type == FCC_TYPE_HUAWEI) {
-      if (fcc_initialize_double_sockets(ctx, upstream_if) < 0) {
+    if (fcc_acquire_sockets(ctx, upstream_if) < 0) {
+      if (fcc->type == FCC_TYPE_HUAWEI) {
         logger(LOG_ERROR, "FCC (Huawei): Cannot bind media/signal socket pair");
-        return -1;
-      }
-    } else {
-      /* Create and configure FCC socket */
-      fcc->fcc_sock = fcc_create_configured_socket(service, upstream_if, "client");
-      if (fcc->fcc_sock < 0) {
-        return -1;
-      }
-
-      /* Bind to configured or ephemeral port */
-      memset(&sin, 0, sizeof(sin));
-      sin.sin_family = AF_INET;
-      sin.sin_addr.s_addr = INADDR_ANY;
-      fcc_single_bind_attempt_t bind_attempt = {.sock = fcc->fcc_sock, .sin = &sin};
-      if (fcc_try_bind_port_range(0, "client socket", fcc_bind_single_socket_port, &bind_attempt) != 0) {
+      } else {
         logger(LOG_ERROR, "FCC: Cannot bind socket within configured range");
-        close(fcc->fcc_sock);
-        fcc->fcc_sock = -1;
-        return -1;
-      }
-
-      /* Get the assigned local address */
-      slen = sizeof(fcc->fcc_client);
-      getsockname(fcc->fcc_sock, (struct sockaddr *)&fcc->fcc_client, &slen);
-
-      fcc->fcc_server = (struct sockaddr_in *)(uintptr_t)service->fcc_addr->ai_addr;
-
-      /* Register socket with poller immediately after creation */
-      if (fcc_register_socket(ctx, fcc->fcc_sock, "client") < 0) {
-        close(fcc->fcc_sock);
-        fcc->fcc_sock = -1;
-        return -1;
       }
+      return -1;
     }
   }
 
@@ -596,6 +381,7 @@ int fcc_initialize_and_request(stream_context_t *ctx) {
   }
 
   fcc->last_data_time = get_time_ms();
+  fcc->request_time = fcc->last_data_time;
   fcc_session_set_state(fcc, FCC_STATE_REQUESTED, "Request sent");
 
   return 0;
@@ -608,6 +394,12 @@ int fcc_initialize_and_request(stream_context_t *ctx) {
 int fcc_handle_server_response(stream_context_t *ctx, uint8_t *buf, int buf_len) {
   fcc_session_t *fcc = &ctx->fcc;
 
+  /* The first answer to a request gives the session's upstream RTT */
+  if (fcc->state == FCC_STATE_REQUESTED && fcc->request_time > 0) {
+    rtcp_receiver_add_rtt(&ctx->rtcp, get_time_ms() - fcc->request_time);
+    fcc->request_time = 0;
+  }
+
   /* Dispatch to vendor-specific handler based on FCC type */
   if (fcc->type == FCC_TYPE_HUAWEI) {
     return fcc_huawei_handle_server_response(ctx, buf, buf_len);
@@ -3,6 +3,7 @@
 
 #include "buffer_pool.h"
 #include "service.h"
+#include <net/if.h>
 #include <netinet/in.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -49,7 +50,8 @@ typedef struct {
   int status_index; /* Index in status_shared->clients array for state updates
                      */
   int fcc_sock;
-  int media_sock; /* Huawei media socket; unused by Telecom/ZTE/Fiberhome */
+  int media_sock;                /* Huawei media socket; unused by Telecom/ZTE/Fiberhome */
+  char upstream_if[IF_NAMESIZE]; /* Upstream interface the sockets were taken from the pool for */
   struct sockaddr_in *fcc_server;
   struct sockaddr_in fcc_client;
   struct sockaddr_in media_client;
@@ -63,6 +65,8 @@ typedef struct {
                                  timeout) */
   int64_t last_data_time;     /* Timestamp of last received FCC data for timeout
                                  detection */
+  int64_t request_time;       /* When the pending FCC request was sent (RTT
+                                 sample), 0 once answered */
 
   /* Huawei FCC specific fields */
   uint32_t session_id;        /* Session ID for NAT traversal correlation */
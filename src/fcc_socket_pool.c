@@ -0,0 +1,512 @@
+#include "fcc_socket_pool.h"
+#include "configuration.h"
+#include "connection.h"
+#include "rtp2httpd.h"
+#include "status.h"
+#include "utils.h"
+#include <errno.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef struct {
+  int sock;       /* Client or signal socket, -1 when unused */
+  int media_sock; /* Media socket of a pair, -1 otherwise */
+  int paired;
+  char ifname[IF_NAMESIZE];
+} fcc_socket_pool_entry_t;
+
+typedef struct {
+  int in_use;
+  int paired;
+  char ifname[IF_NAMESIZE];
+  int64_t last_used;
+} fcc_socket_pool_key_t;
+
+/* Pid of the worker process holding each port, 0 if none; mapped shared by
+ * the supervisor before workers are forked.  A hint that spares bind()
+ * attempts on ports known to be taken. */
+typedef struct {
+  _Atomic uint32_t owner[65536];
+} fcc_port_table_t;
+
+static fcc_port_table_t *port_table = NULL;
+
+/* Per event loop, like the poller the sockets are registered with; the
+ * first call marks all slots unused */
+static _Thread_local fcc_socket_pool_entry_t entries[FCC_SOCKET_POOL_SIZE];
+static _Thread_local fcc_socket_pool_key_t keys[FCC_SOCKET_POOL_KEYS];
+static _Thread_local int entries_ready;
+static _Thread_local uint32_t idle_count;
+static _Thread_local int next_port; /* Where the next probe starts, 0 if not yet chosen */
+static _Thread_local int range_min;  /* fcc-listen-port-range the parked sockets were bound in */
+static _Thread_local int range_max;
+
+static worker_stats_t *pool_stats(void) {
+  if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS)
+    return &status_shared->worker_stats[worker_id];
+  return NULL;
+}
+
+static void pool_update_gauge(void) {
+  worker_stats_t *stats = pool_stats();
+  if (stats)
+    stats->fcc_socket_pool_idle = idle_count;
+}
+
+/* ========== Port range and port map ========== */
+
+/**
+ * Ports to probe: fcc-listen-port-range, or 10000-65535 for pairs without
+ * one (single sockets then take an ephemeral port)
+ * @return 1 for a range, 0 for an ephemeral port, -1 if the range is empty
+ */
+static int pool_port_range(int paired, int *min_port, int *max_port) {
+  if (config.fcc_listen_port_min <= 0 || config.fcc_listen_port_max <= 0) {
+    if (!paired)
+      return 0;
+    *min_port = 10000;
+    *max_port = 65535;
+  } else {
+    *min_port = config.fcc_listen_port_min;
+    *max_port = config.fcc_listen_port_max;
+  }
+
+  if (*max_port < *min_port) {
+    int tmp = *min_port;
+    *min_port = *max_port;
+    *max_port = tmp;
+  }
+
+  /* A pair's media port leaves room for its signal port */
+  if (paired)
+    (*max_port)--;
+  if (*max_port > 65535 - paired)
+    *max_port = 65535 - paired;
+  if (*min_port < 1)
+    *min_port = 1;
+
+  return *max_port >= *min_port ? 1 : -1;
+}
+
+/* Whether spare sockets may be parked */
+static int pool_may_park(int paired) {
+  int min_port, max_port;
+  int ranged = pool_port_range(paired, &min_port, &max_port);
+  if (ranged < 0)
+    return 0;
+  return ranged == 0 || max_port - min_port + 1 >= FCC_SOCKET_POOL_MIN_RANGE;
+}
+
+/* Mark a port held by this process; fails if some worker already holds it */
+static int port_claim(int port) {
+  uint32_t expected = 0;
+  if (!port_table)
+    return 0;
+  return atomic_compare_exchange_strong(&port_table->owner[port], &expected, (uint32_t)getpid()) ? 0 : -1;
+}
+
+/* Give up a port this process claimed; other ports are left alone */
+static void port_release(int port) {
+  uint32_t expected = (uint32_t)getpid();
+  if (port_table && port > 0 && port < 65536)
+    atomic_compare_exchange_strong(&port_table->owner[port], &expected, 0);
+}
+
+static int socket_port(int sock) {
+  struct sockaddr_in sin;
+  socklen_t len = sizeof(sin);
+  if (sock < 0 || getsockname(sock, (struct sockaddr *)&sin, &len) < 0)
+    return 0;
+  return ntohs(sin.sin_port);
+}
+
+/* Close a socket and give up its port.  The port is released whatever the
+ * range is now, it may have been bound before a reload changed it;
+ * ephemeral ports were never claimed and are left alone by port_release(). */
+static void pool_close_socket(int sock) {
+  if (sock < 0)
+    return;
+  port_release(socket_port(sock));
+  close(sock);
+}
+
+/* ========== Socket creation ========== */
+
+static int pool_create_socket(const char *ifname, const char *label) {
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) {
+    logger(LOG_ERROR, "FCC: Failed to create %s socket: %s", label, strerror(errno));
+    return -1;
+  }
+
+  if (connection_set_nonblocking(sock) < 0) {
+    logger(LOG_ERROR, "FCC: Failed to set %s socket non-blocking: %s", label, strerror(errno));
+    close(sock);
+    return -1;
+  }
+
+  if (set_socket_rcvbuf(sock, config.udp_rcvbuf_size) < 0) {
+    logger(LOG_WARN, "FCC: Failed to set %s SO_RCVBUF to %d: %s", label, config.udp_rcvbuf_size, strerror(errno));
+  }
+
+  bind_to_upstream_interface(sock, ifname);
+
+  return sock;
+}
+
+/**
+ * Bind sock to port
+ * @return 0 on success, -1 if the port is taken, -2 on other errors
+ */
+static int pool_bind_port(int sock, int port, const char *label) {
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = INADDR_ANY;
+  sin.sin_port = htons((uint16_t)port);
+
+  if (bind(sock, (struct sockaddr *)&sin, sizeof(sin)) == 0)
+    return 0;
+  if (errno == EADDRINUSE || errno == EACCES)
+    return -1;
+  logger(LOG_DEBUG, "FCC: Failed to bind %s port %d: %s", label, port, strerror(errno));
+  return -2;
+}
+
+/* Bind a single socket, or a media/signal pair on ports N and N+1 */
+static int pool_bind_new(int paired, const char *ifname, int *sock, int *media_sock) {
+  int min_port, max_port;
+  int ranged = pool_port_range(paired, &min_port, &max_port);
+  const char *label = paired ? "media/signal socket pair" : "client socket";
+
+  *sock = -1;
+  *media_sock = -1;
+
+  if (ranged < 0) {
+    logger(LOG_ERROR, "FCC: Invalid %s port range", label);
+    return -1;
+  }
+
+  if (ranged == 0) {
+    *sock = pool_create_socket(ifname, "client");
+    if (*sock < 0)
+      return -1;
+    if (pool_bind_port(*sock, 0, "client") < 0) {
+      logger(LOG_ERROR, "FCC: Unable to bind client socket: %s", strerror(errno));
+      close(*sock);
+      *sock = -1;
+      return -1;
+    }
+    return 0;
+  }
+
+  int first = pool_create_socket(ifname, paired ? "media" : "client");
+  int second = -1;
+  if (first < 0)
+    return -1;
+  if (paired) {
+    second = pool_create_socket(ifname, "signal");
+    if (second < 0) {
+      close(first);
+      return -1;
+    }
+  }
+
+  int range = max_port - min_port + 1;
+  if (next_port < min_port || next_port > max_port)
+    next_port = min_port + (int)(get_time_ms() % range);
+
+  for (int i = 0; i < range; i++) {
+    int port = min_port + ((next_port - min_port + i) % range);
+
+    /* Ports held by any worker are skipped without a system call */
+    if (port_claim(port) < 0)
+      continue;
+    if (paired && port_claim(port + 1) < 0) {
+      port_release(port);
+      continue;
+    }
+
+    int r = pool_bind_port(first, port, paired ? "media" : "client");
+    if (r == 0 && paired)
+      r = pool_bind_port(second, port + 1, "signal");
+    if (r == 0) {
+      next_port = port + 1 + paired;
+      if (paired) {
+        *media_sock = first;
+        *sock = second;
+        logger(LOG_DEBUG, "FCC: Bound media socket to port %d, signal socket to port %d", port, port + 1);
+      } else {
+        *sock = first;
+        logger(LOG_DEBUG, "FCC: Bound client socket to port %d", port);
+      }
+      return 0;
+    }
+
+    port_release(port);
+    if (paired)
+      port_release(port + 1);
+
+    if (r == -2 || (paired && socket_port(first) != 0)) {
+      /* A socket that failed or is already bound cannot try another port */
+      close(first);
+      if (second >= 0)
+        close(second);
+      if (r == -2)
+        return -1;
+      first = pool_create_socket(ifname, "media");
+      second = pool_create_socket(ifname, "signal");
+      if (first < 0 || second < 0) {
+        if (first >= 0)
+          close(first);
+        if (second >= 0)
+          close(second);
+        return -1;
+      }
+    }
+  }
+
+  close(first);
+  if (second >= 0)
+    close(second);
+  logger(LOG_ERROR, "FCC: Unable to bind %s within port range %d-%d", label, min_port, max_port + paired);
+  return -1;
+}
+
+/* ========== Pool ========== */
+
+/* Discard datagrams left over from the previous session
+ * @return 0 once the socket is empty, -1 if it keeps receiving */
+static int pool_drain_socket(int sock) {
+  char byte;
+  if (sock < 0)
+    return 0;
+  for (int i = 0; i < FCC_SOCKET_POOL_DRAIN_MAX; i++) {
+    if (recv(sock, &byte, sizeof(byte), MSG_DONTWAIT) < 0)
+      return errno == EAGAIN ? 0 : -1;
+  }
+  return -1;
+}
+
+static int key_matches(int paired, const char *ifname, int other_paired, const char *other_ifname) {
+  return paired == other_paired && strcmp(ifname, other_ifname) == 0;
+}
+
+static void entry_close(fcc_socket_pool_entry_t *entry) {
+  if (entry->sock < 0)
+    return;
+  pool_close_socket(entry->sock);
+  pool_close_socket(entry->media_sock);
+  entry->sock = -1;
+  entry->media_sock = -1;
+  idle_count--;
+}
+
+/* Set up this event loop's pool, and start over when a reload changed
+ * fcc-listen-port-range: parked sockets are bound in the old range */
+static void pool_prepare(void) {
+  if (!entries_ready) {
+    for (int i = 0; i < FCC_SOCKET_POOL_SIZE; i++) {
+      entries[i].sock = -1;
+      entries[i].media_sock = -1;
+    }
+    range_min = config.fcc_listen_port_min;
+    range_max = config.fcc_listen_port_max;
+    entries_ready = 1;
+    return;
+  }
+
+  if (range_min == config.fcc_listen_port_min && range_max == config.fcc_listen_port_max)
+    return;
+
+  logger(LOG_INFO, "FCC: Listen port range changed, closing %u parked socket(s)", idle_count);
+  for (int i = 0; i < FCC_SOCKET_POOL_SIZE; i++)
+    entry_close(&entries[i]);
+  range_min = config.fcc_listen_port_min;
+  range_max = config.fcc_listen_port_max;
+  next_port = 0;
+  pool_update_gauge();
+}
+
+/* Park a spare socket (pair); closes it when there is no room */
+static void pool_park(int paired, const char *ifname, int sock, int media_sock) {
+  fcc_socket_pool_entry_t *slot = NULL;
+  int same = 0;
+
+  for (int i = 0; i < FCC_SOCKET_POOL_SIZE; i++) {
+    if (entries[i].sock < 0) {
+      if (!slot)
+        slot = &entries[i];
+    } else if (key_matches(paired, ifname, entries[i].paired, entries[i].ifname)) {
+      same++;
+    }
+  }
+
+  if (!slot || same >= FCC_SOCKET_POOL_SPARE || !pool_may_park(paired)) {
+    pool_close_socket(sock);
+    pool_close_socket(media_sock);
+    return;
+  }
+
+  slot->sock = sock;
+  slot->media_sock = media_sock;
+  slot->paired = paired;
+  snprintf(slot->ifname, sizeof(slot->ifname), "%s", ifname);
+  idle_count++;
+}
+
+/* Note demand for a kind, so that the tick keeps spares of it */
+static void pool_note_demand(int paired, const char *ifname) {
+  fcc_socket_pool_key_t *slot = NULL;
+  fcc_socket_pool_key_t *oldest = NULL;
+
+  for (int i = 0; i < FCC_SOCKET_POOL_KEYS; i++) {
+    fcc_socket_pool_key_t *key = &keys[i];
+    if (!key->in_use) {
+      if (!slot)
+        slot = key;
+      continue;
+    }
+    if (key_matches(paired, ifname, key->paired, key->ifname)) {
+      key->last_used = get_time_ms();
+      return;
+    }
+    if (!oldest || key->last_used < oldest->last_used)
+      oldest = key;
+  }
+
+  if (!slot)
+    slot = oldest;
+  slot->in_use = 1;
+  slot->paired = paired;
+  snprintf(slot->ifname, sizeof(slot->ifname), "%s", ifname);
+  slot->last_used = get_time_ms();
+}
+
+int fcc_socket_pool_acquire(int paired, const char *ifname, int *sock, int *media_sock) {
+  worker_stats_t *stats = pool_stats();
+
+  pool_prepare();
+  paired = paired ? 1 : 0;
+  if (!ifname || strlen(ifname) >= IF_NAMESIZE)
+    ifname = "";
+  pool_note_demand(paired, ifname);
+
+  for (int i = 0; i < FCC_SOCKET_POOL_SIZE; i++) {
+    fcc_socket_pool_entry_t *entry = &entries[i];
+    if (entry->sock < 0 || !key_matches(paired, ifname, entry->paired, entry->ifname))
+      continue;
+
+    /* Datagrams that arrived while parked are not for this session */
+    if (pool_drain_socket(entry->sock) < 0 || pool_drain_socket(entry->media_sock) < 0) {
+      logger(LOG_DEBUG, "FCC: Dropping parked socket that keeps receiving");
+      entry_close(entry);
+      continue;
+    }
+
+    *sock = entry->sock;
+    *media_sock = entry->media_sock;
+    entry->sock = -1;
+    entry->media_sock = -1;
+    idle_count--;
+    pool_update_gauge();
+    if (stats)
+      stats->fcc_socket_pool_hits++;
+    logger(LOG_DEBUG, "FCC: Using pre-bound %s on port %d", paired ? "socket pair" : "socket", socket_port(*sock));
+    return 0;
+  }
+
+  if (stats)
+    stats->fcc_socket_pool_misses++;
+  return pool_bind_new(paired, ifname, sock, media_sock);
+}
+
+void fcc_socket_pool_release(int paired, const char *ifname, int sock, int media_sock) {
+  (void)paired;
+  (void)ifname;
+
+  /* Not parked: the next zap usually talks to the same FCC server, and a
+   * burst still in flight to these ports would end up in the new stream.
+   * Spares bound by the tick come from the cursor, away from these ports. */
+  pool_close_socket(sock);
+  pool_close_socket(media_sock);
+}
+
+void fcc_socket_pool_tick(int64_t now) {
+  if (!entries_ready)
+    return;
+  pool_prepare();
+
+  for (int k = 0; k < FCC_SOCKET_POOL_KEYS; k++) {
+    fcc_socket_pool_key_t *key = &keys[k];
+    if (!key->in_use)
+      continue;
+
+    int idle = 0;
+    int expired = now - key->last_used >= (int64_t)FCC_SOCKET_POOL_IDLE_SEC * 1000;
+    for (int i = 0; i < FCC_SOCKET_POOL_SIZE; i++) {
+      fcc_socket_pool_entry_t *entry = &entries[i];
+      if (entry->sock < 0 || !key_matches(key->paired, key->ifname, entry->paired, entry->ifname))
+        continue;
+      if (expired)
+        entry_close(entry);
+      else
+        idle++;
+    }
+    if (expired) {
+      key->in_use = 0;
+      continue;
+    }
+
+    /* Bind this kind's spares off the channel change path */
+    while (idle < FCC_SOCKET_POOL_SPARE && idle_count < FCC_SOCKET_POOL_SIZE && pool_may_park(key->paired)) {
+      int sock, media_sock;
+      if (pool_bind_new(key->paired, key->ifname, &sock, &media_sock) < 0)
+        break;
+      pool_park(key->paired, key->ifname, sock, media_sock);
+      idle++;
+    }
+  }
+  pool_update_gauge();
+}
+
+void fcc_socket_pool_cleanup(void) {
+  if (!entries_ready)
+    return;
+  for (int i = 0; i < FCC_SOCKET_POOL_SIZE; i++)
+    entry_close(&entries[i]);
+  memset(keys, 0, sizeof(keys));
+  pool_update_gauge();
+}
+
+int fcc_socket_pool_init_ports(void) {
+  void *mapped = mmap(NULL, sizeof(*port_table), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    logger(LOG_WARN, "FCC: Failed to map port table, probing ports with bind() only: %s", strerror(errno));
+    return -1;
+  }
+  port_table = mapped;
+  return 0;
+}
+
+void fcc_socket_pool_reap(pid_t dead_pid) {
+  if (!port_table || dead_pid <= 0)
+    return;
+  for (int port = 1; port < 65536; port++) {
+    uint32_t expected = (uint32_t)dead_pid;
+    atomic_compare_exchange_strong(&port_table->owner[port], &expected, 0);
+  }
+}
+
+void fcc_socket_pool_cleanup_ports(void) {
+  if (port_table) {
+    munmap(port_table, sizeof(*port_table));
+    port_table = NULL;
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef __FCC_SOCKET_POOL_H__
+#define __FCC_SOCKET_POOL_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Idle FCC sockets (single sockets or media/signal pairs) kept per event loop */
+#define FCC_SOCKET_POOL_SIZE 16
+
+/* Idle sockets kept ready per kind and upstream interface once one was used */
+#define FCC_SOCKET_POOL_SPARE 2
+
+/* Demanded kinds (single or pair, upstream interface) tracked per event loop */
+#define FCC_SOCKET_POOL_KEYS 8
+
+/* Smallest fcc-listen-port-range idle sockets are kept for: in a narrower
+ * range, ports parked in one worker would be missing in the others */
+#define FCC_SOCKET_POOL_MIN_RANGE 64
+
+/* Seconds idle sockets of a kind nobody asked for again are kept */
+#define FCC_SOCKET_POOL_IDLE_SEC 300
+
+/* Stray datagrams discarded before a spare socket is handed out; a
+ * socket still flooded after that is closed instead */
+#define FCC_SOCKET_POOL_DRAIN_MAX 256
+
+/**
+ * FCC socket pool
+ *
+ * Each FCC session needs a UDP socket bound within fcc-listen-port-range
+ * (Telecom/ZTE/Fiberhome), or a media/signal pair on ports N and N+1
+ * (Huawei).  Creating, sizing and bind()-probing them on every zap puts a
+ * linear walk of the port range on the channel change path.
+ *
+ * Instead, sockets are created, sized to udp-rcvbuf-size, bound to the
+ * upstream interface and to a port here:
+ *
+ * - A table shared by all worker processes records which worker process
+ *   holds each port, so probing skips them without a bind() attempt; a
+ *   per-worker cursor continues after the last port handed out.  A port is
+ *   released by the process that claimed it, whatever the range is by then,
+ *   and the supervisor releases the ports of a worker that died.  bind()
+ *   still has the final word, the table does not know about other programs.
+ * - Once a kind has been used, fcc_socket_pool_tick() keeps
+ *   FCC_SOCKET_POOL_SPARE of it bound ahead of time, parked and keyed by
+ *   kind and upstream interface, and drops them after
+ *   FCC_SOCKET_POOL_IDLE_SEC without demand.  The next zap takes one,
+ *   drained of stray datagrams.
+ * - Sockets of ended sessions are closed, not parked: the next session
+ *   usually talks to the same FCC server, and the tail of the previous
+ *   unicast burst would reach it on a reused port.
+ * - When a reload changes fcc-listen-port-range, parked sockets are closed
+ *   and probing starts over in the new range.
+ *
+ * With a listen port range narrower than FCC_SOCKET_POOL_MIN_RANGE no
+ * spares are kept.
+ */
+
+/**
+ * Take a bound FCC socket (pair)
+ * Parked sockets are handed out first; otherwise new ones are bound.
+ * @param paired Nonzero for a Huawei media/signal pair
+ * @param ifname Upstream interface, NULL or "" for none
+ * @param sock Receives the client (Telecom) or signal (Huawei) socket
+ * @param media_sock Receives the media socket of a pair, -1 otherwise
+ * @return 0 on success, -1 if no port could be bound
+ */
+int fcc_socket_pool_acquire(int paired, const char *ifname, int *sock, int *media_sock);
+
+/**
+ * Return the sockets of an ended session
+ * They must already be removed from the poller and fdmap; the pool closes
+ * them and gives up their ports.
+ * @param paired Nonzero for a Huawei media/signal pair
+ * @param ifname Upstream interface the sockets were acquired for
+ * @param sock Client or signal socket, -1 if none
+ * @param media_sock Media socket of a pair, -1 if none
+ */
+void fcc_socket_pool_release(int paired, const char *ifname, int sock, int media_sock);
+
+/** Bind spare sockets for the kinds in use, drop the ones no longer used */
+void fcc_socket_pool_tick(int64_t now);
+
+/** Close all parked sockets of this event loop */
+void fcc_socket_pool_cleanup(void);
+
+/**
+ * Map the port table shared by all workers
+ * Called by the supervisor before workers are forked.  Without it, ports
+ * are probed with bind() alone.
+ * @return 0 on success, -1 on error
+ */
+int fcc_socket_pool_init_ports(void);
+
+/** Release the ports held by a worker process that exited */
+void fcc_socket_pool_reap(pid_t dead_pid);
+
+/** Unmap the port table */
+void fcc_socket_pool_cleanup_ports(void);
+
+#endif /* __FCC_SOCKET_POOL_H__ */
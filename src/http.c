@@ -3,11 +3,23 @@
 #include "connection.h"
 #include "utils.h"
 #include <ctype.h>
+#include <errno.h>
 #include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define HTTP_SCAN_NEON 1
+#endif
 
 /* Maximum allowed request body size (4MB) to prevent OOM from malicious
  * requests */
@@ -23,6 +35,8 @@ static const char *response_codes[] = {
     "HTTP/1.1 401 Unauthorized\r\n",          /* 6 */
     "HTTP/1.1 304 Not Modified\r\n",          /* 7 */
     "HTTP/1.1 204 No Content\r\n",            /* 8 */
+    "HTTP/1.1 206 Partial Content\r\n",       /* 9 */
+    "HTTP/1.1 416 Range Not Satisfiable\r\n", /* 10 */
 };
 
 void send_http_headers(connection_t *c, http_status_t status, const char *content_type, const char *extra_headers) {
@@ -45,9 +59,19 @@ void send_http_headers(connection_t *c, http_status_t status, const char *conten
                     "Cache-Control: no-cache\r\n"
                     "Connection: keep-alive\r\n");
   } else {
-    /* For non-SSE responses, always close the connection (no keep-alive
-     * support) */
-    len += snprintf(headers + len, sizeof(headers) - len, "Connection: close\r\n");
+    /* Only a response the client can delimit lets the connection carry the
+     * next request; anything else is ended by closing */
+    if (c->keepalive && status != STATUS_204 && status != STATUS_304 &&
+        !(extra_headers && strstr(extra_headers, "Content-Length:")))
+      c->keepalive = 0;
+
+    if (c->keepalive)
+      len += snprintf(headers + len, sizeof(headers) - len,
+                      "Connection: keep-alive\r\n"
+                      "Keep-Alive: timeout=%d, max=%d\r\n",
+                      config.http_keepalive_timeout, config.http_keepalive_requests - (int)c->requests_served);
+    else
+      len += snprintf(headers + len, sizeof(headers) - len, "Connection: close\r\n");
   }
 
   /* Set-Cookie for r2h-token if needed (token was provided via URL query) */
@@ -183,12 +207,25 @@ int http_build_r2h_token_cookie_header(char *buffer, size_t buffer_size, const c
 void http_request_init(http_request_t *req) {
   if (!req)
     return;
-  memset(req, 0, sizeof(*req));
+  /* The header slice table is only read up to header_count */
+  memset(req, 0, offsetof(http_request_t, headers));
+  req->method = "";
+  req->url = "";
+  req->hostname = "";
+  req->user_agent = "";
+  req->accept = "";
+  req->if_none_match = "";
+  req->if_modified_since = "";
+  req->if_range = "";
+  req->range = "";
+  req->x_forwarded_for = "";
+  req->x_forwarded_host = "";
+  req->x_forwarded_proto = "";
+  req->cookie = "";
+  req->access_control_request_method = "";
+  req->access_control_request_headers = "";
   req->parse_state = HTTP_PARSE_REQ_LINE;
   req->content_length = -1;
-  req->body = NULL;
-  req->body_len = 0;
-  req->body_alloc = 0;
 }
 
 void http_request_cleanup(http_request_t *req) {
@@ -202,199 +239,212 @@ void http_request_cleanup(http_request_t *req) {
   req->body_alloc = 0;
 }
 
-int http_parse_request(char *inbuf, int *in_len, http_request_t *req) {
-  if (!inbuf || !in_len || !req)
-    return -1;
+/* Whether a comma-separated header value lists token (case-insensitive) */
+static int http_header_has_token(const char *value, const char *token) {
+  size_t token_len = strlen(token);
+  const char *p = value;
 
-  /* Parse HTTP request line */
-  if (req->parse_state == HTTP_PARSE_REQ_LINE) {
-    char *line_end = strstr(inbuf, "\r\n");
-    if (!line_end)
-      return 0; /* Need more data */
+  while (*p) {
+    while (*p == ' ' || *p == '\t' || *p == ',')
+      p++;
+    const char *end = p;
+    while (*end && *end != ',')
+      end++;
+    const char *last = end;
+    while (last > p && (last[-1] == ' ' || last[-1] == '\t'))
+      last--;
+    if ((size_t)(last - p) == token_len && strncasecmp(p, token, token_len) == 0)
+      return 1;
+    p = end;
+  }
+  return 0;
+}
 
-    size_t line_len = (size_t)(line_end - inbuf) + 2;
-    *line_end = '\0';
-
-    /* Parse: METHOD URL HTTP/1.x */
-    char *sp1 = strchr(inbuf, ' ');
-    if (sp1) {
-      *sp1 = '\0';
-      strncpy(req->method, inbuf, sizeof(req->method) - 1);
-      req->method[sizeof(req->method) - 1] = '\0';
-
-      char *sp2 = strchr(sp1 + 1, ' ');
-      if (sp2) {
-        *sp2 = '\0';
-        strncpy(req->url, sp1 + 1, sizeof(req->url) - 1);
-        req->url[sizeof(req->url) - 1] = '\0';
-      }
-    }
+/**
+ * Find the first a or b in the len bytes at s
+ * Sixteen bytes are compared per step with SSE2 or NEON where available.
+ * @return Offset of the match, or len
+ */
+static size_t http_scan2(const char *s, size_t len, char a, char b) {
+  const char *p = s;
+  const char *end = s + len;
+#if defined(__SSE2__)
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+    if (mask)
+      return (size_t)(p - s) + (size_t)__builtin_ctz((unsigned int)mask);
+  }
+#elif defined(HTTP_SCAN_NEON)
+  const uint8x16_t va = vdupq_n_u8((uint8_t)a);
+  const uint8x16_t vb = vdupq_n_u8((uint8_t)b);
+  for (; end - p >= 16; p += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)p);
+    uint8x16_t eq = vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb));
+    /* Narrow every byte to a nibble so the match mask fits in 64 bits */
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if (mask)
+      return (size_t)(p - s) + (size_t)(__builtin_ctzll(mask) >> 2);
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == a || *p == b)
+      return (size_t)(p - s);
+  }
+  return len;
+}
+
+/* Case-insensitive match of a header name slice */
+static int header_name_is(const char *name, size_t name_len, const char *expected) {
+  return strlen(expected) == name_len && strncasecmp(name, expected, name_len) == 0;
+}
 
-    /* Shift buffer */
-    memmove(inbuf, inbuf + line_len, *in_len - (int)line_len);
-    *in_len -= (int)line_len;
-    req->parse_state = HTTP_PARSE_HEADERS;
+/**
+ * Record one header line and pick up the headers routes use
+ * @param line Start of the line (header name)
+ * @param colon First ':' of the line
+ * @param line_end End of the line (already NUL)
+ */
+static void parse_header_line(http_request_t *req, char *inbuf, char *line, char *colon, char *line_end) {
+  size_t name_len = (size_t)(colon - line);
+  char *value = colon + 1;
+
+  /* Skip leading whitespace, trim trailing whitespace */
+  while (*value == ' ' || *value == '\t')
+    value++;
+  char *value_end = line_end;
+  while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+    value_end--;
+  *value_end = '\0';
+
+  if (req->header_count < HTTP_MAX_HEADERS) {
+    http_header_slice_t *h = &req->headers[req->header_count++];
+    h->name_off = (uint16_t)(line - inbuf);
+    h->name_len = (uint16_t)name_len;
+    h->value_off = (uint16_t)(value - inbuf);
+    h->value_len = (uint16_t)(value_end - value);
   }
 
-  /* Parse headers */
-  if (req->parse_state == HTTP_PARSE_HEADERS) {
-    for (;;) {
-      char *line_end = strstr(inbuf, "\r\n");
-      if (!line_end)
-        return 0; /* Need more data */
+  if (header_name_is(line, name_len, "Host")) {
+    req->hostname = value;
+  } else if (header_name_is(line, name_len, "User-Agent")) {
+    req->user_agent = value;
+  } else if (header_name_is(line, name_len, "Accept")) {
+    req->accept = value;
+  } else if (header_name_is(line, name_len, "If-None-Match")) {
+    req->if_none_match = value;
+  } else if (header_name_is(line, name_len, "If-Modified-Since")) {
+    req->if_modified_since = value;
+  } else if (header_name_is(line, name_len, "If-Range")) {
+    req->if_range = value;
+  } else if (header_name_is(line, name_len, "Range")) {
+    req->range = value;
+  } else if (header_name_is(line, name_len, "Connection")) {
+    if (http_header_has_token(value, "close"))
+      req->keep_alive = 0;
+    else if (http_header_has_token(value, "keep-alive"))
+      req->keep_alive = 1;
+  } else if (header_name_is(line, name_len, "X-Request-Snapshot")) {
+    req->x_request_snapshot = (value[0] == '1');
+  } else if (header_name_is(line, name_len, "X-Forwarded-For")) {
+    /* Keep the first address of "ip1, ip2, ip3" (not forwarded upstream,
+     * so cutting the value in place is safe) */
+    char *comma = strchr(value, ',');
+    if (comma) {
+      while (comma > value && (comma[-1] == ' ' || comma[-1] == '\t'))
+        comma--;
+      *comma = '\0';
+    }
+    req->x_forwarded_for = value;
+  } else if (header_name_is(line, name_len, "X-Forwarded-Host")) {
+    req->x_forwarded_host = value;
+  } else if (header_name_is(line, name_len, "X-Forwarded-Proto")) {
+    req->x_forwarded_proto = value;
+  } else if (header_name_is(line, name_len, "Content-Length")) {
+    char *endptr;
+    long cl = strtol(value, &endptr, 10);
+    if (*endptr != '\0' || cl < 0 || cl > INT_MAX) {
+      req->content_length = 0;
+    } else {
+      req->content_length = (int)cl;
+    }
+  } else if (header_name_is(line, name_len, "Cookie")) {
+    req->cookie = value;
+  } else if (header_name_is(line, name_len, "Access-Control-Request-Method")) {
+    req->access_control_request_method = value;
+  } else if (header_name_is(line, name_len, "Access-Control-Request-Headers")) {
+    req->access_control_request_headers = value;
+  }
+}
 
-      size_t line_len = (size_t)(line_end - inbuf) + 2;
+int http_parse_request(char *inbuf, int *in_len, http_request_t *req) {
+  if (!inbuf || !in_len || !req || *in_len < 0 || *in_len > UINT16_MAX)
+    return -1;
 
-      /* Empty line = end of headers */
-      if (line_len == 2) {
-        memmove(inbuf, inbuf + 2, *in_len - 2);
-        *in_len -= 2;
+  /* Parse the request line and headers in place, one complete line at a
+   * time; parse_off remembers where an incomplete line starts */
+  if (req->parse_state == HTTP_PARSE_REQ_LINE || req->parse_state == HTTP_PARSE_HEADERS) {
+    req->head = inbuf;
 
-        /* Check if we need to read body */
-        if (req->content_length > 0) {
-          req->parse_state = HTTP_PARSE_BODY;
-          break; /* Exit header parsing loop to read body */
-        } else {
-          req->parse_state = HTTP_PARSE_COMPLETE;
-          return 1; /* Request complete */
-        }
+    for (;;) {
+      char *line = inbuf + req->parse_off;
+      size_t avail = (size_t)*in_len - req->parse_off;
+      /* A header's ':' is found in the same pass as its line end */
+      char *colon = NULL;
+      size_t pos = http_scan2(line, avail, '\n', ':');
+      if (pos < avail && line[pos] == ':') {
+        colon = line + pos;
+        pos += 1 + http_scan2(colon + 1, avail - pos - 1, '\n', '\n');
       }
+      if (pos == avail)
+        return 0; /* Need more data */
 
-      *line_end = '\0';
-
-      /* Parse header: Name: Value */
-      char *colon = strchr(inbuf, ':');
-      if (colon) {
-        *colon = '\0';
-        char *value = colon + 1;
-        /* Skip leading whitespace */
-        while (*value == ' ' || *value == '\t')
-          value++;
-
-        /* Trim trailing whitespace */
-        char *value_end = value + strlen(value);
-        while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
-          value_end--;
-          *value_end = '\0';
-        }
+      char *nl = line + pos;
 
-        /* Save raw headers for proxy forwarding (exclude Host, Connection,
-         * Content-Length, Transfer-Encoding which are handled specially,
-         * Accept-Encoding to prevent compressed responses that break rewriting,
-         * and X-Forwarded-* headers which should not be forwarded to upstream).
-         * Cookie and User-Agent are filtered to remove r2h-token before forwarding. */
-        if (strcasecmp(inbuf, "Host") != 0 && strcasecmp(inbuf, "Connection") != 0 &&
-            strcasecmp(inbuf, "Content-Length") != 0 && strcasecmp(inbuf, "Transfer-Encoding") != 0 &&
-            strcasecmp(inbuf, "Accept-Encoding") != 0 && strcasecmp(inbuf, "X-Forwarded-For") != 0 &&
-            strcasecmp(inbuf, "X-Forwarded-Host") != 0 && strcasecmp(inbuf, "X-Forwarded-Proto") != 0) {
-          const char *filtered_value = value;
-          char filter_buf[HTTP_COOKIE_BUFFER_SIZE];
-
-          /* Filter r2h-token from Cookie header */
-          if (strcasecmp(inbuf, "Cookie") == 0 && config.r2h_token && config.r2h_token[0] != '\0') {
-            int flen = http_filter_cookie(value, "r2h-token", filter_buf, sizeof(filter_buf));
-            if (flen > 0) {
-              filtered_value = filter_buf;
-            } else if (flen == 0) {
-              /* Cookie is empty after filtering, skip this header */
-              filtered_value = NULL;
-            } else {
-              logger(LOG_WARN, "Dropping Cookie header after r2h-token filtering failed");
-              filtered_value = NULL;
-            }
-          }
-          /* Filter R2HTOKEN/xxx from User-Agent header */
-          else if (strcasecmp(inbuf, "User-Agent") == 0 && config.r2h_token && config.r2h_token[0] != '\0') {
-            int flen = http_filter_user_agent_token(value, filter_buf, sizeof(filter_buf));
-            if (flen > 0) {
-              filtered_value = filter_buf;
-            }
-          }
+      uint16_t next_off = (uint16_t)(nl + 1 - inbuf);
+      char *line_end = (nl > line && nl[-1] == '\r') ? nl - 1 : nl;
+      *line_end = '\0';
 
-          if (filtered_value && filtered_value[0]) {
-            size_t header_line_len = strlen(inbuf) + 2 + strlen(filtered_value) + 2; /* "Name: Value\r\n" */
-            if (req->raw_headers_len + header_line_len < sizeof(req->raw_headers) - 1) {
-              int added =
-                  snprintf(req->raw_headers + req->raw_headers_len, sizeof(req->raw_headers) - req->raw_headers_len,
-                           "%s: %s\r\n", inbuf, filtered_value);
-              if (added > 0) {
-                req->raw_headers_len += (size_t)added;
-              }
-            }
+      if (req->parse_state == HTTP_PARSE_REQ_LINE) {
+        /* Parse: METHOD URL HTTP/1.x */
+        char *sp1 = strchr(line, ' ');
+        if (sp1) {
+          *sp1 = '\0';
+          req->method = line;
+
+          char *sp2 = strchr(sp1 + 1, ' ');
+          if (sp2) {
+            *sp2 = '\0';
+            req->url = sp1 + 1;
+            /* HTTP/1.1 connections are persistent unless the client says otherwise */
+            req->http_1_1 = strcmp(sp2 + 1, "HTTP/1.1") == 0;
+            req->keep_alive = req->http_1_1;
           }
         }
+        req->parse_state = HTTP_PARSE_HEADERS;
+      } else if (line_end == line) {
+        /* Empty line = end of headers */
+        req->parse_off = next_off;
+        req->head_len = next_off;
 
-        /* Extract interesting headers */
-        if (strcasecmp(inbuf, "Host") == 0) {
-          strncpy(req->hostname, value, sizeof(req->hostname) - 1);
-          req->hostname[sizeof(req->hostname) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "User-Agent") == 0) {
-          strncpy(req->user_agent, value, sizeof(req->user_agent) - 1);
-          req->user_agent[sizeof(req->user_agent) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "Accept") == 0) {
-          strncpy(req->accept, value, sizeof(req->accept) - 1);
-          req->accept[sizeof(req->accept) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "If-None-Match") == 0) {
-          strncpy(req->if_none_match, value, sizeof(req->if_none_match) - 1);
-          req->if_none_match[sizeof(req->if_none_match) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "X-Request-Snapshot") == 0) {
-          req->x_request_snapshot = (value[0] == '1');
-        } else if (strcasecmp(inbuf, "X-Forwarded-For") == 0) {
-          /* Extract first IP from X-Forwarded-For (format: "ip1, ip2, ip3") */
-          const char *comma = strchr(value, ',');
-          size_t ip_len;
-          if (comma) {
-            ip_len = (size_t)(comma - value);
-          } else {
-            ip_len = strlen(value);
-          }
-
-          /* Copy first IP, limiting to buffer size */
-          if (ip_len >= sizeof(req->x_forwarded_for)) {
-            ip_len = sizeof(req->x_forwarded_for) - 1;
-          }
-          strncpy(req->x_forwarded_for, value, ip_len);
-          req->x_forwarded_for[ip_len] = '\0';
-
-          /* Trim trailing whitespace */
-          char *end = req->x_forwarded_for + ip_len;
-          while (end > req->x_forwarded_for && (end[-1] == ' ' || end[-1] == '\t')) {
-            end--;
-            *end = '\0';
-          }
-        } else if (strcasecmp(inbuf, "X-Forwarded-Host") == 0) {
-          strncpy(req->x_forwarded_host, value, sizeof(req->x_forwarded_host) - 1);
-          req->x_forwarded_host[sizeof(req->x_forwarded_host) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "X-Forwarded-Proto") == 0) {
-          strncpy(req->x_forwarded_proto, value, sizeof(req->x_forwarded_proto) - 1);
-          req->x_forwarded_proto[sizeof(req->x_forwarded_proto) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "Content-Length") == 0) {
-          char *endptr;
-          long cl = strtol(value, &endptr, 10);
-          if (*endptr != '\0' || cl < 0 || cl > INT_MAX) {
-            req->content_length = 0;
-          } else {
-            req->content_length = (int)cl;
-          }
-        } else if (strcasecmp(inbuf, "Cookie") == 0) {
-          strncpy(req->cookie, value, sizeof(req->cookie) - 1);
-          req->cookie[sizeof(req->cookie) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "Access-Control-Request-Method") == 0) {
-          strncpy(req->access_control_request_method, value, sizeof(req->access_control_request_method) - 1);
-          req->access_control_request_method[sizeof(req->access_control_request_method) - 1] = '\0';
-        } else if (strcasecmp(inbuf, "Access-Control-Request-Headers") == 0) {
-          strncpy(req->access_control_request_headers, value, sizeof(req->access_control_request_headers) - 1);
-          req->access_control_request_headers[sizeof(req->access_control_request_headers) - 1] = '\0';
+        /* Check if we need to read body */
+        if (req->content_length > 0) {
+          req->parse_state = HTTP_PARSE_BODY;
+          break; /* Exit header parsing loop to read body */
         }
+        req->parse_state = HTTP_PARSE_COMPLETE;
+        return 1; /* Request complete */
+      } else if (colon && colon < line_end) {
+        parse_header_line(req, inbuf, line, colon, line_end);
       }
 
-      /* Shift buffer */
-      memmove(inbuf, inbuf + line_len, *in_len - (int)line_len);
-      *in_len -= (int)line_len;
+      req->parse_off = next_off;
     }
   }
 
-  /* Parse body if needed */
+  /* Parse body if needed; body bytes follow the head in inbuf */
   if (req->parse_state == HTTP_PARSE_BODY) {
     size_t body_size = (size_t)req->content_length;
 
@@ -415,15 +465,15 @@ int http_parse_request(char *inbuf, int *in_len, http_request_t *req) {
 
     /* Calculate how much more we need */
     size_t remaining = body_size - req->body_len;
-    size_t available = (size_t)*in_len;
+    size_t available = (size_t)*in_len - req->head_len;
     size_t to_copy = (available < remaining) ? available : remaining;
 
     if (to_copy > 0) {
-      memcpy(req->body + req->body_len, inbuf, to_copy);
+      memcpy(req->body + req->body_len, inbuf + req->head_len, to_copy);
       req->body_len += to_copy;
 
-      /* Shift buffer */
-      memmove(inbuf, inbuf + to_copy, *in_len - (int)to_copy);
+      /* Shift what follows the body (with its terminator) up to the head */
+      memmove(inbuf + req->head_len, inbuf + req->head_len + to_copy, available - to_copy + 1);
       *in_len -= (int)to_copy;
     }
 
@@ -440,6 +490,92 @@ int http_parse_request(char *inbuf, int *in_len, http_request_t *req) {
   return 0;
 }
 
+void http_request_consume(char *inbuf, int *in_len, http_request_t *req) {
+  if (!inbuf || !in_len || !req)
+    return;
+
+  int used = req->head_len < *in_len ? req->head_len : *in_len;
+  memmove(inbuf, inbuf + used, (size_t)(*in_len - used) + 1);
+  *in_len -= used;
+  req->head_len = 0;
+  req->header_count = 0;
+}
+
+int http_request_format_forward_headers(const http_request_t *req, char *buf, size_t size, int skip_user_agent) {
+  /* Handled specially, rewritten upstream, or would break content rewriting */
+  static const char *const skipped[] = {"Host",
+                                        "Connection",
+                                        "Content-Length",
+                                        "Transfer-Encoding",
+                                        "Accept-Encoding",
+                                        "X-Forwarded-For",
+                                        "X-Forwarded-Host",
+                                        "X-Forwarded-Proto"};
+  char filter_buf[HTTP_COOKIE_BUFFER_SIZE];
+  int filter_token = config.r2h_token && config.r2h_token[0] != '\0';
+  size_t len = 0;
+
+  if (!req || !buf || !req->head)
+    return 0;
+
+  for (uint16_t i = 0; i < req->header_count; i++) {
+    const http_header_slice_t *h = &req->headers[i];
+    const char *name = req->head + h->name_off;
+    const char *value = req->head + h->value_off;
+    size_t value_len = h->value_len;
+    int is_skipped = 0;
+
+    for (size_t k = 0; k < sizeof(skipped) / sizeof(skipped[0]); k++) {
+      if (header_name_is(name, h->name_len, skipped[k])) {
+        is_skipped = 1;
+        break;
+      }
+    }
+    if (is_skipped)
+      continue;
+
+    int is_user_agent = header_name_is(name, h->name_len, "User-Agent");
+    if (is_user_agent && skip_user_agent)
+      continue;
+
+    /* Filter r2h-token from Cookie header */
+    if (filter_token && header_name_is(name, h->name_len, "Cookie")) {
+      int flen = http_filter_cookie(value, "r2h-token", filter_buf, sizeof(filter_buf));
+      if (flen < 0) {
+        logger(LOG_WARN, "Dropping Cookie header after r2h-token filtering failed");
+        continue;
+      }
+      value = filter_buf;
+      value_len = (size_t)flen;
+    }
+    /* Filter R2HTOKEN/xxx from User-Agent header */
+    else if (filter_token && is_user_agent) {
+      int flen = http_filter_user_agent_token(value, filter_buf, sizeof(filter_buf));
+      if (flen > 0) {
+        value = filter_buf;
+        value_len = (size_t)flen;
+      }
+    }
+
+    if (value_len == 0)
+      continue;
+
+    /* "Name: Value\r\n" */
+    if (len + h->name_len + value_len + 4 > size)
+      return -1;
+    memcpy(buf + len, name, h->name_len);
+    len += h->name_len;
+    memcpy(buf + len, ": ", 2);
+    len += 2;
+    memcpy(buf + len, value, value_len);
+    len += value_len;
+    memcpy(buf + len, "\r\n", 2);
+    len += 2;
+  }
+
+  return (int)len;
+}
+
 /**
  * Find parameter in query/form string (case-insensitive)
  * @param query_string Query or form data string
@@ -735,54 +871,42 @@ int http_filter_query_param(const char *query_string, const char *exclude_param,
   return (int)out_len;
 }
 
-void http_send_400(connection_t *conn) {
-  static const char body[] = "<!doctype html><title>400</title>Bad Request";
+/* Send a canned error page; Content-Length keeps the connection reusable */
+static void send_error_page(connection_t *conn, http_status_t status, const char *body, size_t body_len,
+                            const char *additional_headers) {
+  char extra_headers[128];
 
-  /* Send headers */
-  send_http_headers(conn, STATUS_400, "text/html; charset=utf-8", NULL);
+  snprintf(extra_headers, sizeof(extra_headers), "Content-Length: %zu\r\n%s", body_len,
+           additional_headers ? additional_headers : "");
+  send_http_headers(conn, status, "text/html; charset=utf-8", extra_headers);
 
   /* Send body and flush */
-  connection_queue_output_and_flush(conn, (const uint8_t *)body, sizeof(body) - 1);
+  connection_queue_output_and_flush(conn, (const uint8_t *)body, body_len);
+}
+
+void http_send_400(connection_t *conn) {
+  static const char body[] = "<!doctype html><title>400</title>Bad Request";
+  send_error_page(conn, STATUS_400, body, sizeof(body) - 1, NULL);
 }
 
 void http_send_404(connection_t *conn) {
   static const char body[] = "<!doctype html><title>404</title>Not Found";
-
-  /* Send headers */
-  send_http_headers(conn, STATUS_404, "text/html; charset=utf-8", NULL);
-
-  /* Send body and flush */
-  connection_queue_output_and_flush(conn, (const uint8_t *)body, sizeof(body) - 1);
+  send_error_page(conn, STATUS_404, body, sizeof(body) - 1, NULL);
 }
 
 void http_send_500(connection_t *conn) {
   static const char body[] = "<!doctype html><title>500</title>Internal Server Error";
-
-  /* Send headers */
-  send_http_headers(conn, STATUS_500, "text/html; charset=utf-8", NULL);
-
-  /* Send body and flush */
-  connection_queue_output_and_flush(conn, (const uint8_t *)body, sizeof(body) - 1);
+  send_error_page(conn, STATUS_500, body, sizeof(body) - 1, NULL);
 }
 
 void http_send_503(connection_t *conn) {
   static const char body[] = "<!doctype html><title>503</title>Service Unavailable";
-
-  /* Send headers */
-  send_http_headers(conn, STATUS_503, "text/html; charset=utf-8", NULL);
-
-  /* Send body and flush */
-  connection_queue_output_and_flush(conn, (const uint8_t *)body, sizeof(body) - 1);
+  send_error_page(conn, STATUS_503, body, sizeof(body) - 1, NULL);
 }
 
 void http_send_401(connection_t *conn) {
   static const char body[] = "<!doctype html><title>401</title>Unauthorized";
-
-  /* Send headers with WWW-Authenticate */
-  send_http_headers(conn, STATUS_401, "text/html; charset=utf-8", "WWW-Authenticate: Bearer\r\n");
-
-  /* Send body and flush */
-  connection_queue_output_and_flush(conn, (const uint8_t *)body, sizeof(body) - 1);
+  send_error_page(conn, STATUS_401, body, sizeof(body) - 1, "WWW-Authenticate: Bearer\r\n");
 }
 
 int http_parse_url_components(const char *url, char *protocol, char *host, char *port, char *path) {
@@ -1056,3 +1180,298 @@ int http_build_etag_headers(char *buffer, size_t buffer_size, size_t content_len
 
   return written;
 }
+
+typedef struct {
+  size_t start;
+  size_t len;
+} http_byte_range_t;
+
+/* Format an IMF-fixdate (RFC 7231) without depending on the C locale */
+static void format_http_date(time_t t, char *out, size_t out_size) {
+  static const char *const days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  static const char *const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  struct tm tm;
+
+  gmtime_r(&t, &tm);
+  snprintf(out, out_size, "%s, %02d %s %04d %02d:%02d:%02d GMT", days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon],
+           tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+time_t http_parse_date(const char *s) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char month[4];
+  struct tm tm;
+
+  memset(&tm, 0, sizeof(tm));
+  if (sscanf(s, "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &tm.tm_mday, month, &tm.tm_year, &tm.tm_hour, &tm.tm_min,
+             &tm.tm_sec) != 6)
+    return -1;
+  const char *m = strstr(months, month);
+  if (!m || strlen(month) != 3 || (m - months) % 3 != 0)
+    return -1;
+  tm.tm_mon = (int)((m - months) / 3);
+  tm.tm_year -= 1900;
+  return timegm(&tm);
+}
+
+/* Coalesce overlapping or adjacent ranges (RFC 7233 section 4.1), so a
+ * header like "bytes=0-,0-,0-" cannot make us send the body many times.
+ * Ranges stay in request order unless some had to be merged.
+ * Returns the new range count */
+static int coalesce_ranges(http_byte_range_t *ranges, int count) {
+  http_byte_range_t sorted[HTTP_MAX_RANGES];
+  int merged = 0;
+  int out = 0;
+
+  if (count < 2 || count > HTTP_MAX_RANGES)
+    return count;
+
+  memcpy(sorted, ranges, (size_t)count * sizeof(*ranges));
+  for (int i = 1; i < count; i++) {
+    http_byte_range_t r = sorted[i];
+    int j = i;
+    for (; j > 0 && sorted[j - 1].start > r.start; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = r;
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (out > 0 && sorted[i].start <= sorted[out - 1].start + sorted[out - 1].len) {
+      size_t stop = sorted[i].start + sorted[i].len;
+      if (stop > sorted[out - 1].start + sorted[out - 1].len)
+        sorted[out - 1].len = stop - sorted[out - 1].start;
+      merged = 1;
+      continue;
+    }
+    sorted[out++] = sorted[i];
+  }
+
+  if (!merged)
+    return count;
+  memcpy(ranges, sorted, (size_t)out * sizeof(*ranges));
+  return out;
+}
+
+/* Parse a Range header against a body of size bytes
+ * Returns the number of satisfiable ranges after coalescing (0 = none,
+ * answer 416), or -1 if the header is malformed, not in bytes or has too
+ * many ranges (ignore it) */
+static int parse_range_header(const char *value, size_t size, http_byte_range_t *ranges, int max_ranges) {
+  const char *p = value;
+  int count = 0;
+  int specs = 0;
+
+  while (*p == ' ' || *p == '\t')
+    p++;
+  if (strncasecmp(p, "bytes=", 6) != 0)
+    return -1;
+  p += 6;
+
+  for (;;) {
+    unsigned long long first = 0;
+    unsigned long long last = 0;
+    int has_first = 0;
+    int has_last = 0;
+    char *end;
+
+    while (*p == ' ' || *p == '\t')
+      p++;
+    if (*p >= '0' && *p <= '9') {
+      first = strtoull(p, &end, 10);
+      p = end;
+      has_first = 1;
+    }
+    if (*p++ != '-')
+      return -1;
+    if (*p >= '0' && *p <= '9') {
+      last = strtoull(p, &end, 10);
+      p = end;
+      has_last = 1;
+    }
+    if ((!has_first && !has_last) || (has_first && has_last && last < first) || ++specs > max_ranges)
+      return -1;
+
+    if (!has_first) {
+      /* Suffix range: the last N bytes */
+      if (last > 0 && size > 0) {
+        size_t len = last < size ? (size_t)last : size;
+        ranges[count].start = size - len;
+        ranges[count].len = len;
+        count++;
+      }
+    } else if (first < size) {
+      size_t stop = (has_last && last < size) ? (size_t)last : size - 1;
+      ranges[count].start = (size_t)first;
+      ranges[count].len = stop - (size_t)first + 1;
+      count++;
+    }
+
+    while (*p == ' ' || *p == '\t')
+      p++;
+    if (*p == '\0')
+      return coalesce_ranges(ranges, count);
+    if (*p++ != ',')
+      return -1;
+  }
+}
+
+/* If-Range holds an entity tag (strong comparison) or the exact Last-Modified date */
+static int if_range_matches(const char *if_range, const char *etag, time_t mtime) {
+  if (if_range[0] == '"') {
+    size_t len = strlen(if_range);
+    return etag && len == strlen(etag) + 2 && if_range[len - 1] == '"' && strncmp(if_range + 1, etag, len - 2) == 0;
+  }
+  if (if_range[0] == 'W' && if_range[1] == '/')
+    return 0;
+  return mtime > 0 && http_parse_date(if_range) == mtime;
+}
+
+/* Queue one file segment; the zero-copy queue closes its own descriptor */
+static int queue_file_part(connection_t *c, int fd, int last, size_t start, size_t len) {
+  int part_fd = last ? fd : dup(fd);
+
+  if (part_fd < 0) {
+    logger(LOG_ERROR, "Failed to dup file fd for range response: %s", strerror(errno));
+    c->keepalive = 0; /* The response is cut short */
+    return -1;
+  }
+  if (connection_queue_file(c, part_fd, (off_t)start, len) < 0) {
+    close(part_fd);
+    return -1;
+  }
+  return 0;
+}
+
+static void send_multipart_ranges(connection_t *c, int fd, size_t size, const char *content_type,
+                                  const char *extra_headers, const http_byte_range_t *ranges, int count) {
+  char boundary[40];
+  char part_headers[HTTP_MAX_RANGES][256];
+  char type_header[128];
+  char headers[1024];
+  size_t total = 0;
+  int n;
+
+  snprintf(boundary, sizeof(boundary), "r2h-%016llx", (unsigned long long)get_time_ms() ^ (unsigned long long)size);
+  for (int i = 0; i < count; i++) {
+    n = snprintf(part_headers[i], sizeof(part_headers[i]),
+                 "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %zu-%zu/%zu\r\n\r\n", boundary, content_type,
+                 ranges[i].start, ranges[i].start + ranges[i].len - 1, size);
+    total += (size_t)n + ranges[i].len;
+  }
+  n = snprintf(headers, sizeof(headers), "Content-Length: %zu\r\n%s", total + strlen(boundary) + 8, extra_headers);
+  if (n < 0 || (size_t)n >= sizeof(headers)) {
+    close(fd);
+    http_send_500(c);
+    return;
+  }
+
+  snprintf(type_header, sizeof(type_header), "multipart/byteranges; boundary=%s", boundary);
+  send_http_headers(c, STATUS_206, type_header, headers);
+  for (int i = 0; i < count; i++) {
+    int last = i == count - 1;
+    if (connection_queue_output(c, (const uint8_t *)part_headers[i], strlen(part_headers[i])) < 0) {
+      close(fd);
+      c->state = CONN_CLOSING;
+      return;
+    }
+    /* The last part hands fd itself to the queue, closing it on failure */
+    if (queue_file_part(c, fd, last, ranges[i].start, ranges[i].len) < 0) {
+      if (!last)
+        close(fd);
+      c->state = CONN_CLOSING;
+      return;
+    }
+  }
+
+  char closing[64];
+  n = snprintf(closing, sizeof(closing), "\r\n--%s--\r\n", boundary);
+  connection_queue_output_and_flush(c, (const uint8_t *)closing, (size_t)n);
+}
+
+void http_send_file(connection_t *c, int fd, size_t size, const char *content_type, const char *etag,
+                    const char *additional_headers) {
+  http_byte_range_t ranges[HTTP_MAX_RANGES];
+  char validators[384];
+  char extra_headers[768];
+  char date[64];
+  struct stat st;
+  time_t mtime = 0;
+  int len = 0;
+
+  if (!c || fd < 0) {
+    if (fd >= 0)
+      close(fd);
+    return;
+  }
+
+  if (fstat(fd, &st) == 0)
+    mtime = st.st_mtime;
+
+  /* Validator headers shared by every response below */
+  if (etag)
+    len += snprintf(validators + len, sizeof(validators) - (size_t)len, "ETag: \"%s\"\r\nCache-Control: no-cache\r\n",
+                    etag);
+  if (mtime > 0) {
+    format_http_date(mtime, date, sizeof(date));
+    len += snprintf(validators + len, sizeof(validators) - (size_t)len, "Last-Modified: %s\r\n", date);
+  }
+  snprintf(validators + len, sizeof(validators) - (size_t)len, "Accept-Ranges: bytes\r\n%s%s",
+           additional_headers ? additional_headers : "", additional_headers ? "\r\n" : "");
+
+  /* If-None-Match wins over If-Modified-Since (RFC 7232 section 6) */
+  if (http_check_etag_and_send_304(c, etag, content_type)) {
+    close(fd);
+    return;
+  }
+  if (c->http_req.if_none_match[0] == '\0' && c->http_req.if_modified_since[0] != '\0' && mtime > 0) {
+    time_t since = http_parse_date(c->http_req.if_modified_since);
+    if (since >= 0 && mtime <= since) {
+      snprintf(extra_headers, sizeof(extra_headers), "Content-Length: 0\r\n%s", validators);
+      send_http_headers(c, STATUS_304, content_type, extra_headers);
+      connection_queue_output_and_flush(c, NULL, 0);
+      close(fd);
+      return;
+    }
+  }
+
+  int count = -1;
+  if (c->http_req.range[0] != '\0' && strcasecmp(c->http_req.method, "GET") == 0 &&
+      (c->http_req.if_range[0] == '\0' || if_range_matches(c->http_req.if_range, etag, mtime)))
+    count = parse_range_header(c->http_req.range, size, ranges, HTTP_MAX_RANGES);
+
+  if (count == 0) {
+    snprintf(extra_headers, sizeof(extra_headers), "Content-Length: 0\r\nContent-Range: bytes */%zu\r\n%s", size,
+             validators);
+    send_http_headers(c, STATUS_416, NULL, extra_headers);
+    connection_queue_output_and_flush(c, NULL, 0);
+    close(fd);
+    return;
+  }
+
+  if (count > 1) {
+    send_multipart_ranges(c, fd, size, content_type, validators, ranges, count);
+    return;
+  }
+
+  if (count == 1) {
+    snprintf(extra_headers, sizeof(extra_headers), "Content-Length: %zu\r\nContent-Range: bytes %zu-%zu/%zu\r\n%s",
+             ranges[0].len, ranges[0].start, ranges[0].start + ranges[0].len - 1, size, validators);
+    send_http_headers(c, STATUS_206, content_type, extra_headers);
+  } else {
+    ranges[0].start = 0;
+    ranges[0].len = size;
+    snprintf(extra_headers, sizeof(extra_headers), "Content-Length: %zu\r\n%s", size, validators);
+    send_http_headers(c, STATUS_200, content_type, extra_headers);
+  }
+
+  if (ranges[0].len == 0) {
+    close(fd);
+    connection_queue_output_and_flush(c, NULL, 0);
+    return;
+  }
+  if (queue_file_part(c, fd, 1, ranges[0].start, ranges[0].len) < 0) {
+    logger(LOG_ERROR, "Failed to queue file for zero-copy transmission");
+    c->state = CONN_CLOSING;
+  }
+}
@@ -1,6 +1,7 @@
 #ifndef __HTTP_H__
 #define __HTTP_H__
 
+#include <stdint.h>
 #include <sys/types.h>
 
 /* Maximum URL buffer size shared across the HTTP/RTSP pipeline.
@@ -11,9 +12,9 @@
 #define HTTP_URL_BUFFER_SIZE 2048
 #endif
 
-/* Maximum Cookie header value retained for r2h-token extraction.
- * Browsers may send many unrelated cookies for the same domain, so keep this
- * large enough for common shared-domain deployments. */
+/* Maximum Cookie header value handled when filtering r2h-token out of
+ * forwarded requests.  Browsers may send many unrelated cookies for the same
+ * domain, so keep this large enough for common shared-domain deployments. */
 #ifndef HTTP_COOKIE_BUFFER_SIZE
 #define HTTP_COOKIE_BUFFER_SIZE 4096
 #endif
@@ -31,35 +32,65 @@ typedef enum {
   STATUS_500 = 5,
   STATUS_401 = 6,
   STATUS_304 = 7,
-  STATUS_204 = 8
+  STATUS_204 = 8,
+  STATUS_206 = 9,
+  STATUS_416 = 10
 } http_status_t;
 
+/* Ranges answered in one multipart/byteranges response, at most; requests
+ * with more ranges get the full body */
+#define HTTP_MAX_RANGES 16
+
 /* HTTP request parsing state */
 typedef enum { HTTP_PARSE_REQ_LINE = 0, HTTP_PARSE_HEADERS, HTTP_PARSE_BODY, HTTP_PARSE_COMPLETE } http_parse_state_t;
 
-/* HTTP request structure */
+/* Header lines recorded per request, at most; further lines are still
+ * checked for the headers routes use but are not forwarded upstream */
+#define HTTP_MAX_HEADERS 64
+
+/* One header line as offsets into the input buffer (value is trimmed) */
 typedef struct {
-  char method[16];
-  char url[HTTP_URL_BUFFER_SIZE];
-  char hostname[256];
-  char user_agent[256];
-  char accept[256];
-  char if_none_match[256];
-  char x_forwarded_for[64];
-  char x_forwarded_host[256];
-  char x_forwarded_proto[16];
+  uint16_t name_off;
+  uint16_t name_len;
+  uint16_t value_off;
+  uint16_t value_len;
+} http_header_slice_t;
+
+/* HTTP request structure
+ *
+ * The request head is parsed in place: the string members point into the
+ * connection input buffer (NUL-terminated there) or at "" when absent, and
+ * stay valid until http_request_consume() drops the head from the buffer. */
+typedef struct http_request_s {
+  const char *method;
+  const char *url;
+  const char *hostname;
+  const char *user_agent;
+  const char *accept;
+  const char *if_none_match;
+  const char *if_modified_since;
+  const char *if_range;
+  const char *range;
+  const char *x_forwarded_for; /* First address of the list */
+  const char *x_forwarded_host;
+  const char *x_forwarded_proto;
   int x_request_snapshot;
-  char cookie[HTTP_COOKIE_BUFFER_SIZE];     /* Cookie header value for r2h-token extraction */
-  char access_control_request_method[64];   /* CORS preflight method */
-  char access_control_request_headers[512]; /* CORS preflight headers */
+  int keep_alive;                             /* Client accepts a persistent connection */
+  int http_1_1;                               /* Request line says HTTP/1.1 (chunked responses allowed) */
+  const char *cookie;                         /* Cookie header value for r2h-token extraction */
+  const char *access_control_request_method;  /* CORS preflight method */
+  const char *access_control_request_headers; /* CORS preflight headers */
   http_parse_state_t parse_state;
   int content_length;
   char *body;        /* Dynamically allocated based on Content-Length */
   size_t body_len;   /* Current body length */
   size_t body_alloc; /* Allocated size of body buffer */
-  /* Raw headers for proxying - stores all headers except Host, Connection */
-  char raw_headers[4096];
-  size_t raw_headers_len;
+  /* Parsed head within the input buffer */
+  const char *head;   /* Input buffer the offsets below refer to */
+  uint16_t parse_off; /* Start of the first line not parsed yet */
+  uint16_t head_len;  /* Bytes of request line and headers, final CRLF included */
+  uint16_t header_count;
+  http_header_slice_t headers[HTTP_MAX_HEADERS];
 } http_request_t;
 
 /**
@@ -76,15 +107,40 @@ void http_request_cleanup(http_request_t *req);
 
 /**
  * Parse HTTP request from buffer (incremental parsing)
- * Modifies inbuf and in_len as data is consumed.
+ * The head is parsed in place and left in inbuf (see http_request_consume);
+ * body bytes are moved out of inbuf as they arrive.
  *
- * @param inbuf Input buffer containing HTTP request data
- * @param in_len Pointer to current buffer length (updated as data is consumed)
+ * @param inbuf Input buffer containing HTTP request data (NUL-terminated)
+ * @param in_len Pointer to current buffer length (updated as body data is consumed)
  * @param req Request structure to fill (maintains state across calls)
  * @return 0 = need more data, 1 = request complete, -1 = parse error
  */
 int http_parse_request(char *inbuf, int *in_len, http_request_t *req);
 
+/**
+ * Drop a parsed request head from the input buffer, moving any pipelined
+ * data after it to the front.  The string members of req become invalid.
+ *
+ * @param inbuf Input buffer passed to http_parse_request
+ * @param in_len Pointer to current buffer length
+ * @param req Parsed request
+ */
+void http_request_consume(char *inbuf, int *in_len, http_request_t *req);
+
+/**
+ * Write the client headers an upstream request should carry, one
+ * "Name: Value\r\n" line each.  Host, Connection, Content-Length,
+ * Transfer-Encoding, Accept-Encoding and X-Forwarded-* are left out, and
+ * r2h-token is removed from Cookie and User-Agent.
+ *
+ * @param req Parsed request (head still in its input buffer)
+ * @param buf Output buffer
+ * @param size Output buffer size
+ * @param skip_user_agent Leave User-Agent out (an override replaces it)
+ * @return Bytes written (not NUL-terminated), or -1 if buf is too small
+ */
+int http_request_format_forward_headers(const http_request_t *req, char *buf, size_t size, int skip_user_agent);
+
 /**
  * Send HTTP response headers via connection output buffer
  * For SSE (Server-Sent Events), pass "text/event-stream" as content_type which
@@ -268,6 +324,13 @@ int http_match_host_header(const char *request_host_header, const char *expected
  */
 int http_check_etag_and_send_304(connection_t *c, const char *etag, const char *content_type);
 
+/**
+ * Parse an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT")
+ * @param s Header value
+ * @return Time in seconds since the epoch, -1 if malformed
+ */
+time_t http_parse_date(const char *s);
+
 /**
  * Build extra headers string with ETag and Cache-Control
  * Helper function to format standard ETag caching headers with optional
@@ -284,4 +347,22 @@ int http_check_etag_and_send_304(connection_t *c, const char *etag, const char *
 int http_build_etag_headers(char *buffer, size_t buffer_size, size_t content_length, const char *etag,
                             const char *additional_headers);
 
+/**
+ * Send a file-backed response, honouring conditional and range requests
+ * If-None-Match / If-Modified-Since answer 304, Range (checked against
+ * If-Range) answers 206 with one range or multipart/byteranges with several,
+ * and unsatisfiable ranges answer 416.  Every body part is queued straight
+ * from its file offset (sendfile), Last-Modified comes from the file's mtime.
+ *
+ * @param c Connection
+ * @param fd File holding the body (ownership transferred, closed once sent)
+ * @param size Body size in bytes
+ * @param content_type Content-Type of the body
+ * @param etag ETag value without quotes (can be NULL)
+ * @param additional_headers Optional additional headers (can be NULL), should
+ * NOT end with CRLF
+ */
+void http_send_file(connection_t *c, int fd, size_t size, const char *content_type, const char *etag,
+                    const char *additional_headers);
+
 #endif /* __HTTP_H__ */
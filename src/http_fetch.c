@@ -1,12 +1,19 @@
 #include "http_fetch.h"
+#include "connection.h"
 #include "hashmap.h"
+#include "http_chunked_decoder.h"
+#include "platform_compat.h"
 #include "poller.h"
+#include "resolver.h"
 #include "utils.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <netdb.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -14,9 +21,23 @@
 #define MAX_HTTP_CONTENT (20 * 1024 * 1024) /* 10MB max */
 #define MAX_URL_LENGTH 2048
 
+#define HTTP_FETCH_TIMEOUT_MS 30000      /* Whole in-process fetch, like --max-time 30 */
+#define HTTP_FETCH_MAX_HEADER_SIZE 16384 /* Response status line and headers */
+#define HTTP_FETCH_MAX_REDIRECTS 5       /* Like curl -L, but bounded */
+#define HTTP_FETCH_HOST_SIZE 256
+
 /* HTTP fetch tool types */
 typedef enum { HTTP_TOOL_CURL = 0, HTTP_TOOL_UCLIENT_FETCH, HTTP_TOOL_WGET, HTTP_TOOL_NONE } http_fetch_tool_t;
 
+/* Progress of an in-process fetch */
+typedef enum {
+  HTTP_FETCH_STATE_RESOLVING = 0, /* Waiting for the resolver */
+  HTTP_FETCH_STATE_CONNECTING,    /* Non-blocking connect in progress */
+  HTTP_FETCH_STATE_SENDING,       /* Sending the request */
+  HTTP_FETCH_STATE_HEADERS,       /* Reading the status line and headers */
+  HTTP_FETCH_STATE_BODY           /* Streaming the body to the output */
+} http_fetch_state_t;
+
 /* Cached detected HTTP fetch tool */
 static http_fetch_tool_t detected_tool = HTTP_TOOL_NONE;
 static int tool_detection_done = 0;
@@ -24,9 +45,9 @@ static int tool_detection_done = 0;
 /* Async HTTP fetch context */
 struct http_fetch_ctx_s {
   FILE *pipe_fp;                        /* popen file pointer */
-  int pipe_fd;                          /* pipe file descriptor for epoll */
+  int fd;                               /* pipe (external tool) or socket (native) registered with epoll */
   int epfd;                             /* epoll fd */
-  char *url;                            /* URL being fetched */
+  char *url;                            /* URL being fetched (redirect target once redirected) */
   char *temp_file;                      /* temporary file path */
   char *buffer;                         /* accumulated data buffer */
   size_t buffer_size;                   /* allocated buffer size */
@@ -35,16 +56,54 @@ struct http_fetch_ctx_s {
   http_fetch_fd_callback_t fd_callback; /* fd-based completion callback */
   void *user_data;                      /* user-provided data */
   int use_fd;                           /* 1 to use fd callback (zero-copy), 0 to use memory callback */
+
+  /* Conditional fetch */
+  http_fetch_validators_t *validators; /* caller-owned validators, or NULL */
+  uint64_t url_hash;                   /* hash of the requested URL */
+  int not_modified;                    /* 1 if completed as 304 / unchanged file */
+
+  /* In-process HTTP/1.1 client (http:// URLs) */
+  int native;                                    /* 1 if fetched in-process, 0 if via popen */
+  http_fetch_state_t state;                      /* native client progress */
+  char host[HTTP_FETCH_HOST_SIZE];               /* host connected to (no brackets), the proxy if any */
+  int port;                                      /* TCP port */
+  struct resolver_query_s *resolve_query;        /* pending lookup, or NULL */
+  struct addrinfo *connect_results;              /* resolver candidates */
+  struct addrinfo *connect_next;                 /* next candidate to try */
+  int connect_last_errno;                        /* errno of the last failed candidate */
+  int failed;                                    /* failed outside the poller; completed by the tick */
+  int64_t deadline_ms;                           /* whole fetch deadline */
+  char *request;                                 /* serialized request */
+  size_t request_len;                            /* request length */
+  size_t request_sent;                           /* request bytes sent */
+  char *headers;                                 /* response header accumulator */
+  size_t headers_used;                           /* bytes in headers */
+  int status_code;                               /* response status */
+  int64_t content_length;                        /* Content-Length, or -1 */
+  int chunked;                                   /* Transfer-Encoding: chunked */
+  http_chunked_decoder_t chunked_decoder;        /* chunked body decoder */
+  size_t body_size;                              /* decoded body bytes so far */
+  int out_fd;                                    /* tmpfs body file (fd mode), or -1 */
+  int redirects;                                 /* redirects followed */
+  char etag[HTTP_FETCH_VALIDATOR_SIZE];          /* ETag of the response */
+  char last_modified[HTTP_FETCH_VALIDATOR_SIZE]; /* Last-Modified of the response */
+  struct http_fetch_ctx_s *next;                 /* in-process fetch list */
 };
 
-/* Global hashmap for fast fd-based lookup */
-static struct hashmap *fetch_fd_map = NULL;
+/* Per-event-loop hashmap for fast fd-based lookup */
+static _Thread_local struct hashmap *fetch_fd_map = NULL;
+
+/* Per-event-loop list of in-process fetches (for timeouts) */
+static _Thread_local http_fetch_ctx_t *native_fetches = NULL;
+
+static int http_fetch_native_begin(http_fetch_ctx_t *ctx);
+static int http_fetch_tool_begin(http_fetch_ctx_t *ctx);
 
 /* Hash function for fd-based hashmap lookup */
 static uint64_t hash_fetch_fd(const void *item, uint64_t seed0, uint64_t seed1) {
   http_fetch_ctx_t *const *ctx_ptr = item;
   http_fetch_ctx_t *ctx = *ctx_ptr;
-  return hashmap_xxhash3(&ctx->pipe_fd, sizeof(int), seed0, seed1);
+  return hashmap_xxhash3(&ctx->fd, sizeof(int), seed0, seed1);
 }
 
 /* Compare function for fd-based hashmap lookup */
@@ -52,7 +111,7 @@ static int compare_fetch_fds(const void *a, const void *b, void *udata) {
   http_fetch_ctx_t *const *ctx_a = a;
   http_fetch_ctx_t *const *ctx_b = b;
   (void)udata; /* unused */
-  return (*ctx_a)->pipe_fd - (*ctx_b)->pipe_fd;
+  return (*ctx_a)->fd - (*ctx_b)->fd;
 }
 
 /* Initialize hashmap for fd-based lookup */
@@ -108,7 +167,7 @@ static http_fetch_tool_t detect_http_fetch_tool(void) {
   }
 
   /* No suitable tool found */
-  logger(LOG_ERROR, "No HTTP fetch tool found. Please install curl, uclient-fetch or wget.");
+  logger(LOG_ERROR, "No HTTP fetch tool found. Please install curl, uclient-fetch or wget for HTTPS URLs.");
   detected_tool = HTTP_TOOL_NONE;
   tool_detection_done = 1;
   return detected_tool;
@@ -180,13 +239,39 @@ static int build_fetch_command(char *buf, size_t bufsize, const char *url, const
   return 0;
 }
 
+/* Hash identifying the URL validators belong to (never 0) */
+static uint64_t http_fetch_url_hash(const char *url) { return hashmap_xxhash3(url, strlen(url), 0, 0) | 1; }
+
+/* Validators usable for this fetch (same URL as last time), or NULL */
+static const http_fetch_validators_t *http_fetch_active_validators(const http_fetch_ctx_t *ctx) {
+  if (!ctx->validators || ctx->validators->url_hash != ctx->url_hash)
+    return NULL;
+  return ctx->validators;
+}
+
+/* Remember the validators of a successful fetch */
+static void http_fetch_store_validators(http_fetch_ctx_t *ctx, const char *etag, const char *last_modified) {
+  if (!ctx->validators)
+    return;
+  ctx->validators->url_hash = ctx->url_hash;
+  snprintf(ctx->validators->etag, sizeof(ctx->validators->etag), "%s", etag);
+  snprintf(ctx->validators->last_modified, sizeof(ctx->validators->last_modified), "%s", last_modified);
+}
+
+void http_fetch_validators_reset(http_fetch_validators_t *validators) {
+  if (validators)
+    memset(validators, 0, sizeof(*validators));
+}
+
+int http_fetch_not_modified(const http_fetch_ctx_t *ctx) { return ctx ? ctx->not_modified : 0; }
+
 /* Find HTTP fetch context by file descriptor */
 http_fetch_ctx_t *http_fetch_find_by_fd(int fd) {
   if (!fetch_fd_map)
     return NULL;
 
   /* Create a temporary context with the fd we're looking for */
-  http_fetch_ctx_t temp_ctx = {.pipe_fd = fd};
+  http_fetch_ctx_t temp_ctx = {.fd = fd};
   http_fetch_ctx_t *temp_ptr = &temp_ctx;
 
   /* Look up in hashmap */
@@ -202,27 +287,89 @@ static void http_fetch_remove_from_map(http_fetch_ctx_t *ctx) {
   if (!ctx)
     return;
 
-  /* Remove from hashmap if pipe_fd is valid */
-  if (fetch_fd_map && ctx->pipe_fd >= 0) {
+  /* Remove from hashmap if fd is valid */
+  if (fetch_fd_map && ctx->fd >= 0) {
     hashmap_delete(fetch_fd_map, &ctx);
   }
 }
 
+/* Add context to hashmap under its current fd */
+static void http_fetch_add_to_map(http_fetch_ctx_t *ctx) {
+  /* Initialize hashmap if needed */
+  http_fetch_init_map();
+
+  /* Add to hashmap for fast fd-based lookup */
+  if (fetch_fd_map) {
+    http_fetch_ctx_t *ctx_ptr = ctx;
+    hashmap_set(fetch_fd_map, &ctx_ptr);
+  }
+}
+
+/* Close the native client socket (connect fallback, redirect or cleanup) */
+static void http_fetch_close_socket(http_fetch_ctx_t *ctx) {
+  if (ctx->fd < 0)
+    return;
+  http_fetch_remove_from_map(ctx);
+  if (ctx->epfd >= 0)
+    poller_del(ctx->epfd, ctx->fd);
+  close(ctx->fd);
+  ctx->fd = -1;
+}
+
+/* Drop a pending lookup and the candidate list */
+static void http_fetch_free_connect_results(http_fetch_ctx_t *ctx) {
+  if (ctx->resolve_query) {
+    resolver_cancel(ctx->resolve_query);
+    ctx->resolve_query = NULL;
+  }
+  if (ctx->connect_results) {
+    resolver_freeaddrinfo(ctx->connect_results);
+    ctx->connect_results = NULL;
+    ctx->connect_next = NULL;
+  }
+}
+
+/* Unlink an in-process fetch from the per-loop list */
+static void http_fetch_unlink_native(http_fetch_ctx_t *ctx) {
+  for (http_fetch_ctx_t **pp = &native_fetches; *pp; pp = &(*pp)->next) {
+    if (*pp == ctx) {
+      *pp = ctx->next;
+      ctx->next = NULL;
+      return;
+    }
+  }
+}
+
+/* Release the in-process client state (socket, lookup, response parser) */
+static void http_fetch_native_release(http_fetch_ctx_t *ctx) {
+  http_fetch_free_connect_results(ctx);
+  http_fetch_close_socket(ctx);
+  http_fetch_unlink_native(ctx);
+  free(ctx->request);
+  ctx->request = NULL;
+  free(ctx->headers);
+  ctx->headers = NULL;
+  ctx->native = 0;
+}
+
 /* Cleanup and free fetch context */
 static void http_fetch_free(http_fetch_ctx_t *ctx) {
   if (!ctx)
     return;
 
+  if (ctx->native)
+    http_fetch_native_release(ctx);
+
   /* Remove from poller if registered */
-  if (ctx->epfd >= 0 && ctx->pipe_fd >= 0) {
-    poller_del(ctx->epfd, ctx->pipe_fd);
+  if (ctx->epfd >= 0 && ctx->fd >= 0) {
+    poller_del(ctx->epfd, ctx->fd);
   }
 
   /* Close pipe */
   if (ctx->pipe_fp) {
     pclose(ctx->pipe_fp);
     ctx->pipe_fp = NULL;
-    ctx->pipe_fd = -1;
+    ctx->fd = -1;
   }
 
   /* Remove temporary file if exists */
@@ -231,6 +378,9 @@ static void http_fetch_free(http_fetch_ctx_t *ctx) {
     free(ctx->temp_file);
   }
 
+  if (ctx->out_fd >= 0)
+    close(ctx->out_fd);
+
   /* Free buffers */
   if (ctx->url)
     free(ctx->url);
@@ -240,129 +390,118 @@ static void http_fetch_free(http_fetch_ctx_t *ctx) {
   free(ctx);
 }
 
-/* Internal helper to start async HTTP fetch */
-static http_fetch_ctx_t *http_fetch_start_async_internal(const char *url, http_fetch_callback_t callback,
-                                                         http_fetch_fd_callback_t fd_callback, void *user_data,
-                                                         int epfd) {
-  char fetch_cmd[MAX_URL_LENGTH + 256];
-  char temp_file_template[] = "/tmp/rtp2httpd_http_fetch_XXXXXX";
-  int temp_fd;
-
-  if (!url || (!callback && !fd_callback) || epfd < 0) {
-    logger(LOG_ERROR, "Invalid parameters for async HTTP fetch");
-    return NULL;
+/* Complete a file:// fetch synchronously */
+static void http_fetch_file(http_fetch_ctx_t *ctx) {
+  const char *file_path = ctx->url + 7; /* Skip file:// prefix */
+  const char *url = ctx->url;
+  http_fetch_callback_t callback = ctx->callback;
+  http_fetch_fd_callback_t fd_callback = ctx->fd_callback;
+  void *user_data = ctx->user_data;
+  const http_fetch_validators_t *validators = http_fetch_active_validators(ctx);
+  char stamp[HTTP_FETCH_VALIDATOR_SIZE];
+  struct stat st;
+
+  /* Unchanged modification time and size: nothing to reload */
+  if (stat(file_path, &st) == 0) {
+    snprintf(stamp, sizeof(stamp), "%lld:%lld:%lld", (long long)st.st_mtime, (long long)st.st_ino,
+             (long long)st.st_size);
+    if (validators && strcmp(validators->last_modified, stamp) == 0) {
+      logger(LOG_DEBUG, "file:// fetch not modified: %s", url);
+      ctx->not_modified = 1;
+      if (ctx->use_fd)
+        fd_callback(ctx, -1, 0, user_data);
+      else
+        callback(ctx, NULL, 0, user_data);
+      return;
+    }
+  } else {
+    stamp[0] = '\0';
   }
 
-  /* Handle file:// URLs with synchronous read (fast, no epoll needed) */
-  if (strncmp(url, "file://", 7) == 0) {
-    const char *file_path = url + 7; /* Skip file:// prefix */
-
-    /* Create temporary context for callback */
-    http_fetch_ctx_t *ctx = calloc(1, sizeof(*ctx));
-    if (!ctx) {
-      logger(LOG_ERROR, "Failed to allocate context for file:// URL");
-      return NULL;
+  /* Read file and invoke callback immediately */
+  if (ctx->use_fd) {
+    /* fd-based callback: open file and return fd */
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+      logger(LOG_ERROR, "Failed to open file: %s - %s", file_path, strerror(errno));
+      fd_callback(ctx, -1, 0, user_data);
+      return;
     }
 
-    ctx->url = strdup(url);
-    ctx->callback = callback;
-    ctx->fd_callback = fd_callback;
-    ctx->user_data = user_data;
-    ctx->epfd = -1; /* No epoll needed */
-    ctx->use_fd = (fd_callback != NULL);
+    /* Get file size */
+    if (fstat(fd, &st) < 0) {
+      logger(LOG_ERROR, "Failed to stat file: %s - %s", file_path, strerror(errno));
+      close(fd);
+      fd_callback(ctx, -1, 0, user_data);
+      return;
+    }
 
-    /* Read file and invoke callback immediately */
-    if (ctx->use_fd) {
-      /* fd-based callback: open file and return fd */
-      int fd = open(file_path, O_RDONLY);
-      if (fd < 0) {
-        logger(LOG_ERROR, "Failed to open file: %s - %s", file_path, strerror(errno));
-        fd_callback(ctx, -1, 0, user_data);
-        free(ctx->url);
-        free(ctx);
-        return NULL;
-      }
+    logger(LOG_DEBUG, "file:// fetch completed synchronously (fd=%d, %zu bytes): %s", fd, (size_t)st.st_size, url);
 
-      /* Get file size */
-      struct stat st;
-      if (fstat(fd, &st) < 0) {
-        logger(LOG_ERROR, "Failed to stat file: %s - %s", file_path, strerror(errno));
-        close(fd);
-        fd_callback(ctx, -1, 0, user_data);
-        free(ctx->url);
-        free(ctx);
-        return NULL;
-      }
+    http_fetch_store_validators(ctx, "", stamp);
 
-      logger(LOG_DEBUG, "file:// fetch completed synchronously (fd=%d, %zu bytes): %s", fd, (size_t)st.st_size, url);
+    /* Invoke callback with fd (caller must close) */
+    fd_callback(ctx, fd, (size_t)st.st_size, user_data);
+    return;
+  }
 
-      /* Invoke callback with fd (caller must close) */
-      fd_callback(ctx, fd, (size_t)st.st_size, user_data);
+  /* Memory-based callback: read entire file into memory */
+  FILE *fp = fopen(file_path, "r");
+  if (!fp) {
+    logger(LOG_ERROR, "Failed to open file: %s - %s", file_path, strerror(errno));
+    callback(ctx, NULL, 0, user_data);
+    return;
+  }
 
-      /* Free context immediately */
-      free(ctx->url);
-      free(ctx);
-      return NULL; /* NULL = immediate completion, no context to track */
-    } else {
-      /* Memory-based callback: read entire file into memory */
-      FILE *fp = fopen(file_path, "r");
-      if (!fp) {
-        logger(LOG_ERROR, "Failed to open file: %s - %s", file_path, strerror(errno));
-        callback(ctx, NULL, 0, user_data);
-        free(ctx->url);
-        free(ctx);
-        return NULL;
-      }
+  /* Get file size */
+  fseek(fp, 0, SEEK_END);
+  long file_size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
 
-      /* Get file size */
-      fseek(fp, 0, SEEK_END);
-      long file_size = ftell(fp);
-      fseek(fp, 0, SEEK_SET);
+  if (file_size < 0) {
+    logger(LOG_ERROR, "Failed to get file size: %s", file_path);
+    fclose(fp);
+    callback(ctx, NULL, 0, user_data);
+    return;
+  }
 
-      if (file_size < 0) {
-        logger(LOG_ERROR, "Failed to get file size: %s", file_path);
-        fclose(fp);
-        callback(ctx, NULL, 0, user_data);
-        free(ctx->url);
-        free(ctx);
-        return NULL;
-      }
+  if (file_size > MAX_HTTP_CONTENT) {
+    logger(LOG_ERROR, "File too large (%ld bytes, max %ld): %s", file_size, (long)MAX_HTTP_CONTENT, file_path);
+    fclose(fp);
+    callback(ctx, NULL, 0, user_data);
+    return;
+  }
 
-      if (file_size > MAX_HTTP_CONTENT) {
-        logger(LOG_ERROR, "File too large (%ld bytes, max %ld): %s", file_size, (long)MAX_HTTP_CONTENT, file_path);
-        fclose(fp);
-        callback(ctx, NULL, 0, user_data);
-        free(ctx->url);
-        free(ctx);
-        return NULL;
-      }
+  /* Allocate buffer */
+  char *content = malloc(file_size + 1);
+  if (!content) {
+    logger(LOG_ERROR, "Failed to allocate %ld bytes for file content", file_size);
+    fclose(fp);
+    callback(ctx, NULL, 0, user_data);
+    return;
+  }
 
-      /* Allocate buffer */
-      char *content = malloc(file_size + 1);
-      if (!content) {
-        logger(LOG_ERROR, "Failed to allocate %ld bytes for file content", file_size);
-        fclose(fp);
-        callback(ctx, NULL, 0, user_data);
-        free(ctx->url);
-        free(ctx);
-        return NULL;
-      }
+  /* Read file */
+  size_t read_size = fread(content, 1, file_size, fp);
+  content[read_size] = '\0';
+  fclose(fp);
 
-      /* Read file */
-      size_t read_size = fread(content, 1, file_size, fp);
-      content[read_size] = '\0';
-      fclose(fp);
+  logger(LOG_DEBUG, "file:// fetch completed synchronously (%zu bytes): %s", read_size, url);
 
-      logger(LOG_DEBUG, "file:// fetch completed synchronously (%zu bytes): %s", read_size, url);
+  http_fetch_store_validators(ctx, "", stamp);
 
-      /* Invoke callback with content (caller must free) */
-      callback(ctx, content, read_size, user_data);
+  /* Invoke callback with content (caller must free) */
+  callback(ctx, content, read_size, user_data);
+}
 
-      /* Free context immediately */
-      free(ctx->url);
-      free(ctx);
-      return NULL; /* NULL = immediate completion */
-    }
+/* Internal helper to start async HTTP fetch */
+static http_fetch_ctx_t *http_fetch_start_async_internal(const char *url, http_fetch_validators_t *validators,
+                                                         http_fetch_callback_t callback,
+                                                         http_fetch_fd_callback_t fd_callback, void *user_data,
+                                                         int epfd) {
+  if (!url || (!callback && !fd_callback) || epfd < 0) {
+    logger(LOG_ERROR, "Invalid parameters for async HTTP fetch");
+    return NULL;
   }
 
   /* Create context */
@@ -377,80 +516,750 @@ static http_fetch_ctx_t *http_fetch_start_async_internal(const char *url, http_f
   ctx->fd_callback = fd_callback;
   ctx->user_data = user_data;
   ctx->epfd = epfd;
-  ctx->pipe_fd = -1;
+  ctx->fd = -1;
+  ctx->out_fd = -1;
   ctx->use_fd = (fd_callback != NULL);
+  ctx->validators = validators;
+  ctx->url_hash = http_fetch_url_hash(url);
+  if (!ctx->url) {
+    logger(LOG_ERROR, "Failed to allocate HTTP fetch context");
+    http_fetch_free(ctx);
+    return NULL;
+  }
+
+  /* Handle file:// URLs with synchronous read (fast, no epoll needed) */
+  if (strncmp(url, "file://", 7) == 0) {
+    ctx->epfd = -1; /* No epoll needed */
+    http_fetch_file(ctx);
+    http_fetch_free(ctx);
+    return NULL; /* NULL = immediate completion, no context to track */
+  }
+
+  /* Plain http:// is fetched in-process; TLS and credentials need a tool */
+  int started = http_fetch_native_begin(ctx);
+  if (started > 0)
+    started = http_fetch_tool_begin(ctx);
+  if (started < 0) {
+    http_fetch_free(ctx);
+    return NULL;
+  }
+
+  return ctx;
+}
+
+/* Start fetching ctx->url with curl / uclient-fetch / wget via popen
+ * Returns: 0 on success, -1 on error */
+static int http_fetch_tool_begin(http_fetch_ctx_t *ctx) {
+  char fetch_cmd[MAX_URL_LENGTH + 256];
+  char temp_file_template[] = "/tmp/rtp2httpd_http_fetch_XXXXXX";
+  int temp_fd;
 
   /* Create temporary file */
   temp_fd = mkstemp(temp_file_template);
   if (temp_fd == -1) {
     logger(LOG_ERROR, "Failed to create temporary file for async HTTP fetch");
-    http_fetch_free(ctx);
-    return NULL;
+    return -1;
   }
   close(temp_fd);
   ctx->temp_file = strdup(temp_file_template);
+  if (!ctx->temp_file) {
+    unlink(temp_file_template);
+    return -1;
+  }
 
   /* Build fetch command - output to temp file, errors to stdout for monitoring
    */
-  if (build_fetch_command(fetch_cmd, sizeof(fetch_cmd), url, ctx->temp_file, 30) < 0) {
-    http_fetch_free(ctx);
-    return NULL;
+  if (build_fetch_command(fetch_cmd, sizeof(fetch_cmd), ctx->url, ctx->temp_file, 30) < 0) {
+    return -1;
   }
 
-  logger(LOG_DEBUG, "Starting async HTTP fetch: %s", url);
+  logger(LOG_DEBUG, "Starting async HTTP fetch: %s", ctx->url);
 
   /* Start fetch process with popen */
   ctx->pipe_fp = popen(fetch_cmd, "r");
   if (!ctx->pipe_fp) {
     logger(LOG_ERROR, "Failed to start fetch process: %s", strerror(errno));
-    http_fetch_free(ctx);
-    return NULL;
+    return -1;
   }
 
   /* Get file descriptor from FILE* */
-  ctx->pipe_fd = fileno(ctx->pipe_fp);
-  if (ctx->pipe_fd < 0) {
+  ctx->fd = fileno(ctx->pipe_fp);
+  if (ctx->fd < 0) {
     logger(LOG_ERROR, "Failed to get file descriptor from popen");
-    http_fetch_free(ctx);
-    return NULL;
+    return -1;
   }
 
   /* Set non-blocking mode */
-  int flags = fcntl(ctx->pipe_fd, F_GETFL, 0);
-  if (flags < 0 || fcntl(ctx->pipe_fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+  int flags = fcntl(ctx->fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(ctx->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
     logger(LOG_ERROR, "Failed to set non-blocking mode on pipe: %s", strerror(errno));
-    http_fetch_free(ctx);
-    return NULL;
+    return -1;
   }
 
   /* Allocate initial buffer for curl output (errors/progress) */
+  free(ctx->buffer);
   ctx->buffer_size = HTTP_FETCH_BUFFER_SIZE;
   ctx->buffer = malloc(ctx->buffer_size);
   if (!ctx->buffer) {
     logger(LOG_ERROR, "Failed to allocate buffer for async HTTP fetch");
-    http_fetch_free(ctx);
-    return NULL;
+    return -1;
   }
   ctx->buffer_used = 0;
 
   /* Register pipe fd with poller */
-  if (poller_add(epfd, ctx->pipe_fd, POLLER_IN | POLLER_HUP | POLLER_ERR) < 0) {
+  if (poller_add(ctx->epfd, ctx->fd, POLLER_IN | POLLER_HUP | POLLER_ERR) < 0) {
     logger(LOG_ERROR, "Failed to add async HTTP fetch to poller: %s", strerror(errno));
+    return -1;
+  }
+
+  http_fetch_add_to_map(ctx);
+
+  logger(LOG_DEBUG, "Async HTTP fetch started, pipe_fd=%d", ctx->fd);
+  return 0;
+}
+
+/**
+ * Try connecting to the next resolver candidate (sequential dual-stack
+ * fallback, as in the HTTP proxy).  The socket is bound to the HTTP upstream
+ * interface and registered with the poller under this context.
+ * @return 0 if a connection is in progress, -1 when all candidates failed
+ */
+static int http_fetch_try_next_candidate(http_fetch_ctx_t *ctx) {
+  while (ctx->connect_next) {
+    struct addrinfo *rp = ctx->connect_next;
+    ctx->connect_next = rp->ai_next;
+
+    int sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    if (sock < 0) {
+      ctx->connect_last_errno = errno;
+      continue;
+    }
+    platform_set_nosigpipe(sock);
+
+    if (connection_set_nonblocking(sock) < 0) {
+      ctx->connect_last_errno = errno;
+      close(sock);
+      continue;
+    }
+
+    bind_to_upstream_interface(sock, get_upstream_interface_for_http(NULL));
+
+    if (connect(sock, rp->ai_addr, rp->ai_addrlen) == 0 || errno == EINPROGRESS || errno == EWOULDBLOCK) {
+      if (poller_add(ctx->epfd, sock, POLLER_IN | POLLER_OUT | POLLER_ERR | POLLER_HUP | POLLER_RDHUP) < 0) {
+        logger(LOG_ERROR, "HTTP fetch: Failed to add socket to poller: %s", strerror(errno));
+        close(sock);
+        return -1;
+      }
+      ctx->fd = sock;
+      http_fetch_add_to_map(ctx);
+      ctx->state = HTTP_FETCH_STATE_CONNECTING;
+      return 0;
+    }
+
+    ctx->connect_last_errno = errno;
+    logger(LOG_DEBUG, "HTTP fetch: connect() to %s:%d failed (%s): %s", ctx->host, ctx->port,
+           rp->ai_family == AF_INET6 ? "IPv6" : "IPv4", strerror(errno));
+    close(sock);
+  }
+
+  logger(LOG_ERROR, "HTTP fetch: Failed to connect to %s:%d: %s", ctx->host, ctx->port,
+         ctx->connect_last_errno ? strerror(ctx->connect_last_errno) : "no usable address");
+  http_fetch_free_connect_results(ctx);
+  return -1;
+}
+
+/* Completion of the lookup started by http_fetch_native_begin.  Runs outside
+ * the fetch completion path, so failures are left for the tick. */
+static void http_fetch_on_resolved(void *opaque, struct addrinfo *results, const char *error) {
+  http_fetch_ctx_t *ctx = opaque;
+
+  ctx->resolve_query = NULL;
+  if (!results) {
+    logger(LOG_ERROR, "HTTP fetch: Cannot resolve hostname %s: %s", ctx->host, error);
+    ctx->failed = 1;
+    return;
+  }
+
+  ctx->connect_results = results;
+  ctx->connect_next = results;
+  if (http_fetch_try_next_candidate(ctx) < 0)
+    ctx->failed = 1;
+}
+
+/* Serialize the GET request for ctx->url (path and Host from the URL) */
+static int http_fetch_build_request(http_fetch_ctx_t *ctx, const char *authority, size_t authority_len,
+                                    const char *path) {
+  const http_fetch_validators_t *validators = http_fetch_active_validators(ctx);
+  const char *etag = validators && validators->etag[0] ? validators->etag : NULL;
+  const char *last_modified = validators && validators->last_modified[0] ? validators->last_modified : NULL;
+  size_t path_len = strcspn(path, "#");
+  size_t size = path_len + authority_len + 2 * HTTP_FETCH_VALIDATOR_SIZE + 256;
+
+  free(ctx->request);
+  ctx->request = malloc(size);
+  if (!ctx->request)
+    return -1;
+
+  int len = snprintf(ctx->request, size,
+                     "GET %.*s HTTP/1.1\r\n"
+                     "Host: %.*s\r\n"
+                     "User-Agent: rtp2httpd/" VERSION "\r\n"
+                     "Accept: */*\r\n"
+                     "Accept-Encoding: identity\r\n"
+                     "Connection: close\r\n"
+                     "%s%s%s"
+                     "%s%s%s"
+                     "\r\n",
+                     (int)path_len, path, (int)authority_len, authority, etag ? "If-None-Match: " : "",
+                     etag ? etag : "", etag ? "\r\n" : "", last_modified ? "If-Modified-Since: " : "",
+                     last_modified ? last_modified : "", last_modified ? "\r\n" : "");
+  if (len < 0 || (size_t)len >= size)
+    return -1;
+
+  ctx->request_len = (size_t)len;
+  ctx->request_sent = 0;
+  return 0;
+}
+
+/* Reset the body output before a (re)started request */
+static int http_fetch_reset_output(http_fetch_ctx_t *ctx) {
+  ctx->body_size = 0;
+  ctx->buffer_used = 0;
+
+  if (!ctx->use_fd)
+    return 0;
+
+  if (ctx->out_fd >= 0) {
+    if (ftruncate(ctx->out_fd, 0) < 0 || lseek(ctx->out_fd, 0, SEEK_SET) < 0)
+      return -1;
+    return 0;
+  }
+
+  /* Body is streamed to an unlinked tmpfs file handed to the caller */
+  char temp_file_template[] = "/tmp/rtp2httpd_http_fetch_XXXXXX";
+  ctx->out_fd = mkstemp(temp_file_template);
+  if (ctx->out_fd < 0) {
+    logger(LOG_ERROR, "Failed to create temporary file for async HTTP fetch");
+    return -1;
+  }
+  unlink(temp_file_template);
+  return 0;
+}
+
+/* Whether no_proxy / NO_PROXY exempts host from the proxy, as in curl: "*"
+ * matches everything, other entries match the host or a domain suffix */
+static int http_fetch_no_proxy(const char *host) {
+  const char *list = getenv("no_proxy");
+  if (!list || !*list)
+    list = getenv("NO_PROXY");
+  if (!list)
+    return 0;
+
+  size_t host_len = strlen(host);
+  while (*list) {
+    list += strspn(list, ", \t");
+    size_t len = strcspn(list, ", \t");
+    const char *entry = list;
+    list += len;
+    if (len == 1 && *entry == '*')
+      return 1;
+    if (len > 0 && *entry == '.') {
+      entry++;
+      len--;
+    }
+    if (len == 0 || len > host_len || strncasecmp(host + host_len - len, entry, len) != 0)
+      continue;
+    if (len == host_len || host[host_len - len - 1] == '.')
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Find the proxy curl would use for a http:// URL to host (http_proxy, then
+ * all_proxy / ALL_PROXY; like curl, upper case HTTP_PROXY is ignored)
+ * @return 0 with *proxy_host / *proxy_port set, 1 if the fetch goes direct,
+ * -1 if the proxy needs an external tool (credentials, SOCKS, TLS)
+ */
+static int http_fetch_find_proxy(const char *host, char *proxy_host, size_t proxy_host_size, int *proxy_port) {
+  const char *proxy = getenv("http_proxy");
+  if (!proxy || !*proxy)
+    proxy = getenv("all_proxy");
+  if (!proxy || !*proxy)
+    proxy = getenv("ALL_PROXY");
+  if (!proxy || !*proxy || http_fetch_no_proxy(host))
+    return 1;
+
+  const char *scheme_end = strstr(proxy, "://");
+  if (scheme_end) {
+    if ((size_t)(scheme_end - proxy) != 4 || strncasecmp(proxy, "http", 4) != 0)
+      return -1;
+    proxy = scheme_end + 3;
+  }
+
+  char hostport[HTTP_FETCH_HOST_SIZE + 16];
+  size_t len = strcspn(proxy, "/?#");
+  if (memchr(proxy, '@', len))
+    return -1;
+  if (len == 0 || len >= sizeof(hostport))
+    return -1;
+  memcpy(hostport, proxy, len);
+  hostport[len] = '\0';
+  *proxy_port = 1080; /* curl's default proxy port */
+  if (parse_host_port(hostport, proxy_host, proxy_host_size, proxy_port) != 0)
+    return -1;
+  return 0;
+}
+
+/**
+ * Start (or restart after a redirect) an in-process fetch of ctx->url
+ * @return 0 if started, 1 if the URL needs an external tool (https://,
+ * credentials, or a proxy the client cannot speak to), -1 on error
+ */
+static int http_fetch_native_begin(http_fetch_ctx_t *ctx) {
+  const char *error = NULL;
+  const char *authority;
+  const char *path;
+  char hostport[HTTP_FETCH_HOST_SIZE + 16];
+  char proxy_host[HTTP_FETCH_HOST_SIZE];
+  int proxy_port = 0;
+
+  if (strncasecmp(ctx->url, "http://", 7) != 0)
+    return 1;
+
+  authority = ctx->url + 7;
+  path = authority + strcspn(authority, "/?#");
+  size_t authority_len = (size_t)(path - authority);
+  if (memchr(authority, '@', authority_len))
+    return 1;
+
+  if (authority_len == 0 || authority_len >= sizeof(hostport)) {
+    logger(LOG_ERROR, "HTTP fetch: Invalid host in URL: %s", ctx->url);
+    return -1;
+  }
+  memcpy(hostport, authority, authority_len);
+  hostport[authority_len] = '\0';
+  ctx->port = 80;
+  if (parse_host_port(hostport, ctx->host, sizeof(ctx->host), &ctx->port) != 0) {
+    logger(LOG_ERROR, "HTTP fetch: Invalid host format: %s", hostport);
+    return -1;
+  }
+
+  /* Proxied requests connect to the proxy and carry the absolute URL */
+  int proxy = http_fetch_find_proxy(ctx->host, proxy_host, sizeof(proxy_host), &proxy_port);
+  if (proxy < 0)
+    return 1;
+  const char *target = *path == '/' ? path : "/";
+  if (proxy == 0) {
+    logger(LOG_DEBUG, "HTTP fetch: Using proxy %s:%d for %s", proxy_host, proxy_port, ctx->host);
+    snprintf(ctx->host, sizeof(ctx->host), "%s", proxy_host);
+    ctx->port = proxy_port;
+    target = ctx->url;
+  }
+
+  if (http_fetch_build_request(ctx, authority, authority_len, target) < 0) {
+    logger(LOG_ERROR, "HTTP fetch: Request too large for URL: %s", ctx->url);
+    return -1;
+  }
+  if (!ctx->headers) {
+    ctx->headers = malloc(HTTP_FETCH_MAX_HEADER_SIZE + 1);
+    if (!ctx->headers)
+      return -1;
+  }
+  ctx->headers_used = 0;
+  ctx->status_code = 0;
+  ctx->content_length = -1;
+  ctx->chunked = 0;
+  ctx->etag[0] = '\0';
+  ctx->last_modified[0] = '\0';
+  if (http_fetch_reset_output(ctx) < 0)
+    return -1;
+
+  if (!ctx->native) {
+    ctx->native = 1;
+    ctx->deadline_ms = get_time_ms() + HTTP_FETCH_TIMEOUT_MS;
+    ctx->next = native_fetches;
+    native_fetches = ctx;
+  }
+
+  logger(LOG_DEBUG, "Starting async HTTP fetch: %s", ctx->url);
+
+  ctx->connect_last_errno = 0;
+  ctx->state = HTTP_FETCH_STATE_RESOLVING;
+  int r = resolver_lookup(ctx->host, ctx->port, SOCK_STREAM, &ctx->connect_results, &error, http_fetch_on_resolved,
+                          ctx, &ctx->resolve_query);
+  if (r < 0) {
+    logger(LOG_ERROR, "HTTP fetch: Cannot resolve hostname %s: %s", ctx->host, error);
+    return -1;
+  }
+  if (r > 0)
+    return 0;
+
+  ctx->connect_next = ctx->connect_results;
+  return http_fetch_try_next_candidate(ctx);
+}
+
+/* Append decoded body bytes to the output (tmpfs file or memory buffer) */
+static int http_fetch_emit_body(void *opaque, const uint8_t *data, size_t len) {
+  http_fetch_ctx_t *ctx = opaque;
+
+  if (ctx->body_size + len > MAX_HTTP_CONTENT) {
+    logger(LOG_ERROR, "HTTP fetch: Response too large (max %d bytes): %s", MAX_HTTP_CONTENT, ctx->url);
+    return -1;
+  }
+
+  if (ctx->use_fd) {
+    size_t off = 0;
+    while (off < len) {
+      ssize_t w = write(ctx->out_fd, data + off, len - off);
+      if (w < 0) {
+        if (errno == EINTR)
+          continue;
+        logger(LOG_ERROR, "HTTP fetch: Failed to write response body: %s", strerror(errno));
+        return -1;
+      }
+      off += (size_t)w;
+    }
+  } else {
+    if (ctx->buffer_used + len + 1 > ctx->buffer_size) {
+      size_t new_size = ctx->buffer_size ? ctx->buffer_size : HTTP_FETCH_BUFFER_SIZE;
+      while (ctx->buffer_used + len + 1 > new_size)
+        new_size *= 2;
+      char *new_buf = realloc(ctx->buffer, new_size);
+      if (!new_buf) {
+        logger(LOG_ERROR, "Failed to grow buffer for async HTTP fetch");
+        return -1;
+      }
+      ctx->buffer = new_buf;
+      ctx->buffer_size = new_size;
+    }
+    memcpy(ctx->buffer + ctx->buffer_used, data, len);
+    ctx->buffer_used += len;
+  }
+
+  ctx->body_size += len;
+  return 0;
+}
+
+/* Deliver a finished in-process fetch to the caller and free it */
+static int http_fetch_native_complete(http_fetch_ctx_t *ctx) {
+  http_fetch_remove_from_map(ctx);
+
+  if (ctx->not_modified) {
+    logger(LOG_DEBUG, "Async HTTP fetch not modified: %s", ctx->url);
+    if (ctx->use_fd)
+      ctx->fd_callback(ctx, -1, 0, ctx->user_data);
+    else
+      ctx->callback(ctx, NULL, 0, ctx->user_data);
     http_fetch_free(ctx);
-    return NULL;
+    return 1;
   }
 
-  /* Initialize hashmap if needed */
-  http_fetch_init_map();
+  http_fetch_store_validators(ctx, ctx->etag, ctx->last_modified);
+
+  if (ctx->use_fd) {
+    int content_fd = ctx->out_fd;
+    ctx->out_fd = -1;
+    lseek(content_fd, 0, SEEK_SET);
+    logger(LOG_DEBUG, "Async HTTP fetch completed successfully (%zu bytes, fd=%d): %s", ctx->body_size, content_fd,
+           ctx->url);
+    ctx->fd_callback(ctx, content_fd, ctx->body_size, ctx->user_data);
+  } else {
+    char *content = ctx->buffer ? ctx->buffer : malloc(1);
+    if (!content) {
+      http_fetch_cancel(ctx);
+      return -1;
+    }
+    content[ctx->buffer_used] = '\0';
+    ctx->buffer = NULL;
+    logger(LOG_DEBUG, "Async HTTP fetch completed successfully (%zu bytes): %s", ctx->body_size, ctx->url);
+    ctx->callback(ctx, content, ctx->body_size, ctx->user_data);
+  }
 
-  /* Add to hashmap for fast fd-based lookup */
-  if (fetch_fd_map) {
-    http_fetch_ctx_t *ctx_ptr = ctx;
-    hashmap_set(fetch_fd_map, &ctx_ptr);
+  http_fetch_free(ctx);
+  return 1;
+}
+
+/* Copy a header value into dest (trimmed) */
+static void http_fetch_copy_header(char *dest, size_t dest_size, const char *value, size_t value_len) {
+  while (value_len > 0 && (*value == ' ' || *value == '\t')) {
+    value++;
+    value_len--;
   }
+  while (value_len > 0 && (value[value_len - 1] == ' ' || value[value_len - 1] == '\t'))
+    value_len--;
+  if (value_len >= dest_size)
+    value_len = 0; /* Oversized validators are not worth keeping */
+  memcpy(dest, value, value_len);
+  dest[value_len] = '\0';
+}
 
-  logger(LOG_DEBUG, "Async HTTP fetch started, pipe_fd=%d", ctx->pipe_fd);
-  return ctx;
+/**
+ * Follow a redirect to location (absolute or root-relative)
+ * @return 0 if the new request started, -1 on error
+ */
+static int http_fetch_follow_redirect(http_fetch_ctx_t *ctx, const char *location) {
+  char *target;
+
+  if (++ctx->redirects > HTTP_FETCH_MAX_REDIRECTS) {
+    logger(LOG_ERROR, "HTTP fetch: Too many redirects: %s", ctx->url);
+    return -1;
+  }
+
+  if (location[0] == '/' && location[1] != '/') {
+    const char *authority = ctx->url + 7;
+    size_t prefix_len = (size_t)(authority - ctx->url) + strcspn(authority, "/?#");
+    target = malloc(prefix_len + strlen(location) + 1);
+    if (!target)
+      return -1;
+    memcpy(target, ctx->url, prefix_len);
+    strcpy(target + prefix_len, location);
+  } else if (strncasecmp(location, "http://", 7) == 0 || strncasecmp(location, "https://", 8) == 0) {
+    target = strdup(location);
+    if (!target)
+      return -1;
+  } else {
+    logger(LOG_ERROR, "HTTP fetch: Unsupported redirect location: %s", location);
+    return -1;
+  }
+
+  logger(LOG_DEBUG, "HTTP fetch: Redirected to %s", target);
+  free(ctx->url);
+  ctx->url = target;
+
+  http_fetch_free_connect_results(ctx);
+  http_fetch_close_socket(ctx);
+
+  int r = http_fetch_native_begin(ctx);
+  if (r > 0) {
+    /* Redirected to https:// - continue with the external tool */
+    http_fetch_native_release(ctx);
+    if (ctx->out_fd >= 0) {
+      close(ctx->out_fd);
+      ctx->out_fd = -1;
+    }
+    r = http_fetch_tool_begin(ctx);
+  }
+  return r;
+}
+
+/**
+ * Parse the response head once complete
+ * @return 1 if the head is not complete yet, 0 if parsed (ctx->state is BODY),
+ * 2 if the fetch was restarted by a redirect, 3 if complete without body,
+ * -1 on error
+ */
+static int http_fetch_parse_headers(http_fetch_ctx_t *ctx, size_t *body_offset) {
+  char location[MAX_URL_LENGTH];
+  char *end;
+
+  ctx->headers[ctx->headers_used] = '\0';
+  end = strstr(ctx->headers, "\r\n\r\n");
+  if (!end) {
+    if (ctx->headers_used >= HTTP_FETCH_MAX_HEADER_SIZE) {
+      logger(LOG_ERROR, "HTTP fetch: Response headers too large: %s", ctx->url);
+      return -1;
+    }
+    return 1;
+  }
+  *body_offset = (size_t)(end - ctx->headers) + 4;
+  *end = '\0';
+
+  if (sscanf(ctx->headers, "HTTP/%*d.%*d %d", &ctx->status_code) != 1) {
+    logger(LOG_ERROR, "HTTP fetch: Invalid response status line: %s", ctx->url);
+    return -1;
+  }
+
+  location[0] = '\0';
+  for (char *line = strstr(ctx->headers, "\r\n"); line; line = strstr(line, "\r\n")) {
+    line += 2;
+    char *line_end = strstr(line, "\r\n");
+    size_t line_len = line_end ? (size_t)(line_end - line) : strlen(line);
+    char *colon = memchr(line, ':', line_len);
+    if (!colon)
+      continue;
+    size_t name_len = (size_t)(colon - line);
+    const char *value = colon + 1;
+    size_t value_len = line_len - name_len - 1;
+
+    if (name_len == 14 && strncasecmp(line, "Content-Length", 14) == 0) {
+      ctx->content_length = strtoll(value, NULL, 10);
+    } else if (name_len == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0) {
+      char encoding[64];
+      http_fetch_copy_header(encoding, sizeof(encoding), value, value_len);
+      ctx->chunked = strcasestr(encoding, "chunked") != NULL;
+    } else if (name_len == 8 && strncasecmp(line, "Location", 8) == 0) {
+      http_fetch_copy_header(location, sizeof(location), value, value_len);
+    } else if (name_len == 4 && strncasecmp(line, "ETag", 4) == 0) {
+      http_fetch_copy_header(ctx->etag, sizeof(ctx->etag), value, value_len);
+    } else if (name_len == 13 && strncasecmp(line, "Last-Modified", 13) == 0) {
+      http_fetch_copy_header(ctx->last_modified, sizeof(ctx->last_modified), value, value_len);
+    }
+  }
+
+  if (ctx->status_code == 304 && http_fetch_active_validators(ctx)) {
+    ctx->not_modified = 1;
+    return 3;
+  }
+
+  if ((ctx->status_code == 301 || ctx->status_code == 302 || ctx->status_code == 303 || ctx->status_code == 307 ||
+       ctx->status_code == 308) &&
+      location[0]) {
+    return http_fetch_follow_redirect(ctx, location) < 0 ? -1 : 2;
+  }
+
+  if (ctx->status_code != 200) {
+    logger(LOG_ERROR, "HTTP fetch: Upstream returned HTTP %d: %s", ctx->status_code, ctx->url);
+    return -1;
+  }
+
+  if (ctx->content_length > MAX_HTTP_CONTENT) {
+    logger(LOG_ERROR, "HTTP fetch: Response too large (%lld bytes): %s", (long long)ctx->content_length, ctx->url);
+    return -1;
+  }
+
+  if (ctx->chunked)
+    http_chunked_decoder_init(&ctx->chunked_decoder);
+  ctx->state = HTTP_FETCH_STATE_BODY;
+  return (!ctx->chunked && ctx->content_length == 0) ? 3 : 0;
+}
+
+/**
+ * Consume received body bytes
+ * @return 0 if more is expected, 1 if the body is complete, -1 on error
+ */
+static int http_fetch_consume_body(http_fetch_ctx_t *ctx, const uint8_t *data, size_t len) {
+  if (ctx->chunked) {
+    size_t consumed = 0;
+    http_chunked_decode_result_t result =
+        http_chunked_decoder_feed(&ctx->chunked_decoder, data, len, http_fetch_emit_body, ctx, &consumed);
+    if (result == HTTP_CHUNKED_DECODE_ERROR) {
+      logger(LOG_ERROR, "HTTP fetch: Invalid chunked response body: %s", ctx->url);
+      return -1;
+    }
+    return result == HTTP_CHUNKED_DECODE_DONE ? 1 : 0;
+  }
+
+  if (ctx->content_length >= 0 && ctx->body_size + len > (size_t)ctx->content_length)
+    len = (size_t)ctx->content_length - ctx->body_size;
+  if (len > 0 && http_fetch_emit_body(ctx, data, len) < 0)
+    return -1;
+  return (ctx->content_length >= 0 && ctx->body_size >= (size_t)ctx->content_length) ? 1 : 0;
+}
+
+/* Drive the in-process client on a poller event (or a tick-reported failure) */
+static int http_fetch_native_handle_event(http_fetch_ctx_t *ctx) {
+  uint8_t read_buf[HTTP_FETCH_BUFFER_SIZE];
+
+  if (ctx->failed) {
+    http_fetch_cancel(ctx);
+    return -1;
+  }
+
+  if (get_time_ms() >= ctx->deadline_ms) {
+    logger(LOG_ERROR, "HTTP fetch: Timed out: %s", ctx->url);
+    http_fetch_cancel(ctx);
+    return -1;
+  }
+
+  if (ctx->state == HTTP_FETCH_STATE_RESOLVING)
+    return 0;
+
+  if (ctx->state == HTTP_FETCH_STATE_CONNECTING) {
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+    if (getsockopt(ctx->fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0)
+      err = errno;
+    if (err != 0) {
+      ctx->connect_last_errno = err;
+      logger(LOG_DEBUG, "HTTP fetch: Async connect to %s:%d failed: %s", ctx->host, ctx->port, strerror(err));
+      http_fetch_close_socket(ctx);
+      if (http_fetch_try_next_candidate(ctx) < 0) {
+        http_fetch_cancel(ctx);
+        return -1;
+      }
+      return 0;
+    }
+    http_fetch_free_connect_results(ctx);
+    ctx->state = HTTP_FETCH_STATE_SENDING;
+  }
+
+  if (ctx->state == HTTP_FETCH_STATE_SENDING) {
+    while (ctx->request_sent < ctx->request_len) {
+      ssize_t sent =
+          send(ctx->fd, ctx->request + ctx->request_sent, ctx->request_len - ctx->request_sent, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EAGAIN || errno == ENOTCONN)
+          return 0;
+        if (errno == EINTR)
+          continue;
+        logger(LOG_ERROR, "HTTP fetch: Failed to send request to %s:%d: %s", ctx->host, ctx->port, strerror(errno));
+        http_fetch_cancel(ctx);
+        return -1;
+      }
+      ctx->request_sent += (size_t)sent;
+    }
+    poller_mod(ctx->epfd, ctx->fd, POLLER_IN | POLLER_ERR | POLLER_HUP | POLLER_RDHUP);
+    ctx->state = HTTP_FETCH_STATE_HEADERS;
+  }
+
+  for (;;) {
+    ssize_t nread = recv(ctx->fd, read_buf, sizeof(read_buf), 0);
+    if (nread < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN)
+        return 0;
+      logger(LOG_ERROR, "HTTP fetch: Failed to receive from %s:%d: %s", ctx->host, ctx->port, strerror(errno));
+      http_fetch_cancel(ctx);
+      return -1;
+    }
+
+    if (nread == 0) {
+      /* Connection: close - EOF ends a body without length */
+      if (ctx->state == HTTP_FETCH_STATE_BODY && !ctx->chunked && ctx->content_length < 0)
+        return http_fetch_native_complete(ctx);
+      logger(LOG_ERROR, "HTTP fetch: Connection closed before the response was complete: %s", ctx->url);
+      http_fetch_cancel(ctx);
+      return -1;
+    }
+
+    const uint8_t *data = read_buf;
+    size_t len = (size_t)nread;
+    int r;
+
+    if (ctx->state == HTTP_FETCH_STATE_HEADERS) {
+      size_t body_offset = 0;
+      size_t copy = min(len, (size_t)HTTP_FETCH_MAX_HEADER_SIZE - ctx->headers_used);
+      size_t previous = ctx->headers_used;
+      memcpy(ctx->headers + ctx->headers_used, data, copy);
+      ctx->headers_used += copy;
+
+      r = http_fetch_parse_headers(ctx, &body_offset);
+      if (r < 0) {
+        http_fetch_cancel(ctx);
+        return -1;
+      }
+      if (r == 1)
+        continue;
+      if (r == 2)
+        return 0;
+      if (r == 3)
+        return http_fetch_native_complete(ctx);
+
+      /* Body bytes that arrived with the headers */
+      data += body_offset - previous;
+      len -= body_offset - previous;
+    }
+
+    r = http_fetch_consume_body(ctx, data, len);
+    if (r < 0) {
+      http_fetch_cancel(ctx);
+      return -1;
+    }
+    if (r > 0)
+      return http_fetch_native_complete(ctx);
+  }
 }
 
 /* Handle epoll event for async HTTP fetch */
@@ -461,8 +1270,11 @@ int http_fetch_handle_event(http_fetch_ctx_t *ctx) {
   if (!ctx)
     return -1;
 
+  if (ctx->native)
+    return http_fetch_native_handle_event(ctx);
+
   /* Read available data from pipe (curl stderr output) */
-  while ((nread = read(ctx->pipe_fd, read_buf, sizeof(read_buf))) > 0) {
+  while ((nread = read(ctx->fd, read_buf, sizeof(read_buf))) > 0) {
     /* Grow buffer if needed */
     while (ctx->buffer_used + nread + 1 > ctx->buffer_size) {
       size_t new_size = ctx->buffer_size * 2;
@@ -620,6 +1432,7 @@ void http_fetch_cancel(http_fetch_ctx_t *ctx) {
   http_fetch_remove_from_map(ctx);
 
   /* Invoke callback with NULL/error to signal cancellation */
+  ctx->not_modified = 0;
   if (ctx->use_fd && ctx->fd_callback) {
     ctx->fd_callback(ctx, -1, 0, ctx->user_data);
   } else if (ctx->callback) {
@@ -630,13 +1443,32 @@ void http_fetch_cancel(http_fetch_ctx_t *ctx) {
   http_fetch_free(ctx);
 }
 
-/* Start async HTTP fetch using popen (memory-based) */
-http_fetch_ctx_t *http_fetch_start_async(const char *url, http_fetch_callback_t callback, void *user_data, int epfd) {
-  return http_fetch_start_async_internal(url, callback, NULL, user_data, epfd);
+int http_fetch_tick(int64_t now, http_fetch_ctx_t **due, int num_due, int max_due) {
+  for (http_fetch_ctx_t *ctx = native_fetches; ctx && num_due < max_due; ctx = ctx->next) {
+    if (!ctx->failed && now < ctx->deadline_ms)
+      continue;
+
+    int queued = 0;
+    for (int i = 0; i < num_due; i++) {
+      if (due[i] == ctx) {
+        queued = 1;
+        break;
+      }
+    }
+    if (!queued)
+      due[num_due++] = ctx;
+  }
+  return num_due;
+}
+
+/* Start async HTTP fetch (memory-based) */
+http_fetch_ctx_t *http_fetch_start_async(const char *url, http_fetch_validators_t *validators,
+                                         http_fetch_callback_t callback, void *user_data, int epfd) {
+  return http_fetch_start_async_internal(url, validators, callback, NULL, user_data, epfd);
 }
 
-/* Start async HTTP fetch using popen (fd-based, zero-copy) */
-http_fetch_ctx_t *http_fetch_start_async_fd(const char *url, http_fetch_fd_callback_t callback, void *user_data,
-                                            int epfd) {
-  return http_fetch_start_async_internal(url, NULL, callback, user_data, epfd);
+/* Start async HTTP fetch (fd-based, zero-copy) */
+http_fetch_ctx_t *http_fetch_start_async_fd(const char *url, http_fetch_validators_t *validators,
+                                            http_fetch_fd_callback_t callback, void *user_data, int epfd) {
+  return http_fetch_start_async_internal(url, validators, NULL, callback, user_data, epfd);
 }
@@ -2,13 +2,29 @@
 #define __HTTP_FETCH_H__
 
 #include <stddef.h>
+#include <stdint.h>
+
+/* Largest ETag / Last-Modified value remembered for conditional requests */
+#define HTTP_FETCH_VALIDATOR_SIZE 128
 
 /* Async HTTP fetch context (opaque) */
 typedef struct http_fetch_ctx_s http_fetch_ctx_t;
 
+/* Validators of the last successful fetch of a URL, owned by the caller.
+ * When passed to a fetch of the same URL they are sent as If-None-Match /
+ * If-Modified-Since (file:// URLs compare modification time and size), and
+ * an unchanged resource completes with http_fetch_not_modified() set instead
+ * of being downloaded again.  A successful fetch updates them in place. */
+typedef struct http_fetch_validators_s {
+  uint64_t url_hash;                             /* URL the validators belong to (0 = none) */
+  char etag[HTTP_FETCH_VALIDATOR_SIZE];          /* ETag response header */
+  char last_modified[HTTP_FETCH_VALIDATOR_SIZE]; /* Last-Modified response header */
+} http_fetch_validators_t;
+
 /* Callback type for async HTTP fetch completion
  * ctx: fetch context
- * content: fetched content (caller must free), or NULL on error
+ * content: fetched content (caller must free), or NULL on error or when
+ * http_fetch_not_modified(ctx) is set
  * content_size: size of fetched content in bytes (0 if content is NULL)
  * user_data: user-provided data passed to http_fetch_start_async
  */
@@ -28,38 +44,57 @@ typedef void (*http_fetch_callback_t)(http_fetch_ctx_t *ctx, char *content, size
 typedef void (*http_fetch_fd_callback_t)(http_fetch_ctx_t *ctx, int fd, size_t content_size, void *user_data);
 
 /**
- * Start async fetch using popen and curl (supports HTTP(S) and file:// URLs)
- * This function starts a non-blocking HTTP(S) fetch using curl via popen.
- * The pipe is added to the provided epoll instance for async I/O.
- * For file:// URLs, the fetch completes synchronously and callback is invoked
- * immediately.
+ * Start async fetch (supports HTTP(S) and file:// URLs)
+ * http:// URLs are fetched in-process by a non-blocking HTTP/1.1 client on
+ * the provided epoll instance (upstream-interface-http applies).  https://
+ * URLs and URLs with credentials are handed to curl / uclient-fetch / wget
+ * via popen.  For file:// URLs, the fetch completes synchronously and
+ * callback is invoked immediately.
  *
  * @param url URL to fetch (http://, https://, or file://)
+ * @param validators Validators for a conditional fetch (can be NULL)
  * @param callback Function to call when fetch completes (required)
  * @param user_data User-provided data passed to callback (can be NULL)
  * @param epfd epoll file descriptor for async I/O (required)
  * @return Fetch context on success (HTTP(S)), NULL for file:// (immediate
  * completion) or error
  */
-http_fetch_ctx_t *http_fetch_start_async(const char *url, http_fetch_callback_t callback, void *user_data, int epfd);
+http_fetch_ctx_t *http_fetch_start_async(const char *url, http_fetch_validators_t *validators,
+                                         http_fetch_callback_t callback, void *user_data, int epfd);
 
 /**
- * Start async fetch using popen and curl (zero-copy with file descriptor,
- * supports file://) This function starts a non-blocking HTTP(S) fetch using
- * curl via popen. The pipe is added to the provided epoll instance for async
- * I/O. Upon completion, a tmpfs file descriptor is passed to the callback for
- * zero-copy transmission. For file:// URLs, the file is opened directly and
- * callback is invoked immediately.
+ * Start async fetch (zero-copy with file descriptor, supports file://)
+ * Same transports as http_fetch_start_async; the response body is streamed
+ * into a tmpfs file as it arrives. Upon completion, the file descriptor is
+ * passed to the callback for zero-copy transmission. For file:// URLs, the
+ * file is opened directly and callback is invoked immediately.
  *
  * @param url URL to fetch (http://, https://, or file://)
+ * @param validators Validators for a conditional fetch (can be NULL)
  * @param callback Function to call when fetch completes (required)
  * @param user_data User-provided data passed to callback (can be NULL)
  * @param epfd epoll file descriptor for async I/O (required)
  * @return Fetch context on success (HTTP(S)), NULL for file:// (immediate
  * completion) or error
  */
-http_fetch_ctx_t *http_fetch_start_async_fd(const char *url, http_fetch_fd_callback_t callback, void *user_data,
-                                            int epfd);
+http_fetch_ctx_t *http_fetch_start_async_fd(const char *url, http_fetch_validators_t *validators,
+                                            http_fetch_fd_callback_t callback, void *user_data, int epfd);
+
+/**
+ * Check whether a completed fetch found the resource unchanged
+ * Only meaningful inside a completion callback that received no content.
+ *
+ * @param ctx Fetch context passed to the callback
+ * @return 1 if the validators still matched (304 Not Modified), 0 otherwise
+ */
+int http_fetch_not_modified(const http_fetch_ctx_t *ctx);
+
+/**
+ * Forget validators, so that the next fetch downloads the resource again
+ *
+ * @param validators Validators to clear
+ */
+void http_fetch_validators_reset(http_fetch_validators_t *validators);
 
 /**
  * Find HTTP fetch context by file descriptor
@@ -84,11 +119,26 @@ int http_fetch_handle_event(http_fetch_ctx_t *ctx);
 
 /**
  * Cancel and cleanup async HTTP fetch
- * This terminates the curl process, removes it from epoll, and frees resources.
+ * This terminates the fetch process or closes the upstream socket, removes it
+ * from epoll, and frees resources.
  * The completion callback is invoked with NULL content to signal cancellation.
  *
  * @param ctx Fetch context to cancel
  */
 void http_fetch_cancel(http_fetch_ctx_t *ctx);
 
+/**
+ * Collect in-process fetches that failed outside the poller or timed out
+ * Completing a fetch may replace services, so the caller handles the
+ * returned contexts with http_fetch_handle_event() together with the fetch
+ * events of this iteration.
+ *
+ * @param now Current time in milliseconds
+ * @param due Fetch contexts queued for handling
+ * @param num_due Entries already in due (not added twice)
+ * @param max_due Capacity of due
+ * @return New number of entries in due
+ */
+int http_fetch_tick(int64_t now, http_fetch_ctx_t **due, int num_due, int max_due);
+
 #endif /* __HTTP_FETCH_H__ */
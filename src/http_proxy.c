@@ -3,9 +3,13 @@
 #include "configuration.h"
 #include "connection.h"
 #include "http.h"
+#include "http_proxy_cache.h"
+#include "http_proxy_pool.h"
 #include "http_proxy_rewrite.h"
 #include "platform_compat.h"
 #include "poller.h"
+#include "resolver.h"
+#include "rtp2httpd.h"
 #include "status.h"
 #include "utils.h"
 #include "worker.h"
@@ -26,16 +30,25 @@
  *
  * This module implements an HTTP reverse proxy that forwards requests
  * to upstream HTTP servers and streams the response back to clients.
+ * Upstream connections are kept alive: a response is complete when its
+ * framing says so, and the socket then goes to the per-worker pool in
+ * http_proxy_pool.c for the next request to the same upstream.
  */
 
+#define HTTP_PROXY_STATS_INC(field)                                                                                    \
+  do {                                                                                                                 \
+    if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS) {                                           \
+      status_shared->worker_stats[worker_id].field++;                                                                  \
+    }                                                                                                                  \
+  } while (0)
+
 /* Helper function prototypes */
 static int http_proxy_build_request(http_proxy_session_t *session);
 static int http_proxy_try_send_pending(http_proxy_session_t *session);
 static int http_proxy_try_receive_response(http_proxy_session_t *session);
 static int http_proxy_parse_response_headers(http_proxy_session_t *session);
-static int http_proxy_append_raw_headers(http_proxy_session_t *session, char **dest, size_t *remaining, int *total_len,
-                                         int filter_user_agent);
 static void http_proxy_pause_upstream(http_proxy_session_t *session);
+static void http_proxy_release_upstream(http_proxy_session_t *session);
 
 static void http_proxy_parse_transfer_encoding(http_proxy_session_t *session, const char *value) {
   const char *cursor = value;
@@ -138,6 +151,8 @@ void http_proxy_session_init(http_proxy_session_t *session) {
   session->status_index = -1;
   session->target_port = 80; /* Default HTTP port */
   session->content_length = -1;
+  session->cache_max_age = -1;
+  session->cache_s_maxage = -1;
   session->bytes_received = 0;
   session->headers_received = 0;
   session->headers_forwarded = 0;
@@ -179,13 +194,12 @@ void http_proxy_resume_upstream(http_proxy_session_t *session) {
     if (ret <= 0)
       break;
   }
-  /* EOF discovered mid-drain: no further upstream events will arrive, so
-   * close the upstream socket here and start the client drain. */
+  /* Response ended mid-drain (end of its framing, or EOF): no further
+   * upstream events will arrive for it, so release the upstream socket here
+   * and start the client drain. */
   if (session->state == HTTP_PROXY_STATE_COMPLETE) {
-    if (session->socket >= 0) {
-      worker_cleanup_socket_from_epoll(session->epoll_fd, session->socket);
-      session->socket = -1;
-    }
+    http_proxy_cache_finish(session);
+    http_proxy_release_upstream(session);
     connection_begin_drain_close(session->conn);
   }
 }
@@ -295,14 +309,13 @@ void http_proxy_set_method(http_proxy_session_t *session, const char *method) {
   session->method[sizeof(session->method) - 1] = '\0';
 }
 
-void http_proxy_set_raw_headers(http_proxy_session_t *session, const char *raw_headers, size_t raw_headers_len) {
+void http_proxy_set_client_request(http_proxy_session_t *session, const struct http_request_s *request) {
   if (!session)
     return;
 
-  /* Store pointer reference instead of copying - raw_headers points to
-   * http_request_t.raw_headers which remains valid during the proxy session */
-  session->raw_headers = raw_headers;
-  session->raw_headers_len = raw_headers_len;
+  /* Store pointer reference instead of copying - the request head stays in
+   * the connection input buffer during the proxy session */
+  session->client_request = request;
 }
 
 void http_proxy_set_request_body(http_proxy_session_t *session, const char *body, size_t body_len) {
@@ -340,10 +353,15 @@ void http_proxy_set_request_headers(http_proxy_session_t *session, const char *h
   }
 }
 
-/* Free the getaddrinfo candidate list (after success or final failure) */
+/* Free the candidate list and drop a pending lookup (after success or final
+ * failure) */
 static void http_proxy_free_connect_results(http_proxy_session_t *session) {
+  if (session->resolve_query) {
+    resolver_cancel(session->resolve_query);
+    session->resolve_query = NULL;
+  }
   if (session->connect_results) {
-    freeaddrinfo(session->connect_results);
+    resolver_freeaddrinfo(session->connect_results);
     session->connect_results = NULL;
     session->connect_next = NULL;
   }
@@ -368,8 +386,8 @@ static int http_proxy_on_connected(http_proxy_session_t *session) {
 }
 
 /**
- * Try connecting to the next candidate from the getaddrinfo result list
- * (sequential dual-stack fallback, IPv6/IPv4 in resolver order).
+ * Try connecting to the next candidate from the resolver's list
+ * (sequential dual-stack fallback, families alternating in resolver order).
  * On EINPROGRESS the session enters CONNECTING and the poller drives
  * completion; on hard failure the next candidate is tried immediately.
  * @return 0 if a connection succeeded or is in progress, -1 when all
@@ -473,33 +491,132 @@ static int http_proxy_handle_connect_failure(http_proxy_session_t *session, int
   return http_proxy_try_next_candidate(session);
 }
 
-int http_proxy_connect(http_proxy_session_t *session) {
-  struct addrinfo hints;
-  char port_str[16];
-  int gai_result;
+/* Completion of an asynchronous lookup started by http_proxy_connect */
+static void http_proxy_on_resolved(void *ctx, struct addrinfo *results, const char *error) {
+  http_proxy_session_t *session = ctx;
+
+  session->resolve_query = NULL;
+  if (!results) {
+    logger(LOG_ERROR, "HTTP Proxy: Cannot resolve hostname %s: %s", session->target_host, error);
+    session->connect_failed = 1;
+    return;
+  }
+
+  session->connect_results = results;
+  session->connect_next = results;
+  if (http_proxy_try_next_candidate(session) < 0)
+    session->connect_failed = 1;
+}
+
+/* Open a new connection to the upstream, bypassing the idle pool */
+static int http_proxy_connect_new(http_proxy_session_t *session) {
+  const char *error = NULL;
+
+  HTTP_PROXY_STATS_INC(http_upstream_connects);
+
+  /* Resolve hostname (dual-stack: IPv6 and IPv4 candidates) without blocking
+   * the event loop; numeric, /etc/hosts and cached names resolve at once */
+  session->connect_last_errno = 0;
+  session->connect_failed = 0;
+  int r = resolver_lookup(session->target_host, session->target_port, SOCK_STREAM, &session->connect_results, &error,
+                          http_proxy_on_resolved, session, &session->resolve_query);
+  if (r < 0) {
+    logger(LOG_ERROR, "HTTP Proxy: Cannot resolve hostname %s: %s", session->target_host, error);
+    return -1;
+  }
+  if (r > 0) {
+    /* The connect timeout also bounds the lookup */
+    logger(LOG_DEBUG, "HTTP Proxy: Resolving %s", session->target_host);
+    http_proxy_set_state(session, HTTP_PROXY_STATE_CONNECTING);
+    return 0;
+  }
+
+  session->connect_next = session->connect_results;
+  return http_proxy_try_next_candidate(session);
+}
+
+/* Continue on an idle connection taken from the pool */
+static int http_proxy_use_pooled(http_proxy_session_t *session, int sock) {
+  logger(LOG_DEBUG, "HTTP Proxy: Reusing idle connection to %s:%d", session->target_host, session->target_port);
+
+  session->socket = sock;
+  session->reused = 1;
+  if (session->epoll_fd >= 0) {
+    if (poller_add(session->epoll_fd, session->socket,
+                   POLLER_IN | POLLER_OUT | POLLER_HUP | POLLER_ERR | POLLER_RDHUP) < 0) {
+      logger(LOG_ERROR, "HTTP Proxy: Failed to add socket to poller: %s", strerror(errno));
+      close(session->socket);
+      session->socket = -1;
+      session->reused = 0;
+      return http_proxy_connect_new(session);
+    }
+    fdmap_set(session->socket, session->conn);
+  }
 
+  /* The poller reports the socket writable right away */
+  return http_proxy_on_connected(session);
+}
+
+int http_proxy_connect(http_proxy_session_t *session) {
   if (!session || session->socket >= 0) {
     logger(LOG_ERROR, "HTTP Proxy: Invalid session or already connected");
     return -1;
   }
 
-  /* Resolve hostname (dual-stack: IPv6 and IPv4 candidates) */
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = SOCK_STREAM;
-  snprintf(port_str, sizeof(port_str), "%d", session->target_port);
+  /* Only requests that can be repeated without a body are sent on idle
+   * connections: one the upstream closed meanwhile is only noticed after the
+   * request went out, and the request is then sent again */
+  const char *method = session->method[0] ? session->method : "GET";
+  if (session->request_body_len == 0 && (strcasecmp(method, "GET") == 0 || strcasecmp(method, "HEAD") == 0)) {
+    int sock = http_proxy_pool_acquire(session->target_host, session->target_port, session->upstream_ifname);
+    if (sock >= 0)
+      return http_proxy_use_pooled(session, sock);
+  }
 
-  gai_result = getaddrinfo(session->target_host, port_str, &hints, &session->connect_results);
-  if (gai_result != 0) {
-    logger(LOG_ERROR, "HTTP Proxy: Cannot resolve hostname %s: %s", session->target_host, gai_strerror(gai_result));
-    session->connect_results = NULL;
+  return http_proxy_connect_new(session);
+}
+
+/* A pooled connection that the upstream closed while it was idle fails
+ * before the first response byte */
+static int http_proxy_can_retry(const http_proxy_session_t *session) {
+  return session->reused && !session->headers_received && session->response_buffer_pos == 0 &&
+         (session->state == HTTP_PROXY_STATE_SENDING_REQUEST || session->state == HTTP_PROXY_STATE_AWAITING_HEADERS);
+}
+
+/**
+ * Send the request again on a new connection after a reused one failed
+ * @return 0 if a new connection was started, -1 if the failure is final
+ */
+static int http_proxy_retry_on_new_connection(http_proxy_session_t *session) {
+  if (!http_proxy_can_retry(session))
     return -1;
-  }
 
-  session->connect_next = session->connect_results;
-  session->connect_last_errno = 0;
+  logger(LOG_DEBUG, "HTTP Proxy: Idle connection to %s:%d was closed by upstream, reconnecting", session->target_host,
+         session->target_port);
+  worker_cleanup_socket_from_epoll(session->epoll_fd, session->socket);
+  session->socket = -1;
+  session->reused = 0;
+  return http_proxy_connect_new(session);
+}
 
-  return http_proxy_try_next_candidate(session);
+/* Done with the upstream socket: keep it for the next request when the
+ * response ended exactly at its framing and the upstream allows reuse */
+static void http_proxy_release_upstream(http_proxy_session_t *session) {
+  if (session->socket < 0)
+    return;
+
+  if (session->keep_alive && session->response_complete && session->request_body_sent >= session->request_body_len) {
+    fdmap_del(session->socket);
+    if (session->epoll_fd >= 0)
+      poller_del(session->epoll_fd, session->socket);
+    /* Leave a second of margin to the upstream's own idle timeout */
+    int idle_sec = session->keep_alive_sec > 0 ? session->keep_alive_sec - 1 : HTTP_PROXY_POOL_IDLE_SEC;
+    http_proxy_pool_release(session->target_host, session->target_port, session->upstream_ifname, session->socket,
+                            idle_sec);
+  } else {
+    worker_cleanup_socket_from_epoll(session->epoll_fd, session->socket);
+  }
+  session->socket = -1;
 }
 
 static int http_proxy_build_request(http_proxy_session_t *session) {
@@ -522,7 +639,7 @@ static int http_proxy_build_request(http_proxy_session_t *session) {
   len = snprintf(session->pending_request, sizeof(session->pending_request),
                  "%s %s HTTP/1.1\r\n"
                  "Host: %s\r\n"
-                 "Connection: close\r\n",
+                 "Connection: keep-alive\r\n",
                  method, session->target_path, host_header);
 
   if (len < 0 || len >= (int)sizeof(session->pending_request)) {
@@ -547,10 +664,16 @@ static int http_proxy_build_request(http_proxy_session_t *session) {
 
   /* Add raw headers from client for full passthrough, filtering User-Agent
    * when a configured override should take precedence. */
-  if (session->raw_headers_len > 0) {
-    if (http_proxy_append_raw_headers(session, &p, &remaining, &len, override_user_agent != NULL) < 0) {
+  if (session->client_request) {
+    int raw_len =
+        http_request_format_forward_headers(session->client_request, p, remaining, override_user_agent != NULL);
+    if (raw_len < 0 || (size_t)raw_len >= remaining) {
+      logger(LOG_ERROR, "HTTP Proxy: Request too large (raw headers)");
       return -1;
     }
+    len += raw_len;
+    p += raw_len;
+    remaining -= raw_len;
   }
 
   if (override_user_agent) {
@@ -583,42 +706,6 @@ static int http_proxy_build_request(http_proxy_session_t *session) {
   return 0;
 }
 
-static int http_proxy_append_raw_headers(http_proxy_session_t *session, char **dest, size_t *remaining, int *total_len,
-                                         int filter_user_agent) {
-  size_t offset = 0;
-
-  while (offset < session->raw_headers_len) {
-    size_t line_len = 0;
-    const char *line = session->raw_headers + offset;
-
-    while (offset + line_len + 1 < session->raw_headers_len &&
-           !(line[line_len] == '\r' && line[line_len + 1] == '\n')) {
-      line_len++;
-    }
-
-    if (offset + line_len + 1 >= session->raw_headers_len) {
-      logger(LOG_ERROR, "HTTP Proxy: Malformed raw headers");
-      return -1;
-    }
-
-    if (!(filter_user_agent && line_len >= 11 && strncasecmp(line, "User-Agent:", 11) == 0)) {
-      if (line_len + 2 >= *remaining) {
-        logger(LOG_ERROR, "HTTP Proxy: Request too large (raw headers)");
-        return -1;
-      }
-
-      memcpy(*dest, line, line_len + 2);
-      *dest += line_len + 2;
-      *remaining -= line_len + 2;
-      *total_len += (int)(line_len + 2);
-    }
-
-    offset += line_len + 2;
-  }
-
-  return 0;
-}
-
 static int http_proxy_try_send_pending(http_proxy_session_t *session) {
   ssize_t sent;
   size_t remaining;
@@ -636,7 +723,8 @@ static int http_proxy_try_send_pending(http_proxy_session_t *session) {
         return total_sent > 0 ? total_sent : 0;
       }
       if (sent < 0) {
-        logger(LOG_ERROR, "HTTP Proxy: Send headers failed: %s", strerror(errno));
+        logger(http_proxy_can_retry(session) ? LOG_DEBUG : LOG_ERROR, "HTTP Proxy: Send headers failed: %s",
+               strerror(errno));
         return -1;
       }
       break; /* sent == 0: no progress */
@@ -680,105 +768,99 @@ static int http_proxy_try_send_pending(http_proxy_session_t *session) {
   return total_sent;
 }
 
-static int http_proxy_append_rewrite_body(http_proxy_session_t *session, const uint8_t *data, size_t len) {
-  size_t new_size;
-
-  if (len == 0)
+/* Body bytes still expected from a Content-Length framed response, SIZE_MAX
+ * for chunked or close-delimited bodies */
+static size_t http_proxy_body_remaining(const http_proxy_session_t *session) {
+  if (session->transfer_encoding_seen || session->content_length < 0)
+    return SIZE_MAX;
+  if (session->bytes_received >= session->content_length)
     return 0;
-  if (!session || !data || len > REWRITE_MAX_BODY_SIZE - session->rewrite_body_buffer_used) {
-    logger(LOG_ERROR, "HTTP Proxy: Rewrite body exceeds max size");
-    return -1;
-  }
-
-  new_size = session->rewrite_body_buffer_used + len;
-  if (new_size > session->rewrite_body_buffer_size) {
-    size_t new_alloc = session->rewrite_body_buffer_size == 0 ? 16384 : session->rewrite_body_buffer_size * 2;
-    while (new_alloc < new_size)
-      new_alloc *= 2;
-    if (new_alloc > REWRITE_MAX_BODY_SIZE)
-      new_alloc = REWRITE_MAX_BODY_SIZE;
-
-    char *new_buf = realloc(session->rewrite_body_buffer, new_alloc);
-    if (!new_buf) {
-      logger(LOG_ERROR, "HTTP Proxy: Failed to grow rewrite buffer");
-      return -1;
-    }
-    session->rewrite_body_buffer = new_buf;
-    session->rewrite_body_buffer_size = new_alloc;
-  }
-
-  memcpy(session->rewrite_body_buffer + session->rewrite_body_buffer_used, data, len);
-  session->rewrite_body_buffer_used = new_size;
-  return 0;
+  return (size_t)(session->content_length - session->bytes_received);
 }
 
-static int http_proxy_emit_decoded_body(void *opaque, const uint8_t *data, size_t len) {
-  return http_proxy_append_rewrite_body((http_proxy_session_t *)opaque, data, len);
+static int http_proxy_skip_chunk_data(void *opaque, const uint8_t *data, size_t len) {
+  (void)opaque;
+  (void)data;
+  (void)len;
+  return 0;
 }
 
 /**
- * Finalize M3U body rewriting: rewrite the buffered body and send the
- * response (headers + rewritten body) to the client.
- * Called when all body data has been collected or the upstream closed.
- * @return bytes queued on success, -1 on error
+ * Follow the framing of body bytes that are passed through unchanged
+ * @return How many of the len bytes belong to the response; the session
+ * moves to COMPLETE when they end it
  */
-static int http_proxy_finalize_rewrite(http_proxy_session_t *session) {
-  int bytes_forwarded = 0;
-  char *rewritten = NULL;
-  size_t rewritten_size = 0;
-
-  if (session->rewrite_body_buffer_used > 0) {
-    /* Null-terminate for rewriting */
-    if (session->rewrite_body_buffer_used >= session->rewrite_body_buffer_size) {
-      char *new_buf = realloc(session->rewrite_body_buffer, session->rewrite_body_buffer_used + 1);
-      if (!new_buf) {
-        logger(LOG_ERROR, "HTTP Proxy: Failed to grow rewrite buffer for null");
-        return -1;
-      }
-      session->rewrite_body_buffer = new_buf;
-      session->rewrite_body_buffer_size = session->rewrite_body_buffer_used + 1;
+static size_t http_proxy_track_body(http_proxy_session_t *session, const uint8_t *data, size_t len) {
+  if (session->response_is_chunked) {
+    size_t consumed = 0;
+    if (session->chunked_decoder.state == HTTP_CHUNKED_STATE_ERROR)
+      return len;
+    http_chunked_decode_result_t result = http_chunked_decoder_feed(&session->chunked_decoder, data, len,
+                                                                    http_proxy_skip_chunk_data, NULL, &consumed);
+    if (result == HTTP_CHUNKED_DECODE_ERROR) {
+      /* Not chunk-framed after all (e.g. chunked was not the final coding):
+       * relay until the upstream closes */
+      logger(LOG_DEBUG, "HTTP Proxy: Lost chunk framing, relaying until upstream closes");
+      session->keep_alive = 0;
+      return len;
     }
-    session->rewrite_body_buffer[session->rewrite_body_buffer_used] = '\0';
-
-    /* Build base URL and rewrite context */
-    char *base_url = build_proxy_base_url(session->host_header, session->x_forwarded_host, session->x_forwarded_proto);
-    if (!base_url) {
-      logger(LOG_ERROR, "HTTP Proxy: Failed to build base URL for rewriting");
-      return -1;
+    if (result == HTTP_CHUNKED_DECODE_DONE) {
+      if (consumed < len)
+        session->keep_alive = 0;
+      logger(LOG_DEBUG, "HTTP Proxy: Received last chunk");
+      session->response_complete = 1;
+      http_proxy_set_state(session, HTTP_PROXY_STATE_COMPLETE);
+      return consumed;
     }
+    return len;
+  }
 
-    rewrite_context_t ctx = {.upstream_host = session->target_host,
-                             .upstream_port = session->target_port,
-                             .upstream_path = session->target_path,
-                             .base_url = base_url};
-
-    int rewrite_result = rewrite_m3u_content(&ctx, session->rewrite_body_buffer, &rewritten, &rewritten_size);
-    free(base_url);
-
-    if (rewrite_result < 0) {
-      logger(LOG_ERROR, "HTTP Proxy: M3U rewrite failed");
-      return -1;
-    }
+  size_t remaining = http_proxy_body_remaining(session);
+  if (len < remaining) {
+    session->bytes_received += len;
+    return len;
   }
+  if (len > remaining)
+    session->keep_alive = 0;
+  session->bytes_received += remaining;
+  logger(LOG_DEBUG, "HTTP Proxy: Received all content (%zd bytes)", session->bytes_received);
+  session->response_complete = 1;
+  http_proxy_set_state(session, HTTP_PROXY_STATE_COMPLETE);
+  return remaining;
+}
+
+/* Room a rewritten chunk keeps in its pool buffer for the size line in
+ * front ("5f7\r\n") and the CRLF plus last chunk behind */
+#define HTTP_PROXY_CHUNK_HEAD_SIZE 8
+#define HTTP_PROXY_CHUNK_TAIL_SIZE 7
+#define HTTP_PROXY_CHUNK_DATA_SIZE (BUFFER_POOL_BUFFER_SIZE - HTTP_PROXY_CHUNK_HEAD_SIZE - HTTP_PROXY_CHUNK_TAIL_SIZE)
 
-  /* Build and send response headers with new Content-Length
-   * Passthrough original headers except Content-Length, Transfer-Encoding, and Trailer */
+/**
+ * Send the saved response headers ahead of the rewritten body
+ * Passthrough original headers except the framing and connection headers
+ * @param content_length Body length when the whole body is known, else -1
+ * (chunked for HTTP/1.1 clients, delimited by closing otherwise)
+ * @return bytes queued on success, -1 on error
+ */
+static int http_proxy_send_rewrite_headers(http_proxy_session_t *session, ssize_t content_length) {
   char headers[HTTP_PROXY_RESPONSE_BUFFER_SIZE];
   char *hdr_ptr = headers;
   size_t hdr_remaining = sizeof(headers);
   int headers_len = 0;
+  int written;
 
   if (session->saved_response_headers) {
-    /* Rebuild headers in place; the saved copy is not needed after finalization. */
+    /* Rebuild headers in place; the saved copy is not needed afterwards. */
     char *line = strtok(session->saved_response_headers, "\r\n");
     while (line != NULL) {
       /* Skip headers that need to be modified */
       if (strncasecmp(line, "Content-Length:", 15) == 0 || strncasecmp(line, "Transfer-Encoding:", 18) == 0 ||
-          strncasecmp(line, "Trailer:", 8) == 0) {
-        /* Skip - will add correct Content-Length later */
+          strncasecmp(line, "Trailer:", 8) == 0 || strncasecmp(line, "Connection:", 11) == 0 ||
+          strncasecmp(line, "Keep-Alive:", 11) == 0) {
+        /* Skip - framing is added below */
       } else {
         /* Pass through this header */
-        int written = snprintf(hdr_ptr, hdr_remaining, "%s\r\n", line);
+        written = snprintf(hdr_ptr, hdr_remaining, "%s\r\n", line);
         if (written > 0 && (size_t)written < hdr_remaining) {
           hdr_ptr += written;
           hdr_remaining -= written;
@@ -787,26 +869,29 @@ static int http_proxy_finalize_rewrite(http_proxy_session_t *session) {
       }
       line = strtok(NULL, "\r\n");
     }
-
-    /* Add correct Content-Length */
-    int cl_written = snprintf(hdr_ptr, hdr_remaining, "Content-Length: %zu\r\n", rewritten_size);
-    if (cl_written > 0 && (size_t)cl_written < hdr_remaining) {
-      hdr_ptr += cl_written;
-      hdr_remaining -= cl_written;
-      headers_len += cl_written;
-    }
   } else {
     /* Fallback: build minimal headers */
     headers_len = snprintf(headers, sizeof(headers),
                            "HTTP/1.1 %d OK\r\n"
-                           "Content-Type: %s\r\n"
-                           "Content-Length: %zu\r\n"
-                           "Connection: close\r\n",
-                           session->response_status_code, session->response_content_type, rewritten_size);
+                           "Content-Type: %s\r\n",
+                           session->response_status_code, session->response_content_type);
     hdr_ptr = headers + headers_len;
     hdr_remaining = sizeof(headers) - headers_len;
   }
 
+  /* Body framing; the client connection is closed after the response */
+  if (content_length >= 0)
+    written = snprintf(hdr_ptr, hdr_remaining, "Content-Length: %zd\r\nConnection: close\r\n", content_length);
+  else if (session->rewrite_chunked)
+    written = snprintf(hdr_ptr, hdr_remaining, "Transfer-Encoding: chunked\r\nConnection: close\r\n");
+  else
+    written = snprintf(hdr_ptr, hdr_remaining, "Connection: close\r\n");
+  if (written > 0 && (size_t)written < hdr_remaining) {
+    hdr_ptr += written;
+    hdr_remaining -= written;
+    headers_len += written;
+  }
+
   /* Inject Set-Cookie header if needed */
   if (session->conn && session->conn->should_set_r2h_cookie && config.r2h_token && config.r2h_token[0] != '\0') {
     int cookie_written = http_build_r2h_token_cookie_header(hdr_ptr, hdr_remaining, http_proxy_get_cookie_path());
@@ -821,33 +906,140 @@ static int http_proxy_finalize_rewrite(http_proxy_session_t *session) {
   }
 
   /* Add final CRLF to end headers */
-  int final_written = snprintf(hdr_ptr, hdr_remaining, "\r\n");
-  if (final_written > 0) {
-    headers_len += final_written;
+  written = snprintf(hdr_ptr, hdr_remaining, "\r\n");
+  if (written > 0) {
+    headers_len += written;
   }
 
   if (connection_queue_output(session->conn, (const uint8_t *)headers, headers_len) < 0) {
-    free(rewritten);
     logger(LOG_ERROR, "HTTP Proxy: Failed to send rewritten headers");
     return -1;
   }
 
-  /* Send rewritten body */
-  if (connection_queue_output(session->conn, (const uint8_t *)rewritten, rewritten_size) < 0) {
-    free(rewritten);
+  session->headers_forwarded = 1;
+  if (session->conn) {
+    session->conn->headers_sent = 1;
+  }
+  return headers_len;
+}
+
+/**
+ * Send the rewritten bytes collected in rewrite_out, as one chunk for
+ * chunked responses; the response headers go first if not sent yet
+ * @param last Also end a chunked body
+ * @return bytes queued on success, -1 on error
+ */
+static int http_proxy_flush_rewrite(http_proxy_session_t *session, int last) {
+  buffer_ref_t *buf = session->rewrite_out;
+  int queued = 0;
+
+  if (!session->headers_forwarded) {
+    queued = http_proxy_send_rewrite_headers(session, -1);
+    if (queued < 0)
+      return -1;
+  }
+
+  if (!buf) {
+    if (last && session->rewrite_chunked) {
+      if (connection_queue_output(session->conn, (const uint8_t *)"0\r\n\r\n", 5) < 0) {
+        logger(LOG_ERROR, "HTTP Proxy: Failed to send last chunk");
+        return -1;
+      }
+      queued += 5;
+    }
+    return queued;
+  }
+  session->rewrite_out = NULL;
+
+  /* The bytes were collected after HTTP_PROXY_CHUNK_HEAD_SIZE; the size line
+   * goes right before them, the chunk's CRLF (and last chunk) after them */
+  uint8_t *body = (uint8_t *)buf->data + HTTP_PROXY_CHUNK_HEAD_SIZE;
+  size_t body_len = buf->data_size;
+  buf->data_offset = HTTP_PROXY_CHUNK_HEAD_SIZE;
+  if (session->rewrite_chunked) {
+    char size_line[HTTP_PROXY_CHUNK_HEAD_SIZE + 1];
+    int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", body_len);
+    const char *tail = last ? "\r\n0\r\n\r\n" : "\r\n";
+    size_t tail_len = strlen(tail);
+    memcpy(body - size_len, size_line, (size_t)size_len);
+    memcpy(body + body_len, tail, tail_len);
+    buf->data_offset -= (size_t)size_len;
+    buf->data_size += (size_t)size_len + tail_len;
+  }
+
+  if (connection_queue_zerocopy(session->conn, buf) < 0) {
+    buffer_ref_put(buf);
     logger(LOG_ERROR, "HTTP Proxy: Failed to send rewritten body");
     return -1;
   }
+  queued += (int)buf->data_size;
+  buffer_ref_put(buf);
+  return queued;
+}
 
-  session->headers_forwarded = 1;
-  if (session->conn) {
-    session->conn->headers_sent = 1;
+/* Output of the M3U rewriter: collect into pool buffers, one chunk each */
+static int http_proxy_emit_rewritten(void *opaque, const char *data, size_t len) {
+  http_proxy_session_t *session = (http_proxy_session_t *)opaque;
+
+  while (len > 0) {
+    if (!session->rewrite_out) {
+      session->rewrite_out = buffer_pool_alloc();
+      if (!session->rewrite_out) {
+        logger(LOG_ERROR, "HTTP Proxy: Buffer pool exhausted");
+        return -1;
+      }
+      session->rewrite_out->data_size = 0;
+    }
+
+    buffer_ref_t *buf = session->rewrite_out;
+    size_t copy = HTTP_PROXY_CHUNK_DATA_SIZE - buf->data_size;
+    if (copy > len)
+      copy = len;
+    memcpy((uint8_t *)buf->data + HTTP_PROXY_CHUNK_HEAD_SIZE + buf->data_size, data, copy);
+    buf->data_size += copy;
+    data += copy;
+    len -= copy;
+
+    if (buf->data_size == HTTP_PROXY_CHUNK_DATA_SIZE && http_proxy_flush_rewrite(session, 0) < 0)
+      return -1;
   }
+  return 0;
+}
 
-  bytes_forwarded = (int)(headers_len + rewritten_size);
-  free(rewritten);
+static int http_proxy_emit_decoded_body(void *opaque, const uint8_t *data, size_t len) {
+  http_proxy_session_t *session = (http_proxy_session_t *)opaque;
+  return rewrite_m3u_stream_feed(&session->rewrite_stream, (const char *)data, len, http_proxy_emit_rewritten,
+                                 session);
+}
 
-  logger(LOG_DEBUG, "HTTP Proxy: Sent rewritten M3U (%zu bytes body)", rewritten_size);
+/**
+ * Finalize M3U body rewriting: rewrite the last line and end the response.
+ * A body that never filled a chunk is sent with a Content-Length instead.
+ * Called when all body data has been received or the upstream closed.
+ * @return bytes queued on success, -1 on error
+ */
+static int http_proxy_finalize_rewrite(http_proxy_session_t *session) {
+  int bytes_forwarded = 0;
+
+  if (rewrite_m3u_stream_finish(&session->rewrite_stream, http_proxy_emit_rewritten, session) < 0) {
+    logger(LOG_ERROR, "HTTP Proxy: M3U rewrite failed");
+    return -1;
+  }
+
+  if (!session->headers_forwarded) {
+    size_t body_len = session->rewrite_out ? session->rewrite_out->data_size : 0;
+    bytes_forwarded = http_proxy_send_rewrite_headers(session, (ssize_t)body_len);
+    if (bytes_forwarded < 0)
+      return -1;
+    session->rewrite_chunked = 0;
+  }
+
+  int flushed = http_proxy_flush_rewrite(session, 1);
+  if (flushed < 0)
+    return -1;
+  bytes_forwarded += flushed;
+
+  logger(LOG_DEBUG, "HTTP Proxy: Sent rewritten M3U (%s)", session->rewrite_chunked ? "chunked" : "complete");
 
   http_proxy_set_state(session, HTTP_PROXY_STATE_COMPLETE);
   return bytes_forwarded;
@@ -862,15 +1054,33 @@ static int http_proxy_consume_rewrite_body(http_proxy_session_t *session, const
       logger(LOG_ERROR, "HTTP Proxy: Invalid chunked M3U response body");
       return -1;
     }
-    if (result == HTTP_CHUNKED_DECODE_DONE)
+    if (result == HTTP_CHUNKED_DECODE_DONE) {
+      session->response_complete = 1;
+      return http_proxy_finalize_rewrite(session);
+    }
+  } else {
+    if (session->content_length >= 0 && session->bytes_received > session->content_length) {
+      /* Bytes past the body do not belong to this response */
+      len -= (size_t)(session->bytes_received - session->content_length);
+      session->bytes_received = session->content_length;
+      session->keep_alive = 0;
+    }
+    if (http_proxy_emit_decoded_body(session, data, len) < 0)
+      return -1;
+    if (session->content_length >= 0 && session->bytes_received >= session->content_length) {
+      session->response_complete = 1;
       return http_proxy_finalize_rewrite(session);
-    return (int)len;
+    }
   }
 
-  if (http_proxy_append_rewrite_body(session, data, len) < 0)
-    return -1;
-  if (session->content_length >= 0 && session->bytes_received >= session->content_length)
-    return http_proxy_finalize_rewrite(session);
+  /* Pass on what this read completed instead of waiting for the rest; the
+   * send queue's batching would hold back a short chunk */
+  if (session->rewrite_out) {
+    if (http_proxy_flush_rewrite(session, 0) < 0)
+      return -1;
+    connection_epoll_update_events(session->conn->epfd, session->conn->fd,
+                                   POLLER_IN | POLLER_OUT | POLLER_RDHUP | POLLER_HUP | POLLER_ERR);
+  }
   return (int)len;
 }
 
@@ -896,15 +1106,22 @@ static int http_proxy_try_receive_response(http_proxy_session_t *session) {
    * Two-phase receive strategy for zero-copy optimization:
    * Phase 1 (AWAITING_HEADERS): Use fixed buffer for header parsing
    * Phase 2 (STREAMING): Recv directly to buffer pool for zero-copy send
-   *                      OR buffer for rewriting if needs_body_rewrite
+   *                      OR rewrite line by line if needs_body_rewrite
    */
 
   if (session->state == HTTP_PROXY_STATE_STREAMING) {
     /* Check if we need to buffer for rewriting */
     if (session->needs_body_rewrite) {
-      /* Buffer mode: collect body for rewriting */
+      /* Rewrite mode: the rewritten lines are queued as they complete, so
+       * the client's backpressure applies here too */
+      if (connection_should_pause_upstream(session->conn)) {
+        http_proxy_pause_upstream(session);
+        return 0;
+      }
+
       uint8_t temp_buf[8192];
-      received = recv(session->socket, temp_buf, sizeof(temp_buf), 0);
+      size_t want = http_proxy_body_remaining(session);
+      received = recv(session->socket, temp_buf, want < sizeof(temp_buf) ? want : sizeof(temp_buf), 0);
 
       if (received < 0) {
         if (errno == EAGAIN)
@@ -914,7 +1131,7 @@ static int http_proxy_try_receive_response(http_proxy_session_t *session) {
       }
 
       if (received == 0) {
-        logger(LOG_DEBUG, "HTTP Proxy: Upstream closed, processing rewrite buffer");
+        logger(LOG_DEBUG, "HTTP Proxy: Upstream closed, ending rewritten body");
         return http_proxy_handle_upstream_end(session);
       }
 
@@ -938,7 +1155,10 @@ static int http_proxy_try_receive_response(http_proxy_session_t *session) {
       return -1;
     }
 
-    received = recv(session->socket, buf->data, BUFFER_POOL_BUFFER_SIZE, 0);
+    /* Never read past a Content-Length body: what follows on a kept-alive
+     * connection is not part of this response */
+    size_t want = http_proxy_body_remaining(session);
+    received = recv(session->socket, buf->data, want < BUFFER_POOL_BUFFER_SIZE ? want : BUFFER_POOL_BUFFER_SIZE, 0);
 
     if (received < 0) {
       buffer_ref_put(buf);
@@ -955,27 +1175,20 @@ static int http_proxy_try_receive_response(http_proxy_session_t *session) {
       return http_proxy_handle_upstream_end(session);
     }
 
-    /* Queue for zero-copy send */
-    buf->data_size = received;
-    if (connection_queue_zerocopy(session->conn, buf) < 0) {
+    /* Queue for zero-copy send.  Let connection_queue_zerocopy's internal
+     * batching mechanism handle POLLER_OUT - it uses zerocopy_should_flush()
+     * for optimal batching */
+    buf->data_size = http_proxy_track_body(session, buf->data, (size_t)received);
+    if (buf->data_size > 0 && connection_queue_zerocopy(session->conn, buf) < 0) {
       buffer_ref_put(buf);
       logger(LOG_ERROR, "HTTP Proxy: Failed to queue body data");
       return -1;
     }
+    if (session->cache_flight)
+      http_proxy_cache_append(session, buf->data, buf->data_size);
     buffer_ref_put(buf);
-    bytes_forwarded = (int)received;
-
-    /* Let connection_queue_zerocopy's internal batching mechanism handle
-     * POLLER_OUT - it uses zerocopy_should_flush() for optimal batching */
-    session->bytes_received += bytes_forwarded;
-
-    /* Check if we've received all content */
-    if (session->content_length >= 0 && session->bytes_received >= session->content_length) {
-      logger(LOG_DEBUG, "HTTP Proxy: Received all content (%zd bytes)", session->bytes_received);
-      http_proxy_set_state(session, HTTP_PROXY_STATE_COMPLETE);
-    }
 
-    return bytes_forwarded;
+    return (int)received;
   }
 
   /* Phase 1: Header parsing - use fixed buffer */
@@ -992,11 +1205,13 @@ static int http_proxy_try_receive_response(http_proxy_session_t *session) {
     if (errno == EAGAIN) {
       return 0;
     }
-    logger(LOG_ERROR, "HTTP Proxy: Recv failed: %s", strerror(errno));
+    logger(http_proxy_can_retry(session) ? LOG_DEBUG : LOG_ERROR, "HTTP Proxy: Recv failed: %s", strerror(errno));
     return -1;
   }
 
   if (received == 0) {
+    if (http_proxy_can_retry(session))
+      return -1; /* Idle connection closed by upstream, see http_proxy_retry_on_new_connection */
     logger(LOG_DEBUG, "HTTP Proxy: Upstream closed connection");
     http_proxy_set_state(session, HTTP_PROXY_STATE_COMPLETE);
     return 0;
@@ -1020,7 +1235,7 @@ static int http_proxy_try_receive_response(http_proxy_session_t *session) {
   /* Forward any body data that came with headers (in response_buffer) */
   if (session->headers_received && session->response_buffer_pos > 0) {
     if (session->needs_body_rewrite) {
-      /* Buffer or decode initial body data for rewriting */
+      /* Decode and rewrite initial body data */
       size_t initial_size = session->response_buffer_pos;
       session->bytes_received += initial_size;
       session->response_buffer_pos = 0;
@@ -1029,26 +1244,41 @@ static int http_proxy_try_receive_response(http_proxy_session_t *session) {
         return -1;
     } else {
       /* Normal mode: forward immediately */
-      if (connection_queue_output(session->conn, session->response_buffer, session->response_buffer_pos) < 0) {
+      size_t body_len = http_proxy_track_body(session, session->response_buffer, session->response_buffer_pos);
+      if (body_len > 0 && connection_queue_output(session->conn, session->response_buffer, body_len) < 0) {
         logger(LOG_ERROR, "HTTP Proxy: Failed to queue initial body data");
         return -1;
       }
+      if (session->cache_flight)
+        http_proxy_cache_append(session, session->response_buffer, body_len);
 
       bytes_forwarded = (int)session->response_buffer_pos;
       session->response_buffer_pos = 0;
-      session->bytes_received += bytes_forwarded;
-
-      /* Check if we've received all content */
-      if (session->content_length >= 0 && session->bytes_received >= session->content_length) {
-        logger(LOG_DEBUG, "HTTP Proxy: Received all content (%zd bytes)", session->bytes_received);
-        http_proxy_set_state(session, HTTP_PROXY_STATE_COMPLETE);
-      }
     }
   }
 
   return bytes_forwarded > 0 ? bytes_forwarded : socket_progress;
 }
 
+/* Whether a comma-separated header value lists token (case-insensitive) */
+static int http_proxy_header_has_token(const char *value, const char *token) {
+  size_t token_len = strlen(token);
+
+  while (*value) {
+    while (*value == ' ' || *value == '\t' || *value == ',')
+      value++;
+    const char *start = value;
+    while (*value && *value != ',')
+      value++;
+    const char *end = value;
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t'))
+      end--;
+    if ((size_t)(end - start) == token_len && strncasecmp(start, token, token_len) == 0)
+      return 1;
+  }
+  return 0;
+}
+
 /* Check if status code is a redirect that may have Location header */
 static int http_proxy_is_redirect_status(int status_code) {
   return (status_code == 301 || status_code == 302 || status_code == 303 || status_code == 307 || status_code == 308);
@@ -1101,6 +1331,11 @@ static int http_proxy_parse_response_headers(http_proxy_session_t *session) {
 
   logger(LOG_DEBUG, "HTTP Proxy: Response status: %d", session->response_status_code);
 
+  /* HTTP/1.1 connections persist unless the upstream says otherwise; a
+   * protocol switch or interim response leaves the framing to the upstream */
+  session->keep_alive = strncmp(line, "HTTP/1.0", 8) != 0 && session->response_status_code >= 200;
+  int connection_close = 0;
+
   /* Parse headers */
   while ((line = strtok(NULL, "\r\n")) != NULL) {
     if (strncasecmp(line, "Content-Length:", 15) == 0) {
@@ -1119,6 +1354,20 @@ static int http_proxy_parse_response_headers(http_proxy_session_t *session) {
         value++;
       http_proxy_parse_transfer_encoding(session, value);
       logger(LOG_DEBUG, "HTTP Proxy: Transfer-Encoding: %s", value);
+    } else if (strncasecmp(line, "Connection:", 11) == 0) {
+      if (http_proxy_header_has_token(line + 11, "close"))
+        connection_close = 1;
+      else if (http_proxy_header_has_token(line + 11, "keep-alive") && session->response_status_code >= 200)
+        session->keep_alive = 1;
+    } else if (strncasecmp(line, "Keep-Alive:", 11) == 0) {
+      const char *timeout = line + 11;
+      while ((timeout = strchr(timeout, '=')) != NULL) {
+        if (timeout - line >= 18 && strncasecmp(timeout - 7, "timeout", 7) == 0) {
+          session->keep_alive_sec = atoi(timeout + 1);
+          break;
+        }
+        timeout++;
+      }
     } else if (strncasecmp(line, "Location:", 9) == 0) {
       /* Extract Location header value for potential rewriting */
       char *value = line + 9;
@@ -1128,56 +1377,74 @@ static int http_proxy_parse_response_headers(http_proxy_session_t *session) {
       location_header[sizeof(location_header) - 1] = '\0';
       has_location = 1;
       logger(LOG_DEBUG, "HTTP Proxy: Location: %s", location_header);
+    } else {
+      http_proxy_cache_parse_header(session, line);
     }
   }
 
   session->headers_received = 1;
+  if (connection_close)
+    session->keep_alive = 0;
+  if (session->response_is_chunked)
+    http_chunked_decoder_init(&session->chunked_decoder);
+
+  /* Responses that never carry a body, whatever their headers say */
+  int no_body = strcasecmp(session->method, "HEAD") == 0 || session->response_status_code == 204 ||
+                session->response_status_code == 304;
 
   /* Check if a successful response body needs rewriting (M3U content). URL
    * extension takes precedence; fall back to Content-Type only when the URL
    * is not M3U-like. Non-2xx responses must retain normal HTTP semantics,
    * especially redirect Location rewriting and error response passthrough.
-   * Skip for HEAD requests — there is no body to rewrite. */
+   * Skip responses without a body (HEAD, 204, 304). */
   int is_m3u_response = rewrite_is_m3u_url(session->target_path);
   if (!is_m3u_response)
     is_m3u_response = rewrite_is_m3u_content_type(session->response_content_type);
 
-  if (session->response_status_code >= 200 && session->response_status_code < 300 && is_m3u_response &&
-      strcasecmp(session->method, "HEAD") != 0) {
+  if (session->response_status_code >= 200 && session->response_status_code < 300 && is_m3u_response && !no_body) {
     if (session->transfer_encoding_seen && (!session->response_is_chunked || session->unsupported_transfer_coding)) {
       logger(LOG_ERROR, "HTTP Proxy: Unsupported Transfer-Encoding for M3U rewrite");
       return -1;
     }
 
-    /* Transfer-Encoding takes precedence over Content-Length. */
+    /* Transfer-Encoding takes precedence over Content-Length.  An empty
+     * body has nothing to rewrite. */
     if (session->response_is_chunked) {
       session->needs_body_rewrite = 1;
-      http_chunked_decoder_init(&session->chunked_decoder);
       logger(LOG_DEBUG, "HTTP Proxy: Chunked M3U content detected, will decode and rewrite body");
-    } else if (session->content_length > 0 && (size_t)session->content_length <= REWRITE_MAX_BODY_SIZE) {
+    } else if (session->content_length != 0) {
       session->needs_body_rewrite = 1;
       logger(LOG_DEBUG, "HTTP Proxy: M3U content detected, will rewrite body");
-    } else if (session->content_length == -1) {
-      /* Chunked or unknown length - try to buffer if reasonable */
-      session->needs_body_rewrite = 1;
-      logger(LOG_DEBUG, "HTTP Proxy: M3U content with unknown length, will buffer");
-    } else {
-      logger(LOG_WARN, "HTTP Proxy: M3U content too large for rewriting (%zd bytes)", session->content_length);
     }
 
-    /* Save original response headers for passthrough during rewrite */
     if (session->needs_body_rewrite) {
+      /* Save original response headers for passthrough during rewrite */
       session->saved_response_headers = malloc(header_len + 1);
       if (session->saved_response_headers) {
         memcpy(session->saved_response_headers, session->response_buffer, header_len);
         session->saved_response_headers[header_len] = '\0';
         logger(LOG_DEBUG, "HTTP Proxy: Saved %zu bytes of response headers for rewrite", header_len);
       }
+
+      session->rewrite_base_url =
+          build_proxy_base_url(session->host_header, session->x_forwarded_host, session->x_forwarded_proto);
+      if (!session->rewrite_base_url) {
+        logger(LOG_ERROR, "HTTP Proxy: Failed to build base URL for rewriting");
+        return -1;
+      }
+      rewrite_context_t ctx = {.upstream_host = session->target_host,
+                               .upstream_port = session->target_port,
+                               .upstream_path = session->target_path,
+                               .base_url = session->rewrite_base_url};
+      rewrite_m3u_stream_init(&session->rewrite_stream, &ctx);
+
+      /* HTTP/1.0 clients get a body delimited by closing the connection */
+      session->rewrite_chunked = session->client_request && session->client_request->http_1_1;
     }
   }
 
   /* Forward response headers to client - flush immediately */
-  /* Skip header forwarding if body needs rewriting (Content-Length may change) */
+  /* Skip header forwarding if body needs rewriting (its framing changes) */
   if (!session->headers_forwarded && session->conn && !session->needs_body_rewrite) {
     /*
      * For redirect responses (30x), we need to rewrite the Location header
@@ -1315,9 +1582,13 @@ static int http_proxy_parse_response_headers(http_proxy_session_t *session) {
                                    POLLER_IN | POLLER_OUT | POLLER_RDHUP | POLLER_HUP | POLLER_ERR);
   }
 
-  /* HEAD responses have no body — go straight to COMPLETE */
-  if (strcasecmp(session->method, "HEAD") == 0) {
+  /* Bodyless responses (HEAD, 204, 304, Content-Length: 0) go straight to
+   * COMPLETE; the upstream does not close a kept-alive connection after them */
+  if (no_body || http_proxy_body_remaining(session) == 0) {
+    if (session->response_buffer_pos > header_len)
+      session->keep_alive = 0;
     session->response_buffer_pos = 0;
+    session->response_complete = 1;
     http_proxy_set_state(session, HTTP_PROXY_STATE_COMPLETE);
   } else {
     /* Move body data to beginning of buffer */
@@ -1330,6 +1601,9 @@ static int http_proxy_parse_response_headers(http_proxy_session_t *session) {
     http_proxy_set_state(session, HTTP_PROXY_STATE_STREAMING);
   }
 
+  /* Share a segment download with clients waiting for the same URL */
+  http_proxy_cache_begin(session);
+
   return 1; /* Headers complete */
 }
 
@@ -1342,7 +1616,7 @@ int http_proxy_handle_socket_event(http_proxy_session_t *session, uint32_t event
 
   /* Handle in-progress connect FIRST - before generic error/HUP handling.
    * A failed candidate (POLLER_ERR/HUP or SO_ERROR) falls back to the next
-   * address from the getaddrinfo list instead of erroring out. */
+   * address from the resolver list instead of erroring out. */
   if (session->state == HTTP_PROXY_STATE_CONNECTING) {
     int sock_error = 0;
     socklen_t error_len = sizeof(sock_error);
@@ -1378,6 +1652,8 @@ int http_proxy_handle_socket_event(http_proxy_session_t *session, uint32_t event
   if ((events & POLLER_OUT) && session->state == HTTP_PROXY_STATE_SENDING_REQUEST) {
     result = http_proxy_try_send_pending(session);
     if (result < 0) {
+      if (http_proxy_retry_on_new_connection(session) == 0)
+        return 0;
       logger(LOG_ERROR, "HTTP Proxy: Failed to send request");
       http_proxy_set_state(session, HTTP_PROXY_STATE_ERROR);
       return -1;
@@ -1411,6 +1687,8 @@ int http_proxy_handle_socket_event(http_proxy_session_t *session, uint32_t event
     while (session->state == HTTP_PROXY_STATE_AWAITING_HEADERS || session->state == HTTP_PROXY_STATE_STREAMING) {
       result = http_proxy_try_receive_response(session);
       if (result < 0) {
+        if (http_proxy_retry_on_new_connection(session) == 0)
+          return progress;
         logger(LOG_ERROR, "HTTP Proxy: Failed to receive response");
         http_proxy_set_state(session, HTTP_PROXY_STATE_ERROR);
         return -1;
@@ -1438,6 +1716,8 @@ int http_proxy_handle_socket_event(http_proxy_session_t *session, uint32_t event
     }
 
     if (has_socket_error) {
+      if (http_proxy_retry_on_new_connection(session) == 0)
+        return progress;
       if (session->state == HTTP_PROXY_STATE_STREAMING) {
         result = http_proxy_handle_upstream_end(session);
         if (result < 0) {
@@ -1459,6 +1739,12 @@ int http_proxy_handle_socket_event(http_proxy_session_t *session, uint32_t event
    * before buffered data (e.g. rewrite body) is processed. */
   if ((events & (POLLER_HUP | POLLER_RDHUP)) && !(events & POLLER_IN)) {
     /* Upstream closed connection */
+    if (http_proxy_can_retry(session)) {
+      if (http_proxy_retry_on_new_connection(session) == 0)
+        return progress;
+      http_proxy_set_state(session, HTTP_PROXY_STATE_ERROR);
+      return -1;
+    }
     if (session->state == HTTP_PROXY_STATE_STREAMING || session->state == HTTP_PROXY_STATE_AWAITING_HEADERS) {
       logger(LOG_DEBUG, "HTTP Proxy: Upstream closed connection (normal)");
       if (session->state == HTTP_PROXY_STATE_STREAMING) {
@@ -1482,13 +1768,14 @@ int http_proxy_handle_socket_event(http_proxy_session_t *session, uint32_t event
     }
   }
 
-  /* When transfer is complete, clean up proxy socket and begin draining
-   * the client connection's output queue. */
+  /* When transfer is complete, release the proxy socket and begin draining
+   * the client connection's output queue.  An upstream that is already
+   * hanging up is not kept. */
   if (session->state == HTTP_PROXY_STATE_COMPLETE) {
-    if (session->socket >= 0) {
-      worker_cleanup_socket_from_epoll(session->epoll_fd, session->socket);
-      session->socket = -1;
-    }
+    if (events & (POLLER_HUP | POLLER_RDHUP | POLLER_ERR))
+      session->keep_alive = 0;
+    http_proxy_cache_finish(session);
+    http_proxy_release_upstream(session);
     if (session->conn && session->conn->state != CONN_CLOSING) {
       logger(LOG_DEBUG, "HTTP Proxy: Transfer complete");
       session->conn->state = CONN_CLOSING;
@@ -1520,12 +1807,15 @@ int http_proxy_session_cleanup(http_proxy_session_t *session) {
   /* Free pending connect candidates if any */
   http_proxy_free_connect_results(session);
 
-  /* Free rewrite body buffer if allocated */
-  if (session->rewrite_body_buffer) {
-    free(session->rewrite_body_buffer);
-    session->rewrite_body_buffer = NULL;
-    session->rewrite_body_buffer_size = 0;
-    session->rewrite_body_buffer_used = 0;
+  /* Free rewrite state if allocated */
+  rewrite_m3u_stream_free(&session->rewrite_stream);
+  if (session->rewrite_out) {
+    buffer_ref_put(session->rewrite_out);
+    session->rewrite_out = NULL;
+  }
+  if (session->rewrite_base_url) {
+    free(session->rewrite_base_url);
+    session->rewrite_base_url = NULL;
   }
 
   /* Free saved response headers if allocated */
@@ -1544,6 +1834,12 @@ int http_proxy_session_cleanup(http_proxy_session_t *session) {
 int http_proxy_session_tick(http_proxy_session_t *session, int64_t now) {
   if (!session || !session->initialized || session->last_state_change_ms <= 0)
     return 0;
+  if (session->connect_failed) {
+    /* Asynchronous lookup or connect failed */
+    session->connect_failed = 0;
+    http_proxy_set_state(session, HTTP_PROXY_STATE_ERROR);
+    return -1;
+  }
   switch (session->state) {
   case HTTP_PROXY_STATE_CONNECTING:
   case HTTP_PROXY_STATE_SENDING_REQUEST:
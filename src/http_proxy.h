@@ -2,12 +2,17 @@
 #define __HTTP_PROXY_H__
 
 #include "http_chunked_decoder.h"
+#include "http_proxy_rewrite.h"
 #include <stdint.h>
 #include <sys/types.h>
 
 /* Forward declarations */
 struct connection_s;
+struct http_request_s;
 struct addrinfo;
+struct resolver_query_s;
+struct http_proxy_cache_flight_s;
+struct buffer_ref_s;
 
 /* ========== HTTP PROXY BUFFER SIZE CONFIGURATION ========== */
 
@@ -39,14 +44,14 @@ typedef enum {
   HTTP_PROXY_STATE_SENDING_REQUEST,  /* Sending HTTP request */
   HTTP_PROXY_STATE_AWAITING_HEADERS, /* Waiting for response headers */
   HTTP_PROXY_STATE_STREAMING,        /* Streaming response body */
-  HTTP_PROXY_STATE_COMPLETE,         /* Response complete (Content-Length reached
-                                        or connection closed) */
+  HTTP_PROXY_STATE_COMPLETE,         /* Response complete (end of body framing
+                                        reached or connection closed) */
   HTTP_PROXY_STATE_CLOSING,          /* Connection closing */
   HTTP_PROXY_STATE_ERROR
 } http_proxy_state_t;
 
 /* HTTP proxy session structure */
-typedef struct {
+typedef struct http_proxy_session_s {
   int initialized;              /* Flag: session has been initialized with resources */
   int socket;                   /* TCP socket to upstream server */
   int epoll_fd;                 /* Epoll file descriptor for socket
@@ -64,11 +69,15 @@ typedef struct {
   char target_path[HTTP_PROXY_PATH_SIZE];
 
   /* Dual-stack async connect state (sequential candidate fallback).
-   * connect_results owns the getaddrinfo list; connect_next points to the
-   * next untried candidate. */
+   * connect_results owns the resolver's candidate list; connect_next points
+   * to the next untried candidate.  resolve_query is the pending DNS lookup
+   * (state stays CONNECTING meanwhile); connect_failed reports a lookup or
+   * connect failure that happened outside the socket event handler. */
   struct addrinfo *connect_results;
   struct addrinfo *connect_next;
   int connect_last_errno;
+  struct resolver_query_s *resolve_query;
+  int connect_failed;
 
   /* Request method from client (GET, POST, PUT, DELETE, etc.) */
   char method[16];
@@ -83,7 +92,23 @@ typedef struct {
   int transfer_encoding_seen;                               /* Upstream sent Transfer-Encoding */
   int response_is_chunked;                                  /* Final supported transfer coding is chunked */
   int unsupported_transfer_coding;                          /* Transfer-Encoding includes unsupported coding */
-  http_chunked_decoder_t chunked_decoder;                   /* Used only while rewriting chunked M3U bodies */
+  http_chunked_decoder_t chunked_decoder;                   /* Chunk framing; decodes rewritten bodies */
+
+  /* Upstream keep-alive state */
+  int reused;            /* Socket was taken from the idle connection pool */
+  int keep_alive;        /* Upstream allows another request on this connection */
+  int keep_alive_sec;    /* Idle timeout announced in Keep-Alive, 0 if none */
+  int response_complete; /* Response read exactly up to the end of its framing */
+
+  /* HLS segment download shared with other clients (see http_proxy_cache.h)
+   * and the response's freshness information */
+  struct http_proxy_cache_flight_s *cache_flight;
+  int cache_no_store;     /* Cache-Control no-store, no-cache or private */
+  int64_t cache_max_age;  /* Cache-Control max-age in seconds, -1 if absent */
+  int64_t cache_s_maxage; /* Cache-Control s-maxage in seconds, -1 if absent */
+  int64_t cache_expires;  /* Expires, 0 if absent, -1 if malformed */
+  int64_t cache_date;     /* Date, 0 if absent or malformed */
+  int64_t cache_age;      /* Age in seconds, 0 if absent */
 
   /* Non-blocking I/O state */
   char pending_request[HTTP_PROXY_REQUEST_BUFFER_SIZE];     /* Request being sent */
@@ -92,24 +117,25 @@ typedef struct {
   uint8_t response_buffer[HTTP_PROXY_RESPONSE_BUFFER_SIZE]; /* Receive buffer */
   size_t response_buffer_pos;                               /* Current position in response buffer */
 
-  /* Raw headers from client request for full passthrough (pointer to avoid copy)
-   */
-  const char *raw_headers; /* Points to http_request_t.raw_headers, no ownership
-                            */
-  size_t raw_headers_len;
+  /* Client request whose headers are passed through (pointer to avoid copy) */
+  const struct http_request_s *client_request; /* No ownership */
 
   /* Request body from client (pointer to avoid copy) */
   const char *request_body; /* Points to http_request_t.body, no ownership */
   size_t request_body_len;
   size_t request_body_sent; /* Bytes of request body already sent */
 
-  /* Body rewriting state (for M3U, HTML, etc.) */
-  int needs_body_rewrite;          /* Flag: response needs body rewriting */
-  char *rewrite_body_buffer;       /* Dynamically allocated body buffer */
-  size_t rewrite_body_buffer_size; /* Allocated buffer size */
-  size_t rewrite_body_buffer_used; /* Bytes used in buffer */
-
-  /* Saved response headers for passthrough during body rewrite */
+  /* Body rewriting state (for M3U, HTML, etc.).  The body is rewritten as it
+   * arrives; rewritten bytes collect in a pool buffer that is sent as one
+   * chunk (HTTP/1.1 clients) once full or at the end of each read. */
+  int needs_body_rewrite;              /* Flag: response needs body rewriting */
+  int rewrite_chunked;                 /* Rewritten body is sent chunk-encoded */
+  rewrite_m3u_stream_t rewrite_stream; /* Line state of the M3U rewriter */
+  char *rewrite_base_url;              /* malloc'd proxy base URL URLs are rewritten to */
+  struct buffer_ref_s *rewrite_out;    /* Pool buffer collecting the next chunk */
+
+  /* Saved response headers for passthrough during body rewrite; sent with
+   * the first rewritten bytes */
   char *saved_response_headers; /* malloc'd copy of original response headers */
 
   /* Request headers for base URL construction */
@@ -153,13 +179,13 @@ int http_proxy_parse_url(http_proxy_session_t *session, const char *url);
 void http_proxy_set_method(http_proxy_session_t *session, const char *method);
 
 /**
- * Set raw headers for full passthrough from client request
- * These headers will be forwarded as-is to upstream (except Host, Connection)
+ * Set the client request whose headers are passed through to upstream
+ * (except Host, Connection and the others http_request_format_forward_headers
+ * leaves out).  The request must stay valid for the proxy session.
  * @param session HTTP proxy session
- * @param raw_headers Raw header string in "Name: Value\r\n" format
- * @param raw_headers_len Length of raw headers string
+ * @param request Parsed client request
  */
-void http_proxy_set_raw_headers(http_proxy_session_t *session, const char *raw_headers, size_t raw_headers_len);
+void http_proxy_set_client_request(http_proxy_session_t *session, const struct http_request_s *request);
 
 /**
  * Set request body for passthrough from client request
@@ -181,6 +207,8 @@ void http_proxy_set_request_headers(http_proxy_session_t *session, const char *h
 
 /**
  * Connect to upstream HTTP server (non-blocking)
+ * GET and HEAD requests without a body take an idle connection from the
+ * upstream keep-alive pool when there is one.
  * @param session HTTP proxy session (must have epoll_fd set)
  * @return 0 on success (connection in progress), -1 on error
  */
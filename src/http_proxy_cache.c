@@ -0,0 +1,655 @@
+#include "http_proxy_cache.h"
+#include "configuration.h"
+#include "connection.h"
+#include "http.h"
+#include "http_proxy.h"
+#include "poller.h"
+#include "rtp2httpd.h"
+#include "service.h"
+#include "status.h"
+#include "utils.h"
+#include "zerocopy.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  char *key; /* Upstream interface and URL, NULL when the slot is unused */
+  int fd;    /* Unlinked file holding the segment */
+  size_t size;
+  char content_type[HTTP_PROXY_CONTENT_TYPE_SIZE];
+  int64_t stored_at;  /* When the download completed */
+  int64_t expires_at; /* End of the freshness lifetime; hits do not extend it */
+  int64_t last_used;  /* Stored or last served, for LRU eviction */
+} http_proxy_cache_entry_t;
+
+typedef struct http_proxy_cache_waiter_s {
+  connection_t *conn;
+  size_t queued; /* Bytes of the segment queued for the client */
+  struct http_proxy_cache_waiter_s *next;
+} http_proxy_cache_waiter_t;
+
+typedef struct http_proxy_cache_flight_s {
+  char *key;
+  connection_t *leader; /* Connection whose proxy session downloads the segment */
+  int fd;               /* Unlinked file the body goes to, -1 until the headers are in */
+  size_t size;          /* Content-Length */
+  size_t written;       /* Body bytes in the file */
+  int64_t lifetime_ms;  /* Freshness lifetime of the response */
+  char content_type[HTTP_PROXY_CONTENT_TYPE_SIZE];
+  http_proxy_cache_waiter_t *waiters;
+  http_proxy_cache_waiter_t *waiters_tail;
+  struct http_proxy_cache_flight_s *next;
+} http_proxy_cache_flight_t;
+
+/* One cache per event loop, like the proxy sessions that fill it */
+static _Thread_local http_proxy_cache_entry_t entries[HTTP_PROXY_CACHE_MAX_ENTRIES];
+static _Thread_local size_t cached_bytes;
+static _Thread_local http_proxy_cache_flight_t *flights = NULL;
+
+#define HTTP_PROXY_CACHE_STATS_INC(field)                                                                              \
+  do {                                                                                                                 \
+    if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS) {                                           \
+      status_shared->worker_stats[worker_id].field++;                                                                  \
+    }                                                                                                                  \
+  } while (0)
+
+/* Media segment extensions; playlists are rewritten per client and never cached */
+static const char *const segment_extensions[] = {"ts", "m4s", "mp4", "m4a", "m4v", "aac", "ac3", "ec3", "mp3"};
+
+static void update_stats(void) {
+  if (!status_shared || worker_id < 0 || worker_id >= STATUS_MAX_WORKERS)
+    return;
+
+  uint32_t cached = 0;
+  for (int i = 0; i < HTTP_PROXY_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key)
+      cached++;
+  }
+  status_shared->worker_stats[worker_id].http_segment_cached = cached;
+  status_shared->worker_stats[worker_id].http_segment_cache_bytes = cached_bytes;
+}
+
+static void entry_free(http_proxy_cache_entry_t *entry) {
+  free(entry->key);
+  entry->key = NULL;
+  if (entry->fd >= 0)
+    close(entry->fd);
+  entry->fd = -1;
+  cached_bytes -= entry->size;
+  entry->size = 0;
+}
+
+static http_proxy_cache_entry_t *find_entry(const char *key) {
+  for (int i = 0; i < HTTP_PROXY_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key && strcmp(entries[i].key, key) == 0)
+      return &entries[i];
+  }
+  return NULL;
+}
+
+/* Free slot for a segment of size bytes, evicting the least recently used
+ * segments until it fits within the configured limit */
+static http_proxy_cache_entry_t *entry_slot(size_t size) {
+  size_t limit = (size_t)config.http_proxy_segment_cache * 1024 * 1024;
+
+  if (size > limit)
+    return NULL;
+
+  for (;;) {
+    http_proxy_cache_entry_t *free_slot = NULL;
+    http_proxy_cache_entry_t *oldest = NULL;
+
+    for (int i = 0; i < HTTP_PROXY_CACHE_MAX_ENTRIES; i++) {
+      if (!entries[i].key) {
+        if (!free_slot)
+          free_slot = &entries[i];
+      } else if (!oldest || entries[i].last_used < oldest->last_used) {
+        oldest = &entries[i];
+      }
+    }
+    if (free_slot && cached_bytes + size <= limit)
+      return free_slot;
+    if (!oldest)
+      return NULL;
+    entry_free(oldest);
+  }
+}
+
+static int request_has_header(const http_request_t *req, const char *name) {
+  size_t name_len = strlen(name);
+  for (uint16_t i = 0; i < req->header_count; i++) {
+    const http_header_slice_t *h = &req->headers[i];
+    if (h->name_len == name_len && strncasecmp(req->head + h->name_off, name, name_len) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+/* Whether cookies other than our own r2h-token are forwarded upstream */
+static int request_has_upstream_cookie(const http_request_t *req) {
+  char filtered[HTTP_COOKIE_BUFFER_SIZE];
+  int filter_token = config.r2h_token && config.r2h_token[0] != '\0';
+
+  for (uint16_t i = 0; i < req->header_count; i++) {
+    const http_header_slice_t *h = &req->headers[i];
+    if (h->name_len != 6 || strncasecmp(req->head + h->name_off, "Cookie", 6) != 0)
+      continue;
+    if (!filter_token || http_filter_cookie(req->head + h->value_off, "r2h-token", filtered, sizeof(filtered)) != 0)
+      return 1;
+  }
+  return 0;
+}
+
+int http_proxy_cache_is_eligible(const connection_t *c, const char *upstream_url) {
+  if (!c || !upstream_url || config.http_proxy_segment_cache <= 0)
+    return 0;
+  if (strcasecmp(c->http_req.method, "GET") != 0 || c->http_req.body_len > 0)
+    return 0;
+  /* Whatever an authenticated upstream returns is not for everyone */
+  if (request_has_header(&c->http_req, "Authorization"))
+    return 0;
+  /* Nor is what the upstream picked by a client's cookies */
+  if (request_has_upstream_cookie(&c->http_req))
+    return 0;
+
+  /* Extension of the last path component, query excluded */
+  size_t path_len = strcspn(upstream_url, "?#");
+  const char *ext = NULL;
+  for (size_t i = path_len; i > 0; i--) {
+    char ch = upstream_url[i - 1];
+    if (ch == '/')
+      break;
+    if (ch == '.') {
+      ext = upstream_url + i;
+      break;
+    }
+  }
+  if (!ext)
+    return 0;
+
+  size_t ext_len = (size_t)(upstream_url + path_len - ext);
+  for (size_t i = 0; i < sizeof(segment_extensions) / sizeof(segment_extensions[0]); i++) {
+    if (strlen(segment_extensions[i]) == ext_len && strncasecmp(ext, segment_extensions[i], ext_len) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+static http_proxy_cache_flight_t *find_flight(const char *key) {
+  for (http_proxy_cache_flight_t *f = flights; f; f = f->next) {
+    if (strcmp(f->key, key) == 0)
+      return f;
+  }
+  return NULL;
+}
+
+/* Unlink the flight led by leader from the list and return it */
+static http_proxy_cache_flight_t *take_flight(connection_t *leader) {
+  http_proxy_cache_flight_t **pp = &flights;
+  while (*pp) {
+    http_proxy_cache_flight_t *f = *pp;
+    if (f->leader == leader) {
+      *pp = f->next;
+      f->next = NULL;
+      return f;
+    }
+    pp = &f->next;
+  }
+  return NULL;
+}
+
+static http_proxy_cache_waiter_t *pop_waiter(http_proxy_cache_flight_t *flight) {
+  http_proxy_cache_waiter_t *w = flight->waiters;
+  if (w) {
+    flight->waiters = w->next;
+    if (!flight->waiters)
+      flight->waiters_tail = NULL;
+  }
+  return w;
+}
+
+static void flight_free(http_proxy_cache_flight_t *flight) {
+  http_proxy_cache_waiter_t *w;
+  while ((w = pop_waiter(flight)) != NULL) {
+    w->conn->segment_waiting = 0;
+    free(w);
+  }
+  if (flight->fd >= 0)
+    close(flight->fd);
+  free(flight->key);
+  free(flight);
+}
+
+/* Queue what the client has not got yet.  Only one file range is kept in
+ * the client's queue at a time; the rest follows when it drains, so a slow
+ * client holds one descriptor and its backlog stays in the file. */
+static void feed_waiter(http_proxy_cache_flight_t *flight, http_proxy_cache_waiter_t *w) {
+  connection_t *c = w->conn;
+
+  if (w->queued >= flight->written || c->zc_queue.head || c->state == CONN_CLOSING)
+    return;
+
+  int fd = dup(flight->fd);
+  if (fd < 0) {
+    logger(LOG_ERROR, "HTTP Proxy: Failed to dup segment fd: %s", strerror(errno));
+    return; /* Retried on the next drain or when the download ends */
+  }
+  if (zerocopy_queue_add_file(&c->zc_queue, fd, (off_t)w->queued, flight->written - w->queued) < 0) {
+    close(fd);
+    return;
+  }
+  w->queued = flight->written;
+  connection_epoll_update_events(c->epfd, c->fd, POLLER_IN | POLLER_OUT | POLLER_RDHUP | POLLER_HUP | POLLER_ERR);
+}
+
+/* Send the segment headers to a waiter once the leader's response is known */
+static void start_waiter(http_proxy_cache_flight_t *flight, http_proxy_cache_waiter_t *w) {
+  char extra_headers[64];
+
+  snprintf(extra_headers, sizeof(extra_headers), "Content-Length: %zu\r\n", flight->size);
+  send_http_headers(w->conn, STATUS_200, flight->content_type, extra_headers);
+  w->conn->segment_waiting = 1;
+  connection_epoll_update_events(w->conn->epfd, w->conn->fd,
+                                 POLLER_IN | POLLER_OUT | POLLER_RDHUP | POLLER_HUP | POLLER_ERR);
+}
+
+/* Download ended: queue the rest of what arrived and close after it.  A
+ * client of a cut-short download sees less than its Content-Length. */
+static void end_waiter(http_proxy_cache_flight_t *flight, http_proxy_cache_waiter_t *w) {
+  connection_t *c = w->conn;
+  int fd = -1;
+
+  c->segment_waiting = 0;
+  if (w->queued < flight->written && (fd = dup(flight->fd)) >= 0 &&
+      connection_queue_file(c, fd, (off_t)w->queued, flight->written - w->queued) == 0)
+    return; /* The file send ends the connection */
+  if (fd >= 0)
+    close(fd);
+  connection_begin_drain_close(c);
+}
+
+/* The leader's response cannot be shared: waiters fetch the segment on
+ * their own */
+static void release_waiter(http_proxy_cache_waiter_t *w) {
+  connection_t *c = w->conn;
+  service_t *service = c->service;
+
+  c->service = NULL;
+  connection_start_stream(c, service, 0);
+}
+
+static void release_flight(http_proxy_cache_flight_t *flight) {
+  http_proxy_cache_waiter_t *w;
+  while ((w = pop_waiter(flight)) != NULL) {
+    release_waiter(w);
+    free(w);
+  }
+  flight_free(flight);
+}
+
+static void end_flight(http_proxy_cache_flight_t *flight) {
+  http_proxy_cache_waiter_t *w;
+  while ((w = pop_waiter(flight)) != NULL) {
+    end_waiter(flight, w);
+    free(w);
+  }
+}
+
+http_proxy_cache_result_t http_proxy_cache_attach(connection_t *c, const char *key) {
+  if (!c || !key)
+    return HTTP_PROXY_CACHE_MISS;
+
+  int64_t now = get_time_ms();
+  http_proxy_cache_entry_t *entry = find_entry(key);
+  if (entry && now >= entry->expires_at) {
+    logger(LOG_DEBUG, "HTTP Proxy: Cached segment %s is stale", key);
+    entry_free(entry);
+    update_stats();
+    entry = NULL;
+  }
+  if (entry) {
+    /* http_send_file closes its fd once sent */
+    int fd = dup(entry->fd);
+    if (fd >= 0) {
+      char age_header[32];
+      logger(LOG_DEBUG, "HTTP Proxy: Serving cached segment %s (%zu bytes)", key, entry->size);
+      HTTP_PROXY_CACHE_STATS_INC(http_segment_hits);
+      entry->last_used = now;
+      snprintf(age_header, sizeof(age_header), "Age: %lld", (long long)((now - entry->stored_at) / 1000));
+      http_send_file(c, fd, entry->size, entry->content_type, NULL, age_header);
+      return HTTP_PROXY_CACHE_SERVED;
+    }
+    logger(LOG_ERROR, "HTTP Proxy: Failed to dup segment fd: %s", strerror(errno));
+  }
+
+  /* Ranges of a segment still downloading go upstream */
+  if (c->http_req.range[0] != '\0')
+    return HTTP_PROXY_CACHE_MISS;
+
+  http_proxy_cache_flight_t *flight = find_flight(key);
+  if (flight) {
+    http_proxy_cache_waiter_t *w = calloc(1, sizeof(*w));
+    if (!w)
+      return HTTP_PROXY_CACHE_MISS; /* Fetch on our own */
+    w->conn = c;
+    if (flight->waiters_tail)
+      flight->waiters_tail->next = w;
+    else
+      flight->waiters = w;
+    flight->waiters_tail = w;
+    logger(LOG_DEBUG, "HTTP Proxy: Joined running download of %s", key);
+    HTTP_PROXY_CACHE_STATS_INC(http_segment_coalesced);
+    if (flight->fd >= 0)
+      start_waiter(flight, w);
+    return HTTP_PROXY_CACHE_WAITING;
+  }
+
+  /* Lead a new download; without a flight record the request still works,
+   * it just can't be shared */
+  flight = calloc(1, sizeof(*flight));
+  if (!flight)
+    return HTTP_PROXY_CACHE_MISS;
+  flight->key = strdup(key);
+  if (!flight->key) {
+    free(flight);
+    return HTTP_PROXY_CACHE_MISS;
+  }
+  flight->fd = -1;
+  flight->leader = c;
+  flight->next = flights;
+  flights = flight;
+  return HTTP_PROXY_CACHE_MISS;
+}
+
+/* Parse the directives of a Cache-Control value that bear on a shared cache */
+static void parse_cache_control(http_proxy_session_t *session, const char *value) {
+  while (*value) {
+    value += strspn(value, " \t,");
+    size_t len = strcspn(value, ",");
+    size_t name_len = strcspn(value, "=, \t");
+    if (len == 0)
+      break;
+    if (name_len > len)
+      name_len = len;
+
+    if ((name_len == 8 && (strncasecmp(value, "no-store", 8) == 0 || strncasecmp(value, "no-cache", 8) == 0)) ||
+        (name_len == 7 && strncasecmp(value, "private", 7) == 0)) {
+      session->cache_no_store = 1;
+    } else if ((name_len == 7 && strncasecmp(value, "max-age", 7) == 0) ||
+               (name_len == 8 && strncasecmp(value, "s-maxage", 8) == 0)) {
+      const char *arg = value + name_len;
+      char *end;
+      arg += strspn(arg, " \t");
+      if (*arg == '=') {
+        arg++;
+        arg += strspn(arg, " \t\"");
+        long long seconds = strtoll(arg, &end, 10);
+        /* A malformed value makes the response stale */
+        if (end == arg || seconds < 0)
+          seconds = 0;
+        if (name_len == 7)
+          session->cache_max_age = seconds;
+        else
+          session->cache_s_maxage = seconds;
+      }
+    }
+    value += len;
+  }
+}
+
+void http_proxy_cache_parse_header(http_proxy_session_t *session, const char *line) {
+  const char *value = strchr(line, ':');
+  size_t name_len;
+
+  if (!value)
+    return;
+  name_len = (size_t)(value - line);
+  value++;
+  value += strspn(value, " \t");
+
+  if (name_len == 13 && strncasecmp(line, "Cache-Control", 13) == 0) {
+    parse_cache_control(session, value);
+  } else if (name_len == 7 && strncasecmp(line, "Expires", 7) == 0) {
+    time_t t = http_parse_date(value);
+    session->cache_expires = t > 0 ? (int64_t)t : -1;
+  } else if (name_len == 4 && strncasecmp(line, "Date", 4) == 0) {
+    time_t t = http_parse_date(value);
+    session->cache_date = t > 0 ? (int64_t)t : 0;
+  } else if (name_len == 3 && strncasecmp(line, "Age", 3) == 0) {
+    long long age = strtoll(value, NULL, 10);
+    session->cache_age = age > 0 ? age : 0;
+  }
+}
+
+/* How long the response may be served from the cache (RFC 9111 section
+ * 4.2), capped at HTTP_PROXY_CACHE_MAX_AGE_SEC; 0 when not at all */
+static int64_t response_lifetime_ms(const http_proxy_session_t *session) {
+  int64_t lifetime = HTTP_PROXY_CACHE_MAX_AGE_SEC;
+
+  if (session->cache_no_store)
+    return 0;
+  if (session->cache_s_maxage >= 0)
+    lifetime = session->cache_s_maxage;
+  else if (session->cache_max_age >= 0)
+    lifetime = session->cache_max_age;
+  else if (session->cache_expires < 0)
+    return 0;
+  else if (session->cache_expires > 0)
+    lifetime = session->cache_expires - (session->cache_date > 0 ? session->cache_date : (int64_t)time(NULL));
+
+  lifetime -= session->cache_age;
+  if (lifetime <= 0)
+    return 0;
+  if (lifetime > HTTP_PROXY_CACHE_MAX_AGE_SEC)
+    lifetime = HTTP_PROXY_CACHE_MAX_AGE_SEC;
+  return lifetime * 1000;
+}
+
+void http_proxy_cache_begin(http_proxy_session_t *session) {
+  if (!flights || !session->conn)
+    return;
+
+  http_proxy_cache_flight_t *flight = take_flight(session->conn);
+  if (!flight)
+    return;
+
+  int64_t lifetime_ms = response_lifetime_ms(session);
+  int shareable = session->response_status_code == 200 && !session->needs_body_rewrite &&
+                  !session->transfer_encoding_seen && session->content_length > 0 && lifetime_ms > 0;
+  if (shareable) {
+    char temp_file_template[] = "/tmp/rtp2httpd_segment_XXXXXX";
+    flight->fd = mkstemp(temp_file_template);
+    if (flight->fd < 0)
+      logger(LOG_ERROR, "HTTP Proxy: Failed to create segment file: %s", strerror(errno));
+    else
+      unlink(temp_file_template);
+  }
+  if (flight->fd < 0) {
+    logger(LOG_DEBUG, "HTTP Proxy: Response for %s (status %d) is not shared", flight->key,
+           session->response_status_code);
+    release_flight(flight);
+    return;
+  }
+
+  flight->size = (size_t)session->content_length;
+  flight->lifetime_ms = lifetime_ms;
+  snprintf(flight->content_type, sizeof(flight->content_type), "%s",
+           session->response_content_type[0] ? session->response_content_type : "application/octet-stream");
+  flight->next = flights;
+  flights = flight;
+  session->cache_flight = flight;
+
+  for (http_proxy_cache_waiter_t *w = flight->waiters; w; w = w->next)
+    start_waiter(flight, w);
+}
+
+void http_proxy_cache_append(http_proxy_session_t *session, const uint8_t *data, size_t len) {
+  http_proxy_cache_flight_t *flight = session->cache_flight;
+  size_t done = 0;
+
+  if (!flight || len == 0)
+    return;
+
+  while (done < len) {
+    ssize_t n = pwrite(flight->fd, data + done, len - done, (off_t)(flight->written + done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      /* The leader's own client is unaffected; waiters get what made it
+       * into the file */
+      logger(LOG_WARN, "HTTP Proxy: Failed to write segment file: %s", n < 0 ? strerror(errno) : "short write");
+      session->cache_flight = NULL;
+      take_flight(session->conn);
+      end_flight(flight);
+      flight_free(flight);
+      return;
+    }
+    done += (size_t)n;
+  }
+  flight->written += len;
+
+  for (http_proxy_cache_waiter_t *w = flight->waiters; w; w = w->next)
+    feed_waiter(flight, w);
+}
+
+void http_proxy_cache_finish(http_proxy_session_t *session) {
+  http_proxy_cache_flight_t *flight = session->cache_flight;
+
+  if (!flight)
+    return;
+  session->cache_flight = NULL;
+  take_flight(session->conn);
+  end_flight(flight);
+
+  if (!session->response_complete || flight->written != flight->size) {
+    logger(LOG_DEBUG, "HTTP Proxy: Segment %s ended after %zu of %zu bytes, not cached", flight->key,
+           flight->written, flight->size);
+    flight_free(flight);
+    return;
+  }
+
+  http_proxy_cache_entry_t *existing = find_entry(flight->key);
+  if (existing)
+    entry_free(existing);
+  http_proxy_cache_entry_t *entry = entry_slot(flight->size);
+  if (entry) {
+    entry->key = flight->key;
+    entry->fd = flight->fd;
+    entry->size = flight->size;
+    memcpy(entry->content_type, flight->content_type, sizeof(entry->content_type));
+    entry->stored_at = get_time_ms();
+    entry->expires_at = entry->stored_at + flight->lifetime_ms;
+    entry->last_used = entry->stored_at;
+    cached_bytes += entry->size;
+    flight->key = NULL; /* Moved into the entry */
+    flight->fd = -1;
+    logger(LOG_DEBUG, "HTTP Proxy: Cached segment %s (%zu bytes)", entry->key, entry->size);
+  }
+  update_stats();
+  flight_free(flight);
+}
+
+void http_proxy_cache_on_drain(connection_t *c) {
+  for (http_proxy_cache_flight_t *f = flights; f; f = f->next) {
+    for (http_proxy_cache_waiter_t *w = f->waiters; w; w = w->next) {
+      if (w->conn == c) {
+        feed_waiter(f, w);
+        return;
+      }
+    }
+  }
+}
+
+void http_proxy_cache_leave(connection_t *c) {
+  if (!flights || !c)
+    return;
+
+  http_proxy_cache_flight_t *flight = take_flight(c);
+  if (!flight) {
+    /* Not a leader: drop it from whichever flight it waits on */
+    for (http_proxy_cache_flight_t *f = flights; f; f = f->next) {
+      http_proxy_cache_waiter_t **pp = &f->waiters;
+      http_proxy_cache_waiter_t *prev = NULL;
+      while (*pp) {
+        http_proxy_cache_waiter_t *w = *pp;
+        if (w->conn == c) {
+          *pp = w->next;
+          if (f->waiters_tail == w)
+            f->waiters_tail = prev;
+          c->segment_waiting = 0;
+          free(w);
+          return;
+        }
+        prev = w;
+        pp = &w->next;
+      }
+    }
+    return;
+  }
+
+  /* The leader's client left mid-download: waiters get what has arrived */
+  if (flight->fd >= 0) {
+    c->stream.http_proxy.cache_flight = NULL;
+    end_flight(flight);
+    flight_free(flight);
+    return;
+  }
+
+  /* A leader that already answered (503) failed its request */
+  if (c->headers_sent) {
+    release_flight(flight);
+    return;
+  }
+
+  /* The leader's client left before the response: hand the download to the
+   * next waiter */
+  http_proxy_cache_waiter_t *w;
+  while ((w = pop_waiter(flight)) != NULL) {
+    connection_t *next_leader = w->conn;
+    service_t *service = next_leader->service;
+    free(w);
+
+    next_leader->service = NULL;
+    if (connection_start_stream(next_leader, service, 0) == 0) {
+      logger(LOG_DEBUG, "HTTP Proxy: Download of %s handed to a waiting client", flight->key);
+      flight->leader = next_leader;
+      flight->next = flights;
+      flights = flight;
+      return;
+    }
+  }
+  flight_free(flight);
+}
+
+void http_proxy_cache_tick(int64_t now) {
+  int expired = 0;
+
+  if (cached_bytes == 0)
+    return;
+  for (int i = 0; i < HTTP_PROXY_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key && now >= entries[i].expires_at) {
+      entry_free(&entries[i]);
+      expired = 1;
+    }
+  }
+  if (expired)
+    update_stats();
+}
+
+void http_proxy_cache_cleanup(void) {
+  while (flights) {
+    http_proxy_cache_flight_t *flight = flights;
+    flights = flight->next;
+    flight_free(flight);
+  }
+  for (int i = 0; i < HTTP_PROXY_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key)
+      entry_free(&entries[i]);
+  }
+  update_stats();
+}
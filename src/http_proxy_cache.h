@@ -0,0 +1,116 @@
+#ifndef __HTTP_PROXY_CACHE_H__
+#define __HTTP_PROXY_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Forward declarations */
+typedef struct connection_s connection_t;
+struct http_proxy_session_s;
+
+/* Upper bound for the http-proxy-segment-cache option (MB) */
+#define HTTP_PROXY_CACHE_SIZE_MAX 1024
+
+/* Segments kept per event loop, whatever their size */
+#define HTTP_PROXY_CACHE_MAX_ENTRIES 256
+
+/* Upper bound on how long a segment is kept after it was stored, whatever
+ * its freshness lifetime; live playlists have moved past it by then */
+#define HTTP_PROXY_CACHE_MAX_AGE_SEC 60
+
+/**
+ * HLS segment cache for the HTTP proxy
+ *
+ * Clients watching the same HLS channel through /http/... fetch the same
+ * media segments within seconds of each other.  With
+ * config.http_proxy_segment_cache MB configured, GET requests for segment
+ * files (.ts, .m4s, .aac, ...) are keyed by their resolved upstream URL and
+ * upstream interface:
+ *
+ * - The first request leads: it is proxied as usual, and a 200 response with
+ *   a Content-Length is also written to an unlinked file in /tmp (tmpfs on
+ *   the routers this runs on).
+ * - Requests for a segment that is still downloading attach to the leader
+ *   (single-flight) and are sent the file with sendfile() while it grows:
+ *   whatever has arrived is queued as one file range, and the next range
+ *   once that one has been sent.  A slow client only holds a descriptor,
+ *   its backlog stays in the file.
+ * - Complete segments stay in the cache and are answered with sendfile(),
+ *   Range requests included, for their freshness lifetime: s-maxage or
+ *   max-age of Cache-Control, else Expires minus Date, less the upstream's
+ *   Age, and never longer than HTTP_PROXY_CACHE_MAX_AGE_SEC after they were
+ *   stored.  Hits do not extend it.  The least recently used segments are
+ *   evicted to stay within the size limit.
+ *
+ * A response that cannot be shared (not 200, no Content-Length, chunked,
+ * Cache-Control no-store, no-cache or private, already stale) releases the
+ * waiting clients, which then fetch the segment on their own.  Requests
+ * carrying credentials or cookies bypass the cache.
+ */
+
+typedef enum {
+  HTTP_PROXY_CACHE_MISS = 0, /* Caller fetches the segment itself */
+  HTTP_PROXY_CACHE_SERVED,   /* Response sent from the cache */
+  HTTP_PROXY_CACHE_WAITING   /* Attached to the segment's running download */
+} http_proxy_cache_result_t;
+
+/**
+ * Look up a segment request
+ * @param c Connection in CONN_ROUTE; c->service must be set when waiting
+ * @param key Upstream interface and resolved upstream URL
+ * @return http_proxy_cache_result_t
+ */
+http_proxy_cache_result_t http_proxy_cache_attach(connection_t *c, const char *key);
+
+/**
+ * Whether a proxied request may be served from or fill the cache: a GET
+ * without body, credentials or cookies for a segment file
+ * @param c Connection with the parsed request
+ * @param upstream_url Resolved upstream URL
+ */
+int http_proxy_cache_is_eligible(const connection_t *c, const char *upstream_url);
+
+/**
+ * Note an upstream response header that bears on caching (Cache-Control,
+ * Expires, Date, Age) in the session
+ * @param session HTTP proxy session
+ * @param line Header line without CRLF
+ */
+void http_proxy_cache_parse_header(struct http_proxy_session_s *session, const char *line);
+
+/**
+ * Response headers of a leader's upstream arrived
+ * Attaches the session to the download when the response can be shared,
+ * otherwise releases the waiting clients.
+ * @param session Leader's HTTP proxy session
+ */
+void http_proxy_cache_begin(struct http_proxy_session_s *session);
+
+/**
+ * Body bytes the leader queued for its client
+ * @param session Leader's HTTP proxy session
+ * @param data Body bytes
+ * @param len Number of bytes
+ */
+void http_proxy_cache_append(struct http_proxy_session_s *session, const uint8_t *data, size_t len);
+
+/**
+ * The leader's response ended; a complete body is kept in the cache, the
+ * waiting clients get the rest of it
+ * @param session Leader's HTTP proxy session
+ */
+void http_proxy_cache_finish(struct http_proxy_session_s *session);
+
+/** A waiting client's send queue drained: catch up from the file */
+void http_proxy_cache_on_drain(connection_t *c);
+
+/** Detach a connection that is being closed from any running download */
+void http_proxy_cache_leave(connection_t *c);
+
+/** Drop entries past their freshness lifetime */
+void http_proxy_cache_tick(int64_t now);
+
+/** Release all entries of this event loop */
+void http_proxy_cache_cleanup(void);
+
+#endif /* __HTTP_PROXY_CACHE_H__ */
@@ -0,0 +1,169 @@
+#include "http_proxy_pool.h"
+#include "http_proxy.h"
+#include "rtp2httpd.h"
+#include "status.h"
+#include "utils.h"
+#include <errno.h>
+#include <net/if.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef struct {
+  int sock; /* Idle connection, -1 when unused */
+  char host[HTTP_PROXY_HOST_SIZE];
+  int port;
+  char ifname[IF_NAMESIZE];
+  int64_t idle_since;
+  int64_t expires_at;
+} http_proxy_pool_entry_t;
+
+/* Per event loop, like the poller the sockets are taken back into; the
+ * first call marks all slots unused */
+static _Thread_local http_proxy_pool_entry_t entries[HTTP_PROXY_POOL_SIZE];
+static _Thread_local int entries_ready;
+static _Thread_local uint32_t idle_count;
+
+static worker_stats_t *pool_stats(void) {
+  if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS)
+    return &status_shared->worker_stats[worker_id];
+  return NULL;
+}
+
+static void pool_prepare(void) {
+  if (entries_ready)
+    return;
+  for (int i = 0; i < HTTP_PROXY_POOL_SIZE; i++)
+    entries[i].sock = -1;
+  entries_ready = 1;
+}
+
+static void pool_update_gauge(void) {
+  worker_stats_t *stats = pool_stats();
+  if (stats)
+    stats->http_upstream_idle = idle_count;
+}
+
+static void entry_close(http_proxy_pool_entry_t *entry) {
+  if (entry->sock < 0)
+    return;
+  close(entry->sock);
+  entry->sock = -1;
+  idle_count--;
+}
+
+static int entry_matches(const http_proxy_pool_entry_t *entry, const char *host, int port, const char *ifname) {
+  return entry->sock >= 0 && entry->port == port && strcmp(entry->host, host) == 0 &&
+         strcmp(entry->ifname, ifname ? ifname : "") == 0;
+}
+
+/* An idle connection must have nothing to read: data would be a stray
+ * response, EOF or an error means the upstream dropped it */
+static int entry_is_healthy(const http_proxy_pool_entry_t *entry) {
+  char byte;
+  ssize_t r = recv(entry->sock, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return r < 0 && errno == EAGAIN;
+}
+
+int http_proxy_pool_acquire(const char *host, int port, const char *ifname) {
+  pool_prepare();
+
+  for (;;) {
+    /* Most recently parked first: the least likely to have timed out */
+    http_proxy_pool_entry_t *best = NULL;
+    for (int i = 0; i < HTTP_PROXY_POOL_SIZE; i++) {
+      if (entry_matches(&entries[i], host, port, ifname) && (!best || entries[i].idle_since > best->idle_since))
+        best = &entries[i];
+    }
+    if (!best)
+      return -1;
+
+    if (!entry_is_healthy(best)) {
+      logger(LOG_DEBUG, "HTTP Proxy: Dropping idle connection to %s:%d closed by upstream", host, port);
+      entry_close(best);
+      pool_update_gauge();
+      continue;
+    }
+
+    int sock = best->sock;
+    best->sock = -1;
+    idle_count--;
+    pool_update_gauge();
+    worker_stats_t *stats = pool_stats();
+    if (stats)
+      stats->http_upstream_reuses++;
+    return sock;
+  }
+}
+
+void http_proxy_pool_release(const char *host, int port, const char *ifname, int sock, int idle_sec) {
+  http_proxy_pool_entry_t *slot = NULL;
+  http_proxy_pool_entry_t *oldest_same = NULL;
+  http_proxy_pool_entry_t *oldest = NULL;
+  int same = 0;
+
+  pool_prepare();
+
+  if (sock < 0)
+    return;
+  if (idle_sec <= 0 || strlen(host) >= HTTP_PROXY_HOST_SIZE || (ifname && strlen(ifname) >= IF_NAMESIZE)) {
+    close(sock);
+    return;
+  }
+  if (idle_sec > HTTP_PROXY_POOL_IDLE_SEC)
+    idle_sec = HTTP_PROXY_POOL_IDLE_SEC;
+
+  for (int i = 0; i < HTTP_PROXY_POOL_SIZE; i++) {
+    http_proxy_pool_entry_t *entry = &entries[i];
+    if (entry->sock < 0) {
+      if (!slot)
+        slot = entry;
+      continue;
+    }
+    if (entry_matches(entry, host, port, ifname)) {
+      same++;
+      if (!oldest_same || entry->idle_since < oldest_same->idle_since)
+        oldest_same = entry;
+    }
+    if (!oldest || entry->idle_since < oldest->idle_since)
+      oldest = entry;
+  }
+
+  /* Over the per-host limit, replace that host's oldest connection; with a
+   * full table, the oldest connection overall */
+  if (same >= HTTP_PROXY_POOL_MAX_PER_HOST)
+    slot = oldest_same;
+  else if (!slot)
+    slot = oldest;
+  entry_close(slot);
+
+  int64_t now = get_time_ms();
+  slot->sock = sock;
+  snprintf(slot->host, sizeof(slot->host), "%s", host);
+  slot->port = port;
+  snprintf(slot->ifname, sizeof(slot->ifname), "%s", ifname ? ifname : "");
+  slot->idle_since = now;
+  slot->expires_at = now + (int64_t)idle_sec * 1000;
+  idle_count++;
+  pool_update_gauge();
+  logger(LOG_DEBUG, "HTTP Proxy: Keeping connection to %s:%d for reuse (%d s)", host, port, idle_sec);
+}
+
+void http_proxy_pool_tick(int64_t now) {
+  if (!entries_ready || idle_count == 0)
+    return;
+  for (int i = 0; i < HTTP_PROXY_POOL_SIZE; i++) {
+    if (entries[i].sock >= 0 && entries[i].expires_at <= now)
+      entry_close(&entries[i]);
+  }
+  pool_update_gauge();
+}
+
+void http_proxy_pool_cleanup(void) {
+  if (!entries_ready)
+    return;
+  for (int i = 0; i < HTTP_PROXY_POOL_SIZE; i++)
+    entry_close(&entries[i]);
+  pool_update_gauge();
+}
@@ -0,0 +1,60 @@
+#ifndef __HTTP_PROXY_POOL_H__
+#define __HTTP_PROXY_POOL_H__
+
+#include <stdint.h>
+
+/* Idle upstream connections kept per event loop */
+#define HTTP_PROXY_POOL_SIZE 32
+
+/* Idle upstream connections kept per (host, port, interface) */
+#define HTTP_PROXY_POOL_MAX_PER_HOST 4
+
+/* Seconds an idle upstream connection is kept, unless the upstream's
+ * Keep-Alive header announces a shorter timeout */
+#define HTTP_PROXY_POOL_IDLE_SEC 15
+
+/**
+ * Upstream keep-alive pool for the HTTP proxy
+ *
+ * HLS players poll the playlist and fetch a segment every few seconds, each
+ * one a separate proxied request.  Once a response has been read up to the
+ * end of its framing (Content-Length, last chunk, or no body) and the
+ * upstream did not ask to close, the upstream socket is parked here instead
+ * of being closed, keyed by host, port and upstream interface.  The next
+ * GET or HEAD for the same key takes the most recently parked socket and
+ * skips DNS and the TCP handshake.
+ *
+ * Parked sockets are not registered with the poller.  A socket the upstream
+ * closed or wrote to while idle is detected with a non-blocking peek when it
+ * is taken, and dropped.  Sockets idle for longer than their timeout are
+ * closed by http_proxy_pool_tick().
+ */
+
+/**
+ * Take an idle connection to host:port over ifname
+ * @param host Bare host as in http_proxy_session_t.target_host
+ * @param port Upstream port
+ * @param ifname Upstream interface, NULL for none
+ * @return Connected socket owned by the caller, -1 if none is available
+ */
+int http_proxy_pool_acquire(const char *host, int port, const char *ifname);
+
+/**
+ * Park a connection whose last response was read completely
+ * The socket must already be removed from the poller and fdmap; the pool
+ * takes ownership and closes it if it cannot be kept.
+ * @param host Bare host
+ * @param port Upstream port
+ * @param ifname Upstream interface, NULL for none
+ * @param sock Connected socket
+ * @param idle_sec Seconds to keep it, at most HTTP_PROXY_POOL_IDLE_SEC
+ */
+void http_proxy_pool_release(const char *host, int port, const char *ifname, int sock, int idle_sec);
+
+/** Close connections whose idle time ran out */
+void http_proxy_pool_tick(int64_t now);
+
+/** Close all idle connections of this event loop */
+void http_proxy_pool_cleanup(void);
+
+#endif /* __HTTP_PROXY_POOL_H__ */
@@ -365,111 +365,128 @@ static char *rewrite_m3u_line(const rewrite_context_t *ctx, const char *line, si
   return result;
 }
 
-/* ========== Main M3U Rewriting Function ========== */
+/* ========== Streaming M3U Rewriting ========== */
 
-int rewrite_m3u_content(const rewrite_context_t *ctx, const char *input, char **output, size_t *output_size) {
-  if (!ctx || !input || !output || !output_size)
-    return -1;
+void rewrite_m3u_stream_init(rewrite_m3u_stream_t *stream, const rewrite_context_t *ctx) {
+  memset(stream, 0, sizeof(*stream));
+  stream->ctx = *ctx;
+}
 
-  size_t input_len = strlen(input);
+void rewrite_m3u_stream_free(rewrite_m3u_stream_t *stream) {
+  free(stream->line);
+  stream->line = NULL;
+  stream->line_len = 0;
+  stream->line_alloc = 0;
+}
 
-  /* Limit body size to prevent memory exhaustion */
-  if (input_len > REWRITE_MAX_BODY_SIZE) {
-    logger(LOG_ERROR, "M3U content too large for rewriting: %zu bytes", input_len);
+/* Append to the held partial line */
+static int rewrite_m3u_stream_hold(rewrite_m3u_stream_t *stream, const char *data, size_t len) {
+  if (len == 0)
+    return 0;
+  if (len > REWRITE_MAX_LINE_SIZE - stream->line_len) {
+    logger(LOG_ERROR, "M3U line too long for rewriting (over %d bytes)", REWRITE_MAX_LINE_SIZE);
     return -1;
   }
 
-  /* Estimate output size - rewritten URLs are typically longer */
-  /* Assume worst case: every line is a URL that doubles in length */
-  size_t estimated_size = input_len * 3;
-  char *result = malloc(estimated_size);
-  if (!result) {
-    logger(LOG_ERROR, "Failed to allocate M3U rewrite buffer");
-    return -1;
+  size_t needed = stream->line_len + len;
+  if (needed > stream->line_alloc) {
+    size_t new_alloc = stream->line_alloc == 0 ? 256 : stream->line_alloc * 2;
+    while (new_alloc < needed)
+      new_alloc *= 2;
+    char *new_line = realloc(stream->line, new_alloc);
+    if (!new_line) {
+      logger(LOG_ERROR, "Failed to grow M3U line buffer");
+      return -1;
+    }
+    stream->line = new_line;
+    stream->line_alloc = new_alloc;
   }
 
-  char *out_ptr = result;
-  size_t remaining = estimated_size;
-  const char *line_start = input;
-  const char *input_end = input + input_len;
+  memcpy(stream->line + stream->line_len, data, len);
+  stream->line_len = needed;
+  return 0;
+}
 
-  while (line_start < input_end) {
-    /* Find end of line */
-    const char *line_end = line_start;
-    while (line_end < input_end && *line_end != '\n')
-      line_end++;
+/**
+ * Pass on a rewritten line in place of the original one
+ * @param rewritten Result of rewrite_m3u_line (freed here)
+ * @param line Original line, its newline included when present
+ */
+static int rewrite_m3u_emit_rewritten(char *rewritten, const char *line, size_t line_len, rewrite_emit_fn emit,
+                                      void *opaque) {
+  size_t rewritten_len = strlen(rewritten);
+  int ret = emit(opaque, rewritten, rewritten_len);
 
-    /* Include the newline if present */
-    if (line_end < input_end)
-      line_end++;
+  /* Add line ending if original had one but rewritten doesn't */
+  if (ret == 0 && line[line_len - 1] == '\n' && (rewritten_len == 0 || rewritten[rewritten_len - 1] != '\n'))
+    ret = emit(opaque, "\n", 1);
 
-    size_t line_len = (size_t)(line_end - line_start);
+  free(rewritten);
+  return ret;
+}
 
-    /* Try to rewrite this line */
-    char *rewritten = rewrite_m3u_line(ctx, line_start, line_len);
+/* Rewrite and pass on the held line */
+static int rewrite_m3u_stream_flush_line(rewrite_m3u_stream_t *stream, rewrite_emit_fn emit, void *opaque) {
+  size_t line_len = stream->line_len;
+  stream->line_len = 0;
 
-    if (rewritten) {
-      /* Use rewritten line */
-      size_t rewritten_len = strlen(rewritten);
-
-      /* Check if we need to grow the buffer */
-      while (rewritten_len + 2 > remaining) {
-        size_t used = (size_t)(out_ptr - result);
-        size_t new_size = estimated_size * 2;
-        char *new_result = realloc(result, new_size);
-        if (!new_result) {
-          free(rewritten);
-          free(result);
-          logger(LOG_ERROR, "Failed to grow M3U rewrite buffer");
-          return -1;
-        }
-        result = new_result;
-        out_ptr = result + used;
-        remaining = new_size - used;
-        estimated_size = new_size;
-      }
+  char *rewritten = rewrite_m3u_line(&stream->ctx, stream->line, line_len);
+  if (!rewritten)
+    return emit(opaque, stream->line, line_len);
+  return rewrite_m3u_emit_rewritten(rewritten, stream->line, line_len, emit, opaque);
+}
 
-      memcpy(out_ptr, rewritten, rewritten_len);
-      out_ptr += rewritten_len;
-      remaining -= rewritten_len;
+int rewrite_m3u_stream_feed(rewrite_m3u_stream_t *stream, const char *data, size_t len, rewrite_emit_fn emit,
+                            void *opaque) {
+  if (!stream || !emit || (!data && len > 0))
+    return -1;
 
-      /* Add line ending if original had one but rewritten doesn't */
-      if (line_len > 0 && line_start[line_len - 1] == '\n' &&
-          (rewritten_len == 0 || rewritten[rewritten_len - 1] != '\n')) {
-        *out_ptr++ = '\n';
-        remaining--;
-      }
+  const char *end = data + len;
 
-      free(rewritten);
-    } else {
-      /* Keep original line */
-      if (line_len + 1 > remaining) {
-        size_t used = (size_t)(out_ptr - result);
-        size_t new_size = estimated_size * 2;
-        char *new_result = realloc(result, new_size);
-        if (!new_result) {
-          free(result);
-          logger(LOG_ERROR, "Failed to grow M3U rewrite buffer");
-          return -1;
-        }
-        result = new_result;
-        out_ptr = result + used;
-        remaining = new_size - used;
-        estimated_size = new_size;
-      }
+  /* Complete the line carried over from the previous input */
+  if (stream->line_len > 0) {
+    const char *newline = memchr(data, '\n', len);
+    size_t take = newline ? (size_t)(newline - data) + 1 : len;
+    if (rewrite_m3u_stream_hold(stream, data, take) < 0)
+      return -1;
+    data += take;
+    if (!newline)
+      return 0;
+    if (rewrite_m3u_stream_flush_line(stream, emit, opaque) < 0)
+      return -1;
+  }
 
-      memcpy(out_ptr, line_start, line_len);
-      out_ptr += line_len;
-      remaining -= line_len;
-    }
+  /* Unchanged lines go out in runs, straight from the input */
+  const char *run = data;
+  while (data < end) {
+    const char *newline = memchr(data, '\n', (size_t)(end - data));
+    if (!newline)
+      break;
 
-    line_start = line_end;
+    size_t line_len = (size_t)(newline - data) + 1;
+    char *rewritten = rewrite_m3u_line(&stream->ctx, data, line_len);
+    if (rewritten) {
+      if (data > run && emit(opaque, run, (size_t)(data - run)) < 0) {
+        free(rewritten);
+        return -1;
+      }
+      if (rewrite_m3u_emit_rewritten(rewritten, data, line_len, emit, opaque) < 0)
+        return -1;
+      run = newline + 1;
+    }
+    data = newline + 1;
   }
+  if (data > run && emit(opaque, run, (size_t)(data - run)) < 0)
+    return -1;
 
-  *out_ptr = '\0';
-  *output = result;
-  *output_size = (size_t)(out_ptr - result);
+  /* Hold the partial last line until its newline arrives */
+  return rewrite_m3u_stream_hold(stream, data, (size_t)(end - data));
+}
 
-  logger(LOG_DEBUG, "M3U rewrite: %zu bytes -> %zu bytes", input_len, *output_size);
-  return 0;
+int rewrite_m3u_stream_finish(rewrite_m3u_stream_t *stream, rewrite_emit_fn emit, void *opaque) {
+  if (!stream || !emit)
+    return -1;
+  if (stream->line_len == 0)
+    return 0;
+  return rewrite_m3u_stream_flush_line(stream, emit, opaque);
 }
@@ -11,8 +11,9 @@
  * future content types (HTML, CSS, etc.)
  */
 
-/* Maximum body size for rewriting (prevent memory exhaustion) */
-#define REWRITE_MAX_BODY_SIZE (2 * 1024 * 1024) /* 2MB */
+/* Maximum playlist line held while rewriting (prevent memory exhaustion);
+ * the body itself is rewritten as it arrives, whatever its size */
+#define REWRITE_MAX_LINE_SIZE (64 * 1024)
 
 /* Rewrite context - contains all information needed for URL rewriting */
 typedef struct {
@@ -26,6 +27,23 @@ typedef struct {
   const char *base_url; /* e.g., "http://router:5140/" or "/app/rtp2httpd/" */
 } rewrite_context_t;
 
+/**
+ * Output callback of the streaming rewriters
+ * @param opaque Caller's pointer
+ * @param data Rewritten bytes
+ * @param len Number of bytes
+ * @return 0 on success, -1 to stop rewriting
+ */
+typedef int (*rewrite_emit_fn)(void *opaque, const char *data, size_t len);
+
+/* Streaming M3U rewriter - only the line that is still incomplete is held */
+typedef struct {
+  rewrite_context_t ctx; /* Strings must outlive the stream */
+  char *line;            /* Partial line carried over to the next input */
+  size_t line_len;
+  size_t line_alloc;
+} rewrite_m3u_stream_t;
+
 /* ========== M3U/HLS Rewriting ========== */
 
 /**
@@ -44,19 +62,42 @@ int rewrite_is_m3u_url(const char *url);
 int rewrite_is_m3u_content_type(const char *content_type);
 
 /**
- * Rewrite all URLs in M3U content
- * Handles:
+ * Start rewriting an M3U body
+ * Rewrites all URLs line by line as the body arrives:
  * - http:// URLs -> proxy format
  * - Relative URLs -> absolute proxy format
  * - URI attributes in HLS tags (#EXT-X-KEY, #EXT-X-MAP, etc.)
  *
- * @param ctx Rewrite context
- * @param input Original M3U content (null-terminated)
- * @param output Pointer to receive rewritten content (malloc, caller must free)
- * @param output_size Pointer to receive output size
- * @return 0 on success, -1 on error
+ * @param stream Stream state to initialize
+ * @param ctx Rewrite context (copied; the strings it points to are not)
+ */
+void rewrite_m3u_stream_init(rewrite_m3u_stream_t *stream, const rewrite_context_t *ctx);
+
+/**
+ * Rewrite the next piece of an M3U body
+ * Complete lines are passed to emit, unchanged lines in runs straight from
+ * data; a trailing partial line is held until its newline arrives.
+ * @param stream Stream state
+ * @param data Body bytes (any split, need not be null-terminated)
+ * @param len Number of bytes
+ * @param emit Output callback
+ * @param opaque Passed to emit
+ * @return 0 on success, -1 if emit failed or a line exceeds REWRITE_MAX_LINE_SIZE
+ */
+int rewrite_m3u_stream_feed(rewrite_m3u_stream_t *stream, const char *data, size_t len, rewrite_emit_fn emit,
+                            void *opaque);
+
+/**
+ * End of the M3U body: rewrite a last line that has no newline
+ * @return 0 on success, -1 if emit failed
+ */
+int rewrite_m3u_stream_finish(rewrite_m3u_stream_t *stream, rewrite_emit_fn emit, void *opaque);
+
+/**
+ * Release the held line
+ * @param stream Stream state (initialized or zeroed)
  */
-int rewrite_m3u_content(const rewrite_context_t *ctx, const char *input, char **output, size_t *output_size);
+void rewrite_m3u_stream_free(rewrite_m3u_stream_t *stream);
 
 /* ========== Generic URL Rewriting Helpers ========== */
 
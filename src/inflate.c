@@ -0,0 +1,460 @@
+#include "inflate.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BITS 15      /* Longest deflate code */
+#define FAST_BITS 9      /* Codes up to this length decode with one lookup */
+#define MAX_LITLEN 288   /* Literal/length alphabet size */
+#define MAX_DIST 30      /* Distance alphabet size */
+#define MAX_CODELEN 19   /* Code length alphabet size */
+#define MAX_PAD_BYTES 16 /* Zero bytes a truncated stream may read past its end */
+
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+typedef struct {
+  uint16_t fast[1 << FAST_BITS]; /* (symbol << 4) | length, 0 for longer codes */
+  uint16_t count[MAX_BITS + 1];  /* Number of codes of each length */
+  uint16_t symbol[MAX_LITLEN];   /* Symbols ordered by code */
+} huffman_t;
+
+typedef struct {
+  const uint8_t *in;
+  size_t in_len;
+  size_t in_pos;
+  uint64_t bitbuf;
+  unsigned bitcnt;
+  unsigned pad; /* Zero bytes loaded into bitbuf past the end of the input */
+
+  /* Decoded data: the last INFLATE_WINDOW_SIZE bytes are kept for matches */
+  uint8_t window[2 * INFLATE_WINDOW_SIZE];
+  size_t pos;
+  size_t flushed;
+
+  uint32_t crc;
+  uint32_t member_size;
+  uint32_t crc_table[256];
+  inflate_sink_fn sink;
+  void *user_data;
+
+  huffman_t litlen;
+  huffman_t dist;
+} inflate_state_t;
+
+static const uint16_t length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                         31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                         2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                       33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                       1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t codelen_order[MAX_CODELEN] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static void crc32_init(uint32_t *table) {
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++)
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    table[n] = c;
+  }
+}
+
+static uint32_t crc32_update(const uint32_t *table, uint32_t crc, const uint8_t *data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+/* Make at least n bits available; past the end of input zeros are loaded
+ * so a final short code can still be looked up */
+static int need_bits(inflate_state_t *s, unsigned n) {
+  while (s->bitcnt < n) {
+    if (s->in_pos < s->in_len) {
+      s->bitbuf |= (uint64_t)s->in[s->in_pos++] << s->bitcnt;
+    } else if (++s->pad > MAX_PAD_BYTES) {
+      return -1;
+    }
+    s->bitcnt += 8;
+  }
+  return 0;
+}
+
+static int get_bits(inflate_state_t *s, unsigned n, unsigned *value) {
+  if (n == 0) {
+    *value = 0;
+    return 0;
+  }
+  if (need_bits(s, n) < 0)
+    return -1;
+  *value = (unsigned)(s->bitbuf & ((1u << n) - 1));
+  s->bitbuf >>= n;
+  s->bitcnt -= n;
+  return 0;
+}
+
+/* Drop the partial byte in bitbuf and hand whole buffered bytes back to the
+ * input, so byte-aligned data can be read directly */
+static int align_to_input(inflate_state_t *s) {
+  s->bitbuf >>= s->bitcnt & 7;
+  s->bitcnt -= s->bitcnt & 7;
+  if (s->bitcnt / 8 < s->pad)
+    return -1; /* Consumed bits that were never in the input */
+  s->in_pos -= s->bitcnt / 8 - s->pad;
+  s->bitbuf = 0;
+  s->bitcnt = 0;
+  s->pad = 0;
+  return 0;
+}
+
+static int flush_window(inflate_state_t *s) {
+  size_t len = s->pos - s->flushed;
+
+  if (len == 0)
+    return 0;
+  s->crc = crc32_update(s->crc_table, s->crc, s->window + s->flushed, len);
+  s->member_size += (uint32_t)len;
+  s->flushed = s->pos;
+  return s->sink(s->window + s->pos - len, len, s->user_data) != 0 ? -1 : 0;
+}
+
+static int put_byte(inflate_state_t *s, uint8_t b) {
+  if (s->pos == sizeof(s->window)) {
+    if (flush_window(s) < 0)
+      return -1;
+    memmove(s->window, s->window + INFLATE_WINDOW_SIZE, INFLATE_WINDOW_SIZE);
+    s->pos = INFLATE_WINDOW_SIZE;
+    s->flushed = INFLATE_WINDOW_SIZE;
+  }
+  s->window[s->pos++] = b;
+  return 0;
+}
+
+static uint16_t reverse_bits(uint16_t code, unsigned len) {
+  uint16_t r = 0;
+  for (unsigned i = 0; i < len; i++) {
+    r = (uint16_t)((r << 1) | (code & 1));
+    code >>= 1;
+  }
+  return r;
+}
+
+/* Build a canonical Huffman decoder; incomplete codes are accepted */
+static int huffman_build(huffman_t *h, const uint8_t *lengths, int n) {
+  uint16_t offsets[MAX_BITS + 2];
+  uint16_t next_code[MAX_BITS + 1];
+  int left = 1;
+
+  memset(h->count, 0, sizeof(h->count));
+  memset(h->fast, 0, sizeof(h->fast));
+  for (int sym = 0; sym < n; sym++)
+    h->count[lengths[sym]]++;
+  h->count[0] = 0;
+
+  for (int len = 1; len <= MAX_BITS; len++) {
+    left <<= 1;
+    left -= h->count[len];
+    if (left < 0)
+      return -1; /* Over-subscribed */
+  }
+
+  offsets[1] = 0;
+  for (int len = 1; len <= MAX_BITS; len++)
+    offsets[len + 1] = (uint16_t)(offsets[len] + h->count[len]);
+  for (int sym = 0; sym < n; sym++) {
+    if (lengths[sym])
+      h->symbol[offsets[lengths[sym]]++] = (uint16_t)sym;
+  }
+
+  uint16_t code = 0;
+  for (int len = 1; len <= MAX_BITS; len++) {
+    code = (uint16_t)((code + h->count[len - 1]) << 1);
+    next_code[len] = code;
+  }
+  for (int sym = 0; sym < n; sym++) {
+    unsigned len = lengths[sym];
+    if (len == 0)
+      continue;
+    uint16_t c = next_code[len]++;
+    if (len > FAST_BITS)
+      continue;
+    for (unsigned i = reverse_bits(c, len); i < (1u << FAST_BITS); i += 1u << len)
+      h->fast[i] = (uint16_t)((sym << 4) | len);
+  }
+  return 0;
+}
+
+static int huffman_decode(inflate_state_t *s, const huffman_t *h) {
+  if (need_bits(s, MAX_BITS) < 0)
+    return -1;
+
+  uint16_t entry = h->fast[s->bitbuf & ((1u << FAST_BITS) - 1)];
+  if (entry) {
+    s->bitbuf >>= entry & 15;
+    s->bitcnt -= entry & 15;
+    return entry >> 4;
+  }
+
+  /* Canonical decode one bit at a time for long codes */
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (unsigned len = 1; len <= MAX_BITS; len++) {
+    code |= (int)((s->bitbuf >> (len - 1)) & 1);
+    int count = h->count[len];
+    if (code - count < first) {
+      s->bitbuf >>= len;
+      s->bitcnt -= len;
+      return h->symbol[index + (code - first)];
+    }
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+static int inflate_stored(inflate_state_t *s) {
+  if (align_to_input(s) < 0 || s->in_len - s->in_pos < 4)
+    return -1;
+
+  unsigned len = s->in[s->in_pos] | (unsigned)s->in[s->in_pos + 1] << 8;
+  unsigned nlen = s->in[s->in_pos + 2] | (unsigned)s->in[s->in_pos + 3] << 8;
+  s->in_pos += 4;
+  if (len != (~nlen & 0xFFFF) || s->in_len - s->in_pos < len)
+    return -1;
+
+  while (len--) {
+    if (put_byte(s, s->in[s->in_pos++]) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+static int inflate_codes(inflate_state_t *s) {
+  for (;;) {
+    int sym = huffman_decode(s, &s->litlen);
+    if (sym < 0)
+      return -1;
+    if (sym < 256) {
+      if (put_byte(s, (uint8_t)sym) < 0)
+        return -1;
+      continue;
+    }
+    if (sym == 256)
+      return 0;
+
+    sym -= 257;
+    if (sym >= 29)
+      return -1;
+    unsigned extra;
+    if (get_bits(s, length_extra[sym], &extra) < 0)
+      return -1;
+    unsigned len = length_base[sym] + extra;
+
+    sym = huffman_decode(s, &s->dist);
+    if (sym < 0 || sym >= MAX_DIST)
+      return -1;
+    if (get_bits(s, dist_extra[sym], &extra) < 0)
+      return -1;
+    size_t dist = dist_base[sym] + extra;
+    if (dist > s->pos)
+      return -1; /* Reaches before the start of the member */
+
+    while (len--) {
+      /* put_byte may slide the window, so index relative to pos each time */
+      if (put_byte(s, s->window[s->pos - dist]) < 0)
+        return -1;
+    }
+  }
+}
+
+static int inflate_fixed(inflate_state_t *s) {
+  uint8_t lengths[MAX_LITLEN];
+  int sym = 0;
+
+  for (; sym < 144; sym++)
+    lengths[sym] = 8;
+  for (; sym < 256; sym++)
+    lengths[sym] = 9;
+  for (; sym < 280; sym++)
+    lengths[sym] = 7;
+  for (; sym < MAX_LITLEN; sym++)
+    lengths[sym] = 8;
+  if (huffman_build(&s->litlen, lengths, MAX_LITLEN) < 0)
+    return -1;
+
+  memset(lengths, 5, MAX_DIST);
+  if (huffman_build(&s->dist, lengths, MAX_DIST) < 0)
+    return -1;
+
+  return inflate_codes(s);
+}
+
+static int inflate_dynamic(inflate_state_t *s) {
+  uint8_t lengths[MAX_LITLEN + MAX_DIST];
+  unsigned nlen, ndist, ncode;
+
+  if (get_bits(s, 5, &nlen) < 0 || get_bits(s, 5, &ndist) < 0 || get_bits(s, 4, &ncode) < 0)
+    return -1;
+  nlen += 257;
+  ndist += 1;
+  ncode += 4;
+  if (nlen > MAX_LITLEN || ndist > MAX_DIST)
+    return -1;
+
+  memset(lengths, 0, MAX_CODELEN);
+  for (unsigned i = 0; i < ncode; i++) {
+    unsigned len;
+    if (get_bits(s, 3, &len) < 0)
+      return -1;
+    lengths[codelen_order[i]] = (uint8_t)len;
+  }
+  /* The code length code is decoded with the literal/length table */
+  if (huffman_build(&s->litlen, lengths, MAX_CODELEN) < 0)
+    return -1;
+
+  unsigned index = 0;
+  while (index < nlen + ndist) {
+    int sym = huffman_decode(s, &s->litlen);
+    unsigned repeat;
+    uint8_t value = 0;
+
+    if (sym < 0)
+      return -1;
+    if (sym < 16) {
+      lengths[index++] = (uint8_t)sym;
+      continue;
+    }
+    if (sym == 16) {
+      if (index == 0 || get_bits(s, 2, &repeat) < 0)
+        return -1;
+      value = lengths[index - 1];
+      repeat += 3;
+    } else if (sym == 17) {
+      if (get_bits(s, 3, &repeat) < 0)
+        return -1;
+      repeat += 3;
+    } else {
+      if (get_bits(s, 7, &repeat) < 0)
+        return -1;
+      repeat += 11;
+    }
+    if (index + repeat > nlen + ndist)
+      return -1;
+    memset(lengths + index, value, repeat);
+    index += repeat;
+  }
+
+  if (lengths[256] == 0)
+    return -1; /* No end-of-block code */
+  if (huffman_build(&s->litlen, lengths, (int)nlen) < 0 || huffman_build(&s->dist, lengths + nlen, (int)ndist) < 0)
+    return -1;
+
+  return inflate_codes(s);
+}
+
+static int inflate_member_body(inflate_state_t *s) {
+  unsigned last;
+
+  do {
+    unsigned type;
+    int ret;
+
+    if (get_bits(s, 1, &last) < 0 || get_bits(s, 2, &type) < 0)
+      return -1;
+    if (type == 0)
+      ret = inflate_stored(s);
+    else if (type == 1)
+      ret = inflate_fixed(s);
+    else if (type == 2)
+      ret = inflate_dynamic(s);
+    else
+      ret = -1;
+    if (ret < 0)
+      return -1;
+  } while (!last);
+
+  return align_to_input(s);
+}
+
+/* Skip a zero-terminated header field */
+static int skip_string(inflate_state_t *s) {
+  while (s->in_pos < s->in_len) {
+    if (s->in[s->in_pos++] == 0)
+      return 0;
+  }
+  return -1;
+}
+
+static int parse_gzip_header(inflate_state_t *s) {
+  const uint8_t *p = s->in + s->in_pos;
+
+  if (s->in_len - s->in_pos < 10 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8)
+    return -1;
+  uint8_t flags = p[3];
+  s->in_pos += 10;
+
+  if (flags & GZIP_FEXTRA) {
+    if (s->in_len - s->in_pos < 2)
+      return -1;
+    size_t xlen = s->in[s->in_pos] | (size_t)s->in[s->in_pos + 1] << 8;
+    s->in_pos += 2;
+    if (s->in_len - s->in_pos < xlen)
+      return -1;
+    s->in_pos += xlen;
+  }
+  if ((flags & GZIP_FNAME) && skip_string(s) < 0)
+    return -1;
+  if ((flags & GZIP_FCOMMENT) && skip_string(s) < 0)
+    return -1;
+  if (flags & GZIP_FHCRC) {
+    if (s->in_len - s->in_pos < 2)
+      return -1;
+    s->in_pos += 2;
+  }
+  return 0;
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+  return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int inflate_gzip(const uint8_t *in, size_t in_len, inflate_sink_fn sink, void *user_data) {
+  inflate_state_t *s = calloc(1, sizeof(*s));
+  int ret = 0;
+
+  if (!s)
+    return -1;
+  s->in = in;
+  s->in_len = in_len;
+  s->sink = sink;
+  s->user_data = user_data;
+  crc32_init(s->crc_table);
+
+  do {
+    s->pos = 0;
+    s->flushed = 0;
+    s->crc = 0;
+    s->member_size = 0;
+
+    if (parse_gzip_header(s) < 0 || inflate_member_body(s) < 0 || flush_window(s) < 0 ||
+        s->in_len - s->in_pos < 8) {
+      ret = -1;
+      break;
+    }
+    if (read_le32(s->in + s->in_pos) != s->crc || read_le32(s->in + s->in_pos + 4) != s->member_size) {
+      ret = -1;
+      break;
+    }
+    s->in_pos += 8;
+    /* Concatenated members decode as one stream; trailing garbage is ignored */
+  } while (s->in_len - s->in_pos >= 2 && s->in[s->in_pos] == 0x1f && s->in[s->in_pos + 1] == 0x8b);
+
+  free(s);
+  return ret;
+}
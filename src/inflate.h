@@ -0,0 +1,30 @@
+#ifndef __INFLATE_H__
+#define __INFLATE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Decoded bytes are handed to the sink in chunks of at most this size */
+#define INFLATE_WINDOW_SIZE 32768
+
+/**
+ * Receives decoded data
+ * @return 0 to continue, non-zero to abort decoding
+ */
+typedef int (*inflate_sink_fn)(const uint8_t *data, size_t len, void *user_data);
+
+/**
+ * Decode gzip data (RFC 1952, one or more members) held in memory
+ *
+ * Only a 64KB window is kept, so arbitrarily large archives can be consumed
+ * as a stream.  The CRC-32 and size of every member are verified.
+ *
+ * @param in Compressed data
+ * @param in_len Compressed size in bytes
+ * @param sink Callback receiving the decoded data
+ * @param user_data Passed to sink
+ * @return 0 on success, -1 on corrupt input, allocation failure or abort
+ */
+int inflate_gzip(const uint8_t *in, size_t in_len, inflate_sink_fn sink, void *user_data);
+
+#endif /* __INFLATE_H__ */
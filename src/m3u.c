@@ -9,6 +9,7 @@
 #include "utils.h"
 #include <arpa/inet.h>
 #include <ctype.h>
+#include <errno.h>
 #include <ifaddrs.h>
 #include <netinet/in.h>
 #include <stdio.h>
@@ -16,6 +17,7 @@
 #include <string.h>
 #include <strings.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #define MAX_M3U_LINE 4096
 #define MAX_SERVICE_NAME 256
@@ -1408,157 +1410,234 @@ const char *m3u_get_transformed_playlist(void) {
   return m3u_cache.transformed_m3u;
 }
 
-/* Generate complete M3U playlist dynamically based on request headers
+/* Build the #EXTM3U line that starts every served playlist, pointing
+ * x-tvg-url at our EPG endpoint when an EPG is configured
  * Returns malloc'd string, caller must free
  */
-char *m3u_generate_playlist(const char *host_header, const char *x_forwarded_host, const char *x_forwarded_proto) {
-  const char *half_transformed = m3u_cache.transformed_m3u;
-  size_t half_size = m3u_cache.transformed_m3u_used;
-  char *base_url = NULL;
-  char *result = NULL;
-  size_t result_size;
-  size_t result_used = 0;
-  const char *src_ptr;
-  char *dst_ptr;
-  epg_cache_t *epg;
+static char *format_playlist_header(const char *base_url) {
+  epg_cache_t *epg = epg_get_cache();
+  char *encoded_token = NULL;
+  char *header;
+  int len;
 
-  /* Check if we have content to serve */
-  if (!half_transformed || half_size == 0) {
-    return NULL;
+  if (!epg || !epg->url) {
+    return strdup("#EXTM3U\n\n");
   }
 
-  /* Build base URL based on headers and xff config */
-  base_url = build_proxy_base_url(host_header, x_forwarded_host, x_forwarded_proto);
-  if (!base_url) {
-    logger(LOG_ERROR, "Failed to build base URL for M3U generation");
-    return NULL;
+  /* URL encode r2h-token if configured */
+  if (config.r2h_token && config.r2h_token[0] != '\0') {
+    encoded_token = http_url_encode(config.r2h_token);
+    if (!encoded_token) {
+      logger(LOG_ERROR, "Failed to URL encode r2h-token for EPG URL");
+      /* Continue without token */
+    }
   }
 
-  logger(LOG_DEBUG, "Generating M3U with base URL: %s", base_url);
+  len = snprintf(NULL, 0, "#EXTM3U x-tvg-url=\"%sepg.xml%s%s%s\"\n\n", base_url, epg->is_gzipped ? ".gz" : "",
+                 encoded_token ? "?r2h-token=" : "", encoded_token ? encoded_token : "");
+  header = len >= 0 ? malloc((size_t)len + 1) : NULL;
+  if (header) {
+    snprintf(header, (size_t)len + 1, "#EXTM3U x-tvg-url=\"%sepg.xml%s%s%s\"\n\n", base_url,
+             epg->is_gzipped ? ".gz" : "", encoded_token ? "?r2h-token=" : "", encoded_token ? encoded_token : "");
+  }
+
+  free(encoded_token);
+  return header;
+}
 
-  /* Calculate result size: header + EPG line + content with replacements
-   * Estimate: assume worst case where every placeholder gets replaced */
+/* Render header + half-transformed playlist with every placeholder replaced
+ * by base_url
+ * Returns malloc'd NUL-terminated string, caller must free
+ */
+static char *render_playlist(const char *base_url, const char *header, size_t *len_out) {
+  const char *half_transformed = m3u_cache.transformed_m3u;
   size_t base_url_len = strlen(base_url);
+  size_t header_len = strlen(header);
   size_t placeholder_len = strlen(M3U_BASE_URL_PLACEHOLDER);
-  size_t max_replacements = half_size / placeholder_len + 1;
-  size_t header_size = 512; /* Space for #EXTM3U and EPG URL */
-  result_size = header_size + half_size + (max_replacements * base_url_len) + 1;
+  size_t replacements = 0;
+  size_t result_size;
+  const char *src_ptr;
+  const char *next;
+  char *result;
+  char *dst_ptr;
+
+  /* Count placeholders first so the result is allocated exactly once */
+  for (src_ptr = half_transformed; (next = strstr(src_ptr, M3U_BASE_URL_PLACEHOLDER)) != NULL;
+       src_ptr = next + placeholder_len) {
+    replacements++;
+  }
+
+  result_size = header_len + strlen(half_transformed) - replacements * placeholder_len + replacements * base_url_len + 1;
 
   result = malloc(result_size);
   if (!result) {
     logger(LOG_ERROR, "Failed to allocate result buffer for M3U generation");
-    free(base_url);
     return NULL;
   }
 
-  dst_ptr = result;
+  memcpy(result, header, header_len);
+  dst_ptr = result + header_len;
 
-  /* Add #EXTM3U header */
-  epg = epg_get_cache();
-  if (epg && epg->url) {
-    /* Add header with EPG URL */
-    int written;
-    int has_r2h_token = (config.r2h_token && config.r2h_token[0] != '\0');
-    char *encoded_token = NULL;
+  /* Copy half-transformed content span by span, replacing placeholders */
+  for (src_ptr = half_transformed; (next = strstr(src_ptr, M3U_BASE_URL_PLACEHOLDER)) != NULL;
+       src_ptr = next + placeholder_len) {
+    memcpy(dst_ptr, src_ptr, (size_t)(next - src_ptr));
+    dst_ptr += next - src_ptr;
+    memcpy(dst_ptr, base_url, base_url_len);
+    dst_ptr += base_url_len;
+  }
+  size_t tail_len = strlen(src_ptr);
+  memcpy(dst_ptr, src_ptr, tail_len);
+  dst_ptr += tail_len;
 
-    /* URL encode r2h-token if configured */
-    if (has_r2h_token) {
-      encoded_token = http_url_encode(config.r2h_token);
-      if (!encoded_token) {
-        logger(LOG_ERROR, "Failed to URL encode r2h-token for EPG URL");
-        /* Continue without token */
-        has_r2h_token = 0;
-      }
-    }
+  /* Null terminate */
+  *dst_ptr = '\0';
 
-    if (has_r2h_token && encoded_token) {
-      /* Include r2h-token in EPG URL */
-      if (epg->is_gzipped) {
-        written = snprintf(dst_ptr, result_size - result_used, "#EXTM3U x-tvg-url=\"%sepg.xml.gz?r2h-token=%s\"\n\n",
-                           base_url, encoded_token);
-      } else {
-        written = snprintf(dst_ptr, result_size - result_used, "#EXTM3U x-tvg-url=\"%sepg.xml?r2h-token=%s\"\n\n",
-                           base_url, encoded_token);
-      }
-    } else {
-      /* No token, just basic EPG URL */
-      if (epg->is_gzipped) {
-        written = snprintf(dst_ptr, result_size - result_used, "#EXTM3U x-tvg-url=\"%sepg.xml.gz\"\n\n", base_url);
-      } else {
-        written = snprintf(dst_ptr, result_size - result_used, "#EXTM3U x-tvg-url=\"%sepg.xml\"\n\n", base_url);
-      }
-    }
+  *len_out = (size_t)(dst_ptr - result);
+  return result;
+}
 
-    if (written > 0) {
-      dst_ptr += written;
-      result_used += written;
-    }
+/* Rendered playlists of this event loop, one per base URL / EPG header
+ * variant.  Entries rendered from an older ETag are dropped on lookup. */
+typedef struct {
+  char *key;         /* Base URL and header, NULL when the slot is unused */
+  char etag[33];     /* ETag of the half-transformed playlist it came from */
+  int fd;            /* Unlinked file holding the rendered playlist */
+  size_t size;       /* Rendered size in bytes */
+  uint64_t last_use; /* LRU clock value of the last hit */
+} m3u_rendered_entry_t;
+
+static _Thread_local m3u_rendered_entry_t rendered_entries[M3U_RENDERED_CACHE_ENTRIES];
+static _Thread_local uint64_t rendered_clock = 0;
+
+static void rendered_entry_free(m3u_rendered_entry_t *entry) {
+  if (!entry->key)
+    return;
+  free(entry->key);
+  entry->key = NULL;
+  close(entry->fd);
+  entry->fd = -1;
+}
 
-    if (encoded_token) {
-      free(encoded_token);
-    }
-  } else {
-    /* No EPG, just add basic header */
-    int written = snprintf(dst_ptr, result_size - result_used, "#EXTM3U\n\n");
-    if (written > 0) {
-      dst_ptr += written;
-      result_used += written;
+/* Write a rendered playlist to an unlinked tmpfs file */
+static int write_rendered_file(const char *data, size_t len) {
+  char temp_file_template[] = "/tmp/rtp2httpd_playlist_XXXXXX";
+  size_t written = 0;
+  int fd = mkstemp(temp_file_template);
+
+  if (fd < 0) {
+    logger(LOG_ERROR, "Failed to create temporary file for rendered playlist: %s", strerror(errno));
+    return -1;
+  }
+  unlink(temp_file_template);
+
+  while (written < len) {
+    ssize_t n = write(fd, data + written, len - written);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      logger(LOG_ERROR, "Failed to write rendered playlist: %s", strerror(errno));
+      close(fd);
+      return -1;
     }
+    written += (size_t)n;
   }
+  return fd;
+}
 
-  /* Copy half-transformed content while replacing placeholders */
-  src_ptr = half_transformed;
-  while (*src_ptr) {
-    /* Check if we're at a placeholder */
-    if (strncmp(src_ptr, M3U_BASE_URL_PLACEHOLDER, placeholder_len) == 0) {
-      /* Replace with base URL */
-      size_t remaining = result_size - result_used;
-      if (base_url_len >= remaining) {
-        /* Need to grow buffer */
-        size_t new_size = result_size * 2;
-        char *new_result = realloc(result, new_size);
-        if (!new_result) {
-          logger(LOG_ERROR, "Failed to grow result buffer");
-          free(result);
-          free(base_url);
-          return NULL;
-        }
-        result = new_result;
-        result_size = new_size;
-        dst_ptr = result + result_used;
-      }
+int m3u_open_rendered_playlist(const char *host_header, const char *x_forwarded_host, const char *x_forwarded_proto,
+                               int *fd_out, size_t *size_out) {
+  m3u_rendered_entry_t *entry = NULL;
+  m3u_rendered_entry_t *slot = NULL;
+  const char *etag;
+  char *base_url;
+  char *header;
+  char *key = NULL;
+
+  etag = m3u_get_etag();
+  if (!etag) {
+    return -1;
+  }
 
-      memcpy(dst_ptr, base_url, base_url_len);
-      dst_ptr += base_url_len;
-      result_used += base_url_len;
-      src_ptr += placeholder_len;
-    } else {
-      /* Copy character as-is */
-      if (result_used >= result_size - 1) {
-        /* Need to grow buffer */
-        size_t new_size = result_size * 2;
-        char *new_result = realloc(result, new_size);
-        if (!new_result) {
-          logger(LOG_ERROR, "Failed to grow result buffer");
-          free(result);
-          free(base_url);
-          return NULL;
-        }
-        result = new_result;
-        result_size = new_size;
-        dst_ptr = result + result_used;
-      }
+  /* Build base URL based on headers and xff config */
+  base_url = build_proxy_base_url(host_header, x_forwarded_host, x_forwarded_proto);
+  if (!base_url) {
+    logger(LOG_ERROR, "Failed to build base URL for M3U generation");
+    return -1;
+  }
 
-      *dst_ptr++ = *src_ptr++;
-      result_used++;
+  /* The header also depends on EPG and r2h-token state, so it is part of the key */
+  header = format_playlist_header(base_url);
+  if (header) {
+    size_t key_len = strlen(base_url) + strlen(header) + 2;
+    key = malloc(key_len);
+    if (key)
+      snprintf(key, key_len, "%s\n%s", base_url, header);
+  }
+  if (!key) {
+    logger(LOG_ERROR, "Failed to allocate rendered playlist key");
+    free(header);
+    free(base_url);
+    return -1;
+  }
+
+  for (int i = 0; i < M3U_RENDERED_CACHE_ENTRIES; i++) {
+    m3u_rendered_entry_t *e = &rendered_entries[i];
+    if (e->key && strcmp(e->etag, etag) != 0)
+      rendered_entry_free(e);
+    if (!e->key) {
+      if (!slot || slot->key)
+        slot = e;
+    } else if (strcmp(e->key, key) == 0) {
+      entry = e;
+    } else if (!slot || (slot->key && e->last_use < slot->last_use)) {
+      slot = e;
     }
   }
 
-  /* Null terminate */
-  *dst_ptr = '\0';
+  if (!entry) {
+    size_t len;
+    char *rendered = render_playlist(base_url, header, &len);
+    int fd = rendered ? write_rendered_file(rendered, len) : -1;
+
+    free(rendered);
+    if (fd < 0) {
+      free(key);
+      free(header);
+      free(base_url);
+      return -1;
+    }
+
+    logger(LOG_DEBUG, "Rendered M3U with base URL: %s (%zu bytes)", base_url, len);
+
+    entry = slot;
+    rendered_entry_free(entry);
+    entry->key = key;
+    key = NULL;
+    memcpy(entry->etag, etag, sizeof(entry->etag));
+    entry->fd = fd;
+    entry->size = len;
+  }
 
+  free(key);
+  free(header);
   free(base_url);
-  return result;
+
+  entry->last_use = ++rendered_clock;
+
+  /* The zero-copy queue closes its fd once sent */
+  *fd_out = dup(entry->fd);
+  if (*fd_out < 0) {
+    logger(LOG_ERROR, "Failed to dup rendered playlist fd: %s", strerror(errno));
+    return -1;
+  }
+  *size_out = entry->size;
+  return 0;
+}
+
+void m3u_rendered_cache_cleanup(void) {
+  for (int i = 0; i < M3U_RENDERED_CACHE_ENTRIES; i++)
+    rendered_entry_free(&rendered_entries[i]);
 }
 
 const char *m3u_get_etag(void) {
@@ -1654,11 +1733,20 @@ static void m3u_process_and_fetch_epg(const char *m3u_content, const char *sourc
 static void m3u_reload_async_callback(http_fetch_ctx_t *ctx, char *content, size_t content_size, void *user_data) {
   int epfd;
 
-  (void)ctx;          /* Unused */
   (void)content_size; /* Unused */
 
   epfd = (int)(intptr_t)user_data; /* Retrieve epfd from user_data */
 
+  if (!content && http_fetch_not_modified(ctx)) {
+    /* Services from the last load stay; the EPG is still revalidated */
+    m3u_cache.retry_count = 0;
+    m3u_cache.next_retry_time = 0;
+    logger(LOG_INFO, "External M3U not modified, keeping current services");
+    if (epg_get_cache()->url && epfd >= 0)
+      epg_fetch_async(epfd);
+    return;
+  }
+
   if (!content) {
     /* Schedule retry if we haven't exceeded max retries */
     if (m3u_cache.retry_count < M3U_MAX_RETRY_COUNT) {
@@ -1719,7 +1807,8 @@ int m3u_reload_external_async(int epfd) {
   /* Start async fetch - supports both HTTP(S) and file:// URLs
    * Note: file:// URLs complete synchronously and return NULL (callback already
    * invoked) */
-  fetch_ctx = http_fetch_start_async(config.external_m3u_url, m3u_reload_async_callback, (void *)(intptr_t)epfd, epfd);
+  fetch_ctx = http_fetch_start_async(config.external_m3u_url, &m3u_cache.fetch_validators, m3u_reload_async_callback,
+                                     (void *)(intptr_t)epfd, epfd);
 
   /* NULL return value can mean:
    * 1. file:// URL completed synchronously (callback already called) - SUCCESS
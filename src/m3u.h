@@ -1,6 +1,7 @@
 #ifndef __M3U_H__
 #define __M3U_H__
 
+#include "http_fetch.h"
 #include <stdint.h>
 #include <stdio.h>
 
@@ -9,6 +10,10 @@ typedef struct {
   int retry_count;         /* Current retry count (0-8) */
   int64_t next_retry_time; /* Next retry time in milliseconds (0 if not retrying) */
 
+  /* Validators of the loaded external M3U, so an unchanged playlist is not
+   * downloaded or parsed again */
+  http_fetch_validators_t fetch_validators;
+
   /* Transformed M3U playlist buffer */
   char *transformed_m3u;             /* Dynamic buffer for transformed playlist */
   size_t transformed_m3u_size;       /* Total allocated size */
@@ -40,14 +45,22 @@ int m3u_is_header(const char *line);
  */
 const char *m3u_get_transformed_playlist(void);
 
-/* Generate complete M3U playlist dynamically based on request headers
- * host_header: HTTP Host header (can be NULL)
- * x_forwarded_host: X-Forwarded-Host header (can be NULL, only used when
- * xff=yes) x_forwarded_proto: X-Forwarded-Proto header (can be NULL, only used
- * when xff=yes) Returns: malloc'd complete M3U content with header and replaced
- * placeholders, caller must free
+/* Rendered playlists kept per event loop; the least recently used is
+ * replaced first */
+#define M3U_RENDERED_CACHE_ENTRIES 8
+
+/* Open the complete M3U playlist for a request as an unlinked file
+ * The playlist is rendered once per base URL (and EPG header) and ETag and
+ * then served from the event loop's cache until the ETag changes.
+ * fd_out: receives a descriptor the caller owns (suitable for sendfile)
+ * size_out: receives the playlist size in bytes
+ * Returns: 0 on success, -1 if no playlist is available or on error
  */
-char *m3u_generate_playlist(const char *host_header, const char *x_forwarded_host, const char *x_forwarded_proto);
+int m3u_open_rendered_playlist(const char *host_header, const char *x_forwarded_host, const char *x_forwarded_proto,
+                               int *fd_out, size_t *size_out);
+
+/* Release the rendered playlists of this event loop */
+void m3u_rendered_cache_cleanup(void);
 
 /* Get the ETag for the current transformed M3U playlist
  * Returns: ETag string (static buffer), or NULL if no playlist
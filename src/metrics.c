@@ -0,0 +1,484 @@
+#include "metrics.h"
+#include "buffer_pool.h"
+#include "configuration.h"
+#include "connection.h"
+#include "http.h"
+#include "rtp2httpd.h"
+#include "status.h"
+#include "utils.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define METRICS_CONTENT_TYPE_OPENMETRICS "application/openmetrics-text; version=1.0.0; charset=utf-8"
+#define METRICS_CONTENT_TYPE_TEXT "text/plain; version=0.0.4; charset=utf-8"
+
+/* Longest single line of the exposition */
+#define METRICS_LINE_SIZE 512
+
+/* Service types clients are grouped by (names from service_type_name()) */
+#define METRICS_SERVICE_TYPES 3
+static const char *const metrics_service_types[METRICS_SERVICE_TYPES] = {"rtp", "rtsp", "http"};
+
+/* Histogram bucket upper bounds; +Inf is implied */
+#define METRICS_QUEUE_BUCKETS 6
+static const uint64_t metrics_queue_bounds[METRICS_QUEUE_BUCKETS] = {0, 16384, 65536, 262144, 1048576, 4194304};
+
+/* 1, 5, 10, 20, 40 and 80 Mbit/s */
+#define METRICS_BANDWIDTH_BUCKETS 6
+static const uint64_t metrics_bandwidth_bounds[METRICS_BANDWIDTH_BUCKETS] = {125000,  625000,  1250000,
+                                                                               2500000, 5000000, 10000000};
+
+typedef enum { METRIC_COUNTER, METRIC_GAUGE, METRIC_GAUGE_HISTOGRAM, METRIC_INFO } metric_type_t;
+
+/* Exposition being rendered into a chain of pool buffers */
+typedef struct {
+  buffer_ref_t *buffers[METRICS_MAX_BUFFERS];
+  size_t buffer_count;
+  size_t length;
+  int failed;
+  int openmetrics; /* OpenMetrics rather than Prometheus 0.0.4 text */
+} metrics_writer_t;
+
+/* Clients of one service type on one worker */
+typedef struct {
+  uint32_t clients;
+  uint32_t slow_clients;
+  uint64_t bytes_sent;
+  uint64_t dropped_packets;
+  uint64_t dropped_bytes;
+  uint64_t backpressure_events;
+  uint64_t rtp_expected;
+  uint64_t rtp_lost;
+  uint64_t queue_bytes_sum;
+  uint64_t bandwidth_sum;
+  uint32_t queue_buckets[METRICS_QUEUE_BUCKETS + 1]; /* Per bucket, last one is +Inf */
+  uint32_t bandwidth_buckets[METRICS_BANDWIDTH_BUCKETS + 1];
+} metrics_client_group_t;
+
+/* Per-worker counters and gauges exported as-is */
+typedef struct {
+  const char *name;
+  metric_type_t type;
+  size_t offset;
+  int is_u32;
+  const char *help;
+} metrics_worker_field_t;
+
+#define WORKER_U64(name, type, field, help) {name, type, offsetof(worker_stats_t, field), 0, help}
+#define WORKER_U32(name, type, field, help) {name, type, offsetof(worker_stats_t, field), 1, help}
+
+static const metrics_worker_field_t metrics_worker_fields[] = {
+    WORKER_U64("rtp2httpd_send_calls", METRIC_COUNTER, total_sends, "sendmsg() calls on client sockets"),
+    WORKER_U64("rtp2httpd_send_zerocopy_completions", METRIC_COUNTER, total_completions,
+               "MSG_ZEROCOPY completions"),
+    WORKER_U64("rtp2httpd_send_copied", METRIC_COUNTER, total_copied,
+               "Zero-copy sends the kernel completed by copying"),
+    WORKER_U64("rtp2httpd_send_eagain", METRIC_COUNTER, eagain_count, "Sends that failed with EAGAIN"),
+    WORKER_U64("rtp2httpd_send_enobufs", METRIC_COUNTER, enobufs_count, "Sends that failed with ENOBUFS"),
+    WORKER_U64("rtp2httpd_send_batches", METRIC_COUNTER, batch_sends, "Sends triggered by the batch size threshold"),
+    WORKER_U64("rtp2httpd_accepts", METRIC_COUNTER, accepts, "Accepted client connections"),
+    WORKER_U64("rtp2httpd_cross_cpu_accepts", METRIC_COUNTER, cross_cpu_accepts,
+               "Accepts whose SYN was handled on another CPU"),
+    WORKER_U64("rtp2httpd_http_requests", METRIC_COUNTER, http_requests, "Requests parsed on client connections"),
+    WORKER_U64("rtp2httpd_http_keepalive_reuses", METRIC_COUNTER, http_keepalive_reuses,
+               "Requests that arrived on an already used connection"),
+    WORKER_U64("rtp2httpd_http_pipelined", METRIC_COUNTER, http_pipelined,
+               "Requests already buffered when the previous response finished"),
+    WORKER_U64("rtp2httpd_http_idle_timeouts", METRIC_COUNTER, http_idle_timeouts,
+               "Persistent connections closed after idling"),
+    WORKER_U64("rtp2httpd_http_upstream_reuses", METRIC_COUNTER, http_upstream_reuses,
+               "Proxied requests sent on an idle upstream connection"),
+    WORKER_U64("rtp2httpd_http_upstream_connects", METRIC_COUNTER, http_upstream_connects,
+               "Proxied requests that opened a new upstream connection"),
+    WORKER_U32("rtp2httpd_http_upstream_idle", METRIC_GAUGE, http_upstream_idle,
+               "Idle upstream connections kept for reuse"),
+    WORKER_U64("rtp2httpd_http_segment_cache_hits", METRIC_COUNTER, http_segment_hits,
+               "HLS segment requests answered from the segment cache"),
+    WORKER_U64("rtp2httpd_http_segment_coalesced", METRIC_COUNTER, http_segment_coalesced,
+               "HLS segment requests that joined another client's download"),
+    WORKER_U32("rtp2httpd_http_segment_cached", METRIC_GAUGE, http_segment_cached,
+               "HLS segments held in the segment cache"),
+    WORKER_U64("rtp2httpd_http_segment_cache_bytes", METRIC_GAUGE, http_segment_cache_bytes,
+               "Bytes of the cached HLS segments"),
+    WORKER_U64("rtp2httpd_access_log_records", METRIC_COUNTER, access_log_records,
+               "Access log lines queued for writing"),
+    WORKER_U64("rtp2httpd_access_log_dropped", METRIC_COUNTER, access_log_dropped,
+               "Access log lines dropped because the writer fell behind"),
+    WORKER_U64("rtp2httpd_log_dropped", METRIC_COUNTER, log_dropped,
+               "Log messages dropped because the supervisor fell behind"),
+    WORKER_U64("rtp2httpd_log_suppressed", METRIC_COUNTER, log_suppressed,
+               "Log messages collapsed by the per-call-site rate limit"),
+    WORKER_U64("rtp2httpd_rtsp_share_joins", METRIC_COUNTER, rtsp_share_joins,
+               "Clients served by an already running upstream RTSP session"),
+    WORKER_U64("rtp2httpd_rtsp_fast_starts", METRIC_COUNTER, rtsp_fast_starts,
+               "RTSP sessions that skipped OPTIONS and DESCRIBE using a cached DESCRIBE"),
+    WORKER_U64("rtp2httpd_fcc_socket_pool_hits", METRIC_COUNTER, fcc_socket_pool_hits,
+               "FCC sessions started on a pre-bound socket"),
+    WORKER_U64("rtp2httpd_fcc_socket_pool_misses", METRIC_COUNTER, fcc_socket_pool_misses,
+               "FCC sessions that had to bind a new socket"),
+    WORKER_U32("rtp2httpd_fcc_socket_pool_idle", METRIC_GAUGE, fcc_socket_pool_idle,
+               "Pre-bound FCC sockets (or socket pairs) waiting for a session"),
+    WORKER_U64("rtp2httpd_dns_queries", METRIC_COUNTER, dns_queries, "Host name resolutions requested"),
+    WORKER_U64("rtp2httpd_dns_cache_hits", METRIC_COUNTER, dns_cache_hits,
+               "Resolutions answered from /etc/hosts or the resolver cache"),
+    WORKER_U64("rtp2httpd_dns_lookups", METRIC_COUNTER, dns_lookups, "Lookups sent to nameservers"),
+    WORKER_U64("rtp2httpd_dns_failures", METRIC_COUNTER, dns_failures, "Lookups that found no address"),
+    WORKER_U64("rtp2httpd_snapshot_jobs", METRIC_COUNTER, snapshot_jobs, "Successful snapshot conversions"),
+    WORKER_U64("rtp2httpd_snapshot_failures", METRIC_COUNTER, snapshot_failures,
+               "Failed or cancelled snapshot conversions"),
+    WORKER_U64("rtp2httpd_snapshot_timeouts", METRIC_COUNTER, snapshot_timeouts,
+               "Snapshot requests that hit the conversion timeout"),
+    WORKER_U64("rtp2httpd_snapshot_rejects", METRIC_COUNTER, snapshot_rejects,
+               "Snapshot requests rejected because the queue was full"),
+    WORKER_U32("rtp2httpd_snapshot_decoders", METRIC_GAUGE, snapshot_decoders, "Running snapshot decoders"),
+    WORKER_U32("rtp2httpd_snapshot_queue_length", METRIC_GAUGE, snapshot_queue_len,
+               "Snapshot requests waiting for a decoder"),
+};
+
+static int metrics_append(metrics_writer_t *w, const char *data, size_t len) {
+  while (len > 0 && !w->failed) {
+    buffer_ref_t *buf_ref = w->buffer_count ? w->buffers[w->buffer_count - 1] : NULL;
+
+    if (!buf_ref || buf_ref->data_size == BUFFER_POOL_BUFFER_SIZE) {
+      /* Control buffers only: a scrape must not eat into the media pool */
+      if (w->buffer_count == METRICS_MAX_BUFFERS || !(buf_ref = buffer_pool_alloc_control())) {
+        w->failed = 1;
+        break;
+      }
+      buf_ref->data_size = 0;
+      w->buffers[w->buffer_count++] = buf_ref;
+    }
+
+    size_t chunk = BUFFER_POOL_BUFFER_SIZE - buf_ref->data_size;
+    if (chunk > len)
+      chunk = len;
+    memcpy((uint8_t *)buf_ref->data + buf_ref->data_size, data, chunk);
+    buf_ref->data_size += chunk;
+    w->length += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+
+  return w->failed ? -1 : 0;
+}
+
+static int metrics_printf(metrics_writer_t *w, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static int metrics_printf(metrics_writer_t *w, const char *format, ...) {
+  char line[METRICS_LINE_SIZE];
+  va_list args;
+
+  va_start(args, format);
+  int n = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+
+  if (n < 0 || (size_t)n >= sizeof(line)) {
+    w->failed = 1;
+    return -1;
+  }
+  return metrics_append(w, line, (size_t)n);
+}
+
+/* Counters are sampled as <name>_total; the 0.0.4 format names the family
+ * after the sample, OpenMetrics after the metric */
+static void metrics_family(metrics_writer_t *w, const char *name, metric_type_t type, const char *help) {
+  const char *suffix = "";
+  const char *type_name = "gauge";
+
+  switch (type) {
+  case METRIC_COUNTER:
+    type_name = "counter";
+    if (!w->openmetrics)
+      suffix = "_total";
+    break;
+  case METRIC_GAUGE_HISTOGRAM:
+    type_name = w->openmetrics ? "gaugehistogram" : "histogram";
+    break;
+  case METRIC_INFO:
+    type_name = w->openmetrics ? "info" : "gauge";
+    if (!w->openmetrics)
+      suffix = "_info";
+    break;
+  default:
+    break;
+  }
+
+  metrics_printf(w, "# TYPE %s%s %s\n# HELP %s%s %s\n", name, suffix, type_name, name, suffix, help);
+}
+
+static void metrics_histogram(metrics_writer_t *w, const char *name, int worker, const char *service_type,
+                              const uint64_t *bounds, const uint32_t *buckets, int bucket_count, uint64_t sum) {
+  uint64_t cumulative = 0;
+
+  for (int i = 0; i <= bucket_count; i++) {
+    cumulative += buckets[i];
+    if (i < bucket_count)
+      metrics_printf(w, "%s_bucket{worker=\"%d\",service_type=\"%s\",le=\"%llu.0\"} %llu\n", name, worker,
+                     service_type, (unsigned long long)bounds[i], (unsigned long long)cumulative);
+    else
+      metrics_printf(w, "%s_bucket{worker=\"%d\",service_type=\"%s\",le=\"+Inf\"} %llu\n", name, worker, service_type,
+                     (unsigned long long)cumulative);
+  }
+  metrics_printf(w, "%s_%s{worker=\"%d\",service_type=\"%s\"} %llu\n", name, w->openmetrics ? "gcount" : "count",
+                 worker, service_type, (unsigned long long)cumulative);
+  metrics_printf(w, "%s_%s{worker=\"%d\",service_type=\"%s\"} %llu\n", name, w->openmetrics ? "gsum" : "sum", worker,
+                 service_type, (unsigned long long)sum);
+}
+
+static int metrics_bucket(const uint64_t *bounds, int bucket_count, uint64_t value) {
+  int i = 0;
+  while (i < bucket_count && value > bounds[i])
+    i++;
+  return i;
+}
+
+static int metrics_service_type_index(const char *name) {
+  for (int i = 0; i < METRICS_SERVICE_TYPES; i++) {
+    if (strcmp(name, metrics_service_types[i]) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static void metrics_render(metrics_writer_t *w) {
+  metrics_client_group_t groups[STATUS_MAX_WORKERS][METRICS_SERVICE_TYPES];
+  uint64_t worker_bytes[STATUS_MAX_WORKERS];
+  int workers = config.workers < STATUS_MAX_WORKERS ? config.workers : STATUS_MAX_WORKERS;
+
+  memset(groups, 0, sizeof(groups));
+  memset(worker_bytes, 0, sizeof(worker_bytes));
+
+  for (int i = 0; i < STATUS_MAX_CLIENTS; i++) {
+    client_stats_payload_t client;
+    if (!status_snapshot_client(i, &client) || client.service_url[0] == '\0')
+      continue;
+
+    int worker = client.worker_index;
+    int type = metrics_service_type_index(client.service_type);
+    if (worker < 0 || worker >= STATUS_MAX_WORKERS || type < 0)
+      continue;
+
+    metrics_client_group_t *g = &groups[worker][type];
+    g->clients++;
+    if (client.slow_active)
+      g->slow_clients++;
+    g->bytes_sent += client.bytes_sent;
+    g->dropped_packets += client.dropped_packets;
+    g->dropped_bytes += client.dropped_bytes;
+    g->backpressure_events += client.backpressure_events;
+    g->rtp_expected += client.rtp_expected;
+    g->rtp_lost += client.rtp_lost;
+    g->queue_bytes_sum += client.queue_bytes;
+    g->bandwidth_sum += client.current_bandwidth;
+    g->queue_buckets[metrics_bucket(metrics_queue_bounds, METRICS_QUEUE_BUCKETS, client.queue_bytes)]++;
+    g->bandwidth_buckets[metrics_bucket(metrics_bandwidth_bounds, METRICS_BANDWIDTH_BUCKETS,
+                                        client.current_bandwidth)]++;
+    worker_bytes[worker] += client.bytes_sent;
+  }
+
+  metrics_family(w, "rtp2httpd_build", METRIC_INFO, "Server version");
+  metrics_printf(w, "rtp2httpd_build_info{version=\"%s\"} 1\n", VERSION);
+  metrics_family(w, "rtp2httpd_start_time_seconds", METRIC_GAUGE, "Server start time since the Unix epoch");
+  metrics_printf(w, "rtp2httpd_start_time_seconds %lld.%03lld\n", (long long)(status_shared->server_start_time / 1000),
+                 (long long)(status_shared->server_start_time % 1000));
+  metrics_family(w, "rtp2httpd_max_clients", METRIC_GAUGE, "Configured client limit");
+  metrics_printf(w, "rtp2httpd_max_clients %d\n", config.maxclients);
+
+  /* Bytes of finished clients plus those of the clients still streaming */
+  metrics_family(w, "rtp2httpd_sent_bytes", METRIC_COUNTER, "Media bytes sent to clients");
+  for (int i = 0; i < workers; i++)
+    metrics_printf(w, "rtp2httpd_sent_bytes_total{worker=\"%d\"} %llu\n", i,
+                   (unsigned long long)(status_shared->client_bytes_cumulative[i] + worker_bytes[i]));
+
+  for (size_t f = 0; f < sizeof(metrics_worker_fields) / sizeof(metrics_worker_fields[0]); f++) {
+    const metrics_worker_field_t *field = &metrics_worker_fields[f];
+    metrics_family(w, field->name, field->type, field->help);
+    for (int i = 0; i < workers; i++) {
+      const uint8_t *ws = (const uint8_t *)&status_shared->worker_stats[i];
+      uint64_t value;
+      if (field->is_u32) {
+        uint32_t v32;
+        memcpy(&v32, ws + field->offset, sizeof(v32));
+        value = v32;
+      } else {
+        memcpy(&value, ws + field->offset, sizeof(value));
+      }
+      metrics_printf(w, "%s%s{worker=\"%d\"} %llu\n", field->name, field->type == METRIC_COUNTER ? "_total" : "", i,
+                     (unsigned long long)value);
+    }
+  }
+
+  /* Media and control buffer pools */
+  metrics_family(w, "rtp2httpd_buffer_pool_buffers", METRIC_GAUGE, "Buffers allocated by a pool");
+  for (int i = 0; i < workers; i++) {
+    const worker_stats_t *ws = &status_shared->worker_stats[i];
+    metrics_printf(w, "rtp2httpd_buffer_pool_buffers{worker=\"%d\",pool=\"media\"} %llu\n", i,
+                   (unsigned long long)ws->pool_total_buffers);
+    metrics_printf(w, "rtp2httpd_buffer_pool_buffers{worker=\"%d\",pool=\"control\"} %llu\n", i,
+                   (unsigned long long)ws->control_pool_total_buffers);
+  }
+  metrics_family(w, "rtp2httpd_buffer_pool_free_buffers", METRIC_GAUGE, "Free buffers of a pool");
+  for (int i = 0; i < workers; i++) {
+    const worker_stats_t *ws = &status_shared->worker_stats[i];
+    metrics_printf(w, "rtp2httpd_buffer_pool_free_buffers{worker=\"%d\",pool=\"media\"} %llu\n", i,
+                   (unsigned long long)ws->pool_free_buffers);
+    metrics_printf(w, "rtp2httpd_buffer_pool_free_buffers{worker=\"%d\",pool=\"control\"} %llu\n", i,
+                   (unsigned long long)ws->control_pool_free_buffers);
+  }
+  metrics_family(w, "rtp2httpd_buffer_pool_max_buffers", METRIC_GAUGE, "Buffers a pool may grow to");
+  for (int i = 0; i < workers; i++) {
+    const worker_stats_t *ws = &status_shared->worker_stats[i];
+    metrics_printf(w, "rtp2httpd_buffer_pool_max_buffers{worker=\"%d\",pool=\"media\"} %llu\n", i,
+                   (unsigned long long)ws->pool_max_buffers);
+    metrics_printf(w, "rtp2httpd_buffer_pool_max_buffers{worker=\"%d\",pool=\"control\"} %llu\n", i,
+                   (unsigned long long)ws->control_pool_max_buffers);
+  }
+  metrics_family(w, "rtp2httpd_buffer_pool_expansions", METRIC_COUNTER, "Times a pool grew");
+  for (int i = 0; i < workers; i++) {
+    const worker_stats_t *ws = &status_shared->worker_stats[i];
+    metrics_printf(w, "rtp2httpd_buffer_pool_expansions_total{worker=\"%d\",pool=\"media\"} %llu\n", i,
+                   (unsigned long long)ws->pool_expansions);
+    metrics_printf(w, "rtp2httpd_buffer_pool_expansions_total{worker=\"%d\",pool=\"control\"} %llu\n", i,
+                   (unsigned long long)ws->control_pool_expansions);
+  }
+  metrics_family(w, "rtp2httpd_buffer_pool_exhaustions", METRIC_COUNTER, "Times a pool had no buffer to give");
+  for (int i = 0; i < workers; i++) {
+    const worker_stats_t *ws = &status_shared->worker_stats[i];
+    metrics_printf(w, "rtp2httpd_buffer_pool_exhaustions_total{worker=\"%d\",pool=\"media\"} %llu\n", i,
+                   (unsigned long long)ws->pool_exhaustions);
+    metrics_printf(w, "rtp2httpd_buffer_pool_exhaustions_total{worker=\"%d\",pool=\"control\"} %llu\n", i,
+                   (unsigned long long)ws->control_pool_exhaustions);
+  }
+  metrics_family(w, "rtp2httpd_buffer_pool_shrinks", METRIC_COUNTER, "Times a pool released idle buffers");
+  for (int i = 0; i < workers; i++) {
+    const worker_stats_t *ws = &status_shared->worker_stats[i];
+    metrics_printf(w, "rtp2httpd_buffer_pool_shrinks_total{worker=\"%d\",pool=\"media\"} %llu\n", i,
+                   (unsigned long long)ws->pool_shrinks);
+    metrics_printf(w, "rtp2httpd_buffer_pool_shrinks_total{worker=\"%d\",pool=\"control\"} %llu\n", i,
+                   (unsigned long long)ws->control_pool_shrinks);
+  }
+
+  /* Streaming clients, by worker and service type */
+  static const struct {
+    const char *name;
+    size_t offset;
+    const char *help;
+  } client_gauges[] = {
+      {"rtp2httpd_clients", offsetof(metrics_client_group_t, clients), "Streaming clients"},
+      {"rtp2httpd_slow_clients", offsetof(metrics_client_group_t, slow_clients),
+       "Streaming clients currently flagged as slow"},
+  };
+  static const struct {
+    const char *name;
+    size_t offset;
+    const char *help;
+  } client_sums[] = {
+      {"rtp2httpd_client_sent_bytes", offsetof(metrics_client_group_t, bytes_sent),
+       "Bytes sent to the clients currently streaming"},
+      {"rtp2httpd_client_dropped_packets", offsetof(metrics_client_group_t, dropped_packets),
+       "Packets dropped for the clients currently streaming"},
+      {"rtp2httpd_client_dropped_bytes", offsetof(metrics_client_group_t, dropped_bytes),
+       "Bytes dropped for the clients currently streaming"},
+      {"rtp2httpd_client_backpressure_events", offsetof(metrics_client_group_t, backpressure_events),
+       "Upstream reads paused for the clients currently streaming"},
+      {"rtp2httpd_client_rtp_expected_packets", offsetof(metrics_client_group_t, rtp_expected),
+       "Upstream RTP packets expected by the clients currently streaming"},
+      {"rtp2httpd_client_rtp_lost_packets", offsetof(metrics_client_group_t, rtp_lost),
+       "Upstream RTP packets lost for the clients currently streaming"},
+  };
+
+  for (size_t f = 0; f < sizeof(client_gauges) / sizeof(client_gauges[0]); f++) {
+    metrics_family(w, client_gauges[f].name, METRIC_GAUGE, client_gauges[f].help);
+    for (int i = 0; i < workers; i++) {
+      for (int t = 0; t < METRICS_SERVICE_TYPES; t++) {
+        uint32_t value;
+        memcpy(&value, (const uint8_t *)&groups[i][t] + client_gauges[f].offset, sizeof(value));
+        metrics_printf(w, "%s{worker=\"%d\",service_type=\"%s\"} %u\n", client_gauges[f].name, i,
+                       metrics_service_types[t], value);
+      }
+    }
+  }
+  for (size_t f = 0; f < sizeof(client_sums) / sizeof(client_sums[0]); f++) {
+    metrics_family(w, client_sums[f].name, METRIC_GAUGE, client_sums[f].help);
+    for (int i = 0; i < workers; i++) {
+      for (int t = 0; t < METRICS_SERVICE_TYPES; t++) {
+        uint64_t value;
+        memcpy(&value, (const uint8_t *)&groups[i][t] + client_sums[f].offset, sizeof(value));
+        metrics_printf(w, "%s{worker=\"%d\",service_type=\"%s\"} %llu\n", client_sums[f].name, i,
+                       metrics_service_types[t], (unsigned long long)value);
+      }
+    }
+  }
+
+  metrics_family(w, "rtp2httpd_client_queue_bytes", METRIC_GAUGE_HISTOGRAM, "Bytes queued for streaming clients");
+  for (int i = 0; i < workers; i++) {
+    for (int t = 0; t < METRICS_SERVICE_TYPES; t++)
+      metrics_histogram(w, "rtp2httpd_client_queue_bytes", i, metrics_service_types[t], metrics_queue_bounds,
+                        groups[i][t].queue_buckets, METRICS_QUEUE_BUCKETS, groups[i][t].queue_bytes_sum);
+  }
+  metrics_family(w, "rtp2httpd_client_bandwidth_bytes_per_second", METRIC_GAUGE_HISTOGRAM,
+                 "Current bandwidth of streaming clients");
+  for (int i = 0; i < workers; i++) {
+    for (int t = 0; t < METRICS_SERVICE_TYPES; t++)
+      metrics_histogram(w, "rtp2httpd_client_bandwidth_bytes_per_second", i, metrics_service_types[t],
+                        metrics_bandwidth_bounds, groups[i][t].bandwidth_buckets, METRICS_BANDWIDTH_BUCKETS,
+                        groups[i][t].bandwidth_sum);
+  }
+
+  if (w->openmetrics)
+    metrics_printf(w, "# EOF\n");
+}
+
+static void metrics_release(metrics_writer_t *w, size_t from) {
+  for (size_t i = from; i < w->buffer_count; i++)
+    buffer_ref_put(w->buffers[i]);
+  w->buffer_count = 0;
+}
+
+void metrics_handle_request(connection_t *c) {
+  metrics_writer_t w;
+  char extra_headers[80];
+
+  if (!status_shared) {
+    http_send_503(c);
+    return;
+  }
+
+  memset(&w, 0, sizeof(w));
+  w.openmetrics = c->http_req.accept[0] && strstr(c->http_req.accept, "application/openmetrics-text") != NULL;
+
+  metrics_render(&w);
+  if (w.failed) {
+    logger(LOG_WARN, "Metrics: control buffer pool exhausted after %zu bytes", w.length);
+    metrics_release(&w, 0);
+    http_send_503(c);
+    return;
+  }
+
+  snprintf(extra_headers, sizeof(extra_headers), "Cache-Control: no-cache\r\nContent-Length: %zu\r\n", w.length);
+  send_http_headers(c, STATUS_200, w.openmetrics ? METRICS_CONTENT_TYPE_OPENMETRICS : METRICS_CONTENT_TYPE_TEXT,
+                    extra_headers);
+
+  if (strcasecmp(c->http_req.method, "HEAD") == 0) {
+    metrics_release(&w, 0);
+    connection_queue_output_and_flush(c, NULL, 0);
+    return;
+  }
+
+  for (size_t i = 0; i < w.buffer_count; i++) {
+    if (connection_queue_zerocopy(c, w.buffers[i]) < 0) {
+      /* Headers are out already; end the response by closing */
+      logger(LOG_WARN, "Metrics: output queue full, response truncated");
+      c->keepalive = 0;
+      metrics_release(&w, i);
+      connection_queue_output_and_flush(c, NULL, 0);
+      return;
+    }
+    buffer_ref_put(w.buffers[i]);
+  }
+  connection_queue_output_and_flush(c, NULL, 0);
+}
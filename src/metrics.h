@@ -0,0 +1,27 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/* Forward declarations */
+typedef struct connection_s connection_t;
+
+/* Largest exposition, in buffer pool buffers (BUFFER_POOL_BUFFER_SIZE each) */
+#define METRICS_MAX_BUFFERS 512
+
+/**
+ * Serve /metrics
+ *
+ * Renders the worker and client statistics kept in shared memory in the
+ * OpenMetrics text format, or in the Prometheus 0.0.4 text format when the
+ * scraper does not ask for OpenMetrics.  Counters are labelled by worker,
+ * client gauges and the queue depth / bandwidth histograms by worker and
+ * service type.
+ *
+ * The exposition is written line by line straight into control pool buffers,
+ * which are queued behind the headers once its length is known: a scrape
+ * needs no large allocation and never takes media buffers from the streams.
+ *
+ * @param c Client connection
+ */
+void metrics_handle_request(connection_t *c);
+
+#endif /* METRICS_H */
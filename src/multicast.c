@@ -1,6 +1,7 @@
 #include "multicast.h"
 #include "buffer_pool.h"
 #include "connection.h"
+#include "cpu_affinity.h"
 #include "fcc.h"
 #include "platform_compat.h"
 #include "poller.h"
@@ -239,6 +240,8 @@ static int join_mcast_group(service_t *service, int is_fec) {
     return -1;
   }
 
+  cpu_affinity_set_incoming_cpu(sock);
+
   /* Join the multicast group */
   if (mcast_group_op(sock, service, 1, "join") < 0) {
     logger(LOG_ERROR, "%s: Cannot join mcast group", log_prefix);
@@ -476,6 +479,7 @@ int mcast_session_handle_event(mcast_session_t *session, stream_context_t *ctx,
 
     session->last_data_time = now;
     recv_buf->data_size = (size_t)actualr;
+    cpu_affinity_sample_rx(session->sock);
 
     int result = 0;
 
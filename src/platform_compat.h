@@ -110,6 +110,35 @@ static inline ssize_t platform_sendfile(int out_fd, int in_fd, off_t *offset, si
 #define MSG_ERRQUEUE 0x2000
 #endif
 
+/* ── recvmmsg() ──────────────────────────────────────────────────────
+ * Linux and FreeBSD receive several datagrams per system call.  macOS has
+ * no recvmmsg(); the fallback receives one datagram per call, so callers
+ * loop the same way on every platform.  Non-blocking: returns the number
+ * of datagrams received (msg_len set for each), or -1 with errno (EAGAIN
+ * when the socket is empty).
+ */
+#if defined(__linux__) || defined(__FreeBSD__)
+typedef struct mmsghdr platform_mmsghdr_t;
+static inline int platform_recvmmsg(int fd, platform_mmsghdr_t *msgs, unsigned int vlen) {
+  return recvmmsg(fd, msgs, vlen, MSG_DONTWAIT, NULL);
+}
+#else
+#include <sys/uio.h>
+typedef struct {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+} platform_mmsghdr_t;
+static inline int platform_recvmmsg(int fd, platform_mmsghdr_t *msgs, unsigned int vlen) {
+  if (vlen == 0)
+    return 0;
+  ssize_t n = recvmsg(fd, &msgs[0].msg_hdr, MSG_DONTWAIT);
+  if (n < 0)
+    return -1;
+  msgs[0].msg_len = (unsigned int)n;
+  return 1;
+}
+#endif
+
 /* ── SO_BINDTODEVICE ─────────────────────────────────────────────────
  * Linux-only. On macOS, IP_BOUND_IF is a rough equivalent.
  */
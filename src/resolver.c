@@ -0,0 +1,1185 @@
+#include "resolver.h"
+#include "configuration.h"
+#include "poller.h"
+#include "rtp2httpd.h"
+#include "status.h"
+#include "utils.h"
+#include "worker.h"
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESOLV_CONF_PATH "/etc/resolv.conf"
+#define HOSTS_PATH "/etc/hosts"
+
+/* How often resolv.conf, /etc/hosts and dns-server are checked for changes */
+#define RESOLVER_RELOAD_CHECK_MS 5000
+
+#define RESOLVER_NAME_MAX 256
+#define RESOLVER_MAX_SEARCH 6
+#define RESOLVER_PACKET_SIZE 1232
+
+#define DNS_HEADER_SIZE 12
+#define DNS_TYPE_A 1
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_SOA 6
+#define DNS_TYPE_AAAA 28
+#define DNS_CLASS_IN 1
+#define DNS_RCODE_NOERROR 0
+#define DNS_RCODE_NXDOMAIN 3
+
+/* Query slots of a lookup: 0 = A (IPv4), 1 = AAAA (IPv6) */
+#define SLOT_A 0
+#define SLOT_AAAA 1
+
+typedef union {
+  struct sockaddr sa;
+  struct sockaddr_in sin;
+  struct sockaddr_in6 sin6;
+} resolver_sockaddr_t;
+
+typedef struct {
+  resolver_sockaddr_t addr[2][RESOLVER_MAX_ADDRS]; /* Indexed by slot */
+  int count[2];
+} resolver_answer_t;
+
+typedef struct {
+  char name[RESOLVER_NAME_MAX]; /* Lower-case host name, empty when unused */
+  resolver_answer_t answer;     /* No addresses: cached NXDOMAIN / NODATA */
+  int64_t expires_at;
+} resolver_cache_entry_t;
+
+typedef struct {
+  char *name;
+  resolver_sockaddr_t addr;
+} resolver_hosts_entry_t;
+
+typedef struct resolver_lookup_s resolver_lookup_t;
+
+struct resolver_query_s {
+  resolver_lookup_t *lookup; /* NULL once detached for the callback */
+  int port;
+  int socktype;
+  resolver_callback_t callback;
+  void *ctx;
+  struct resolver_query_s *next;
+};
+
+struct resolver_lookup_s {
+  char name[RESOLVER_NAME_MAX];  /* Host name as requested (lower case) */
+  char qname[RESOLVER_NAME_MAX]; /* Name being queried (with search suffix) */
+  int absolute;                  /* Name had a trailing dot: no search list */
+  int candidate;                 /* Index of qname in the search order */
+  uint16_t id[2];                /* Transaction IDs per slot */
+  int answered[2];               /* Slot got a final answer */
+  int rcode[2];                  /* RCODE of that answer */
+  resolver_answer_t answer;
+  uint32_t ttl;          /* Smallest TTL among the accepted records */
+  uint32_t negative_ttl; /* From the SOA of negative answers */
+  int server;            /* Nameserver the queries were last sent to */
+  int sock;              /* Socket of the last transmission, -1 if none */
+  int attempts;          /* Transmissions so far */
+  int64_t started;
+  int64_t sent_at;
+  int64_t first_answer_at; /* One family answered with addresses */
+  resolver_query_t *queries;
+  resolver_lookup_t *next;
+};
+
+typedef struct {
+  int initialized;
+  int epfd;
+  resolver_sockaddr_t servers[RESOLVER_MAX_SERVERS];
+  int server_count;
+  char search[RESOLVER_MAX_SEARCH][RESOLVER_NAME_MAX];
+  int search_count;
+  int ndots;
+  char *server_spec; /* dns-server value the list was built from */
+  time_t resolv_conf_mtime;
+  time_t hosts_mtime;
+  int64_t last_reload_check;
+  resolver_hosts_entry_t *hosts;
+  size_t hosts_count;
+  resolver_cache_entry_t cache[RESOLVER_CACHE_SIZE];
+  resolver_lookup_t *lookups;
+  uint16_t ids[32]; /* Random transaction IDs, consumed from the end */
+  int ids_left;
+} resolver_state_t;
+
+/* One resolver per event loop, like the connections it serves */
+static _Thread_local resolver_state_t state;
+
+typedef struct {
+  struct addrinfo ai;
+  resolver_sockaddr_t addr;
+} resolver_result_node_t;
+
+static worker_stats_t *resolver_stats(void) {
+  if (!status_shared || worker_id < 0 || worker_id >= STATUS_MAX_WORKERS)
+    return NULL;
+  return &status_shared->worker_stats[worker_id];
+}
+
+#define RESOLVER_STATS_INC(field)                                                                                      \
+  do {                                                                                                                 \
+    worker_stats_t *stats_ = resolver_stats();                                                                         \
+    if (stats_)                                                                                                        \
+      stats_->field++;                                                                                                 \
+  } while (0)
+
+static void update_cache_stats(int64_t now) {
+  worker_stats_t *stats = resolver_stats();
+  uint32_t cached = 0;
+
+  if (!stats)
+    return;
+  for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+    if (state.cache[i].name[0] && state.cache[i].expires_at > now)
+      cached++;
+  }
+  stats->dns_cached = cached;
+}
+
+/* Transaction IDs are unpredictable: together with the random source port
+ * of each transmission they are what stops off-path answer spoofing */
+static uint16_t random_id(void) {
+  if (state.ids_left == 0) {
+    ssize_t r = getrandom(state.ids, sizeof(state.ids), GRND_NONBLOCK);
+    if (r != (ssize_t)sizeof(state.ids)) {
+      int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+      r = fd >= 0 ? read(fd, state.ids, sizeof(state.ids)) : -1;
+      if (fd >= 0)
+        close(fd);
+    }
+    if (r != (ssize_t)sizeof(state.ids)) {
+      /* No entropy source: still vary IDs, the source port stays random */
+      for (size_t i = 0; i < sizeof(state.ids) / sizeof(state.ids[0]); i++)
+        state.ids[i] ^= (uint16_t)(get_time_ms() * 2654435761u >> 16) + (uint16_t)i;
+    }
+    state.ids_left = (int)(sizeof(state.ids) / sizeof(state.ids[0]));
+  }
+  return state.ids[--state.ids_left];
+}
+
+static socklen_t sockaddr_len(const resolver_sockaddr_t *addr) {
+  return addr->sa.sa_family == AF_INET6 ? (socklen_t)sizeof(struct sockaddr_in6)
+                                        : (socklen_t)sizeof(struct sockaddr_in);
+}
+
+static int family_slot(int family) { return family == AF_INET6 ? SLOT_AAAA : SLOT_A; }
+
+static void lowercase_copy(char *dst, size_t size, const char *src) {
+  size_t i = 0;
+  for (; src[i] && i + 1 < size; i++)
+    dst[i] = (char)tolower((unsigned char)src[i]);
+  dst[i] = '\0';
+}
+
+/* Parse "addr", "addr:port", "[addr]" or "[addr]:port" */
+static int parse_server(const char *spec, resolver_sockaddr_t *out) {
+  char host[INET6_ADDRSTRLEN + 8];
+  const char *port_str = NULL;
+  int port = 53;
+
+  if (spec[0] == '[') {
+    const char *end = strchr(spec, ']');
+    if (!end || (size_t)(end - spec - 1) >= sizeof(host))
+      return -1;
+    memcpy(host, spec + 1, (size_t)(end - spec - 1));
+    host[end - spec - 1] = '\0';
+    if (end[1] == ':')
+      port_str = end + 2;
+    else if (end[1] != '\0')
+      return -1;
+  } else {
+    const char *colon = strchr(spec, ':');
+    if (colon && strchr(colon + 1, ':'))
+      colon = NULL; /* Bare IPv6 address */
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+    if (len >= sizeof(host))
+      return -1;
+    memcpy(host, spec, len);
+    host[len] = '\0';
+    if (colon)
+      port_str = colon + 1;
+  }
+
+  if (port_str) {
+    char *endp;
+    long val = strtol(port_str, &endp, 10);
+    if (*port_str == '\0' || *endp != '\0' || val <= 0 || val > 65535)
+      return -1;
+    port = (int)val;
+  }
+
+  memset(out, 0, sizeof(*out));
+  if (inet_pton(AF_INET, host, &out->sin.sin_addr) == 1) {
+    out->sin.sin_family = AF_INET;
+    out->sin.sin_port = htons((uint16_t)port);
+    return 0;
+  }
+  if (inet_pton(AF_INET6, host, &out->sin6.sin6_addr) == 1) {
+    out->sin6.sin6_family = AF_INET6;
+    out->sin6.sin6_port = htons((uint16_t)port);
+    return 0;
+  }
+  return -1;
+}
+
+static void add_server(const char *spec) {
+  if (state.server_count >= RESOLVER_MAX_SERVERS)
+    return;
+  if (parse_server(spec, &state.servers[state.server_count]) < 0) {
+    logger(LOG_WARN, "DNS: Ignoring invalid nameserver %s", spec);
+    return;
+  }
+  state.server_count++;
+}
+
+static void add_search_domain(const char *domain) {
+  if (state.search_count >= RESOLVER_MAX_SEARCH || domain[0] == '\0' || strcmp(domain, ".") == 0)
+    return;
+  lowercase_copy(state.search[state.search_count], RESOLVER_NAME_MAX, domain);
+  size_t len = strlen(state.search[state.search_count]);
+  if (len > 0 && state.search[state.search_count][len - 1] == '.')
+    state.search[state.search_count][len - 1] = '\0';
+  state.search_count++;
+}
+
+/* Nameservers from dns-server, else /etc/resolv.conf; search / ndots always
+ * come from resolv.conf */
+static void load_resolv_conf(void) {
+  char line[1024];
+  FILE *fp;
+
+  state.server_count = 0;
+  state.search_count = 0;
+  state.ndots = 1;
+
+  free(state.server_spec);
+  state.server_spec = config.dns_server ? strdup(config.dns_server) : NULL;
+  if (config.dns_server) {
+    char *spec = strdup(config.dns_server);
+    char *saveptr = NULL;
+    for (char *tok = spec ? strtok_r(spec, ", \t", &saveptr) : NULL; tok; tok = strtok_r(NULL, ", \t", &saveptr))
+      add_server(tok);
+    free(spec);
+  }
+  int use_conf_servers = state.server_count == 0;
+
+  fp = fopen(RESOLV_CONF_PATH, "r");
+  if (fp) {
+    while (fgets(line, sizeof(line), fp)) {
+      char *saveptr = NULL;
+      char *key = strtok_r(line, " \t\r\n", &saveptr);
+      if (!key || key[0] == '#' || key[0] == ';')
+        continue;
+      if (strcmp(key, "nameserver") == 0) {
+        char *val = strtok_r(NULL, " \t\r\n", &saveptr);
+        if (val && use_conf_servers)
+          add_server(val);
+      } else if (strcmp(key, "search") == 0 || strcmp(key, "domain") == 0) {
+        /* The last search / domain line wins */
+        state.search_count = 0;
+        for (char *val = strtok_r(NULL, " \t\r\n", &saveptr); val; val = strtok_r(NULL, " \t\r\n", &saveptr))
+          add_search_domain(val);
+      } else if (strcmp(key, "options") == 0) {
+        for (char *val = strtok_r(NULL, " \t\r\n", &saveptr); val; val = strtok_r(NULL, " \t\r\n", &saveptr)) {
+          if (strncmp(val, "ndots:", 6) == 0) {
+            int n = atoi(val + 6);
+            state.ndots = n < 0 ? 0 : (n > 15 ? 15 : n);
+          }
+        }
+      }
+    }
+    fclose(fp);
+  }
+
+  /* Same default as the C library: a resolver on this host */
+  if (state.server_count == 0)
+    add_server("127.0.0.1");
+}
+
+static void free_hosts(void) {
+  for (size_t i = 0; i < state.hosts_count; i++)
+    free(state.hosts[i].name);
+  free(state.hosts);
+  state.hosts = NULL;
+  state.hosts_count = 0;
+}
+
+/* Numeric address (IPv6 may carry a %scope); getaddrinfo never blocks here */
+static int parse_numeric(const char *text, resolver_sockaddr_t *out) {
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_flags = AI_NUMERICHOST;
+  if (getaddrinfo(text, NULL, &hints, &res) != 0 || !res)
+    return -1;
+  int ok = (res->ai_family == AF_INET || res->ai_family == AF_INET6) && res->ai_addrlen <= sizeof(*out);
+  if (ok) {
+    memset(out, 0, sizeof(*out));
+    memcpy(out, res->ai_addr, res->ai_addrlen);
+  }
+  freeaddrinfo(res);
+  return ok ? 0 : -1;
+}
+
+static void load_hosts(void) {
+  char line[1024];
+  size_t cap = 0;
+  FILE *fp;
+
+  free_hosts();
+  fp = fopen(HOSTS_PATH, "r");
+  if (!fp)
+    return;
+
+  while (fgets(line, sizeof(line), fp)) {
+    char *hash = strchr(line, '#');
+    char *saveptr = NULL;
+    resolver_sockaddr_t addr;
+
+    if (hash)
+      *hash = '\0';
+    char *addr_str = strtok_r(line, " \t\r\n", &saveptr);
+    if (!addr_str || parse_numeric(addr_str, &addr) < 0)
+      continue;
+
+    for (char *name = strtok_r(NULL, " \t\r\n", &saveptr); name; name = strtok_r(NULL, " \t\r\n", &saveptr)) {
+      if (state.hosts_count == cap) {
+        size_t new_cap = cap ? cap * 2 : 16;
+        resolver_hosts_entry_t *entries = realloc(state.hosts, new_cap * sizeof(*entries));
+        if (!entries) {
+          fclose(fp);
+          return;
+        }
+        state.hosts = entries;
+        cap = new_cap;
+      }
+      char lower[RESOLVER_NAME_MAX];
+      lowercase_copy(lower, sizeof(lower), name);
+      state.hosts[state.hosts_count].name = strdup(lower);
+      if (!state.hosts[state.hosts_count].name)
+        continue;
+      state.hosts[state.hosts_count].addr = addr;
+      state.hosts_count++;
+    }
+  }
+  fclose(fp);
+}
+
+static time_t file_mtime(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? st.st_mtime : 0;
+}
+
+static void reload_if_changed(int64_t now) {
+  if (now - state.last_reload_check < RESOLVER_RELOAD_CHECK_MS)
+    return;
+  state.last_reload_check = now;
+
+  time_t resolv_mtime = file_mtime(RESOLV_CONF_PATH);
+  const char *spec = config.dns_server;
+  int spec_changed = (spec == NULL) != (state.server_spec == NULL) ||
+                     (spec && state.server_spec && strcmp(spec, state.server_spec) != 0);
+  if (resolv_mtime != state.resolv_conf_mtime || spec_changed) {
+    state.resolv_conf_mtime = resolv_mtime;
+    load_resolv_conf();
+    logger(LOG_DEBUG, "DNS: Reloaded nameservers (%d)", state.server_count);
+  }
+
+  time_t hosts_mtime = file_mtime(HOSTS_PATH);
+  if (hosts_mtime != state.hosts_mtime) {
+    state.hosts_mtime = hosts_mtime;
+    load_hosts();
+    /* Names now listed in hosts must not be answered from the cache */
+    memset(state.cache, 0, sizeof(state.cache));
+    update_cache_stats(now);
+  }
+}
+
+static int hosts_lookup(const char *name, resolver_answer_t *answer) {
+  memset(answer, 0, sizeof(*answer));
+  for (size_t i = 0; i < state.hosts_count; i++) {
+    if (strcmp(state.hosts[i].name, name) != 0)
+      continue;
+    int slot = family_slot(state.hosts[i].addr.sa.sa_family);
+    if (answer->count[slot] < RESOLVER_MAX_ADDRS)
+      answer->addr[slot][answer->count[slot]++] = state.hosts[i].addr;
+  }
+  return answer->count[SLOT_A] + answer->count[SLOT_AAAA] > 0 ? 0 : -1;
+}
+
+static resolver_cache_entry_t *cache_find(const char *name, int64_t now) {
+  for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+    resolver_cache_entry_t *entry = &state.cache[i];
+    if (entry->name[0] && entry->expires_at > now && strcmp(entry->name, name) == 0)
+      return entry;
+  }
+  return NULL;
+}
+
+static void cache_store(const char *name, const resolver_answer_t *answer, uint32_t ttl, int64_t now) {
+  resolver_cache_entry_t *slot = NULL;
+
+  for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+    resolver_cache_entry_t *entry = &state.cache[i];
+    if (entry->name[0] && strcmp(entry->name, name) == 0) {
+      slot = entry;
+      break;
+    }
+    if (!slot || entry->expires_at < slot->expires_at)
+      slot = entry;
+  }
+
+  snprintf(slot->name, sizeof(slot->name), "%s", name);
+  slot->answer = *answer;
+  slot->expires_at = now + (int64_t)ttl * 1000;
+  update_cache_stats(now);
+}
+
+/* glibc-style RFC 6724 check: IPv6 goes first only if it is routable */
+static int ipv6_first(const resolver_answer_t *answer) {
+  if (answer->count[SLOT_AAAA] == 0)
+    return 0;
+  if (answer->count[SLOT_A] == 0)
+    return 1;
+
+  int fd = socket(AF_INET6, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return 0;
+  resolver_sockaddr_t probe = answer->addr[SLOT_AAAA][0];
+  probe.sin6.sin6_port = htons(9);
+  int routable = connect(fd, &probe.sa, sizeof(probe.sin6)) == 0;
+  close(fd);
+  return routable;
+}
+
+/* Candidate list alternating address families (RFC 8305 section 4) */
+static struct addrinfo *build_results(const resolver_answer_t *answer, int port, int socktype) {
+  int total = answer->count[SLOT_A] + answer->count[SLOT_AAAA];
+  int first = ipv6_first(answer) ? SLOT_AAAA : SLOT_A;
+  int next[2] = {0, 0};
+
+  if (total == 0)
+    return NULL;
+  resolver_result_node_t *nodes = calloc((size_t)total, sizeof(*nodes));
+  if (!nodes)
+    return NULL;
+
+  int slot = first;
+  for (int n = 0; n < total; n++) {
+    if (next[slot] >= answer->count[slot])
+      slot = !slot;
+    resolver_result_node_t *node = &nodes[n];
+    node->addr = answer->addr[slot][next[slot]++];
+    if (node->addr.sa.sa_family == AF_INET6)
+      node->addr.sin6.sin6_port = htons((uint16_t)port);
+    else
+      node->addr.sin.sin_port = htons((uint16_t)port);
+    node->ai.ai_family = node->addr.sa.sa_family;
+    node->ai.ai_socktype = socktype;
+    node->ai.ai_protocol = socktype == SOCK_DGRAM ? IPPROTO_UDP : IPPROTO_TCP;
+    node->ai.ai_addr = &node->addr.sa;
+    node->ai.ai_addrlen = sockaddr_len(&node->addr);
+    node->ai.ai_next = n + 1 < total ? &nodes[n + 1].ai : NULL;
+    slot = !slot;
+  }
+  return &nodes[0].ai;
+}
+
+/* Used outside an event loop (no poller to drive queries) */
+static int blocking_lookup(const char *host, resolver_answer_t *answer, const char **error) {
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int gai_result = getaddrinfo(host, NULL, &hints, &res);
+  if (gai_result != 0) {
+    *error = gai_strerror(gai_result);
+    return -1;
+  }
+
+  memset(answer, 0, sizeof(*answer));
+  for (struct addrinfo *rp = res; rp; rp = rp->ai_next) {
+    if ((rp->ai_family != AF_INET && rp->ai_family != AF_INET6) || rp->ai_addrlen > sizeof(resolver_sockaddr_t))
+      continue;
+    int slot = family_slot(rp->ai_family);
+    if (answer->count[slot] < RESOLVER_MAX_ADDRS) {
+      memset(&answer->addr[slot][answer->count[slot]], 0, sizeof(resolver_sockaddr_t));
+      memcpy(&answer->addr[slot][answer->count[slot]++], rp->ai_addr, rp->ai_addrlen);
+    }
+  }
+  freeaddrinfo(res);
+  return 0;
+}
+
+/* Name to query for the given position in the search order, -1 past the end */
+static int candidate_name(const resolver_lookup_t *lookup, int index, char *out, size_t size) {
+  int dots = 0;
+  for (const char *p = lookup->name; *p; p++)
+    dots += *p == '.';
+
+  if (lookup->absolute || state.search_count == 0) {
+    if (index > 0)
+      return -1;
+    snprintf(out, size, "%s", lookup->name);
+    return 0;
+  }
+
+  /* Enough dots: the name as given first, then with search suffixes;
+   * otherwise the suffixed names first */
+  int as_given_first = dots >= state.ndots;
+  int as_given_index = as_given_first ? 0 : state.search_count;
+  if (index > state.search_count)
+    return -1;
+  if (index == as_given_index) {
+    snprintf(out, size, "%s", lookup->name);
+    return 0;
+  }
+  int search_index = as_given_first ? index - 1 : index;
+  int n = snprintf(out, size, "%s.%s", lookup->name, state.search[search_index]);
+  return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+static int encode_name(uint8_t *buf, size_t size, const char *name) {
+  size_t pos = 0;
+  const char *label = name;
+
+  while (*label) {
+    const char *dot = strchr(label, '.');
+    size_t len = dot ? (size_t)(dot - label) : strlen(label);
+    if (len == 0 || len > 63 || pos + len + 2 > size)
+      return -1;
+    buf[pos++] = (uint8_t)len;
+    memcpy(buf + pos, label, len);
+    pos += len;
+    label += len;
+    if (*label == '.')
+      label++;
+  }
+  if (pos + 1 > size || pos + 1 > 255)
+    return -1;
+  buf[pos++] = 0;
+  return (int)pos;
+}
+
+static int build_query(uint8_t *buf, size_t size, uint16_t id, const char *qname, uint16_t qtype) {
+  if (size < DNS_HEADER_SIZE + 4)
+    return -1;
+  memset(buf, 0, DNS_HEADER_SIZE);
+  buf[0] = (uint8_t)(id >> 8);
+  buf[1] = (uint8_t)id;
+  buf[2] = 0x01; /* RD */
+  buf[5] = 1;    /* QDCOUNT */
+
+  int name_len = encode_name(buf + DNS_HEADER_SIZE, size - DNS_HEADER_SIZE - 4, qname);
+  if (name_len < 0)
+    return -1;
+  size_t pos = DNS_HEADER_SIZE + (size_t)name_len;
+  buf[pos++] = (uint8_t)(qtype >> 8);
+  buf[pos++] = (uint8_t)qtype;
+  buf[pos++] = 0;
+  buf[pos++] = DNS_CLASS_IN;
+  return (int)pos;
+}
+
+/* Decode a (possibly compressed) name at *offset into lower-case dotted form */
+static int read_name(const uint8_t *msg, size_t len, size_t *offset, char *out, size_t out_size) {
+  size_t pos = *offset;
+  size_t out_len = 0;
+  int jumped = 0;
+  int jumps = 0;
+
+  for (;;) {
+    if (pos >= len)
+      return -1;
+    uint8_t label_len = msg[pos];
+    if ((label_len & 0xC0) == 0xC0) {
+      if (pos + 1 >= len || ++jumps > 32)
+        return -1;
+      if (!jumped)
+        *offset = pos + 2;
+      jumped = 1;
+      pos = ((size_t)(label_len & 0x3F) << 8) | msg[pos + 1];
+      continue;
+    }
+    if (label_len & 0xC0)
+      return -1;
+    pos++;
+    if (label_len == 0)
+      break;
+    if (pos + label_len > len || out_len + label_len + 2 > out_size)
+      return -1;
+    if (out_len > 0)
+      out[out_len++] = '.';
+    for (size_t i = 0; i < label_len; i++)
+      out[out_len++] = (char)tolower(msg[pos + i]);
+    pos += label_len;
+  }
+  if (!jumped)
+    *offset = pos;
+  out[out_len] = '\0';
+  return 0;
+}
+
+static uint16_t read_u16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+static uint32_t read_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+typedef struct {
+  char owner[RESOLVER_NAME_MAX];
+  uint16_t type;
+  uint16_t rclass;
+  uint32_t ttl;
+  size_t rdata;
+  uint16_t rdlength;
+} dns_record_t;
+
+static int read_record(const uint8_t *msg, size_t len, size_t *offset, dns_record_t *rr) {
+  if (read_name(msg, len, offset, rr->owner, sizeof(rr->owner)) < 0 || *offset + 10 > len)
+    return -1;
+  const uint8_t *p = msg + *offset;
+  rr->type = read_u16(p);
+  rr->rclass = read_u16(p + 2);
+  rr->ttl = read_u32(p + 4);
+  rr->rdlength = read_u16(p + 8);
+  rr->rdata = *offset + 10;
+  if (rr->rdata + rr->rdlength > len)
+    return -1;
+  *offset = rr->rdata + rr->rdlength;
+  return 0;
+}
+
+/* Collect the addresses of qname from the answer section, following CNAMEs;
+ * for negative answers take the SOA minimum from the authority section */
+static int parse_answer(resolver_lookup_t *lookup, int slot, const uint8_t *msg, size_t len, size_t answers_offset,
+                        int ancount, int nscount) {
+  uint16_t want = slot == SLOT_AAAA ? DNS_TYPE_AAAA : DNS_TYPE_A;
+  char target[RESOLVER_NAME_MAX];
+  dns_record_t rr;
+  size_t offset;
+
+  snprintf(target, sizeof(target), "%s", lookup->qname);
+
+  /* Resolve the CNAME chain first; records may come in any order */
+  for (int depth = 0; depth < 8; depth++) {
+    int followed = 0;
+    offset = answers_offset;
+    for (int i = 0; i < ancount; i++) {
+      if (read_record(msg, len, &offset, &rr) < 0)
+        return -1;
+      if (rr.type == DNS_TYPE_CNAME && rr.rclass == DNS_CLASS_IN && strcmp(rr.owner, target) == 0) {
+        size_t rdata = rr.rdata;
+        if (read_name(msg, len, &rdata, target, sizeof(target)) < 0)
+          return -1;
+        if (rr.ttl < lookup->ttl)
+          lookup->ttl = rr.ttl;
+        followed = 1;
+        break;
+      }
+    }
+    if (!followed)
+      break;
+  }
+
+  offset = answers_offset;
+  for (int i = 0; i < ancount; i++) {
+    if (read_record(msg, len, &offset, &rr) < 0)
+      return -1;
+    if (rr.type != want || rr.rclass != DNS_CLASS_IN || strcmp(rr.owner, target) != 0)
+      continue;
+    if (lookup->answer.count[slot] >= RESOLVER_MAX_ADDRS)
+      continue;
+    resolver_sockaddr_t *addr = &lookup->answer.addr[slot][lookup->answer.count[slot]];
+    memset(addr, 0, sizeof(*addr));
+    if (want == DNS_TYPE_A && rr.rdlength == 4) {
+      addr->sin.sin_family = AF_INET;
+      memcpy(&addr->sin.sin_addr, msg + rr.rdata, 4);
+    } else if (want == DNS_TYPE_AAAA && rr.rdlength == 16) {
+      addr->sin6.sin6_family = AF_INET6;
+      memcpy(&addr->sin6.sin6_addr, msg + rr.rdata, 16);
+    } else {
+      continue;
+    }
+    lookup->answer.count[slot]++;
+    if (rr.ttl < lookup->ttl)
+      lookup->ttl = rr.ttl;
+  }
+
+  if (lookup->answer.count[slot] > 0)
+    return 0;
+
+  for (int i = 0; i < nscount; i++) {
+    if (read_record(msg, len, &offset, &rr) < 0)
+      break;
+    if (rr.type != DNS_TYPE_SOA)
+      continue;
+    size_t rdata = rr.rdata;
+    char skip[RESOLVER_NAME_MAX];
+    if (read_name(msg, len, &rdata, skip, sizeof(skip)) < 0 || read_name(msg, len, &rdata, skip, sizeof(skip)) < 0 ||
+        rdata + 20 > rr.rdata + rr.rdlength)
+      break;
+    uint32_t minimum = read_u32(msg + rdata + 16);
+    uint32_t ttl = rr.ttl < minimum ? rr.ttl : minimum;
+    if (ttl < lookup->negative_ttl)
+      lookup->negative_ttl = ttl;
+    break;
+  }
+  return 0;
+}
+
+static void handle_lookup_fd(int fd, uint32_t events, int64_t now, void *opaque);
+
+static void close_lookup_socket(resolver_lookup_t *lookup) {
+  if (lookup->sock < 0)
+    return;
+  fdmap_del(lookup->sock);
+  poller_del(state.epfd, lookup->sock);
+  close(lookup->sock);
+  lookup->sock = -1;
+}
+
+/* Every transmission goes out on a new socket connected to the nameserver:
+ * the kernel picks a random ephemeral source port for it and drops
+ * datagrams from any other peer */
+static int open_lookup_socket(resolver_lookup_t *lookup, const resolver_sockaddr_t *server) {
+  close_lookup_socket(lookup);
+
+  int fd = socket(server->sa.sa_family, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return -1;
+  int flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) < 0 ||
+      connect(fd, &server->sa, sockaddr_len(server)) < 0 || poller_add(state.epfd, fd, POLLER_IN) < 0) {
+    close(fd);
+    return -1;
+  }
+  fdmap_set_handler(fd, handle_lookup_fd, lookup);
+  lookup->sock = fd;
+  return fd;
+}
+
+static int send_queries(resolver_lookup_t *lookup, int64_t now) {
+  const resolver_sockaddr_t *server = &state.servers[lookup->server];
+  uint8_t packet[RESOLVER_PACKET_SIZE];
+  int sent = 0;
+
+  int fd = open_lookup_socket(lookup, server);
+  if (fd < 0) {
+    logger(LOG_ERROR, "DNS: Failed to create socket: %s", strerror(errno));
+    return -1;
+  }
+
+  for (int slot = 0; slot < 2; slot++) {
+    if (lookup->answered[slot])
+      continue;
+    lookup->id[slot] = random_id();
+    int len = build_query(packet, sizeof(packet), lookup->id[slot], lookup->qname,
+                          slot == SLOT_AAAA ? DNS_TYPE_AAAA : DNS_TYPE_A);
+    if (len < 0)
+      return -1;
+    if (send(fd, packet, (size_t)len, 0) == len)
+      sent++;
+    else
+      logger(LOG_DEBUG, "DNS: send failed: %s", strerror(errno));
+  }
+
+  lookup->sent_at = now;
+  lookup->attempts++;
+  return sent > 0 || lookup->answered[SLOT_A] || lookup->answered[SLOT_AAAA] ? 0 : -1;
+}
+
+/* Query the next name of the search order; -1 when there is none */
+static int start_candidate(resolver_lookup_t *lookup, int index, int64_t now) {
+  if (candidate_name(lookup, index, lookup->qname, sizeof(lookup->qname)) < 0)
+    return -1;
+  lookup->candidate = index;
+  memset(lookup->answered, 0, sizeof(lookup->answered));
+  memset(lookup->rcode, 0, sizeof(lookup->rcode));
+  memset(&lookup->answer, 0, sizeof(lookup->answer));
+  lookup->ttl = RESOLVER_MAX_TTL;
+  lookup->negative_ttl = RESOLVER_NEGATIVE_TTL_MAX;
+  lookup->first_answer_at = 0;
+  lookup->attempts = 0;
+  lookup->server = 0;
+  return send_queries(lookup, now);
+}
+
+static void unlink_lookup(resolver_lookup_t *lookup) {
+  resolver_lookup_t **pp = &state.lookups;
+  while (*pp) {
+    if (*pp == lookup) {
+      *pp = lookup->next;
+      return;
+    }
+    pp = &(*pp)->next;
+  }
+}
+
+/* Cache the outcome and hand it to every waiting query */
+static void finish_lookup(resolver_lookup_t *lookup, const char *error, int cache_negative, int64_t now) {
+  int total = lookup->answer.count[SLOT_A] + lookup->answer.count[SLOT_AAAA];
+  int64_t latency = now - lookup->started;
+  worker_stats_t *stats = resolver_stats();
+
+  unlink_lookup(lookup);
+  close_lookup_socket(lookup);
+
+  if (stats) {
+    stats->dns_latency_ms_total += (uint64_t)(latency > 0 ? latency : 0);
+    if (latency > (int64_t)stats->dns_latency_ms_max)
+      stats->dns_latency_ms_max = (uint32_t)latency;
+    if (total == 0)
+      stats->dns_failures++;
+  }
+
+  if (total > 0) {
+    uint32_t ttl = lookup->ttl < RESOLVER_MIN_TTL ? RESOLVER_MIN_TTL : lookup->ttl;
+    cache_store(lookup->name, &lookup->answer, ttl, now);
+    logger(LOG_DEBUG, "DNS: Resolved %s (%d IPv4, %d IPv6, ttl %u) in %lld ms", lookup->name,
+           lookup->answer.count[SLOT_A], lookup->answer.count[SLOT_AAAA], ttl, (long long)latency);
+  } else {
+    if (cache_negative) {
+      uint32_t ttl = lookup->negative_ttl < RESOLVER_MIN_TTL ? RESOLVER_MIN_TTL : lookup->negative_ttl;
+      cache_store(lookup->name, &lookup->answer, ttl, now);
+    }
+    logger(LOG_DEBUG, "DNS: Lookup of %s failed after %lld ms: %s", lookup->name, (long long)latency, error);
+  }
+
+  resolver_query_t *q;
+  while ((q = lookup->queries) != NULL) {
+    lookup->queries = q->next;
+    q->lookup = NULL;
+    struct addrinfo *results = total > 0 ? build_results(&lookup->answer, q->port, q->socktype) : NULL;
+    q->callback(q->ctx, results, results ? NULL : (total > 0 ? "out of memory" : error));
+    free(q);
+  }
+  free(lookup);
+}
+
+/* Returns 1 if the lookup finished (and was freed) */
+static int check_complete(resolver_lookup_t *lookup, int64_t now) {
+  int total = lookup->answer.count[SLOT_A] + lookup->answer.count[SLOT_AAAA];
+
+  if (!lookup->answered[SLOT_A] || !lookup->answered[SLOT_AAAA]) {
+    /* One family has addresses: give the other the resolution delay */
+    if (total > 0 && lookup->first_answer_at == 0)
+      lookup->first_answer_at = now;
+    return 0;
+  }
+
+  if (total > 0) {
+    finish_lookup(lookup, NULL, 0, now);
+    return 1;
+  }
+
+  int negative = (lookup->rcode[SLOT_A] == DNS_RCODE_NOERROR || lookup->rcode[SLOT_A] == DNS_RCODE_NXDOMAIN) &&
+                 (lookup->rcode[SLOT_AAAA] == DNS_RCODE_NOERROR || lookup->rcode[SLOT_AAAA] == DNS_RCODE_NXDOMAIN);
+  if (negative) {
+    if (start_candidate(lookup, lookup->candidate + 1, now) == 0)
+      return 0;
+    finish_lookup(lookup, "host not found", 1, now);
+    return 1;
+  }
+  finish_lookup(lookup, "DNS server failure", 0, now);
+  return 1;
+}
+
+/* Returns 1 if the lookup finished (and was freed) */
+static int handle_response(resolver_lookup_t *lookup, const uint8_t *msg, size_t len, int64_t now) {
+  if (len < DNS_HEADER_SIZE || !(msg[2] & 0x80))
+    return 0;
+
+  uint16_t id = read_u16(msg);
+  int rcode = msg[3] & 0x0F;
+  int truncated = (msg[2] & 0x02) != 0;
+  int qdcount = read_u16(msg + 4);
+  int ancount = read_u16(msg + 6);
+  int nscount = read_u16(msg + 8);
+
+  int slot = -1;
+  for (int s = 0; s < 2; s++) {
+    if (!lookup->answered[s] && lookup->id[s] == id) {
+      slot = s;
+      break;
+    }
+  }
+  if (slot < 0 || qdcount != 1)
+    return 0;
+
+  /* The question must echo what was asked: name, type and class */
+  char qname[RESOLVER_NAME_MAX];
+  size_t offset = DNS_HEADER_SIZE;
+  if (read_name(msg, len, &offset, qname, sizeof(qname)) < 0 || offset + 4 > len ||
+      strcmp(qname, lookup->qname) != 0 ||
+      read_u16(msg + offset) != (slot == SLOT_AAAA ? DNS_TYPE_AAAA : DNS_TYPE_A) ||
+      read_u16(msg + offset + 2) != DNS_CLASS_IN)
+    return 0;
+  offset += 4;
+
+  if (rcode != DNS_RCODE_NOERROR && rcode != DNS_RCODE_NXDOMAIN) {
+    /* SERVFAIL / REFUSED: let the retry timer move to the next server */
+    logger(LOG_DEBUG, "DNS: Server answered rcode %d for %s", rcode, lookup->qname);
+    if (lookup->attempts >= state.server_count * 2) {
+      lookup->answered[slot] = 1;
+      lookup->rcode[slot] = rcode;
+      return check_complete(lookup, now);
+    }
+    lookup->sent_at = 0;
+    return 0;
+  }
+
+  if (parse_answer(lookup, slot, msg, len, offset, ancount, truncated ? 0 : nscount) < 0) {
+    logger(LOG_DEBUG, "DNS: Malformed response for %s", lookup->qname);
+    return 0;
+  }
+  if (truncated && lookup->answer.count[slot] == 0) {
+    /* No TCP fallback: a truncated answer without usable records is retried */
+    lookup->sent_at = 0;
+    return 0;
+  }
+  lookup->answered[slot] = 1;
+  lookup->rcode[slot] = rcode;
+  return check_complete(lookup, now);
+}
+
+static void handle_lookup_fd(int fd, uint32_t events, int64_t now, void *opaque) {
+  resolver_lookup_t *lookup = opaque;
+  uint8_t msg[RESOLVER_PACKET_SIZE];
+  (void)events;
+
+  /* Stop once the lookup finished or moved on to a new socket */
+  while (lookup->sock == fd) {
+    ssize_t r = recv(fd, msg, sizeof(msg), 0);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == ECONNREFUSED)
+        lookup->sent_at = 0; /* Nothing listens there: try the next server */
+      break;
+    }
+    if (handle_response(lookup, msg, (size_t)r, now))
+      break;
+  }
+}
+
+void resolver_init(int epfd) {
+  memset(&state, 0, sizeof(state));
+  state.epfd = epfd;
+  state.resolv_conf_mtime = file_mtime(RESOLV_CONF_PATH);
+  state.hosts_mtime = file_mtime(HOSTS_PATH);
+  state.last_reload_check = get_time_ms();
+  load_resolv_conf();
+  load_hosts();
+  state.initialized = 1;
+}
+
+void resolver_cleanup(void) {
+  if (!state.initialized)
+    return;
+
+  while (state.lookups) {
+    resolver_lookup_t *lookup = state.lookups;
+    state.lookups = lookup->next;
+    close_lookup_socket(lookup);
+    while (lookup->queries) {
+      resolver_query_t *q = lookup->queries;
+      lookup->queries = q->next;
+      free(q);
+    }
+    free(lookup);
+  }
+  free_hosts();
+  free(state.server_spec);
+  state.server_spec = NULL;
+  memset(state.cache, 0, sizeof(state.cache));
+  update_cache_stats(0);
+  state.initialized = 0;
+}
+
+void resolver_tick(int64_t now) {
+  if (!state.initialized)
+    return;
+
+  reload_if_changed(now);
+
+  resolver_lookup_t *lookup = state.lookups;
+  while (lookup) {
+    resolver_lookup_t *next = lookup->next;
+    int total = lookup->answer.count[SLOT_A] + lookup->answer.count[SLOT_AAAA];
+
+    if (lookup->first_answer_at && now - lookup->first_answer_at >= RESOLVER_RESOLUTION_DELAY_MS) {
+      finish_lookup(lookup, NULL, 0, now);
+    } else if (now - lookup->started >= RESOLVER_TIMEOUT_MS) {
+      if (total > 0)
+        finish_lookup(lookup, NULL, 0, now);
+      else
+        finish_lookup(lookup, "DNS timeout", 0, now);
+    } else if (now - lookup->sent_at >= RESOLVER_RETRY_MS) {
+      lookup->server = (lookup->server + 1) % state.server_count;
+      if (send_queries(lookup, now) < 0)
+        finish_lookup(lookup, "DNS send failed", 0, now);
+    }
+    lookup = next;
+  }
+}
+
+static int answered(const resolver_answer_t *answer, int port, int socktype, struct addrinfo **results,
+                    const char **error) {
+  *results = build_results(answer, port, socktype);
+  if (!*results) {
+    *error = "no address";
+    return -1;
+  }
+  return 0;
+}
+
+int resolver_lookup(const char *host, int port, int socktype, struct addrinfo **results, const char **error,
+                    resolver_callback_t callback, void *ctx, resolver_query_t **query) {
+  resolver_answer_t answer;
+  resolver_sockaddr_t numeric;
+  char name[RESOLVER_NAME_MAX];
+  int absolute = 0;
+
+  *results = NULL;
+  *error = NULL;
+  if (query)
+    *query = NULL;
+
+  if (!host || host[0] == '\0' || strlen(host) >= sizeof(name)) {
+    *error = "invalid host name";
+    return -1;
+  }
+
+  memset(&answer, 0, sizeof(answer));
+  if (parse_numeric(host, &numeric) == 0) {
+    answer.addr[family_slot(numeric.sa.sa_family)][0] = numeric;
+    answer.count[family_slot(numeric.sa.sa_family)] = 1;
+    return answered(&answer, port, socktype, results, error);
+  }
+
+  if (!state.initialized || !callback || !query) {
+    if (blocking_lookup(host, &answer, error) < 0)
+      return -1;
+    return answered(&answer, port, socktype, results, error);
+  }
+
+  lowercase_copy(name, sizeof(name), host);
+  size_t name_len = strlen(name);
+  if (name[name_len - 1] == '.') {
+    name[--name_len] = '\0';
+    absolute = 1;
+  }
+  if (name_len == 0) {
+    *error = "invalid host name";
+    return -1;
+  }
+
+  int64_t now = get_time_ms();
+  RESOLVER_STATS_INC(dns_queries);
+
+  if (hosts_lookup(name, &answer) == 0) {
+    RESOLVER_STATS_INC(dns_cache_hits);
+    return answered(&answer, port, socktype, results, error);
+  }
+
+  resolver_cache_entry_t *entry = cache_find(name, now);
+  if (entry) {
+    RESOLVER_STATS_INC(dns_cache_hits);
+    answer = entry->answer;
+    if (answer.count[SLOT_A] + answer.count[SLOT_AAAA] == 0) {
+      *error = "host not found (cached)";
+      return -1;
+    }
+    return answered(&answer, port, socktype, results, error);
+  }
+
+  resolver_query_t *q = calloc(1, sizeof(*q));
+  if (!q) {
+    *error = "out of memory";
+    return -1;
+  }
+  q->port = port;
+  q->socktype = socktype;
+  q->callback = callback;
+  q->ctx = ctx;
+
+  /* Join a lookup of the same name that is already on the wire */
+  resolver_lookup_t *lookup;
+  for (lookup = state.lookups; lookup; lookup = lookup->next) {
+    if (strcmp(lookup->name, name) == 0)
+      break;
+  }
+
+  if (!lookup) {
+    lookup = calloc(1, sizeof(*lookup));
+    if (!lookup) {
+      free(q);
+      *error = "out of memory";
+      return -1;
+    }
+    snprintf(lookup->name, sizeof(lookup->name), "%s", name);
+    lookup->absolute = absolute;
+    lookup->started = now;
+    lookup->sock = -1;
+    if (start_candidate(lookup, 0, now) < 0) {
+      close_lookup_socket(lookup);
+      free(lookup);
+      free(q);
+      *error = "DNS send failed";
+      return -1;
+    }
+    lookup->next = state.lookups;
+    state.lookups = lookup;
+    RESOLVER_STATS_INC(dns_lookups);
+  }
+
+  q->lookup = lookup;
+  q->next = lookup->queries;
+  lookup->queries = q;
+  *query = q;
+  return 1;
+}
+
+void resolver_cancel(resolver_query_t *query) {
+  if (!query)
+    return;
+
+  resolver_lookup_t *lookup = query->lookup;
+  if (lookup) {
+    resolver_query_t **pp = &lookup->queries;
+    while (*pp) {
+      if (*pp == query) {
+        *pp = query->next;
+        break;
+      }
+      pp = &(*pp)->next;
+    }
+  }
+  /* The lookup itself carries on so its answer still lands in the cache */
+  free(query);
+}
+
+void resolver_freeaddrinfo(struct addrinfo *results) {
+  /* Nodes come from a single allocation headed by the first one */
+  free(results);
+}
@@ -0,0 +1,97 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <stdint.h>
+
+/* Forward declarations */
+struct addrinfo;
+
+/* Nameservers used at once (like MAXNS in resolv.conf) */
+#define RESOLVER_MAX_SERVERS 3
+
+/* Addresses kept per family for one host name */
+#define RESOLVER_MAX_ADDRS 8
+
+/* Host names cached per event loop; the entry closest to expiry is evicted */
+#define RESOLVER_CACHE_SIZE 64
+
+/* A lookup is retried on the next nameserver after this long (milliseconds) */
+#define RESOLVER_RETRY_MS 1000
+
+/* A lookup without any answer fails after this long (milliseconds) */
+#define RESOLVER_TIMEOUT_MS 5000
+
+/* Once one address family answered, wait this long for the other (RFC 8305
+ * resolution delay, milliseconds) */
+#define RESOLVER_RESOLUTION_DELAY_MS 50
+
+/* Bounds applied to record TTLs before caching (seconds) */
+#define RESOLVER_MIN_TTL 5
+#define RESOLVER_MAX_TTL 3600
+#define RESOLVER_NEGATIVE_TTL_MAX 300
+
+/**
+ * Asynchronous DNS resolver
+ *
+ * Resolves upstream host names without blocking the event loop: numeric
+ * addresses and /etc/hosts entries are answered at once, everything else is
+ * sent as A and AAAA queries over UDP to the nameservers from dns-server (or
+ * /etc/resolv.conf, honouring search / ndots).  Each transmission uses a new
+ * socket with a kernel-chosen source port and random transaction IDs,
+ * registered with the worker's poller and fdmap; answers must echo the
+ * question.  Answers are cached per event loop for the record TTL,
+ * NXDOMAIN / NODATA for the SOA minimum, and concurrent lookups of the same
+ * name share one query.  Candidate lists alternate address families (RFC 8305
+ * happy eyeballs ordering), starting with IPv6 only when it is routable.
+ */
+
+typedef struct resolver_query_s resolver_query_t;
+
+/**
+ * Completion callback of a pending lookup
+ * @param ctx Caller context passed to resolver_lookup
+ * @param results Candidate list (ownership transferred, free with
+ * resolver_freeaddrinfo) or NULL on failure
+ * @param error Failure reason when results is NULL
+ */
+typedef void (*resolver_callback_t)(void *ctx, struct addrinfo *results, const char *error);
+
+/**
+ * Initialize the resolver for this event loop
+ * @param epfd Poller of the calling event loop
+ */
+void resolver_init(int epfd);
+
+/** Drop pending lookups (without callbacks), the cache and the sockets */
+void resolver_cleanup(void);
+
+/** Retry and time out pending lookups, reload resolv.conf / hosts on change */
+void resolver_tick(int64_t now);
+
+/**
+ * Resolve a host name for connecting to port
+ * Outside an initialized event loop this falls back to a blocking
+ * getaddrinfo().
+ * @param host Host name or numeric address (IPv6 without brackets)
+ * @param port Port stored in the returned socket addresses
+ * @param socktype SOCK_STREAM or SOCK_DGRAM
+ * @param results Set to the candidate list when answered immediately
+ * @param error Set to the failure reason on failure
+ * @param callback Called once when a pending lookup completes
+ * @param ctx Passed to callback
+ * @param query Set to the pending lookup handle (for resolver_cancel)
+ * @return 0 if *results is set, 1 if pending, -1 on failure
+ */
+int resolver_lookup(const char *host, int port, int socktype, struct addrinfo **results, const char **error,
+                    resolver_callback_t callback, void *ctx, resolver_query_t **query);
+
+/**
+ * Cancel a pending lookup; its callback will not be called
+ * @param query Handle from resolver_lookup (NULL is ignored)
+ */
+void resolver_cancel(resolver_query_t *query);
+
+/** Free a candidate list returned by resolver_lookup */
+void resolver_freeaddrinfo(struct addrinfo *results);
+
+#endif /* RESOLVER_H */
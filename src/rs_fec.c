@@ -17,6 +17,7 @@
 
 #include "rs_fec.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -66,7 +67,7 @@ static uint8_t get_g_coefficient(int row, int col, const uint8_t *g0_table, cons
 
 static uint8_t rs_exp[255 + 1];
 static uint16_t rs_log[255 + 1];
-static int rs_fec_initialized = 0;
+static pthread_once_t rs_fec_once = PTHREAD_ONCE_INIT;
 
 static void generate_gf_tables(void) {
   uint8_t x = 0x1;
@@ -90,10 +91,8 @@ static void generate_gf_tables(void) {
 }
 
 void rs_fec_init(void) {
-  if (!rs_fec_initialized) {
-    generate_gf_tables();
-    rs_fec_initialized = 1;
-  }
+  /* Event loops in worker-threads mode may create decoders concurrently */
+  pthread_once(&rs_fec_once, generate_gf_tables);
 }
 
 static int matrix_inv_gf256(uint8_t **matrix, int n) {
@@ -179,9 +178,7 @@ static void matrix_mul_gf256(uint8_t **a, uint8_t **b, uint8_t **c, int left, in
 rs_fec_t *rs_fec_new(int data_pkt_num, int fec_pkt_num) {
   rs_fec_t *rs = NULL;
 
-  if (!rs_fec_initialized) {
-    rs_fec_init();
-  }
+  rs_fec_init();
 
   int i, j;
 
@@ -23,7 +23,8 @@ typedef struct rs_fec_s {
 } rs_fec_t;
 
 /**
- * Initialize RS FEC tables (called automatically by rs_fec_new)
+ * Initialize RS FEC tables once (called automatically by rs_fec_new, safe
+ * from any thread)
  */
 void rs_fec_init(void);
 
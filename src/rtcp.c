@@ -0,0 +1,227 @@
+#include "rtcp.h"
+#include "utils.h"
+#include <string.h>
+#include <unistd.h>
+
+#define RTCP_PT_SR 200
+#define RTCP_PT_RR 201
+#define RTCP_PT_SDES 202
+#define RTCP_PT_BYE 203
+
+#define RTCP_SDES_CNAME 1
+#define RTCP_CNAME "rtp2httpd"
+
+/* Sequence tracking limits from RFC 3550 appendix A.1 */
+#define RTCP_MAX_DROPOUT 3000
+#define RTCP_MAX_MISORDER 100
+#define RTCP_SEQ_MOD (1U << 16)
+
+static uint32_t read_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void write_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+/* Arrival time in RTP timestamp units; only differences matter */
+static uint32_t arrival_units(int64_t arrival_us) {
+  return (uint32_t)((uint64_t)arrival_us * (RTCP_CLOCK_RATE / 1000) / 1000);
+}
+
+static void source_init(rtcp_receiver_t *r, uint32_t ssrc, uint16_t seq) {
+  r->active = 1;
+  r->ssrc = ssrc;
+  r->base_seq = seq;
+  r->max_seq = seq;
+  r->bad_seq = RTCP_SEQ_MOD + 1; /* So seq == bad_seq is false */
+  r->cycles = 0;
+  r->received = 0;
+  r->expected_prior = 0;
+  r->received_prior = 0;
+  r->transit = 0;
+  r->jitter = 0;
+}
+
+void rtcp_receiver_init(rtcp_receiver_t *r) {
+  memset(r, 0, sizeof(*r));
+  r->rtt_ms = -1;
+}
+
+void rtcp_receiver_on_rtp(rtcp_receiver_t *r, const uint8_t *packet, int64_t arrival_us) {
+  uint16_t seq = (uint16_t)((packet[2] << 8) | packet[3]);
+  uint32_t timestamp = read_u32(packet + 4);
+  uint32_t ssrc = read_u32(packet + 8);
+  int first = 0;
+
+  if (!r->active || ssrc != r->ssrc) {
+    /* New source (e.g. FCC handing over from unicast to multicast) */
+    if (r->active)
+      logger(LOG_DEBUG, "RTCP: Source changed from %08x to %08x", r->ssrc, ssrc);
+    source_init(r, ssrc, seq);
+    first = 1;
+  } else {
+    uint16_t udelta = (uint16_t)(seq - r->max_seq);
+    if (udelta < RTCP_MAX_DROPOUT) {
+      /* In order, with permissible gap */
+      if (seq < r->max_seq)
+        r->cycles += RTCP_SEQ_MOD;
+      r->max_seq = seq;
+    } else if (udelta <= RTCP_SEQ_MOD - RTCP_MAX_MISORDER) {
+      /* Very large jump: restart if the next packet follows it, as after a
+       * sender restart; ignore it otherwise */
+      if (seq == r->bad_seq) {
+        source_init(r, ssrc, seq);
+        first = 1;
+      } else {
+        r->bad_seq = (seq + 1) & (RTCP_SEQ_MOD - 1);
+        return;
+      }
+    }
+    /* Otherwise duplicate or reordered packet: counted, no new maximum */
+  }
+  r->received++;
+
+  uint32_t transit = arrival_units(arrival_us) - timestamp;
+  if (!first) {
+    int32_t d = (int32_t)(transit - r->transit);
+    if (d < 0)
+      d = -d;
+    r->jitter += (uint32_t)d - ((r->jitter + 8) >> 4);
+  }
+  r->transit = transit;
+}
+
+int rtcp_receiver_on_rtcp(rtcp_receiver_t *r, const uint8_t *data, size_t len, int64_t now_us) {
+  int bye = 0;
+
+  if (len < 4)
+    return -1;
+
+  while (len >= 4) {
+    if ((data[0] & 0xC0) != 0x80)
+      return -1;
+    size_t packet_len = ((size_t)((data[2] << 8) | data[3]) + 1) * 4;
+    if (packet_len > len)
+      return -1;
+
+    switch (data[1]) {
+    case RTCP_PT_SR:
+      /* Sender SSRC, NTP timestamp; report blocks are about other senders */
+      if (packet_len >= 28 && (!r->active || read_u32(data + 4) == r->ssrc)) {
+        r->last_sr = (read_u32(data + 8) << 16) | (read_u32(data + 12) >> 16);
+        r->last_sr_us = now_us;
+      }
+      break;
+    case RTCP_PT_BYE:
+      bye = 1;
+      break;
+    case RTCP_PT_RR:
+    default:
+      break;
+    }
+
+    data += packet_len;
+    len -= packet_len;
+  }
+
+  return bye;
+}
+
+size_t rtcp_receiver_build_report(rtcp_receiver_t *r, uint8_t *buf, size_t size, int64_t now_us) {
+  size_t cname_len = sizeof(RTCP_CNAME) - 1;
+  /* SDES chunk: SSRC, CNAME item, then at least one null octet up to a
+   * 32-bit boundary */
+  size_t sdes_len = 4 + ((4 + 2 + cname_len + 4) & ~(size_t)3);
+  size_t rr_len = r->active ? 32 : 8;
+
+  if (size < rr_len + sdes_len || rr_len + sdes_len > RTCP_REPORT_MAX_SIZE)
+    return 0;
+
+  if (r->local_ssrc == 0) {
+    uint64_t seed = (uint64_t)now_us ^ ((uint64_t)getpid() << 20) ^ (uint64_t)(uintptr_t)r;
+    r->local_ssrc = (uint32_t)(seed ^ (seed >> 32)) | 1;
+    if (r->local_ssrc == r->ssrc)
+      r->local_ssrc ^= 0x80000000U;
+  }
+
+  memset(buf, 0, rr_len + sdes_len);
+  buf[0] = 0x80 | (r->active ? 1 : 0);
+  buf[1] = RTCP_PT_RR;
+  buf[2] = 0;
+  buf[3] = (uint8_t)(rr_len / 4 - 1);
+  write_u32(buf + 4, r->local_ssrc);
+
+  if (r->active) {
+    uint64_t expected = rtcp_receiver_expected(r);
+    uint64_t expected_interval = expected - r->expected_prior;
+    uint64_t received_interval = r->received - r->received_prior;
+    int64_t lost_interval = (int64_t)expected_interval - (int64_t)received_interval;
+    uint8_t fraction = 0;
+    if (expected_interval > 0 && lost_interval > 0)
+      fraction = (uint8_t)(((uint64_t)lost_interval << 8) / expected_interval);
+    r->expected_prior = expected;
+    r->received_prior = r->received;
+
+    /* Cumulative loss is a signed 24-bit field */
+    int64_t lost = (int64_t)expected - (int64_t)r->received;
+    if (lost > 0x7FFFFF)
+      lost = 0x7FFFFF;
+    else if (lost < -0x800000)
+      lost = -0x800000;
+
+    uint32_t dlsr = 0;
+    if (r->last_sr_us > 0)
+      dlsr = (uint32_t)((uint64_t)(now_us - r->last_sr_us) * 65536 / 1000000);
+
+    uint8_t *block = buf + 8;
+    write_u32(block, r->ssrc);
+    write_u32(block + 4, ((uint32_t)fraction << 24) | ((uint32_t)lost & 0xFFFFFF));
+    write_u32(block + 8, r->cycles + r->max_seq);
+    write_u32(block + 12, r->jitter >> 4);
+    write_u32(block + 16, r->last_sr_us > 0 ? r->last_sr : 0);
+    write_u32(block + 20, dlsr);
+  }
+
+  uint8_t *sdes = buf + rr_len;
+  sdes[0] = 0x81;
+  sdes[1] = RTCP_PT_SDES;
+  sdes[2] = 0;
+  sdes[3] = (uint8_t)(sdes_len / 4 - 1);
+  write_u32(sdes + 4, r->local_ssrc);
+  sdes[8] = RTCP_SDES_CNAME;
+  sdes[9] = (uint8_t)cname_len;
+  memcpy(sdes + 10, RTCP_CNAME, cname_len);
+
+  return rr_len + sdes_len;
+}
+
+void rtcp_receiver_add_rtt(rtcp_receiver_t *r, int64_t sample_ms) {
+  if (sample_ms < 0)
+    return;
+  if (sample_ms > 60000)
+    sample_ms = 60000;
+  /* Same gain as TCP's SRTT (RFC 6298) */
+  if (r->rtt_ms < 0)
+    r->rtt_ms = (int)sample_ms;
+  else
+    r->rtt_ms = (int)((7 * (int64_t)r->rtt_ms + sample_ms) / 8);
+}
+
+uint32_t rtcp_receiver_jitter_us(const rtcp_receiver_t *r) {
+  return (uint32_t)((uint64_t)(r->jitter >> 4) * 1000000 / RTCP_CLOCK_RATE);
+}
+
+uint64_t rtcp_receiver_expected(const rtcp_receiver_t *r) {
+  if (!r->active)
+    return 0;
+  return (uint64_t)(r->cycles + r->max_seq) - r->base_seq + 1;
+}
+
+uint64_t rtcp_receiver_lost(const rtcp_receiver_t *r) {
+  uint64_t expected = rtcp_receiver_expected(r);
+  return expected > r->received ? expected - r->received : 0;
+}
@@ -0,0 +1,89 @@
+#ifndef __RTCP_H__
+#define __RTCP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* RTP clock rate of MPEG-TS payloads (RFC 2250), used for jitter */
+#define RTCP_CLOCK_RATE 90000
+
+/* Interval between receiver reports (RFC 3550 minimum) */
+#define RTCP_REPORT_INTERVAL_MS 5000
+
+/* Room for one RR with a report block plus the SDES CNAME chunk */
+#define RTCP_REPORT_MAX_SIZE 64
+
+/**
+ * RTCP receiver state for one media stream (RFC 3550)
+ *
+ * Fed with every RTP packet the stream receives, it keeps the extended
+ * highest sequence number, the packet count and the interarrival jitter of
+ * the current source (appendix A.1, A.3, A.8), plus the last sender report
+ * seen, so receiver reports can be built for the upstream.  RTT is not
+ * measurable from RTCP by a receiver that never sends RTP; the owning
+ * session feeds round trips of its control requests instead.
+ */
+typedef struct {
+  int active;              /* An RTP packet of ssrc has been seen */
+  uint32_t ssrc;           /* Source being reported on */
+  uint32_t local_ssrc;     /* Our SSRC in reports, picked on first use */
+  uint16_t max_seq;        /* Highest sequence number seen */
+  uint32_t cycles;         /* Sequence number wraps, shifted left by 16 */
+  uint32_t base_seq;       /* First sequence number of the source */
+  uint32_t bad_seq;        /* Sequence number expected after a jump, for resync */
+  uint64_t received;       /* Packets received from the source */
+  uint64_t expected_prior; /* Expected count at the last report */
+  uint64_t received_prior; /* Received count at the last report */
+  uint32_t transit;        /* Relative transit time of the last packet */
+  uint32_t jitter;         /* Interarrival jitter in timestamp units, << 4 */
+  uint32_t last_sr;        /* Middle 32 bits of the last SR NTP timestamp */
+  int64_t last_sr_us;      /* Arrival of the last SR, 0 if none */
+  int rtt_ms;              /* Smoothed round trip to the upstream, -1 if unknown */
+} rtcp_receiver_t;
+
+/** Reset a receiver to its initial state */
+void rtcp_receiver_init(rtcp_receiver_t *r);
+
+/**
+ * Account for a received RTP packet
+ * @param r Receiver state
+ * @param packet RTP packet with at least a fixed 12-byte header
+ * @param arrival_us Arrival time from get_time_us()
+ */
+void rtcp_receiver_on_rtp(rtcp_receiver_t *r, const uint8_t *packet, int64_t arrival_us);
+
+/**
+ * Parse a compound RTCP packet from the upstream (SR, RR, BYE; other types
+ * are skipped)
+ * @param r Receiver state
+ * @param data Packet data
+ * @param len Packet length
+ * @param now_us Arrival time from get_time_us()
+ * @return 1 if it carried a BYE, 0 if parsed, -1 if malformed
+ */
+int rtcp_receiver_on_rtcp(rtcp_receiver_t *r, const uint8_t *data, size_t len, int64_t now_us);
+
+/**
+ * Build a compound receiver report (RR and SDES CNAME) and start a new
+ * reporting interval
+ * @param r Receiver state
+ * @param buf Output buffer of at least RTCP_REPORT_MAX_SIZE bytes
+ * @param size Size of buf
+ * @param now_us Current time from get_time_us()
+ * @return Report length in bytes, 0 if buf is too small
+ */
+size_t rtcp_receiver_build_report(rtcp_receiver_t *r, uint8_t *buf, size_t size, int64_t now_us);
+
+/** Fold a round-trip sample (ms) into the smoothed RTT */
+void rtcp_receiver_add_rtt(rtcp_receiver_t *r, int64_t sample_ms);
+
+/** Interarrival jitter in microseconds */
+uint32_t rtcp_receiver_jitter_us(const rtcp_receiver_t *r);
+
+/** Packets expected from the current source so far */
+uint64_t rtcp_receiver_expected(const rtcp_receiver_t *r);
+
+/** Packets lost from the current source so far (duplicates do not offset it below 0) */
+uint64_t rtcp_receiver_lost(const rtcp_receiver_t *r);
+
+#endif /* __RTCP_H__ */
@@ -6,7 +6,7 @@
 #include <unistd.h>
 
 /* GLOBALS */
-int worker_id = SUPERVISOR_WORKER_ID; /* Worker ID for this process (0-based) */
+_Thread_local int worker_id = SUPERVISOR_WORKER_ID; /* Worker ID for this process or thread (0-based) */
 
 int main(int argc, char *argv[]) {
   parse_cmd_line(argc, argv);
@@ -2,6 +2,7 @@
 #define __RTP2HTTPD_H__
 
 /* GLOBALS */
-extern int worker_id;
+/* Thread-local so that each event-loop thread in worker-threads mode keeps its own id */
+extern _Thread_local int worker_id;
 
 #endif
@@ -7,11 +7,15 @@
 #include "multicast.h"
 #include "platform_compat.h"
 #include "poller.h"
+#include "resolver.h"
 #include "rtp.h"
+#include "rtsp_fast_start.h"
+#include "rtsp_share.h"
 #include "status.h"
 #include "stream.h"
 #include "utils.h"
 #include "worker.h"
+#include <ctype.h>
 #include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
@@ -49,6 +53,8 @@ static void rtsp_close_udp_sockets(rtsp_session_t *session, const char *reason);
 static char *rtsp_find_header(const char *response, const char *header_name);
 static void rtsp_parse_transport_header(rtsp_session_t *session, const char *transport);
 static void rtsp_send_udp_nat_probe(rtsp_session_t *session);
+static void rtsp_handle_rtcp_packet(rtsp_session_t *session, const uint8_t *data, size_t len);
+static int rtsp_flush_rtcp_out(rtsp_session_t *session);
 static int rtsp_process_interleaved_buffer(rtsp_session_t *session, connection_t *conn);
 static int rtsp_handle_redirect(rtsp_session_t *session, const char *location);
 static void rtsp_parse_describe_sdp(rtsp_session_t *session, const char *header_start, const char *sdp_body);
@@ -399,8 +405,14 @@ static void rtsp_session_set_state(rtsp_session_t *session, rtsp_state_t new_sta
   /* Update client status immediately */
   if (new_state < ARRAY_SIZE(rtsp_to_client_state)) {
     status_update_client_state(session->status_index, rtsp_to_client_state[new_state]);
+    if (session->conn && session->conn->stream.rtsp_share)
+      rtsp_share_set_state(session->conn->stream.rtsp_share, rtsp_to_client_state[new_state]);
   }
 
+  /* A session that failed on cached data must not lead the next one astray */
+  if (new_state == RTSP_STATE_ERROR && session->fast_start)
+    rtsp_fast_start_forget(session);
+
   /* Auto-cleanup on ERROR state transition (if not already done) */
   if (new_state == RTSP_STATE_ERROR && !session->cleanup_done) {
     logger(LOG_DEBUG, "RTSP: Auto-cleanup triggered on ERROR state");
@@ -710,18 +722,35 @@ int rtsp_parse_server_url(rtsp_session_t *session, const char *rtsp_url, const c
   return 0;
 }
 
-/* Free the getaddrinfo candidate list (after success or final failure) */
+void rtsp_session_key(const rtsp_session_t *session, char *key, size_t key_size) {
+  char host[RTSP_SERVER_HOST_SIZE];
+  size_t i;
+
+  for (i = 0; session->server_host[i] && i < sizeof(host) - 1; i++)
+    host[i] = (char)tolower((unsigned char)session->server_host[i]);
+  host[i] = '\0';
+
+  snprintf(key, key_size, "%s|%s:%s@%s:%d%s", session->upstream_ifname ? session->upstream_ifname : "",
+           session->username, session->password, host, session->server_port, session->server_path);
+}
+
+/* Free the candidate list and drop a pending lookup (after success or final
+ * failure) */
 static void rtsp_free_connect_results(rtsp_session_t *session) {
+  if (session->resolve_query) {
+    resolver_cancel(session->resolve_query);
+    session->resolve_query = NULL;
+  }
   if (session->connect_results) {
-    freeaddrinfo(session->connect_results);
+    resolver_freeaddrinfo(session->connect_results);
     session->connect_results = NULL;
     session->connect_next = NULL;
   }
 }
 
 /**
- * Try connecting to the next candidate from the getaddrinfo result list
- * (sequential dual-stack fallback, IPv6/IPv4 in resolver order).
+ * Try connecting to the next candidate from the resolver's list
+ * (sequential dual-stack fallback, families alternating in resolver order).
  * Both immediate success and EINPROGRESS leave the session in
  * CONNECTING/RECONNECTING; the poller event drives completion via
  * getsockopt(SO_ERROR).  A hard connect() failure moves on to the next
@@ -819,28 +848,9 @@ static int rtsp_handle_connect_failure(rtsp_session_t *session, int error) {
   return rtsp_try_next_candidate(session);
 }
 
-int rtsp_connect(rtsp_session_t *session) {
-  struct addrinfo hints;
-  char port_str[16];
-  int gai_result;
-
-  /* Resolve hostname first (dual-stack: IPv6 and IPv4 candidates), so the
-   * upstream address family is known before creating UDP/STUN sockets */
-  rtsp_free_connect_results(session);
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = SOCK_STREAM;
-  snprintf(port_str, sizeof(port_str), "%d", session->server_port);
-
-  gai_result = getaddrinfo(session->server_host, port_str, &hints, &session->connect_results);
-  if (gai_result != 0) {
-    logger(LOG_ERROR, "RTSP: Cannot resolve hostname %s: %s", session->server_host, gai_strerror(gai_result));
-    session->connect_results = NULL;
-    return -1;
-  }
-
+/* Start connecting once the candidate list is known */
+static int rtsp_connect_resolved(rtsp_session_t *session) {
   session->connect_next = session->connect_results;
-  session->connect_last_errno = 0;
   if (session->connect_results) {
     session->upstream_family = session->connect_results->ai_family;
   }
@@ -850,7 +860,7 @@ int rtsp_connect(rtsp_session_t *session) {
    * Only do this on initial connect (not on redirect or reconnect for TEARDOWN)
    * Check: UDP socket not yet created and STUN not already in progress/completed */
   if (config.rtsp_stun_server && config.rtsp_stun_server[0] != '\0' && session->rtp_socket < 0 &&
-      !session->stun.in_progress && !session->stun.completed) {
+      !session->stun.in_progress && !session->stun.completed && !session->fast_start_tcp) {
     if (rtsp_setup_udp_sockets(session) == 0) {
       if (stun_send_request(&session->stun, session->rtp_socket) == 0) {
         logger(LOG_DEBUG, "RTSP: Started STUN discovery before TCP connect");
@@ -861,12 +871,60 @@ int rtsp_connect(rtsp_session_t *session) {
   return rtsp_try_next_candidate(session);
 }
 
+/* Completion of an asynchronous lookup started by rtsp_connect */
+static void rtsp_on_resolved(void *ctx, struct addrinfo *results, const char *error) {
+  rtsp_session_t *session = ctx;
+
+  session->resolve_query = NULL;
+  if (!results) {
+    logger(LOG_ERROR, "RTSP: Cannot resolve hostname %s: %s", session->server_host, error);
+    session->connect_failed = 1;
+    return;
+  }
+
+  session->connect_results = results;
+  if (rtsp_connect_resolved(session) < 0)
+    session->connect_failed = 1;
+}
+
+int rtsp_connect(rtsp_session_t *session) {
+  const char *error = NULL;
+
+  /* Resolve hostname first (dual-stack: IPv6 and IPv4 candidates), so the
+   * upstream address family is known before creating UDP/STUN sockets.  The
+   * lookup never blocks the event loop; while it is pending the session waits
+   * in CONNECTING (or RECONNECTING) under the handshake timeout. */
+  rtsp_free_connect_results(session);
+  session->connect_last_errno = 0;
+  session->connect_failed = 0;
+
+  /* A fresh session may resume the DESCRIBE of an earlier one */
+  if (session->state == RTSP_STATE_INIT && session->redirect_count == 0)
+    rtsp_fast_start_load(session);
+  int r = resolver_lookup(session->server_host, session->server_port, SOCK_STREAM, &session->connect_results, &error,
+                          rtsp_on_resolved, session, &session->resolve_query);
+  if (r < 0) {
+    logger(LOG_ERROR, "RTSP: Cannot resolve hostname %s: %s", session->server_host, error);
+    return -1;
+  }
+  if (r > 0) {
+    logger(LOG_DEBUG, "RTSP: Resolving %s", session->server_host);
+    if (session->state != RTSP_STATE_RECONNECTING) {
+      rtsp_session_set_state(session, RTSP_STATE_CONNECTING);
+    }
+    session->last_state_change_ms = get_time_ms();
+    return 0;
+  }
+
+  return rtsp_connect_resolved(session);
+}
+
 int rtsp_handle_socket_event(rtsp_session_t *session, uint32_t events) {
   int result;
 
   /* Handle in-progress connect FIRST (both initial and reconnect for
    * TEARDOWN).  A failed candidate falls back to the next address from the
-   * getaddrinfo list instead of erroring out. */
+   * resolver list instead of erroring out. */
   if (session->state == RTSP_STATE_CONNECTING || session->state == RTSP_STATE_RECONNECTING) {
     int sock_error = 0;
     socklen_t error_len = sizeof(sock_error);
@@ -967,6 +1025,10 @@ int rtsp_handle_socket_event(rtsp_session_t *session, uint32_t events) {
 
   /* Handle writable socket - try to send pending data */
   if (events & POLLER_OUT) {
+    if (session->rtcp_out_len > 0 && rtsp_flush_rtcp_out(session) < 0) {
+      rtsp_session_set_state(session, RTSP_STATE_ERROR);
+      return -1;
+    }
     if (session->pending_request_len > 0 && session->pending_request_sent < session->pending_request_len) {
       result = rtsp_try_send_pending(session);
       if (result < 0) {
@@ -1214,6 +1276,15 @@ int rtsp_send_keepalive(rtsp_session_t *session) {
  * Returns: 0 = complete, -1 = error, EAGAIN = would block (handled internally)
  */
 static int rtsp_try_send_pending(rtsp_session_t *session) {
+  /* A partly written interleaved report has to go out first */
+  if (session->rtcp_out_len > 0) {
+    int flushed = rtsp_flush_rtcp_out(session);
+    if (flushed < 0)
+      return -1;
+    if (flushed > 0)
+      return 0;
+  }
+
   if (session->pending_request_sent >= session->pending_request_len) {
     return 0; /* Already sent */
   }
@@ -1243,6 +1314,7 @@ static int rtsp_try_send_pending(rtsp_session_t *session) {
   if (session->pending_request_sent >= session->pending_request_len) {
     /* Send complete - now await response */
     logger(LOG_DEBUG, "RTSP: Request sent completely (%zu bytes)", session->pending_request_len);
+    session->request_sent_ms = get_time_ms();
     session->pending_request_len = 0;
     session->pending_request_sent = 0;
     session->awaiting_response = 1;
@@ -1377,6 +1449,12 @@ static int rtsp_try_receive_response(rtsp_session_t *session) {
   session->awaiting_response = 0;
   session->awaiting_keepalive_response = 0;
 
+  /* Control round trips stand in for the RTT RTCP can't give a receiver */
+  if (session->request_sent_ms > 0 && session->conn) {
+    rtcp_receiver_add_rtt(&session->conn->stream.rtcp, get_time_ms() - session->request_sent_ms);
+    session->request_sent_ms = 0;
+  }
+
   if (parse_result < 0) {
     return RTSP_RESPONSE_ERROR;
   }
@@ -1458,6 +1536,8 @@ static int rtsp_try_receive_response(rtsp_session_t *session) {
       session->response_buffer_pos = 0;
       return RTSP_RESPONSE_DURATION;
     }
+    /* A Session ID handed out before SETUP can't be reused by a fast start */
+    session->describe_cacheable = session->redirect_count == 0 && session->session_id[0] == '\0';
     rtsp_session_set_state(session, RTSP_STATE_DESCRIBED);
     session->response_buffer_pos = 0;
     return RTSP_RESPONSE_ADVANCE;
@@ -1470,6 +1550,7 @@ static int rtsp_try_receive_response(rtsp_session_t *session) {
 
   if (session->state == RTSP_STATE_AWAITING_PLAY) {
     rtsp_session_set_state(session, RTSP_STATE_PLAYING);
+    rtsp_fast_start_store(session);
 
     /* For TCP interleaved mode, preserve any RTP data that came after PLAY
      * response */
@@ -1487,6 +1568,11 @@ static int rtsp_try_receive_response(rtsp_session_t *session) {
   } else {
     /* Clear response buffer for other states */
     session->response_buffer_pos = 0;
+    /* A rejected request was rewound (authentication, fast start fallback):
+     * the state machine must send again */
+    if (session->state == RTSP_STATE_CONNECTED || session->state == RTSP_STATE_DESCRIBED ||
+        session->state == RTSP_STATE_SETUP)
+      return RTSP_RESPONSE_ADVANCE;
   }
 
   return RTSP_RESPONSE_OK;
@@ -1497,6 +1583,11 @@ int rtsp_state_machine_advance(rtsp_session_t *session) {
 
   switch (session->state) {
   case RTSP_STATE_CONNECTED:
+    if (session->fast_start) {
+      /* SDP and transport known from an earlier session: go straight to SETUP */
+      rtsp_session_set_state(session, RTSP_STATE_DESCRIBED);
+      return rtsp_state_machine_advance(session);
+    }
     /* Ready to send OPTIONS (RFC 2326 requires OPTIONS before DESCRIBE) */
     extra_headers[0] = '\0'; /* No extra headers needed for OPTIONS */
     if (rtsp_prepare_request(session, RTSP_METHOD_OPTIONS, NULL, extra_headers) < 0) {
@@ -1523,8 +1614,11 @@ int rtsp_state_machine_advance(rtsp_session_t *session) {
     int udp_setup_ok = 0;
     int advertised_rtp_port, advertised_rtcp_port;
 
-    /* Check if UDP sockets were already created for STUN */
-    if (session->rtp_socket >= 0) {
+    /* Check if UDP sockets were already created for STUN; a fast start
+     * that settled on TCP last time does not need them */
+    if (session->fast_start_tcp) {
+      udp_setup_ok = 0;
+    } else if (session->rtp_socket >= 0) {
       udp_setup_ok = 1;
     } else if (rtsp_setup_udp_sockets(session) == 0) {
       udp_setup_ok = 1;
@@ -1644,11 +1738,99 @@ int rtsp_state_machine_advance(rtsp_session_t *session) {
   }
 }
 
+/**
+ * Write what is left of a queued interleaved receiver report
+ * @return 0 once nothing is left, 1 if the socket is full, -1 on error
+ */
+static int rtsp_flush_rtcp_out(rtsp_session_t *session) {
+  while (session->rtcp_out_sent < session->rtcp_out_len) {
+    ssize_t sent = send(session->socket, session->rtcp_out + session->rtcp_out_sent,
+                        session->rtcp_out_len - session->rtcp_out_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EAGAIN)
+        return 1;
+      logger(LOG_ERROR, "RTSP: Failed to send RTCP report: %s", strerror(errno));
+      session->rtcp_out_len = 0;
+      session->rtcp_out_sent = 0;
+      return -1;
+    }
+    if (sent == 0)
+      return 1;
+    session->rtcp_out_sent += (size_t)sent;
+  }
+  session->rtcp_out_len = 0;
+  session->rtcp_out_sent = 0;
+  return 0;
+}
+
+/* Without RTCP from the server yet, send reports to its RTSP address */
+static int rtsp_guess_rtcp_peer(rtsp_session_t *session) {
+  socklen_t len = sizeof(session->rtcp_peer);
+
+  if (session->server_rtcp_port <= 0 || session->socket < 0)
+    return -1;
+  if (getpeername(session->socket, (struct sockaddr *)&session->rtcp_peer, &len) < 0)
+    return -1;
+  sockaddr_set_port((struct sockaddr *)&session->rtcp_peer, (uint16_t)session->server_rtcp_port);
+  session->rtcp_peer_len = len;
+  return 0;
+}
+
+/**
+ * Send a receiver report on the stream this session feeds: to the server's
+ * RTCP port in UDP mode, as an interleaved frame on the RTCP channel in TCP
+ * mode.  A report never splits a request that is partly written; it is
+ * skipped until the next interval instead.
+ */
+static void rtsp_send_receiver_report(rtsp_session_t *session, int64_t now) {
+  rtcp_receiver_t *rtcp = &session->conn->stream.rtcp;
+
+  session->last_rtcp_report_ms = now;
+
+  if (session->transport_mode == RTSP_TRANSPORT_UDP) {
+    uint8_t report[RTCP_REPORT_MAX_SIZE];
+
+    if (session->rtcp_socket < 0 || (session->rtcp_peer_len == 0 && rtsp_guess_rtcp_peer(session) < 0))
+      return;
+    size_t len = rtcp_receiver_build_report(rtcp, report, sizeof(report), get_time_us());
+    if (len > 0 && sendto(session->rtcp_socket, report, len, MSG_DONTWAIT | MSG_NOSIGNAL,
+                          (struct sockaddr *)&session->rtcp_peer, session->rtcp_peer_len) < 0)
+      logger(LOG_DEBUG, "RTSP: Failed to send RTCP report: %s", strerror(errno));
+    return;
+  }
+
+  if (session->socket < 0 || session->rtcp_out_len > 0 ||
+      (session->pending_request_len > 0 && session->pending_request_sent > 0))
+    return;
+
+  size_t len = rtcp_receiver_build_report(rtcp, session->rtcp_out + 4, sizeof(session->rtcp_out) - 4, get_time_us());
+  if (len == 0)
+    return;
+  session->rtcp_out[0] = '$';
+  session->rtcp_out[1] = (uint8_t)session->rtcp_channel;
+  session->rtcp_out[2] = (uint8_t)(len >> 8);
+  session->rtcp_out[3] = (uint8_t)len;
+  session->rtcp_out_len = len + 4;
+  session->rtcp_out_sent = 0;
+
+  if (rtsp_flush_rtcp_out(session) > 0 && session->epoll_fd >= 0) {
+    /* Finish it (and any request queued meanwhile) once writable */
+    poller_mod(session->epoll_fd, session->socket, POLLER_IN | POLLER_OUT | POLLER_HUP | POLLER_ERR | POLLER_RDHUP);
+  }
+}
+
 int rtsp_session_tick(rtsp_session_t *session, int64_t now) {
   if (!session || !session->initialized) {
     return 0;
   }
 
+  if (session->connect_failed) {
+    /* Asynchronous lookup or connect failed */
+    session->connect_failed = 0;
+    rtsp_session_set_state(session, RTSP_STATE_ERROR);
+    return -1;
+  }
+
   /* Check state timeout */
   if (session->last_state_change_ms > 0) {
     int64_t elapsed = now - session->last_state_change_ms;
@@ -1721,36 +1903,72 @@ int rtsp_session_tick(rtsp_session_t *session, int64_t now) {
     }
   }
 
+  /* Periodic RTCP receiver report once media flows; the first one comes
+   * after half an interval (RFC 3550 section 6.2) */
+  if (session->state == RTSP_STATE_PLAYING && session->first_media_received && session->conn) {
+    if (session->last_rtcp_report_ms == 0)
+      session->last_rtcp_report_ms = now - RTCP_REPORT_INTERVAL_MS / 2;
+    if (now - session->last_rtcp_report_ms >= RTCP_REPORT_INTERVAL_MS)
+      rtsp_send_receiver_report(session, now);
+  }
+
   return 0;
 }
 
+/**
+ * Hand a received RTP packet to the clients of this session: a copy to every
+ * client sharing it, then the buffer itself to the owning connection (unless
+ * its client is gone and the session only lingers)
+ * @return bytes forwarded to the owning connection
+ */
+static int rtsp_deliver_rtp(connection_t *conn, buffer_ref_t *buf) {
+  if (conn->stream.rtsp_share)
+    rtsp_share_deliver(conn->stream.rtsp_share, buf);
+  if (conn->fd < 0)
+    return 0;
+  return stream_process_rtp_payload(&conn->stream, buf);
+}
+
 /**
  * Process '$'-prefixed interleaved frames already in response_buffer.
  * Does NOT recv() from socket — only consumes complete frames from buffer.
  * Stops when buffer starts with non-'$' data (e.g. RTSP response) or is empty.
+ *
+ * Frames are parsed in place behind a read cursor and each RTP payload is
+ * copied once, straight into its pool buffer.  Whatever is left past the
+ * cursor (a partial frame or an RTSP response) is moved to the front of the
+ * buffer a single time on the way out, so a recv() holding many frames costs
+ * one memmove rather than one per frame.
  * @return bytes forwarded (>=0), or -1 on error, -2 on ANNOUNCE (stream end)
  */
 static int rtsp_process_interleaved_buffer(rtsp_session_t *session, connection_t *conn) {
+  uint8_t *buf = session->response_buffer;
+  size_t end = session->response_buffer_pos;
+  size_t pos = 0;
   int bytes_forwarded = 0;
-  while (session->response_buffer_pos >= 4) {
-    if (session->response_buffer[0] != '$') {
+  int result = 0;
+
+  while (end - pos >= 4) {
+    uint8_t *frame = buf + pos;
+    size_t avail = end - pos;
+
+    if (frame[0] != '$') {
       /* Not interleaved data, check if it's an RTSP request from server */
-      if (session->response_buffer_pos >= 8 && (strncmp((char *)session->response_buffer, "ANNOUNCE", 8) == 0 ||
-                                                strncmp((char *)session->response_buffer, "OPTIONS", 7) == 0 ||
-                                                strncmp((char *)session->response_buffer, "SET_PARAMETER", 13) == 0)) {
+      if (avail >= 8 && (strncmp((char *)frame, "ANNOUNCE", 8) == 0 || strncmp((char *)frame, "OPTIONS", 7) == 0 ||
+                         (avail >= 13 && strncmp((char *)frame, "SET_PARAMETER", 13) == 0))) {
         /* Find end of RTSP message (double CRLF) */
-        char *end_marker = strstr((char *)session->response_buffer, "\r\n\r\n");
+        char *end_marker = memmem(frame, avail, "\r\n\r\n", 4);
         if (end_marker) {
-          size_t msg_len = (end_marker - (char *)session->response_buffer) + 4;
+          size_t msg_len = (size_t)(end_marker - (char *)frame) + 4;
 
-          logger(LOG_INFO, "RTSP: Received server request: %.32s", session->response_buffer);
+          logger(LOG_INFO, "RTSP: Received server request: %.32s", frame);
 
-          int is_announce = (strncmp((char *)session->response_buffer, "ANNOUNCE", 8) == 0);
+          int is_announce = (strncmp((char *)frame, "ANNOUNCE", 8) == 0);
 
           /* Extract CSeq if present for response */
           char cseq_buf[32] = "0";
-          char *cseq_line = strstr((char *)session->response_buffer, "CSeq:");
-          if (cseq_line && cseq_line < end_marker) {
+          char *cseq_line = memmem(frame, msg_len, "CSeq:", 5);
+          if (cseq_line) {
             sscanf(cseq_line, "CSeq: %31s", cseq_buf);
           }
 
@@ -1769,13 +1987,13 @@ static int rtsp_process_interleaved_buffer(rtsp_session_t *session, connection_t
             }
           }
 
-          /* Remove processed message from buffer */
-          memmove(session->response_buffer, session->response_buffer + msg_len, session->response_buffer_pos - msg_len);
-          session->response_buffer_pos -= msg_len;
+          /* Consume processed message */
+          pos += msg_len;
 
           if (is_announce) {
             logger(LOG_INFO, "RTSP: Server sent ANNOUNCE, stream may be ending");
-            return -2; /* Treat as stream end */
+            result = -2; /* Treat as stream end */
+            break;
           }
 
           continue; /* Process next packet in buffer */
@@ -1789,13 +2007,8 @@ static int rtsp_process_interleaved_buffer(rtsp_session_t *session, connection_t
       }
     }
 
-    uint8_t channel = session->response_buffer[1];
-    uint16_t packet_length = (session->response_buffer[2] << 8) | session->response_buffer[3];
-
-    /* Check if we have the complete packet */
-    if (session->response_buffer_pos < 4 + (size_t)packet_length) {
-      break; /* Wait for more data */
-    }
+    uint8_t channel = frame[1];
+    uint16_t packet_length = (uint16_t)((frame[2] << 8) | frame[3]);
 
     /* Sanity check: bound against the zero-copy destination buffer. */
     if (packet_length > BUFFER_POOL_BUFFER_SIZE) {
@@ -1803,19 +2016,23 @@ static int rtsp_process_interleaved_buffer(rtsp_session_t *session, connection_t
              "RTSP: Received packet too large (%d bytes, max %d), attempting "
              "resync",
              packet_length, BUFFER_POOL_BUFFER_SIZE);
-      uint8_t *next_marker = memchr(session->response_buffer + 1, '$', session->response_buffer_pos - 1);
+      uint8_t *next_marker = memchr(frame + 1, '$', avail - 1);
       if (next_marker) {
-        size_t skip = next_marker - session->response_buffer;
-        memmove(session->response_buffer, next_marker, session->response_buffer_pos - skip);
-        session->response_buffer_pos -= skip;
+        size_t skip = (size_t)(next_marker - frame);
+        pos += skip;
         logger(LOG_DEBUG, "RTSP: Resynced stream, skipped %zu bytes", skip);
       } else {
-        session->response_buffer_pos = 0;
+        pos = end;
         logger(LOG_DEBUG, "RTSP: No sync marker found, buffer reset");
       }
       break;
     }
 
+    /* Check if we have the complete packet */
+    if (avail < 4 + (size_t)packet_length) {
+      break; /* Wait for more data */
+    }
+
     /* Process RTP/RTCP packet based on channel.
      * During TEARDOWN, stream context (reorder, FEC, etc.) is already freed,
      * so skip payload processing and just consume the frame from the buffer. */
@@ -1823,13 +2040,13 @@ static int rtsp_process_interleaved_buffer(rtsp_session_t *session, connection_t
       if (channel == session->rtp_channel) {
         buffer_ref_t *packet_buf = buffer_pool_alloc();
         if (packet_buf) {
-          memcpy(packet_buf->data, &session->response_buffer[4], packet_length);
+          memcpy(packet_buf->data, frame + 4, packet_length);
           packet_buf->data_size = (size_t)packet_length;
           if (!session->first_media_received) {
             session->first_media_received = 1;
             logger(LOG_DEBUG, "RTSP: First media packet received (TCP)");
           }
-          int pb = stream_process_rtp_payload(&conn->stream, packet_buf);
+          int pb = rtsp_deliver_rtp(conn, packet_buf);
           if (pb > 0)
             bytes_forwarded += pb;
           buffer_ref_put(packet_buf);
@@ -1838,18 +2055,21 @@ static int rtsp_process_interleaved_buffer(rtsp_session_t *session, connection_t
           logger(LOG_DEBUG, "RTSP TCP: Buffer pool exhausted, dropping packet");
         }
       } else if (channel == session->rtcp_channel) {
-        /* RTCP data - ignored */
+        rtsp_handle_rtcp_packet(session, frame + 4, (size_t)packet_length);
       }
     }
 
-    /* Remove processed packet from buffer */
-    int total_packet_size = 4 + packet_length;
-    memmove(session->response_buffer, &session->response_buffer[total_packet_size],
-            session->response_buffer_pos - total_packet_size);
-    session->response_buffer_pos -= total_packet_size;
+    pos += 4 + (size_t)packet_length;
   }
 
-  return bytes_forwarded;
+  /* Keep only the unconsumed tail */
+  if (pos > 0) {
+    if (pos < end)
+      memmove(buf, buf + pos, end - pos);
+    session->response_buffer_pos = end - pos;
+  }
+
+  return result < 0 ? result : bytes_forwarded;
 }
 
 int rtsp_handle_tcp_interleaved_data(rtsp_session_t *session, connection_t *conn) {
@@ -1857,13 +2077,13 @@ int rtsp_handle_tcp_interleaved_data(rtsp_session_t *session, connection_t *conn
 
   /* Outer loop: drain all available data for edge-triggered pollers
    * (epoll EPOLLET / kqueue EV_CLEAR) where the read event fires only once
-   * per data arrival.  The inner recv loop may fill the small response buffer
+   * per data arrival.  The inner recv loop may fill the response buffer
    * before hitting EAGAIN; after processing we must loop back to recv more. */
   for (;;) {
     /* Pause upstream BEFORE recv when client queue is near limit, so data
      * accumulates in the upstream TCP receive buffer rather than being dropped
      * at the application layer (which would tear holes in the RTP stream). */
-    if (connection_should_pause_upstream(conn)) {
+    if (connection_should_pause_upstream(conn) && !rtsp_share_is_shared(conn->stream.rtsp_share)) {
       rtsp_pause_upstream(session);
       return total_forwarded;
     }
@@ -1939,11 +2159,28 @@ int rtsp_handle_udp_rtp_data(rtsp_session_t *session, connection_t *conn) {
   }
 
   /* Drain all available packets for edge-triggered pollers (epoll EPOLLET / kqueue EV_CLEAR)
-   * where the read event fires only once per data arrival. */
+   * where the read event fires only once per data arrival.  Each recvmmsg()
+   * receives up to a batch of datagrams straight into pool buffers. */
   for (;;) {
-    /* Allocate a fresh buffer from pool for this receive operation */
-    buffer_ref_t *rtp_buf = buffer_pool_alloc();
-    if (!rtp_buf) {
+    buffer_ref_t *bufs[RTSP_UDP_RECV_BATCH];
+    struct iovec iovs[RTSP_UDP_RECV_BATCH];
+    platform_mmsghdr_t msgs[RTSP_UDP_RECV_BATCH];
+    unsigned int nbufs = 0;
+
+    while (nbufs < RTSP_UDP_RECV_BATCH) {
+      buffer_ref_t *buf = buffer_pool_alloc();
+      if (!buf)
+        break;
+      bufs[nbufs] = buf;
+      iovs[nbufs].iov_base = buf->data;
+      iovs[nbufs].iov_len = BUFFER_POOL_BUFFER_SIZE;
+      memset(&msgs[nbufs], 0, sizeof(msgs[nbufs]));
+      msgs[nbufs].msg_hdr.msg_iov = &iovs[nbufs];
+      msgs[nbufs].msg_hdr.msg_iovlen = 1;
+      nbufs++;
+    }
+
+    if (nbufs == 0) {
       /* Buffer pool exhausted - drop this packet */
       logger(LOG_DEBUG, "RTSP UDP: Buffer pool exhausted, dropping packet");
       session->packets_dropped++;
@@ -1953,35 +2190,87 @@ int rtsp_handle_udp_rtp_data(rtsp_session_t *session, connection_t *conn) {
       return total_bytes_written;
     }
 
-    /* Receive directly into zero-copy buffer (true zero-copy receive) */
-    int bytes_received = recv(session->rtp_socket, rtp_buf->data, BUFFER_POOL_BUFFER_SIZE, 0);
-    if (bytes_received < 0) {
-      buffer_ref_put(rtp_buf);
-      if (errno == EAGAIN)
+    int received = platform_recvmmsg(session->rtp_socket, msgs, nbufs);
+    if (received < 0) {
+      int saved_errno = errno;
+      for (unsigned int i = 0; i < nbufs; i++)
+        buffer_ref_put(bufs[i]);
+      if (saved_errno == EAGAIN)
         break; /* No more data available */
-      logger(LOG_ERROR, "RTSP: RTP receive failed: %s", strerror(errno));
+      logger(LOG_ERROR, "RTSP: RTP receive failed: %s", strerror(saved_errno));
       return -1;
     }
 
-    if (bytes_received == 0) {
+    for (unsigned int i = 0; i < nbufs; i++) {
+      buffer_ref_t *rtp_buf = bufs[i];
+      if ((int)i < received && msgs[i].msg_len > 0 && session->rtp_socket >= 0) {
+        rtp_buf->data_size = msgs[i].msg_len;
+        if (!session->first_media_received) {
+          session->first_media_received = 1;
+          logger(LOG_DEBUG, "RTSP: First media packet received (UDP)");
+        }
+        int pb = rtsp_deliver_rtp(conn, rtp_buf);
+        if (pb > 0)
+          total_bytes_written += pb;
+      }
       buffer_ref_put(rtp_buf);
-      break;
     }
 
-    rtp_buf->data_size = (size_t)bytes_received;
-    if (!session->first_media_received) {
-      session->first_media_received = 1;
-      logger(LOG_DEBUG, "RTSP: First media packet received (UDP)");
-    }
-    int pb = stream_process_rtp_payload(&conn->stream, rtp_buf);
-    buffer_ref_put(rtp_buf);
-    if (pb > 0)
-      total_bytes_written += pb;
+    /* A short batch means the socket is drained */
+    if ((unsigned int)received < nbufs || session->rtp_socket < 0)
+      break;
   }
 
   return total_bytes_written;
 }
 
+/* Account for an RTCP packet from the server */
+static void rtsp_handle_rtcp_packet(rtsp_session_t *session, const uint8_t *data, size_t len) {
+  if (!session->conn)
+    return;
+  int result = rtcp_receiver_on_rtcp(&session->conn->stream.rtcp, data, len, get_time_us());
+  if (result < 0)
+    logger(LOG_DEBUG, "RTSP: Ignoring malformed RTCP packet (%zu bytes)", len);
+  else if (result > 0)
+    logger(LOG_INFO, "RTSP: Server sent RTCP BYE");
+}
+
+void rtsp_handle_udp_rtcp_data(rtsp_session_t *session) {
+  uint8_t rtcp_buffers[RTSP_RTCP_RECV_BATCH][RTCP_BUFFER_SIZE];
+  struct sockaddr_storage sources[RTSP_RTCP_RECV_BATCH];
+  struct iovec iovs[RTSP_RTCP_RECV_BATCH];
+  platform_mmsghdr_t msgs[RTSP_RTCP_RECV_BATCH];
+
+  for (unsigned int i = 0; i < RTSP_RTCP_RECV_BATCH; i++) {
+    iovs[i].iov_base = rtcp_buffers[i];
+    iovs[i].iov_len = sizeof(rtcp_buffers[i]);
+  }
+
+  /* Drain everything for edge-triggered pollers */
+  for (;;) {
+    memset(msgs, 0, sizeof(msgs));
+    for (unsigned int i = 0; i < RTSP_RTCP_RECV_BATCH; i++) {
+      msgs[i].msg_hdr.msg_name = &sources[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(sources[i]);
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int received = platform_recvmmsg(session->rtcp_socket, msgs, RTSP_RTCP_RECV_BATCH);
+    for (int i = 0; i < received; i++) {
+      if (msgs[i].msg_len == 0)
+        continue;
+      /* Reports go back to where the server's RTCP comes from */
+      if (msgs[i].msg_hdr.msg_namelen > 0 && msgs[i].msg_hdr.msg_namelen <= sizeof(session->rtcp_peer)) {
+        memcpy(&session->rtcp_peer, &sources[i], msgs[i].msg_hdr.msg_namelen);
+        session->rtcp_peer_len = msgs[i].msg_hdr.msg_namelen;
+      }
+      rtsp_handle_rtcp_packet(session, rtcp_buffers[i], msgs[i].msg_len);
+    }
+    if (received < RTSP_RTCP_RECV_BATCH)
+      break;
+  }
+}
+
 /**
  * Force cleanup - immediately close all sockets and reset session
  * Used when TEARDOWN cannot be sent or after TEARDOWN completes
@@ -1998,6 +2287,9 @@ static void rtsp_force_cleanup(rtsp_session_t *session) {
 
   /* Free pending connect candidates if any */
   rtsp_free_connect_results(session);
+  resolver_cancel(session->nat_probe_query);
+  session->nat_probe_query = NULL;
+  session->connect_failed = 0;
 
   /* Reset response buffer position */
   session->response_buffer_pos = 0;
@@ -2325,6 +2617,18 @@ static int rtsp_parse_response_header(rtsp_session_t *session, const char *respo
       goto cleanup;
     }
 
+    if (session->fast_start && session->state == RTSP_STATE_AWAITING_SETUP) {
+      /* The cached SETUP URL or transport is stale: do the full handshake */
+      logger(LOG_INFO, "RTSP: SETUP from cached DESCRIBE failed with %d, retrying with DESCRIBE", status_code);
+      rtsp_fast_start_forget(session);
+      session->fast_start = 0;
+      session->fast_start_tcp = 0;
+      session->setup_url[0] = '\0';
+      rtsp_session_set_state(session, RTSP_STATE_CONNECTED);
+      result = 0;
+      goto cleanup;
+    }
+
     logger(LOG_ERROR, "RTSP: Server returned error code %d", status_code);
     result = -1;
     goto cleanup;
@@ -2750,18 +3054,12 @@ done:
   }
 }
 
-static void rtsp_send_udp_nat_probe(rtsp_session_t *session) {
-  char port_str[RTSP_PORT_STRING_SIZE];
-  struct addrinfo hints;
-  struct addrinfo *result = NULL;
+/* Send the NAT probes to the resolved server source address */
+static void rtsp_send_nat_probe_packets(rtsp_session_t *session, struct addrinfo *result) {
   struct addrinfo *rp;
   uint8_t rtp_packet[12];
   uint8_t rtcp_packet[8];
 
-  if (!session || session->server_source_addr[0] == '\0') {
-    return;
-  }
-
   /* Build minimal RTP packet - 12 bytes */
   memset(rtp_packet, 0, sizeof(rtp_packet));
   rtp_packet[0] = 0x80; /* V=2, P=0, X=0, CC=0 */
@@ -2774,17 +3072,6 @@ static void rtsp_send_udp_nat_probe(rtsp_session_t *session) {
   rtcp_packet[2] = 0x00; /* length in words - 1 (high byte) */
   rtcp_packet[3] = 0x01; /* length in words - 1 (low byte) = 1 */
 
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = SOCK_DGRAM;
-  hints.ai_protocol = IPPROTO_UDP;
-
-  /* Resolve server address once for both RTP and RTCP */
-  snprintf(port_str, sizeof(port_str), "%d", session->server_rtp_port);
-  if (getaddrinfo(session->server_source_addr, port_str, &hints, &result) != 0) {
-    return;
-  }
-
   /* Pick the first address matching the UDP socket address family */
   for (rp = result; rp != NULL; rp = rp->ai_next) {
     if (rp->ai_family == session->upstream_family) {
@@ -2807,14 +3094,49 @@ static void rtsp_send_udp_nat_probe(rtsp_session_t *session) {
     if (session->server_rtcp_port > 0 && session->rtcp_socket >= 0) {
       sockaddr_set_port(rp->ai_addr, (uint16_t)session->server_rtcp_port);
       sendto(session->rtcp_socket, rtcp_packet, sizeof(rtcp_packet), 0, rp->ai_addr, rp->ai_addrlen);
+      if (session->rtcp_peer_len == 0 && rp->ai_addrlen <= sizeof(session->rtcp_peer)) {
+        memcpy(&session->rtcp_peer, rp->ai_addr, rp->ai_addrlen);
+        session->rtcp_peer_len = rp->ai_addrlen;
+      }
     }
   }
 
-  freeaddrinfo(result);
   logger(LOG_DEBUG, "RTSP: Sent NAT probe packets to %s:%d/%d", session->server_source_addr, session->server_rtp_port,
          session->server_rtcp_port);
 }
 
+static void rtsp_on_nat_probe_resolved(void *ctx, struct addrinfo *results, const char *error) {
+  rtsp_session_t *session = ctx;
+
+  session->nat_probe_query = NULL;
+  if (!results) {
+    logger(LOG_DEBUG, "RTSP: Cannot resolve NAT probe target %s: %s", session->server_source_addr, error);
+    return;
+  }
+  rtsp_send_nat_probe_packets(session, results);
+  resolver_freeaddrinfo(results);
+}
+
+static void rtsp_send_udp_nat_probe(rtsp_session_t *session) {
+  struct addrinfo *result = NULL;
+  const char *error = NULL;
+
+  if (!session || session->server_source_addr[0] == '\0') {
+    return;
+  }
+
+  /* Resolve server address once for both RTP and RTCP; a pending lookup sends
+   * the probes when it completes */
+  resolver_cancel(session->nat_probe_query);
+  session->nat_probe_query = NULL;
+  if (resolver_lookup(session->server_source_addr, session->server_rtp_port, SOCK_DGRAM, &result, &error,
+                      rtsp_on_nat_probe_resolved, session, &session->nat_probe_query) != 0) {
+    return;
+  }
+  rtsp_send_nat_probe_packets(session, result);
+  resolver_freeaddrinfo(result);
+}
+
 static void rtsp_parse_transport_header(rtsp_session_t *session, const char *transport) {
   char *server_port_param;
   char *interleaved_param;
@@ -2,12 +2,15 @@
 #define __RTSP_H__
 
 #include <stdint.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 
+#include "rtcp.h"
 #include "stun.h"
 
-/* Forward declaration */
+/* Forward declarations */
 struct addrinfo;
+struct resolver_query_s;
 
 #define RTSP_DISABLE_TCP_TRANSPORT 0 /* To debug UDP transport, set to 1 */
 
@@ -21,8 +24,13 @@ struct addrinfo;
 /* RTCP buffer size - same as RTP buffer pool for consistency */
 #define RTCP_BUFFER_SIZE 1536
 
-/* RTSP response buffer - for server responses and SDP descriptions */
-#define RTSP_RESPONSE_BUFFER_SIZE 4096
+/* Datagrams taken from the UDP RTP / RTCP socket per recvmmsg() call */
+#define RTSP_UDP_RECV_BATCH 16
+#define RTSP_RTCP_RECV_BATCH 4
+
+/* RTSP response buffer - for server responses and SDP descriptions, and the
+ * receive window for TCP interleaved frames (about a dozen per recv) */
+#define RTSP_RESPONSE_BUFFER_SIZE 16384
 
 /* RTSP request buffer - for building outgoing requests */
 #define RTSP_REQUEST_BUFFER_SIZE 4096
@@ -47,6 +55,9 @@ struct addrinfo;
 
 #define RTSP_CREDENTIAL_SIZE 128
 
+/* Session key - ifname|user:password@host:port/path, see rtsp_session_key() */
+#define RTSP_SESSION_KEY_SIZE (RTSP_SERVER_PATH_SIZE + RTSP_SERVER_HOST_SIZE + 2 * RTSP_CREDENTIAL_SIZE + 64)
+
 /* URL copy buffer - for URL parsing operations. Same sizing rationale as
  * RTSP_SERVER_URL_SIZE. */
 #define RTSP_URL_COPY_SIZE 2048
@@ -129,11 +140,16 @@ typedef struct {
   char server_path[RTSP_SERVER_PATH_SIZE]; /* RTSP path with query string */
 
   /* Dual-stack async connect state (sequential candidate fallback).
-   * connect_results owns the getaddrinfo list; connect_next points to the
-   * next untried candidate. */
+   * connect_results owns the resolver's candidate list; connect_next points
+   * to the next untried candidate.  resolve_query is the pending DNS lookup
+   * (state stays CONNECTING / RECONNECTING meanwhile); connect_failed reports
+   * a lookup or connect failure that happened outside the socket handler. */
   struct addrinfo *connect_results;
   struct addrinfo *connect_next;
   int connect_last_errno;
+  struct resolver_query_s *resolve_query;
+  int connect_failed;
+  struct resolver_query_s *nat_probe_query; /* Pending lookup of server_source_addr */
   int upstream_family; /* Address family of the connected/connecting upstream
                           (AF_INET / AF_INET6) */
   int redirect_count;  /* Number of redirects followed */
@@ -152,6 +168,11 @@ typedef struct {
   char auth_opaque[RTSP_CREDENTIAL_SIZE]; /* Digest auth opaque */
   int auth_retry_count;                   /* Number of auth retries (prevent infinite loops) */
 
+  /* Fast start: the DESCRIBE result of an earlier session for this URL */
+  int fast_start;         /* OPTIONS and DESCRIBE are skipped, SETUP uses the cached result */
+  int fast_start_tcp;     /* The cached SETUP settled on TCP interleaved: offer only TCP */
+  int describe_cacheable; /* This session's DESCRIBE result may be reused by later sessions */
+
   /* Transport mode configuration */
   rtsp_transport_mode_t transport_mode;         /* Current transport mode */
   rtsp_transport_protocol_t transport_protocol; /* Current transport protocol */
@@ -176,6 +197,15 @@ typedef struct {
   /* Statistics */
   uint64_t packets_dropped; /* Packets dropped due to backpressure */
 
+  /* RTCP receiver reports; the statistics they carry live in conn->stream.rtcp */
+  int64_t last_rtcp_report_ms;            /* When the last report was sent, 0 if never */
+  struct sockaddr_storage rtcp_peer;      /* Server RTCP address for UDP reports */
+  socklen_t rtcp_peer_len;                /* 0 until that address is known */
+  uint8_t rtcp_out[RTCP_REPORT_MAX_SIZE]; /* Interleaved report not yet fully written */
+  size_t rtcp_out_len;                    /* Length of the report in rtcp_out */
+  size_t rtcp_out_sent;                   /* Bytes of it already written */
+  int64_t request_sent_ms;                /* When the last request went out, for RTT */
+
   /* Cleanup state */
   int cleanup_done;         /* Flag: cleanup has been completed */
   int first_media_received; /* Flag: first media packet received in PLAYING */
@@ -207,8 +237,8 @@ typedef struct {
 
   /* Buffering */
   uint8_t response_buffer[RTSP_RESPONSE_BUFFER_SIZE]; /* Buffer for RTSP
-                                                         responses (control
-                                                         plane, not media) */
+                                                         responses and TCP
+                                                         interleaved frames */
 
   /* Flow control state (TCP interleaved transport only) */
   int upstream_paused; /* 1 = upstream recv currently suspended due to client backpressure */
@@ -238,6 +268,15 @@ void rtsp_session_init(rtsp_session_t *session);
 int rtsp_parse_server_url(rtsp_session_t *session, const char *rtsp_url, const char *fallback_username,
                           const char *fallback_password);
 
+/**
+ * Build the key identifying a session's upstream: interface, credentials,
+ * lower-case host, port and path with query
+ * @param session RTSP session with a parsed server URL
+ * @param key Output buffer
+ * @param key_size Size of key (RTSP_SESSION_KEY_SIZE)
+ */
+void rtsp_session_key(const rtsp_session_t *session, char *key, size_t key_size);
+
 /**
  * Connect to RTSP server (non-blocking)
  * @param session RTSP session (must have epoll_fd set)
@@ -276,6 +315,12 @@ int rtsp_handle_tcp_interleaved_data(rtsp_session_t *session, struct connection_
  */
 int rtsp_handle_udp_rtp_data(rtsp_session_t *session, struct connection_s *conn);
 
+/**
+ * Drain the UDP RTCP socket, accounting for sender reports and BYE
+ * @param session RTSP session
+ */
+void rtsp_handle_udp_rtcp_data(rtsp_session_t *session);
+
 /**
  * Send RTSP TEARDOWN and cleanup session
  * @param session RTSP session
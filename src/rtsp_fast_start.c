@@ -0,0 +1,121 @@
+#include "rtsp_fast_start.h"
+#include "rtp2httpd.h"
+#include "status.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  char *key;       /* rtsp_session_key(), NULL when unused */
+  char *setup_url; /* Resolved SETUP URL, empty for aggregate control */
+  int tcp;         /* Server chose TCP interleaved transport */
+  rtsp_auth_type_t auth_type;
+  char auth_realm[RTSP_CREDENTIAL_SIZE];
+  char auth_nonce[RTSP_CREDENTIAL_SIZE];
+  char auth_opaque[RTSP_CREDENTIAL_SIZE];
+  int64_t expires_at;
+} rtsp_fast_start_entry_t;
+
+/* Per event loop, like the sessions filling it */
+static _Thread_local rtsp_fast_start_entry_t entries[RTSP_FAST_START_CACHE_SIZE];
+
+static void entry_clear(rtsp_fast_start_entry_t *entry) {
+  free(entry->key);
+  free(entry->setup_url);
+  memset(entry, 0, sizeof(*entry));
+}
+
+static rtsp_fast_start_entry_t *entry_find(const char *key) {
+  for (int i = 0; i < RTSP_FAST_START_CACHE_SIZE; i++) {
+    if (entries[i].key && strcmp(entries[i].key, key) == 0)
+      return &entries[i];
+  }
+  return NULL;
+}
+
+int rtsp_fast_start_load(rtsp_session_t *session) {
+  char key[RTSP_SESSION_KEY_SIZE];
+
+  if (!session || session->r2h_duration)
+    return 0;
+
+  rtsp_session_key(session, key, sizeof(key));
+  rtsp_fast_start_entry_t *entry = entry_find(key);
+  if (!entry)
+    return 0;
+  if (entry->expires_at <= get_time_ms()) {
+    entry_clear(entry);
+    return 0;
+  }
+
+  snprintf(session->setup_url, sizeof(session->setup_url), "%s", entry->setup_url);
+  session->auth_type = entry->auth_type;
+  memcpy(session->auth_realm, entry->auth_realm, sizeof(session->auth_realm));
+  memcpy(session->auth_nonce, entry->auth_nonce, sizeof(session->auth_nonce));
+  memcpy(session->auth_opaque, entry->auth_opaque, sizeof(session->auth_opaque));
+  session->fast_start = 1;
+  session->fast_start_tcp = entry->tcp;
+  session->describe_cacheable = 1;
+
+  if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS)
+    status_shared->worker_stats[worker_id].rtsp_fast_starts++;
+  logger(LOG_DEBUG, "RTSP: Fast start for %s from cached DESCRIBE", session->server_url);
+  return 1;
+}
+
+void rtsp_fast_start_store(const rtsp_session_t *session) {
+  char key[RTSP_SESSION_KEY_SIZE];
+
+  if (!session || !session->describe_cacheable || session->redirect_count)
+    return;
+
+  rtsp_session_key(session, key, sizeof(key));
+  rtsp_fast_start_entry_t *entry = entry_find(key);
+  if (!entry) {
+    /* Take a free slot, or the one closest to expiry */
+    entry = &entries[0];
+    for (int i = 0; i < RTSP_FAST_START_CACHE_SIZE; i++) {
+      if (!entries[i].key) {
+        entry = &entries[i];
+        break;
+      }
+      if (entries[i].expires_at < entry->expires_at)
+        entry = &entries[i];
+    }
+    entry_clear(entry);
+    entry->key = strdup(key);
+    if (!entry->key)
+      return;
+  }
+
+  char *setup_url = strdup(session->setup_url);
+  if (!setup_url) {
+    entry_clear(entry);
+    return;
+  }
+  free(entry->setup_url);
+  entry->setup_url = setup_url;
+  entry->tcp = session->transport_mode == RTSP_TRANSPORT_TCP;
+  entry->auth_type = session->auth_type;
+  memcpy(entry->auth_realm, session->auth_realm, sizeof(entry->auth_realm));
+  memcpy(entry->auth_nonce, session->auth_nonce, sizeof(entry->auth_nonce));
+  memcpy(entry->auth_opaque, session->auth_opaque, sizeof(entry->auth_opaque));
+  entry->expires_at = get_time_ms() + (int64_t)RTSP_FAST_START_TTL_SEC * 1000;
+}
+
+void rtsp_fast_start_forget(const rtsp_session_t *session) {
+  char key[RTSP_SESSION_KEY_SIZE];
+
+  if (!session)
+    return;
+  rtsp_session_key(session, key, sizeof(key));
+  rtsp_fast_start_entry_t *entry = entry_find(key);
+  if (entry)
+    entry_clear(entry);
+}
+
+void rtsp_fast_start_cleanup(void) {
+  for (int i = 0; i < RTSP_FAST_START_CACHE_SIZE; i++)
+    entry_clear(&entries[i]);
+}
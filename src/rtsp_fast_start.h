@@ -0,0 +1,50 @@
+#ifndef RTSP_FAST_START_H
+#define RTSP_FAST_START_H
+
+#include "rtsp.h"
+
+/* Upstreams remembered per event loop */
+#define RTSP_FAST_START_CACHE_SIZE 16
+
+/* Seconds a DESCRIBE result is reused after the session that produced it
+ * (or last reused it) reached PLAYING */
+#define RTSP_FAST_START_TTL_SEC 30
+
+/**
+ * RTSP fast start
+ *
+ * Zapping back to a channel normally repeats OPTIONS and DESCRIBE before
+ * SETUP, although the SETUP URL derived from the SDP, the transport the
+ * server picked and its authentication challenge rarely change.  Once a
+ * session reaches PLAYING these are remembered per event loop, keyed by
+ * rtsp_session_key(); the next session for the same URL within the TTL
+ * sends SETUP right after connecting, saving two round trips, and offers
+ * only TCP interleaved transport when that is what the server chose (no
+ * UDP sockets or STUN discovery).
+ *
+ * Sessions whose server hands out a Session ID before SETUP, and sessions
+ * that were redirected or only query the duration, are not remembered.  A
+ * SETUP that fails on cached data drops the entry and the session falls back
+ * to the full handshake.
+ */
+
+/**
+ * Load the cached DESCRIBE result for a session that is about to connect
+ * @param session Initialized session with a parsed server URL
+ * @return 1 if the session was set up for a fast start, 0 otherwise
+ */
+int rtsp_fast_start_load(rtsp_session_t *session);
+
+/**
+ * Remember (or refresh) the DESCRIBE result of a session that reached
+ * PLAYING; no-op unless session->describe_cacheable
+ */
+void rtsp_fast_start_store(const rtsp_session_t *session);
+
+/** Drop the entry a failed fast start was based on */
+void rtsp_fast_start_forget(const rtsp_session_t *session);
+
+/** Free this event loop's entries */
+void rtsp_fast_start_cleanup(void);
+
+#endif /* RTSP_FAST_START_H */
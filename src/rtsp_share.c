@@ -0,0 +1,343 @@
+#include "rtsp_share.h"
+#include "configuration.h"
+#include "connection.h"
+#include "http.h"
+#include "poller.h"
+#include "rtp2httpd.h"
+#include "rtsp.h"
+#include "status.h"
+#include "utils.h"
+#include "worker.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct rtsp_share_follower_s {
+  connection_t *conn;
+  struct rtsp_share_follower_s *next;
+} rtsp_share_follower_t;
+
+struct rtsp_share_s {
+  char *key;
+  connection_t *leader; /* Connection whose stream context owns the session */
+  rtsp_share_follower_t *followers;
+  rtsp_share_follower_t *followers_tail;
+  int64_t parked_until; /* Leader's client is gone, tear down at this time (0 = not parked) */
+  struct rtsp_share_s *next;
+};
+
+/* Connections whose parked session was adopted by a new client; closed on
+ * the next tick, outside the worker's connection walk */
+typedef struct rtsp_share_retired_s {
+  connection_t *conn;
+  struct rtsp_share_retired_s *next;
+} rtsp_share_retired_t;
+
+/* Sessions are shared within an event loop, like the connections using them */
+static _Thread_local rtsp_share_t *shares = NULL;
+static _Thread_local rtsp_share_retired_t *retired = NULL;
+
+/* The session is connecting or playing and has not failed or begun teardown */
+static int session_is_live(const rtsp_session_t *session) {
+  return session->initialized && !session->cleanup_done && !session->teardown_requested &&
+         session->state <= RTSP_STATE_PLAYING;
+}
+
+static int share_is_joinable(const rtsp_share_t *share) {
+  if (share->parked_until)
+    return share->leader->stream.rtsp.state == RTSP_STATE_PLAYING && session_is_live(&share->leader->stream.rtsp);
+  return share->leader->state != CONN_CLOSING && session_is_live(&share->leader->stream.rtsp);
+}
+
+/* The session may move to another connection: nothing outside the struct
+ * points into it (resolver lookups keep a pointer while pending) */
+static int share_can_hand_over(const rtsp_share_t *share) {
+  const rtsp_session_t *session = &share->leader->stream.rtsp;
+  return session_is_live(session) && !session->resolve_query && !session->nat_probe_query;
+}
+
+static void stats_count_join(void) {
+  if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS)
+    status_shared->worker_stats[worker_id].rtsp_share_joins++;
+}
+
+static rtsp_share_t *find_share(const char *key) {
+  for (rtsp_share_t *s = shares; s; s = s->next) {
+    if (strcmp(s->key, key) == 0 && share_is_joinable(s))
+      return s;
+  }
+  return NULL;
+}
+
+static void unlink_share(rtsp_share_t *share) {
+  rtsp_share_t **pp = &shares;
+  while (*pp) {
+    if (*pp == share) {
+      *pp = share->next;
+      share->next = NULL;
+      return;
+    }
+    pp = &(*pp)->next;
+  }
+}
+
+static connection_t *pop_follower(rtsp_share_t *share) {
+  rtsp_share_follower_t *f = share->followers;
+  if (!f)
+    return NULL;
+  share->followers = f->next;
+  if (!share->followers)
+    share->followers_tail = NULL;
+  connection_t *c = f->conn;
+  free(f);
+  return c;
+}
+
+static void share_free(rtsp_share_t *share) {
+  connection_t *c;
+  while ((c = pop_follower(share)) != NULL)
+    c->stream.rtsp_share = NULL;
+  if (share->leader)
+    share->leader->stream.rtsp_share = NULL;
+  free(share->key);
+  free(share);
+}
+
+/* The upstream is gone: followers that got no data yet are answered with a
+ * 503, the others end once their queue drains */
+static void fail_followers(rtsp_share_t *share) {
+  connection_t *c;
+  while ((c = pop_follower(share)) != NULL) {
+    c->stream.rtsp_share = NULL;
+    if (!c->headers_sent)
+      http_send_503(c);
+    else
+      connection_begin_drain_close(c);
+  }
+}
+
+/* Move the leader's session into another connection's stream context */
+static void hand_over(rtsp_share_t *share, connection_t *to) {
+  connection_t *from = share->leader;
+  rtsp_session_t *session = &to->stream.rtsp;
+
+  *session = from->stream.rtsp;
+  session->conn = to;
+  session->status_index = to->status_index;
+  fdmap_set(session->socket, to);
+  fdmap_set(session->rtp_socket, to);
+  fdmap_set(session->rtcp_socket, to);
+
+  /* The old owner has nothing left to tear down */
+  memset(&from->stream.rtsp, 0, sizeof(from->stream.rtsp));
+  from->stream.rtsp_share = NULL;
+
+  share->leader = to;
+  to->stream.rtsp_share = share;
+  if (session->upstream_paused)
+    rtsp_resume_upstream(session);
+}
+
+int rtsp_share_attach(connection_t *c) {
+  char key[RTSP_SESSION_KEY_SIZE];
+
+  if (!c)
+    return 0;
+
+  rtsp_session_key(&c->stream.rtsp, key, sizeof(key));
+  rtsp_share_t *share = find_share(key);
+
+  if (share && share->parked_until) {
+    /* Nobody was watching: the new client adopts the parked session */
+    connection_t *parked = share->leader;
+    rtsp_share_retired_t *r = calloc(1, sizeof(*r));
+    if (!r)
+      return 0;
+    hand_over(share, c);
+    share->parked_until = 0;
+    status_update_client_state(c->status_index, CLIENT_STATE_RTSP_PLAYING);
+    r->conn = parked;
+    r->next = retired;
+    retired = r;
+    logger(LOG_DEBUG, "RTSP: Resumed parked upstream session for %s", c->stream.rtsp.server_url);
+    stats_count_join();
+    return 1;
+  }
+
+  if (share) {
+    rtsp_share_follower_t *f = calloc(1, sizeof(*f));
+    if (!f)
+      return 0; /* Run our own session */
+    f->conn = c;
+    if (share->followers_tail)
+      share->followers_tail->next = f;
+    else
+      share->followers = f;
+    share->followers_tail = f;
+
+    /* The session is the leader's; this stream only reads from it */
+    memset(&c->stream.rtsp, 0, sizeof(c->stream.rtsp));
+    c->stream.rtsp_share = share;
+    status_update_client_state(c->status_index, share->leader->stream.rtsp.state == RTSP_STATE_PLAYING
+                                                    ? CLIENT_STATE_RTSP_PLAYING
+                                                    : CLIENT_STATE_RTSP_CONNECTING);
+    logger(LOG_DEBUG, "RTSP: Joined running upstream session for %s", share->leader->stream.rtsp.server_url);
+    stats_count_join();
+    return 1;
+  }
+
+  /* Lead a new session; without a share record the stream still works, it
+   * just can't be shared */
+  share = calloc(1, sizeof(*share));
+  if (!share)
+    return 0;
+  share->key = strdup(key);
+  if (!share->key) {
+    free(share);
+    return 0;
+  }
+  share->leader = c;
+  share->next = shares;
+  shares = share;
+  c->stream.rtsp_share = share;
+  return 0;
+}
+
+void rtsp_share_deliver(rtsp_share_t *share, const buffer_ref_t *buf) {
+  const uint8_t *data = (const uint8_t *)buf->data + buf->data_offset;
+
+  for (rtsp_share_follower_t *f = share->followers; f; f = f->next) {
+    connection_t *c = f->conn;
+    if (c->state == CONN_CLOSING)
+      continue;
+
+    buffer_ref_t *copy = buffer_pool_alloc();
+    if (!copy) {
+      logger(LOG_DEBUG, "RTSP: Buffer pool exhausted, dropping packet for shared client");
+      return;
+    }
+    memcpy(copy->data, data, buf->data_size);
+    copy->data_size = buf->data_size;
+    stream_process_rtp_payload(&c->stream, copy);
+    buffer_ref_put(copy);
+  }
+}
+
+int rtsp_share_is_shared(const rtsp_share_t *share) { return share && (share->followers || share->parked_until); }
+
+void rtsp_share_set_state(rtsp_share_t *share, client_state_type_t state) {
+  for (rtsp_share_follower_t *f = share->followers; f; f = f->next)
+    status_update_client_state(f->conn->status_index, state);
+}
+
+/* Keep the leader's session playing without its client */
+static void park(rtsp_share_t *share, connection_t *c) {
+  if (c->fd >= 0) {
+    fdmap_del(c->fd);
+    if (c->epfd >= 0)
+      poller_del(c->epfd, c->fd);
+    close(c->fd);
+    c->fd = -1;
+  }
+  c->state = CONN_CLOSING;
+  zerocopy_queue_cleanup(&c->zc_queue);
+
+  if (c->status_index >= 0) {
+    status_unregister_client(c->status_index);
+    c->status_index = -1;
+  }
+  c->stream.status_index = -1;
+  c->stream.rtsp.status_index = -1;
+
+  share->parked_until = get_time_ms() + (int64_t)config.rtsp_share_linger * 1000;
+  logger(LOG_DEBUG, "RTSP: Last client left, keeping upstream session for %ds", config.rtsp_share_linger);
+}
+
+int rtsp_share_leave(connection_t *c) {
+  rtsp_share_t *share = c ? c->stream.rtsp_share : NULL;
+  if (!share)
+    return 0;
+
+  if (share->leader != c) {
+    /* A follower: just stop copying packets to it */
+    rtsp_share_follower_t **pp = &share->followers;
+    rtsp_share_follower_t *prev = NULL;
+    while (*pp) {
+      rtsp_share_follower_t *f = *pp;
+      if (f->conn == c) {
+        *pp = f->next;
+        if (share->followers_tail == f)
+          share->followers_tail = prev;
+        free(f);
+        break;
+      }
+      prev = f;
+      pp = &f->next;
+    }
+    c->stream.rtsp_share = NULL;
+    return 0;
+  }
+
+  if (share->parked_until) {
+    /* Linger time is over or the worker is stopping */
+    unlink_share(share);
+    share_free(share);
+    return 0;
+  }
+
+  if (share->followers && share_can_hand_over(share)) {
+    connection_t *next;
+    while ((next = pop_follower(share)) != NULL) {
+      if (next->state == CONN_CLOSING) {
+        next->stream.rtsp_share = NULL;
+        continue;
+      }
+      hand_over(share, next);
+      logger(LOG_DEBUG, "RTSP: Upstream session for %s handed to a shared client", next->stream.rtsp.server_url);
+      return 0;
+    }
+  }
+
+  if (!share->followers && config.rtsp_share_linger > 0 && c->headers_sent &&
+      c->stream.rtsp.state == RTSP_STATE_PLAYING && share_can_hand_over(share)) {
+    park(share, c);
+    return 1;
+  }
+
+  unlink_share(share);
+  fail_followers(share);
+  share_free(share);
+  return 0;
+}
+
+void rtsp_share_tick(int64_t now) {
+  while (retired) {
+    rtsp_share_retired_t *r = retired;
+    retired = r->next;
+    worker_close_and_free_connection(r->conn);
+    free(r);
+  }
+
+  rtsp_share_t *s = shares;
+  while (s) {
+    rtsp_share_t *next = s->next;
+    if (s->parked_until && now >= s->parked_until) {
+      logger(LOG_DEBUG, "RTSP: No client came back, closing upstream session");
+      worker_close_and_free_connection(s->leader);
+    }
+    s = next;
+  }
+}
+
+void rtsp_share_cleanup(void) {
+  while (retired) {
+    rtsp_share_retired_t *r = retired;
+    retired = r->next;
+    free(r);
+  }
+  while (shares) {
+    rtsp_share_t *share = shares;
+    shares = share->next;
+    share_free(share);
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef RTSP_SHARE_H
+#define RTSP_SHARE_H
+
+#include "buffer_pool.h"
+#include "status.h"
+#include <stdint.h>
+
+/* Forward declarations */
+typedef struct connection_s connection_t;
+typedef struct rtsp_share_s rtsp_share_t;
+
+/* Upper bound for the rtsp-share-linger option (seconds) */
+#define RTSP_SHARE_LINGER_MAX 300
+
+/**
+ * Shared upstream RTSP sessions
+ *
+ * Live RTSP requests (no seek, start or duration query) for the same
+ * upstream URL, credentials and interface share one upstream session per
+ * event loop.  The first client leads: its stream context owns the
+ * rtsp_session_t and runs the handshake.  Later clients follow: every RTP
+ * packet the leader receives is copied into a pool buffer per follower and
+ * fed to the follower's own reorder / FEC path, so each client keeps its own
+ * send queue and backpressure.  A follower that joins mid-stream starts at
+ * the next packet.
+ *
+ * When the leader's client goes away the session is handed to the oldest
+ * follower.  When the last client leaves the session is torn down, or, with
+ * config.rtsp_share_linger, kept playing for that many seconds so a client
+ * coming back to the channel skips the handshake.
+ */
+
+/**
+ * Join the running session for the upstream of c's parsed, not yet
+ * connected RTSP session, or become the leader of a new one
+ * @param c Connection whose stream context was just initialized
+ * @return 1 if c was served by a running session (its own session was
+ * released), 0 if c must connect its session and lead
+ */
+int rtsp_share_attach(connection_t *c);
+
+/**
+ * Copy a packet received by the leader to every follower
+ * @param share Share led by the receiving connection
+ * @param buf RTP packet, not yet processed by the leader
+ */
+void rtsp_share_deliver(rtsp_share_t *share, const buffer_ref_t *buf);
+
+/** 1 if other clients depend on the leader's upstream (NULL gives 0) */
+int rtsp_share_is_shared(const rtsp_share_t *share);
+
+/** Mirror the leader's RTSP state on every follower's status entry */
+void rtsp_share_set_state(rtsp_share_t *share, client_state_type_t state);
+
+/**
+ * Detach a connection that is being closed
+ * A leading connection hands its session to a follower, or parks it when
+ * lingering is enabled; a parked connection stays in the worker's list with
+ * its client socket closed and must not be freed yet.
+ * @return 1 if c was parked, 0 if the caller proceeds with the close
+ */
+int rtsp_share_leave(connection_t *c);
+
+/** Close parked sessions whose linger time ran out */
+void rtsp_share_tick(int64_t now);
+
+/**
+ * Release all shares of this event loop; call before closing the remaining
+ * connections so that none of them is parked
+ */
+void rtsp_share_cleanup(void);
+
+#endif /* RTSP_SHARE_H */
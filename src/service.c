@@ -2300,6 +2300,19 @@ void service_hashmap_remove(service_t *service) {
   hashmap_delete(service_map, &service);
 }
 
+const char *service_type_name(service_type_t type) {
+  switch (type) {
+  case SERVICE_MRTP:
+    return "rtp";
+  case SERVICE_RTSP:
+    return "rtsp";
+  case SERVICE_HTTP:
+    return "http";
+  default:
+    return "-";
+  }
+}
+
 service_t *service_hashmap_get(const char *url) {
   if (service_map == NULL) {
     logger(LOG_ERROR, "Service hashmap not initialized");
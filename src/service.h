@@ -317,6 +317,14 @@ void service_hashmap_remove(service_t *service);
  */
 service_t *service_hashmap_get(const char *url);
 
+/**
+ * Short name of a service type ("rtp", "rtsp" or "http")
+ *
+ * @param type Service type
+ * @return Static string, "-" for an unknown type
+ */
+const char *service_type_name(service_type_t type);
+
 /**
  * Resolve upstream URL by substituting template placeholders or appending
  * seek parameters (query-append mode).
@@ -2,6 +2,8 @@
 #include "connection.h"
 #include "http.h"
 #include "rtp.h"
+#include "snapshot_cache.h"
+#include "snapshot_decoder.h"
 #include "utils.h"
 #include <errno.h>
 #include <fcntl.h>
@@ -9,7 +11,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
-#include <sys/stat.h>
 #include <unistd.h>
 
 /* MPEG2-TS constants */
@@ -85,6 +86,9 @@ void snapshot_cleanup(snapshot_context_t *ctx) {
   if (!ctx || !ctx->initialized)
     return;
 
+  /* A decoder may still be reading the frame from idr_frame_mmap */
+  snapshot_decoder_cancel(ctx);
+
   if (ctx->idr_frame_mmap && ctx->idr_frame_mmap != MAP_FAILED) {
     munmap(ctx->idr_frame_mmap, ctx->idr_frame_capacity);
     ctx->idr_frame_mmap = NULL;
@@ -206,98 +210,24 @@ static void cache_ts_header_packet(snapshot_context_t *ctx, const uint8_t *ts_pa
     ctx->ts_header_size += TS_PACKET_SIZE;
 }
 
-/**
- * Convert IDR frame to JPEG using external ffmpeg
- * Uses existing tmpfs mmap fd for input (MPEG2-TS format) and returns new fd
- * for JPEG output
- * @param idr_frame_fd File descriptor containing MPEG2-TS data with IDR frame
- * (already in tmpfs)
- * @param idr_frame_size MPEG2-TS data size
- * @param jpeg_fd Output: file descriptor for JPEG file (caller must close)
- * @param jpeg_size Output: JPEG file size
- * @return 0 on success, -1 on error
- */
-static int snapshot_convert_to_jpeg(int idr_frame_fd, size_t idr_frame_size, int *jpeg_fd, size_t *jpeg_size) {
-  if (idr_frame_fd < 0 || idr_frame_size == 0 || !jpeg_fd || !jpeg_size)
-    return -1;
-
-  *jpeg_fd = -1;
-  *jpeg_size = 0;
-
-  /* Create output file in /tmp */
-  char output_path[] = "/tmp/rtp2httpd_jpeg_XXXXXX";
-  int output_fd = mkstemp(output_path);
-  if (output_fd < 0) {
-    logger(LOG_ERROR, "Snapshot: Failed to create JPEG output file: %s", strerror(errno));
-    return -1;
-  }
-
-  /* Unlink immediately - file will be deleted when fd is closed */
-  unlink(output_path);
-
-  /* Build ffmpeg command using /proc/self/fd/ to access unlinked files
-   * Input is always MPEG2-TS format (RTP-encapsulated or raw)
-   * ffmpeg will demux the TS and extract the first video frame
-   */
-  const char *ffmpeg_path = config.ffmpeg_path ? config.ffmpeg_path : "ffmpeg";
-  const char *ffmpeg_args = config.ffmpeg_args ? config.ffmpeg_args : "-hwaccel none";
-
-  char command[1024];
-  snprintf(command, sizeof(command),
-           "%s %s -loglevel error -f mpegts -i /proc/self/fd/%d -frames:v 1 "
-           "-q:v 8 -f image2 -y /proc/self/fd/%d 2>&1",
-           ffmpeg_path, ffmpeg_args, idr_frame_fd, output_fd);
-
-  logger(LOG_DEBUG, "Snapshot: Executing ffmpeg: %s", command);
-
-  /* Execute ffmpeg */
-  FILE *fp = popen(command, "r");
-  if (!fp) {
-    logger(LOG_ERROR, "Snapshot: Failed to execute ffmpeg: %s", strerror(errno));
-    close(output_fd);
-    return -1;
-  }
-
-  /* Read ffmpeg output (errors) */
-  char error_buf[1024];
-  size_t error_len = fread(error_buf, 1, sizeof(error_buf) - 1, fp);
-  error_buf[error_len] = '\0';
-
-  int status = pclose(fp);
+void snapshot_complete(snapshot_context_t *ctx, int jpeg_fd, size_t jpeg_size) {
+  connection_t *conn = ctx ? ctx->conn : NULL;
 
-  /* Always log ffmpeg output if there's any */
-  if (error_len > 0) {
-    logger(LOG_DEBUG, "Snapshot: ffmpeg output: %s", error_buf);
-  }
-
-  if (status != 0) {
-    logger(LOG_ERROR, "Snapshot: ffmpeg failed (exit code %d)", status);
-    close(output_fd);
-    return -1;
-  }
-
-  /* Get JPEG file size */
-  struct stat st;
-  if (fstat(output_fd, &st) < 0) {
-    logger(LOG_ERROR, "Snapshot: Failed to stat output file: %s", strerror(errno));
-    close(output_fd);
-    return -1;
+  if (!ctx || !ctx->initialized || !conn) {
+    if (jpeg_fd >= 0)
+      close(jpeg_fd);
+    return;
   }
 
-  if (st.st_size == 0) {
-    logger(LOG_ERROR, "Snapshot: ffmpeg produced empty JPEG file");
-    close(output_fd);
-    return -1;
+  if (jpeg_fd < 0) {
+    logger(LOG_ERROR, "Snapshot: JPEG conversion failed");
+    snapshot_fallback_to_streaming(ctx, conn);
+    return;
   }
 
-  *jpeg_size = st.st_size;
-  *jpeg_fd = output_fd;
-
-  /* Reset file position for sendfile */
-  lseek(output_fd, 0, SEEK_SET);
-
-  logger(LOG_DEBUG, "Snapshot: JPEG conversion successful (%zu bytes)", *jpeg_size);
-  return 0;
+  /* Answer this client and any request that joined its capture, and keep
+   * the JPEG for later requests on the same channel */
+  snapshot_cache_publish(conn, jpeg_fd, jpeg_size);
 }
 
 /**
@@ -446,42 +376,15 @@ int snapshot_process_packet(snapshot_context_t *ctx, int recv_len, uint8_t *buf,
                  ctx->has_pat, ctx->has_pmt);
         }
 
-        /* Truncate to actual size */
-        if (ftruncate(ctx->idr_frame_fd, ctx->idr_frame_size) < 0) {
-          logger(LOG_WARN, "Snapshot: Failed to truncate mmap file: %s", strerror(errno));
-        }
-
-        /* Reset file position for ffmpeg to read from beginning */
-        lseek(ctx->idr_frame_fd, 0, SEEK_SET);
-
-        /* Convert to JPEG and send immediately */
-        int jpeg_fd = -1;
-        size_t jpeg_size = 0;
-
-        if (snapshot_convert_to_jpeg(ctx->idr_frame_fd, ctx->idr_frame_size, &jpeg_fd, &jpeg_size) == 0) {
-          /* Send HTTP headers with Content-Length */
-          char content_length_header[64];
-          snprintf(content_length_header, sizeof(content_length_header), "Content-Length: %zu\r\n", jpeg_size);
-
-          send_http_headers(conn, STATUS_200, "image/jpeg", content_length_header);
-
-          /* Queue JPEG file for non-blocking sendfile() */
-          if (connection_queue_file(conn, jpeg_fd, 0, jpeg_size) < 0) {
-            logger(LOG_ERROR, "Snapshot: Failed to queue JPEG file");
-            close(jpeg_fd);
-            return -1;
-          }
-
-          /* File descriptor ownership transferred to queue, don't close it here
-           */
-          logger(LOG_INFO, "Snapshot: Sent JPEG response (%zu bytes)", jpeg_size);
-        } else {
-          /* Conversion failed */
+        /* Convert to JPEG in the decoder pool; the response is sent from
+         * snapshot_complete() once the decoder is done */
+        ctx->conn = conn;
+        if (snapshot_decoder_submit(ctx) < 0) {
           logger(LOG_ERROR, "Snapshot: JPEG conversion failed");
           snapshot_fallback_to_streaming(ctx, conn);
         }
 
-        return 0; /* IDR frame captured and sent */
+        return 0; /* IDR frame captured and handed to the decoder pool */
       }
 
       /* Only accumulate packets from the video PID */
@@ -508,6 +411,9 @@ void snapshot_fallback_to_streaming(snapshot_context_t *ctx, connection_t *conn)
   if (!ctx || !ctx->initialized || !conn)
     return;
 
+  /* Requests waiting on this capture fail along with it */
+  snapshot_cache_fail(conn);
+
   if (!ctx->fallback_to_streaming) {
     http_send_500(conn);
     return;
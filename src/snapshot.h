@@ -29,6 +29,11 @@ typedef struct snapshot_context_s {
   int has_pmt;           /* 1 if PMT packet cached in mmap[188..375] */
   uint16_t pmt_pid;      /* PID of PMT (extracted from PAT) */
   size_t ts_header_size; /* Size of PAT+PMT headers (0, 188, or 376 bytes) */
+
+  /* JPEG conversion in the decoder pool */
+  connection_t *conn;         /* Connection awaiting the JPEG */
+  int decode_pending;         /* 1 while queued or converting in the decoder pool */
+  int64_t decode_submit_time; /* When the frame was handed to the decoder pool */
 } snapshot_context_t;
 
 /**
@@ -56,6 +61,16 @@ void snapshot_cleanup(snapshot_context_t *ctx);
  */
 int snapshot_process_packet(snapshot_context_t *ctx, int recv_len, uint8_t *buf, connection_t *conn);
 
+/**
+ * Deliver the decoder pool result for a captured frame
+ * Sends the JPEG response, or falls back to streaming / 500 on failure
+ * @param ctx Snapshot context
+ * @param jpeg_fd Unlinked file holding the JPEG (ownership transferred), or -1
+ * on failure
+ * @param jpeg_size JPEG size in bytes
+ */
+void snapshot_complete(snapshot_context_t *ctx, int jpeg_fd, size_t jpeg_size);
+
 /**
  * Fallback to normal streaming mode
  * Sends normal streaming headers and frees snapshot context
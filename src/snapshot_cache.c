@@ -0,0 +1,358 @@
+#include "snapshot_cache.h"
+#include "configuration.h"
+#include "connection.h"
+#include "http.h"
+#include "md5.h"
+#include "rtp2httpd.h"
+#include "status.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+  char *key;         /* Channel identity, NULL when the slot is unused */
+  int fd;            /* Unlinked file holding the JPEG */
+  size_t size;       /* JPEG size in bytes */
+  char etag[33];     /* MD5 of the JPEG (hex) */
+  int64_t stored_at; /* When the JPEG was captured */
+} snapshot_cache_entry_t;
+
+typedef struct snapshot_waiter_s {
+  connection_t *conn;
+  int mode; /* Snapshot request mode, 2 falls back to streaming on failure */
+  struct snapshot_waiter_s *next;
+} snapshot_waiter_t;
+
+typedef struct snapshot_flight_s {
+  char *key;
+  connection_t *leader; /* Connection running the capture */
+  snapshot_waiter_t *waiters;
+  snapshot_waiter_t *waiters_tail;
+  struct snapshot_flight_s *next;
+} snapshot_flight_t;
+
+/* One cache per event loop, like the decoder pool that fills it */
+static _Thread_local snapshot_cache_entry_t entries[SNAPSHOT_CACHE_MAX_ENTRIES];
+static _Thread_local snapshot_flight_t *flights = NULL;
+
+#define SNAPSHOT_CACHE_STATS_INC(field)                                                                                \
+  do {                                                                                                                 \
+    if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS) {                                           \
+      status_shared->worker_stats[worker_id].field++;                                                                  \
+    }                                                                                                                  \
+  } while (0)
+
+static void update_stats(void) {
+  if (!status_shared || worker_id < 0 || worker_id >= STATUS_MAX_WORKERS)
+    return;
+
+  uint32_t cached = 0;
+  for (int i = 0; i < SNAPSHOT_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key)
+      cached++;
+  }
+  status_shared->worker_stats[worker_id].snapshot_cached = cached;
+}
+
+static void entry_free(snapshot_cache_entry_t *entry) {
+  free(entry->key);
+  entry->key = NULL;
+  if (entry->fd >= 0)
+    close(entry->fd);
+  entry->fd = -1;
+}
+
+static int entry_is_fresh(const snapshot_cache_entry_t *entry, int64_t now) {
+  return entry->key && config.snapshot_cache_ttl > 0 && now - entry->stored_at < config.snapshot_cache_ttl * 1000LL;
+}
+
+static snapshot_cache_entry_t *find_entry(const char *key) {
+  for (int i = 0; i < SNAPSHOT_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key && strcmp(entries[i].key, key) == 0)
+      return &entries[i];
+  }
+  return NULL;
+}
+
+/* Slot for a new entry: the key's current slot, a free one, or the oldest */
+static snapshot_cache_entry_t *entry_slot(const char *key) {
+  snapshot_cache_entry_t *oldest = NULL;
+
+  for (int i = 0; i < SNAPSHOT_CACHE_MAX_ENTRIES; i++) {
+    if (!entries[i].key)
+      return &entries[i];
+    if (strcmp(entries[i].key, key) == 0)
+      return &entries[i];
+    if (!oldest || entries[i].stored_at < oldest->stored_at)
+      oldest = &entries[i];
+  }
+  return oldest;
+}
+
+static int compute_etag(int fd, size_t size, char *etag) {
+  MD5Context ctx;
+  uint8_t buffer[8192];
+  size_t total_read = 0;
+
+  md5Init(&ctx);
+  while (total_read < size) {
+    size_t to_read = (size - total_read < sizeof(buffer)) ? (size - total_read) : sizeof(buffer);
+    ssize_t bytes_read = pread(fd, buffer, to_read, (off_t)total_read);
+    if (bytes_read <= 0)
+      return -1;
+    md5Update(&ctx, buffer, (size_t)bytes_read);
+    total_read += (size_t)bytes_read;
+  }
+  md5Finalize(&ctx);
+  md5_to_hex(ctx.digest, etag);
+  return 0;
+}
+
+/* Answer a snapshot request with the JPEG in fd (fd stays owned by the caller) */
+static void send_jpeg(connection_t *c, int fd, size_t size, const char *etag) {
+  /* http_send_file closes its fd once sent */
+  int dup_fd = dup(fd);
+  if (dup_fd < 0) {
+    logger(LOG_ERROR, "Snapshot: Failed to dup JPEG fd: %s", strerror(errno));
+    c->state = CONN_CLOSING;
+    return;
+  }
+  http_send_file(c, dup_fd, size, "image/jpeg", etag, NULL);
+}
+
+static snapshot_flight_t *find_flight(const char *key) {
+  for (snapshot_flight_t *f = flights; f; f = f->next) {
+    if (strcmp(f->key, key) == 0)
+      return f;
+  }
+  return NULL;
+}
+
+/* Unlink the flight led by leader from the list and return it */
+static snapshot_flight_t *take_flight(connection_t *leader) {
+  snapshot_flight_t **pp = &flights;
+  while (*pp) {
+    snapshot_flight_t *f = *pp;
+    if (f->leader == leader) {
+      *pp = f->next;
+      f->next = NULL;
+      return f;
+    }
+    pp = &f->next;
+  }
+  return NULL;
+}
+
+static snapshot_waiter_t *pop_waiter(snapshot_flight_t *flight) {
+  snapshot_waiter_t *w = flight->waiters;
+  if (w) {
+    flight->waiters = w->next;
+    if (!flight->waiters)
+      flight->waiters_tail = NULL;
+  }
+  return w;
+}
+
+static void flight_free(snapshot_flight_t *flight) {
+  snapshot_waiter_t *w;
+  while ((w = pop_waiter(flight)) != NULL)
+    free(w);
+  free(flight->key);
+  free(flight);
+}
+
+static void fail_waiter(snapshot_waiter_t *w) {
+  connection_t *c = w->conn;
+
+  if (w->mode == 2) {
+    /* X-Request-Snapshot / Accept: image/jpeg clients fall back to streaming */
+    service_t *service = c->service;
+    c->service = NULL;
+    logger(LOG_INFO, "Snapshot: Falling back to normal streaming");
+    connection_start_stream(c, service, 0);
+    return;
+  }
+  http_send_500(c);
+}
+
+static void fail_flight(snapshot_flight_t *flight) {
+  snapshot_waiter_t *w;
+  while ((w = pop_waiter(flight)) != NULL) {
+    fail_waiter(w);
+    free(w);
+  }
+  flight_free(flight);
+}
+
+snapshot_cache_result_t snapshot_cache_attach(connection_t *c, const char *key, int mode) {
+  if (!c || !key)
+    return SNAPSHOT_CACHE_MISS;
+
+  snapshot_cache_entry_t *entry = find_entry(key);
+  if (entry && entry_is_fresh(entry, get_time_ms())) {
+    logger(LOG_DEBUG, "Snapshot: Serving cached JPEG for %s (%zu bytes)", key, entry->size);
+    SNAPSHOT_CACHE_STATS_INC(snapshot_cache_hits);
+    send_jpeg(c, entry->fd, entry->size, entry->etag);
+    return SNAPSHOT_CACHE_SERVED;
+  }
+
+  snapshot_flight_t *flight = find_flight(key);
+  if (flight) {
+    snapshot_waiter_t *w = calloc(1, sizeof(*w));
+    if (!w)
+      return SNAPSHOT_CACHE_MISS; /* Capture on our own */
+    w->conn = c;
+    w->mode = mode;
+    if (flight->waiters_tail)
+      flight->waiters_tail->next = w;
+    else
+      flight->waiters = w;
+    flight->waiters_tail = w;
+    logger(LOG_DEBUG, "Snapshot: Joined running capture for %s", key);
+    SNAPSHOT_CACHE_STATS_INC(snapshot_coalesced);
+    return SNAPSHOT_CACHE_WAITING;
+  }
+
+  /* Lead a new capture; without a flight record the request still works,
+   * it just can't be shared */
+  flight = calloc(1, sizeof(*flight));
+  if (!flight)
+    return SNAPSHOT_CACHE_MISS;
+  flight->key = strdup(key);
+  if (!flight->key) {
+    free(flight);
+    return SNAPSHOT_CACHE_MISS;
+  }
+  flight->leader = c;
+  flight->next = flights;
+  flights = flight;
+  return SNAPSHOT_CACHE_MISS;
+}
+
+void snapshot_cache_publish(connection_t *leader, int jpeg_fd, size_t jpeg_size) {
+  snapshot_flight_t *flight = take_flight(leader);
+  char etag[33];
+  const char *etag_ptr = etag;
+  snapshot_waiter_t *w;
+
+  if (compute_etag(jpeg_fd, jpeg_size, etag) < 0) {
+    logger(LOG_WARN, "Snapshot: Failed to read JPEG for ETag calculation");
+    etag_ptr = NULL;
+  }
+
+  send_jpeg(leader, jpeg_fd, jpeg_size, etag_ptr);
+  logger(LOG_INFO, "Snapshot: Sent JPEG response (%zu bytes)", jpeg_size);
+
+  if (!flight) {
+    close(jpeg_fd);
+    return;
+  }
+
+  while ((w = pop_waiter(flight)) != NULL) {
+    send_jpeg(w->conn, jpeg_fd, jpeg_size, etag_ptr);
+    free(w);
+  }
+
+  if (config.snapshot_cache_ttl > 0 && etag_ptr) {
+    snapshot_cache_entry_t *entry = entry_slot(flight->key);
+    if (entry->key)
+      entry_free(entry);
+    entry->key = flight->key;
+    entry->fd = jpeg_fd;
+    entry->size = jpeg_size;
+    memcpy(entry->etag, etag, sizeof(entry->etag));
+    entry->stored_at = get_time_ms();
+    flight->key = NULL; /* Moved into the entry */
+    update_stats();
+  } else {
+    close(jpeg_fd);
+  }
+  flight_free(flight);
+}
+
+void snapshot_cache_fail(connection_t *leader) {
+  snapshot_flight_t *flight = take_flight(leader);
+  if (flight)
+    fail_flight(flight);
+}
+
+void snapshot_cache_leave(connection_t *c) {
+  if (!flights || !c)
+    return;
+
+  snapshot_flight_t *flight = take_flight(c);
+  if (!flight) {
+    /* Not a leader: drop it from whichever flight it waits on */
+    for (snapshot_flight_t *f = flights; f; f = f->next) {
+      snapshot_waiter_t **pp = &f->waiters;
+      snapshot_waiter_t *prev = NULL;
+      while (*pp) {
+        snapshot_waiter_t *w = *pp;
+        if (w->conn == c) {
+          *pp = w->next;
+          if (f->waiters_tail == w)
+            f->waiters_tail = prev;
+          free(w);
+          return;
+        }
+        prev = w;
+        pp = &w->next;
+      }
+    }
+    return;
+  }
+
+  /* A leader that already answered (503 / 500) failed its capture */
+  if (c->headers_sent) {
+    fail_flight(flight);
+    return;
+  }
+
+  /* The leader's client left before the JPEG was ready: hand the capture to
+   * the next waiter */
+  snapshot_waiter_t *w;
+  while ((w = pop_waiter(flight)) != NULL) {
+    connection_t *next_leader = w->conn;
+    service_t *service = next_leader->service;
+    int mode = w->mode;
+    free(w);
+
+    next_leader->service = NULL;
+    if (connection_start_stream(next_leader, service, mode) == 0) {
+      logger(LOG_DEBUG, "Snapshot: Capture for %s handed to a waiting client", flight->key);
+      flight->leader = next_leader;
+      flight->next = flights;
+      flights = flight;
+      return;
+    }
+  }
+  flight_free(flight);
+}
+
+void snapshot_cache_tick(int64_t now) {
+  int expired = 0;
+
+  for (int i = 0; i < SNAPSHOT_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key && !entry_is_fresh(&entries[i], now)) {
+      entry_free(&entries[i]);
+      expired = 1;
+    }
+  }
+  if (expired)
+    update_stats();
+}
+
+void snapshot_cache_cleanup(void) {
+  while (flights) {
+    snapshot_flight_t *flight = flights;
+    flights = flight->next;
+    flight_free(flight);
+  }
+  for (int i = 0; i < SNAPSHOT_CACHE_MAX_ENTRIES; i++) {
+    if (entries[i].key)
+      entry_free(&entries[i]);
+  }
+  update_stats();
+}
@@ -0,0 +1,65 @@
+#ifndef SNAPSHOT_CACHE_H
+#define SNAPSHOT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Forward declarations */
+typedef struct connection_s connection_t;
+
+/* Upper bound for the snapshot-cache-ttl option (seconds) */
+#define SNAPSHOT_CACHE_TTL_MAX 3600
+
+/* Channel JPEGs kept per event loop; the oldest entry is evicted first */
+#define SNAPSHOT_CACHE_MAX_ENTRIES 128
+
+/**
+ * Per-channel snapshot cache
+ *
+ * Each event loop remembers the last JPEG produced for a channel for
+ * config.snapshot_cache_ttl seconds and serves it with sendfile() and an
+ * ETag.  Requests for a channel whose capture is already running attach to
+ * that capture (single-flight) instead of joining the stream, waiting for an
+ * IDR and running ffmpeg again; they are answered when the leader's JPEG is
+ * ready.  If the leader's client goes away first, the next waiter takes over
+ * the capture.
+ */
+
+typedef enum {
+  SNAPSHOT_CACHE_MISS = 0, /* Caller leads a new capture for the channel */
+  SNAPSHOT_CACHE_SERVED,   /* Response sent from the cache (200 or 304) */
+  SNAPSHOT_CACHE_WAITING   /* Attached to the channel's running capture */
+} snapshot_cache_result_t;
+
+/**
+ * Look up a snapshot request
+ * @param c Connection in CONN_ROUTE; c->service must be set when waiting
+ * @param key Channel identity (service path and query without r2h-token /
+ * snapshot)
+ * @param mode Snapshot request mode as passed to stream_context_init_for_worker
+ * @return snapshot_cache_result_t
+ */
+snapshot_cache_result_t snapshot_cache_attach(connection_t *c, const char *key, int mode);
+
+/**
+ * Publish the JPEG captured by a leader: answer the leader and every waiter,
+ * then cache it for the channel
+ * @param leader Connection that ran the capture
+ * @param jpeg_fd Unlinked file holding the JPEG (ownership transferred)
+ * @param jpeg_size JPEG size in bytes
+ */
+void snapshot_cache_publish(connection_t *leader, int jpeg_fd, size_t jpeg_size);
+
+/** Capture of a leader failed: waiters fall back to streaming or get a 500 */
+void snapshot_cache_fail(connection_t *leader);
+
+/** Detach a connection that is being closed from any running capture */
+void snapshot_cache_leave(connection_t *c);
+
+/** Drop expired entries */
+void snapshot_cache_tick(int64_t now);
+
+/** Release all entries of this event loop */
+void snapshot_cache_cleanup(void);
+
+#endif /* SNAPSHOT_CACHE_H */
@@ -0,0 +1,573 @@
+#include "snapshot_decoder.h"
+#include "configuration.h"
+#include "platform_compat.h"
+#include "poller.h"
+#include "rtp2httpd.h"
+#include "snapshot.h"
+#include "status.h"
+#include "utils.h"
+#include "worker.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+typedef enum {
+  DECODER_EMPTY = 0, /* Slot unused */
+  DECODER_IDLE,      /* Process started, waiting for a frame on stdin */
+  DECODER_WRITING,   /* Feeding the frame into stdin */
+  DECODER_READING,   /* stdin closed, collecting the JPEG from stdout */
+  DECODER_EXITING    /* Pipes closed, waiting to reap the process */
+} decoder_state_t;
+
+typedef struct {
+  decoder_state_t state;
+  pid_t pid;
+  int stdin_fd;
+  int stdout_fd;
+  snapshot_context_t *job; /* Request being converted, NULL when idle */
+  size_t written;          /* Frame bytes written to stdin */
+  int output_fd;           /* Unlinked tmp file receiving the JPEG */
+  size_t output_size;
+  int64_t spawned_at;
+  unsigned int generation; /* Command generation the process was started with */
+} snapshot_decoder_t;
+
+typedef struct {
+  int initialized;
+  int epfd;
+  snapshot_decoder_t decoders[SNAPSHOT_DECODER_MAX];
+  snapshot_context_t *queue[SNAPSHOT_QUEUE_MAX];
+  int queue_head;
+  int queue_len;
+  char command[1024];      /* Shell command the current generation runs */
+  unsigned int generation; /* Bumped when ffmpeg-path / ffmpeg-args change */
+  int64_t next_spawn_time; /* Respawn backoff after decoders die unused */
+} snapshot_decoder_pool_t;
+
+/* One pool per event loop */
+static _Thread_local snapshot_decoder_pool_t pool;
+
+static void handle_decoder_fd(int fd, uint32_t events, int64_t now, void *opaque);
+
+#define SNAPSHOT_STATS_INC(field)                                                                                      \
+  do {                                                                                                                 \
+    if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS) {                                           \
+      status_shared->worker_stats[worker_id].field++;                                                                  \
+    }                                                                                                                  \
+  } while (0)
+
+static int pool_size(void) {
+  if (!config.video_snapshot)
+    return 0;
+  return config.snapshot_decoders < SNAPSHOT_DECODER_MAX ? config.snapshot_decoders : SNAPSHOT_DECODER_MAX;
+}
+
+static int queue_capacity(void) {
+  return config.snapshot_queue_depth < SNAPSHOT_QUEUE_MAX ? config.snapshot_queue_depth : SNAPSHOT_QUEUE_MAX;
+}
+
+static void update_stats(void) {
+  if (!status_shared || worker_id < 0 || worker_id >= STATUS_MAX_WORKERS)
+    return;
+
+  worker_stats_t *stats = &status_shared->worker_stats[worker_id];
+  uint32_t running = 0;
+  uint32_t busy = 0;
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+    decoder_state_t state = pool.decoders[i].state;
+    if (state == DECODER_IDLE || state == DECODER_WRITING || state == DECODER_READING)
+      running++;
+    if (state == DECODER_WRITING || state == DECODER_READING)
+      busy++;
+  }
+  stats->snapshot_decoders = running;
+  stats->snapshot_decoders_busy = busy;
+  stats->snapshot_queue_len = (uint32_t)pool.queue_len;
+  stats->snapshot_queue_max = (uint32_t)queue_capacity();
+}
+
+/* Refresh the decoder command line, retiring the old generation on change */
+static void refresh_command(void) {
+  char command[sizeof(pool.command)];
+  const char *ffmpeg_path = config.ffmpeg_path ? config.ffmpeg_path : "ffmpeg";
+  const char *ffmpeg_args = config.ffmpeg_args ? config.ffmpeg_args : "-hwaccel none";
+
+  /* Input is always MPEG2-TS (PAT + PMT + one IDR access unit); ffmpeg
+   * decodes the first video frame and writes it as JPEG to stdout. */
+  snprintf(command, sizeof(command),
+           "exec %s %s -nostdin -loglevel error -f mpegts -i pipe:0 -frames:v 1 "
+           "-q:v 8 -c:v mjpeg -f image2pipe pipe:1",
+           ffmpeg_path, ffmpeg_args);
+
+  if (strcmp(command, pool.command) != 0) {
+    memcpy(pool.command, command, sizeof(pool.command));
+    pool.generation++;
+  }
+}
+
+static void close_decoder_fd(int *fd) {
+  if (*fd < 0)
+    return;
+  fdmap_del(*fd);
+  if (pool.epfd >= 0)
+    poller_del(pool.epfd, *fd);
+  close(*fd);
+  *fd = -1;
+}
+
+/* Close pipes and move the decoder to EXITING until waitpid() collects it */
+static void retire_decoder(snapshot_decoder_t *d, int kill_process) {
+  close_decoder_fd(&d->stdin_fd);
+  close_decoder_fd(&d->stdout_fd);
+  if (d->output_fd >= 0) {
+    close(d->output_fd);
+    d->output_fd = -1;
+  }
+  d->output_size = 0;
+  d->written = 0;
+  if (d->pid > 0) {
+    if (kill_process)
+      kill(d->pid, SIGKILL);
+    d->state = DECODER_EXITING;
+  } else {
+    d->state = DECODER_EMPTY;
+  }
+}
+
+static void reap_decoders(void) {
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+    snapshot_decoder_t *d = &pool.decoders[i];
+    if (d->state != DECODER_EXITING)
+      continue;
+    pid_t r = waitpid(d->pid, NULL, WNOHANG);
+    if (r == d->pid || (r < 0 && errno == ECHILD)) {
+      d->pid = 0;
+      d->state = DECODER_EMPTY;
+    }
+  }
+}
+
+/* Close descriptors inherited from the worker (listeners, client sockets) */
+static void close_inherited_fds(long max_fd) {
+#if defined(__linux__) && defined(SYS_close_range)
+  if (syscall(SYS_close_range, 3U, ~0U, 0U) == 0)
+    return;
+#endif
+  for (long fd = 3; fd < max_fd; fd++)
+    close((int)fd);
+}
+
+pid_t snapshot_spawn_command(const char *command, int stdin_fd, int stdout_fd) {
+  long max_fd = sysconf(_SC_OPEN_MAX);
+  pid_t pid;
+
+  if (max_fd < 0 || max_fd > 65536)
+    max_fd = 65536;
+
+  pid = fork();
+  if (pid != 0)
+    return pid;
+
+  /* Child: only async-signal-safe calls until exec */
+  sigset_t all;
+  int devnull = open("/dev/null", O_RDWR);
+  dup2(stdin_fd >= 0 ? stdin_fd : devnull, STDIN_FILENO);
+  dup2(stdout_fd >= 0 ? stdout_fd : devnull, STDOUT_FILENO);
+  if (devnull >= 0)
+    dup2(devnull, STDERR_FILENO);
+  close_inherited_fds(max_fd);
+  signal(SIGPIPE, SIG_DFL);
+  sigemptyset(&all);
+  sigprocmask(SIG_SETMASK, &all, NULL);
+  platform_set_parent_death_signal(SIGKILL);
+  execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+  _exit(127);
+}
+
+static int set_pipe_flags(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    return -1;
+  return fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static int spawn_decoder(snapshot_decoder_t *d, int64_t now) {
+  int in_pipe[2] = {-1, -1};
+  int out_pipe[2] = {-1, -1};
+  pid_t pid;
+
+  if (pipe(in_pipe) < 0 || pipe(out_pipe) < 0) {
+    logger(LOG_ERROR, "Snapshot: Failed to create decoder pipes: %s", strerror(errno));
+    goto error;
+  }
+
+  pid = snapshot_spawn_command(pool.command, in_pipe[0], out_pipe[1]);
+  if (pid < 0) {
+    logger(LOG_ERROR, "Snapshot: Failed to start decoder: %s", strerror(errno));
+    goto error;
+  }
+
+  close(in_pipe[0]);
+  close(out_pipe[1]);
+  d->stdin_fd = in_pipe[1];
+  d->stdout_fd = out_pipe[0];
+  d->pid = pid;
+  d->job = NULL;
+  d->written = 0;
+  d->output_fd = -1;
+  d->output_size = 0;
+  d->spawned_at = now;
+  d->generation = pool.generation;
+  d->state = DECODER_IDLE;
+
+  if (set_pipe_flags(d->stdin_fd) < 0 || set_pipe_flags(d->stdout_fd) < 0 ||
+      poller_add(pool.epfd, d->stdout_fd, POLLER_IN | POLLER_HUP | POLLER_ERR) < 0) {
+    logger(LOG_ERROR, "Snapshot: Failed to set up decoder pipes: %s", strerror(errno));
+    retire_decoder(d, 1);
+    return -1;
+  }
+  fdmap_set_handler(d->stdout_fd, handle_decoder_fd, d);
+
+  SNAPSHOT_STATS_INC(snapshot_spawns);
+  logger(LOG_DEBUG, "Snapshot: Decoder started (pid=%d)", (int)pid);
+  return 0;
+
+error:
+  for (int i = 0; i < 2; i++) {
+    if (in_pipe[i] >= 0)
+      close(in_pipe[i]);
+    if (out_pipe[i] >= 0)
+      close(out_pipe[i]);
+  }
+  return -1;
+}
+
+/* Spawn decoders until the configured pool size is running */
+static void fill_pool(int64_t now) {
+  int wanted = pool_size();
+  int running = 0;
+
+  if (!pool.initialized || now < pool.next_spawn_time)
+    return;
+
+  refresh_command();
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+    snapshot_decoder_t *d = &pool.decoders[i];
+    /* Idle decoders of an older command line or beyond the pool size retire */
+    if (d->state == DECODER_IDLE && (d->generation != pool.generation || running >= wanted))
+      retire_decoder(d, 1);
+    if (d->state == DECODER_IDLE || d->state == DECODER_WRITING || d->state == DECODER_READING)
+      running++;
+  }
+
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX && running < wanted; i++) {
+    if (pool.decoders[i].state != DECODER_EMPTY)
+      continue;
+    if (spawn_decoder(&pool.decoders[i], now) < 0) {
+      pool.next_spawn_time = now + SNAPSHOT_DECODER_RESPAWN_BACKOFF_MS;
+      break;
+    }
+    running++;
+  }
+}
+
+/* Detach the job from its decoder and hand the result to snapshot.c */
+static void finish_job(snapshot_decoder_t *d, int success) {
+  snapshot_context_t *ctx = d->job;
+  int jpeg_fd = -1;
+  size_t jpeg_size = 0;
+
+  d->job = NULL;
+  if (success && d->output_fd >= 0 && d->output_size > 0) {
+    jpeg_fd = d->output_fd;
+    jpeg_size = d->output_size;
+    d->output_fd = -1;
+    lseek(jpeg_fd, 0, SEEK_SET);
+    SNAPSHOT_STATS_INC(snapshot_jobs);
+  } else {
+    SNAPSHOT_STATS_INC(snapshot_failures);
+  }
+
+  if (ctx) {
+    ctx->decode_pending = 0;
+    snapshot_complete(ctx, jpeg_fd, jpeg_size);
+  } else if (jpeg_fd >= 0) {
+    close(jpeg_fd);
+  }
+}
+
+static void write_frame(snapshot_decoder_t *d) {
+  snapshot_context_t *ctx = d->job;
+
+  while (d->written < ctx->idr_frame_size) {
+    ssize_t n = write(d->stdin_fd, ctx->idr_frame_mmap + d->written, ctx->idr_frame_size - d->written);
+    if (n > 0) {
+      d->written += (size_t)n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && errno == EAGAIN)
+      return; /* Wait for POLLER_OUT */
+    /* EPIPE: ffmpeg already has its frame or died; stdout EOF decides */
+    break;
+  }
+
+  /* EOF on stdin lets ffmpeg flush the decoder and write the JPEG */
+  close_decoder_fd(&d->stdin_fd);
+  d->state = DECODER_READING;
+}
+
+static void start_job(snapshot_decoder_t *d, snapshot_context_t *ctx) {
+  char output_path[] = "/tmp/rtp2httpd_jpeg_XXXXXX";
+
+  d->job = ctx;
+  d->written = 0;
+  d->output_size = 0;
+  d->output_fd = mkstemp(output_path);
+  if (d->output_fd < 0) {
+    logger(LOG_ERROR, "Snapshot: Failed to create JPEG output file: %s", strerror(errno));
+    finish_job(d, 0);
+    return;
+  }
+  /* Unlink immediately - file will be deleted when fd is closed */
+  unlink(output_path);
+
+  d->state = DECODER_WRITING;
+  if (poller_add(pool.epfd, d->stdin_fd, POLLER_OUT | POLLER_ERR) < 0) {
+    logger(LOG_ERROR, "Snapshot: Failed to watch decoder stdin: %s", strerror(errno));
+    retire_decoder(d, 1);
+    finish_job(d, 0);
+    return;
+  }
+  fdmap_set_handler(d->stdin_fd, handle_decoder_fd, d);
+  write_frame(d);
+}
+
+/* Hand queued requests to idle decoders */
+static void dispatch_queue(void) {
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX && pool.queue_len > 0; i++) {
+    snapshot_decoder_t *d = &pool.decoders[i];
+    if (d->state != DECODER_IDLE || d->generation != pool.generation)
+      continue;
+    snapshot_context_t *ctx = pool.queue[pool.queue_head];
+    pool.queue_head = (pool.queue_head + 1) % SNAPSHOT_QUEUE_MAX;
+    pool.queue_len--;
+    start_job(d, ctx);
+  }
+}
+
+static void read_output(snapshot_decoder_t *d, int64_t now) {
+  char buf[16384];
+
+  for (;;) {
+    ssize_t n = read(d->stdout_fd, buf, sizeof(buf));
+    if (n > 0) {
+      if (d->job && d->output_fd >= 0) {
+        if (write(d->output_fd, buf, (size_t)n) != n) {
+          logger(LOG_ERROR, "Snapshot: Failed to store JPEG output: %s", strerror(errno));
+          retire_decoder(d, 1);
+          finish_job(d, 0);
+          return;
+        }
+        d->output_size += (size_t)n;
+      }
+      continue;
+    }
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && errno == EAGAIN)
+      return;
+    break; /* EOF or error: the decoder is done */
+  }
+
+  if (d->job) {
+    int success = d->output_size > 0;
+    if (!success)
+      logger(LOG_ERROR, "Snapshot: ffmpeg produced empty JPEG output");
+    else
+      logger(LOG_DEBUG, "Snapshot: JPEG conversion successful (%zu bytes)", d->output_size);
+    finish_job(d, success);
+    retire_decoder(d, 0);
+  } else {
+    /* Decoder exited before receiving a frame: broken ffmpeg path/args */
+    logger(LOG_WARN, "Snapshot: Decoder (pid=%d) exited while idle", (int)d->pid);
+    if (now - d->spawned_at < 1000)
+      pool.next_spawn_time = now + SNAPSHOT_DECODER_RESPAWN_BACKOFF_MS;
+    retire_decoder(d, 0);
+  }
+}
+
+void snapshot_decoder_pool_init(int epfd) {
+  memset(&pool, 0, sizeof(pool));
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+    pool.decoders[i].stdin_fd = -1;
+    pool.decoders[i].stdout_fd = -1;
+    pool.decoders[i].output_fd = -1;
+  }
+  pool.epfd = epfd;
+  pool.initialized = 1;
+
+  /* A decoder dying mid-write must surface as EPIPE, not kill the worker */
+  signal(SIGPIPE, SIG_IGN);
+
+  fill_pool(get_time_ms());
+  update_stats();
+}
+
+void snapshot_decoder_pool_cleanup(void) {
+  if (!pool.initialized)
+    return;
+
+  while (pool.queue_len > 0) {
+    snapshot_context_t *ctx = pool.queue[pool.queue_head];
+    pool.queue_head = (pool.queue_head + 1) % SNAPSHOT_QUEUE_MAX;
+    pool.queue_len--;
+    ctx->decode_pending = 0;
+  }
+
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+    snapshot_decoder_t *d = &pool.decoders[i];
+    if (d->job) {
+      d->job->decode_pending = 0;
+      d->job = NULL;
+    }
+    if (d->state != DECODER_EMPTY && d->state != DECODER_EXITING)
+      retire_decoder(d, 1);
+    if (d->state == DECODER_EXITING) {
+      waitpid(d->pid, NULL, 0);
+      d->pid = 0;
+      d->state = DECODER_EMPTY;
+    }
+  }
+
+  pool.initialized = 0;
+  update_stats();
+}
+
+int snapshot_decoder_submit(snapshot_context_t *ctx) {
+  int64_t now = get_time_ms();
+
+  if (!pool.initialized || !ctx || pool_size() == 0)
+    return -1;
+
+  ctx->decode_submit_time = now;
+  fill_pool(now);
+
+  if (pool.queue_len >= queue_capacity()) {
+    /* Queue full, but an idle decoder may still take the request directly */
+    int has_idle = 0;
+    for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+      if (pool.decoders[i].state == DECODER_IDLE && pool.decoders[i].generation == pool.generation)
+        has_idle = 1;
+    }
+    if (!has_idle || pool.queue_len >= SNAPSHOT_QUEUE_MAX) {
+      logger(LOG_WARN, "Snapshot: Decoder queue full (%d waiting), rejecting request", pool.queue_len);
+      SNAPSHOT_STATS_INC(snapshot_rejects);
+      return -1;
+    }
+  }
+
+  ctx->decode_pending = 1;
+  pool.queue[(pool.queue_head + pool.queue_len) % SNAPSHOT_QUEUE_MAX] = ctx;
+  pool.queue_len++;
+  dispatch_queue();
+  update_stats();
+  return 0;
+}
+
+void snapshot_decoder_cancel(snapshot_context_t *ctx) {
+  if (!pool.initialized || !ctx || !ctx->decode_pending)
+    return;
+
+  ctx->decode_pending = 0;
+
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+    snapshot_decoder_t *d = &pool.decoders[i];
+    if (d->job == ctx) {
+      /* The frame buffer is about to be unmapped: stop the decoder */
+      d->job = NULL;
+      retire_decoder(d, 1);
+      SNAPSHOT_STATS_INC(snapshot_failures);
+    }
+  }
+
+  /* Compact the queue without the cancelled request */
+  int kept = 0;
+  for (int i = 0; i < pool.queue_len; i++) {
+    snapshot_context_t *queued = pool.queue[(pool.queue_head + i) % SNAPSHOT_QUEUE_MAX];
+    if (queued != ctx)
+      pool.queue[(pool.queue_head + kept++) % SNAPSHOT_QUEUE_MAX] = queued;
+  }
+  pool.queue_len = kept;
+  update_stats();
+}
+
+/* fdmap handler for a decoder's stdin and stdout pipes */
+static void handle_decoder_fd(int fd, uint32_t events, int64_t now, void *opaque) {
+  snapshot_decoder_t *d = opaque;
+
+  if (d->state == DECODER_EMPTY || d->state == DECODER_EXITING)
+    return;
+
+  if (fd == d->stdin_fd) {
+    if (d->state == DECODER_WRITING && d->job)
+      write_frame(d);
+    else if (events & (POLLER_ERR | POLLER_HUP))
+      close_decoder_fd(&d->stdin_fd);
+  } else if (fd == d->stdout_fd) {
+    read_output(d, now);
+  } else {
+    return;
+  }
+
+  reap_decoders();
+  fill_pool(now);
+  dispatch_queue();
+  update_stats();
+}
+
+void snapshot_decoder_tick(int64_t now) {
+  if (!pool.initialized)
+    return;
+
+  /* Per-request timeout covers both queueing and conversion */
+  for (int i = 0; i < SNAPSHOT_DECODER_MAX; i++) {
+    snapshot_decoder_t *d = &pool.decoders[i];
+    if (d->job && now - d->job->decode_submit_time > SNAPSHOT_DECODE_TIMEOUT_MS) {
+      logger(LOG_WARN, "Snapshot: Decoder (pid=%d) timed out after %lld ms", (int)d->pid,
+             (long long)(now - d->job->decode_submit_time));
+      SNAPSHOT_STATS_INC(snapshot_timeouts);
+      retire_decoder(d, 1);
+      finish_job(d, 0);
+    }
+  }
+
+  while (pool.queue_len > 0) {
+    snapshot_context_t *ctx = pool.queue[pool.queue_head];
+    if (now - ctx->decode_submit_time <= SNAPSHOT_DECODE_TIMEOUT_MS)
+      break;
+    pool.queue_head = (pool.queue_head + 1) % SNAPSHOT_QUEUE_MAX;
+    pool.queue_len--;
+    logger(LOG_WARN, "Snapshot: Request timed out waiting for a decoder");
+    SNAPSHOT_STATS_INC(snapshot_timeouts);
+    SNAPSHOT_STATS_INC(snapshot_failures);
+    ctx->decode_pending = 0;
+    snapshot_complete(ctx, -1, 0);
+  }
+
+  reap_decoders();
+  fill_pool(now);
+  dispatch_queue();
+  update_stats();
+}
@@ -0,0 +1,66 @@
+#ifndef SNAPSHOT_DECODER_H
+#define SNAPSHOT_DECODER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Forward declarations */
+typedef struct snapshot_context_s snapshot_context_t;
+
+/* Upper bounds for the snapshot-decoders / snapshot-queue-depth options */
+#define SNAPSHOT_DECODER_MAX 8
+#define SNAPSHOT_QUEUE_MAX 64
+
+/* Per-request conversion timeout, measured from submission (milliseconds) */
+#define SNAPSHOT_DECODE_TIMEOUT_MS 5000
+
+/* Delay before respawning after a decoder exits without handling a request */
+#define SNAPSHOT_DECODER_RESPAWN_BACKOFF_MS 5000
+
+/**
+ * Snapshot decoder pool
+ *
+ * Each event loop keeps config.snapshot_decoders ffmpeg coprocesses started
+ * ahead of time and blocked on their stdin pipe, so process start-up, dynamic
+ * linking and codec registration are off the request path.  A request writes
+ * the captured MPEG-TS frame into an idle decoder's stdin and reads the JPEG
+ * from its stdout, both non-blocking through the worker poller (the pipes are
+ * registered in the worker fdmap with a handler).  ffmpeg cannot
+ * decode unrelated streams in one session, so a decoder exits after its frame
+ * and is replaced in the background.  Requests arriving while every decoder is
+ * busy wait in a bounded FIFO queue.
+ */
+
+/**
+ * Initialize this event loop's decoder pool and prewarm decoders when video
+ * snapshots are enabled
+ * @param epfd Poller of the calling event loop
+ */
+void snapshot_decoder_pool_init(int epfd);
+
+/** Kill all decoders of this event loop and fail pending requests */
+void snapshot_decoder_pool_cleanup(void);
+
+/**
+ * Queue a captured frame (ctx->idr_frame_mmap, ctx->idr_frame_size) for JPEG
+ * conversion.  snapshot_complete() is called with the result.
+ * @return 0 if started or queued, -1 if the queue is full or the pool is down
+ */
+int snapshot_decoder_submit(snapshot_context_t *ctx);
+
+/** Drop a pending request whose snapshot context is going away */
+void snapshot_decoder_cancel(snapshot_context_t *ctx);
+
+/** Enforce timeouts, reap exited decoders and keep the pool filled */
+void snapshot_decoder_tick(int64_t now);
+
+/**
+ * Start a helper process running command under /bin/sh, with inherited
+ * descriptors closed and SIGKILL on parent death
+ * @param stdin_fd Descriptor for the child's stdin, -1 for /dev/null
+ * @param stdout_fd Descriptor for the child's stdout, -1 for /dev/null
+ * @return Child pid, or -1 if fork() failed
+ */
+pid_t snapshot_spawn_command(const char *command, int stdin_fd, int stdout_fd);
+
+#endif /* SNAPSHOT_DECODER_H */
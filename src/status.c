@@ -21,23 +21,29 @@ status_shared_t *status_shared = NULL;
 /* Path for shared memory file in /tmp */
 static char shm_path[256] = {0};
 
-typedef enum { STATUS_LOG_EVENT_ADD = 1 } status_log_event_type_t;
-
 typedef enum { STATUS_CONTROL_EVENT_CLEAR_LOGS = 1 } status_control_event_type_t;
 
 typedef struct {
   uint32_t type;
+} status_control_event_t;
+
+/* Header of a worker log record; the message bytes follow, padded to 8 */
+typedef struct {
   int64_t timestamp;
-  loglevel_t level;
-  char message[STATUS_LOG_ENTRY_LEN];
-} status_log_event_t;
+  uint32_t length; /* Message bytes, without terminator */
+  int32_t level;
+} status_log_record_t;
 
+/* Single-producer single-consumer ring of log records: the worker (or worker
+ * thread) of the same index appends, the supervisor prints and stores them.
+ * head and tail only grow; offsets are taken modulo the size. */
 typedef struct {
-  uint32_t type;
-} status_control_event_t;
+  _Atomic uint64_t head;
+  _Atomic uint64_t tail;
+  char data[STATUS_LOG_RING_SIZE];
+} status_log_ring_t;
 
-static int log_event_recv_fd = -1;
-static int log_event_send_fd = -1;
+static status_log_ring_t *log_rings = NULL;
 static int control_event_recv_fd = -1;
 static int control_event_send_fd = -1;
 
@@ -248,27 +254,27 @@ int status_init(void) {
     return -1;
   }
 
-  int log_fds[2];
-  if (socketpair(AF_UNIX, SOCK_DGRAM, 0, log_fds) == -1) {
+  void *rings = mmap(NULL, sizeof(status_log_ring_t) * STATUS_MAX_WORKERS, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (rings == MAP_FAILED) {
     int err = errno;
     status_shared = NULL;
     munmap(mapped, sizeof(status_shared_t));
     unlink(shm_path);
-    logger(LOG_ERROR, "Failed to create status log socketpair: %s", strerror(err));
+    logger(LOG_ERROR, "Failed to map worker log rings: %s", strerror(err));
     return -1;
   }
-  log_event_recv_fd = log_fds[0];
-  log_event_send_fd = log_fds[1];
-  set_fd_nonblocking(log_event_recv_fd);
-  set_fd_nonblocking(log_event_send_fd);
+  log_rings = rings;
+  for (int i = 0; i < STATUS_MAX_WORKERS; i++) {
+    atomic_init(&log_rings[i].head, 0);
+    atomic_init(&log_rings[i].tail, 0);
+  }
 
   int control_fds[2];
   if (socketpair(AF_UNIX, SOCK_DGRAM, 0, control_fds) == -1) {
     int err = errno;
-    close(log_event_recv_fd);
-    close(log_event_send_fd);
-    log_event_recv_fd = -1;
-    log_event_send_fd = -1;
+    munmap(log_rings, sizeof(status_log_ring_t) * STATUS_MAX_WORKERS);
+    log_rings = NULL;
     status_shared = NULL;
     munmap(mapped, sizeof(status_shared_t));
     unlink(shm_path);
@@ -301,10 +307,8 @@ int status_init(void) {
         if (status_shared->worker_notification_pipes[j] != -1)
           close(status_shared->worker_notification_pipes[j]);
       }
-      close(log_event_recv_fd);
-      close(log_event_send_fd);
-      log_event_recv_fd = -1;
-      log_event_send_fd = -1;
+      munmap(log_rings, sizeof(status_log_ring_t) * STATUS_MAX_WORKERS);
+      log_rings = NULL;
       close(control_event_recv_fd);
       close(control_event_send_fd);
       control_event_recv_fd = -1;
@@ -359,13 +363,9 @@ void status_cleanup(void) {
   if (worker_id == SUPERVISOR_WORKER_ID)
     status_supervisor_drain_logs();
 
-  if (log_event_recv_fd >= 0) {
-    close(log_event_recv_fd);
-    log_event_recv_fd = -1;
-  }
-  if (log_event_send_fd >= 0) {
-    close(log_event_send_fd);
-    log_event_send_fd = -1;
+  if (log_rings) {
+    munmap(log_rings, sizeof(status_log_ring_t) * STATUS_MAX_WORKERS);
+    log_rings = NULL;
   }
   if (control_event_recv_fd >= 0) {
     close(control_event_recv_fd);
@@ -412,17 +412,13 @@ void status_cleanup(void) {
 }
 
 void status_worker_init(void) {
-  if (log_event_recv_fd >= 0) {
-    close(log_event_recv_fd);
-    log_event_recv_fd = -1;
-  }
   if (control_event_recv_fd >= 0) {
     close(control_event_recv_fd);
     control_event_recv_fd = -1;
   }
 }
 
-int status_register_client(const char *client_addr_str, const char *service_url) {
+int status_register_client(const char *client_addr_str, const char *service_url, const char *service_type) {
   int status_index = -1;
   uint32_t owner_pid = (uint32_t)getpid();
 
@@ -463,6 +459,7 @@ int status_register_client(const char *client_addr_str, const char *service_url)
   client->payload.worker_index = worker_id;
   client->payload.connect_time = get_realtime_ms();
   client->payload.state = CLIENT_STATE_CONNECTING;
+  client->payload.rtt_ms = -1;
 
   /* Copy client address string (format: "IP:port", "[IPv6]:port", or
    * "localhost" for Unix socket clients) */
@@ -483,6 +480,10 @@ int status_register_client(const char *client_addr_str, const char *service_url)
     strncpy(client->payload.service_url, service_url, sizeof(client->payload.service_url) - 1);
     client->payload.service_url[sizeof(client->payload.service_url) - 1] = '\0';
   }
+  if (service_type) {
+    strncpy(client->payload.service_type, service_type, sizeof(client->payload.service_type) - 1);
+    client->payload.service_type[sizeof(client->payload.service_type) - 1] = '\0';
+  }
 
   atomic_store_explicit(&client->active, 1, memory_order_release);
 
@@ -492,6 +493,14 @@ int status_register_client(const char *client_addr_str, const char *service_url)
   return status_index;
 }
 
+int status_snapshot_client(int status_index, client_stats_payload_t *snapshot) {
+  uint32_t owner_pid = 0;
+
+  if (!status_shared || !snapshot || status_index < 0 || status_index >= STATUS_MAX_CLIENTS)
+    return 0;
+  return snapshot_client(&status_shared->clients[status_index], snapshot, &owner_pid, NULL);
+}
+
 void status_unregister_client(int status_index) {
   if (!status_shared)
     return;
@@ -546,9 +555,10 @@ int status_reap_worker(pid_t dead_pid, int worker_index) {
   atomic_compare_exchange_strong_explicit(&status_shared->client_admission_owner_pid, &expected_admission_owner, 0,
                                           memory_order_release, memory_order_relaxed);
 
-  if (worker_index >= 0 && worker_index < STATUS_MAX_WORKERS &&
-      status_shared->worker_stats[worker_index].worker_pid == dead_pid) {
-    memset(&status_shared->worker_stats[worker_index], 0, sizeof(worker_stats_t));
+  /* A worker-threads process owns one stats slot per thread */
+  for (int i = 0; i < STATUS_MAX_WORKERS; i++) {
+    if (status_shared->worker_stats[i].worker_pid == dead_pid)
+      memset(&status_shared->worker_stats[i], 0, sizeof(worker_stats_t));
   }
 
   if (reclaimed > 0) {
@@ -582,6 +592,16 @@ int status_worker_get_notif_fd(void) {
   return notif_fd;
 }
 
+void status_worker_keep_notif_fds(int count) {
+  if (!status_shared)
+    return;
+
+  for (int i = count; i < STATUS_MAX_WORKERS; i++) {
+    if (status_shared->worker_notification_pipe_read_fds[i] != -1)
+      close(status_shared->worker_notification_pipe_read_fds[i]);
+  }
+}
+
 void status_trigger_event(status_event_type_t event_type) {
   uint8_t event_byte = (uint8_t)event_type;
   int i;
@@ -670,6 +690,75 @@ void status_update_client_queue(int status_index, size_t queue_bytes, size_t que
   client_write_end(client);
 }
 
+void status_update_client_rtp(int status_index, uint32_t jitter_us, uint64_t expected, uint64_t lost, int32_t rtt_ms) {
+  if (!status_shared)
+    return;
+
+  if (status_index < 0 || status_index >= STATUS_MAX_CLIENTS)
+    return;
+
+  client_stats_t *client = &status_shared->clients[status_index];
+  if (atomic_load_explicit(&client->owner_pid, memory_order_acquire) != (uint32_t)getpid() ||
+      !atomic_load_explicit(&client->active, memory_order_acquire))
+    return;
+
+  client_write_begin(client);
+  client->payload.rtp_jitter_us = jitter_us;
+  client->payload.rtp_expected = expected;
+  client->payload.rtp_lost = lost;
+  client->payload.rtt_ms = rtt_ms;
+  client_write_end(client);
+}
+
+static size_t log_record_size(uint32_t length) {
+  return sizeof(status_log_record_t) + (((size_t)length + 7) & ~(size_t)7);
+}
+
+static void log_ring_copy_in(status_log_ring_t *ring, uint64_t pos, const void *src, size_t len) {
+  size_t offset = (size_t)(pos % STATUS_LOG_RING_SIZE);
+  size_t first = STATUS_LOG_RING_SIZE - offset;
+  if (first > len)
+    first = len;
+  memcpy(ring->data + offset, src, first);
+  memcpy(ring->data, (const char *)src + first, len - first);
+}
+
+static void log_ring_copy_out(const status_log_ring_t *ring, uint64_t pos, void *dst, size_t len) {
+  size_t offset = (size_t)(pos % STATUS_LOG_RING_SIZE);
+  size_t first = STATUS_LOG_RING_SIZE - offset;
+  if (first > len)
+    first = len;
+  memcpy(dst, ring->data + offset, first);
+  memcpy((char *)dst + first, ring->data, len - first);
+}
+
+int status_queue_worker_log(enum loglevel level, const char *message, size_t len) {
+  if (!log_rings || !status_shared || worker_id < 0 || worker_id >= STATUS_MAX_WORKERS)
+    return -1;
+
+  status_log_ring_t *ring = &log_rings[worker_id];
+  status_log_record_t record;
+
+  if (len > STATUS_LOG_ENTRY_LEN - 1)
+    len = STATUS_LOG_ENTRY_LEN - 1;
+  record.timestamp = get_realtime_ms();
+  record.length = (uint32_t)len;
+  record.level = (int32_t)level;
+
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  size_t size = log_record_size(record.length);
+  if (size > STATUS_LOG_RING_SIZE - (size_t)(head - tail)) {
+    status_shared->worker_stats[worker_id].log_dropped++;
+    return 0;
+  }
+
+  log_ring_copy_in(ring, head, &record, sizeof(record));
+  log_ring_copy_in(ring, head + sizeof(record), message, len);
+  atomic_store_explicit(&ring->head, head + size, memory_order_release);
+  return 0;
+}
+
 void status_add_log_entry(enum loglevel level, const char *message) {
   if (!status_shared || !message)
     return;
@@ -680,16 +769,7 @@ void status_add_log_entry(enum loglevel level, const char *message) {
     return;
   }
 
-  if (log_event_send_fd < 0)
-    return;
-
-  status_log_event_t event;
-  memset(&event, 0, sizeof(event));
-  event.type = STATUS_LOG_EVENT_ADD;
-  event.timestamp = get_realtime_ms();
-  event.level = level;
-  strncpy(event.message, message, sizeof(event.message) - 1);
-  (void)send(log_event_send_fd, &event, sizeof(event), MSG_DONTWAIT);
+  status_queue_worker_log(level, message, strlen(message));
 }
 
 void status_supervisor_drain_logs(void) {
@@ -697,23 +777,30 @@ void status_supervisor_drain_logs(void) {
     return;
 
   int changed = 0;
-  if (log_event_recv_fd >= 0) {
-    for (;;) {
-      status_log_event_t event;
-      ssize_t received = recv(log_event_recv_fd, &event, sizeof(event), MSG_DONTWAIT);
-      if (received < 0) {
-        if (errno == EINTR)
-          continue;
-        break;
-      }
-      if ((size_t)received != sizeof(event))
-        continue;
-      if (event.type == STATUS_LOG_EVENT_ADD) {
-        event.message[sizeof(event.message) - 1] = '\0';
-        append_log_entry(event.timestamp, event.level, event.message);
+  if (log_rings) {
+    for (int i = 0; i < STATUS_MAX_WORKERS; i++) {
+      status_log_ring_t *ring = &log_rings[i];
+      uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+      uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+      while (tail < head) {
+        status_log_record_t record;
+        char message[STATUS_LOG_ENTRY_LEN];
+
+        log_ring_copy_out(ring, tail, &record, sizeof(record));
+        size_t len = record.length < sizeof(message) ? record.length : sizeof(message) - 1;
+        log_ring_copy_out(ring, tail + sizeof(record), message, len);
+        message[len] = '\0';
+        tail += log_record_size(record.length);
+
+        fputs(message, stdout);
+        append_log_entry(record.timestamp, (loglevel_t)record.level, message);
         changed = 1;
       }
+      atomic_store_explicit(&ring->tail, tail, memory_order_release);
     }
+    if (changed)
+      fflush(stdout);
   }
 
   if (control_event_recv_fd >= 0) {
@@ -758,14 +845,149 @@ const char *status_get_log_level_name(enum loglevel level) {
   }
 }
 
-int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_initial, uint32_t *p_last_log_epoch,
-                          uint32_t *p_last_log_sequence) {
-  if (!status_shared)
+/* What one status stream last reported for a client slot */
+typedef struct {
+  uint32_t generation; /* Slot generation reported, 0 if none */
+  char client_id[sizeof(((client_stats_payload_t *)0)->client_id)];
+  client_state_type_t state;
+  uint64_t bytes_sent;
+  uint32_t current_bandwidth;
+  size_t queue_bytes;
+  size_t queue_limit_bytes;
+  size_t queue_bytes_highwater;
+  uint64_t dropped_bytes;
+  int slow_active;
+  uint32_t rtp_jitter_us;
+  uint64_t rtp_expected;
+  uint64_t rtp_lost;
+  int32_t rtt_ms;
+} sse_client_view_t;
+
+struct status_sse_view_s {
+  int sent_initial;
+  uint32_t last_log_epoch;
+  uint32_t last_log_sequence;
+  uint32_t workers_hash; /* FNV-1a of the last workers section sent */
+  sse_client_view_t clients[STATUS_MAX_CLIENTS];
+};
+
+status_sse_view_t *status_sse_view_create(void) { return calloc(1, sizeof(status_sse_view_t)); }
+
+void status_sse_view_free(status_sse_view_t *view) { free(view); }
+
+static uint32_t sse_hash(const char *data, size_t len) {
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static void sse_remember_client(sse_client_view_t *seen, const client_stats_payload_t *client, uint32_t generation) {
+  seen->generation = generation;
+  memcpy(seen->client_id, client->client_id, sizeof(seen->client_id));
+  seen->state = client->state;
+  seen->bytes_sent = client->bytes_sent;
+  seen->current_bandwidth = client->current_bandwidth;
+  seen->queue_bytes = client->queue_bytes;
+  seen->queue_limit_bytes = client->queue_limit_bytes;
+  seen->queue_bytes_highwater = client->queue_bytes_highwater;
+  seen->dropped_bytes = client->dropped_bytes;
+  seen->slow_active = client->slow_active;
+  seen->rtp_jitter_us = client->rtp_jitter_us;
+  seen->rtp_expected = client->rtp_expected;
+  seen->rtp_lost = client->rtp_lost;
+  seen->rtt_ms = client->rtt_ms;
+}
+
+/* Full client entry; op is "" in snapshots and "\"op\":\"add\"," in deltas */
+static int append_client_entry(char *buffer, size_t buffer_capacity, size_t *len, const char *op,
+                               const client_stats_payload_t *client, uint32_t owner_pid, int64_t duration_ms) {
+  /* Escape client-controlled strings before embedding them in JSON. */
+  char escaped_client_id[sizeof(client->client_id) * 6 + 1];
+  char escaped_client_addr[sizeof(client->client_addr) * 6 + 1];
+  char escaped_service_url[sizeof(client->service_url) * 6 + 1];
+  json_escape_string_to_buffer(client->client_id, escaped_client_id, sizeof(escaped_client_id));
+  json_escape_string_to_buffer(client->client_addr, escaped_client_addr, sizeof(escaped_client_addr));
+  json_escape_string_to_buffer(client->service_url, escaped_service_url, sizeof(escaped_service_url));
+
+  return append_sse_data(buffer, buffer_capacity, len,
+                         "{%s\"clientId\":\"%s\",\"workerPid\":%d,\"durationMs\":%lld,"
+                         "\"clientAddr\":\"%s\","
+                         "\"serviceUrl\":\"%s\",\"state\":%d,\"bytesSent\":%llu,"
+                         "\"currentBandwidth\":%u,\"queueBytes\":%zu,"
+                         "\"queueLimitBytes\":%zu,\"queueBytesHighwater\":%zu,"
+                         "\"droppedBytes\":%llu,\"slow\":%d,\"jitterUs\":%u,\"rtpExpected\":%llu,"
+                         "\"rtpLost\":%llu,\"rttMs\":%d}",
+                         op, escaped_client_id, (int)owner_pid, (long long)duration_ms, escaped_client_addr,
+                         escaped_service_url, (int)client->state, (unsigned long long)client->bytes_sent,
+                         client->current_bandwidth, client->queue_bytes, client->queue_limit_bytes,
+                         client->queue_bytes_highwater, (unsigned long long)client->dropped_bytes,
+                         client->slow_active, client->rtp_jitter_us, (unsigned long long)client->rtp_expected,
+                         (unsigned long long)client->rtp_lost, (int)client->rtt_ms);
+}
+
+/* Fields of a reported client that changed since; nothing if none did */
+static int append_client_update(char *buffer, size_t buffer_capacity, size_t *len, int *first,
+                                const sse_client_view_t *seen, const client_stats_payload_t *client) {
+  char fields[512];
+  size_t fields_len = 0;
+
+  if (seen->state != client->state)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"state\":%d", (int)client->state);
+  if (seen->bytes_sent != client->bytes_sent)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"bytesSent\":%llu",
+                    (unsigned long long)client->bytes_sent);
+  if (seen->current_bandwidth != client->current_bandwidth)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"currentBandwidth\":%u", client->current_bandwidth);
+  if (seen->queue_bytes != client->queue_bytes)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"queueBytes\":%zu", client->queue_bytes);
+  if (seen->queue_limit_bytes != client->queue_limit_bytes)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"queueLimitBytes\":%zu", client->queue_limit_bytes);
+  if (seen->queue_bytes_highwater != client->queue_bytes_highwater)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"queueBytesHighwater\":%zu",
+                    client->queue_bytes_highwater);
+  if (seen->dropped_bytes != client->dropped_bytes)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"droppedBytes\":%llu",
+                    (unsigned long long)client->dropped_bytes);
+  if (seen->slow_active != client->slow_active)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"slow\":%d", client->slow_active);
+  if (seen->rtp_jitter_us != client->rtp_jitter_us)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"jitterUs\":%u", client->rtp_jitter_us);
+  if (seen->rtp_expected != client->rtp_expected)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"rtpExpected\":%llu",
+                    (unsigned long long)client->rtp_expected);
+  if (seen->rtp_lost != client->rtp_lost)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"rtpLost\":%llu", (unsigned long long)client->rtp_lost);
+  if (seen->rtt_ms != client->rtt_ms)
+    append_sse_data(fields, sizeof(fields), &fields_len, ",\"rttMs\":%d", (int)client->rtt_ms);
+  if (fields_len == 0)
     return 0;
 
-  int sent_initial = *p_sent_initial;
-  uint32_t last_log_epoch = *p_last_log_epoch;
-  uint32_t last_log_sequence = *p_last_log_sequence;
+  char escaped_client_id[sizeof(client->client_id) * 6 + 1];
+  json_escape_string_to_buffer(client->client_id, escaped_client_id, sizeof(escaped_client_id));
+  if (!*first && append_sse_data(buffer, buffer_capacity, len, ",") < 0)
+    return -1;
+  *first = 0;
+  return append_sse_data(buffer, buffer_capacity, len, "{\"op\":\"update\",\"clientId\":\"%s\"%s}",
+                         escaped_client_id, fields);
+}
+
+static int append_client_removal(char *buffer, size_t buffer_capacity, size_t *len, int *first,
+                                 const sse_client_view_t *seen) {
+  char escaped_client_id[sizeof(seen->client_id) * 6 + 1];
+  json_escape_string_to_buffer(seen->client_id, escaped_client_id, sizeof(escaped_client_id));
+  if (!*first && append_sse_data(buffer, buffer_capacity, len, ",") < 0)
+    return -1;
+  *first = 0;
+  return append_sse_data(buffer, buffer_capacity, len, "{\"op\":\"remove\",\"clientId\":\"%s\"}", escaped_client_id);
+}
+
+static int build_sse_json(char *buffer, size_t buffer_capacity, status_sse_view_t *view) {
+  int full = !view->sent_initial;
+  uint32_t last_log_epoch = view->last_log_epoch;
+  uint32_t last_log_sequence = view->last_log_sequence;
   int i;
   uint64_t total_bytes = 0;
   uint32_t total_bw = 0;
@@ -781,59 +1003,72 @@ int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_init
   int64_t current_time = get_realtime_ms();
   int64_t uptime_ms = current_time - status_shared->server_start_time;
 
+  /* The first event is a full snapshot; later ones carry only the clients
+   * that were added, removed or changed since the previous event */
   size_t len = 0;
-  if (append_sse_data(buffer, buffer_capacity, &len,
-                      "data: "
-                      "{\"serverStartTime\":%lld,\"uptimeMs\":%lld,\"currentLogLevel\":%d,"
-                      "\"version\":\"%s\",\"maxClients\":%d,\"clients\":[",
-                      (long long)status_shared->server_start_time, (long long)uptime_ms,
-                      status_shared->current_log_level, VERSION, config.maxclients) < 0)
-    return 0;
+  if (full) {
+    if (append_sse_data(buffer, buffer_capacity, &len,
+                        "data: "
+                        "{\"type\":\"full\",\"serverStartTime\":%lld,\"uptimeMs\":%lld,\"currentLogLevel\":%d,"
+                        "\"version\":\"%s\",\"maxClients\":%d,\"clients\":[",
+                        (long long)status_shared->server_start_time, (long long)uptime_ms,
+                        status_shared->current_log_level, VERSION, config.maxclients) < 0)
+      return 0;
+  } else {
+    if (append_sse_data(buffer, buffer_capacity, &len,
+                        "data: "
+                        "{\"type\":\"delta\",\"uptimeMs\":%lld,\"currentLogLevel\":%d,\"maxClients\":%d,"
+                        "\"clientChanges\":[",
+                        (long long)uptime_ms, status_shared->current_log_level, config.maxclients) < 0)
+      return 0;
+  }
 
   /* Add client data (only real media streams: have a service_url) */
   int first_client = 1;
   for (i = 0; i < STATUS_MAX_CLIENTS; i++) {
+    sse_client_view_t *seen = &view->clients[i];
     client_stats_payload_t client;
     uint32_t owner_pid = 0;
-    if (snapshot_client(&status_shared->clients[i], &client, &owner_pid, NULL) && client.service_url[0] != '\0') {
+    uint32_t generation = 0;
+    int live = snapshot_client(&status_shared->clients[i], &client, &owner_pid, &generation) &&
+               client.service_url[0] != '\0';
+
+    if (!live && seen->generation &&
+        atomic_load_explicit(&status_shared->clients[i].active, memory_order_acquire) &&
+        atomic_load_explicit(&status_shared->clients[i].generation, memory_order_acquire) == seen->generation)
+      continue; /* Reported client is mid-update; keep it as last seen */
+
+    if (seen->generation && (!live || seen->generation != generation)) {
+      /* Reported client is gone, or its slot was reused */
+      if (!full && append_client_removal(buffer, buffer_capacity, &len, &first_client, seen) < 0)
+        return 0;
+      seen->generation = 0;
+    }
+    if (!live)
+      continue;
+
+    if (seen->generation == generation) {
+      if (append_client_update(buffer, buffer_capacity, &len, &first_client, seen, &client) < 0)
+        return 0;
+    } else {
       if (!first_client && append_sse_data(buffer, buffer_capacity, &len, ",") < 0)
         return 0;
       first_client = 0;
-
-      int64_t duration_ms = current_time - client.connect_time;
-
-      /* Escape client-controlled strings before embedding them in JSON. */
-      char escaped_client_id[sizeof(client.client_id) * 6 + 1];
-      char escaped_client_addr[sizeof(client.client_addr) * 6 + 1];
-      char escaped_service_url[sizeof(client.service_url) * 6 + 1];
-      json_escape_string_to_buffer(client.client_id, escaped_client_id, sizeof(escaped_client_id));
-      json_escape_string_to_buffer(client.client_addr, escaped_client_addr, sizeof(escaped_client_addr));
-      json_escape_string_to_buffer(client.service_url, escaped_service_url, sizeof(escaped_service_url));
-
-      if (append_sse_data(buffer, buffer_capacity, &len,
-                          "{\"clientId\":\"%s\",\"workerPid\":%d,\"durationMs\":%lld,"
-                          "\"clientAddr\":\"%s\","
-                          "\"serviceUrl\":\"%s\",\"state\":%d,\"bytesSent\":%llu,"
-                          "\"currentBandwidth\":%u,\"queueBytes\":%zu,"
-                          "\"queueLimitBytes\":%zu,\"queueBytesHighwater\":%zu,"
-                          "\"droppedBytes\":%llu,\"slow\":%d}",
-                          escaped_client_id, (int)owner_pid, (long long)duration_ms, escaped_client_addr,
-                          escaped_service_url, (int)client.state, (unsigned long long)client.bytes_sent,
-                          client.current_bandwidth, client.queue_bytes, client.queue_limit_bytes,
-                          client.queue_bytes_highwater, (unsigned long long)client.dropped_bytes,
-                          client.slow_active) < 0)
+      if (append_client_entry(buffer, buffer_capacity, &len, full ? "" : "\"op\":\"add\",", &client, owner_pid,
+                              current_time - client.connect_time) < 0)
         return 0;
+    }
+    sse_remember_client(seen, &client, generation);
 
-      streams_count++;
-      total_bytes += client.bytes_sent;
-      total_bw += client.current_bandwidth;
+    streams_count++;
+    total_bytes += client.bytes_sent;
+    total_bw += client.current_bandwidth;
 
-      int worker_index = client.worker_index;
-      if (worker_index >= 0 && worker_index < STATUS_MAX_WORKERS) {
-        worker_active_clients[worker_index]++;
-        worker_active_bytes[worker_index] += client.bytes_sent;
-        worker_bandwidth_sum[worker_index] += client.current_bandwidth;
-      }
+    int worker_index = client.worker_index;
+    if (worker_index >= 0 && worker_index < STATUS_MAX_WORKERS) {
+      worker_active_clients[worker_index]++;
+      worker_active_bytes[worker_index] += client.bytes_sent;
+      worker_bandwidth_sum[worker_index] += client.current_bandwidth;
     }
   }
 
@@ -848,7 +1083,8 @@ int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_init
                       (unsigned long long)total_bytes_sent, total_bw) < 0)
     return 0;
 
-  /* Add per-worker breakdown */
+  /* Add per-worker breakdown (left out of deltas when unchanged) */
+  size_t workers_start = len;
   if (append_sse_data(buffer, buffer_capacity, &len, ",\"workers\":[") < 0)
     return 0;
   int first_worker_entry = 1;
@@ -881,7 +1117,21 @@ int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_init
             "\"utilization\":%.1f},"
             "\"controlPool\":{\"total\":%llu,\"free\":%llu,\"used\":%llu,\"max\":%"
             "llu,\"expansions\":%llu,\"exhaustions\":%llu,\"shrinks\":%llu,"
-            "\"utilization\":%.1f}}",
+            "\"utilization\":%.1f},"
+            "\"cpu\":{\"affinity\":%d,\"current\":%d,\"accepts\":%llu,\"crossCpuAccepts\":%llu,"
+            "\"rxSamples\":%llu,\"crossCpuRxSamples\":%llu},"
+            "\"snapshot\":{\"decoders\":%u,\"busy\":%u,\"queued\":%u,\"queueMax\":%u,\"jobs\":%llu,"
+            "\"failures\":%llu,\"timeouts\":%llu,\"rejects\":%llu,\"spawns\":%llu,\"cached\":%u,"
+            "\"cacheHits\":%llu,\"coalesced\":%llu},"
+            "\"dns\":{\"queries\":%llu,\"cacheHits\":%llu,\"lookups\":%llu,\"failures\":%llu,"
+            "\"latencyTotalMs\":%llu,\"latencyMaxMs\":%u,\"cached\":%u},"
+            "\"http\":{\"requests\":%llu,\"keepaliveReuses\":%llu,\"pipelined\":%llu,\"idleTimeouts\":%llu,"
+            "\"upstreamReuses\":%llu,\"upstreamConnects\":%llu,\"upstreamIdle\":%u,\"segmentHits\":%llu,"
+            "\"segmentCoalesced\":%llu,\"segmentCached\":%u,\"segmentCacheBytes\":%llu},"
+            "\"accessLog\":{\"records\":%llu,\"dropped\":%llu},"
+            "\"logger\":{\"dropped\":%llu,\"suppressed\":%llu},"
+            "\"rtsp\":{\"sharedJoins\":%llu,\"fastStarts\":%llu},"
+            "\"fcc\":{\"poolHits\":%llu,\"poolMisses\":%llu,\"poolIdle\":%u}}",
             i, (int)ws->worker_pid, (unsigned int)w_active, (unsigned long long)w_bandwidth,
             (unsigned long long)w_total_bytes, (unsigned long long)ws->total_sends,
             (unsigned long long)ws->total_completions, (unsigned long long)ws->total_copied,
@@ -893,15 +1143,41 @@ int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_init
             (unsigned long long)w_ctrl_total, (unsigned long long)w_ctrl_free, (unsigned long long)w_ctrl_used,
             (unsigned long long)ws->control_pool_max_buffers, (unsigned long long)ws->control_pool_expansions,
             (unsigned long long)ws->control_pool_exhaustions, (unsigned long long)ws->control_pool_shrinks,
-            w_ctrl_total > 0 ? (100.0 * w_ctrl_used / w_ctrl_total) : 0.0) < 0)
+            w_ctrl_total > 0 ? (100.0 * w_ctrl_used / w_ctrl_total) : 0.0, ws->worker_pid ? (int)ws->cpu_affinity : -1,
+            ws->worker_pid ? (int)ws->current_cpu : -1, (unsigned long long)ws->accepts,
+            (unsigned long long)ws->cross_cpu_accepts, (unsigned long long)ws->rx_samples,
+            (unsigned long long)ws->cross_cpu_rx_samples, (unsigned int)ws->snapshot_decoders,
+            (unsigned int)ws->snapshot_decoders_busy, (unsigned int)ws->snapshot_queue_len,
+            (unsigned int)ws->snapshot_queue_max, (unsigned long long)ws->snapshot_jobs,
+            (unsigned long long)ws->snapshot_failures, (unsigned long long)ws->snapshot_timeouts,
+            (unsigned long long)ws->snapshot_rejects, (unsigned long long)ws->snapshot_spawns,
+            (unsigned int)ws->snapshot_cached, (unsigned long long)ws->snapshot_cache_hits,
+            (unsigned long long)ws->snapshot_coalesced, (unsigned long long)ws->dns_queries,
+            (unsigned long long)ws->dns_cache_hits, (unsigned long long)ws->dns_lookups,
+            (unsigned long long)ws->dns_failures, (unsigned long long)ws->dns_latency_ms_total,
+            (unsigned int)ws->dns_latency_ms_max, (unsigned int)ws->dns_cached, (unsigned long long)ws->http_requests,
+            (unsigned long long)ws->http_keepalive_reuses, (unsigned long long)ws->http_pipelined,
+            (unsigned long long)ws->http_idle_timeouts, (unsigned long long)ws->http_upstream_reuses,
+            (unsigned long long)ws->http_upstream_connects, (unsigned int)ws->http_upstream_idle,
+            (unsigned long long)ws->http_segment_hits, (unsigned long long)ws->http_segment_coalesced,
+            (unsigned int)ws->http_segment_cached, (unsigned long long)ws->http_segment_cache_bytes,
+            (unsigned long long)ws->access_log_records,
+            (unsigned long long)ws->access_log_dropped, (unsigned long long)ws->log_dropped,
+            (unsigned long long)ws->log_suppressed, (unsigned long long)ws->rtsp_share_joins,
+            (unsigned long long)ws->rtsp_fast_starts, (unsigned long long)ws->fcc_socket_pool_hits,
+            (unsigned long long)ws->fcc_socket_pool_misses, (unsigned int)ws->fcc_socket_pool_idle) < 0)
       return 0;
   }
   if (append_sse_data(buffer, buffer_capacity, &len, "]") < 0)
     return 0;
+  uint32_t workers_hash = sse_hash(buffer + workers_start, len - workers_start);
+  if (!full && workers_hash == view->workers_hash)
+    len = workers_start;
+  view->workers_hash = workers_hash;
 
   uint32_t current_log_epoch = atomic_load_explicit(&status_shared->log_epoch, memory_order_acquire);
   uint32_t current_log_sequence = atomic_load_explicit(&status_shared->log_sequence, memory_order_acquire);
-  int full_logs = !sent_initial || current_log_epoch != last_log_epoch || current_log_sequence < last_log_sequence ||
+  int full_logs = full || current_log_epoch != last_log_epoch || current_log_sequence < last_log_sequence ||
                   current_log_sequence - last_log_sequence > STATUS_MAX_LOG_ENTRIES;
   uint32_t first_sequence = 0;
   if (full_logs) {
@@ -947,17 +1223,12 @@ int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_init
         return 0;
     }
   }
-  sent_initial = 1;
-  last_log_epoch = current_log_epoch;
-  last_log_sequence = current_log_sequence;
-
   if (append_sse_data(buffer, buffer_capacity, &len, "]}\n\n") < 0)
     return 0;
 
-  /* Update output parameters */
-  *p_sent_initial = sent_initial;
-  *p_last_log_epoch = last_log_epoch;
-  *p_last_log_sequence = last_log_sequence;
+  view->sent_initial = 1;
+  view->last_log_epoch = current_log_epoch;
+  view->last_log_sequence = current_log_sequence;
 
   /* Update global bandwidth statistics */
   status_shared->total_bandwidth = total_bw;
@@ -965,50 +1236,67 @@ int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_init
   return (int)len;
 }
 
+int status_build_sse_json(char *buffer, size_t buffer_capacity, status_sse_view_t *view) {
+  if (!status_shared || !view)
+    return 0;
+
+  int len = build_sse_json(buffer, buffer_capacity, view);
+  if (len == 0) {
+    /* The view may be half updated; start over with a snapshot */
+    memset(view, 0, sizeof(*view));
+  }
+  return len;
+}
+
+/* Send a JSON API response; Content-Length keeps the connection reusable */
+static void send_api_response(connection_t *c, http_status_t status, const char *response) {
+  char extra_headers[64];
+  size_t len = strlen(response);
+
+  snprintf(extra_headers, sizeof(extra_headers), "Content-Length: %zu\r\n", len);
+  send_http_headers(c, status, "application/json", extra_headers);
+  connection_queue_output_and_flush(c, (const uint8_t *)response, len);
+}
+
 void handle_disconnect_client(connection_t *c) {
   int found = 0;
   char response[512];
   char client_id_str[256] = {0};
 
   if (!status_shared) {
-    send_http_headers(c, STATUS_503, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Status system not initialized\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Status system not initialized\"}");
+    send_api_response(c, STATUS_503, response);
     return;
   }
 
   /* Check HTTP method */
   if (strcasecmp(c->http_req.method, "POST") != 0 && strcasecmp(c->http_req.method, "DELETE") != 0) {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response),
+        snprintf(response, sizeof(response),
              "{\"success\":false,\"error\":\"Method not allowed. Use POST or "
              "DELETE\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
   /* Parse form data body to get client_id */
   if (c->http_req.body_len > 0) {
     if (http_parse_query_param(c->http_req.body, "client_id", client_id_str, sizeof(client_id_str)) != 0) {
-      send_http_headers(c, STATUS_400, "application/json", NULL);
-      snprintf(response, sizeof(response),
+            snprintf(response, sizeof(response),
                "{\"success\":false,\"error\":\"Missing 'client_id' parameter "
                "in request body\"}");
-      connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+      send_api_response(c, STATUS_400, response);
       return;
     }
   } else {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Missing request body\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Missing request body\"}");
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
   /* Validate client_id is not empty */
   if (client_id_str[0] == '\0') {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Empty client_id\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Empty client_id\"}");
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
@@ -1036,8 +1324,6 @@ void handle_disconnect_client(connection_t *c) {
     }
   }
 
-  send_http_headers(c, STATUS_200, "application/json", NULL);
-
   if (found) {
     snprintf(response, sizeof(response), "{\"success\":true,\"message\":\"Disconnect request sent\"}");
   } else {
@@ -1046,7 +1332,7 @@ void handle_disconnect_client(connection_t *c) {
              "disconnected\"}");
   }
 
-  connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+  send_api_response(c, STATUS_200, response);
 }
 
 void handle_clear_logs(connection_t *c) {
@@ -1054,16 +1340,14 @@ void handle_clear_logs(connection_t *c) {
 
   /* Check HTTP method */
   if (strcasecmp(c->http_req.method, "POST") != 0) {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Method not allowed. Use POST\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Method not allowed. Use POST\"}");
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
   if (!status_shared) {
-    send_http_headers(c, STATUS_503, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Status system not initialized\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Status system not initialized\"}");
+    send_api_response(c, STATUS_503, response);
     return;
   }
 
@@ -1075,18 +1359,16 @@ void handle_clear_logs(connection_t *c) {
     bytes_sent = send(control_event_send_fd, &event, sizeof(event), MSG_DONTWAIT);
 
   if (bytes_sent != (ssize_t)sizeof(event)) {
-    send_http_headers(c, STATUS_503, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Failed to queue log clear request\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Failed to queue log clear request\"}");
+    send_api_response(c, STATUS_503, response);
     return;
   }
 
   /* Trigger SSE update to notify clients */
   status_trigger_event(STATUS_EVENT_SSE_UPDATE);
 
-  send_http_headers(c, STATUS_200, "application/json", NULL);
-  snprintf(response, sizeof(response), "{\"success\":true,\"message\":\"Logs cleared\"}");
-  connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+    snprintf(response, sizeof(response), "{\"success\":true,\"message\":\"Logs cleared\"}");
+  send_api_response(c, STATUS_200, response);
 }
 
 void handle_set_log_level(connection_t *c) {
@@ -1096,37 +1378,33 @@ void handle_set_log_level(connection_t *c) {
 
   /* Check HTTP method */
   if (strcasecmp(c->http_req.method, "PUT") != 0 && strcasecmp(c->http_req.method, "PATCH") != 0) {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response),
+        snprintf(response, sizeof(response),
              "{\"success\":false,\"error\":\"Method not allowed. Use PUT or "
              "PATCH\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
   /* Parse form data body to get level */
   if (c->http_req.body_len > 0) {
     if (http_parse_query_param(c->http_req.body, "level", level_str, sizeof(level_str)) != 0) {
-      send_http_headers(c, STATUS_400, "application/json", NULL);
-      snprintf(response, sizeof(response),
+            snprintf(response, sizeof(response),
                "{\"success\":false,\"error\":\"Missing 'level' parameter in "
                "request body\"}");
-      connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+      send_api_response(c, STATUS_400, response);
       return;
     }
   } else {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Missing request body\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Missing request body\"}");
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
   new_level = atoi(level_str);
 
   if (new_level < LOG_FATAL || new_level > LOG_DEBUG) {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Invalid log level (must be 0-4)\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Invalid log level (must be 0-4)\"}");
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
@@ -1134,11 +1412,10 @@ void handle_set_log_level(connection_t *c) {
   if (status_shared) {
     status_shared->current_log_level = new_level;
   }
-  send_http_headers(c, STATUS_200, "application/json", NULL);
 
   snprintf(response, sizeof(response), "{\"success\":true,\"message\":\"Log level changed to %s\"}",
            status_get_log_level_name(new_level));
-  connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+  send_api_response(c, STATUS_200, response);
 }
 
 void handle_reload_config(connection_t *c) {
@@ -1146,9 +1423,8 @@ void handle_reload_config(connection_t *c) {
 
   /* Check HTTP method */
   if (strcasecmp(c->http_req.method, "POST") != 0) {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Method not allowed. Use POST\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Method not allowed. Use POST\"}");
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
@@ -1157,16 +1433,15 @@ void handle_reload_config(connection_t *c) {
 
   /* Send SIGHUP to supervisor */
   if (kill(supervisor_pid, SIGHUP) == 0) {
-    send_http_headers(c, STATUS_200, "application/json", NULL);
     snprintf(response, sizeof(response), "{\"success\":true,\"message\":\"Configuration reload triggered\"}");
+    send_api_response(c, STATUS_200, response);
   } else {
-    send_http_headers(c, STATUS_500, "application/json", NULL);
     snprintf(response, sizeof(response),
              "{\"success\":false,\"error\":\"Failed to send signal to "
              "supervisor: %s\"}",
              strerror(errno));
+    send_api_response(c, STATUS_500, response);
   }
-  connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
 }
 
 void handle_restart_workers(connection_t *c) {
@@ -1174,9 +1449,8 @@ void handle_restart_workers(connection_t *c) {
 
   /* Check HTTP method */
   if (strcasecmp(c->http_req.method, "POST") != 0) {
-    send_http_headers(c, STATUS_400, "application/json", NULL);
-    snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Method not allowed. Use POST\"}");
-    connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
+        snprintf(response, sizeof(response), "{\"success\":false,\"error\":\"Method not allowed. Use POST\"}");
+    send_api_response(c, STATUS_400, response);
     return;
   }
 
@@ -1185,39 +1459,50 @@ void handle_restart_workers(connection_t *c) {
 
   /* Send SIGUSR1 to supervisor */
   if (kill(supervisor_pid, SIGUSR1) == 0) {
-    send_http_headers(c, STATUS_200, "application/json", NULL);
     snprintf(response, sizeof(response), "{\"success\":true,\"message\":\"Worker restart triggered\"}");
+    send_api_response(c, STATUS_200, response);
   } else {
-    send_http_headers(c, STATUS_500, "application/json", NULL);
     snprintf(response, sizeof(response),
              "{\"success\":false,\"error\":\"Failed to send signal to "
              "supervisor: %s\"}",
              strerror(errno));
+    send_api_response(c, STATUS_500, response);
   }
-  connection_queue_output_and_flush(c, (const uint8_t *)response, strlen(response));
 }
 
-int status_handle_sse_init(connection_t *c) {
-  if (!c)
-    return -1;
+/* Build and queue the next event of one status stream */
+static int sse_send_update(connection_t *c, int64_t now) {
+  char tmp[SSE_BUFFER_SIZE];
 
-  /* Send SSE headers */
-  send_http_headers(c, STATUS_200, "text/event-stream", NULL);
+  c->sse_pending = 0;
+  c->sse_last_sent = now;
+  c->next_sse_ts = now + STATUS_SSE_REFRESH_INTERVAL_MS;
 
-  c->sse_sent_initial = 0;
-  c->sse_last_log_epoch = 0;
-  c->sse_last_log_sequence = 0;
-  c->next_sse_ts = get_time_ms();
+  int len = status_build_sse_json(tmp, sizeof(tmp), c->sse_view);
+  if (len <= 0 || connection_queue_output_and_flush(c, (const uint8_t *)tmp, (size_t)len) < 0)
+    return -1;
+  /* Queueing marks the connection closing; the stream stays open */
+  c->state = CONN_SSE;
+  return 0;
+}
 
-  /* Build and send initial SSE payload immediately */
-  char tmp[SSE_BUFFER_SIZE];
-  int len =
-      status_build_sse_json(tmp, sizeof(tmp), &c->sse_sent_initial, &c->sse_last_log_epoch, &c->sse_last_log_sequence);
+int status_handle_sse_init(connection_t *c) {
+  if (!c)
+    return -1;
 
-  if (len > 0) {
-    connection_queue_output_and_flush(c, (const uint8_t *)tmp, (size_t)len);
+  c->sse_view = status_sse_view_create();
+  if (!c->sse_view) {
+    logger(LOG_ERROR, "Failed to allocate status stream state");
+    http_send_503(c);
+    return 0;
   }
 
+  /* Send SSE headers; the event stream occupies the connection until it closes */
+  c->keepalive = 0;
+  send_http_headers(c, STATUS_200, "text/event-stream", NULL);
+
+  /* Send the initial snapshot immediately */
+  sse_send_update(c, get_time_ms());
   c->state = CONN_SSE;
 
   return 0;
@@ -1225,28 +1510,25 @@ int status_handle_sse_init(connection_t *c) {
 
 int status_handle_sse_notification(connection_t *conn_head) {
   int updated_count = 0;
+  int64_t now = get_time_ms();
 
   if (!status_shared)
     return 0;
 
-  /* Build and enqueue SSE payloads for all SSE connections
-   * Note: Each connection has its own state (sse_sent_initial,
-   * per-connection log cursors, so we must build a separate
-   * payload for each connection */
+  /* Each connection has its own view of what it last reported, so payloads
+   * are built per connection.  Bursts of events are coalesced: a stream
+   * updated less than STATUS_SSE_MIN_INTERVAL_MS ago is marked pending and
+   * flushed by its heartbeat. */
   for (connection_t *cc = conn_head; cc; cc = cc->next) {
     if (cc->state != CONN_SSE)
       continue;
 
-    char tmp[SSE_BUFFER_SIZE];
-    int len = status_build_sse_json(tmp, sizeof(tmp), &cc->sse_sent_initial, &cc->sse_last_log_epoch,
-                                    &cc->sse_last_log_sequence);
-
-    if (len > 0) {
-      if (connection_queue_output_and_flush(cc, (const uint8_t *)tmp, (size_t)len) == 0) {
-        cc->state = CONN_SSE;
-        updated_count++;
-      }
+    if (now - cc->sse_last_sent < STATUS_SSE_MIN_INTERVAL_MS) {
+      cc->sse_pending = 1;
+      continue;
     }
+    if (sse_send_update(cc, now) == 0)
+      updated_count++;
   }
 
   return updated_count;
@@ -1256,13 +1538,10 @@ int status_handle_sse_heartbeat(connection_t *c, int64_t now) {
   if (!c || c->state != CONN_SSE)
     return -1;
 
-  /* Check if heartbeat is needed */
-  if (c->next_sse_ts > now)
+  /* Flush a coalesced update, or refresh the counters once per interval */
+  if (!(c->sse_pending && now - c->sse_last_sent >= STATUS_SSE_MIN_INTERVAL_MS) && c->next_sse_ts > now)
     return -1;
 
-  /* Trigger periodic SSE update (once per second) */
-  status_trigger_event(STATUS_EVENT_SSE_UPDATE);
-  c->next_sse_ts = now + 1000;
-
+  sse_send_update(c, now);
   return 0;
 }
@@ -23,8 +23,18 @@ typedef enum {
 #define STATUS_MAX_LOG_ENTRIES 100
 #define STATUS_LOG_ENTRY_LEN 1024
 
+/* Per-worker ring of log records awaiting output by the supervisor */
+#define STATUS_LOG_RING_SIZE (128 * 1024)
+
 #define SSE_BUFFER_SIZE 262144 /* 256k */
 
+/* Status streams get at most one event per interval; events arriving
+ * sooner are coalesced into the next one */
+#define STATUS_SSE_MIN_INTERVAL_MS 250
+
+/* Status streams are refreshed at least this often */
+#define STATUS_SSE_REFRESH_INTERVAL_MS 1000
+
 /* Client state types for status display */
 typedef enum {
   CLIENT_STATE_CONNECTING = 0,
@@ -69,6 +79,7 @@ typedef struct {
   int64_t connect_time;             /* Connection timestamp in milliseconds */
   char client_addr[128];            /* Client address (IP:port format, IPv6 uses []:port) */
   char service_url[256];            /* Service URL being accessed */
+  char service_type[8];             /* Service type name ("rtp", "rtsp" or "http") */
   client_state_type_t state;        /* Current connection state */
   uint64_t bytes_sent;              /* Total bytes sent to client */
   uint32_t current_bandwidth;       /* Current bandwidth in bytes/sec */
@@ -81,6 +92,10 @@ typedef struct {
   uint64_t dropped_bytes;           /* Total dropped bytes */
   uint32_t backpressure_events;     /* Times upstream reads were paused due to client backpressure (TCP only) */
   int slow_active;
+  uint32_t rtp_jitter_us;           /* RTP interarrival jitter (RFC 3550) of the upstream */
+  uint64_t rtp_expected;            /* RTP packets expected from the upstream source */
+  uint64_t rtp_lost;                /* RTP packets of those never received */
+  int32_t rtt_ms;                   /* Upstream round trip time, -1 if unknown */
 } client_stats_payload_t;
 
 /* Per-client statistics stored in shared memory. owner_pid is also the
@@ -136,6 +151,67 @@ typedef struct {
   uint64_t control_pool_expansions;
   uint64_t control_pool_exhaustions;
   uint64_t control_pool_shrinks;
+
+  /* CPU placement statistics */
+  int32_t cpu_affinity;          /* CPU the worker is pinned to, -1 if unpinned */
+  int32_t current_cpu;           /* CPU the worker last ran on, -1 if unknown */
+  uint64_t accepts;              /* Accepted client connections */
+  uint64_t cross_cpu_accepts;    /* Accepts whose SYN was handled on another CPU */
+  uint64_t rx_samples;           /* Sampled upstream datagram reads */
+  uint64_t cross_cpu_rx_samples; /* Samples whose packets were handled on another CPU */
+
+  /* Snapshot decoder pool statistics */
+  uint32_t snapshot_decoders;      /* Running decoder coprocesses */
+  uint32_t snapshot_decoders_busy; /* Decoders converting a frame */
+  uint32_t snapshot_queue_len;     /* Requests waiting for a decoder */
+  uint32_t snapshot_queue_max;     /* Configured queue depth */
+  uint64_t snapshot_jobs;          /* Successful JPEG conversions */
+  uint64_t snapshot_failures;      /* Failed or cancelled conversions */
+  uint64_t snapshot_timeouts;      /* Requests that hit the conversion timeout */
+  uint64_t snapshot_rejects;       /* Requests rejected because the queue was full */
+  uint64_t snapshot_spawns;        /* Decoder processes started */
+  uint32_t snapshot_cached;        /* Channel JPEGs held in the snapshot cache */
+  uint64_t snapshot_cache_hits;    /* Requests answered from the snapshot cache */
+  uint64_t snapshot_coalesced;     /* Requests that joined another request's capture */
+
+  /* Asynchronous DNS resolver statistics */
+  uint64_t dns_queries;          /* Host name resolutions requested */
+  uint64_t dns_cache_hits;       /* Answered from /etc/hosts or the resolver cache */
+  uint64_t dns_lookups;          /* Lookups sent to nameservers */
+  uint64_t dns_failures;         /* Lookups that found no address */
+  uint64_t dns_latency_ms_total; /* Sum of lookup latencies */
+  uint32_t dns_latency_ms_max;   /* Slowest lookup */
+  uint32_t dns_cached;           /* Names held in the resolver cache */
+
+  /* HTTP keep-alive statistics */
+  uint64_t http_requests;            /* Requests parsed on client connections */
+  uint64_t http_keepalive_reuses;    /* Requests that arrived on an already used connection */
+  uint64_t http_pipelined;           /* Requests already buffered when the previous response finished */
+  uint64_t http_idle_timeouts;       /* Persistent connections closed after idling */
+  uint64_t http_upstream_reuses;     /* Proxied requests sent on an idle upstream connection */
+  uint64_t http_upstream_connects;   /* Proxied requests that opened a new upstream connection */
+  uint32_t http_upstream_idle;       /* Idle upstream connections kept for reuse */
+  uint64_t http_segment_hits;        /* HLS segment requests answered from the segment cache */
+  uint64_t http_segment_coalesced;   /* HLS segment requests that joined another client's download */
+  uint32_t http_segment_cached;      /* HLS segments held in the segment cache */
+  uint64_t http_segment_cache_bytes; /* Bytes of the cached HLS segments */
+
+  /* Access log statistics */
+  uint64_t access_log_records; /* Lines queued for the supervisor's writer */
+  uint64_t access_log_dropped; /* Lines dropped because the ring was full */
+
+  /* Logger statistics */
+  uint64_t log_dropped;    /* Messages dropped because the log ring was full */
+  uint64_t log_suppressed; /* Messages collapsed by the per-call-site rate limit */
+
+  /* Shared upstream RTSP session statistics */
+  uint64_t rtsp_share_joins; /* Clients served by an already running upstream session */
+  uint64_t rtsp_fast_starts; /* Sessions that skipped OPTIONS and DESCRIBE */
+
+  /* FCC socket pool statistics */
+  uint64_t fcc_socket_pool_hits;   /* FCC sessions started on a pre-bound socket */
+  uint64_t fcc_socket_pool_misses; /* FCC sessions that had to bind a new socket */
+  uint32_t fcc_socket_pool_idle;   /* Pre-bound FCC sockets (or pairs) waiting for a session */
 } worker_stats_t;
 
 /* Shared memory structure for status information */
@@ -176,6 +252,9 @@ typedef struct {
 /* Global pointer to shared memory segment */
 extern status_shared_t *status_shared;
 
+/* Per-connection state of a status SSE stream (see status_build_sse_json) */
+typedef struct status_sse_view_s status_sse_view_t;
+
 /**
  * Initialize status tracking system
  * Creates shared memory segment for IPC between parent and child processes
@@ -195,7 +274,8 @@ void status_worker_init(void);
 /* Drain worker log/control datagrams in the supervisor. */
 void status_supervisor_drain_logs(void);
 
-/* Reclaim every client slot owned by a worker confirmed dead by waitpid(). */
+/* Reclaim every client slot and worker stats slot owned by a worker process
+ * confirmed dead by waitpid(). */
 int status_reap_worker(pid_t dead_pid, int worker_index);
 
 /**
@@ -206,9 +286,18 @@ int status_reap_worker(pid_t dead_pid, int worker_index);
  * @param client_addr_str Client address string (format: "IP:port",
  * "[IPv6]:port", or "localhost" for Unix socket clients)
  * @param service_url Service URL string (e.g., HTTP request path)
+ * @param service_type Service type name (see service_type_name())
  * @return Client slot index (status_index) on success, -1 on error
  */
-int status_register_client(const char *client_addr_str, const char *service_url);
+int status_register_client(const char *client_addr_str, const char *service_url, const char *service_type);
+
+/**
+ * Copy a consistent snapshot of a client slot
+ * @param status_index Client slot index
+ * @param snapshot Receives the payload
+ * @return 1 if the slot holds a published client, 0 otherwise
+ */
+int status_snapshot_client(int status_index, client_stats_payload_t *snapshot);
 
 /**
  * Unregister a streaming client connection from shared memory
@@ -238,6 +327,16 @@ void status_update_client_queue(int status_index, size_t queue_bytes, size_t que
                                 size_t queue_bytes_highwater, size_t queue_buffers_highwater, uint64_t dropped_packets,
                                 uint64_t dropped_bytes, uint32_t backpressure_events, int slow_active);
 
+/**
+ * Update upstream RTP reception statistics by status index
+ * @param status_index Client slot index returned by status_register_client()
+ * @param jitter_us Interarrival jitter in microseconds
+ * @param expected RTP packets expected from the upstream source
+ * @param lost RTP packets of those never received
+ * @param rtt_ms Upstream round trip time, -1 if unknown
+ */
+void status_update_client_rtp(int status_index, uint32_t jitter_us, uint64_t expected, uint64_t lost, int32_t rtt_ms);
+
 /**
  * Add log entry to circular buffer
  * Called by logger function to store logs for status page
@@ -246,6 +345,21 @@ void status_update_client_queue(int status_index, size_t queue_bytes, size_t que
  */
 void status_add_log_entry(loglevel_t level, const char *message);
 
+/**
+ * Hand a formatted log line to the supervisor (worker side, never blocks)
+ *
+ * The line is appended to this worker's log ring; the supervisor writes it
+ * to stdout and to the status page log on its next tick.  When the ring is
+ * full the line is dropped and counted.
+ *
+ * @param level Log level
+ * @param message Log line, including the trailing newline
+ * @param len Length of message
+ * @return 0 if queued or dropped, -1 if not running as a worker (the caller
+ * prints the line itself)
+ */
+int status_queue_worker_log(loglevel_t level, const char *message, size_t len);
+
 /**
  * Handle API request to disconnect a client
  * RESTful: POST/DELETE <status-path>/api/disconnect with form data body
@@ -292,6 +406,13 @@ void handle_restart_workers(connection_t *c);
  */
 int status_worker_get_notif_fd(void);
 
+/**
+ * Keep the notification pipe read fds of worker slots [0, count) and close
+ * the others (worker-threads mode, where each thread polls its own slot)
+ * @param count Number of worker threads in this process
+ */
+void status_worker_keep_notif_fds(int count);
+
 /**
  * Trigger an event notification to wake up workers
  * Called when significant events occur (connect/disconnect/state
@@ -308,18 +429,27 @@ void status_trigger_event(status_event_type_t event_type);
 const char *status_get_log_level_name(loglevel_t level);
 
 /**
- * Build SSE JSON payload with status information (for event-driven SSE)
- * This function is used by worker.c to build SSE payloads for connections.
+ * Allocate the per-stream state of a status SSE connection
+ * @return New state (starts with a full snapshot), or NULL on allocation failure
+ */
+status_sse_view_t *status_sse_view_create(void);
+
+/** Free status SSE stream state (NULL is ignored) */
+void status_sse_view_free(status_sse_view_t *view);
+
+/**
+ * Build the next SSE event of a status stream
+ * The first event is a full snapshot ("type":"full"); later ones are deltas
+ * ("type":"delta") whose clientChanges list only the clients added, removed
+ * or changed since the previous event, and which leave out unchanged worker
+ * stats.
  *
  * @param buffer Output buffer
  * @param buffer_capacity Buffer size
- * @param p_sent_initial Pointer to sent_initial flag (in/out)
- * @param p_last_log_epoch Pointer to last observed log epoch (in/out)
- * @param p_last_log_sequence Pointer to last observed log sequence (in/out)
- * @return Number of bytes written to buffer
+ * @param view What the stream last reported (updated)
+ * @return Number of bytes written to buffer, 0 on error
  */
-int status_build_sse_json(char *buffer, size_t buffer_capacity, int *p_sent_initial, uint32_t *p_last_log_epoch,
-                          uint32_t *p_last_log_sequence);
+int status_build_sse_json(char *buffer, size_t buffer_capacity, status_sse_view_t *view);
 
 /**
  * Initialize SSE connection for a client
@@ -332,7 +462,8 @@ int status_handle_sse_init(connection_t *c);
 
 /**
  * Handle SSE notification event
- * Builds and enqueues SSE payloads for all active SSE connections
+ * Builds and enqueues SSE payloads for all active SSE connections, or marks
+ * them pending when they were updated within STATUS_SSE_MIN_INTERVAL_MS
  *
  * @param conn_head Head of connection list
  * @return Number of connections updated
@@ -341,9 +472,8 @@ int status_handle_sse_notification(connection_t *conn_head);
 
 /**
  * Handle SSE heartbeat for a connection
- * Triggers status update to keep connection alive and update frontend
- * Only sends heartbeat when there are no active media clients (every 1s)
- * When clients are active, relies on event-driven updates
+ * Sends a pending coalesced update once the minimum interval has passed, and
+ * refreshes the stream every STATUS_SSE_REFRESH_INTERVAL_MS otherwise
  *
  * @param c Connection object
  * @param now Current timestamp in milliseconds
@@ -6,6 +6,7 @@
 #include "rtp.h"
 #include "rtp_fec.h"
 #include "rtsp.h"
+#include "rtsp_share.h"
 #include "service.h"
 #include "snapshot.h"
 #include "status.h"
@@ -61,6 +62,7 @@ int stream_process_rtp_payload(stream_context_t *ctx, buffer_ref_t *buf_ref) {
   }
 
   /* pkt_type == 1: Regular RTP packet */
+  rtcp_receiver_on_rtp(&ctx->rtcp, data_ptr, get_time_us());
 
   /* Adjust buffer to point to payload */
   buf_ref->data_offset = payload - (uint8_t *)buf_ref->data;
@@ -126,11 +128,7 @@ int stream_handle_fd_event(stream_context_t *ctx, int fd, uint32_t events, int64
   /* Handle UDP RTCP socket - drain all available packets for
    * edge-triggered pollers (epoll EPOLLET / kqueue EV_CLEAR). */
   if (ctx->rtsp.initialized && ctx->rtsp.rtcp_socket >= 0 && fd == ctx->rtsp.rtcp_socket) {
-    /* RTCP data processing could be added here in the future */
-    /* For now, just consume all data to prevent buffer overflow */
-    uint8_t rtcp_buffer[RTCP_BUFFER_SIZE];
-    while (recv(ctx->rtsp.rtcp_socket, rtcp_buffer, sizeof(rtcp_buffer), 0) > 0)
-      ;
+    rtsp_handle_udp_rtcp_data(&ctx->rtsp);
     return 0;
   }
 
@@ -160,6 +158,7 @@ int stream_context_init_for_worker(stream_context_t *ctx, connection_t *conn, se
   ctx->total_bytes_sent = 0;
   ctx->last_bytes_sent = 0;
   ctx->last_status_update = get_time_ms();
+  rtcp_receiver_init(&ctx->rtcp);
 
   /* Initialize media path depending on service type */
   if (service->service_type == SERVICE_HTTP) {
@@ -202,8 +201,8 @@ int stream_context_init_for_worker(stream_context_t *ctx, connection_t *conn, se
     /* Set HTTP method from client request */
     http_proxy_set_method(&ctx->http_proxy, conn->http_req.method);
 
-    /* Set raw headers for full passthrough */
-    http_proxy_set_raw_headers(&ctx->http_proxy, conn->http_req.raw_headers, conn->http_req.raw_headers_len);
+    /* Pass client headers through (built from the parsed request head) */
+    http_proxy_set_client_request(&ctx->http_proxy, &conn->http_req);
 
     /* Set request body for passthrough */
     if (conn->http_req.body && conn->http_req.body_len > 0) {
@@ -288,6 +287,13 @@ int stream_context_init_for_worker(stream_context_t *ctx, connection_t *conn, se
         return -1;
       }
 
+      /* Live playback of the same upstream is served by one session per
+       * worker; seek, start and duration requests keep their own */
+      if (!is_snapshot && !service->seek_param_value && !ctx->rtsp.use_playseek_range && !ctx->rtsp.r2h_duration &&
+          ctx->rtsp.r2h_start[0] == '\0' && rtsp_share_attach(conn)) {
+        return 0;
+      }
+
       if (rtsp_connect(&ctx->rtsp) < 0) {
         logger(LOG_ERROR, "RTSP: Failed to initiate connection");
         return -1;
@@ -349,8 +355,9 @@ int stream_tick(stream_context_t *ctx, int64_t now) {
   if (http_proxy_session_tick(&ctx->http_proxy, now) < 0)
     return -1;
 
-  /* Check snapshot timeout (5 seconds) */
-  if (ctx->snapshot.initialized) {
+  /* Check snapshot timeout while waiting for the I-frame; conversion has its
+   * own timeout in the decoder pool */
+  if (ctx->snapshot.initialized && !ctx->snapshot.idr_frame_complete) {
     int64_t snapshot_elapsed = now - ctx->snapshot.start_time;
     if (snapshot_elapsed > SNAPSHOT_TIMEOUT_SEC * 1000) /* 5 seconds */
     {
@@ -373,6 +380,9 @@ int stream_tick(stream_context_t *ctx, int64_t now) {
 
     /* Update bytes and bandwidth in status */
     status_update_client_bytes(ctx->status_index, ctx->total_bytes_sent, current_bandwidth);
+    if (ctx->rtcp.active || ctx->rtcp.rtt_ms >= 0)
+      status_update_client_rtp(ctx->status_index, rtcp_receiver_jitter_us(&ctx->rtcp),
+                               rtcp_receiver_expected(&ctx->rtcp), rtcp_receiver_lost(&ctx->rtcp), ctx->rtcp.rtt_ms);
 
     /* Save current bytes for next calculation */
     ctx->last_bytes_sent = ctx->total_bytes_sent;
@@ -4,6 +4,7 @@
 #include "fcc.h"
 #include "http_proxy.h"
 #include "multicast.h"
+#include "rtcp.h"
 #include "rtp_fec.h"
 #include "rtp_reorder.h"
 #include "rtsp.h"
@@ -39,6 +40,7 @@ typedef struct stream_context_s {
 
   /* RTSP session for SERVICE_RTSP */
   rtsp_session_t rtsp;
+  struct rtsp_share_s *rtsp_share; /* Shared upstream session this stream leads or follows */
 
   /* HTTP proxy session for SERVICE_HTTP */
   http_proxy_session_t http_proxy;
@@ -49,6 +51,9 @@ typedef struct stream_context_s {
   /* FEC context for packet recovery */
   fec_context_t fec;
 
+  /* Upstream RTP reception statistics (jitter, loss, RTT) */
+  rtcp_receiver_t rtcp;
+
   /* Snapshot context */
   snapshot_context_t snapshot;
 } stream_context_t;
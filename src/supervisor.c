@@ -1,19 +1,24 @@
 #include "supervisor.h"
 #include "access_log.h"
 #include "configuration.h"
+#include "cpu_affinity.h"
 #include "epg.h"
+#include "fcc_socket_pool.h"
 #include "m3u.h"
 #include "pid_file.h"
 #include "platform_compat.h"
 #include "rtp2httpd.h"
 #include "service.h"
 #include "status.h"
+#include "thumbnail.h"
 #include "unix_socket.h"
 #include "utils.h"
 #include "worker.h"
 #include "zerocopy.h"
 #include <errno.h>
+#include <limits.h>
 #include <netdb.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,6 +46,8 @@ typedef struct {
 /* Supervisor state */
 static worker_info_t workers[STATUS_MAX_WORKERS];
 static int desired_workers = 0;
+static int running_worker_threads = 0;    /* Threads per process when worker-threads is on, else 0 */
+static cpu_affinity_set_t worker_cpu_set; /* worker-cpu-affinity, resolved before each worker starts */
 static volatile sig_atomic_t supervisor_stop_flag = 0;
 static volatile sig_atomic_t supervisor_reload_flag = 0;
 static volatile sig_atomic_t supervisor_restart_workers_flag = 0;
@@ -114,6 +121,18 @@ static void worker_restore_default_signal_handlers(void) {
   signal(SIGUSR1, SIG_DFL);
 }
 
+static int optional_string_equals(const char *a, const char *b) {
+  if (!a || !b)
+    return a == b;
+  return strcmp(a, b) == 0;
+}
+
+/**
+ * Number of worker processes to keep running: one process hosting every
+ * event loop in worker-threads mode, otherwise one process per worker.
+ */
+static int worker_process_count(void) { return config.worker_threads ? 1 : config.workers; }
+
 /**
  * Check if restart is allowed (rate limiting)
  * Returns 1 if restart is allowed, 0 if rate limited
@@ -166,6 +185,10 @@ static int spawn_worker(int worker_idx) {
     return -1;
   }
 
+  /* Resolved here, in the never-pinned supervisor: "auto" reads the affinity
+   * mask, which a pinned worker would see narrowed to its own CPU */
+  cpu_affinity_resolve(&worker_cpu_set);
+
   pid_t pid = fork();
   fork_errno = errno;
 
@@ -291,7 +314,8 @@ static void free_reload_snapshot(config_t *old_config, service_t *old_services,
 int supervisor_run(void) {
   int i;
 
-  desired_workers = config.workers;
+  desired_workers = worker_process_count();
+  running_worker_threads = config.worker_threads ? config.workers : 0;
 
   /* Initialize worker info */
   memset(workers, 0, sizeof(workers));
@@ -323,6 +347,11 @@ int supervisor_run(void) {
     return -1;
   }
 
+  /* Rings and the FCC port table must exist before the fork so every
+   * worker shares them */
+  access_log_init();
+  fcc_socket_pool_init_ports();
+
   /* Spawn all workers */
   for (i = 0; i < desired_workers && !supervisor_stop_flag; i++) {
     if (spawn_worker(i) < 0) {
@@ -349,6 +378,7 @@ int supervisor_run(void) {
 
       /* Reclaim shared status state before this worker index can be reused. */
       status_reap_worker(pid, worker_idx);
+      fcc_socket_pool_reap(pid);
       workers[worker_idx].pid = 0;
 
       /* Log exit reason */
@@ -430,6 +460,7 @@ int supervisor_run(void) {
 
       if (config_reload(&bind_changed) == 0) {
         int reload_failed = 0;
+        access_log_reopen();
         if (pid_file_prepare(config.pid_file) < 0) {
           logger(LOG_ERROR, "Failed to prepare PID file after configuration reload");
           restore_reload_snapshot(&old_config, &old_services, &old_bind_addresses, &old_m3u_cache, &old_epg_cache);
@@ -449,6 +480,11 @@ int supervisor_run(void) {
         if (!reload_failed)
           pid_file_commit();
 
+        /* Workers pin themselves and program their listeners at startup */
+        int placement_changed =
+            !reload_failed && (old_config.reuseport_cpu_steering != config.reuseport_cpu_steering ||
+                               !optional_string_equals(old_config.worker_cpu_affinity, config.worker_cpu_affinity));
+
         free_reload_snapshot(&old_config, old_services, old_bind_addresses, &old_m3u_cache, &old_epg_cache);
 
         if (reload_failed) {
@@ -456,16 +492,28 @@ int supervisor_run(void) {
           continue;
         }
 
+        /* Threads cannot be added to or removed from a running worker
+         * process, so switching worker-threads mode or changing the thread
+         * count restarts workers like a bind change does. */
+        const char *restart_reason = bind_changed ? "Bind addresses changed" : NULL;
+        int desired_threads = config.worker_threads ? config.workers : 0;
+        if (desired_threads != running_worker_threads) {
+          running_worker_threads = desired_threads;
+          restart_reason = "Worker threads changed";
+        }
+        if (placement_changed && !restart_reason)
+          restart_reason = "Worker CPU affinity changed";
+
         /* Handle worker count changes without dropping tracking records for
          * workers that have not reached waitpid() yet. */
         int previous_desired = desired_workers;
-        desired_workers = config.workers;
+        desired_workers = worker_process_count();
         if (desired_workers > previous_desired) {
           for (i = previous_desired; i < desired_workers; i++)
             workers[i].retiring = 0;
 
-          if (bind_changed) {
-            broadcast_signal_to_workers(SIGTERM, "Bind addresses changed");
+          if (restart_reason) {
+            broadcast_signal_to_workers(SIGTERM, restart_reason);
           } else {
             broadcast_signal_to_workers(SIGHUP, "Forwarding config reload");
           }
@@ -489,14 +537,14 @@ int supervisor_run(void) {
             }
           }
 
-          if (bind_changed) {
-            broadcast_signal_to_workers(SIGTERM, "Bind addresses changed");
+          if (restart_reason) {
+            broadcast_signal_to_workers(SIGTERM, restart_reason);
           } else {
             broadcast_signal_to_workers(SIGHUP, "Forwarding config reload");
           }
         } else {
-          if (bind_changed) {
-            broadcast_signal_to_workers(SIGTERM, "Bind addresses changed");
+          if (restart_reason) {
+            broadcast_signal_to_workers(SIGTERM, restart_reason);
           } else {
             broadcast_signal_to_workers(SIGHUP, "Forwarding config reload");
           }
@@ -515,6 +563,7 @@ int supervisor_run(void) {
     }
 
     status_supervisor_drain_logs();
+    access_log_flush(0);
 
     /* Sleep before next check */
     usleep(100000); /* 100ms */
@@ -571,38 +620,32 @@ int supervisor_run(void) {
 
   /* Clean up shared memory and other resources
    * Supervisor is now the last process, so it does final cleanup */
+  access_log_cleanup();
+  fcc_socket_pool_cleanup_ports();
   status_cleanup();
+  thumbnail_remove_files(getpid());
 
   pid_file_cleanup();
 
   return 0;
 }
 
-int run_worker(void) {
+/**
+ * Open this event loop's listening sockets: per-loop TCP listeners
+ * (SO_REUSEPORT allows multiple binds) plus the supervisor-owned Unix
+ * listeners.  When dup_unix is set the Unix listeners are duplicated so each
+ * worker thread owns (and later closes) its own descriptors.
+ * @return number of sockets in s, or -1 on fatal error
+ */
+static int open_worker_listeners(int *s, int dup_unix) {
   struct addrinfo hints, *res, *ai;
   bindaddr_t *bind_addr;
   int r;
-  int s[MAX_S];
   int maxs, nfds;
   int max_tcp_sockets;
   char hbuf[NI_MAXHOST], sbuf[NI_MAXSERV];
   const int on = 1;
-  int notif_fd = -1;
-
-  /* Get notification pipe read fd for this worker (after fork)
-   * This also closes read fds for other workers to avoid fd leaks */
-  if (status_shared) {
-    notif_fd = status_worker_get_notif_fd();
-    if (notif_fd < 0) {
-      logger(LOG_ERROR, "Failed to get worker notification pipe");
-    }
-    if (worker_id >= 0 && worker_id < STATUS_MAX_WORKERS)
-      status_shared->worker_stats[worker_id].worker_pid = getpid();
-  }
-
-  logger(LOG_INFO, "Worker %d started (pid=%d)", worker_id, (int)getpid());
 
-  /* Per-worker listener setup (SO_REUSEPORT allows multiple binds) */
   memset(&hints, 0, sizeof(hints));
   hints.ai_socktype = SOCK_STREAM;
   hints.ai_flags = AI_PASSIVE;
@@ -623,7 +666,7 @@ int run_worker(void) {
     r = getaddrinfo(bind_addr->node, bind_addr->service, &hints, &res);
     if (r) {
       logger(LOG_FATAL, "GAI: %s", gai_strerror(r));
-      return EXIT_FAILURE;
+      return -1;
     }
 
     for (ai = res; ai && maxs < max_tcp_sockets; ai = ai->ai_next) {
@@ -659,12 +702,15 @@ int run_worker(void) {
         close(s[maxs]);
         continue;
       }
+      /* Prefer this loop's listener for SYNs handled on its pinned CPU */
+      cpu_affinity_set_incoming_cpu(s[maxs]);
       r = listen(s[maxs], 128);
       if (r) {
         logger(LOG_ERROR, "Cannot listen: %s", strerror(errno));
         close(s[maxs]);
         continue;
       }
+      cpu_affinity_attach_reuseport_steering(s[maxs], &worker_cpu_set);
       r = getnameinfo(ai->ai_addr, ai->ai_addrlen, hbuf, sizeof(hbuf), sbuf, sizeof(sbuf),
                       NI_NUMERICHOST | NI_NUMERICSERV);
       if (r) {
@@ -680,13 +726,78 @@ int run_worker(void) {
     freeaddrinfo(res);
   }
 
+  int tcp_count = maxs;
   if (unix_socket_listeners_append(s, MAX_S, &maxs, &nfds) < 0) {
     logger(LOG_FATAL, "Too many listening sockets (max %d)", MAX_S);
-    return EXIT_FAILURE;
+    for (int i = 0; i < tcp_count; i++)
+      close(s[i]);
+    return -1;
+  }
+
+  if (dup_unix) {
+    for (int i = tcp_count; i < maxs; i++) {
+      s[i] = dup(s[i]);
+      if (s[i] < 0) {
+        logger(LOG_FATAL, "Cannot duplicate Unix listener: %s", strerror(errno));
+        for (int j = 0; j < i; j++)
+          close(s[j]);
+        return -1;
+      }
+    }
   }
 
   if (maxs == 0) {
     logger(LOG_FATAL, "No socket to listen!");
+    return -1;
+  }
+
+  return maxs;
+}
+
+/* Worker threads open their listeners in worker order so that the kernel's
+ * reuseport group index of each listener matches its worker id, which is
+ * what the reuseport CPU steering program returns. */
+static pthread_mutex_t listener_turn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t listener_turn_cond = PTHREAD_COND_INITIALIZER;
+static int listener_turn = 0;
+
+static void listener_turn_wait(int index) {
+  pthread_mutex_lock(&listener_turn_lock);
+  while (listener_turn < index)
+    pthread_cond_wait(&listener_turn_cond, &listener_turn_lock);
+  pthread_mutex_unlock(&listener_turn_lock);
+}
+
+static void listener_turn_advance(int next) {
+  pthread_mutex_lock(&listener_turn_lock);
+  if (listener_turn < next)
+    listener_turn = next;
+  pthread_cond_broadcast(&listener_turn_cond);
+  pthread_mutex_unlock(&listener_turn_lock);
+}
+
+/**
+ * Set up listeners and buffer pools for one event loop and run it
+ * @param notif_fd Notification pipe read fd for this loop (-1 if none)
+ * @param threaded 1 when running as one of several worker threads
+ */
+static int run_worker_event_loop(int notif_fd, int threaded) {
+  int s[MAX_S];
+  int maxs;
+
+  if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS)
+    status_shared->worker_stats[worker_id].worker_pid = getpid();
+
+  cpu_affinity_pin_worker(&worker_cpu_set, worker_id);
+
+  if (threaded)
+    listener_turn_wait(worker_id);
+  maxs = open_worker_listeners(s, threaded);
+  if (threaded)
+    listener_turn_advance(worker_id + 1);
+  if (maxs < 0) {
+    if (notif_fd >= 0)
+      close(notif_fd);
     return EXIT_FAILURE;
   }
 
@@ -694,6 +805,10 @@ int run_worker(void) {
   if (zerocopy_init() != 0) {
     logger(LOG_FATAL, "Failed to initialize zero-copy infrastructure");
     logger(LOG_FATAL, "MSG_ZEROCOPY support is required (kernel 4.14+)");
+    for (int i = 0; i < maxs; i++)
+      close(s[i]);
+    if (notif_fd >= 0)
+      close(notif_fd);
     return EXIT_FAILURE;
   }
 
@@ -702,8 +817,107 @@ int run_worker(void) {
   /* Run worker event loop */
   int result = worker_run_event_loop(s, maxs, notif_fd);
 
-  access_log_cleanup();
   zerocopy_cleanup();
+  return result;
+}
+
+typedef struct {
+  pthread_t thread;
+  int worker_index;
+  int result;
+} worker_thread_t;
+
+static void *worker_thread_main(void *arg) {
+  worker_thread_t *wt = arg;
+
+  worker_id = wt->worker_index;
+  int notif_fd = status_shared ? status_shared->worker_notification_pipe_read_fds[worker_id] : -1;
+
+  logger(LOG_INFO, "Worker thread %d started (pid=%d)", worker_id, (int)getpid());
+  wt->result = run_worker_event_loop(notif_fd, 1);
+
+  /* One loop failing takes the whole process down so the supervisor restarts it */
+  if (wt->result != 0)
+    worker_request_stop();
+  return NULL;
+}
+
+/**
+ * worker-threads mode: run config.workers event loops as threads of this
+ * process.  Worker 0 runs on the calling thread and is the leader that
+ * applies config reloads and M3U/EPG refreshes.
+ */
+static int run_worker_threads(void) {
+  worker_thread_t threads[STATUS_MAX_WORKERS];
+  int count = config.workers;
+  int started = 0;
+  int result = 0;
+
+  if (count > STATUS_MAX_WORKERS)
+    count = STATUS_MAX_WORKERS;
+
+  status_worker_keep_notif_fds(count);
+
+  if (worker_threads_init(count) < 0) {
+    logger(LOG_FATAL, "Failed to initialize worker threads");
+    return EXIT_FAILURE;
+  }
+  buffer_pool_depot_enable();
+
+  logger(LOG_INFO, "Worker process started with %d event-loop threads (pid=%d)", count, (int)getpid());
+
+  for (int i = 1; i < count; i++) {
+    threads[i].worker_index = i;
+    threads[i].result = 0;
+    int r = pthread_create(&threads[i].thread, NULL, worker_thread_main, &threads[i]);
+    if (r != 0) {
+      logger(LOG_ERROR, "Failed to start worker thread %d: %s", i, strerror(r));
+      worker_request_stop();
+      listener_turn_advance(INT_MAX);
+      result = EXIT_FAILURE;
+      break;
+    }
+    started = i;
+  }
+
+  if (result == 0) {
+    int notif_fd = status_shared ? status_shared->worker_notification_pipe_read_fds[0] : -1;
+    result = run_worker_event_loop(notif_fd, 1);
+    worker_request_stop();
+  }
+
+  for (int i = 1; i <= started; i++) {
+    pthread_join(threads[i].thread, NULL);
+    if (threads[i].result != 0)
+      result = threads[i].result;
+  }
+
+  worker_threads_cleanup();
+  buffer_pool_depot_cleanup();
+  return result;
+}
+
+int run_worker(void) {
+  int notif_fd = -1;
+  int result;
+
+  if (config.worker_threads) {
+    result = run_worker_threads();
+  } else {
+    /* Get notification pipe read fd for this worker (after fork)
+     * This also closes read fds for other workers to avoid fd leaks */
+    if (status_shared) {
+      notif_fd = status_worker_get_notif_fd();
+      if (notif_fd < 0) {
+        logger(LOG_ERROR, "Failed to get worker notification pipe");
+      }
+    }
+
+    logger(LOG_INFO, "Worker %d started (pid=%d)", worker_id, (int)getpid());
+    result = run_worker_event_loop(notif_fd, 0);
+  }
+
+  access_log_cleanup();
   status_cleanup();
   config_cleanup(true);
 
@@ -0,0 +1,633 @@
+#include "thumbnail.h"
+#include "configuration.h"
+#include "connection.h"
+#include "http.h"
+#include "poller.h"
+#include "rtp2httpd.h"
+#include "service.h"
+#include "snapshot_decoder.h"
+#include "utils.h"
+#include "worker.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define THUMBNAIL_DIR_FORMAT "/tmp/rtp2httpd_thumbnails_%d"
+#define THUMBNAIL_MOSAIC_FILE "thumbnails.jpg"
+#define THUMBNAIL_INDEX_FILE "thumbnails.json"
+#define THUMBNAIL_MOSAIC_TMP_FILE "thumbnails.jpg.XXXXXX"
+#define THUMBNAIL_INDEX_TMP_FILE "thumbnails.json.XXXXXX"
+
+/* Response headers sent in front of a channel's JPEG */
+#define THUMBNAIL_RESPONSE_MAX (THUMBNAIL_MAX_JPEG_SIZE + 4096)
+
+typedef struct {
+  char *name;        /* Service path (hashmap key) */
+  uint8_t *jpeg;     /* Latest thumbnail, NULL until captured */
+  size_t jpeg_size;  /* Thumbnail size in bytes */
+  time_t updated;    /* When the thumbnail was captured */
+} thumbnail_channel_t;
+
+typedef struct {
+  int fd;          /* Our end of the socketpair, -1 when the slot is unused */
+  char *name;      /* Channel being captured */
+  uint8_t *buf;    /* HTTP response received so far */
+  size_t len;
+  size_t cap;
+  int64_t started; /* When the capture was started */
+} thumbnail_capture_t;
+
+typedef struct {
+  int initialized;
+  int epfd;
+  thumbnail_channel_t *channels; /* Channels of the running cycle, playlist order */
+  size_t channel_count;
+  size_t next_channel;        /* Next channel of the cycle to capture */
+  int64_t cycle_started;      /* When the running cycle began */
+  int64_t next_start_time;    /* Earliest start of the next capture */
+  int64_t start_spacing_ms;   /* Spreads a cycle's captures over the interval */
+  thumbnail_capture_t captures[THUMBNAIL_CONCURRENCY_MAX];
+  int dirty;                  /* Thumbnails changed since the last mosaic */
+  int64_t last_compose;       /* When the last mosaic build started */
+  pid_t compose_pid;          /* Running ffmpeg mosaic build, 0 if none */
+  char compose_output[320];   /* Temporary file the running build writes */
+  char *pending_index;        /* Index published once the running build succeeds */
+  size_t pending_index_len;
+} thumbnail_state_t;
+
+/* Only worker 0 runs captures; the state is per event loop for symmetry with
+ * the snapshot decoder pool */
+static _Thread_local thumbnail_state_t state;
+
+static int thumbnail_path(char *buf, size_t size, pid_t supervisor_pid, const char *file) {
+  int n;
+  if (file)
+    n = snprintf(buf, size, THUMBNAIL_DIR_FORMAT "/%s", (int)supervisor_pid, file);
+  else
+    n = snprintf(buf, size, THUMBNAIL_DIR_FORMAT, (int)supervisor_pid);
+  return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+/* The directory sits in world-writable /tmp: create it private, and refuse
+ * one (or a symlink in its place) that somebody else created first */
+static int thumbnail_prepare_dir(const char *dir) {
+  struct stat st;
+
+  if (mkdir(dir, 0700) < 0 && errno != EEXIST) {
+    logger(LOG_ERROR, "Thumbnail: Failed to create %s: %s", dir, strerror(errno));
+    return -1;
+  }
+  if (lstat(dir, &st) < 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid()) {
+    logger(LOG_ERROR, "Thumbnail: %s is not a directory owned by rtp2httpd, not writing thumbnails", dir);
+    return -1;
+  }
+  if ((st.st_mode & 077) != 0 && chmod(dir, 0700) < 0) {
+    logger(LOG_ERROR, "Thumbnail: Failed to restrict %s: %s", dir, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/* Create a unique file from a template in the thumbnail directory */
+static int thumbnail_create_tmp(char *path, size_t size, pid_t supervisor_pid, const char *template) {
+  if (thumbnail_path(path, size, supervisor_pid, template) < 0)
+    return -1;
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    logger(LOG_ERROR, "Thumbnail: Failed to create %s: %s", path, strerror(errno));
+    path[0] = '\0';
+  }
+  return fd;
+}
+
+static int refresher_enabled(void) {
+  return state.initialized && worker_id == 0 && config.video_snapshot && config.thumbnail_interval > 0;
+}
+
+static void free_channels(void) {
+  for (size_t i = 0; i < state.channel_count; i++) {
+    free(state.channels[i].name);
+    free(state.channels[i].jpeg);
+  }
+  free(state.channels);
+  state.channels = NULL;
+  state.channel_count = 0;
+  state.next_channel = 0;
+}
+
+static thumbnail_channel_t *find_channel(const char *name) {
+  for (size_t i = 0; i < state.channel_count; i++) {
+    if (strcmp(state.channels[i].name, name) == 0)
+      return &state.channels[i];
+  }
+  return NULL;
+}
+
+/* Take the channel list from the current services, keeping known thumbnails */
+static void rebuild_channels(void) {
+  size_t count = 0;
+  thumbnail_channel_t *channels;
+
+  for (service_t *s = services; s; s = s->next) {
+    if (s->url && s->service_type != SERVICE_HTTP)
+      count++;
+  }
+
+  channels = count ? calloc(count, sizeof(*channels)) : NULL;
+  if (count && !channels) {
+    logger(LOG_ERROR, "Thumbnail: Failed to allocate channel list");
+    return;
+  }
+
+  size_t n = 0;
+  for (service_t *s = services; s && n < count; s = s->next) {
+    if (!s->url || s->service_type == SERVICE_HTTP)
+      continue;
+    channels[n].name = strdup(s->url);
+    if (!channels[n].name)
+      continue;
+    thumbnail_channel_t *old = find_channel(s->url);
+    if (old) {
+      channels[n].jpeg = old->jpeg;
+      channels[n].jpeg_size = old->jpeg_size;
+      channels[n].updated = old->updated;
+      old->jpeg = NULL;
+    }
+    n++;
+  }
+
+  if (n != state.channel_count)
+    state.dirty = 1;
+  free_channels();
+  state.channels = channels;
+  state.channel_count = n;
+}
+
+static void finish_capture(thumbnail_capture_t *cap, int complete) {
+  if (cap->fd >= 0) {
+    fdmap_del(cap->fd);
+    poller_del(state.epfd, cap->fd);
+    close(cap->fd);
+    cap->fd = -1;
+  }
+
+  if (complete) {
+    /* Expect "HTTP/1.x 200 ..." followed by a JPEG body */
+    const uint8_t *end =
+        cap->len >= 12 && memcmp(cap->buf, "HTTP/1.", 7) == 0 && memcmp(cap->buf + 8, " 200", 4) == 0
+            ? memmem(cap->buf, cap->len, "\r\n\r\n", 4)
+            : NULL;
+    size_t offset = end ? (size_t)(end - cap->buf) + 4 : cap->len;
+    size_t body_len = cap->len - offset;
+    thumbnail_channel_t *ch = find_channel(cap->name);
+
+    if (body_len >= 2 && cap->buf[offset] == 0xFF && cap->buf[offset + 1] == 0xD8 && ch) {
+      memmove(cap->buf, cap->buf + offset, body_len);
+      free(ch->jpeg);
+      ch->jpeg = cap->buf;
+      ch->jpeg_size = body_len;
+      ch->updated = time(NULL);
+      cap->buf = NULL;
+      state.dirty = 1;
+      logger(LOG_DEBUG, "Thumbnail: Captured %s (%zu bytes)", cap->name, body_len);
+    } else {
+      logger(LOG_DEBUG, "Thumbnail: No snapshot for %s", cap->name);
+    }
+  }
+
+  free(cap->buf);
+  cap->buf = NULL;
+  cap->len = 0;
+  cap->cap = 0;
+  free(cap->name);
+  cap->name = NULL;
+}
+
+static void handle_capture_fd(int fd, uint32_t events, int64_t now, void *opaque);
+
+static int start_capture(thumbnail_capture_t *cap, const thumbnail_channel_t *ch, int64_t now) {
+  service_t *configured = service_hashmap_get(ch->name);
+  char cache_key[HTTP_URL_BUFFER_SIZE + 2];
+  int sv[2];
+
+  if (!configured)
+    return -1;
+  snprintf(cache_key, sizeof(cache_key), "/%s", ch->name);
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+    logger(LOG_ERROR, "Thumbnail: socketpair failed: %s", strerror(errno));
+    return -1;
+  }
+  connection_set_nonblocking(sv[0]);
+  connection_set_nonblocking(sv[1]);
+  if (poller_add(state.epfd, sv[1], POLLER_IN | POLLER_RDHUP | POLLER_HUP | POLLER_ERR) < 0) {
+    close(sv[0]);
+    close(sv[1]);
+    return -1;
+  }
+
+  cap->fd = sv[1];
+  fdmap_set_handler(cap->fd, handle_capture_fd, cap);
+  cap->name = strdup(ch->name);
+  cap->started = now;
+  cap->len = 0;
+  if (!cap->name) {
+    close(sv[0]);
+    finish_capture(cap, 0);
+    return -1;
+  }
+
+  /* The other end becomes an internal client asking for the channel's
+   * snapshot, so the capture shares the snapshot cache and decoder pool */
+  connection_t *c = worker_add_connection(state.epfd, sv[0], NULL, 0);
+  service_t *service = c ? service_clone(configured) : NULL;
+  if (!service) {
+    finish_capture(cap, 0); /* The connection sees the hangup and closes */
+    return -1;
+  }
+  c->state = CONN_ROUTE;
+  connection_start_snapshot(c, service, cache_key, 1);
+  return 0;
+}
+
+static void read_capture(thumbnail_capture_t *cap) {
+  for (;;) {
+    if (cap->len == cap->cap) {
+      size_t new_cap = cap->cap ? cap->cap * 2 : 64 * 1024;
+      if (new_cap > THUMBNAIL_RESPONSE_MAX)
+        new_cap = THUMBNAIL_RESPONSE_MAX;
+      if (new_cap <= cap->len) {
+        logger(LOG_WARN, "Thumbnail: Snapshot of %s too large", cap->name);
+        finish_capture(cap, 0);
+        return;
+      }
+      uint8_t *buf = realloc(cap->buf, new_cap);
+      if (!buf) {
+        finish_capture(cap, 0);
+        return;
+      }
+      cap->buf = buf;
+      cap->cap = new_cap;
+    }
+
+    ssize_t r = read(cap->fd, cap->buf + cap->len, cap->cap - cap->len);
+    if (r > 0) {
+      cap->len += (size_t)r;
+    } else if (r == 0) {
+      finish_capture(cap, 1);
+      return;
+    } else {
+      if (errno != EAGAIN && errno != EINTR)
+        finish_capture(cap, 0);
+      return;
+    }
+  }
+}
+
+/* Poller events on a capture's end of the socketpair */
+static void handle_capture_fd(int fd, uint32_t events, int64_t now, void *opaque) {
+  thumbnail_capture_t *cap = opaque;
+  (void)events;
+  (void)now;
+
+  if (cap->fd == fd)
+    read_capture(cap);
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+  const uint8_t *p = data;
+  while (len > 0) {
+    ssize_t w = write(fd, p, len);
+    if (w < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    p += w;
+    len -= (size_t)w;
+  }
+  return 0;
+}
+
+/* Index of the mosaic about to be built: tile offsets per channel, -1 for
+ * channels without a thumbnail yet */
+static char *build_index(int columns, int rows, size_t *out_len) {
+  size_t size = 256;
+  for (size_t i = 0; i < state.channel_count; i++)
+    size += json_escaped_len(state.channels[i].name) + 96;
+
+  char *json = malloc(size);
+  if (!json)
+    return NULL;
+
+  size_t len = (size_t)snprintf(json, size,
+                                "{\"updated\":%lld,\"tileWidth\":%d,\"tileHeight\":%d,\"columns\":%d,\"rows\":%d,"
+                                "\"channels\":[",
+                                (long long)time(NULL), THUMBNAIL_TILE_WIDTH, THUMBNAIL_TILE_HEIGHT, columns, rows);
+  int tile = 0;
+  for (size_t i = 0; i < state.channel_count; i++) {
+    const thumbnail_channel_t *ch = &state.channels[i];
+    char *name = json_escape_string(ch->name);
+    int x = -1;
+    int y = -1;
+    if (ch->jpeg) {
+      x = (tile % columns) * THUMBNAIL_TILE_WIDTH;
+      y = (tile / columns) * THUMBNAIL_TILE_HEIGHT;
+      tile++;
+    }
+    len += (size_t)snprintf(json + len, size - len, "%s{\"name\":\"%s\",\"x\":%d,\"y\":%d,\"updated\":%lld}",
+                            i ? "," : "", name ? name : "", x, y, (long long)(ch->jpeg ? ch->updated : 0));
+    free(name);
+  }
+  len += (size_t)snprintf(json + len, size - len, "]}");
+  *out_len = len;
+  return json;
+}
+
+/* Tile every captured thumbnail into one JPEG with ffmpeg in the background */
+static void compose_mosaic(int64_t now) {
+  pid_t supervisor_pid = getppid();
+  char dir[256];
+  char input_path[] = "/tmp/rtp2httpd_mosaic_XXXXXX";
+  char command[2048];
+  int tiles = 0;
+
+  for (size_t i = 0; i < state.channel_count; i++) {
+    if (state.channels[i].jpeg)
+      tiles++;
+  }
+  state.dirty = 0;
+  state.last_compose = now;
+  if (tiles == 0)
+    return;
+
+  if (thumbnail_path(dir, sizeof(dir), supervisor_pid, NULL) < 0 || thumbnail_prepare_dir(dir) < 0)
+    return;
+
+  /* Thumbnails go to ffmpeg's stdin as one concatenated MJPEG stream in tile
+   * order, from an unlinked file */
+  int input_fd = mkstemp(input_path);
+  if (input_fd < 0) {
+    logger(LOG_ERROR, "Thumbnail: Failed to create mosaic input: %s", strerror(errno));
+    return;
+  }
+  unlink(input_path);
+  for (size_t i = 0; i < state.channel_count; i++) {
+    const thumbnail_channel_t *ch = &state.channels[i];
+    if (ch->jpeg && write_all(input_fd, ch->jpeg, ch->jpeg_size) < 0) {
+      logger(LOG_ERROR, "Thumbnail: Failed to write mosaic input: %s", strerror(errno));
+      close(input_fd);
+      return;
+    }
+  }
+  lseek(input_fd, 0, SEEK_SET);
+
+  /* ffmpeg writes the mosaic to stdout, a new file renamed into place once
+   * the build succeeded */
+  int output_fd =
+      thumbnail_create_tmp(state.compose_output, sizeof(state.compose_output), supervisor_pid, THUMBNAIL_MOSAIC_TMP_FILE);
+  if (output_fd < 0) {
+    close(input_fd);
+    return;
+  }
+
+  int columns = tiles < THUMBNAIL_MOSAIC_COLUMNS ? tiles : THUMBNAIL_MOSAIC_COLUMNS;
+  int rows = (tiles + columns - 1) / columns;
+
+  free(state.pending_index);
+  state.pending_index = build_index(columns, rows, &state.pending_index_len);
+  if (!state.pending_index) {
+    close(input_fd);
+    close(output_fd);
+    unlink(state.compose_output);
+    state.compose_output[0] = '\0';
+    return;
+  }
+
+  /* Thumbnails differ in resolution: keep one filter graph (-reinit_filter 0)
+   * and let scale/pad normalise each frame to the tile size */
+  snprintf(command, sizeof(command),
+           "exec %s -nostdin -loglevel error -reinit_filter 0 -f image2pipe -c:v mjpeg -i pipe:0 "
+           "-vf 'scale=%d:%d:force_original_aspect_ratio=decrease,pad=%d:%d:(ow-iw)/2:(oh-ih)/2,tile=%dx%d' "
+           "-frames:v 1 -q:v 5 -c:v mjpeg -f image2pipe pipe:1",
+           config.ffmpeg_path ? config.ffmpeg_path : "ffmpeg", THUMBNAIL_TILE_WIDTH, THUMBNAIL_TILE_HEIGHT,
+           THUMBNAIL_TILE_WIDTH, THUMBNAIL_TILE_HEIGHT, columns, rows);
+
+  pid_t pid = snapshot_spawn_command(command, input_fd, output_fd);
+  close(input_fd);
+  close(output_fd);
+  if (pid < 0) {
+    logger(LOG_ERROR, "Thumbnail: Failed to start mosaic build: %s", strerror(errno));
+    unlink(state.compose_output);
+    state.compose_output[0] = '\0';
+    return;
+  }
+  state.compose_pid = pid;
+  logger(LOG_DEBUG, "Thumbnail: Building mosaic of %d thumbnails (%dx%d tiles)", tiles, columns, rows);
+}
+
+/* Publish the mosaic and its index once the build exited */
+static void reap_compose(int64_t now) {
+  pid_t supervisor_pid = getppid();
+  char mosaic_path[320];
+  char index_tmp_path[320];
+  char index_path[320];
+  struct stat st;
+  int status = 0;
+
+  if (state.compose_pid <= 0)
+    return;
+
+  pid_t r = waitpid(state.compose_pid, &status, WNOHANG);
+  if (r == 0) {
+    if (now - state.last_compose < THUMBNAIL_COMPOSE_INTERVAL_MS)
+      return;
+    logger(LOG_WARN, "Thumbnail: Mosaic build timed out");
+    kill(state.compose_pid, SIGKILL);
+    r = waitpid(state.compose_pid, &status, 0);
+    status = -1;
+  }
+  state.compose_pid = 0;
+
+  thumbnail_path(mosaic_path, sizeof(mosaic_path), supervisor_pid, THUMBNAIL_MOSAIC_FILE);
+  thumbnail_path(index_path, sizeof(index_path), supervisor_pid, THUMBNAIL_INDEX_FILE);
+
+  if (r < 0 || status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+      stat(state.compose_output, &st) < 0 || st.st_size == 0) {
+    logger(LOG_WARN, "Thumbnail: Mosaic build failed");
+    unlink(state.compose_output);
+    state.dirty = 1; /* Retry on the next compose interval */
+  } else if (rename(state.compose_output, mosaic_path) < 0) {
+    logger(LOG_ERROR, "Thumbnail: Failed to publish mosaic: %s", strerror(errno));
+    unlink(state.compose_output);
+  } else if (state.pending_index) {
+    int fd = thumbnail_create_tmp(index_tmp_path, sizeof(index_tmp_path), supervisor_pid, THUMBNAIL_INDEX_TMP_FILE);
+    if (fd < 0 || write_all(fd, state.pending_index, state.pending_index_len) < 0 ||
+        rename(index_tmp_path, index_path) < 0) {
+      logger(LOG_ERROR, "Thumbnail: Failed to publish index: %s", strerror(errno));
+      if (fd >= 0)
+        unlink(index_tmp_path);
+    } else {
+      logger(LOG_INFO, "Thumbnail: Mosaic updated");
+    }
+    if (fd >= 0)
+      close(fd);
+  }
+  state.compose_output[0] = '\0';
+
+  free(state.pending_index);
+  state.pending_index = NULL;
+  state.pending_index_len = 0;
+}
+
+static void stop_captures(void) {
+  for (int i = 0; i < THUMBNAIL_CONCURRENCY_MAX; i++) {
+    if (state.captures[i].fd >= 0)
+      finish_capture(&state.captures[i], 0);
+  }
+}
+
+void thumbnail_init(int epfd) {
+  memset(&state, 0, sizeof(state));
+  state.epfd = epfd;
+  for (int i = 0; i < THUMBNAIL_CONCURRENCY_MAX; i++)
+    state.captures[i].fd = -1;
+  state.initialized = 1;
+}
+
+void thumbnail_cleanup(void) {
+  if (!state.initialized)
+    return;
+
+  stop_captures();
+  if (state.compose_pid > 0) {
+    kill(state.compose_pid, SIGKILL);
+    state.last_compose = 0;
+    reap_compose(THUMBNAIL_COMPOSE_INTERVAL_MS);
+  }
+  free(state.pending_index);
+  state.pending_index = NULL;
+  free_channels();
+  state.initialized = 0;
+}
+
+void thumbnail_tick(int64_t now) {
+  int running = 0;
+
+  if (!state.initialized)
+    return;
+
+  reap_compose(now);
+
+  if (!refresher_enabled()) {
+    stop_captures();
+    if (state.channel_count)
+      free_channels();
+    state.cycle_started = 0;
+    return;
+  }
+
+  for (int i = 0; i < THUMBNAIL_CONCURRENCY_MAX; i++) {
+    thumbnail_capture_t *cap = &state.captures[i];
+    if (cap->fd < 0)
+      continue;
+    if (now - cap->started > THUMBNAIL_CAPTURE_TIMEOUT_MS) {
+      logger(LOG_WARN, "Thumbnail: Capture of %s timed out", cap->name);
+      finish_capture(cap, 0);
+      continue;
+    }
+    running++;
+  }
+
+  /* A new cycle picks up playlist changes; an empty playlist is rechecked
+   * every tick so the first cycle starts as soon as services are loaded */
+  int64_t interval_ms = config.thumbnail_interval * 1000LL;
+  if (state.channel_count == 0 ||
+      (state.next_channel >= state.channel_count && now - state.cycle_started >= interval_ms)) {
+    rebuild_channels();
+    state.next_channel = 0;
+    state.cycle_started = now;
+    state.next_start_time = now;
+    state.start_spacing_ms = state.channel_count ? interval_ms / (int64_t)state.channel_count : 0;
+  }
+
+  int concurrency =
+      config.thumbnail_concurrency < THUMBNAIL_CONCURRENCY_MAX ? config.thumbnail_concurrency : THUMBNAIL_CONCURRENCY_MAX;
+  for (int i = 0; i < THUMBNAIL_CONCURRENCY_MAX && running < concurrency; i++) {
+    if (state.next_channel >= state.channel_count || now < state.next_start_time)
+      break;
+    if (state.captures[i].fd >= 0)
+      continue;
+    thumbnail_channel_t *ch = &state.channels[state.next_channel++];
+    state.next_start_time += state.start_spacing_ms;
+    if (start_capture(&state.captures[i], ch, now) == 0)
+      running++;
+  }
+
+  if (state.dirty && state.compose_pid == 0) {
+    int cycle_done = state.next_channel >= state.channel_count && running == 0;
+    if (cycle_done || now - state.last_compose >= THUMBNAIL_COMPOSE_INTERVAL_MS)
+      compose_mosaic(now);
+  }
+}
+
+void thumbnail_handle_request(connection_t *c, int want_index) {
+  const char *content_type = want_index ? "application/json" : "image/jpeg";
+  char path[320];
+  char etag[64];
+  struct stat st;
+
+  if (thumbnail_path(path, sizeof(path), getppid(), want_index ? THUMBNAIL_INDEX_FILE : THUMBNAIL_MOSAIC_FILE) < 0) {
+    http_send_404(c);
+    return;
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd < 0) {
+    http_send_404(c);
+    return;
+  }
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    http_send_404(c);
+    return;
+  }
+
+  /* Files are replaced by rename(), so mtime + size identify a version */
+  snprintf(etag, sizeof(etag), "%llx-%llx", (unsigned long long)st.st_mtime, (unsigned long long)st.st_size);
+  http_send_file(c, fd, (size_t)st.st_size, content_type, etag, NULL);
+}
+
+void thumbnail_remove_files(pid_t supervisor_pid) {
+  char dir[256];
+  char path[320];
+  struct stat st;
+
+  /* Only a directory this process owns is emptied; it holds the published
+   * files and any temporary file a killed build left behind */
+  if (thumbnail_path(dir, sizeof(dir), supervisor_pid, NULL) < 0 || lstat(dir, &st) < 0 || !S_ISDIR(st.st_mode) ||
+      st.st_uid != geteuid())
+    return;
+
+  DIR *d = opendir(dir);
+  if (d) {
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+      if (strncmp(entry->d_name, "thumbnails.", strlen("thumbnails.")) != 0)
+        continue;
+      if (thumbnail_path(path, sizeof(path), supervisor_pid, entry->d_name) == 0)
+        unlink(path);
+    }
+    closedir(d);
+  }
+  rmdir(dir);
+}
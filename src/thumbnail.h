@@ -0,0 +1,65 @@
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Forward declarations */
+typedef struct connection_s connection_t;
+
+/* Upper bounds for the thumbnail-interval / thumbnail-concurrency options */
+#define THUMBNAIL_INTERVAL_MAX 86400
+#define THUMBNAIL_CONCURRENCY_MAX 16
+
+/* Mosaic layout: tiles of this size, this many per row */
+#define THUMBNAIL_TILE_WIDTH 320
+#define THUMBNAIL_TILE_HEIGHT 180
+#define THUMBNAIL_MOSAIC_COLUMNS 10
+
+/* A capture that has not produced a JPEG by then is abandoned (milliseconds) */
+#define THUMBNAIL_CAPTURE_TIMEOUT_MS 15000
+
+/* Rebuild the mosaic at most this often while a cycle is running (milliseconds) */
+#define THUMBNAIL_COMPOSE_INTERVAL_MS 30000
+
+/* Largest JPEG accepted for a single channel */
+#define THUMBNAIL_MAX_JPEG_SIZE (2 * 1024 * 1024)
+
+/**
+ * Background thumbnail refresher
+ *
+ * When thumbnail-interval is set, worker 0 walks the configured services and
+ * captures one snapshot per channel through the regular snapshot path (so it
+ * shares the snapshot cache and decoder pool with client requests), at most
+ * thumbnail-concurrency at a time and spread evenly over the interval.  The
+ * thumbnails are tiled into a single JPEG mosaic by ffmpeg, next to a JSON
+ * index giving each channel's tile offset.  Both files live in a directory
+ * owned by the supervisor, so every worker can serve them.
+ */
+
+/**
+ * Initialize the refresher for this event loop (only worker 0 captures)
+ * @param epfd Poller of the calling event loop
+ */
+void thumbnail_init(int epfd);
+
+/** Abort running captures and the mosaic build of this event loop */
+void thumbnail_cleanup(void);
+
+/** Start due captures, enforce timeouts and rebuild the mosaic */
+void thumbnail_tick(int64_t now);
+
+/**
+ * Serve /thumbnails.jpg (mosaic) or /thumbnails.json (index)
+ * @param c Connection
+ * @param want_index 1 for the JSON index, 0 for the mosaic
+ */
+void thumbnail_handle_request(connection_t *c, int want_index);
+
+/**
+ * Remove the mosaic directory of a supervisor on shutdown
+ * @param supervisor_pid Supervisor the directory belongs to
+ */
+void thumbnail_remove_files(pid_t supervisor_pid);
+
+#endif /* THUMBNAIL_H */
@@ -36,6 +36,19 @@ int64_t get_time_ms(void) {
   return (int64_t)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
 }
 
+/**
+ * Get current monotonic time in microseconds (same clock as get_time_ms()).
+ */
+int64_t get_time_us(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+      return 0;
+    }
+  }
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000LL;
+}
+
 /**
  * Get current real time in milliseconds since Unix epoch.
  * Uses CLOCK_REALTIME for wall clock time.
@@ -219,10 +232,91 @@ int set_socket_rcvbuf(int fd, int size) {
   return 0;
 }
 
+/* Per call site (format string) rate limit: at most LOGGER_RATE_BURST
+ * messages per LOGGER_RATE_WINDOW_MS; the rest are counted and reported with
+ * the first message of a later window.  A call site takes the first free
+ * slot of LOGGER_RATE_PROBES starting at its hash, and only evicts a site
+ * whose window has ended, so colliding hot sites keep their limits. */
+#define LOGGER_RATE_SLOTS 64
+#define LOGGER_RATE_PROBES 4
+#define LOGGER_RATE_WINDOW_MS 1000
+#define LOGGER_RATE_BURST 20
+
+typedef struct {
+  const char *format;
+  loglevel_t level;
+  int64_t window_start;
+  uint32_t count;
+  uint32_t suppressed;
+} logger_rate_slot_t;
+
+static _Thread_local logger_rate_slot_t logger_rate_slots[LOGGER_RATE_SLOTS];
+
+/**
+ * Account one message of a call site
+ * @param suppressed Receives the messages suppressed since this site last
+ * logged, to be reported with this message
+ * @param evicted Receives the slot's previous call site when it was evicted
+ * with messages still to report (its format, level and count are copied)
+ * @return 1 if the message must be dropped
+ */
+static int logger_rate_limited(loglevel_t level, const char *format, uint32_t *suppressed,
+                               logger_rate_slot_t *evicted) {
+  size_t home = ((uintptr_t)format >> 3) % LOGGER_RATE_SLOTS;
+  logger_rate_slot_t *slot = NULL;
+  logger_rate_slot_t *reusable = NULL;
+  int64_t now = get_time_ms();
+
+  *suppressed = 0;
+  evicted->suppressed = 0;
+  for (size_t i = 0; i < LOGGER_RATE_PROBES; i++) {
+    logger_rate_slot_t *probe = &logger_rate_slots[(home + i) % LOGGER_RATE_SLOTS];
+    if (probe->format == format) {
+      slot = probe;
+      break;
+    }
+    if (!reusable && (!probe->format || now - probe->window_start >= LOGGER_RATE_WINDOW_MS))
+      reusable = probe;
+  }
+
+  if (!slot) {
+    /* Every probed slot is busy within its window: log without a limit
+     * rather than reset another site's */
+    if (!reusable)
+      return 0;
+    if (reusable->format && reusable->suppressed > 0)
+      *evicted = *reusable;
+    reusable->format = format;
+    reusable->level = level;
+    reusable->window_start = now;
+    reusable->count = 1;
+    reusable->suppressed = 0;
+    return 0;
+  }
+
+  if (now - slot->window_start >= LOGGER_RATE_WINDOW_MS) {
+    slot->window_start = now;
+    slot->count = 0;
+  }
+  if (slot->count >= LOGGER_RATE_BURST) {
+    slot->suppressed++;
+    return 1;
+  }
+
+  slot->count++;
+  *suppressed = slot->suppressed;
+  slot->suppressed = 0;
+  return 0;
+}
+
 /**
  * Logger function. Show the message if current verbosity is above
  * logged level.
  *
+ * Workers hand the formatted line to the supervisor, which prints it, so
+ * logging never blocks an event loop on stdout.  Messages repeated faster
+ * than the per-call-site rate limit collapse into a count.
+ *
  * @param level Message log level
  * @param format printf style format string
  * @return errno or return of fputs
@@ -233,12 +327,29 @@ int logger(loglevel_t level, const char *format, ...) {
   int prefix_len, body_written, ret;
   size_t avail, body_len;
   loglevel_t current_level;
+  uint32_t suppressed = 0;
+  logger_rate_slot_t evicted = {0};
 
   current_level = status_shared ? status_shared->current_log_level : config.verbosity;
   if (current_level < level) {
     return 0;
   }
 
+  if (level > LOG_FATAL && logger_rate_limited(level, format, &suppressed, &evicted)) {
+    if (status_shared && worker_id >= 0 && worker_id < STATUS_MAX_WORKERS)
+      status_shared->worker_stats[worker_id].log_suppressed++;
+    return 0;
+  }
+
+  /* Report what a call site had suppressed before its slot went to this one */
+  if (evicted.suppressed > 0) {
+    size_t format_len = strlen(evicted.format);
+    if (format_len > 0 && evicted.format[format_len - 1] == '\n')
+      format_len--;
+    logger(evicted.level, "%u messages like \"%.*s\" suppressed", evicted.suppressed, (int)format_len,
+           evicted.format);
+  }
+
   if (worker_id == SUPERVISOR_WORKER_ID) {
     prefix_len = snprintf(message, sizeof(message), "[Supervisor] ");
   } else {
@@ -259,6 +370,15 @@ int logger(loglevel_t level, const char *format, ...) {
   /* Clamp on truncation: vsnprintf returns the length it *would* have written. */
   body_len = ((size_t)body_written >= avail) ? avail - 1 : (size_t)body_written;
 
+  if (suppressed > 0) {
+    if (body_len > 0 && message[prefix_len + body_len - 1] == '\n')
+      body_len--;
+    int note = snprintf(message + prefix_len + body_len, avail - body_len, " (%u similar messages suppressed)",
+                        suppressed);
+    if (note > 0)
+      body_len = ((size_t)note >= avail - body_len) ? avail - 1 : body_len + (size_t)note;
+  }
+
   /* Ensure the buffer ends with '\n'. Decision is based on the actual buffer
    * content (not the format string), so a trailing '\n' lost to truncation is
    * still appended back, while a '\n' already present is not duplicated. */
@@ -270,6 +390,9 @@ int logger(loglevel_t level, const char *format, ...) {
     message[prefix_len + body_len] = '\0';
   }
 
+  if (worker_id != SUPERVISOR_WORKER_ID && status_queue_worker_log(level, message, (size_t)prefix_len + body_len) == 0)
+    return (int)((size_t)prefix_len + body_len);
+
   /* Flush immediately, otherwise syslogd/journald timestamps drift and
    * startup-time logs may not appear at all. */
   ret = fputs(message, stdout);
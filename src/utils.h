@@ -25,6 +25,14 @@ int logger(loglevel_t level, const char *format, ...) __attribute__((format(prin
  */
 int64_t get_time_ms(void);
 
+/**
+ * Get current monotonic time in microseconds, on the same clock as
+ * get_time_ms().
+ *
+ * @return Current time in microseconds since an unspecified starting point
+ */
+int64_t get_time_us(void);
+
 /**
  * Get current real time in milliseconds since Unix epoch.
  * Uses CLOCK_REALTIME for wall clock time.
@@ -1,35 +1,57 @@
 #include "worker.h"
-#include "access_log.h"
 #include "configuration.h"
 #include "connection.h"
+#include "cpu_affinity.h"
 #include "epg.h"
+#include "fcc_socket_pool.h"
 #include "hashmap.h"
 #include "http_fetch.h"
+#include "http_proxy_cache.h"
+#include "http_proxy_pool.h"
 #include "m3u.h"
 #include "poller.h"
+#include "resolver.h"
 #include "rtp2httpd.h"
+#include "rtsp_fast_start.h"
+#include "rtsp_share.h"
+#include "snapshot_cache.h"
+#include "snapshot_decoder.h"
 #include "status.h"
 #include "stream.h"
+#include "thumbnail.h"
 #include "utils.h"
 #include "zerocopy.h"
 #include <errno.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
-/* fd -> connection map entry */
+/* fd -> connection (or module handler) map entry */
 typedef struct {
   int fd;
   connection_t *conn;
+  fdmap_handler_fn handler; /* Set instead of conn for module-owned fds */
+  void *opaque;
 } fdmap_entry_t;
 
-/* fd -> connection map (hashmap-based for O(1) lookups) */
-static struct hashmap *fd_map = NULL;
+/* fd -> connection map (hashmap-based for O(1) lookups), one per event loop */
+static _Thread_local struct hashmap *fd_map = NULL;
 
-/* Connection list head */
-static connection_t *conn_head = NULL;
+/* Connection list head, one per event loop */
+static _Thread_local connection_t *conn_head = NULL;
+
+/* Number of event-loop threads sharing this process (0 = one loop per process) */
+static int worker_thread_count = 0;
+
+/* Quiescent-state lock for worker-threads mode.  Every event-loop iteration
+ * holds it shared while it touches config, services and the M3U/EPG caches;
+ * the leader thread (worker 0) takes it exclusively to apply config reloads
+ * and finished M3U/EPG fetches, which therefore only happen while the other
+ * loops are parked in poller_wait(). */
+static pthread_rwlock_t shared_state_lock;
 
 /* Stop flag for graceful shutdown */
 static volatile sig_atomic_t stop_flag = 0;
@@ -38,6 +60,52 @@ static volatile sig_atomic_t stop_flag = 0;
 static volatile sig_atomic_t reload_flag = 0;
 
 #define WORKER_MAX_WRITE_BATCH 128
+#define WORKER_MAX_EVENTS 1024
+
+typedef enum { PLAYLIST_RELOAD_NONE = 0, PLAYLIST_RELOAD_M3U, PLAYLIST_RELOAD_EPG } playlist_reload_t;
+
+int worker_threads_init(int count) {
+  pthread_rwlockattr_t attr;
+
+  if (pthread_rwlockattr_init(&attr) != 0)
+    return -1;
+#ifdef __GLIBC__
+  /* Readers re-enter every loop iteration; do not let them starve the leader */
+  pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+  int r = pthread_rwlock_init(&shared_state_lock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+  if (r != 0)
+    return -1;
+
+  worker_thread_count = count;
+  return 0;
+}
+
+void worker_threads_cleanup(void) {
+  if (worker_thread_count > 0) {
+    pthread_rwlock_destroy(&shared_state_lock);
+    worker_thread_count = 0;
+  }
+}
+
+static void shared_state_read_begin(void) {
+  if (worker_thread_count > 0)
+    pthread_rwlock_rdlock(&shared_state_lock);
+}
+
+static void shared_state_write_begin(void) {
+  if (worker_thread_count > 0)
+    pthread_rwlock_wrlock(&shared_state_lock);
+}
+
+static void shared_state_end(void) {
+  if (worker_thread_count > 0)
+    pthread_rwlock_unlock(&shared_state_lock);
+}
+
+/* The leader owns config reloads and M3U/EPG refreshes for its process */
+static int worker_is_leader(void) { return worker_thread_count == 0 || worker_id == 0; }
 
 /**
  * Hash function for file descriptors
@@ -91,14 +159,32 @@ void fdmap_set(int fd, connection_t *c) {
 }
 
 /**
- * Get connection by fd
+ * Set fd -> handler mapping
  */
-connection_t *fdmap_get(int fd) {
+void fdmap_set_handler(int fd, fdmap_handler_fn handler, void *opaque) {
+  if (fd < 0 || !fd_map)
+    return;
+
+  fdmap_entry_t entry = {.fd = fd, .handler = handler, .opaque = opaque};
+  hashmap_set(fd_map, &entry);
+}
+
+/**
+ * Look up the map entry of fd
+ */
+static const fdmap_entry_t *fdmap_lookup(int fd) {
   if (fd < 0 || !fd_map)
     return NULL;
 
   fdmap_entry_t key = {.fd = fd};
-  const fdmap_entry_t *entry = hashmap_get(fd_map, &key);
+  return hashmap_get(fd_map, &key);
+}
+
+/**
+ * Get connection by fd
+ */
+connection_t *fdmap_get(int fd) {
+  const fdmap_entry_t *entry = fdmap_lookup(fd);
   return entry ? entry->conn : NULL;
 }
 
@@ -158,10 +244,41 @@ static void remove_connection_from_list(connection_t *c) {
   }
 }
 
+connection_t *worker_add_connection(int epfd, int fd, struct sockaddr_storage *addr, socklen_t addr_len) {
+  connection_t *c = connection_create(fd, epfd, addr, addr_len);
+  if (!c) {
+    close(fd);
+    return NULL;
+  }
+
+  /* link */
+  c->next = conn_head;
+  conn_head = c;
+
+  /* Add client fd to poller and map */
+  if (poller_add(epfd, fd, POLLER_IN | POLLER_RDHUP | POLLER_HUP | POLLER_ERR) < 0) {
+    logger(LOG_ERROR, "poller_add client failed: %s", strerror(errno));
+    worker_close_and_free_connection(c);
+    return NULL;
+  }
+  fdmap_set(fd, c);
+  return c;
+}
+
 void worker_close_and_free_connection(connection_t *c) {
   if (!c)
     return;
 
+  /* Hand a running snapshot capture to a waiting client, or stop waiting */
+  snapshot_cache_leave(c);
+
+  /* Hand a running segment download to a waiting client, or stop waiting */
+  http_proxy_cache_leave(c);
+
+  /* Hand a shared RTSP session to another client, or keep it lingering */
+  if (rtsp_share_leave(c))
+    return;
+
   /* CRITICAL: For streaming connections, initiate cleanup first to check if
    * async TEARDOWN will be started This prevents use-after-free when TEARDOWN
    * response arrives after connection is freed. */
@@ -215,6 +332,13 @@ void worker_close_and_free_connection(connection_t *c) {
   connection_cleanup(c);
 }
 
+/* A connection's response has been sent: keep it for the next request when
+ * it is persistent, otherwise close it */
+static void worker_finish_response(connection_t *c) {
+  if (connection_finish_response(c) < 0)
+    worker_close_and_free_connection(c);
+}
+
 static void term_handler(int signum) {
   (void)signum;
   stop_flag = 1;
@@ -227,6 +351,106 @@ static void sighup_handler(int signum) {
 
 void worker_install_sighup_handler(void) { signal(SIGHUP, &sighup_handler); }
 
+void worker_request_stop(void) { stop_flag = 1; }
+
+/**
+ * Decide whether the external M3U or EPG should be refreshed now.
+ * All workers perform this with staggered timing.  This handles both external
+ * M3U and inline M3U's EPG updates.  Only touches leader-owned scheduling
+ * state; the fetch itself is started by the caller.
+ */
+static playlist_reload_t worker_playlist_reload_due(int64_t now) {
+  m3u_cache_t *m3u_cache = m3u_get_cache();
+  epg_cache_t *epg_cache = epg_get_cache();
+
+  if (!(config.external_m3u_url || epg_cache->url) || config.external_m3u_update_interval < 0)
+    return PLAYLIST_RELOAD_NONE;
+
+  int64_t interval_ms = (int64_t)config.external_m3u_update_interval * 1000;
+  int64_t last_update = config.last_external_m3u_update_time;
+  int64_t worker_offset_ms = (int64_t)worker_id * 1000;
+
+  /* Check if retry is scheduled for M3U */
+  if (config.external_m3u_url && m3u_cache->next_retry_time > 0 && now >= m3u_cache->next_retry_time) {
+    logger(LOG_INFO, "M3U retry scheduled, attempting fetch (retry %d)", m3u_cache->retry_count);
+    m3u_cache->next_retry_time = 0; /* Clear retry time before attempting */
+    return PLAYLIST_RELOAD_M3U;
+  }
+
+  /* Check if retry is scheduled for EPG */
+  if (epg_cache->url && epg_cache->next_retry_time > 0 && now >= epg_cache->next_retry_time) {
+    logger(LOG_INFO, "EPG retry scheduled, attempting fetch (retry %d)", epg_cache->retry_count);
+    epg_cache->next_retry_time = 0; /* Clear retry time before attempting */
+    return PLAYLIST_RELOAD_EPG;
+  }
+
+  /* Handle first-time load: if last_update is 0, load immediately with
+     staggered timing */
+  if (last_update == 0) {
+    /* Calculate uptime to compare against staggered offset */
+    int64_t uptime_ms = get_realtime_ms() - status_shared->server_start_time;
+
+    /* Each worker loads after a staggered delay from startup (0s, 1s, 2s,
+     * ...) */
+    if (uptime_ms < worker_offset_ms)
+      return PLAYLIST_RELOAD_NONE;
+
+    /* Update timestamp immediately to prevent reentry during async
+     * operation */
+    config.last_external_m3u_update_time = now;
+
+    if (config.external_m3u_url) {
+      /* External M3U: reload it (will also fetch EPG if found in M3U) */
+      logger(LOG_INFO, "Initial external M3U load for worker %d", worker_id);
+      return PLAYLIST_RELOAD_M3U;
+    }
+    /* Inline M3U with EPG: only fetch EPG */
+    logger(LOG_INFO, "Initial EPG load (from inline M3U) for worker %d", worker_id);
+    return PLAYLIST_RELOAD_EPG;
+  }
+
+  /* Handle periodic updates (only if interval > 0) */
+  if (interval_ms <= 0)
+    return PLAYLIST_RELOAD_NONE;
+
+  int64_t time_since_last_update = now - last_update;
+
+  /* Check if it's time for this worker to update */
+  if (time_since_last_update < (interval_ms + worker_offset_ms))
+    return PLAYLIST_RELOAD_NONE;
+
+  /* Also check if this update cycle hasn't been done yet by checking
+   * if enough time has passed since the interval started */
+  int64_t current_cycle = time_since_last_update / interval_ms;
+  int64_t expected_update_time = current_cycle * interval_ms + worker_offset_ms;
+  if (time_since_last_update < expected_update_time)
+    return PLAYLIST_RELOAD_NONE;
+
+  /* Update timestamp immediately to prevent reentry during async
+   * operation.  Note: We always update timestamp regardless of
+   * success/failure to avoid hammering the server with repeated requests */
+  config.last_external_m3u_update_time = now;
+
+  if (config.external_m3u_url) {
+    /* External M3U: reload it (will also fetch EPG if found in M3U) */
+    logger(LOG_DEBUG,
+           "External M3U update interval reached for worker %d, "
+           "reloading...",
+           worker_id);
+    /* Reset retry state for new update cycle */
+    m3u_cache->retry_count = 0;
+    m3u_cache->next_retry_time = 0;
+    return PLAYLIST_RELOAD_M3U;
+  }
+
+  /* Inline M3U with EPG: only fetch EPG */
+  logger(LOG_DEBUG, "EPG update interval reached for worker %d, reloading...", worker_id);
+  /* Reset retry state for new update cycle */
+  epg_cache->retry_count = 0;
+  epg_cache->next_retry_time = 0;
+  return PLAYLIST_RELOAD_EPG;
+}
+
 int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
   int i;
   struct sockaddr_storage client;
@@ -241,7 +465,8 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
     return -1;
   }
 
-  poller_event_t events[1024];
+  poller_event_t events[WORKER_MAX_EVENTS];
+  http_fetch_ctx_t *fetch_events[WORKER_MAX_EVENTS];
   for (i = 0; i < num_sockets; i++) {
     connection_set_nonblocking(listen_sockets[i]);
     if (poller_add(epfd, listen_sockets[i], POLLER_IN) < 0) {
@@ -258,6 +483,10 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
     }
   }
 
+  resolver_init(epfd);
+  snapshot_decoder_pool_init(epfd);
+  thumbnail_init(epfd);
+
   /* Register signal handlers */
   signal(SIGTERM, &term_handler);
   signal(SIGINT, &term_handler);
@@ -277,18 +506,23 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
     }
 
     int64_t now = get_time_ms();
+    int num_fetch_events = 0;
+    playlist_reload_t playlist_reload = PLAYLIST_RELOAD_NONE;
 
     /* Handle SIGHUP reload request */
-    if (reload_flag) {
+    if (reload_flag && worker_is_leader()) {
       reload_flag = 0;
       logger(LOG_INFO, "Received SIGHUP, reloading configuration");
 
+      shared_state_write_begin();
       if (config_reload(NULL) != 0) {
         logger(LOG_ERROR, "Configuration reload failed, keeping old config");
       }
-      access_log_reopen();
+      shared_state_end();
     }
 
+    shared_state_read_begin();
+
     /* 1) Handle all ready events */
     for (int e = 0; e < n; e++) {
       int fd_ready = events[e].fd;
@@ -365,44 +599,35 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
           connection_set_nonblocking(cfd);
           if (client.ss_family == AF_INET || client.ss_family == AF_INET6) {
             connection_set_tcp_nodelay(cfd);
+            cpu_affinity_note_accept(cfd);
+            cpu_affinity_set_incoming_cpu(cfd);
           }
 
-          /* Create connection
-           * status_index will be assigned later by status_register_client() if
-           * this is a streaming client */
-          connection_t *c = connection_create(cfd, epfd, &client, alen);
-          if (!c) {
-            close(cfd);
-            continue;
-          }
-
-          /* link */
-          c->next = conn_head;
-          conn_head = c;
-
-          /* Add client fd to poller and map */
-          if (poller_add(epfd, cfd, POLLER_IN | POLLER_RDHUP | POLLER_HUP | POLLER_ERR) < 0) {
-            logger(LOG_ERROR, "poller_add client failed: %s", strerror(errno));
-            worker_close_and_free_connection(c);
-          } else {
-            fdmap_set(cfd, c);
-          }
+          /* status_index will be assigned later by status_register_client()
+           * if this is a streaming client */
+          worker_add_connection(epfd, cfd, &client, alen);
         }
         continue;
       }
 
-      /* Check if this is an async HTTP fetch fd */
+      /* Check if this is an async HTTP fetch fd.  Completions replace
+       * services and the M3U/EPG caches, so they are handled after this
+       * batch with exclusive access to shared state. */
       http_fetch_ctx_t *fetch_ctx = http_fetch_find_by_fd(fd_ready);
       if (fetch_ctx) {
-        /* Handle HTTP fetch event */
-        (void)http_fetch_handle_event(fetch_ctx);
-        /* Return value: 0 = more data expected, 1 = completed, -1 = error
-         * In all cases, the context handles cleanup internally */
+        fetch_events[num_fetch_events++] = fetch_ctx;
         continue;
       }
 
       /* Non-listener: lookup by fd map */
-      connection_t *c = fdmap_get(fd_ready);
+      const fdmap_entry_t *entry = fdmap_lookup(fd_ready);
+      if (entry && entry->handler) {
+        /* Module-owned fd (snapshot decoder pipes, DNS lookup sockets,
+         * thumbnail captures) */
+        entry->handler(fd_ready, events[e].events, now, entry->opaque);
+        continue;
+      }
+      connection_t *c = entry ? entry->conn : NULL;
       if (c) {
         if (fd_ready == c->fd) {
           /* Client socket events */
@@ -421,7 +646,7 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
               if (completions > 0) {
                 had_zerocopy_completions = 1;
                 if (c->state == CONN_CLOSING && !c->zc_queue.head && !c->zc_queue.pending_head) {
-                  worker_close_and_free_connection(c);
+                  worker_finish_response(c);
                   continue; /* Skip further processing for this connection */
                 }
               } else if (completions < 0) {
@@ -490,7 +715,7 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
               /* Normal HTTP request handling */
               connection_handle_read(c);
               if (c->state == CONN_CLOSING && !c->zc_queue.head) {
-                worker_close_and_free_connection(c);
+                worker_finish_response(c);
                 continue; /* Skip further processing for this connection */
               }
             }
@@ -499,7 +724,7 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
           if (events[e].events & POLLER_OUT) {
             connection_write_status_t status = connection_handle_write(c);
             if (status == CONNECTION_WRITE_CLOSED) {
-              worker_close_and_free_connection(c);
+              worker_finish_response(c);
               continue;
             }
           }
@@ -528,6 +753,17 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
     /* 2) Periodic tick: update streams and SSE heartbeats */
     if (now - last_tick >= timeout_ms) {
       last_tick = now;
+      cpu_affinity_update_stats();
+      resolver_tick(now);
+      snapshot_decoder_tick(now);
+      snapshot_cache_tick(now);
+      rtsp_share_tick(now);
+      http_proxy_pool_tick(now);
+      http_proxy_cache_tick(now);
+      fcc_socket_pool_tick(now);
+      thumbnail_tick(now);
+      /* Timed out / failed in-process fetches complete with the fetch events */
+      num_fetch_events = http_fetch_tick(now, fetch_events, num_fetch_events, WORKER_MAX_EVENTS);
       connection_t *c = conn_head;
       while (c) {
         connection_t *next = c->next; /* Save next pointer before potential cleanup */
@@ -552,106 +788,52 @@ int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd) {
           }
         } else if (c->state == CONN_SSE) {
           status_handle_sse_heartbeat(c, now);
+        } else if (connection_check_idle_timeout(c, now) < 0) {
+          worker_close_and_free_connection(c);
         }
         c = next;
       }
 
-      /* Check if M3U/EPG needs to be reloaded (all workers perform this with
-       * staggered timing) This handles both external M3U and inline M3U's EPG
-       * updates */
-      m3u_cache_t *m3u_cache = m3u_get_cache();
-      epg_cache_t *epg_cache = epg_get_cache();
-
-      if ((config.external_m3u_url || epg_cache->url) && config.external_m3u_update_interval >= 0) {
-        int64_t interval_ms = (int64_t)config.external_m3u_update_interval * 1000;
-        int64_t last_update = config.last_external_m3u_update_time;
-        int64_t worker_offset_ms = (int64_t)worker_id * 1000;
-
-        /* Check if retry is scheduled for M3U */
-        if (config.external_m3u_url && m3u_cache->next_retry_time > 0 && now >= m3u_cache->next_retry_time) {
-          logger(LOG_INFO, "M3U retry scheduled, attempting fetch (retry %d)", m3u_cache->retry_count);
-          m3u_cache->next_retry_time = 0; /* Clear retry time before attempting */
-          m3u_reload_external_async(epfd);
-        }
-        /* Check if retry is scheduled for EPG */
-        else if (epg_cache->url && epg_cache->next_retry_time > 0 && now >= epg_cache->next_retry_time) {
-          logger(LOG_INFO, "EPG retry scheduled, attempting fetch (retry %d)", epg_cache->retry_count);
-          epg_cache->next_retry_time = 0; /* Clear retry time before attempting */
-          epg_fetch_async(epfd);
-        }
-        /* Handle first-time load: if last_update is 0, load immediately with
-           staggered timing */
-        else if (last_update == 0) {
-          /* Calculate uptime to compare against staggered offset */
-          int64_t uptime_ms = get_realtime_ms() - status_shared->server_start_time;
-
-          /* Each worker loads after a staggered delay from startup (0s, 1s, 2s,
-           * ...) */
-          if (uptime_ms >= worker_offset_ms) {
-            /* Update timestamp immediately to prevent reentry during async
-             * operation */
-            config.last_external_m3u_update_time = now;
-
-            if (config.external_m3u_url) {
-              /* External M3U: reload it (will also fetch EPG if found in M3U)
-               */
-              logger(LOG_INFO, "Initial external M3U load for worker %d", worker_id);
-              m3u_reload_external_async(epfd);
-            } else if (epg_cache->url) {
-              /* Inline M3U with EPG: only fetch EPG */
-              logger(LOG_INFO, "Initial EPG load (from inline M3U) for worker %d", worker_id);
-              epg_fetch_async(epfd);
-            }
-          }
-        }
-        /* Handle periodic updates (only if interval > 0) */
-        else if (interval_ms > 0) {
-          int64_t time_since_last_update = now - last_update;
-
-          /* Check if it's time for this worker to update */
-          if (time_since_last_update >= (interval_ms + worker_offset_ms)) {
-            /* Also check if this update cycle hasn't been done yet by checking
-             * if enough time has passed since the interval started */
-            int64_t current_cycle = time_since_last_update / interval_ms;
-            int64_t expected_update_time = current_cycle * interval_ms + worker_offset_ms;
-
-            if (time_since_last_update >= expected_update_time) {
-              /* Update timestamp immediately to prevent reentry during async
-               * operation */
-              config.last_external_m3u_update_time = now;
-
-              if (config.external_m3u_url) {
-                /* External M3U: reload it (will also fetch EPG if found in M3U)
-                 */
-                logger(LOG_DEBUG,
-                       "External M3U update interval reached for worker %d, "
-                       "reloading...",
-                       worker_id);
-                /* Reset retry state for new update cycle */
-                m3u_cache->retry_count = 0;
-                m3u_cache->next_retry_time = 0;
-                m3u_reload_external_async(epfd);
-              } else if (epg_cache->url) {
-                /* Inline M3U with EPG: only fetch EPG */
-                logger(LOG_DEBUG, "EPG update interval reached for worker %d, reloading...", worker_id);
-                /* Reset retry state for new update cycle */
-                epg_cache->retry_count = 0;
-                epg_cache->next_retry_time = 0;
-                epg_fetch_async(epfd);
-              }
-              /* Note: We always update timestamp regardless of success/failure
-               * to avoid hammering the server with repeated requests */
-            }
-          }
-        }
+      if (worker_is_leader())
+        playlist_reload = worker_playlist_reload_due(now);
+    }
+
+    shared_state_end();
+
+    /* Fetch completions, refreshes and a finished EPG index replace shared state */
+    int publish_epg_index = worker_is_leader() && epg_index_pending();
+    if (num_fetch_events > 0 || playlist_reload != PLAYLIST_RELOAD_NONE || publish_epg_index) {
+      shared_state_write_begin();
+      if (publish_epg_index)
+        epg_publish_index();
+      for (int f = 0; f < num_fetch_events; f++) {
+        /* Return value: 0 = more data expected, 1 = completed, -1 = error
+         * In all cases, the context handles cleanup internally */
+        (void)http_fetch_handle_event(fetch_events[f]);
       }
+      if (playlist_reload == PLAYLIST_RELOAD_M3U)
+        m3u_reload_external_async(epfd);
+      else if (playlist_reload == PLAYLIST_RELOAD_EPG)
+        epg_fetch_async(epfd);
+      shared_state_end();
     }
   }
 
-  /* Cleanup: close all active connections */
+  /* Cleanup: close all active connections; without shares nothing lingers */
+  rtsp_share_cleanup();
+  rtsp_fast_start_cleanup();
+  http_proxy_pool_cleanup();
   while (conn_head)
     worker_close_and_free_connection(conn_head);
 
+  thumbnail_cleanup();
+  snapshot_cache_cleanup();
+  http_proxy_cache_cleanup();
+  fcc_socket_pool_cleanup();
+  snapshot_decoder_pool_cleanup();
+  m3u_rendered_cache_cleanup();
+  resolver_cleanup();
+
   /* Cleanup fd map */
   fdmap_cleanup();
 
@@ -19,10 +19,28 @@ void fdmap_init(void);
  */
 void fdmap_set(int fd, connection_t *c);
 
+/**
+ * Handler for an fd that belongs to an event-loop module rather than to a
+ * connection (e.g. snapshot decoder pipes)
+ * @param fd Ready file descriptor
+ * @param events Poller events
+ * @param now Current time in milliseconds
+ * @param opaque Pointer registered with fdmap_set_handler()
+ */
+typedef void (*fdmap_handler_fn)(int fd, uint32_t events, int64_t now, void *opaque);
+
+/**
+ * Set fd -> handler mapping; the event loop calls handler for events on fd
+ * @param fd File descriptor
+ * @param handler Event handler
+ * @param opaque Passed to handler
+ */
+void fdmap_set_handler(int fd, fdmap_handler_fn handler, void *opaque);
+
 /**
  * Get connection by fd
  * @param fd File descriptor
- * @return Connection pointer or NULL
+ * @return Connection pointer or NULL (also for fds mapped to a handler)
  */
 connection_t *fdmap_get(int fd);
 
@@ -40,6 +58,24 @@ void fdmap_cleanup(void);
 /** Install the worker SIGHUP handler before startup signals are unblocked. */
 void worker_install_sighup_handler(void);
 
+/**
+ * Prepare this process to run several event loops as threads
+ * (worker-threads mode).  Must be called before the threads start.
+ * @param count Number of event-loop threads
+ * @return 0 on success, -1 on error
+ */
+int worker_threads_init(int count);
+
+/**
+ * Release worker-threads state after all event-loop threads have exited
+ */
+void worker_threads_cleanup(void);
+
+/**
+ * Ask every event loop in this process to exit
+ */
+void worker_request_stop(void);
+
 /**
  * Run the worker event loop
  * @param listen_sockets Array of listening socket fds
@@ -49,6 +85,17 @@ void worker_install_sighup_handler(void);
  */
 int worker_run_event_loop(int *listen_sockets, int num_sockets, int notif_fd);
 
+/**
+ * Create a connection for a client socket and add it to this event loop
+ * On failure the socket is closed
+ * @param epfd Poller of the calling event loop
+ * @param fd Client socket (non-blocking)
+ * @param addr Client address, NULL for internal connections
+ * @param addr_len Client address length, 0 for internal connections
+ * @return New connection, or NULL on failure
+ */
+connection_t *worker_add_connection(int epfd, int fd, struct sockaddr_storage *addr, socklen_t addr_len);
+
 /**
  * Close and free a connection, removing it from the list
  * @param c Connection to close
@@ -14,8 +14,8 @@
 #include <linux/errqueue.h>
 #endif
 
-/* Global zero-copy state */
-zerocopy_state_t zerocopy_state = {0};
+/* Per-worker zero-copy state */
+_Thread_local zerocopy_state_t zerocopy_state = {0};
 
 /**
  * Helper macro to access this worker's statistics in shared memory
@@ -46,8 +46,8 @@ typedef struct zerocopy_state_s {
   int initialized;            /* Whether initialized */
 } zerocopy_state_t;
 
-/* Global zero-copy state */
-extern zerocopy_state_t zerocopy_state;
+/* Per-worker zero-copy state (thread-local: each worker thread owns its pools) */
+extern _Thread_local zerocopy_state_t zerocopy_state;
 
 /**
  * Initialize zero-copy infrastructure
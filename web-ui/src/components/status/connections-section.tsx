@@ -53,6 +53,20 @@ function ClientStateBadge({ client, locale }: { client: ClientRow; locale: Local
   );
 }
 
+/* "Jitter 1.2 ms · Loss 0.05% · RTT 8 ms" for RTP upstreams */
+function UpstreamQuality({ client, locale, className }: { client: ClientRow; locale: Locale; className?: string }) {
+  const t = useStatusTranslation(locale);
+  const rttMs = client.rttMs ?? -1;
+  if (!client.rtpExpected && rttMs < 0) return null;
+  const parts: string[] = [];
+  if (client.rtpExpected) {
+    parts.push(`${t("upstreamJitter")} ${(client.jitterUs / 1000).toFixed(1)} ms`);
+    parts.push(`${t("upstreamLoss")} ${((client.rtpLost * 100) / client.rtpExpected).toFixed(2)}%`);
+  }
+  if (rttMs >= 0) parts.push(`${t("upstreamRtt")} ${rttMs} ms`);
+  return <div className={clsx("text-xs text-muted-foreground tabular-nums", className)}>{parts.join(" · ")}</div>;
+}
+
 interface ConnectionsSectionProps {
   clients: ClientRow[];
   locale: Locale;
@@ -134,6 +148,7 @@ function ConnectionsSectionComponent({
                     <TableCell>
                       <ClientStateBadge client={client} locale={locale} />
                       {client.slow ? <div className="mt-2 text-xs text-destructive">{t("slowClient")}</div> : null}
+                      <UpstreamQuality client={client} locale={locale} className="mt-2 whitespace-nowrap" />
                     </TableCell>
                     <TableCell className="whitespace-nowrap text-right tabular-nums">
                       {formatDuration(client.isDisconnected ? (client.disconnectDurationMs ?? 0) : client.durationMs)}
@@ -208,6 +223,7 @@ function ConnectionsSectionComponent({
                     <span>
                       {t("dataSent")}: {formatBytes(client.bytesSent)}
                     </span>
+                    <UpstreamQuality client={client} locale={locale} className="col-span-2" />
                   </div>
                   <QueueUsage
                     locale={locale}
@@ -47,6 +47,129 @@ function WorkersSectionComponent({ workers, locale, bandwidthUnit }: WorkersSect
               ["sendBatch", t("sendBatch"), worker.send.batch.toLocaleString()],
               ["sendEagain", t("sendEagain"), worker.send.eagain.toLocaleString()],
               ["sendEnobufs", t("sendEnobufs"), worker.send.enobufs.toLocaleString()],
+              ...(worker.cpu
+                ? ([
+                    [
+                      "cpuAffinity",
+                      t("cpuAffinity"),
+                      worker.cpu.affinity >= 0 ? `#${worker.cpu.affinity}` : t("cpuUnpinned"),
+                    ],
+                    [
+                      "crossCpuAccepts",
+                      t("crossCpuAccepts"),
+                      `${worker.cpu.crossCpuAccepts.toLocaleString()} / ${worker.cpu.accepts.toLocaleString()}`,
+                    ],
+                    [
+                      "crossCpuRxSamples",
+                      t("crossCpuRxSamples"),
+                      `${worker.cpu.crossCpuRxSamples.toLocaleString()} / ${worker.cpu.rxSamples.toLocaleString()}`,
+                    ],
+                  ] as const)
+                : []),
+              ...(worker.snapshot && worker.snapshot.spawns > 0
+                ? ([
+                    [
+                      "snapshotDecoders",
+                      t("snapshotDecoders"),
+                      `${worker.snapshot.busy} / ${worker.snapshot.decoders} (${t("snapshotQueued")} ${worker.snapshot.queued})`,
+                    ],
+                    ["snapshotJobs", t("snapshotJobs"), worker.snapshot.jobs.toLocaleString()],
+                    [
+                      "snapshotShared",
+                      t("snapshotShared"),
+                      ((worker.snapshot.cacheHits ?? 0) + (worker.snapshot.coalesced ?? 0)).toLocaleString(),
+                    ],
+                    [
+                      "snapshotFailures",
+                      t("snapshotFailures"),
+                      (
+                        worker.snapshot.failures +
+                        worker.snapshot.timeouts +
+                        worker.snapshot.rejects
+                      ).toLocaleString(),
+                    ],
+                  ] as const)
+                : []),
+              ...(worker.dns && worker.dns.lookups + worker.dns.cacheHits > 0
+                ? ([
+                    [
+                      "dnsLookups",
+                      t("dnsLookups"),
+                      `${(worker.dns.lookups + worker.dns.cacheHits).toLocaleString()} (${worker.dns.cacheHits.toLocaleString()})`,
+                    ],
+                    [
+                      "dnsLatency",
+                      t("dnsLatency"),
+                      `${worker.dns.lookups > 0 ? Math.round(worker.dns.latencyTotalMs / worker.dns.lookups) : 0} / ${worker.dns.latencyMaxMs} ms`,
+                    ],
+                    ["dnsFailures", t("dnsFailures"), worker.dns.failures.toLocaleString()],
+                  ] as const)
+                : []),
+              ...(worker.http && worker.http.requests > 0
+                ? ([
+                    [
+                      "httpKeepalive",
+                      t("httpKeepalive"),
+                      `${worker.http.keepaliveReuses.toLocaleString()} / ${worker.http.requests.toLocaleString()}`,
+                    ],
+                    [
+                      "httpPipelined",
+                      t("httpPipelined"),
+                      `${worker.http.pipelined.toLocaleString()} (${worker.http.idleTimeouts.toLocaleString()})`,
+                    ],
+                  ] as const)
+                : []),
+              ...(worker.http && worker.http.upstreamReuses + worker.http.upstreamConnects > 0
+                ? ([
+                    [
+                      "httpUpstreamReuses",
+                      t("httpUpstreamReuses"),
+                      `${worker.http.upstreamReuses.toLocaleString()} / ${(worker.http.upstreamReuses + worker.http.upstreamConnects).toLocaleString()} (${worker.http.upstreamIdle.toLocaleString()})`,
+                    ],
+                  ] as const)
+                : []),
+              ...(worker.http && (worker.http.segmentHits ?? 0) + (worker.http.segmentCoalesced ?? 0) > 0
+                ? ([
+                    [
+                      "httpSegmentShared",
+                      t("httpSegmentShared"),
+                      `${((worker.http.segmentHits ?? 0) + (worker.http.segmentCoalesced ?? 0)).toLocaleString()} (${(worker.http.segmentCached ?? 0).toLocaleString()}, ${formatBytes(worker.http.segmentCacheBytes ?? 0)})`,
+                    ],
+                  ] as const)
+                : []),
+              ...(worker.accessLog && worker.accessLog.records + worker.accessLog.dropped > 0
+                ? ([
+                    [
+                      "accessLog",
+                      t("accessLog"),
+                      `${worker.accessLog.records.toLocaleString()} (${worker.accessLog.dropped.toLocaleString()})`,
+                    ],
+                  ] as const)
+                : []),
+              ...(worker.logger && worker.logger.dropped + worker.logger.suppressed > 0
+                ? ([
+                    [
+                      "loggerDropped",
+                      t("loggerDropped"),
+                      `${worker.logger.suppressed.toLocaleString()} / ${worker.logger.dropped.toLocaleString()}`,
+                    ],
+                  ] as const)
+                : []),
+              ...(worker.rtsp && worker.rtsp.sharedJoins > 0
+                ? ([["rtspSharedJoins", t("rtspSharedJoins"), worker.rtsp.sharedJoins.toLocaleString()]] as const)
+                : []),
+              ...(worker.rtsp && worker.rtsp.fastStarts > 0
+                ? ([["rtspFastStarts", t("rtspFastStarts"), worker.rtsp.fastStarts.toLocaleString()]] as const)
+                : []),
+              ...(worker.fcc && worker.fcc.poolHits + worker.fcc.poolMisses > 0
+                ? ([
+                    [
+                      "fccPoolHits",
+                      t("fccPoolHits"),
+                      `${worker.fcc.poolHits.toLocaleString()} / ${(worker.fcc.poolHits + worker.fcc.poolMisses).toLocaleString()} (${worker.fcc.poolIdle.toLocaleString()})`,
+                    ],
+                  ] as const)
+                : []),
             ] as const;
             return (
               <Card
@@ -1,10 +1,10 @@
 import { useCallback, useEffect, useRef, useState } from "react";
 import { buildStatusPath } from "../lib/url";
-import type { StatusPayload } from "../types";
+import type { StatusEvent } from "../types";
 import type { ConnectionState } from "../types/ui";
 
 export function useSse(
-  onPayload: (payload: StatusPayload) => void,
+  onPayload: (payload: StatusEvent) => void,
   onConnectionChange: (state: ConnectionState) => void,
 ) {
   const reconnectRef = useRef<number>(0);
@@ -40,7 +40,7 @@ export function useSse(
 
     source.onmessage = (event) => {
       try {
-        const payload = JSON.parse(event.data) as StatusPayload;
+        const payload = JSON.parse(event.data) as StatusEvent;
         onPayload(payload);
       } catch (error) {
         console.error("Failed to parse SSE payload", error);
@@ -32,6 +32,9 @@ const base: TranslationDict = {
   reconnecting: "Reconnecting…",
   workerPid: "Worker PID",
   slowClient: "Slow client",
+  upstreamJitter: "Jitter",
+  upstreamLoss: "Loss",
+  upstreamRtt: "RTT",
   bufferPool: "Buffer pool",
   controlPool: "Control pool",
   sendStats: "Send stats",
@@ -40,6 +43,27 @@ const base: TranslationDict = {
   sendCopied: "Copied",
   sendEagain: "EAGAIN",
   sendEnobufs: "ENOBUFS",
+  cpuAffinity: "Pinned CPU",
+  cpuUnpinned: "Unpinned",
+  crossCpuAccepts: "Cross-CPU accepts",
+  crossCpuRxSamples: "Cross-CPU RX samples",
+  snapshotDecoders: "Busy snapshot decoders",
+  snapshotQueued: "queued",
+  snapshotJobs: "Snapshots",
+  snapshotShared: "Shared snapshots",
+  snapshotFailures: "Failed snapshots",
+  dnsLookups: "DNS lookups (cached)",
+  dnsLatency: "Avg / max DNS latency",
+  dnsFailures: "Failed DNS lookups",
+  httpKeepalive: "Keep-alive reuses / requests",
+  httpPipelined: "Pipelined requests (idle timeouts)",
+  httpUpstreamReuses: "Proxy upstream reuses / requests (idle)",
+  httpSegmentShared: "Shared HLS segments (cached)",
+  accessLog: "Access log lines (dropped)",
+  loggerDropped: "Log messages suppressed / dropped",
+  rtspSharedJoins: "Shared RTSP joins",
+  rtspFastStarts: "RTSP fast starts",
+  fccPoolHits: "Pre-bound FCC sockets used / sessions (idle)",
   sendBatch: "Batch flushes",
   poolTotal: "Total",
   poolFree: "Free",
@@ -133,6 +157,9 @@ const zhHans: TranslationDict = {
   reconnecting: "重新连接中…",
   workerPid: "工作进程 PID",
   slowClient: "慢客户端",
+  upstreamJitter: "抖动",
+  upstreamLoss: "丢包",
+  upstreamRtt: "往返时延",
   bufferPool: "缓冲池",
   controlPool: "控制池",
   sendStats: "发送统计",
@@ -141,6 +168,27 @@ const zhHans: TranslationDict = {
   sendCopied: "拷贝次数",
   sendEagain: "EAGAIN 次数",
   sendEnobufs: "ENOBUFS 次数",
+  cpuAffinity: "绑定 CPU",
+  cpuUnpinned: "未绑定",
+  crossCpuAccepts: "跨 CPU 接入",
+  crossCpuRxSamples: "跨 CPU 收包采样",
+  snapshotDecoders: "忙碌快照解码器",
+  snapshotQueued: "排队",
+  snapshotJobs: "快照数",
+  snapshotShared: "复用快照",
+  snapshotFailures: "快照失败",
+  dnsLookups: "DNS 查询（缓存命中）",
+  dnsLatency: "DNS 平均 / 最大延迟",
+  dnsFailures: "DNS 解析失败",
+  httpKeepalive: "长连接复用 / 请求数",
+  httpPipelined: "管线化请求（空闲超时）",
+  httpUpstreamReuses: "代理上游连接复用 / 请求数（空闲）",
+  httpSegmentShared: "共享的 HLS 分片（已缓存）",
+  accessLog: "访问日志行数（丢弃）",
+  loggerDropped: "日志消息合并 / 丢弃",
+  rtspSharedJoins: "RTSP 共享会话加入",
+  rtspFastStarts: "RTSP 快速起播",
+  fccPoolHits: "预绑定 FCC 套接字使用 / 会话（空闲）",
   sendBatch: "批量刷新",
   poolTotal: "总量",
   poolFree: "空闲",
@@ -235,6 +283,9 @@ const zhHant: TranslationDict = {
   reconnecting: "重新連線中…",
   workerPid: "工作進程 PID",
   slowClient: "慢速客戶端",
+  upstreamJitter: "抖動",
+  upstreamLoss: "丟包",
+  upstreamRtt: "往返延遲",
   bufferPool: "緩衝池",
   controlPool: "控制池",
   sendStats: "傳送統計",
@@ -243,6 +294,27 @@ const zhHant: TranslationDict = {
   sendCopied: "拷貝次數",
   sendEagain: "EAGAIN 次數",
   sendEnobufs: "ENOBUFS 次數",
+  cpuAffinity: "綁定 CPU",
+  cpuUnpinned: "未綁定",
+  crossCpuAccepts: "跨 CPU 接入",
+  crossCpuRxSamples: "跨 CPU 收包取樣",
+  snapshotDecoders: "忙碌快照解碼器",
+  snapshotQueued: "排隊",
+  snapshotJobs: "快照數",
+  snapshotShared: "複用快照",
+  snapshotFailures: "快照失敗",
+  dnsLookups: "DNS 查詢（快取命中）",
+  dnsLatency: "DNS 平均 / 最大延遲",
+  dnsFailures: "DNS 解析失敗",
+  httpKeepalive: "長連線複用 / 請求數",
+  httpPipelined: "管線化請求（閒置逾時）",
+  httpUpstreamReuses: "代理上游連線複用 / 請求數（閒置）",
+  httpSegmentShared: "共享的 HLS 分片（已快取）",
+  accessLog: "存取日誌行數（捨棄）",
+  loggerDropped: "日誌訊息合併 / 捨棄",
+  rtspSharedJoins: "RTSP 共享工作階段加入",
+  rtspFastStarts: "RTSP 快速起播",
+  fccPoolHits: "預先綁定的 FCC 通訊端使用 / 工作階段（閒置）",
   sendBatch: "批次刷新",
   poolTotal: "總量",
   poolFree: "空閒",
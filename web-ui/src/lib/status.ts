@@ -1,6 +1,6 @@
 import type { TranslationKey } from "../i18n/status";
 import { translations } from "../i18n/status";
-import type { ClientEntry, ClientRow } from "../types";
+import type { ClientEntry, ClientRow, StatusDelta, StatusPayload } from "../types";
 import { ClientState } from "../types";
 import type { Locale } from "./locale";
 
@@ -69,6 +69,44 @@ export function stateToLabel(locale: Locale, state: ClientState): string {
   return fallbackTable[key] ?? fallbackTable[FALLBACK_STATE_KEY];
 }
 
+/* Rebuild the full payload a delta event describes on top of the previous one */
+export function applyStatusDelta(previous: StatusPayload, delta: StatusDelta): StatusPayload {
+  const elapsedMs = delta.uptimeMs - previous.uptimeMs;
+  const clients = new Map<string, ClientEntry>();
+  for (const client of previous.clients) {
+    clients.set(client.clientId, { ...client, durationMs: client.durationMs + elapsedMs });
+  }
+
+  for (const change of delta.clientChanges) {
+    if (change.op === "remove") {
+      clients.delete(change.clientId);
+    } else if (change.op === "add") {
+      const { op: _op, ...client } = change;
+      clients.set(client.clientId, client);
+    } else {
+      const existing = clients.get(change.clientId);
+      if (existing) {
+        const { op: _op, ...fields } = change;
+        clients.set(change.clientId, { ...existing, ...fields });
+      }
+    }
+  }
+
+  return {
+    ...previous,
+    uptimeMs: delta.uptimeMs,
+    currentLogLevel: delta.currentLogLevel,
+    maxClients: delta.maxClients,
+    clients: Array.from(clients.values()),
+    totalClients: delta.totalClients,
+    totalBytesSent: delta.totalBytesSent,
+    totalBandwidth: delta.totalBandwidth,
+    workers: delta.workers ?? previous.workers,
+    logsMode: delta.logsMode,
+    logs: delta.logs,
+  };
+}
+
 export function mergeClients(previous: Map<string, ClientRow>, clients: ClientEntry[]): Map<string, ClientRow> {
   const now = Date.now();
   const next = new Map(previous);
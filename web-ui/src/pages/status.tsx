@@ -1,5 +1,5 @@
 import { Activity, Gauge, Layers, Users } from "lucide-react";
-import { StrictMode, startTransition, useCallback, useDeferredValue, useMemo, useState } from "react";
+import { StrictMode, startTransition, useCallback, useDeferredValue, useMemo, useRef, useState } from "react";
 import { createRoot } from "react-dom/client";
 import { ConnectionsSection } from "../components/status/connections-section";
 import { LogsSection } from "../components/status/logs-section";
@@ -15,8 +15,8 @@ import { useStatusTranslation } from "../hooks/use-status-translation";
 import { useTheme } from "../hooks/use-theme";
 import { formatBandwidth, formatBytes, formatDuration } from "../lib/format";
 import type { Locale } from "../lib/locale";
-import { mergeClients } from "../lib/status";
-import type { ClientRow, LogEntry, StatusPayload } from "../types";
+import { applyStatusDelta, mergeClients } from "../lib/status";
+import type { ClientRow, LogEntry, StatusEvent, StatusPayload } from "../types";
 import type { ConnectionState } from "../types/ui";
 
 const LOG_LEVELS: Array<{ value: number; label: string }> = [
@@ -48,7 +48,17 @@ function StatusPage() {
   const [disconnectingIds, setDisconnectingIds] = useState<Set<string>>(new Set());
   const [lastUpdated, setLastUpdated] = useState<string>("--");
 
-  const handlePayload = useCallback((incoming: StatusPayload) => {
+  const payloadRef = useRef<StatusPayload | null>(null);
+
+  const handlePayload = useCallback((event: StatusEvent) => {
+    /* Deltas only make sense on top of the snapshot that opened the stream */
+    const previous = payloadRef.current;
+    const incoming = event.type === "delta" ? (previous ? applyStatusDelta(previous, event) : null) : event;
+    if (!incoming) {
+      return;
+    }
+    payloadRef.current = incoming;
+
     setPayload(incoming);
     setClientsMap((previous) => mergeClients(previous, incoming.clients));
     setLastUpdated(new Date().toLocaleTimeString());
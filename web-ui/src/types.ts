@@ -17,6 +17,75 @@ export interface PoolStats {
   utilization: number;
 }
 
+export interface CpuStats {
+  affinity: number;
+  current: number;
+  accepts: number;
+  crossCpuAccepts: number;
+  rxSamples: number;
+  crossCpuRxSamples: number;
+}
+
+export interface SnapshotStats {
+  decoders: number;
+  busy: number;
+  queued: number;
+  queueMax: number;
+  jobs: number;
+  failures: number;
+  timeouts: number;
+  rejects: number;
+  spawns: number;
+  cached?: number;
+  cacheHits?: number;
+  coalesced?: number;
+}
+
+export interface DnsStats {
+  queries: number;
+  cacheHits: number;
+  lookups: number;
+  failures: number;
+  latencyTotalMs: number;
+  latencyMaxMs: number;
+  cached: number;
+}
+
+export interface HttpStats {
+  requests: number;
+  keepaliveReuses: number;
+  pipelined: number;
+  idleTimeouts: number;
+  upstreamReuses: number;
+  upstreamConnects: number;
+  upstreamIdle: number;
+  segmentHits?: number;
+  segmentCoalesced?: number;
+  segmentCached?: number;
+  segmentCacheBytes?: number;
+}
+
+export interface AccessLogStats {
+  records: number;
+  dropped: number;
+}
+
+export interface LoggerStats {
+  dropped: number;
+  suppressed: number;
+}
+
+export interface RtspShareStats {
+  sharedJoins: number;
+  fastStarts: number;
+}
+
+export interface FccPoolStats {
+  poolHits: number;
+  poolMisses: number;
+  poolIdle: number;
+}
+
 export interface WorkerEntry {
   id: number;
   pid: number;
@@ -26,6 +95,14 @@ export interface WorkerEntry {
   send: SendStats;
   pool: PoolStats;
   controlPool: PoolStats;
+  cpu?: CpuStats;
+  snapshot?: SnapshotStats;
+  dns?: DnsStats;
+  http?: HttpStats;
+  accessLog?: AccessLogStats;
+  logger?: LoggerStats;
+  rtsp?: RtspShareStats;
+  fcc?: FccPoolStats;
 }
 
 export interface LogEntry {
@@ -83,9 +160,14 @@ export interface ClientEntry {
   queueBytesHighwater: number;
   droppedBytes: number;
   slow: boolean;
+  jitterUs: number /* RTP interarrival jitter of the upstream (RFC 3550) */;
+  rtpExpected: number;
+  rtpLost: number;
+  rttMs: number /* Upstream round trip, -1 if unknown */;
 }
 
 export interface StatusPayload {
+  type?: "full";
   serverStartTime: number;
   uptimeMs: number;
   currentLogLevel: number;
@@ -103,6 +185,29 @@ export interface StatusPayload {
   logs: LogEntry[];
 }
 
+/* Client change carried by a delta event, keyed by clientId */
+export type ClientChange =
+  | ({ op: "add" } & ClientEntry)
+  | ({ op: "update"; clientId: string } & Partial<Omit<ClientEntry, "clientId">>)
+  | { op: "remove"; clientId: string };
+
+/* Status event sent after the initial snapshot; workers are left out when unchanged */
+export interface StatusDelta {
+  type: "delta";
+  uptimeMs: number;
+  currentLogLevel: number;
+  maxClients: number;
+  clientChanges: ClientChange[];
+  totalClients: number;
+  totalBytesSent: number;
+  totalBandwidth: number;
+  workers?: WorkerEntry[];
+  logsMode: "none" | "full" | "incremental";
+  logs: LogEntry[];
+}
+
+export type StatusEvent = StatusPayload | StatusDelta;
+
 export interface ClientRow extends ClientEntry {
   isDisconnected: boolean;
   disconnectDurationMs?: number;